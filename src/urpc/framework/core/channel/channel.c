@@ -13,14 +13,33 @@
 #include "urpc_lib_log.h"
 #include "notify.h"
 #include "keepalive.h"
+#include "cancel.h"
 #include "crypto.h"
 #include "cp.h"
 #include "dp.h"
 #include "urpc_dbuf_stat.h"
+#include "util_epoch.h"
 #include "channel.h"
 
+#define CHANNEL_REQ_TW_WHEEL_MAX (16)    // wheels deduplicated when retiring a request entry table
+
+// request entry table freed by the last wheel which drains cancels of its timers
+typedef struct req_entry_table_retire {
+    req_entry_t *table;
+    uint32_t ref_cnt;
+} req_entry_table_retire_t;
+
 static urpc_channel_info_t *g_urpc_channels[URPC_MAX_CHANNELS] = {0};
 static urpc_channel_id_allocator_t g_urpc_channel_id_allocator = {0};
+static __thread uint32_t g_channel_select_seed;
+
+static void channel_queue_snapshot_publish(channel_queue_selector_t *selector, channel_queue_snapshot_t *snapshot)
+{
+    channel_queue_snapshot_t *old = __atomic_exchange_n(&selector->snapshot, snapshot, __ATOMIC_ACQ_REL);
+    if (old != NULL) {
+        util_epoch_retire(old, urpc_dbuf_free);
+    }
+}
 
 int channel_id_allocator_init(urpc_channel_id_allocator_t *id_allocator, uint32_t max_num)
 {
@@ -160,6 +179,63 @@ urpc_channel_info_t *channel_alloc(void)
     return info;
 }
 
+static void req_entry_table_retire_put(void *args)
+{
+    req_entry_table_retire_t *retire = (req_entry_table_retire_t *)args;
+    if (__atomic_sub_fetch(&retire->ref_cnt, 1, __ATOMIC_ACQ_REL) == 0) {
+        urpc_dbuf_free(retire->table);
+        urpc_dbuf_free(retire);
+    }
+}
+
+/* timers cancelled by other threads than the owners of their wheels stay linked until the owners poll, so the
+ * table is handed to those wheels and freed after the last of them has drained the cancels */
+static void req_entry_table_retire(urpc_channel_info_t *channel)
+{
+    req_entry_table_retire_t *retire =
+        (req_entry_table_retire_t *)urpc_dbuf_calloc(URPC_DBUF_TYPE_CHANNEL, 1, sizeof(req_entry_table_retire_t));
+    if (retire == NULL) {
+        // nothing is handed to wheels, free the table only if no wheel links its timers
+        for (uint32_t i = 0; i < channel->req_entry_size; ++i) {
+            if (util_tw_timer_cancel_wheel(&channel->req_entry_table[i].tw_timer) != NULL) {
+                URPC_LIB_LOG_ERR("retire request entry table of channel[%u] failed, leak it\n", channel->id);
+                return;
+            }
+        }
+        urpc_dbuf_free(channel->req_entry_table);
+        return;
+    }
+    retire->table = channel->req_entry_table;
+    retire->ref_cnt = 1;
+
+    util_timer_wheel_t *wheels[CHANNEL_REQ_TW_WHEEL_MAX];
+    uint32_t wheel_num = 0;
+    for (uint32_t i = 0; i < channel->req_entry_size; ++i) {
+        util_timer_wheel_t *tw = util_tw_timer_cancel_wheel(&channel->req_entry_table[i].tw_timer);
+        if (tw == NULL) {
+            continue;
+        }
+        uint32_t j = 0;
+        while (j < wheel_num && wheels[j] != tw) {
+            j++;
+        }
+        if (j < wheel_num) {
+            continue;
+        }
+        // a wheel beyond the dedup array may be handed the table again, which only takes one more reference
+        if (wheel_num < CHANNEL_REQ_TW_WHEEL_MAX) {
+            wheels[wheel_num++] = tw;
+        }
+
+        __atomic_add_fetch(&retire->ref_cnt, 1, __ATOMIC_RELAXED);
+        if (util_timer_wheel_defer(tw, req_entry_table_retire_put, retire) != URPC_SUCCESS) {
+            // the wheel may still link the timer, never drop the reference taken for it
+            URPC_LIB_LOG_ERR("retire request entry table of channel[%u] failed, leak it\n", channel->id);
+        }
+    }
+    req_entry_table_retire_put(retire);
+}
+
 int channel_free(uint32_t urpc_chid)
 {
     urpc_channel_info_t *channel = channel_get(urpc_chid);
@@ -182,6 +258,8 @@ int channel_free(uint32_t urpc_chid)
         (void)__sync_fetch_and_sub(&l_queue->ref_cnt, 1);
         urpc_dbuf_free(cur_node);
     }
+    channel_queue_snapshot_publish(&channel->r_selector, NULL);
+    channel_queue_snapshot_publish(&channel->l_selector, NULL);
 
     server_node_t *cur_server_node, *next_server_node;
     URPC_LIST_FOR_EACH_SAFE(cur_server_node, next_server_node, node, &channel->server_nodes_list) {
@@ -203,8 +281,9 @@ int channel_free(uint32_t urpc_chid)
                 urpc_timer_destroy(channel->req_entry_table[i].timer);
                 channel->req_entry_table[i].timer = NULL;
             }
+            (void)util_tw_timer_cancel(&channel->req_entry_table[i].tw_timer);
         }
-        urpc_dbuf_free(channel->req_entry_table);
+        req_entry_table_retire(channel);
     }
 
     if (URPC_LIKELY(is_feature_enable(URPC_TIMER_FEATURE_FLAG))) {
@@ -268,6 +347,7 @@ void req_entry_table_init(urpc_channel_info_t *channel)
 
     for (uint32_t i = 0; i < channel->req_entry_size; ++i) {
         (void)pthread_mutex_init(&req_entry_table[i].lock, NULL);
+        util_tw_timer_init(&req_entry_table[i].tw_timer, urpc_cancel_tw_timeout_process, &req_entry_table[i]);
     }
 
     channel->req_entry_table = req_entry_table;
@@ -311,6 +391,8 @@ req_entry_t *req_entry_get(urpc_channel_info_t *channel, void *ctx)
     req_entry->valid = 1;
     req_entry->cb = NULL;
     req_entry->cb_arg = NULL;
+    req_entry->l_slot = CHANNEL_QUEUE_SLOT_INVALID;
+    req_entry->r_slot = CHANNEL_QUEUE_SLOT_INVALID;
     (void)pthread_spin_unlock(&channel->lock);
 
     return req_entry;
@@ -349,6 +431,11 @@ req_entry_t *req_entry_query(uint32_t urpc_chid, uint32_t req_id, bool need_lock
 
 void req_entry_put(req_entry_t *req_entry)
 {
+    if (req_entry->tw_armed != URPC_FALSE) {
+        (void)util_tw_timer_cancel(&req_entry->tw_timer);
+        req_entry->tw_armed = URPC_FALSE;
+    }
+
     if (URPC_LIKELY(is_feature_enable(URPC_TIMER_FEATURE_FLAG) && req_entry->timer != NULL)) {
         urpc_timer_destroy(req_entry->timer);
         req_entry->timer = NULL;
@@ -370,6 +457,10 @@ void req_entry_put(req_entry_t *req_entry)
     }
     channel->stats[CHANNEL_REQ_ENTRY_FREE_NUM]++;
     channel->stats[CHANNEL_LAST_FREE_REQ_ID] = req_entry->req_id;
+    channel_queue_load_sub(&channel->l_selector, req_entry->l_slot);
+    channel_queue_load_sub(&channel->r_selector, req_entry->r_slot);
+    req_entry->l_slot = CHANNEL_QUEUE_SLOT_INVALID;
+    req_entry->r_slot = CHANNEL_QUEUE_SLOT_INVALID;
 }
 
 int channel_add_remote_queue(
@@ -431,6 +522,7 @@ int channel_post_add_remote_queue(urpc_channel_info_t *channel, queue_t *queue,
     URPC_SLIST_INSERT_HEAD(&channel->r_queue_nodes_head, node, node);
     channel->r_qnum++;
     queue->ref_cnt++;
+    channel_queue_snapshot_update(channel, true);
 
     return URPC_SUCCESS;
 }
@@ -438,9 +530,6 @@ int channel_post_add_remote_queue(urpc_channel_info_t *channel, queue_t *queue,
 int channel_remove_local_queue(urpc_channel_info_t *channel, queue_t *queue)
 {
     uint64_t urpc_qh = (uint64_t)(uintptr_t)queue;
-    if (channel->cur_rr_local_queue != NULL && channel->cur_rr_local_queue->urpc_qh == urpc_qh) {
-        channel->cur_rr_local_queue = NULL;
-    }
     if (channel->cur_poll_queue != NULL && channel->cur_poll_queue->urpc_qh == urpc_qh) {
         channel->cur_poll_queue = NULL;
     }
@@ -456,6 +545,7 @@ int channel_remove_local_queue(urpc_channel_info_t *channel, queue_t *queue)
             URPC_SLIST_REMOVE(&channel->l_queue_nodes_head, cur_node, queue_node, node);
             urpc_dbuf_free(cur_node);
             channel->l_qnum--;
+            channel_queue_snapshot_update(channel, false);
             return URPC_SUCCESS;
         }
     }
@@ -467,9 +557,6 @@ int channel_remove_local_queue(urpc_channel_info_t *channel, queue_t *queue)
 int channel_remove_remote_queue(urpc_channel_info_t *channel, queue_t *queue)
 {
     uint64_t urpc_qh = (uint64_t)(uintptr_t)queue;
-    if (channel->cur_rr_remote_queue != NULL && channel->cur_rr_remote_queue->urpc_qh == urpc_qh) {
-        channel->cur_rr_remote_queue = NULL;
-    }
     queue_node_t *cur_node, *next_node;
     URPC_SLIST_FOR_EACH_SAFE(cur_node, &channel->r_queue_nodes_head, node, next_node) {
         if (cur_node->urpc_qh == urpc_qh) {
@@ -478,6 +565,7 @@ int channel_remove_remote_queue(urpc_channel_info_t *channel, queue_t *queue)
                 return URPC_SUCCESS;
             }
             URPC_SLIST_REMOVE(&channel->r_queue_nodes_head, cur_node, queue_node, node);
+            channel_queue_snapshot_update(channel, true);
             (void)queue->ops->unimport_remote_queue(queue);
             channel->r_qnum--;
             urpc_dbuf_free(cur_node);
@@ -494,9 +582,6 @@ int channel_remove_remote_queue(urpc_channel_info_t *channel, queue_t *queue)
 int channel_remove_remote_queue_async(urpc_channel_info_t *channel, queue_t *queue)
 {
     uint64_t urpc_qh = (uint64_t)(uintptr_t)queue;
-    if (channel->cur_rr_remote_queue != NULL && channel->cur_rr_remote_queue->urpc_qh == urpc_qh) {
-        channel->cur_rr_remote_queue = NULL;
-    }
     queue_node_t *cur_node, *next_node;
     URPC_SLIST_FOR_EACH_SAFE(cur_node, &channel->r_queue_nodes_head, node, next_node) {
         if (cur_node->urpc_qh == urpc_qh) {
@@ -505,6 +590,7 @@ int channel_remove_remote_queue_async(urpc_channel_info_t *channel, queue_t *que
                 return URPC_SUCCESS;
             }
             URPC_SLIST_REMOVE(&channel->r_queue_nodes_head, cur_node, queue_node, node);
+            channel_queue_snapshot_update(channel, true);
             (void)queue->ops->unimport_remote_queue(queue);
             channel->r_qnum--;
             urpc_dbuf_free(cur_node);
@@ -1117,64 +1203,198 @@ void channel_queue_query(urpc_channel_info_t *channel, urpc_channel_qinfos_t *in
     (void)pthread_rwlock_unlock(&channel->rw_lock);
 }
 
-queue_t *channel_get_next_local_queue(urpc_channel_info_t *channel)
+void channel_queue_snapshot_update(urpc_channel_info_t *channel, bool is_remote)
 {
-    (void)pthread_spin_lock(&channel->lock);
-    bool reset = true;
-    queue_node_t *cur_node = channel->cur_rr_local_queue;
-    if (cur_node == NULL) {
-        reset = false;
-        cur_node = URPC_SLIST_FIRST(&channel->l_queue_nodes_head);
+    channel_queue_selector_t *selector = is_remote ? &channel->r_selector : &channel->l_selector;
+    struct queue_nodes_head *head = is_remote ? &channel->r_queue_nodes_head : &channel->l_queue_nodes_head;
+    queue_node_t *cur_node;
+    uint32_t num = 0;
+    URPC_SLIST_FOR_EACH(cur_node, head, node) {
+        num++;
+    }
+
+    channel_queue_snapshot_t *snapshot = (channel_queue_snapshot_t *)urpc_dbuf_malloc(URPC_DBUF_TYPE_CHANNEL,
+        sizeof(channel_queue_snapshot_t) + num * sizeof(channel_queue_entry_t));
+    if (snapshot == NULL) {
+        // old snapshot may refer to a removed queue, the channel has no queue to select until next update
+        URPC_LIB_LOG_ERR("malloc %s queue snapshot failed, channel[%u]\n", is_remote ? "remote" : "local",
+            channel->id);
+        channel_queue_snapshot_publish(selector, NULL);
+        return;
     }
 
-    while (cur_node != NULL) {
-        queue_t *queue = (queue_t *)(uintptr_t)cur_node->urpc_qh;
-        if (queue->status == QUEUE_STATUS_READY) {
-            channel->cur_rr_local_queue = URPC_SLIST_NEXT(cur_node, node);
-            (void)pthread_spin_unlock(&channel->lock);
-            return queue;
+    // a queue keeps its slot, so that requests in flight are still counted on it
+    channel_queue_snapshot_t *old = selector->snapshot;
+    uint64_t used[MAX_QUEUE_SIZE / BITS_PER_LONG] = {0};
+    snapshot->num = 0;
+    URPC_SLIST_FOR_EACH(cur_node, head, node) {
+        channel_queue_entry_t *entry = &snapshot->entry[snapshot->num++];
+        entry->queue = (queue_t *)(uintptr_t)cur_node->urpc_qh;
+        entry->slot = CHANNEL_QUEUE_SLOT_INVALID;
+        for (uint32_t i = 0; old != NULL && i < old->num; i++) {
+            if (old->entry[i].queue == entry->queue) {
+                entry->slot = old->entry[i].slot;
+                used[entry->slot / BITS_PER_LONG] |= 1UL << (entry->slot % BITS_PER_LONG);
+                break;
+            }
         }
-        cur_node = cur_node->node.next;
-        if (cur_node == NULL && reset) {
-            reset = false;
-            cur_node = URPC_SLIST_FIRST(&channel->l_queue_nodes_head);
+    }
+
+    uint32_t next_slot = 0;
+    for (uint32_t i = 0; i < snapshot->num; i++) {
+        channel_queue_entry_t *entry = &snapshot->entry[i];
+        if (entry->slot != CHANNEL_QUEUE_SLOT_INVALID) {
+            continue;
+        }
+        while (next_slot < MAX_QUEUE_SIZE &&
+            (used[next_slot / BITS_PER_LONG] & (1UL << (next_slot % BITS_PER_LONG))) != 0) {
+            next_slot++;
+        }
+        // queue number of a channel is limited by MAX_QUEUE_SIZE, leave the queue uncounted if it is exceeded
+        if (next_slot < MAX_QUEUE_SIZE) {
+            entry->slot = next_slot++;
         }
     }
-    (void)pthread_spin_unlock(&channel->lock);
-    URPC_LIB_LOG_DEBUG("local queue is null\n");
 
-    return NULL;
+    channel_queue_snapshot_publish(selector, snapshot);
 }
 
-queue_t *channel_get_next_remote_queue(urpc_channel_info_t *channel)
+static inline uint32_t channel_select_rand(void)
 {
-    (void)pthread_spin_lock(&channel->lock);
-    bool reset = true;
-    queue_node_t *cur_node = channel->cur_rr_remote_queue;
-    if (cur_node == NULL) {
-        reset = false;
-        cur_node = URPC_SLIST_FIRST(&channel->r_queue_nodes_head);
+    // xorshift, seeded once per thread
+    uint32_t x = g_channel_select_seed;
+    if (URPC_UNLIKELY(x == 0)) {
+        x = (uint32_t)get_timestamp_ns() | 1;
+    }
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_channel_select_seed = x;
+    return x;
+}
+
+static inline bool channel_queue_entry_ready(const channel_queue_entry_t *entry)
+{
+    return entry->queue->status == QUEUE_STATUS_READY;
+}
+
+static channel_queue_entry_t *channel_queue_select_rr(channel_queue_selector_t *selector,
+    channel_queue_snapshot_t *snapshot)
+{
+    uint32_t start = __sync_fetch_and_add(&selector->cursor, 1);
+    for (uint32_t i = 0; i < snapshot->num; i++) {
+        channel_queue_entry_t *entry = &snapshot->entry[(start + i) % snapshot->num];
+        if (channel_queue_entry_ready(entry)) {
+            return entry;
+        }
     }
 
-    while (cur_node != NULL) {
-        queue_t *queue = (queue_t *)(uintptr_t)cur_node->urpc_qh;
-        if (queue->status == QUEUE_STATUS_READY) {
-            channel->cur_rr_remote_queue = URPC_SLIST_NEXT(cur_node, node);
-            (void)pthread_spin_unlock(&channel->lock);
+    return NULL;
+}
 
-            return queue;
+static channel_queue_entry_t *channel_queue_select_least_load(channel_queue_selector_t *selector,
+    channel_queue_snapshot_t *snapshot)
+{
+    uint32_t start = __sync_fetch_and_add(&selector->cursor, 1);
+    channel_queue_entry_t *best = NULL;
+    uint32_t best_load = UINT32_MAX;
+    for (uint32_t i = 0; i < snapshot->num; i++) {
+        channel_queue_entry_t *entry = &snapshot->entry[(start + i) % snapshot->num];
+        if (!channel_queue_entry_ready(entry)) {
+            continue;
         }
-        cur_node = cur_node->node.next;
-        if (cur_node == NULL && reset) {
-            reset = false;
-            cur_node = URPC_SLIST_FIRST(&channel->r_queue_nodes_head);
+        uint32_t load = entry->slot == CHANNEL_QUEUE_SLOT_INVALID ? UINT32_MAX - 1 : selector->load[entry->slot];
+        if (load < best_load) {
+            best = entry;
+            best_load = load;
+            if (load == 0) {
+                break;
+            }
         }
     }
 
-    (void)pthread_spin_unlock(&channel->lock);
-    URPC_LIB_LOG_DEBUG("remote queue is null\n");
+    return best;
+}
 
-    return NULL;
+static channel_queue_entry_t *channel_queue_select_p2c(channel_queue_selector_t *selector,
+    channel_queue_snapshot_t *snapshot)
+{
+    if (snapshot->num == 1) {
+        return channel_queue_select_rr(selector, snapshot);
+    }
+
+    uint32_t first = channel_select_rand() % snapshot->num;
+    uint32_t second = (first + 1 + channel_select_rand() % (snapshot->num - 1)) % snapshot->num;
+    channel_queue_entry_t *a = &snapshot->entry[first];
+    channel_queue_entry_t *b = &snapshot->entry[second];
+    if (!channel_queue_entry_ready(a) || !channel_queue_entry_ready(b)) {
+        if (channel_queue_entry_ready(a)) {
+            return a;
+        }
+        return channel_queue_entry_ready(b) ? b : channel_queue_select_rr(selector, snapshot);
+    }
+
+    uint32_t load_a = a->slot == CHANNEL_QUEUE_SLOT_INVALID ? UINT32_MAX : selector->load[a->slot];
+    uint32_t load_b = b->slot == CHANNEL_QUEUE_SLOT_INVALID ? UINT32_MAX : selector->load[b->slot];
+    return load_b < load_a ? b : a;
+}
+
+static queue_t *channel_queue_select(channel_queue_selector_t *selector, urpc_queue_select_policy_t policy,
+    uint32_t *slot)
+{
+    *slot = CHANNEL_QUEUE_SLOT_INVALID;
+    if (URPC_UNLIKELY(!util_epoch_read_lock())) {
+        return NULL;
+    }
+
+    channel_queue_snapshot_t *snapshot = __atomic_load_n(&selector->snapshot, __ATOMIC_ACQUIRE);
+    if (snapshot == NULL || snapshot->num == 0) {
+        util_epoch_read_unlock();
+        return NULL;
+    }
+
+    channel_queue_entry_t *entry;
+    switch (policy) {
+        case URPC_QUEUE_SELECT_LEAST_LOAD:
+            entry = channel_queue_select_least_load(selector, snapshot);
+            break;
+        case URPC_QUEUE_SELECT_P2C:
+            entry = channel_queue_select_p2c(selector, snapshot);
+            break;
+        default:
+            entry = channel_queue_select_rr(selector, snapshot);
+            break;
+    }
+
+    queue_t *queue = NULL;
+    if (entry != NULL) {
+        queue = entry->queue;
+        // load is not counted under round robin, it costs an atomic on a shared line for each request
+        *slot = policy == URPC_QUEUE_SELECT_RR ? CHANNEL_QUEUE_SLOT_INVALID : entry->slot;
+    }
+    util_epoch_read_unlock();
+
+    return queue;
+}
+
+queue_t *channel_get_next_local_queue(urpc_channel_info_t *channel, uint32_t *slot)
+{
+    queue_t *queue = channel_queue_select(&channel->l_selector, channel->queue_select, slot);
+    if (queue == NULL) {
+        URPC_LIB_LOG_DEBUG("local queue is null\n");
+    }
+
+    return queue;
+}
+
+queue_t *channel_get_next_remote_queue(urpc_channel_info_t *channel, uint32_t *slot)
+{
+    queue_t *queue = channel_queue_select(&channel->r_selector, channel->queue_select, slot);
+    if (queue == NULL) {
+        URPC_LIB_LOG_DEBUG("remote queue is null\n");
+    }
+
+    return queue;
 }
 
 queue_t *channel_get_cur_poll_queue(urpc_channel_info_t *channel)
@@ -13,6 +13,7 @@
 #include "urpc_hmap.h"
 #include "urpc_socket.h"
 #include "urpc_timer.h"
+#include "util_timer_wheel.h"
 #include "urpc_framework_types.h"
 #include "urpc_util.h"
 
@@ -33,6 +34,8 @@ extern "C" {
 
 #define URPC_ATTR_MANAGE                        1
 
+#define CHANNEL_QUEUE_SLOT_INVALID              0xffff
+
 typedef enum urpc_channel_status {
     /* channel is idle */
     URPC_CHANNEL_IDLE = 0,
@@ -69,6 +72,7 @@ typedef struct req_entry {
     /* The callback can be executed only once. Tell the timeout thread whether the callback can be invoked normally. */
     pthread_mutex_t lock;
     urpc_timer_t *timer;
+    util_tw_timer_t tw_timer;              // timeout on the wheel of the sending thread, used instead of timer
     void *ctx;
     urpc_sge_t *args;
     uint32_t args_num;
@@ -77,7 +81,10 @@ typedef struct req_entry {
     uint32_t local_chid;
     uint32_t server_node_idx;
     uint64_t send_qh;
+    uint16_t l_slot;                       // load slot of local queue counting the request, see channel_queue_select
+    uint16_t r_slot;                       // load slot of remote queue counting the request
     uint8_t valid;
+    uint8_t tw_armed;                      // tw_timer is started for the request
     urpc_req_cb_t cb;                      // callback func for request when receiving response
     void *cb_arg;                          // callback arg
 } req_entry_t;
@@ -110,6 +117,26 @@ typedef struct channel_query_info {
     channel_server_info_t   server[0];
 } channel_query_info_t;
 
+typedef struct channel_queue_entry {
+    queue_t *queue;
+    uint32_t slot;                  // index of the load counter of the queue in its selector
+} channel_queue_entry_t;
+
+/* queues of a channel in an array, rebuilt and replaced as a whole when the queue list changes, so that the
+ * datapath selects a queue without any lock. readers access it in util_epoch read section, old one is retired */
+typedef struct channel_queue_snapshot {
+    uint32_t num;
+    channel_queue_entry_t entry[0];
+} channel_queue_snapshot_t;
+
+typedef struct channel_queue_selector {
+    channel_queue_snapshot_t *snapshot;
+    volatile uint32_t cursor;       // round robin cursor, also breaks ties of least load
+    /* requests waiting for response on each slot, only counted under load aware policy. a slot is kept by its
+     * queue while the queue stays in the channel, and taken by later added queue after the queue is removed */
+    volatile uint32_t load[MAX_QUEUE_SIZE];
+} channel_queue_selector_t;
+
 typedef struct urpc_channel_info {
     uint32_t                id;
     uint32_t                req_id;
@@ -121,10 +148,11 @@ typedef struct urpc_channel_info {
     struct queue_nodes_head l_queue_nodes_head;
     /* Details of remote queues related to the channel */
     struct queue_nodes_head r_queue_nodes_head;
-    /* current local queue for round-robin */
-    queue_node_t            *cur_rr_local_queue;
-    /* current remote queue for round-robin */
-    queue_node_t            *cur_rr_remote_queue;
+    /* snapshot of local queues and their load for urpc_func_call */
+    channel_queue_selector_t l_selector;
+    /* snapshot of remote queues and their load for urpc_func_call */
+    channel_queue_selector_t r_selector;
+    urpc_queue_select_policy_t queue_select;
     /* current poll queue */
     queue_node_t            *cur_poll_queue;
     /* req entry table */
@@ -253,8 +281,27 @@ req_entry_t *req_entry_get(urpc_channel_info_t *channel, void *ctx);
 req_entry_t *req_entry_query(uint32_t urpc_chid, uint32_t req_id, bool need_lock);
 void req_entry_put(req_entry_t *req_entry);
 
-queue_t *channel_get_next_local_queue(urpc_channel_info_t *channel);
-queue_t *channel_get_next_remote_queue(urpc_channel_info_t *channel);
+/* rebuild snapshot of local or remote queues after the queue list of the channel changed, queues not ready are
+ * kept in it and skipped at select */
+void channel_queue_snapshot_update(urpc_channel_info_t *channel, bool is_remote);
+// select queue by policy of the channel, slot of the queue is returned to count the request if policy needs it
+queue_t *channel_get_next_local_queue(urpc_channel_info_t *channel, uint32_t *slot);
+queue_t *channel_get_next_remote_queue(urpc_channel_info_t *channel, uint32_t *slot);
+
+static inline void channel_queue_load_add(channel_queue_selector_t *selector, uint32_t slot)
+{
+    if (slot != CHANNEL_QUEUE_SLOT_INVALID) {
+        (void)__sync_fetch_and_add(&selector->load[slot], 1);
+    }
+}
+
+static inline void channel_queue_load_sub(channel_queue_selector_t *selector, uint32_t slot)
+{
+    if (slot != CHANNEL_QUEUE_SLOT_INVALID) {
+        (void)__sync_fetch_and_sub(&selector->load[slot], 1);
+    }
+}
+
 queue_t *channel_get_cur_poll_queue(urpc_channel_info_t *channel);
 queue_t *channel_get_local_queue_by_handle(urpc_channel_info_t *channel, uint64_t urpc_qh);
 queue_t *channel_get_remote_queue_by_handle(urpc_channel_info_t *channel, uint64_t urpc_qh);
@@ -296,6 +343,13 @@ static inline bool is_req_entry_timeout(const req_entry_t *entry)
     return ((entry->valid != URPC_FALSE) && is_urpc_timer_running(entry->timer));
 }
 
+// a fired tw_timer is idle, a pending one has been added again for a new request after this one was put
+static inline bool is_req_entry_tw_timeout(const req_entry_t *entry)
+{
+    return ((entry->valid != URPC_FALSE) && (entry->tw_armed != URPC_FALSE) &&
+        __atomic_load_n(&entry->tw_timer.state, __ATOMIC_ACQUIRE) == UTIL_TW_TIMER_IDLE);
+}
+
 int server_channel_add_mem(urpc_server_channel_info_t *server_channel, xchg_mem_info_t *xchg_mem);
 int server_channel_put_mem_info(uint32_t server_chid, xchg_mem_info_t **mem_info, uint32_t mem_info_num);
 
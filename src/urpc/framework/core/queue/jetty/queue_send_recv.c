@@ -192,15 +192,23 @@ static queue_t *send_recv_create_local_queue(queue_create_option_t *option, uint
         goto FREE_LOCAL;
     }
 
+    if (queue_stats_init(&send_recv_local_q->local_q) != 0) {
+        goto FREE_LOCAL;
+    }
+
     if (send_recv_create_transport_resource(provider, send_recv_local_q, cfg, option->qid) != URPC_SUCCESS) {
         URPC_LIB_LOG_ERR("create transport resource failed\n");
-        goto FREE_LOCAL;
+        goto UNINIT_STATS;
     }
+
     send_recv_local_q_init(send_recv_local_q, provider, send_recv_get_queue_ops(), flag, option->qid);
     queue_list_push(&send_recv_local_q->local_q);
 
     return &send_recv_local_q->local_q.queue;
 
+UNINIT_STATS:
+    queue_stats_uninit(&send_recv_local_q->local_q);
+
 FREE_LOCAL:
     urpc_dbuf_free(send_recv_local_q);
     return NULL;
@@ -301,6 +309,7 @@ static int send_recv_delete_local_queue(queue_t *l_queue, delete_queue_callback_
     }
     queue_slab_uninit(local_q);
     queue_list_pop(&local->local_q);
+    queue_stats_uninit(&local->local_q);
     send_recv_destroy_transport_resource(local);
 
     urpc_dbuf_free(local);
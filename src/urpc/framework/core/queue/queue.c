@@ -13,6 +13,7 @@
 #include "urpc_lib_log.h"
 #include "urpc_framework_errno.h"
 #include "urpc_id_generator.h"
+#include "urpc_thread_closure.h"
 #include "queue.h"
 
 typedef struct provider_ctx {
@@ -178,6 +179,12 @@ _Static_assert((sizeof(g_urpc_queue_error_stats_name) / sizeof(g_urpc_queue_erro
 
 static volatile uint64_t g_urpc_queue_error_stats[ERR_STATS_TYPE_MAX];
 
+_Static_assert(QUEUE_STATS_SLOT_NUM == sizeof(uint64_t) * 8, "queue stats slot bitmap is one uint64_t");
+
+__thread uint32_t g_queue_stats_slot = QUEUE_STATS_SLOT_NUM;
+// slots in use, QUEUE_STATS_SLOT_SHARED is never given to a thread
+static volatile uint64_t g_queue_stats_slot_bitmap = 1ULL << QUEUE_STATS_SLOT_SHARED;
+
 void queue_stats_enable(void)
 {
     g_urpc_queue_stats_enable = true;
@@ -458,19 +465,120 @@ void queue_common_error_stats_get(uint64_t *stats, int stats_len)
     }
 }
 
+static queue_stats_block_t *queue_stats_block_create(bool shared)
+{
+    // one more cache line to align the block inside
+    void *head = urpc_dbuf_calloc(URPC_DBUF_TYPE_QUEUE, 1, sizeof(queue_stats_block_t) + QUEUE_STATS_ALIGN);
+    if (head == NULL) {
+        return NULL;
+    }
+
+    queue_stats_block_t *block =
+        (queue_stats_block_t *)(((uintptr_t)head + QUEUE_STATS_ALIGN) & ~((uintptr_t)QUEUE_STATS_ALIGN - 1));
+    block->head = head;
+    block->shared = shared;
+    return block;
+}
+
+int queue_stats_init(queue_local_t *local_q)
+{
+    local_q->stats_block[QUEUE_STATS_SLOT_SHARED] = queue_stats_block_create(true);
+    if (local_q->stats_block[QUEUE_STATS_SLOT_SHARED] == NULL) {
+        URPC_LIB_LOG_ERR("malloc queue stats failed\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+void queue_stats_uninit(queue_local_t *local_q)
+{
+    for (uint32_t slot = 0; slot < QUEUE_STATS_SLOT_NUM; slot++) {
+        if (local_q->stats_block[slot] == NULL) {
+            continue;
+        }
+        urpc_dbuf_free(local_q->stats_block[slot]->head);
+        local_q->stats_block[slot] = NULL;
+    }
+}
+
+// the slot is taken by the next new thread, counts left in blocks of the slot are kept
+static void queue_stats_slot_free(uint64_t slot)
+{
+    (void)__atomic_and_fetch(&g_queue_stats_slot_bitmap, ~(1ULL << slot), __ATOMIC_RELEASE);
+}
+
+static uint32_t queue_stats_slot_alloc(void)
+{
+    uint64_t used = __atomic_load_n(&g_queue_stats_slot_bitmap, __ATOMIC_RELAXED);
+    uint32_t slot;
+    do {
+        if (~used == 0) {
+            URPC_LIB_LOG_WARN("queue stats slots are used up, thread records into the shared one\n");
+            return QUEUE_STATS_SLOT_SHARED;
+        }
+        slot = (uint32_t)__builtin_ctzll(~used);
+    } while (!__atomic_compare_exchange_n(&g_queue_stats_slot_bitmap, &used, used | (1ULL << slot), true,
+        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    urpc_thread_closure_register(THREAD_CLOSURE_QUEUE_STATS, slot, queue_stats_slot_free);
+    return slot;
+}
+
+queue_stats_block_t *queue_stats_block_alloc(queue_local_t *local_q)
+{
+    if (URPC_UNLIKELY(g_queue_stats_slot == QUEUE_STATS_SLOT_NUM)) {
+        g_queue_stats_slot = queue_stats_slot_alloc();
+    }
+
+    uint32_t slot = g_queue_stats_slot;
+    if (local_q->stats_block[slot] != NULL) {
+        return local_q->stats_block[slot];
+    }
+
+    queue_stats_block_t *block = queue_stats_block_create(false);
+    if (block == NULL) {
+        URPC_LIB_LIMIT_LOG_WARN("malloc queue stats failed, thread records into the shared one\n");
+        return local_q->stats_block[QUEUE_STATS_SLOT_SHARED];
+    }
+    // published to queries of other threads
+    __atomic_store_n(&local_q->stats_block[slot], block, __ATOMIC_RELEASE);
+    return block;
+}
+
 void queue_stats_get(queue_t *queue, uint64_t *stats, int stats_len)
 {
     queue_local_t *local_q = CONTAINER_OF_FIELD(queue, queue_local_t, queue);
-    for (int i = 0; i < (int)STATS_TYPE_MAX && i < stats_len; i++) {
-        stats[i] = (uint64_t)__sync_add_and_fetch(&local_q->stats[i], 0);
+    int len = stats_len < (int)STATS_TYPE_MAX ? stats_len : (int)STATS_TYPE_MAX;
+    for (int i = 0; i < len; i++) {
+        stats[i] = 0;
+    }
+    for (uint32_t slot = 0; slot < QUEUE_STATS_SLOT_NUM; slot++) {
+        queue_stats_block_t *block = __atomic_load_n(&local_q->stats_block[slot], __ATOMIC_ACQUIRE);
+        if (block == NULL) {
+            continue;
+        }
+        for (int i = 0; i < len; i++) {
+            stats[i] += __atomic_load_n(&block->stats[i], __ATOMIC_RELAXED);
+        }
     }
 }
 
 void queue_error_stats_get(queue_t *queue, uint64_t *stats, int stats_len)
 {
     queue_local_t *local_q = CONTAINER_OF_FIELD(queue, queue_local_t, queue);
-    for (int i = 0; i < (int)ERR_STATS_TYPE_MAX && i < stats_len; i++) {
-        stats[i] = (uint64_t)__sync_add_and_fetch(&local_q->error_stats[i], 0);
+    int len = stats_len < (int)ERR_STATS_TYPE_MAX ? stats_len : (int)ERR_STATS_TYPE_MAX;
+    for (int i = 0; i < len; i++) {
+        stats[i] = 0;
+    }
+    for (uint32_t slot = 0; slot < QUEUE_STATS_SLOT_NUM; slot++) {
+        queue_stats_block_t *block = __atomic_load_n(&local_q->stats_block[slot], __ATOMIC_ACQUIRE);
+        if (block == NULL) {
+            continue;
+        }
+        for (int i = 0; i < len; i++) {
+            stats[i] += __atomic_load_n(&block->error_stats[i], __ATOMIC_RELAXED);
+        }
     }
 }
 
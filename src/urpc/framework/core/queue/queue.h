@@ -35,6 +35,10 @@ extern "C" {
 #define QUEUE_STATS_TYPE_DMA_SGE_OFFSET 3
 #define QUEUE_STATS_TYPE_DMA_BYTES_OFFSET 4
 
+#define QUEUE_STATS_SLOT_NUM 64     // threads recording stats, one bit each in slot bitmap
+#define QUEUE_STATS_SLOT_SHARED 0   // shared by threads without a slot of their own
+#define QUEUE_STATS_ALIGN 64
+
 #define QUEUE_ID_INVALID 0
 #define QUEUE_ID_UPPER_LIMIT 0xffff
 #define QUEUE_ID_MAX (QUEUE_ID_UPPER_LIMIT + 1)
@@ -186,14 +190,22 @@ typedef struct queue {
     volatile uint32_t ref_cnt;
 } queue_t;
 
+/* stats of one queue recorded by one thread. each thread records into its own block, aligned to cache line, so
+ * that threads polling and posting the same queue never write the same line. blocks are summed on query */
+typedef struct queue_stats_block {
+    volatile uint64_t stats[STATS_TYPE_MAX];
+    volatile uint64_t error_stats[ERR_STATS_TYPE_MAX];
+    void *head;                     // address allocated, the block is aligned inside it
+    bool shared;                    // block of QUEUE_STATS_SLOT_SHARED, written by several threads
+} __attribute__((aligned(QUEUE_STATS_ALIGN))) queue_stats_block_t;
+
 URPC_SLIST_HEAD(queue_nodes_head, queue_node);
 
 /* only local */
 typedef struct queue_local_t {
     queue_t queue;                  // placed at the beginning of the definition to facilitate conversion of types
     eslab_t slab[QUEUE_CTX_TYPE_MAX];
-    volatile uint64_t stats[STATS_TYPE_MAX];
-    volatile uint64_t error_stats[ERR_STATS_TYPE_MAX];
+    queue_stats_block_t *stats_block[QUEUE_STATS_SLOT_NUM];    // indexed by thread slot, allocated on first record
     rq_ctx_t *rq_ctx;
     cq_ctx_t *tx_cq_ctx; // tx_cq
     cq_ctx_t *cq_ctx; // rx_cq
@@ -747,6 +759,38 @@ typedef struct sges_stats {
 
 void queue_common_error_stats_record(urpc_error_stats_type_t type);
 
+// stats slot of current thread, QUEUE_STATS_SLOT_NUM until the thread records for the first time
+extern __thread uint32_t g_queue_stats_slot;
+
+int queue_stats_init(queue_local_t *local_q);
+void queue_stats_uninit(queue_local_t *local_q);
+// slow path of queue_stats_block_get, never returns NULL
+queue_stats_block_t *queue_stats_block_alloc(queue_local_t *local_q);
+
+static ALWAYS_INLINE queue_stats_block_t *queue_stats_block_get(queue_local_t *local_q)
+{
+    uint32_t slot = g_queue_stats_slot;
+    if (URPC_LIKELY(slot < QUEUE_STATS_SLOT_NUM)) {
+        // only the thread owning the slot installs its block, no barrier is needed to read it back
+        queue_stats_block_t *block = local_q->stats_block[slot];
+        if (URPC_LIKELY(block != NULL)) {
+            return block;
+        }
+    }
+
+    return queue_stats_block_alloc(local_q);
+}
+
+static ALWAYS_INLINE void queue_stats_block_add(queue_stats_block_t *block, volatile uint64_t *counter, uint64_t num)
+{
+    if (URPC_LIKELY(!block->shared)) {
+        *counter += num;
+        return;
+    }
+
+    (void)__sync_add_and_fetch(counter, num);
+}
+
 // only local queue support record/get stats
 static ALWAYS_INLINE void queue_sge_stats_record(
     queue_t *queue, urpc_stats_type_t type, uint32_t sge_num, uint32_t completion_len)
@@ -756,20 +800,11 @@ static ALWAYS_INLINE void queue_sge_stats_record(
     }
 
     queue_local_t *local_q = CONTAINER_OF_FIELD(queue, queue_local_t, queue);
-
-    if (URPC_LIKELY(local_q->cfg.lock_free != 0)) {
-        ++local_q->stats[type];
-        local_q->stats[type + QUEUE_STATS_TYPE_SGE_OFFSET] += sge_num;
-        local_q->stats[type + QUEUE_STATS_TYPE_BYTES_OFFSET] += completion_len;
-        return;
-    }
-
-    (void)__sync_add_and_fetch(&local_q->stats[type], 1);
+    queue_stats_block_t *block = queue_stats_block_get(local_q);
+    queue_stats_block_add(block, &block->stats[type], 1);
     if (URPC_LIKELY(sge_num > 0)) {
-        (void)__sync_add_and_fetch(&local_q->stats[type + QUEUE_STATS_TYPE_SGE_OFFSET],
-            sge_num);
-        (void)__sync_add_and_fetch(&local_q->stats[type + QUEUE_STATS_TYPE_BYTES_OFFSET],
-            completion_len);
+        queue_stats_block_add(block, &block->stats[type + QUEUE_STATS_TYPE_SGE_OFFSET], sge_num);
+        queue_stats_block_add(block, &block->stats[type + QUEUE_STATS_TYPE_BYTES_OFFSET], completion_len);
     }
 }
 
@@ -780,21 +815,13 @@ static ALWAYS_INLINE void queue_dma_sge_stats_record(queue_t *queue, urpc_stats_
     }
 
     queue_local_t *local_q = CONTAINER_OF_FIELD(queue, queue_local_t, queue);
-    if (URPC_LIKELY(local_q->cfg.lock_free != 0)) {
-        local_q->stats[type] += sge_stats->record_cnt;
-        local_q->stats[type + QUEUE_STATS_TYPE_SGE_OFFSET] += sge_stats->normal_cnt;
-        local_q->stats[type + QUEUE_STATS_TYPE_BYTES_OFFSET] += sge_stats->normal_len;
-        local_q->stats[type + QUEUE_STATS_TYPE_DMA_SGE_OFFSET] += sge_stats->dma_cnt;
-        local_q->stats[type + QUEUE_STATS_TYPE_DMA_BYTES_OFFSET] += sge_stats->dma_len;
-        return;
-    }
-
-    (void)__sync_add_and_fetch(&local_q->stats[type], sge_stats->record_cnt);
-    (void)__sync_add_and_fetch(&local_q->stats[type + QUEUE_STATS_TYPE_SGE_OFFSET], sge_stats->normal_cnt);
-    (void)__sync_add_and_fetch(&local_q->stats[type + QUEUE_STATS_TYPE_BYTES_OFFSET], sge_stats->normal_len);
+    queue_stats_block_t *block = queue_stats_block_get(local_q);
+    queue_stats_block_add(block, &block->stats[type], sge_stats->record_cnt);
+    queue_stats_block_add(block, &block->stats[type + QUEUE_STATS_TYPE_SGE_OFFSET], sge_stats->normal_cnt);
+    queue_stats_block_add(block, &block->stats[type + QUEUE_STATS_TYPE_BYTES_OFFSET], sge_stats->normal_len);
     if (URPC_UNLIKELY(sge_stats->dma_cnt > 0)) {
-        (void)__sync_add_and_fetch(&local_q->stats[type + QUEUE_STATS_TYPE_DMA_SGE_OFFSET], sge_stats->dma_cnt);
-        (void)__sync_add_and_fetch(&local_q->stats[type + QUEUE_STATS_TYPE_DMA_BYTES_OFFSET], sge_stats->dma_len);
+        queue_stats_block_add(block, &block->stats[type + QUEUE_STATS_TYPE_DMA_SGE_OFFSET], sge_stats->dma_cnt);
+        queue_stats_block_add(block, &block->stats[type + QUEUE_STATS_TYPE_DMA_BYTES_OFFSET], sge_stats->dma_len);
     }
 }
 
@@ -815,11 +842,8 @@ static ALWAYS_INLINE void queue_error_stats_record(queue_t *queue, urpc_error_st
     }
 
     queue_local_t *local_q = CONTAINER_OF_FIELD(queue, queue_local_t, queue);
-    if (URPC_LIKELY(local_q->cfg.lock_free != 0)) {
-        ++local_q->error_stats[type];
-        return;
-    }
-    (void)__sync_add_and_fetch(&local_q->error_stats[type], 1);
+    queue_stats_block_t *block = queue_stats_block_get(local_q);
+    queue_stats_block_add(block, &block->error_stats[type], 1);
 }
 
 void queue_stats_get(queue_t *queue, uint64_t *stats, int stats_len);
@@ -846,11 +870,8 @@ static ALWAYS_INLINE void queue_stats_record(queue_t *queue, urpc_stats_type_t t
         return;
     }
     queue_local_t *local_q = CONTAINER_OF_FIELD(queue, queue_local_t, queue);
-    if (URPC_LIKELY(local_q->cfg.lock_free != 0)) {
-        ++local_q->stats[type];
-        return;
-    }
-    (void)__sync_add_and_fetch(&local_q->stats[type], 1);
+    queue_stats_block_t *block = queue_stats_block_get(local_q);
+    queue_stats_block_add(block, &block->stats[type], 1);
 }
 
 
@@ -873,12 +894,8 @@ static ALWAYS_INLINE void queue_io_sended_stats_record(uint16_t call_mode, queue
 
     urpc_stats_type_t type = table[mode];
     queue_local_t *local_q = CONTAINER_OF_FIELD(queue, queue_local_t, queue);
-    if (URPC_LIKELY(local_q->cfg.lock_free != 0)) {
-        ++local_q->stats[type];
-        return;
-    }
-
-    (void)__sync_add_and_fetch(&local_q->stats[type], 1);
+    queue_stats_block_t *block = queue_stats_block_get(local_q);
+    queue_stats_block_add(block, &block->stats[type], 1);
 }
 
 static ALWAYS_INLINE void queue_io_req_error_stats_record(uint16_t call_mode, queue_t *queue) {
@@ -901,11 +918,8 @@ static ALWAYS_INLINE void queue_io_req_error_stats_record(uint16_t call_mode, qu
 
     type = table[mode];
     queue_local_t *local_q = CONTAINER_OF_FIELD(queue, queue_local_t, queue);
-    if (URPC_LIKELY(local_q->cfg.lock_free != 0)) {
-        ++local_q->error_stats[type];
-        return;
-    }
-    (void)__sync_add_and_fetch(&local_q->error_stats[type], 1);
+    queue_stats_block_t *block = queue_stats_block_get(local_q);
+    queue_stats_block_add(block, &block->error_stats[type], 1);
 }
 
 void queue_common_error_stats_get(uint64_t *stats, int stats_len);
@@ -20,6 +20,7 @@
 #include "allocator.h"
 
 #define DEFAULT_ALLOCATOR_ALIGNMENT 4096 // Memory alignment method
+#define DEFAULT_ALLOCATOR_MAX_RUN_NUM (DEFAULT_LARGE_SGE_SIZE / DEFAULT_SGE_HEAD_SIZE) // sges in largest head
 
 typedef struct urpc_da_cfg {
     uint64_t addr;
@@ -30,6 +31,8 @@ typedef struct urpc_da_cfg {
     uint32_t total_size_large;
     eslab_t slab;
     eslab_t slab_large;
+    uint16_t *run_len;        // indexed by id of first buffer of a sge, number of buffers merged into the sge
+    uint16_t *run_len_large;
     uint32_t large_sge_size;
 } urpc_da_cfg_t;
 
@@ -81,6 +84,12 @@ int urpc_default_allocator_init(default_allocator_cfg_t *cfg)
         URPC_LIB_LOG_ERR("register default buf failed\n");
         goto FREE_ADDR;
     }
+    g_urpc_da_ctx.cfg.run_len = (uint16_t *)urpc_dbuf_calloc(URPC_DBUF_TYPE_ALLOCATOR, DEFAULT_SGE_NUM,
+        sizeof(uint16_t));
+    if (g_urpc_da_ctx.cfg.run_len == NULL) {
+        URPC_LIB_LOG_ERR("malloc default run length failed\n");
+        goto UNREGISTER;
+    }
     eslab_init(&g_urpc_da_ctx.cfg.slab, buf, DEFAULT_SGE_SIZE, DEFAULT_SGE_NUM);
     URPC_LIB_LOG_DEBUG("default allocator get normal segment num[%u]\n", DEFAULT_SGE_NUM);
 
@@ -100,6 +109,12 @@ int urpc_default_allocator_init(default_allocator_cfg_t *cfg)
             URPC_LIB_LOG_ERR("register default buf failed\n");
             goto FREE_ADDR_LARGE;
         }
+        g_urpc_da_ctx.cfg.run_len_large = (uint16_t *)urpc_dbuf_calloc(URPC_DBUF_TYPE_ALLOCATOR,
+            DEFAULT_LARGE_SGE_NUM, sizeof(uint16_t));
+        if (g_urpc_da_ctx.cfg.run_len_large == NULL) {
+            URPC_LIB_LOG_ERR("malloc default run length failed\n");
+            goto UNREGISTER_LARGE;
+        }
         eslab_init(&g_urpc_da_ctx.cfg.slab_large, buf, g_urpc_da_ctx.cfg.large_sge_size, DEFAULT_LARGE_SGE_NUM);
         URPC_LIB_LOG_DEBUG("default allocator get large segment num[%u]\n", DEFAULT_LARGE_SGE_NUM);
     }
@@ -107,10 +122,14 @@ int urpc_default_allocator_init(default_allocator_cfg_t *cfg)
     (void)pthread_mutex_unlock(&g_urpc_da_ctx.lock);
     return URPC_SUCCESS;
 
+UNREGISTER_LARGE:
+    urpc_mem_seg_unregister(g_urpc_da_ctx.cfg.tsge_large);
 FREE_ADDR_LARGE:
     urpc_dbuf_free((void *)(uintptr_t)g_urpc_da_ctx.cfg.addr_large);
 UNINIT_ESLAB:
     eslab_uninit(&g_urpc_da_ctx.cfg.slab);
+    urpc_dbuf_free(g_urpc_da_ctx.cfg.run_len);
+UNREGISTER:
     urpc_mem_seg_unregister(g_urpc_da_ctx.cfg.tsge);
 FREE_ADDR:
     urpc_dbuf_free((void *)(uintptr_t)g_urpc_da_ctx.cfg.addr);
@@ -129,12 +148,14 @@ void urpc_default_allocator_uninit(void)
         return;
     }
     eslab_uninit(&g_urpc_da_ctx.cfg.slab);
+    urpc_dbuf_free(g_urpc_da_ctx.cfg.run_len);
     urpc_mem_seg_unregister(g_urpc_da_ctx.cfg.tsge);
     void *buf = (void *)(uintptr_t)g_urpc_da_ctx.cfg.addr;
     urpc_dbuf_free(buf);
 
     if (g_urpc_da_ctx.cfg.total_size_large != 0) {
         eslab_uninit(&g_urpc_da_ctx.cfg.slab_large);
+        urpc_dbuf_free(g_urpc_da_ctx.cfg.run_len_large);
         urpc_mem_seg_unregister(g_urpc_da_ctx.cfg.tsge_large);
         buf = (void *)(uintptr_t)g_urpc_da_ctx.cfg.addr_large;
         urpc_dbuf_free(buf);
@@ -166,6 +187,23 @@ static uint32_t urpc_default_allocator_size_check(urpc_allocator_option_t *optio
     return DEFAULT_SGE_SIZE;
 }
 
+static inline uint32_t urpc_default_allocator_max_run_num(void)
+{
+    // the same limit as urpc_default_allocator_head_eslab_judge
+    return g_urpc_da_ctx.cfg.total_size_large == 0 ? DEFAULT_SGE_SIZE / DEFAULT_SGE_HEAD_SIZE :
+                                                     DEFAULT_ALLOCATOR_MAX_RUN_NUM;
+}
+
+// a single buffer goes through the front cache of eslab, otherwise all runs are returned in one critical section
+static void urpc_default_allocator_runs_put(eslab_t *slab, eslab_run_t *run, uint32_t run_num)
+{
+    if (run_num == 1 && run[0].num == 1) {
+        eslab_put_buf(slab, eslab_id_to_addr(slab, run[0].id));
+        return;
+    }
+    eslab_free_runs(slab, run, run_num);
+}
+
 static int urpc_default_allocator_get(urpc_sge_t **sge, uint32_t *num, uint64_t size, urpc_allocator_option_t *option)
 {
     int ret = URPC_FAIL;
@@ -175,53 +213,67 @@ static int urpc_default_allocator_get(urpc_sge_t **sge, uint32_t *num, uint64_t
     }
     eslab_t *slab, *pr_slab;
     uint64_t tsge;
-    uint32_t count, length;
+    uint16_t *run_len;
+    uint64_t count;
+    uint32_t length;
     length = urpc_default_allocator_size_check(option);
     if (length > DEFAULT_SGE_SIZE) {
         slab = &g_urpc_da_ctx.cfg.slab_large;
         tsge = g_urpc_da_ctx.cfg.tsge_large;
+        run_len = g_urpc_da_ctx.cfg.run_len_large;
         count = size % g_urpc_da_ctx.cfg.large_sge_size == 0 ? size / g_urpc_da_ctx.cfg.large_sge_size :
                                                           size / g_urpc_da_ctx.cfg.large_sge_size + 1;
         length = g_urpc_da_ctx.cfg.large_sge_size;
     } else {
         slab = &g_urpc_da_ctx.cfg.slab;
         tsge = g_urpc_da_ctx.cfg.tsge;
+        run_len = g_urpc_da_ctx.cfg.run_len;
         count = size % DEFAULT_SGE_SIZE == 0 ? size / DEFAULT_SGE_SIZE : size / DEFAULT_SGE_SIZE + 1;
         length = DEFAULT_SGE_SIZE;
     }
 
-    if ((pr_slab = urpc_default_allocator_head_eslab_judge(count)) == NULL) {
-        URPC_LIB_LOG_ERR("total_size too large:%lu,count:%u\n", size, count);
+    if (count == 0 || count > slab->total) {
+        URPC_LIB_LOG_ERR("total_size invalid:%lu,count:%lu\n", size, count);
         return ret;
     }
-    urpc_sge_t *pr = (urpc_sge_t *)eslab_get_buf(pr_slab);
+
+    // buffers are taken in one critical section, adjacent buffers are merged into one sge
+    eslab_run_t run[DEFAULT_ALLOCATOR_MAX_RUN_NUM];
+    uint32_t run_num = 1;
+    if (count == 1) {
+        void *buf = eslab_get_buf(slab);
+        if (buf == NULL) {
+            URPC_LIB_LOG_ERR("get buf is NULL\n");
+            return ret;
+        }
+        run[0].id = eslab_addr_to_id(slab, buf);
+        run[0].num = 1;
+    } else {
+        run_num = eslab_alloc_runs(slab, (uint32_t)count, run, urpc_default_allocator_max_run_num());
+        if (run_num == 0) {
+            URPC_LIB_LOG_ERR("get bufs failed, count:%lu, errno:%d\n", count, errno);
+            return ret;
+        }
+    }
+
+    pr_slab = urpc_default_allocator_head_eslab_judge(run_num);
+    urpc_sge_t *pr = pr_slab == NULL ? NULL : (urpc_sge_t *)eslab_get_buf(pr_slab);
     if (pr == NULL) {
         URPC_LIB_LOG_ERR("malloc failed\n");
+        urpc_default_allocator_runs_put(slab, run, run_num);
         return ret;
     }
 
-    void *buf = NULL;
-    uint32_t i = 0;
-    for (; i < count; i++) {
-        buf = eslab_get_buf(slab);
-        if (buf == NULL) {
-            URPC_LIB_LOG_ERR("get buf is NULL\n");
-            goto RESET;
-        }
-        pr[i].length = length;
+    for (uint32_t i = 0; i < run_num; i++) {
+        run_len[run[i].id] = (uint16_t)run[i].num;
+        pr[i].length = length * run[i].num;
         pr[i].flag = 0;
-        pr[i].addr = (uint64_t)(uintptr_t)buf;
+        pr[i].addr = (uint64_t)(uintptr_t)eslab_id_to_addr(slab, run[i].id);
         pr[i].mem_h = tsge;
     }
-    *num = count;
+    *num = run_num;
     *sge = pr;
     return URPC_SUCCESS;
-RESET:
-    for (uint32_t j = 0; j < i; j++) {
-        eslab_put_buf(slab, (void *)(uintptr_t)pr[j].addr);
-    }
-    eslab_put_buf(pr_slab, (void *)pr);
-    return ret;
 }
 
 static int urpc_default_allocator_put(urpc_sge_t *sge, uint32_t num, urpc_allocator_option_t *option)
@@ -231,14 +283,17 @@ static int urpc_default_allocator_put(urpc_sge_t *sge, uint32_t num, urpc_alloca
         return URPC_FAIL;
     }
     eslab_t *slab, *pr_slab;
+    uint16_t *run_len;
     uint64_t addr, total_size;
     uint32_t length = urpc_default_allocator_size_check(option);
     if (length > DEFAULT_SGE_SIZE) {
         slab = &g_urpc_da_ctx.cfg.slab_large;
+        run_len = g_urpc_da_ctx.cfg.run_len_large;
         addr = g_urpc_da_ctx.cfg.addr_large;
         total_size = g_urpc_da_ctx.cfg.total_size_large;
     } else {
         slab = &g_urpc_da_ctx.cfg.slab;
+        run_len = g_urpc_da_ctx.cfg.run_len;
         addr = g_urpc_da_ctx.cfg.addr;
         total_size = g_urpc_da_ctx.cfg.total_size;
     }
@@ -247,15 +302,26 @@ static int urpc_default_allocator_put(urpc_sge_t *sge, uint32_t num, urpc_alloca
         URPC_LIB_LOG_ERR("total_size too large num:%u\n", num);
         return URPC_FAIL;
     }
+
+    // length of sge may be changed by user, number of buffers merged into it is taken from run_len
+    eslab_run_t run[DEFAULT_ALLOCATOR_MAX_RUN_NUM];
+    uint32_t run_num = 0;
     for (uint32_t i = 0; i < num; i++) {
         if (sge[i].addr == 0 || sge[i].addr < addr || (sge[i].addr - addr > total_size)) {
             URPC_LIB_LOG_ERR("sge[%u].addr is invalid\n", i);
             continue;
         }
 
-        eslab_put_buf(slab, (void *)(uintptr_t)sge[i].addr);
+        uint32_t id = eslab_addr_to_id(slab, (void *)(uintptr_t)sge[i].addr);
+        run[run_num].id = id;
+        run[run_num].num = run_len[id] == 0 ? 1 : run_len[id];
+        run_len[id] = 0;
+        run_num++;
         sge[i].length = 0;
     }
+    if (run_num != 0) {
+        urpc_default_allocator_runs_put(slab, run, run_num);
+    }
 
     eslab_put_buf(pr_slab, (void *)sge);
     sge->length = 0;
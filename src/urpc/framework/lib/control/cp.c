@@ -1025,6 +1025,12 @@ bool urpc_channel_connect_option_set(
         out->flag |= URPC_CHANNEL_CONN_FLAG_BIND_LOCAL;
         out->local = in->local;
     }
+
+    // applied to the channel after attach succeeds, see task_engine_callback_queue_select_apply
+    if (server != NULL && (in->flag & URPC_CHANNEL_CONN_FLAG_QUEUE_SELECT) != 0) {
+        out->flag |= URPC_CHANNEL_CONN_FLAG_QUEUE_SELECT;
+        out->queue_select = in->queue_select;
+    }
     // Non-blocking requires checking the timeout duration.
     if (is_nonblock && (in->flag & URPC_CHANNEL_CONN_FLAG_TIMEOUT) != 0) {
         if (in->timeout < -1 || in->timeout == 0) {
@@ -1086,6 +1092,11 @@ int urpc_channel_server_attach(uint32_t urpc_chid, urpc_host_info_t *server, urp
         URPC_LIB_LOG_ERR("invalid channel[%u] type\n", urpc_chid);
         return -URPC_ERR_EINVAL;
     }
+    if (option != NULL && (option->flag & URPC_CHANNEL_CONN_FLAG_QUEUE_SELECT) != 0 &&
+        (uint32_t)option->queue_select >= URPC_QUEUE_SELECT_MAX) {
+        URPC_LIB_LOG_ERR("queue select policy %d is invalid\n", option->queue_select);
+        return -URPC_ERR_EINVAL;
+    }
 
     handshaker_callback_ctx_t *conn_ctx = task_engine_callback_construct(server, option);
     if (conn_ctx == NULL) {
@@ -1123,6 +1134,9 @@ int urpc_channel_server_attach(uint32_t urpc_chid, urpc_host_info_t *server, urp
     // in blocking mode, the task resource is released after the task is completed
     sem_wait(&(conn_ctx->sem));
     ret = conn_ctx->result;
+    if (ret == URPC_SUCCESS) {
+        task_engine_callback_queue_select_apply(conn_ctx, urpc_chid);
+    }
     task_engine_callback_destruct(conn_ctx);
     return ret;
 }
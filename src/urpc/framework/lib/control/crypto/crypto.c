@@ -16,10 +16,37 @@
 #include "urpc_framework_api.h"
 #include "urpc_framework_errno.h"
 #include "urpc_lib_log.h"
+#include "urpc_dbuf_stat.h"
+#include "urpc_thread_closure.h"
 #include "protocol.h"
 
 #include "crypto.h"
 
+#define CRYPTO_CTX_CACHE_SIZE       16      // channels cached by one thread, power of 2
+#define CRYPTO_IV_COUNTER_BATCH     256     // iv counters reserved by one thread at once
+
+/* each thread keeps keyed cipher ctx of recent channels, so a message costs an iv re-init only, instead of ctx
+ * alloc and key setup. iv counters are reserved from the channel in batch, a counter is never used twice, the ones
+ * left in a batch are skipped when the entry is taken by another channel.
+ * key schedule stays in the ctx until the entry is taken by another channel, any cipher is uninited, or the thread
+ * exits. an uninit bumps g_crypto_uninit_gen, and every thread wipes its whole cache on next use, since the
+ * uninited cipher may already be freed and can not be matched against the entries */
+typedef struct crypto_ctx_cache_entry {
+    const urpc_cipher_t *cipher_opt;
+    uint64_t key_gen;
+    EVP_CIPHER_CTX *encrypt_ctx;
+    EVP_CIPHER_CTX *decrypt_ctx;
+    bool encrypt_keyed;
+    bool decrypt_keyed;
+    unsigned long long counter_next;        // next iv counter reserved by this thread
+    unsigned long long counter_end;
+} crypto_ctx_cache_entry_t;
+
+static __thread crypto_ctx_cache_entry_t *g_crypto_ctx_cache;
+static __thread uint64_t g_crypto_ctx_cache_uninit_gen;    // g_crypto_uninit_gen the cache was last wiped at
+static uint64_t g_crypto_key_gen;
+static uint64_t g_crypto_uninit_gen;
+
 static char g_urpc_cipher_list[URPC_MAX_CIPHER_LIST_LENGTH] = {0};
 static char g_urpc_cipher_suites[URPC_MAX_CIPHER_LIST_LENGTH] = {0};
 
@@ -411,6 +438,7 @@ int crypto_cipher_init(urpc_cipher_t *cipher_opt, crypto_key_t *crypto_key)
     }
     memcpy(&cipher_opt->crypto_key, crypto_key, sizeof(crypto_key_t));
     atomic_init(&cipher_opt->counter, 0);
+    cipher_opt->key_gen = __atomic_add_fetch(&g_crypto_key_gen, 1, __ATOMIC_RELAXED);
     URPC_LIB_LOG_DEBUG("cipher initialized successfully\n");
 
     return URPC_SUCCESS;
@@ -425,23 +453,161 @@ void crypto_cipher_uninit(urpc_cipher_t *cipher_opt)
     memset(&cipher_opt->crypto_key, 0, sizeof(crypto_key_t));
     cipher_opt->chid = URPC_INVALID_ID_U32;
     atomic_init(&cipher_opt->counter, 0);
+    cipher_opt->key_gen = 0;
+    // key schedules cached by threads are wiped on their next use
+    (void)__atomic_add_fetch(&g_crypto_uninit_gen, 1, __ATOMIC_RELEASE);
     URPC_LIB_LOG_DEBUG("cipher uninitialized successfully\n");
 }
 
+static void crypto_ctx_cache_free(uint64_t id)
+{
+    crypto_ctx_cache_entry_t *cache = (crypto_ctx_cache_entry_t *)(uintptr_t)id;
+    for (uint32_t i = 0; i < CRYPTO_CTX_CACHE_SIZE; i++) {
+        EVP_CIPHER_CTX_free(cache[i].encrypt_ctx);
+        EVP_CIPHER_CTX_free(cache[i].decrypt_ctx);
+    }
+    urpc_dbuf_free(cache);
+    g_crypto_ctx_cache = NULL;
+}
+
+static void crypto_ctx_cache_wipe(crypto_ctx_cache_entry_t *cache)
+{
+    for (uint32_t i = 0; i < CRYPTO_CTX_CACHE_SIZE; i++) {
+        // reset cleanses the key schedule and keeps the ctx for reuse
+        if (cache[i].encrypt_ctx != NULL) {
+            (void)EVP_CIPHER_CTX_reset(cache[i].encrypt_ctx);
+        }
+        if (cache[i].decrypt_ctx != NULL) {
+            (void)EVP_CIPHER_CTX_reset(cache[i].decrypt_ctx);
+        }
+        cache[i].cipher_opt = NULL;
+        cache[i].key_gen = 0;
+        cache[i].encrypt_keyed = false;
+        cache[i].decrypt_keyed = false;
+        cache[i].counter_next = 0;
+        cache[i].counter_end = 0;
+    }
+}
+
+static crypto_ctx_cache_entry_t *crypto_ctx_cache_get(const urpc_cipher_t *cipher_opt)
+{
+    crypto_ctx_cache_entry_t *cache = g_crypto_ctx_cache;
+    if (URPC_UNLIKELY(cache == NULL)) {
+        cache = (crypto_ctx_cache_entry_t *)urpc_dbuf_calloc(URPC_DBUF_TYPE_ENCRYPT, CRYPTO_CTX_CACHE_SIZE,
+            sizeof(crypto_ctx_cache_entry_t));
+        if (cache == NULL) {
+            URPC_LIB_LIMIT_LOG_ERR("malloc cipher ctx cache failed\n");
+            return NULL;
+        }
+        g_crypto_ctx_cache = cache;
+        g_crypto_ctx_cache_uninit_gen = __atomic_load_n(&g_crypto_uninit_gen, __ATOMIC_ACQUIRE);
+        urpc_thread_closure_register(THREAD_CLOSURE_CRYPTO, (uint64_t)(uintptr_t)cache, crypto_ctx_cache_free);
+    }
+
+    uint64_t uninit_gen = __atomic_load_n(&g_crypto_uninit_gen, __ATOMIC_ACQUIRE);
+    if (URPC_UNLIKELY(g_crypto_ctx_cache_uninit_gen != uninit_gen)) {
+        crypto_ctx_cache_wipe(cache);
+        g_crypto_ctx_cache_uninit_gen = uninit_gen;
+    }
+
+    // key_gen is sequential, channels in use spread over entries
+    crypto_ctx_cache_entry_t *entry = &cache[cipher_opt->key_gen & (CRYPTO_CTX_CACHE_SIZE - 1)];
+    if (entry->cipher_opt != cipher_opt || entry->key_gen != cipher_opt->key_gen) {
+        entry->cipher_opt = cipher_opt;
+        entry->key_gen = cipher_opt->key_gen;
+        entry->encrypt_keyed = false;
+        entry->decrypt_keyed = false;
+        entry->counter_next = 0;
+        entry->counter_end = 0;
+    }
+    return entry;
+}
+
+static void crypto_iv_fill(crypto_ctx_cache_entry_t *entry, urpc_cipher_t *cipher_opt, unsigned char *iv)
+{
+    if (entry->counter_next == entry->counter_end) {
+        entry->counter_next = atomic_fetch_add(&cipher_opt->counter, CRYPTO_IV_COUNTER_BATCH);
+        entry->counter_end = entry->counter_next + CRYPTO_IV_COUNTER_BATCH;
+    }
+
+    uint32_t *chid = (uint32_t *)iv;
+    *chid = cipher_opt->chid;
+    unsigned long long *counter = (unsigned long long *)(iv + sizeof(cipher_opt->chid));
+    *counter = entry->counter_next++;
+}
+
+EVP_CIPHER_CTX *crypto_encrypt_ctx_get(urpc_cipher_t *cipher_opt, unsigned char *iv)
+{
+    crypto_ctx_cache_entry_t *entry = crypto_ctx_cache_get(cipher_opt);
+    if (URPC_UNLIKELY(entry == NULL)) {
+        return NULL;
+    }
+
+    if (URPC_UNLIKELY(!entry->encrypt_keyed)) {
+        if (entry->encrypt_ctx == NULL && (entry->encrypt_ctx = EVP_CIPHER_CTX_new()) == NULL) {
+            URPC_LIB_LIMIT_LOG_ERR("cannot create EVP_CIPHER_CTX\n");
+            return NULL;
+        }
+        if (EVP_EncryptInit_ex(entry->encrypt_ctx, cipher_opt->cipher, NULL, cipher_opt->crypto_key.key, NULL) == 0) {
+            URPC_LIB_LIMIT_LOG_ERR("cipher encrypt key init failed\n");
+            return NULL;
+        }
+        entry->encrypt_keyed = true;
+    }
+
+    crypto_iv_fill(entry, cipher_opt, iv);
+    if (URPC_UNLIKELY(EVP_EncryptInit_ex(entry->encrypt_ctx, NULL, NULL, NULL, iv) == 0)) {
+        URPC_LIB_LIMIT_LOG_ERR("cipher encrypt iv init failed\n");
+        entry->encrypt_keyed = false;
+        return NULL;
+    }
+    return entry->encrypt_ctx;
+}
+
+EVP_CIPHER_CTX *crypto_decrypt_ctx_get(urpc_cipher_t *cipher_opt, const unsigned char *iv)
+{
+    crypto_ctx_cache_entry_t *entry = crypto_ctx_cache_get(cipher_opt);
+    if (URPC_UNLIKELY(entry == NULL)) {
+        return NULL;
+    }
+
+    if (URPC_UNLIKELY(!entry->decrypt_keyed)) {
+        if (entry->decrypt_ctx == NULL && (entry->decrypt_ctx = EVP_CIPHER_CTX_new()) == NULL) {
+            URPC_LIB_LIMIT_LOG_ERR("cannot create EVP_CIPHER_CTX\n");
+            return NULL;
+        }
+        if (EVP_DecryptInit_ex(entry->decrypt_ctx, cipher_opt->cipher, NULL, cipher_opt->crypto_key.key, NULL) == 0) {
+            URPC_LIB_LIMIT_LOG_ERR("cipher decrypt key init failed\n");
+            return NULL;
+        }
+        entry->decrypt_keyed = true;
+    }
+
+    if (URPC_UNLIKELY(EVP_DecryptInit_ex(entry->decrypt_ctx, NULL, NULL, NULL, iv) == 0)) {
+        URPC_LIB_LIMIT_LOG_ERR("cipher decrypt iv init failed\n");
+        entry->decrypt_keyed = false;
+        return NULL;
+    }
+    return entry->decrypt_ctx;
+}
+
 EVP_CIPHER_CTX *crypto_encrypt_ctx_init(urpc_cipher_t *cipher_opt,
     unsigned char *iv, size_t iv_len __attribute__((unused)))
 {
+    EVP_CIPHER_CTX *cached = crypto_encrypt_ctx_get(cipher_opt, iv);
+    if (cached == NULL) {
+        URPC_LIB_LOG_ERR("Cipher Encrypt Init failed\n");
+        return NULL;
+    }
+
+    // copy keyed ctx instead of key setup
     EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
     if (ctx == NULL) {
         URPC_LIB_LOG_ERR("cannot create EVP_CIPHER_CTX\n");
         return NULL;
     }
-    uint32_t *chid = (uint32_t *)iv;
-    *chid = cipher_opt->chid;
-    unsigned long long *counter = (unsigned long long *)(iv + sizeof(cipher_opt->chid));
-    *counter = atomic_fetch_add(&cipher_opt->counter, 1);
-    if (EVP_EncryptInit_ex(ctx, cipher_opt->cipher, NULL, cipher_opt->crypto_key.key, iv) == 0) {
-        URPC_LIB_LOG_ERR("Cipher Encrypt Init failed\n");
+    if (EVP_CIPHER_CTX_copy(ctx, cached) != 1) {
+        URPC_LIB_LOG_ERR("Cipher Encrypt ctx copy failed\n");
         EVP_CIPHER_CTX_free(ctx);
         return NULL;
     }
@@ -496,21 +662,12 @@ int crypto_encrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uin
         return URPC_FAIL;
     }
 
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (URPC_UNLIKELY(ctx == NULL)) {
-        URPC_LIB_LIMIT_LOG_ERR("cannot create EVP_CIPHER_CTX\n");
-        return URPC_FAIL;
-    }
-
     // generate iv & init encrypt ctx
     unsigned char iv[URPC_AES_IV_LEN];
-    uint32_t *chid = (uint32_t *)iv;
-    *chid = cipher_opt->chid;
-    unsigned long long *counter = (unsigned long long *)(iv + sizeof(cipher_opt->chid));
-    *counter = atomic_fetch_add(&cipher_opt->counter, 1);
-    if (EVP_EncryptInit_ex(ctx, cipher_opt->cipher, NULL, cipher_opt->crypto_key.key, iv) == 0) {
+    EVP_CIPHER_CTX *ctx = crypto_encrypt_ctx_get(cipher_opt, iv);
+    if (URPC_UNLIKELY(ctx == NULL)) {
         URPC_LIB_LIMIT_LOG_ERR("cipher encrypt init failed\n");
-        goto ERR_EXIT;
+        return URPC_FAIL;
     }
 
     // base header: integrity
@@ -519,7 +676,7 @@ int crypto_encrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uin
     if (EVP_EncryptUpdate(ctx, NULL, &encrypt_out, (unsigned char *)base,
                           URPC_KEEPALIVE_HDR_SIZE - URPC_AES_CHECK_LEN) != 1) {
         URPC_LIB_LIMIT_LOG_ERR("cipher encrypt add keepalive header for integrity check failed\n");
-        goto ERR_EXIT;
+        return URPC_FAIL;
     }
 
     // if has user input msg
@@ -528,19 +685,19 @@ int crypto_encrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uin
         EVP_EncryptUpdate(ctx, need_encrypt_ext, &encrypt_out, need_encrypt_ext,
                           sge[0].length - URPC_KEEPALIVE_HDR_SIZE) != 1) {
         URPC_LIB_LIMIT_LOG_ERR("cipher encrypt add keepalive message for encryption failed\n");
-        goto ERR_EXIT;
+        return URPC_FAIL;
     }
 
     if (EVP_EncryptFinal_ex(ctx, NULL, &encrypt_out) != 1) {
         URPC_LIB_LIMIT_LOG_ERR("Cipher Encrypt Final failed\n");
-        goto ERR_EXIT;
+        return URPC_FAIL;
     }
 
     // generate tag
     unsigned char tag[URPC_AES_TAG_LEN];
     if ((EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, URPC_AES_TAG_LEN, tag)) != 1) {
         URPC_LIB_LIMIT_LOG_ERR("cipher encrypt generate tag data failed\n");
-        goto ERR_EXIT;
+        return URPC_FAIL;
     }
 
     urpc_security_exthdr_t *sec_hdr = (urpc_security_exthdr_t *)(uintptr_t)(need_encrypt_ext - URPC_AES_CHECK_LEN);
@@ -548,12 +705,7 @@ int crypto_encrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uin
     memcpy(sec_hdr->tag, tag, URPC_AES_TAG_LEN);
     URPC_LIB_LIMIT_LOG_DEBUG("cipher encrypt keepalive successfully\n");
 
-    EVP_CIPHER_CTX_free(ctx);
     return URPC_SUCCESS;
-
-ERR_EXIT:
-    EVP_CIPHER_CTX_free(ctx);
-    return URPC_FAIL;
 }
 
 int crypto_decrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uint32_t sge_num)
@@ -563,12 +715,7 @@ int crypto_decrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uin
         return URPC_FAIL;
     }
 
-    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
-    if (ctx == NULL) {
-        URPC_LIB_LIMIT_LOG_ERR("cannot create EVP_CIPHER_CTX_new\n");
-        return URPC_FAIL;
-    }
-
+    EVP_CIPHER_CTX *ctx = NULL;
     unsigned char iv[URPC_AES_IV_LEN];
     unsigned char tag[URPC_AES_TAG_LEN];
     urpc_req_head_t *base = (urpc_req_head_t *)(uintptr_t)sge[0].addr;
@@ -579,9 +726,10 @@ int crypto_decrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uin
     memcpy(tag, sec_hdr->tag, URPC_AES_TAG_LEN);
 
     if (cipher_opt != NULL) {
-        if (EVP_DecryptInit_ex(ctx, cipher_opt->cipher, NULL, cipher_opt->crypto_key.key, iv) == 0) {
+        ctx = crypto_decrypt_ctx_get(cipher_opt, iv);
+        if (ctx == NULL) {
             URPC_LIB_LIMIT_LOG_ERR("cipher decrypt init failed\n");
-            goto ERR_EXIT;
+            return URPC_FAIL;
         }
     } else {
         urpc_keepalive_head_t *keepalive_hdr =
@@ -590,19 +738,19 @@ int crypto_decrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uin
         urpc_server_channel_info_t *channel = server_channel_get_with_rw_lock(server_chid, false);
         if (channel == NULL) {
             URPC_LIB_LIMIT_LOG_ERR("get server channel failed\n");
-            goto ERR_EXIT;
+            return URPC_FAIL;
         }
         if (channel->cipher_opt == NULL) {
             (void)pthread_rwlock_unlock(&channel->rw_lock);
             URPC_LIB_LIMIT_LOG_ERR("server channel cipher_opt is null\n");
-            goto ERR_EXIT;
+            return URPC_FAIL;
         }
-        if (EVP_DecryptInit_ex(ctx, channel->cipher_opt->cipher, NULL, channel->cipher_opt->crypto_key.key, iv) == 0) {
-            (void)pthread_rwlock_unlock(&channel->rw_lock);
+        ctx = crypto_decrypt_ctx_get(channel->cipher_opt, iv);
+        (void)pthread_rwlock_unlock(&channel->rw_lock);
+        if (ctx == NULL) {
             URPC_LIB_LIMIT_LOG_ERR("cipher decrypt init failed\n");
-            goto ERR_EXIT;
+            return URPC_FAIL;
         }
-        (void)pthread_rwlock_unlock(&channel->rw_lock);
     }
 
     // base header: integrity
@@ -610,7 +758,7 @@ int crypto_decrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uin
     if (EVP_DecryptUpdate(ctx, NULL, &decrypt_out, (unsigned char *)base,
                           URPC_KEEPALIVE_HDR_SIZE - URPC_AES_CHECK_LEN) != 1) {
         URPC_LIB_LOG_ERR("decrypt basic keepalive header failed\n");
-        goto ERR_EXIT;
+        return URPC_FAIL;
     }
 
     // if has user input msg
@@ -618,27 +766,22 @@ int crypto_decrypt_keepalive_req(urpc_cipher_t *cipher_opt, urpc_sge_t *sge, uin
         EVP_DecryptUpdate(ctx, need_encrypt_ext, &decrypt_out, need_encrypt_ext,
                           sge[0].length - URPC_KEEPALIVE_HDR_SIZE) != 1) {
         URPC_LIB_LOG_ERR("decrypt keepalive message failed\n");
-        goto ERR_EXIT;
+        return URPC_FAIL;
     }
 
     // valid tag
     if (EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, URPC_AES_TAG_LEN, tag) != 1) {
         URPC_LIB_LOG_ERR("cipher decrypt check tag data failed\n");
-        goto ERR_EXIT;
+        return URPC_FAIL;
     }
 
     if (EVP_DecryptFinal_ex(ctx, NULL, &decrypt_out) != 1) {
         URPC_LIB_LOG_ERR("cipher EVP_DecryptFinal_ex failed\n");
-        goto ERR_EXIT;
+        return URPC_FAIL;
     }
 
     URPC_LIB_LIMIT_LOG_DEBUG("cipher decrypt keepalive successfully\n");
-    EVP_CIPHER_CTX_free(ctx);
     return URPC_SUCCESS;
-
-ERR_EXIT:
-    EVP_CIPHER_CTX_free(ctx);
-    return URPC_FAIL;
 }
 
 int crypto_server_cipher_ctx_init(EVP_CIPHER_CTX *ctx, uint32_t server_channel, unsigned char *iv, size_t iv_len)
@@ -654,7 +797,9 @@ int crypto_server_cipher_ctx_init(EVP_CIPHER_CTX *ctx, uint32_t server_channel,
         URPC_LIB_LOG_ERR("server channel cipher_opt is null\n");
         return URPC_FAIL;
     }
-    if (EVP_DecryptInit_ex(ctx, channel->cipher_opt->cipher, NULL, channel->cipher_opt->crypto_key.key, iv) == 0) {
+    // copy keyed ctx instead of key setup
+    EVP_CIPHER_CTX *cached = crypto_decrypt_ctx_get(channel->cipher_opt, iv);
+    if (cached == NULL || EVP_CIPHER_CTX_copy(ctx, cached) != 1) {
         (void)pthread_rwlock_unlock(&channel->rw_lock);
         URPC_LIB_LOG_ERR("cipher decrypt init failed\n");
         return URPC_FAIL;
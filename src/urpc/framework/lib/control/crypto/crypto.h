@@ -39,6 +39,7 @@ typedef struct urpc_cipher {
     crypto_key_t crypto_key;                        // key for encrypt/decrypt, security random number
     uint32_t chid;                                  // local channel id, used as the fixed field for iv
     atomic_ullong counter;                          // counter for iv, used as the variable field for iv
+    uint64_t key_gen;                               // unique for each key set, identify cipher in thread cache
 } urpc_cipher_t;
 
 SSL *crypto_ssl_init(int sockfd, bool is_server);
@@ -79,8 +80,15 @@ int crypto_cipher_init(urpc_cipher_t *cipher_opt, crypto_key_t *crypto_key);
 
 void crypto_cipher_uninit(urpc_cipher_t *cipher_opt);
 
+// return a new encrypt ctx with next iv filled in iv, it's owned by caller and freed by EVP_CIPHER_CTX_free
 EVP_CIPHER_CTX *crypto_encrypt_ctx_init(urpc_cipher_t *cipher_opt, unsigned char *iv, size_t iv_len);
 
+/* return encrypt/decrypt ctx cached by current thread for cipher_opt, keyed already and only re-initialized with
+ * iv. it's owned by the thread, must not be freed, and is valid until next ctx get of the thread.
+ * encrypt fills next iv in iv, decrypt takes iv of the message */
+EVP_CIPHER_CTX *crypto_encrypt_ctx_get(urpc_cipher_t *cipher_opt, unsigned char *iv);
+EVP_CIPHER_CTX *crypto_decrypt_ctx_get(urpc_cipher_t *cipher_opt, const unsigned char *iv);
+
 int crypto_encrypt_user_data(
     EVP_CIPHER_CTX *ctx, urpc_sge_t *sge, uint32_t sge_num, uint32_t hdr_index, uint32_t first_sge_offset);
 
@@ -14,12 +14,24 @@
 #include "unix_server.h"
 #include "urpc_thread_closure.h"
 #include "urpc_dbuf_stat.h"
+#include "util_hist.h"
 #include "perf.h"
 
 #define URPC_PERF_CMD_NUM               (sizeof(g_urpc_perf_cmd) / sizeof(urpc_ipc_cmd_t))
-#define URPC_PERF_MAX_THRESH_NS         (100000u)
 #define URPC_PERF_REC_MAX_NUM           (256u)
 
+typedef struct urpc_perf_record {
+    struct {
+        double mean;
+        double std_m2;
+        uint64_t min;
+        uint64_t max;
+        uint64_t cnt;
+        util_hist_t hist;
+    } type_record[PERF_RECORD_POINT_MAX];
+    bool is_used;
+} urpc_perf_record_t;
+
 static __thread uint32_t g_perf_record_index = -1;
 static urpc_perf_recorder_t g_urpc_perf_recorder = NULL;
 static __thread pthread_once_t g_dp_thread_run_once = PTHREAD_ONCE_INIT;
@@ -31,8 +43,10 @@ void urpc_dp_thread_run_once(void)
 }
 
 struct urpc_perf_record_ctx {
-    urpc_perf_record_t perf_record_table[URPC_PERF_REC_MAX_NUM];
-    uint64_t perf_quantile_thresh[URPC_PERF_QUANTILE_MAX_NUM];
+    // allocated when a data plane thread comes, and kept for reuse after the thread exits
+    urpc_perf_record_t *perf_record_table[URPC_PERF_REC_MAX_NUM];
+    // records of exited data plane threads are merged here, and reported in the result of all threads
+    urpc_perf_record_t retired_record;
     pthread_mutex_t lock;
     bool io_record_started;
 } g_urpc_perf_record_ctx = {
@@ -40,24 +54,62 @@ struct urpc_perf_record_ctx {
     .io_record_started = 0,
 };
 
-static void urpc_clear_perf_record_item(uint32_t record_idx)
+static void urpc_perf_record_clear(urpc_perf_record_t *record)
 {
-    urpc_perf_record_t *cur_record = &g_urpc_perf_record_ctx.perf_record_table[record_idx];
     for (int type = 0; type < PERF_RECORD_POINT_MAX; ++type) {
-        cur_record->type_record[type].mean = 0;
-        cur_record->type_record[type].std_m2 = 0;
-        cur_record->type_record[type].min = UINT64_MAX;
-        cur_record->type_record[type].max = 0;
-        cur_record->type_record[type].cnt = 0;
-        memset(cur_record->type_record[type].bucket, 0, sizeof(cur_record->type_record[type].bucket));
+        record->type_record[type].mean = 0;
+        record->type_record[type].std_m2 = 0;
+        record->type_record[type].min = UINT64_MAX;
+        record->type_record[type].max = 0;
+        record->type_record[type].cnt = 0;
+        util_hist_clear(&record->type_record[type].hist);
+    }
+}
+
+static void urpc_clear_perf_record_item(uint32_t record_idx)
+{
+    urpc_perf_record_t *cur_record = g_urpc_perf_record_ctx.perf_record_table[record_idx];
+    if (cur_record == NULL) {
+        return;
+    }
+    urpc_perf_record_clear(cur_record);
+}
+
+// merge mean and m2 of welford algorithm from two sample sets
+static void urpc_perf_merge_welford_m2(double *mean, double *m2, uint64_t cnt, double src_mean, double src_m2,
+    uint64_t src_cnt)
+{
+    double total = (double)(cnt + src_cnt);
+    double delta = src_mean - *mean;
+    *mean += delta * (double)src_cnt / total;
+    *m2 += src_m2 + delta * delta * (double)cnt * (double)src_cnt / total;
+}
+
+static void urpc_perf_record_merge(urpc_perf_record_t *dst, const urpc_perf_record_t *src, uint32_t point)
+{
+    uint64_t src_cnt = src->type_record[point].cnt;
+    if (src_cnt == 0) {
+        return;
     }
+    urpc_perf_merge_welford_m2(&dst->type_record[point].mean, &dst->type_record[point].std_m2,
+        dst->type_record[point].cnt, src->type_record[point].mean, src->type_record[point].std_m2, src_cnt);
+    (dst->type_record[point].cnt == 0 || src->type_record[point].min < dst->type_record[point].min) ?
+        dst->type_record[point].min = src->type_record[point].min : 0;
+    (dst->type_record[point].cnt == 0 || src->type_record[point].max > dst->type_record[point].max) ?
+        dst->type_record[point].max = src->type_record[point].max : 0;
+    dst->type_record[point].cnt += src_cnt;
+    util_hist_merge(&dst->type_record[point].hist, &src->type_record[point].hist);
 }
 
 static inline void urpc_perf_record_closure(uint64_t idx)
 {
     (void)pthread_mutex_lock(&g_urpc_perf_record_ctx.lock);
+    for (uint32_t point = 0; point < PERF_RECORD_POINT_MAX; ++point) {
+        urpc_perf_record_merge(&g_urpc_perf_record_ctx.retired_record, g_urpc_perf_record_ctx.perf_record_table[idx],
+            point);
+    }
     urpc_clear_perf_record_item(idx);
-    g_urpc_perf_record_ctx.perf_record_table[idx].is_used = false;
+    g_urpc_perf_record_ctx.perf_record_table[idx]->is_used = false;
     (void)pthread_mutex_unlock(&g_urpc_perf_record_ctx.lock);
 }
 
@@ -67,7 +119,8 @@ void urpc_perf_record_alloc(void)
 
     (void)pthread_mutex_lock(&g_urpc_perf_record_ctx.lock);
     for (idx = 0; idx < URPC_PERF_REC_MAX_NUM; ++idx) {
-        if (!g_urpc_perf_record_ctx.perf_record_table[idx].is_used) {
+        if (g_urpc_perf_record_ctx.perf_record_table[idx] == NULL ||
+            !g_urpc_perf_record_ctx.perf_record_table[idx]->is_used) {
             break;
         }
     }
@@ -77,32 +130,23 @@ void urpc_perf_record_alloc(void)
         return;
     }
 
+    if (g_urpc_perf_record_ctx.perf_record_table[idx] == NULL) {
+        g_urpc_perf_record_ctx.perf_record_table[idx] =
+            (urpc_perf_record_t *)urpc_dbuf_malloc(URPC_DBUF_TYPE_DFX, sizeof(urpc_perf_record_t));
+        if (g_urpc_perf_record_ctx.perf_record_table[idx] == NULL) {
+            (void)pthread_mutex_unlock(&g_urpc_perf_record_ctx.lock);
+            URPC_LIB_LOG_WARN("malloc perf_rec failed\n");
+            return;
+        }
+    }
     urpc_clear_perf_record_item(idx);
-    g_urpc_perf_record_ctx.perf_record_table[idx].is_used = true;
+    g_urpc_perf_record_ctx.perf_record_table[idx]->is_used = true;
     (void)pthread_mutex_unlock(&g_urpc_perf_record_ctx.lock);
 
     g_perf_record_index = idx;
     urpc_thread_closure_register(THREAD_CLOSURE_PERF, idx, urpc_perf_record_closure);
 }
 
-static inline uint32_t find_perf_record_bucket(uint64_t delta)
-{
-    if (g_urpc_perf_record_ctx.perf_quantile_thresh[0] == 0) {
-        // quantile thresh is not set, don't fill the bucket
-        return URPC_INVALID_ID_U32;
-    }
-    uint32_t idx;
-    for (idx = 0; idx < URPC_PERF_QUANTILE_MAX_NUM; ++idx) {
-        if (delta <= g_urpc_perf_record_ctx.perf_quantile_thresh[idx]) {
-            break;
-        }
-    }
-
-    // return URPC_PERF_QUANTILE_MAX_NUM for samples whose time cost > maximum quantile_thresh,
-    // since bucket[URPC_PERF_QUANTILE_MAX_NUM] stores the number of samples that exceed the max quantile_thresh
-    return idx;
-}
-
 static uint64_t urpc_perf_get_start_timestamp(void)
 {
     if (URPC_LIKELY(!(g_urpc_perf_record_ctx.io_record_started && g_perf_record_index < URPC_PERF_REC_MAX_NUM))) {
@@ -130,20 +174,17 @@ void urpc_perf_record_write(urpc_perf_record_point_t point, uint64_t start)
         return;
     }
     uint64_t delta = urpc_get_cpu_cycles() - start;
-    urpc_perf_record_t *cur_rec = &g_urpc_perf_record_ctx.perf_record_table[g_perf_record_index];
+    urpc_perf_record_t *cur_rec = g_urpc_perf_record_ctx.perf_record_table[g_perf_record_index];
     calculate_welford_m2(
         delta, &cur_rec->type_record[point].mean, &cur_rec->type_record[point].std_m2, cur_rec->type_record[point].cnt);
     (delta < cur_rec->type_record[point].min) ? cur_rec->type_record[point].min = delta : 0;
     (delta > cur_rec->type_record[point].max) ? cur_rec->type_record[point].max = delta : 0;
-    uint32_t bucket_idx = find_perf_record_bucket(delta);
-    if (bucket_idx != URPC_INVALID_ID_U32) {
-        ++cur_rec->type_record[point].bucket[bucket_idx];
-    }
+    util_hist_record(&cur_rec->type_record[point].hist, delta);
     ++cur_rec->type_record[point].cnt;
 }
 
-static void perf_start_cmd_process(
-    urpc_ipc_ctl_head_t *req_ctl, char *request, urpc_ipc_ctl_head_t *rsp_ctl, char **reply)
+static void perf_start_cmd_process(urpc_ipc_ctl_head_t *req_ctl __attribute__((unused)),
+    char *request __attribute__((unused)), urpc_ipc_ctl_head_t *rsp_ctl, char **reply __attribute__((unused)))
 {
     // IO perf record has been started, user must stop it first before restart
     if (g_urpc_perf_record_ctx.io_record_started) {
@@ -152,43 +193,102 @@ static void perf_start_cmd_process(
         return;
     }
 
-    uint32_t thresh_num = req_ctl->data_size / sizeof(uint64_t);
-    if (request == NULL || thresh_num == 0) {
-        URPC_LIB_LOG_INFO("IO perf record started without quantile\n");
-        goto START_WITHOUT_QUANTILE;
+    // thresh from old urpc_admin is ignored, quantiles are requested on perf stop and read from histogram
+    g_urpc_perf_record_ctx.io_record_started = true;
+    rsp_ctl->error_code = URPC_SUCCESS;
+    URPC_LIB_LOG_INFO("IO perf record started successfully\n");
+}
+
+static void urpc_perf_result_fill(urpc_perf_result_t *result, uint32_t point, const urpc_perf_record_t *record,
+    const urpc_perf_stop_req_t *req)
+{
+    const util_hist_t *hist = &record->type_record[point].hist;
+    uint64_t cnt = record->type_record[point].cnt;
+
+    result->type_record[point].mean = record->type_record[point].mean;
+    result->type_record[point].std_m2 = record->type_record[point].std_m2;
+    result->type_record[point].min = record->type_record[point].min;
+    result->type_record[point].max = record->type_record[point].max;
+    result->type_record[point].cnt = cnt;
+    for (uint32_t i = 0; i < req->quantile_num; ++i) {
+        uint64_t value = util_hist_quantile(hist, cnt, req->quantile[i]);
+        // the middle of bucket may be out of the range recorded
+        if (cnt != 0) {
+            value = value < record->type_record[point].min ? record->type_record[point].min : value;
+            value = value > record->type_record[point].max ? record->type_record[point].max : value;
+        }
+        result->type_record[point].quantile[i] = value;
+    }
+}
+
+// caller should hold the lock, the last result is merged from all data threads, including the exited ones
+static urpc_perf_result_t *urpc_perf_result_get(const urpc_perf_stop_req_t *req, uint32_t *result_num)
+{
+    uint32_t used_num = 0;
+    for (uint32_t i = 0; i < URPC_PERF_REC_MAX_NUM; ++i) {
+        used_num += (g_urpc_perf_record_ctx.perf_record_table[i] != NULL &&
+            g_urpc_perf_record_ctx.perf_record_table[i]->is_used) ? 1 : 0;
     }
-    if (thresh_num > URPC_PERF_QUANTILE_MAX_NUM) {
-        URPC_LIB_LOG_WARN(
-            "configured thresh num %u exceeds the max thresh_num %u, only the minimum %d of them are used\n",
-            thresh_num, URPC_PERF_QUANTILE_MAX_NUM, URPC_PERF_QUANTILE_MAX_NUM);
-        thresh_num = URPC_PERF_QUANTILE_MAX_NUM;
+
+    urpc_perf_result_t *result =
+        (urpc_perf_result_t *)urpc_dbuf_calloc(URPC_DBUF_TYPE_DFX, used_num + 1, sizeof(urpc_perf_result_t));
+    urpc_perf_record_t *total = (urpc_perf_record_t *)urpc_dbuf_calloc(URPC_DBUF_TYPE_DFX, 1,
+        sizeof(urpc_perf_record_t));
+    if (result == NULL || total == NULL) {
+        urpc_dbuf_free(result);
+        urpc_dbuf_free(total);
+        return NULL;
     }
 
-    // set quantile bucket
-    uint32_t idx = 0;
-    uint64_t *thresh_array = (uint64_t *)request;
-    for (uint32_t i = 0; i < thresh_num; ++i) {
-        if (thresh_array[i] > (URPC_PERF_MAX_THRESH_NS * urpc_get_cpu_hz() / NS_PER_SEC)) {
+    uint32_t num = 0;
+    urpc_perf_record_clear(total);
+    for (uint32_t point = 0; point < PERF_RECORD_POINT_MAX; ++point) {
+        urpc_perf_record_merge(total, &g_urpc_perf_record_ctx.retired_record, point);
+    }
+    for (uint32_t i = 0; i < URPC_PERF_REC_MAX_NUM; ++i) {
+        urpc_perf_record_t *record = g_urpc_perf_record_ctx.perf_record_table[i];
+        if (record == NULL || !record->is_used) {
             continue;
         }
-        if (idx == 0 || thresh_array[i] > g_urpc_perf_record_ctx.perf_quantile_thresh[idx - 1]) {
-            g_urpc_perf_record_ctx.perf_quantile_thresh[idx++] = thresh_array[i];
+        result[num].thread_idx = i;
+        for (uint32_t point = 0; point < PERF_RECORD_POINT_MAX; ++point) {
+            urpc_perf_result_fill(&result[num], point, record, req);
+            urpc_perf_record_merge(total, record, point);
         }
+        num++;
     }
 
-    g_urpc_perf_record_ctx.io_record_started = true;
-    rsp_ctl->error_code = URPC_SUCCESS;
-    URPC_LIB_LOG_INFO("IO perf record started successfully, set %u thresh\n", idx);
+    result[num].thread_idx = URPC_PERF_ALL_THREAD_IDX;
+    for (uint32_t point = 0; point < PERF_RECORD_POINT_MAX; ++point) {
+        urpc_perf_result_fill(&result[num], point, total, req);
+    }
+    urpc_dbuf_free(total);
+    *result_num = num + 1;
+    return result;
+}
 
-    return;
+// quantiles of the request are used if valid, or the default ones for urpc_admin sending no quantile
+static void perf_stop_req_parse(urpc_ipc_ctl_head_t *req_ctl, char *request, urpc_perf_stop_req_t *req)
+{
+    static const double default_list[URPC_PERF_QUANTILE_DEFAULT_NUM] = URPC_PERF_QUANTILE_DEFAULT_LIST;
+    if (request != NULL && req_ctl->data_size >= sizeof(urpc_perf_stop_req_t)) {
+        (void)memcpy(req, request, sizeof(urpc_perf_stop_req_t));
+        bool valid = req->quantile_num > 0 && req->quantile_num <= URPC_PERF_QUANTILE_MAX_NUM;
+        for (uint32_t i = 0; valid && i < req->quantile_num; ++i) {
+            valid = req->quantile[i] >= 0 && req->quantile[i] <= 1;
+        }
+        if (valid) {
+            return;
+        }
+        URPC_LIB_LOG_WARN("invalid quantiles in perf stop request, report the default ones\n");
+    }
 
-START_WITHOUT_QUANTILE:
-    g_urpc_perf_record_ctx.io_record_started = true;
-    rsp_ctl->error_code = URPC_PARTIAL_SUCCESS;
+    req->quantile_num = URPC_PERF_QUANTILE_DEFAULT_NUM;
+    (void)memcpy(req->quantile, default_list, sizeof(default_list));
 }
 
-static void perf_stop_cmd_process(urpc_ipc_ctl_head_t *req_ctl __attribute__((unused)),
-    char *request __attribute__((unused)), urpc_ipc_ctl_head_t *rsp_ctl, char **reply)
+static void perf_stop_cmd_process(urpc_ipc_ctl_head_t *req_ctl, char *request, urpc_ipc_ctl_head_t *rsp_ctl,
+    char **reply)
 {
     if (!g_urpc_perf_record_ctx.io_record_started) {
         URPC_LIB_LOG_INFO("IO perf has not been started.\n");
@@ -196,9 +296,21 @@ static void perf_stop_cmd_process(urpc_ipc_ctl_head_t *req_ctl __attribute__((un
     }
     g_urpc_perf_record_ctx.io_record_started = false;
     URPC_LIB_LOG_INFO("IO perf record stopped.\n");
-    *reply = (char *)g_urpc_perf_record_ctx.perf_record_table;
-    rsp_ctl->data_size = (uint32_t)(sizeof(g_urpc_perf_record_ctx.perf_record_table));
-    memset(g_urpc_perf_record_ctx.perf_quantile_thresh, 0, URPC_PERF_QUANTILE_MAX_NUM * sizeof(uint64_t));
+
+    urpc_perf_stop_req_t req = {0};
+    perf_stop_req_parse(req_ctl, request, &req);
+
+    uint32_t result_num = 0;
+    (void)pthread_mutex_lock(&g_urpc_perf_record_ctx.lock);
+    urpc_perf_result_t *result = urpc_perf_result_get(&req, &result_num);
+    (void)pthread_mutex_unlock(&g_urpc_perf_record_ctx.lock);
+    if (result == NULL) {
+        URPC_LIB_LOG_ERR("malloc perf result failed\n");
+        rsp_ctl->error_code = URPC_FAIL;
+        return;
+    }
+    *reply = (char *)result;
+    rsp_ctl->data_size = (uint32_t)(sizeof(urpc_perf_result_t) * result_num);
 }
 
 static void perf_clear_cmd_process(urpc_ipc_ctl_head_t *req_ctl __attribute__((unused)),
@@ -209,10 +321,12 @@ static void perf_clear_cmd_process(urpc_ipc_ctl_head_t *req_ctl __attribute__((u
         URPC_LIB_LOG_INFO("IO perf is still running, clear it after stop\n");
         return;
     }
+    (void)pthread_mutex_lock(&g_urpc_perf_record_ctx.lock);
     for (uint32_t i = 0; i < URPC_PERF_REC_MAX_NUM; ++i) {
         urpc_clear_perf_record_item(i);
     }
-    memset(g_urpc_perf_record_ctx.perf_quantile_thresh, 0, URPC_PERF_QUANTILE_MAX_NUM * sizeof(uint64_t));
+    urpc_perf_record_clear(&g_urpc_perf_record_ctx.retired_record);
+    (void)pthread_mutex_unlock(&g_urpc_perf_record_ctx.lock);
     rsp_ctl->error_code = URPC_SUCCESS;
     URPC_LIB_LOG_INFO("IO perf records were cleared\n");
 }
@@ -228,7 +342,7 @@ static urpc_ipc_cmd_t g_urpc_perf_cmd[] = {
         .module_id = (uint16_t)URPC_IPC_MODULE_PERF,
         .cmd_id = (uint16_t)URPC_PERF_CMD_ID_STOP,
         .func = perf_stop_cmd_process,
-        .reply_malloced = false,
+        .reply_malloced = true,
     },
     {
         .module_id = (uint16_t)URPC_IPC_MODULE_PERF,
@@ -243,6 +357,7 @@ int urpc_perf_cmd_init(void)
     for (uint32_t i = 0; i < URPC_PERF_REC_MAX_NUM; ++i) {
         urpc_clear_perf_record_item(i);
     }
+    urpc_perf_record_clear(&g_urpc_perf_record_ctx.retired_record);
     return unix_server_cmds_register(g_urpc_perf_cmd, URPC_PERF_CMD_NUM);
 }
 
@@ -16,7 +16,13 @@
 extern "C" {
 #endif
 
+// quantiles are read from log-linear histogram of each data thread, at most 8 of them are reported on perf stop
 #define URPC_PERF_QUANTILE_MAX_NUM (8u)
+// quantiles reported when perf stop request specifies none: median, p90, p99, p99.9 and p99.99
+#define URPC_PERF_QUANTILE_DEFAULT_NUM (5u)
+#define URPC_PERF_QUANTILE_DEFAULT_LIST {0.5, 0.9, 0.99, 0.999, 0.9999}
+// thread_idx of the result merged from all data threads
+#define URPC_PERF_ALL_THREAD_IDX (UINT32_MAX)
 
 typedef enum urpc_perf_cmd_id {
     URPC_PERF_CMD_ID_START,
@@ -25,18 +31,24 @@ typedef enum urpc_perf_cmd_id {
     URPC_PERF_CMD_MAX,
 } urpc_perf_cmd_id_t;
 
-typedef struct urpc_perf_record {
+// request of perf stop, each quantile is in [0, 1]
+typedef struct urpc_perf_stop_req {
+    uint32_t quantile_num;
+    double quantile[URPC_PERF_QUANTILE_MAX_NUM];
+} urpc_perf_stop_req_t;
+
+// reply of perf stop, in cpu cycles, quantile[i] is the value at quantile[i] of the request
+typedef struct urpc_perf_result {
     struct {
         double mean;
         double std_m2;
         uint64_t min;
         uint64_t max;
         uint64_t cnt;
-        // bucket[URPC_PERF_QUANTILE_MAX_NUM] stores the number of samples that exceed the max quantile_thresh
-        uint64_t bucket[URPC_PERF_QUANTILE_MAX_NUM + 1];
+        uint64_t quantile[URPC_PERF_QUANTILE_MAX_NUM];
     } type_record[PERF_RECORD_POINT_MAX];
-    bool is_used;
-} urpc_perf_record_t;
+    uint32_t thread_idx;
+} urpc_perf_result_t;
 
 int urpc_perf_cmd_init(void);
 void urpc_perf_cmd_uninit(void);
@@ -101,6 +101,9 @@ void task_engine_async_callback(void *ctx, int result)
     URPC_LIB_LOG_DEBUG("handshake with server completed, to notify the user result:%d, type:%d\n",
         result, callback_ctx->event.event_type);
     callback_ctx->event.err_code = result;
+    if (result == URPC_SUCCESS && callback_ctx->event.event_type == URPC_ASYNC_EVENT_CHANNEL_ATTACH) {
+        task_engine_callback_queue_select_apply(callback_ctx, callback_ctx->event.channel_id);
+    }
     if (result != URPC_ERR_FORCE_EXIT) {
         async_event_notify(&callback_ctx->event);
     }
@@ -1860,6 +1863,7 @@ static int add_local_final_step(urpc_async_task_ctx_t *task)
     URPC_SLIST_INSERT_HEAD(&channel->l_queue_nodes_head, ctx->queue_node, node);
     ctx->queue_node = NULL;
     channel->l_qnum++;
+    channel_queue_snapshot_update(channel, false);
     queue_t *queue = (queue_t *)(uintptr_t)ctx->urpc_qh;
     (void)__sync_fetch_and_add(&queue->ref_cnt, 1);
     return URPC_SUCCESS;
@@ -2728,6 +2732,19 @@ handshaker_callback_ctx_t *task_engine_callback_construct(
     return ctx;
 }
 
+void task_engine_callback_queue_select_apply(handshaker_callback_ctx_t *ctx, uint32_t urpc_chid)
+{
+    if ((ctx->conn_option.flag & URPC_CHANNEL_CONN_FLAG_QUEUE_SELECT) == 0) {
+        return;
+    }
+    urpc_channel_info_t *channel = channel_get(urpc_chid);
+    if (channel == NULL) {
+        return;
+    }
+    // requests in flight remember the slots they are counted on, so policy may change at any time
+    channel->queue_select = ctx->conn_option.queue_select;
+}
+
 void task_engine_callback_destruct(handshaker_callback_ctx_t *ctx)
 {
     if (ctx->nonblock == URPC_FALSE) {
@@ -262,6 +262,8 @@ void task_engine_sync_callback(void *ctx, int result);
 handshaker_callback_ctx_t *task_engine_callback_construct(
     urpc_host_info_t *server, urpc_channel_connect_option_t *option);
 void task_engine_callback_destruct(handshaker_callback_ctx_t *ctx);
+// set queue select policy of connect option to the channel, called after attach succeeds
+void task_engine_callback_queue_select_apply(handshaker_callback_ctx_t *ctx, uint32_t urpc_chid);
 bool task_can_stop_immediately(urpc_async_task_ctx_t *task);
 
 #ifdef __cplusplus
@@ -22,6 +22,7 @@
 #define URPC_REF_READ_MAX_SGE_NUM 1
 #define MAX_FUNC_DEFINED 256
 #define POLL_MAX_NUM 64
+#define URPC_REQ_TIMER_WHEEL_TICK_US 1000    // request timeout is set in ms
 static ext_ops_t *g_urpc_ext_ops[MAX_FUNC_DEFINED];
 
 static urpc_func_poll_cb_t g_func_poll_cb = NULL;
@@ -137,8 +138,9 @@ RECORD_END:
     return ret;
 }
 
-queue_t *urpc_get_local_queue(urpc_channel_info_t *channel, urpc_call_option_t *option)
+queue_t *urpc_get_local_queue(urpc_channel_info_t *channel, urpc_call_option_t *option, uint32_t *slot)
 {
+    *slot = CHANNEL_QUEUE_SLOT_INVALID;
     if ((option->option_flag & FUNC_CALL_FLAG_L_QH) != 0) {
         if (option->l_qh == URPC_INVALID_HANDLE) {
             URPC_LIB_LIMIT_LOG_DEBUG("local queue handle invalid\n");
@@ -147,12 +149,13 @@ queue_t *urpc_get_local_queue(urpc_channel_info_t *channel, urpc_call_option_t *
         return channel_get_local_queue_by_handle(channel, option->l_qh);
     }
 
-    // local queue按rr选择
-    return channel_get_next_local_queue(channel);
+    // local queue按channel的策略选择
+    return channel_get_next_local_queue(channel, slot);
 }
 
-queue_t *urpc_get_remote_queue(urpc_channel_info_t *channel, urpc_call_option_t *option)
+queue_t *urpc_get_remote_queue(urpc_channel_info_t *channel, urpc_call_option_t *option, uint32_t *slot)
 {
+    *slot = CHANNEL_QUEUE_SLOT_INVALID;
     if ((option->option_flag & FUNC_CALL_FLAG_R_QH) != 0) {
         if (option->r_qh == URPC_INVALID_HANDLE) {
             URPC_LIB_LIMIT_LOG_DEBUG("remote queue handle invalid\n");
@@ -161,8 +164,8 @@ queue_t *urpc_get_remote_queue(urpc_channel_info_t *channel, urpc_call_option_t
         return channel_get_remote_queue_by_handle(channel, option->r_qh);
     }
 
-    // remote queue按rr选择
-    return channel_get_next_remote_queue(channel);
+    // remote queue按channel的策略选择
+    return channel_get_next_remote_queue(channel, slot);
 }
 
 static int ext_func_call(urpc_poll_msg_t *msg, req_ctx_t **req_ctx, ext_call_ctx_t *ext_call_ctx)
@@ -273,6 +276,21 @@ static int timeout_create(urpc_call_option_t *option, req_entry_t *req, uint8_t
         return URPC_FAIL;
     }
 
+    /* a caller which polls by urpc_func_poll may ask its own wheel to check the timeout, which takes no lock.
+     * wait-rsp callers block until the response instead of polling, they take the global timer, as do requests
+     * whose tw_timer is still being cancelled on the wheel of another thread */
+    bool wait_rsp = (option->option_flag & FUNC_CALL_FLAG_CALL_MODE) != 0 &&
+        (option->call_mode & FUNC_CALL_MODE_WAIT_RSP) != 0;
+    if ((option->option_flag & FUNC_CALL_FLAG_POLL_TIMEOUT) != 0 && !wait_rsp &&
+        util_tw_timer_is_idle(&req->tw_timer)) {
+        util_timer_wheel_t *tw = util_timer_wheel_thread_get(URPC_REQ_TIMER_WHEEL_TICK_US, 0);
+        if (URPC_LIKELY(tw != NULL && util_tw_timer_add(tw, &req->tw_timer,
+            (uint64_t)option->timeout * (US_PER_SEC / MS_PER_SEC), false) == URPC_SUCCESS)) {
+            req->tw_armed = URPC_TRUE;
+            return URPC_SUCCESS;
+        }
+    }
+
     req->timer = urpc_timer_create(req->local_chid, false);
     if (URPC_UNLIKELY(req->timer == NULL)) {
         return URPC_FAIL;
@@ -370,7 +388,8 @@ uint64_t urpc_func_call(uint32_t chid, urpc_call_wr_t *wr, urpc_call_option_t *o
     }
 
     (void)pthread_rwlock_rdlock(&channel->rw_lock);
-    queue_t *l_queue = urpc_get_local_queue(channel, option);
+    uint32_t l_slot, r_slot;
+    queue_t *l_queue = urpc_get_local_queue(channel, option, &l_slot);
     if (URPC_UNLIKELY(l_queue == NULL)) {
         errno = URPC_ERR_LOCAL_QUEUE_ERR;
         queue_error_stats_record(NULL, ERR_STATS_TYPE_CALL_NO_L_QUEUE);
@@ -378,7 +397,7 @@ uint64_t urpc_func_call(uint32_t chid, urpc_call_wr_t *wr, urpc_call_option_t *o
         goto UNLOCK_CHANNEL;
     }
 
-    queue_t *r_queue = urpc_get_remote_queue(channel, option);
+    queue_t *r_queue = urpc_get_remote_queue(channel, option, &r_slot);
     if (URPC_UNLIKELY(r_queue == NULL)) {
         errno = URPC_ERR_REMOTE_QUEUE_ERR;
         queue_error_stats_record(l_queue, ERR_STATS_TYPE_CALL_NO_R_QUEUE);
@@ -414,6 +433,11 @@ uint64_t urpc_func_call(uint32_t chid, urpc_call_wr_t *wr, urpc_call_option_t *o
         req_entry->args_num = wr->args_num;
         req_entry->send_qh = (uint64_t)(uintptr_t)l_queue;
         req_id = req_entry->req_id;
+        // requests are counted on the selected queues until response, req_entry_put uncounts them
+        req_entry->l_slot = (uint16_t)l_slot;
+        req_entry->r_slot = (uint16_t)r_slot;
+        channel_queue_load_add(&channel->l_selector, l_slot);
+        channel_queue_load_add(&channel->r_selector, r_slot);
 
         if ((option->option_flag & FUNC_CALL_FLAG_CALL_MODE) != 0 &&
             (option->call_mode & FUNC_CALL_MODE_WAIT_RSP) != 0) {
@@ -1790,6 +1814,12 @@ int urpc_func_poll(uint32_t urpc_chid, urpc_poll_option_t *option, urpc_poll_msg
     int msg_num = max_msg_num > POLL_MAX_NUM ? POLL_MAX_NUM : (int)max_msg_num;
     uint64_t func_poll_start = urpc_perf_record_begin(PERF_RECORD_POINT_FUNC_POLL);
 
+    // timeouts of requests sent by this thread with FUNC_CALL_FLAG_POLL_TIMEOUT
+    util_timer_wheel_t *tw = util_timer_wheel_thread_peek();
+    if (tw != NULL) {
+        (void)util_timer_wheel_poll(tw);
+    }
+
     int ret = 0;
     if (option->urpc_qh != URPC_INVALID_HANDLE) {
         ret = poll_one_queue(urpc_chid, option, msg, msg_num);
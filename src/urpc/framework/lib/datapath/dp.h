@@ -119,8 +119,8 @@ typedef struct sync_req_cb_arg {
 } sync_req_cb_arg_t;
 
 int post_rx_buf(uint64_t qh, uint32_t post_num, uint64_t one_buffer_size);
-queue_t *urpc_get_local_queue(urpc_channel_info_t *channel, urpc_call_option_t *option);
-queue_t *urpc_get_remote_queue(urpc_channel_info_t *channel, urpc_call_option_t *option);
+queue_t *urpc_get_local_queue(urpc_channel_info_t *channel, urpc_call_option_t *option, uint32_t *slot);
+queue_t *urpc_get_remote_queue(urpc_channel_info_t *channel, urpc_call_option_t *option, uint32_t *slot);
 void tx_ctx_try_put(tx_ctx_t *ctx);
 // export for dp_ext
 int urpc_func_call_early_rsp(uint32_t server_chid, urpc_call_wr_t *wr, urpc_call_option_t *option);
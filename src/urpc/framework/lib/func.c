@@ -13,6 +13,7 @@
 #include "urpc_framework_api.h"
 #include "urpc_dbuf_stat.h"
 #include "urpc_hash.h"
+#include "util_epoch.h"
 #include "func.h"
 
 /*
@@ -45,6 +46,7 @@ typedef struct urpc_func_id {
 #define METHOD_PRIVATE 1
 #define METHOD_MASK 0x7fffff
 #define PRIVATE_MASK 0x800000
+#define URPC_FUNC_SLOT_MIN 64
 
 typedef struct urpc_func_base_entry {
     struct urpc_hmap_node name_node;
@@ -53,7 +55,6 @@ typedef struct urpc_func_base_entry {
 } urpc_func_base_entry_t;
 
 typedef struct urpc_func_entry {
-    struct urpc_hmap_node id_node;
     struct urpc_hmap_node name_node;
     urpc_handler_info_t info;
     uint64_t func_id;
@@ -71,7 +72,15 @@ typedef struct urpc_func_info {
     name_id_t name_map[0];
 } urpc_func_info_t;
 
-static struct urpc_hmap g_urpc_func_id_table;
+/* entries indexed by method id, looked up on each request in epoch read section without lock.
+ * writers hold g_urpc_func_table_rwlock, set or clear a slot in place, and replace the whole table only to grow,
+ * unregistered entries and replaced tables are freed after readers left */
+typedef struct urpc_func_slots {
+    uint32_t num;
+    urpc_func_entry_t *entry[0];
+} urpc_func_slots_t;
+
+static urpc_func_slots_t *g_urpc_func_slots;    // NULL if the function module is not initialized
 static struct urpc_hmap g_urpc_func_name_table;
 static pthread_rwlock_t  g_urpc_func_table_rwlock = PTHREAD_RWLOCK_INITIALIZER;
 static urpc_id_generator_t g_urpc_func_id_gen;
@@ -117,16 +126,51 @@ static inline urpc_func_base_entry_t *urpc_client_func_entry_get_by_name(struct
 }
 
 // method_id is func id without prefix
-static inline urpc_func_entry_t *urpc_server_func_entry_get_by_id(struct urpc_hmap *hmap, uint32_t method_id)
+static inline urpc_func_entry_t *urpc_server_func_entry_get_by_id(urpc_func_slots_t *slots, uint32_t method_id)
 {
-    urpc_func_entry_t *entry = NULL;
-    URPC_HMAP_FOR_EACH_WITH_HASH(entry, id_node, method_id, hmap) {
-        if ((entry->func_id & METHOD_MASK) == method_id) {
-            return entry;
-        }
+    if (method_id >= slots->num) {
+        return NULL;
     }
 
-    return NULL;
+    return __atomic_load_n(&slots->entry[method_id], __ATOMIC_ACQUIRE);
+}
+
+static urpc_func_slots_t *urpc_func_slots_alloc(uint32_t num, urpc_func_slots_t *old)
+{
+    urpc_func_slots_t *slots = (urpc_func_slots_t *)urpc_dbuf_calloc(URPC_DBUF_TYPE_FUNC, 1,
+        (uint32_t)(sizeof(urpc_func_slots_t) + sizeof(urpc_func_entry_t *) * num));
+    if (slots == NULL) {
+        return NULL;
+    }
+
+    slots->num = num;
+    if (old != NULL) {
+        (void)memcpy(slots->entry, old->entry, sizeof(urpc_func_entry_t *) * old->num);
+    }
+    return slots;
+}
+
+// called with write lock held, the replaced table is returned in old to be retired after unlock
+static int urpc_func_slots_reserve(uint32_t method_id, urpc_func_slots_t **old)
+{
+    urpc_func_slots_t *slots = g_urpc_func_slots;
+    *old = NULL;
+    if (method_id < slots->num) {
+        return URPC_SUCCESS;
+    }
+
+    uint32_t num = slots->num;
+    while (num <= method_id) {
+        num <<= 1;
+    }
+    urpc_func_slots_t *new_slots = urpc_func_slots_alloc(num, slots);
+    if (new_slots == NULL) {
+        return -URPC_ERR_ENOMEM;
+    }
+
+    __atomic_store_n(&g_urpc_func_slots, new_slots, __ATOMIC_RELEASE);
+    *old = slots;
+    return URPC_SUCCESS;
 }
 
 static inline urpc_func_entry_t *urpc_server_func_entry_get_by_name(struct urpc_hmap *hmap, const char *name)
@@ -155,20 +199,24 @@ int urpc_func_exec(uint64_t func_id, urpc_sge_t *args, uint32_t args_sge_num, ur
         return -URPC_ERR_EINVAL;
     }
 
-    (void)pthread_rwlock_rdlock(&g_urpc_func_table_rwlock);
-    if (!g_urpc_function_initialized) {
-        (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
-         URPC_LIB_LOG_DEBUG("the function module needs to be initialized\n");
+    if (!util_epoch_read_lock()) {
+        URPC_LIB_LIMIT_LOG_ERR("function[%lu] lookup failed, no epoch reader\n", func_id);
+        return -URPC_ERR_ENOMEM;
+    }
+    urpc_func_slots_t *slots = __atomic_load_n(&g_urpc_func_slots, __ATOMIC_ACQUIRE);
+    if (slots == NULL) {
+        util_epoch_read_unlock();
+        URPC_LIB_LOG_DEBUG("the function module needs to be initialized\n");
         return -1;
     }
-    urpc_func_entry_t *entry = urpc_server_func_entry_get_by_id(&g_urpc_func_id_table, method_id);
+    urpc_func_entry_t *entry = urpc_server_func_entry_get_by_id(slots, method_id);
     if (entry == NULL || entry->info.type != URPC_HANDLER_SYNC || entry->info.sync_handler == NULL) {
-        (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
+        util_epoch_read_unlock();
         URPC_LIB_LOG_DEBUG("lookup function[%lu] failed\n", func_id);
         return -1;
     }
     entry->info.sync_handler(args, args_sge_num, entry->info.ctx, rsps, rsps_sge_num);
-    (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
+    util_epoch_read_unlock();
     return 0;
 }
 
@@ -184,20 +232,24 @@ int urpc_func_async_exec(uint64_t func_id, urpc_sge_t *args, uint32_t args_sge_n
         return -URPC_ERR_EINVAL;
     }
 
-    (void)pthread_rwlock_rdlock(&g_urpc_func_table_rwlock);
-    if (!g_urpc_function_initialized) {
-        (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
-         URPC_LIB_LOG_DEBUG("the function module needs to be initialized\n");
+    if (!util_epoch_read_lock()) {
+        URPC_LIB_LIMIT_LOG_ERR("function[%lu] lookup failed, no epoch reader\n", func_id);
+        return -URPC_ERR_ENOMEM;
+    }
+    urpc_func_slots_t *slots = __atomic_load_n(&g_urpc_func_slots, __ATOMIC_ACQUIRE);
+    if (slots == NULL) {
+        util_epoch_read_unlock();
+        URPC_LIB_LOG_DEBUG("the function module needs to be initialized\n");
         return -1;
     }
-    urpc_func_entry_t *entry = urpc_server_func_entry_get_by_id(&g_urpc_func_id_table, method_id);
+    urpc_func_entry_t *entry = urpc_server_func_entry_get_by_id(slots, method_id);
     if (entry == NULL || entry->info.type != URPC_HANDLER_ASYNC || entry->info.async_handler == NULL) {
-        (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
+        util_epoch_read_unlock();
         URPC_LIB_LOG_DEBUG("lookup function[%lu] failed\n", func_id);
         return -1;
     }
     entry->info.async_handler(args, args_sge_num, entry->info.ctx, req_ctx, qh);
-    (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
+    util_epoch_read_unlock();
     return 0;
 }
 
@@ -236,12 +288,25 @@ int urpc_func_register(urpc_handler_info_t *info, uint64_t *func_id)
         return -URPC_ERR_ENOMEM;
     }
 
-    (void)pthread_rwlock_wrlock(&g_urpc_func_table_rwlock);
-    urpc_hmap_insert(&g_urpc_func_id_table, &entry->id_node, method_id);
-    urpc_hmap_insert(&g_urpc_func_name_table, &entry->name_node, urpc_hash_string(info->name, 0));
     entry->info = *info;
     entry->func_id = *func_id;
+
+    urpc_func_slots_t *old_slots = NULL;
+    (void)pthread_rwlock_wrlock(&g_urpc_func_table_rwlock);
+    ret = g_urpc_function_initialized ? urpc_func_slots_reserve(method_id, &old_slots) : URPC_FAIL;
+    if (ret != URPC_SUCCESS) {
+        (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
+        URPC_LIB_LOG_ERR("reserve function slot failed, ret:%d\n", ret);
+        urpc_dbuf_free(entry);
+        urpc_id_generator_free(&g_urpc_func_id_gen, method_id);
+        return ret;
+    }
+    urpc_hmap_insert(&g_urpc_func_name_table, &entry->name_node, urpc_hash_string(info->name, 0));
+    __atomic_store_n(&g_urpc_func_slots->entry[method_id], entry, __ATOMIC_RELEASE);
     (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
+    if (old_slots != NULL) {
+        util_epoch_retire(old_slots, urpc_dbuf_free);
+    }
 
     URPC_LIB_LOG_INFO("register function[%lu] successful\n", *func_id);
     return URPC_SUCCESS;
@@ -262,18 +327,22 @@ int urpc_func_unregister(uint64_t func_id)
         return URPC_FAIL;
     }
 
-    urpc_func_entry_t *entry = urpc_server_func_entry_get_by_id(&g_urpc_func_id_table, method_id);
+    urpc_func_entry_t *entry = urpc_server_func_entry_get_by_id(g_urpc_func_slots, method_id);
     if (entry == NULL) {
         (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
         URPC_LIB_LOG_ERR("function doesn't exist in hash table\n");
         return URPC_FAIL;
     }
 
+    // the id can be taken again at once, a new entry never shares memory with the retired one
+    __atomic_store_n(&g_urpc_func_slots->entry[method_id], NULL, __ATOMIC_RELEASE);
     urpc_id_generator_free(&g_urpc_func_id_gen, method_id);
-    urpc_hmap_remove(&g_urpc_func_id_table, &entry->id_node);
     urpc_hmap_remove(&g_urpc_func_name_table, &entry->name_node);
-    urpc_dbuf_free(entry);
     (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
+    /* handler may still be running in other threads, wait for them to return as the table lock used to, so that
+     * caller can free ctx or unload handler once unregister returns. entry is freed then as well */
+    util_epoch_retire(entry, urpc_dbuf_free);
+    util_epoch_synchronize();
     URPC_LIB_LOG_INFO("unregister function[%lu] successful\n", func_id);
 
     return URPC_SUCCESS;
@@ -335,28 +404,30 @@ int urpc_func_init(uint16_t device_class, uint16_t sub_class)
         return ret;
     }
 
-    ret = urpc_hmap_init(&g_urpc_func_id_table, URPC_FUNC_TABLE_SIZE);
-    if (ret != 0) {
-        URPC_LIB_LOG_ERR("hmap init failed, ret:%d\n", ret);
+    urpc_func_slots_t *slots = urpc_func_slots_alloc(URPC_FUNC_SLOT_MIN, NULL);
+    if (slots == NULL) {
+        URPC_LIB_LOG_ERR("malloc function slots failed\n");
+        ret = -URPC_ERR_ENOMEM;
         goto UNINIT_ID_GENERATOR;
     }
 
     ret = urpc_hmap_init(&g_urpc_func_name_table, URPC_FUNC_TABLE_SIZE);
     if (ret != 0) {
         URPC_LIB_LOG_ERR("hmap init failed, ret:%d\n", ret);
-        goto UNINIT_FUNC;
+        goto FREE_SLOTS;
     }
 
     urpc_func_id_t *func_id = (urpc_func_id_t *)(uintptr_t)&g_urpc_func_id_fixed_prefix;
     func_id->device_class = device_class;
     func_id->sub_class = sub_class;
     func_id->p = METHOD_PRIVATE;
+    __atomic_store_n(&g_urpc_func_slots, slots, __ATOMIC_RELEASE);
     g_urpc_function_initialized = true;
     (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
     return URPC_SUCCESS;
 
-UNINIT_FUNC:
-    urpc_hmap_uninit(&g_urpc_func_id_table);
+FREE_SLOTS:
+    urpc_dbuf_free(slots);
 
 UNINIT_ID_GENERATOR:
     urpc_id_generator_uninit(&g_urpc_func_id_gen);
@@ -373,18 +444,24 @@ void urpc_func_uninit(void)
         return;
     }
 
+    urpc_func_slots_t *slots = g_urpc_func_slots;
+    __atomic_store_n(&g_urpc_func_slots, NULL, __ATOMIC_RELEASE);
     urpc_id_generator_uninit(&g_urpc_func_id_gen);
     urpc_func_entry_t *cur = NULL;
     urpc_func_entry_t *next = NULL;
-    URPC_HMAP_FOR_EACH_SAFE(cur, next, id_node, &g_urpc_func_id_table) {
-        urpc_hmap_remove(&g_urpc_func_id_table, &cur->id_node);
+    URPC_HMAP_FOR_EACH_SAFE(cur, next, name_node, &g_urpc_func_name_table) {
         urpc_hmap_remove(&g_urpc_func_name_table, &cur->name_node);
-        urpc_dbuf_free(cur);
     }
-    urpc_hmap_uninit(&g_urpc_func_id_table);
     urpc_hmap_uninit(&g_urpc_func_name_table);
     g_urpc_function_initialized = false;
     (void)pthread_rwlock_unlock(&g_urpc_func_table_rwlock);
+
+    // wait out of lock, handlers still running may look up function id
+    util_epoch_synchronize();
+    for (uint32_t i = 0; i < slots->num; i++) {
+        urpc_dbuf_free(slots->entry[i]);
+    }
+    urpc_dbuf_free(slots);
 }
 
 // used for server to construct send func info
@@ -392,7 +469,7 @@ int urpc_func_info_get(void **addr, uint32_t *len)
 {
     int ret = URPC_FAIL;
     pthread_rwlock_rdlock(&g_urpc_func_table_rwlock);
-    uint32_t func_count = urpc_hmap_count(&g_urpc_func_id_table);
+    uint32_t func_count = urpc_hmap_count(&g_urpc_func_name_table);
     uint32_t info_size = (uint32_t)(sizeof(urpc_func_info_t) + sizeof(name_id_t) * func_count);
     urpc_func_info_t *info = urpc_dbuf_calloc(URPC_DBUF_TYPE_FUNC, 1, info_size);
     if (info == NULL) {
@@ -411,7 +488,7 @@ int urpc_func_info_get(void **addr, uint32_t *len)
 
     uint32_t index = 0;
     urpc_func_entry_t *entry = NULL;
-    URPC_HMAP_FOR_EACH(entry, id_node, &g_urpc_func_id_table) {
+    URPC_HMAP_FOR_EACH(entry, name_node, &g_urpc_func_name_table) {
         info->name_map[index].id = entry->func_id;
         strcpy(info->name_map[index].name, entry->info.name);
         index++;
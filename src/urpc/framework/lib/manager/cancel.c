@@ -30,13 +30,12 @@ static void client_report_cancel_msg(req_entry_t *req_entry, void *user_ctx)
 }
 
 // do nothing, just set req_entry_t to invalid
-void urpc_cancel_timeout_process(void *args)
+static void cancel_timeout_process(req_entry_t *entry, bool tw_timer)
 {
-    req_entry_t *entry = (req_entry_t *)args;
     URPC_LIB_LOG_WARN("start timeout process, cid = %d, sid = %d, rsn = %d, args_num = %d\n",
         entry->local_chid, entry->remote_chid, entry->req_id, entry->args_num);
     (void)pthread_mutex_lock(&entry->lock);
-    if (is_req_entry_timeout(entry)) {
+    if (tw_timer ? is_req_entry_tw_timeout(entry) : is_req_entry_timeout(entry)) {
         tx_ctx_t *tx_ctx = (tx_ctx_t *)entry->ctx;
         if (tx_ctx != NULL) {
             if ((tx_ctx->call_mode & FUNC_CALL_MODE_WAIT_RSP) != 0) {
@@ -52,4 +51,14 @@ void urpc_cancel_timeout_process(void *args)
         req_entry_put(entry);
     }
     (void)pthread_mutex_unlock(&entry->lock);
+}
+
+void urpc_cancel_timeout_process(void *args)
+{
+    cancel_timeout_process((req_entry_t *)args, false);
+}
+
+void urpc_cancel_tw_timeout_process(void *args)
+{
+    cancel_timeout_process((req_entry_t *)args, true);
 }
\ No newline at end of file
@@ -15,6 +15,8 @@ extern "C" {
 #endif
 
 void urpc_cancel_timeout_process(void *args);
+// callback of req_entry_t tw_timer, called by the thread which sent the request in its urpc_func_poll
+void urpc_cancel_tw_timeout_process(void *args);
 
 #ifdef __cplusplus
 }
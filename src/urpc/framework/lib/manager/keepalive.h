@@ -45,7 +45,7 @@ typedef struct urpc_keepalive_entry {
     urpc_instance_key_t key;
     struct urpc_hmap_node task_node;
 
-    uint64_t cpu_cycles;
+    uint64_t cpu_cycles;  // last refresh of logic server, stored atomically without the write lock
     uint8_t remote_version;
     uint8_t primary_is_server : 1;  // local is primary logic server, been attached as server firstly [and attach to
                                     // server]
@@ -56,7 +56,7 @@ typedef struct urpc_keepalive_entry {
 
     // if local is logic server
     struct urpc_hmap_node server_id_node;
-    urpc_list_t list;  // in reachable list
+    urpc_list_t list;  // in deadline wheel of logic servers
     urpc_keepalive_id_t server_task_id;
     uint64_t user_ctx;                                  // used for keepalive callback
     uint32_t server_chid[URPC_MAX_CHANNEL_PER_CLIENT];  // server channel id, local logic server use
@@ -112,6 +112,8 @@ int urpc_keepalive_task_server_chid_add(urpc_instance_key_t *key, urpc_keepalive
 void urpc_keepalive_task_server_chid_delete(urpc_instance_key_t *key, urpc_keepalive_task_info_t *info);
 
 void urpc_keepalive_check(void *args);
+// expire logic servers not refreshed for check time before cur_cpu_cycles, return the number expired
+uint32_t urpc_keepalive_task_timeout(uint64_t cur_cpu_cycles);
 void urpc_keepalive_task_timestamp_update(urpc_keepalive_id_t *id, bool is_server);
 int urpc_keepalive_task_entry_info_get(urpc_keepalive_id_t *id, bool is_server, urpc_keepalive_event_info_t *info);
 
@@ -18,6 +18,18 @@
 #include "keepalive.h"
 
 #define URPC_KEEPALIVE_TASK_NUM (8192)
+#define URPC_KEEPALIVE_WHEEL_SIZE (256)  // buckets of one second, power of 2
+#define URPC_KEEPALIVE_WHEEL_MASK (URPC_KEEPALIVE_WHEEL_SIZE - 1)
+#define URPC_KEEPALIVE_EXPIRE_BATCH (32)
+
+// logic server expired, copied out under the write lock, its channels are released and callback is called after
+typedef struct urpc_keepalive_expired {
+    urpc_instance_key_t key;
+    urpc_keepalive_id_t server_task_id;
+    uint32_t server_chid[URPC_MAX_CHANNEL_PER_CLIENT];
+    uint8_t server_chid_num;
+    urpc_keepalive_event_info_t info;
+} urpc_keepalive_expired_t;
 
 static struct {
     pthread_rwlock_t lock;           // when insert/remove entry, use wr_lock, otherwise, use rd_lock
@@ -25,7 +37,10 @@ static struct {
     struct urpc_hmap server_id_map;  // key: manage chid, value: entry. to prevent timer and mange thread concurrency
     struct urpc_hmap task_map;       // key: remote urpc_instance_key_t, value: entry
     struct urpc_hmap server_info_map;  // key: urpc_server_info_inner_t, value: entry. used when insert input msg
-    urpc_list_t reachable_list;        // logic server update its timestamp
+    /* logic servers bucketed by the second their check time is due. refresh only stores cpu_cycles of entry, the
+     * entry is moved to the bucket of its new deadline when the check reaches its old bucket */
+    urpc_list_t wheel[URPC_KEEPALIVE_WHEEL_SIZE];
+    uint64_t wheel_sec;  // buckets before this second have been checked
 } g_urpc_keepalive_mgmt = {
     .lock = PTHREAD_RWLOCK_INITIALIZER,
 };
@@ -45,7 +60,10 @@ int urpc_keepalive_task_init(void)
 {
     int ret;
 
-    urpc_list_init(&g_urpc_keepalive_mgmt.reachable_list);
+    for (uint32_t i = 0; i < URPC_KEEPALIVE_WHEEL_SIZE; i++) {
+        urpc_list_init(&g_urpc_keepalive_mgmt.wheel[i]);
+    }
+    g_urpc_keepalive_mgmt.wheel_sec = urpc_get_cpu_cycles() / urpc_get_cpu_hz();
     ret = urpc_hmap_init(&g_urpc_keepalive_mgmt.client_id_map, URPC_KEEPALIVE_TASK_NUM);
     if (ret != URPC_SUCCESS) {
         URPC_LIB_LOG_ERR("keepalive client id hmap init failed\n");
@@ -103,7 +121,7 @@ static void urpc_keepalive_task_free(urpc_keepalive_task_entry_t *entry)
     }
     urpc_hmap_remove(&g_urpc_keepalive_mgmt.task_map, &entry->task_node);
 
-    // remove from reachable list
+    // remove from deadline wheel
     if (URPC_LIKELY(urpc_list_is_in_list(&entry->list))) {
         urpc_list_remove(&entry->list);
     }
@@ -198,13 +216,31 @@ static urpc_keepalive_task_entry_t *urpc_keepalive_task_lookup_by_server_info(ur
     return NULL;
 }
 
+static inline urpc_list_t *urpc_keepalive_wheel_bucket(uint64_t cpu_cycles, uint64_t check_time, uint64_t hz)
+{
+    return &g_urpc_keepalive_mgmt.wheel[((cpu_cycles + check_time) / hz) & URPC_KEEPALIVE_WHEEL_MASK];
+}
+
+// write lock held, entry->cpu_cycles has been set
 static inline void urpc_keepalive_task_reachable(urpc_keepalive_task_entry_t *entry)
 {
+    uint64_t hz = urpc_get_cpu_hz();
+
     if (URPC_LIKELY(urpc_list_is_in_list(&entry->list))) {
         urpc_list_remove(&entry->list);
     }
 
-    urpc_list_push_back(&g_urpc_keepalive_mgmt.reachable_list, &entry->list);
+    urpc_list_push_back(
+        urpc_keepalive_wheel_bucket(entry->cpu_cycles, urpc_keepalive_check_time_get() * hz, hz), &entry->list);
+}
+
+static inline bool urpc_keepalive_task_need_update(urpc_keepalive_task_entry_t *entry, bool is_server)
+{
+    // in the following cases, we should update keepalive task timestamp
+    // 1. for server, always update
+    // 2. for client, local and remote version >= 1 and has logic server
+    return (is_server && entry->has_server == URPC_TRUE) ||
+           (!is_server && entry->has_server == URPC_TRUE && entry->remote_version > 0);
 }
 
 // used when logic server recv rsp ta_ack or logic client recv rsp(version >= 1)
@@ -212,23 +248,34 @@ void urpc_keepalive_task_timestamp_update(urpc_keepalive_id_t *id, bool is_serve
 {
     urpc_keepalive_task_entry_t *entry = NULL;
     bool updated = false;
+    bool need_rearm = false;
 
-    (void)pthread_rwlock_wrlock(&g_urpc_keepalive_mgmt.lock);
+    // entry in the wheel only needs a new timestamp, wheel and tables are changed under write lock only
+    (void)pthread_rwlock_rdlock(&g_urpc_keepalive_mgmt.lock);
     entry = urpc_keepalive_task_lookup_by_id(id, is_server);
     if (URPC_LIKELY(entry != NULL)) {
-        // in the following cases, we should update keepalive task timestamp
-        // 1. for server, always update
-        // 2. for client, local and remote version >= 1 and has logic server
-        updated = (is_server && entry->has_server == URPC_TRUE) ||
-                  (!is_server && entry->has_server == URPC_TRUE && entry->remote_version > 0);
-        if (URPC_LIKELY(updated)) {
+        updated = urpc_keepalive_task_need_update(entry, is_server);
+        if (URPC_LIKELY(updated && urpc_list_is_in_list(&entry->list))) {
+            __atomic_store_n(&entry->cpu_cycles, urpc_get_cpu_cycles(), __ATOMIC_RELEASE);
+        } else {
+            need_rearm = updated;
+        }
+    }
+    (void)pthread_rwlock_unlock(&g_urpc_keepalive_mgmt.lock);
+
+    // entry stopped by delayed release is added back to the wheel
+    if (URPC_UNLIKELY(need_rearm)) {
+        (void)pthread_rwlock_wrlock(&g_urpc_keepalive_mgmt.lock);
+        entry = urpc_keepalive_task_lookup_by_id(id, is_server);
+        updated = entry != NULL && urpc_keepalive_task_need_update(entry, is_server);
+        if (updated) {
             (void)pthread_spin_lock(&entry->lock);
             entry->cpu_cycles = urpc_get_cpu_cycles();
             urpc_keepalive_task_reachable(entry);
             (void)pthread_spin_unlock(&entry->lock);
         }
+        (void)pthread_rwlock_unlock(&g_urpc_keepalive_mgmt.lock);
     }
-    (void)pthread_rwlock_unlock(&g_urpc_keepalive_mgmt.lock);
 
     if (updated) {
         URPC_LIB_LIMIT_LOG_DEBUG(
@@ -372,7 +419,7 @@ static int urpc_keepalive_task_add_logic_server(
     uint32_t id_hash = urpc_hash_uint64(entry->server_task_id.id);
     urpc_hmap_insert(&g_urpc_keepalive_mgmt.server_id_map, &entry->server_id_node, id_hash);
 
-    // insert reachable list tail
+    // insert into deadline wheel
     entry->cpu_cycles = urpc_get_cpu_cycles();
     urpc_keepalive_task_reachable(entry);
 
@@ -608,15 +655,11 @@ static void urpc_keepalive_task_delete_logic_server(urpc_instance_key_t *key, ur
     // no logic server
     entry->has_server = URPC_FALSE;
     urpc_hmap_remove(&g_urpc_keepalive_mgmt.server_id_map, &entry->server_id_node);
-    // remove from reachable list
+    // remove from deadline wheel
     if (URPC_LIKELY(urpc_list_is_in_list(&entry->list))) {
         urpc_list_remove(&entry->list);
     }
 
-    URPC_LIB_LOG_INFO("keepalive delete logic server successful, client chid[%u], server chid[%u], " EID_FMT
-                       ", pid: %u\n",
-        entry->server_task_id.client_chid, entry->server_task_id.server_chid, EID_ARGS(key->eid), key->pid);
-
     if (entry->primary_is_server == URPC_FALSE) {
         return;
     }
@@ -676,6 +719,9 @@ void urpc_keepalive_task_delete(urpc_instance_key_t *key, urpc_keepalive_task_in
 
     if (info->is_server == URPC_TRUE && entry->has_server == URPC_TRUE) {
         urpc_keepalive_task_delete_logic_server(&entry->key, entry);
+        URPC_LIB_LOG_INFO("keepalive delete logic server successful, client chid[%u], server chid[%u], " EID_FMT
+                          ", pid: %u\n", entry->server_task_id.client_chid, entry->server_task_id.server_chid,
+                          EID_ARGS(key->eid), key->pid);
     } else if (info->is_server == URPC_FALSE && entry->has_client == URPC_TRUE) {
         urpc_keepalive_task_delete_logic_client(&entry->key, entry);
     } else {
@@ -738,7 +784,7 @@ int keepalive_task_restart(urpc_instance_key_t *key, urpc_keepalive_task_info_t
         entry->client_status = URPC_KEEPALIVE_TASK_RUNNING;
     }
 
-    // logic server add to reachable list
+    // logic server add to deadline wheel
     if ((info->is_server == URPC_TRUE) && (entry->has_server == URPC_TRUE)) {
         if (task_id_changed) {
             // remove old id_node, and then update new id_node
@@ -792,7 +838,7 @@ int keepalive_task_stop(urpc_instance_key_t *key, urpc_keepalive_task_info_t *in
         entry->client_status = URPC_KEEPALIVE_TASK_STOPPED;
     }
 
-    // logic server remove from reachable list
+    // logic server remove from deadline wheel
     if ((info->is_server == URPC_TRUE) && (entry->has_server == URPC_TRUE)) {
         if (URPC_LIKELY(urpc_list_is_in_list(&entry->list))) {
             urpc_list_remove(&entry->list);
@@ -809,35 +855,23 @@ MGMT_UNLOCK:
     return ret;
 }
 
-static void urpc_keepalive_task_entry_timeout(uint64_t cur_cpu_cycles, urpc_keepalive_task_entry_t *entry)
+// write lock held, take entry out of tables, what to release after the lock is dropped is copied to expired
+static void urpc_keepalive_task_entry_timeout(
+    uint64_t cur_cpu_cycles, uint64_t cpu_cycles, urpc_keepalive_task_entry_t *entry, urpc_keepalive_expired_t *expired)
 {
     bool need_delete_task = false;
     (void)pthread_spin_lock(&entry->lock);
-    // 1. release server channel resource
-    for (uint8_t i = 0; i < entry->server_chid_num; i++) {
-        // g_urpc_keepalive_mgmt has been locked outside, set lock_free here
-        if (server_manage_channel_put(&entry->key, false, true) == 0) {
-            (void)server_channel_free(entry->server_task_id.server_chid, false);
-        }
-        (void)server_channel_free(entry->server_chid[i], false);
-    }
-
-    // 2. keepalive callback
-    urpc_keepalive_event_info_t info = {
+    expired->key = entry->key;
+    expired->server_task_id = entry->server_task_id;
+    expired->server_chid_num = entry->server_chid_num;
+    (void)memcpy(expired->server_chid, entry->server_chid, sizeof(uint32_t) * entry->server_chid_num);
+    expired->info = (urpc_keepalive_event_info_t) {
         .user_ctx = entry->user_ctx,
-        .inactivated_time = (cur_cpu_cycles - entry->cpu_cycles) / urpc_get_cpu_hz(),
+        .inactivated_time = (cur_cpu_cycles - cpu_cycles) / urpc_get_cpu_hz(),
         .peer_pid = entry->key.pid,
     };
 
-    if (entry->server_chid_num != 0) {
-        URPC_LIB_LOG_WARN("keepalive timeout, client chid[%u], server chid[%u], " EID_FMT
-                          ", pid: %u, user info %lu, inactivated for %u seconds\n",
-                          entry->server_task_id.client_chid, entry->server_task_id.server_chid,
-                          EID_ARGS(entry->key.eid), entry->key.pid, info.user_ctx, info.inactivated_time);
-        urpc_keepalive_callback_get()(URPC_KEEPALIVE_FAILED, info);
-    }
-
-    // 3. delete logic server, and if local has no logic client, free task
+    // delete logic server, and if local has no logic client, free task
     urpc_keepalive_task_delete_logic_server(&entry->key, entry);
     need_delete_task = entry->has_client == URPC_FALSE;
 
@@ -848,37 +882,102 @@ static void urpc_keepalive_task_entry_timeout(uint64_t cur_cpu_cycles, urpc_keep
     }
 }
 
-static void urpc_keepalive_task_timeout(void)
+// no lock held, keepalive task of expired has been deleted already
+static void urpc_keepalive_task_expired_release(urpc_keepalive_expired_t *expired)
 {
-    uint64_t check_time = urpc_keepalive_check_time_get() * urpc_get_cpu_hz();
-    uint64_t cur_cpu_cycles = urpc_get_cpu_cycles();
-    struct urpc_list list_head;
-    urpc_list_init(&list_head);
+    // 1. release server channel resource
+    for (uint8_t i = 0; i < expired->server_chid_num; i++) {
+        if (server_manage_channel_put(&expired->key, false, true) == 0) {
+            (void)server_channel_free(expired->server_task_id.server_chid, false);
+        }
+        (void)server_channel_free(expired->server_chid[i], false);
+    }
 
-    urpc_keepalive_task_entry_t *cur = NULL;
-    urpc_keepalive_task_entry_t *next = NULL;
+    // 2. keepalive callback
+    if (expired->server_chid_num != 0) {
+        URPC_LIB_LOG_WARN("keepalive timeout, client chid[%u], server chid[%u], " EID_FMT
+                          ", pid: %u, user info %lu, inactivated for %u seconds\n",
+                          expired->server_task_id.client_chid, expired->server_task_id.server_chid,
+                          EID_ARGS(expired->key.eid), expired->key.pid, expired->info.user_ctx,
+                          expired->info.inactivated_time);
+        urpc_keepalive_callback_get()(URPC_KEEPALIVE_FAILED, expired->info);
+    }
 
-    (void)pthread_rwlock_wrlock(&g_urpc_keepalive_mgmt.lock);
-    URPC_LIST_FOR_EACH_SAFE(cur, next, list, &g_urpc_keepalive_mgmt.reachable_list) {
-        if (cur->has_server == URPC_FALSE) {
-            continue;
+    URPC_LIB_LOG_INFO("keepalive delete logic server successful, client chid[%u], server chid[%u], " EID_FMT
+                      ", pid: %u\n", expired->server_task_id.client_chid, expired->server_task_id.server_chid,
+                      EID_ARGS(expired->key.eid), expired->key.pid);
+}
+
+/* write lock held, walk the buckets due before the second of cur_cpu_cycles. entries refreshed since they were put
+ * in the bucket move to the bucket of their new deadline, the others expire. stop when expired is full, the bucket
+ * in process is walked again next time */
+static uint32_t urpc_keepalive_wheel_expire(
+    uint64_t cur_cpu_cycles, urpc_keepalive_expired_t *expired, uint32_t max_num)
+{
+    uint64_t hz = urpc_get_cpu_hz();
+    uint64_t check_time = urpc_keepalive_check_time_get() * hz;
+    uint64_t cur_sec = cur_cpu_cycles / hz;
+    uint32_t num = 0;
+
+    // buckets have been walked once when the check is late for more than a round
+    if (cur_sec > g_urpc_keepalive_mgmt.wheel_sec &&
+        cur_sec - g_urpc_keepalive_mgmt.wheel_sec > URPC_KEEPALIVE_WHEEL_SIZE) {
+        g_urpc_keepalive_mgmt.wheel_sec = cur_sec - URPC_KEEPALIVE_WHEEL_SIZE;
+    }
+
+    while (g_urpc_keepalive_mgmt.wheel_sec < cur_sec) {
+        urpc_list_t *bucket = &g_urpc_keepalive_mgmt.wheel[g_urpc_keepalive_mgmt.wheel_sec & URPC_KEEPALIVE_WHEEL_MASK];
+        urpc_keepalive_task_entry_t *cur = NULL;
+        urpc_keepalive_task_entry_t *next = NULL;
+        URPC_LIST_FOR_EACH_SAFE(cur, next, list, bucket) {
+            if (URPC_UNLIKELY(cur->has_server == URPC_FALSE)) {
+                urpc_list_remove(&cur->list);
+                continue;
+            }
+
+            uint64_t cpu_cycles = __atomic_load_n(&cur->cpu_cycles, __ATOMIC_ACQUIRE);
+            // 1. current thread cpu cycles is not ahead of entry cpu cycles, or
+            // 2. entry is not timeout
+            if ((cur_cpu_cycles <= cpu_cycles) || ((cur_cpu_cycles - cpu_cycles) < check_time)) {
+                urpc_list_t *due = urpc_keepalive_wheel_bucket(cpu_cycles, check_time, hz);
+                if (due != bucket) {
+                    urpc_list_remove(&cur->list);
+                    urpc_list_push_back(due, &cur->list);
+                }
+                continue;
+            }
+
+            if (num == max_num) {
+                return num;
+            }
+            urpc_list_remove(&cur->list);
+            urpc_keepalive_task_entry_timeout(cur_cpu_cycles, cpu_cycles, cur, &expired[num]);
+            num++;
         }
+        g_urpc_keepalive_mgmt.wheel_sec++;
+    }
 
-        // 1. current thread cpu cycles is not ahead of entry cpu cycles, or
-        // 2. entry is not timeout
-        if ((cur_cpu_cycles <= cur->cpu_cycles) || ((cur_cpu_cycles - cur->cpu_cycles) < check_time)) {
-            break;
-        }
+    return num;
+}
 
-        urpc_list_remove(&cur->list);
-        urpc_list_push_back(&list_head, &cur->list);
-    }
+uint32_t urpc_keepalive_task_timeout(uint64_t cur_cpu_cycles)
+{
+    urpc_keepalive_expired_t expired[URPC_KEEPALIVE_EXPIRE_BATCH];
+    uint32_t total = 0;
+    uint32_t num;
 
-    URPC_LIST_FOR_EACH_SAFE(cur, next, list, &list_head) {
-        urpc_keepalive_task_entry_timeout(cur_cpu_cycles, cur);
-    }
+    do {
+        (void)pthread_rwlock_wrlock(&g_urpc_keepalive_mgmt.lock);
+        num = urpc_keepalive_wheel_expire(cur_cpu_cycles, expired, URPC_KEEPALIVE_EXPIRE_BATCH);
+        (void)pthread_rwlock_unlock(&g_urpc_keepalive_mgmt.lock);
 
-    (void)pthread_rwlock_unlock(&g_urpc_keepalive_mgmt.lock);
+        for (uint32_t i = 0; i < num; i++) {
+            urpc_keepalive_task_expired_release(&expired[i]);
+        }
+        total += num;
+    } while (num == URPC_KEEPALIVE_EXPIRE_BATCH);
+
+    return total;
 }
 
 // move to listen thread
@@ -889,7 +988,7 @@ void urpc_keepalive_check(void *args)
         return;
     }
 
-    urpc_keepalive_task_timeout();
+    (void)urpc_keepalive_task_timeout(urpc_get_cpu_cycles());
 }
 
 int urpc_keepalive_init(urpc_keepalive_config_t *cfg)
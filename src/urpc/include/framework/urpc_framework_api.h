@@ -110,7 +110,8 @@ int urpc_channel_cfg_set(uint32_t urpc_chid, urpc_ccfg_set_t *cfg);
  * (such as queue information, function information), and attempt to establish a connection
  * @param[in] urpc_chid: Channel ID (urpc_chid)
  * @param[in] server: server information (server)
- * @param[in] option: configuration
+ * @param[in] option: configuration, with URPC_CHANNEL_CONN_FLAG_QUEUE_SELECT, queue_select sets how
+ * urpc_func_call selects queues of the channel, it is round robin by default, and takes effect once attach succeeds
  * Return: under the synchronous configuration, return URPC_SUCCESS on success, error code on failure,
  * under the asynchronous configuration, return task id, task id >= 0, task generation successful, otherwise, failure
  * the specific error code is as follows
@@ -380,7 +381,8 @@ int urpc_queue_rx_post(uint64_t urpc_qh, urpc_sge_t *args, uint32_t args_sge_num
 int urpc_func_register(urpc_handler_info_t *info, uint64_t *func_id);
 
 /**
- * Unregister custom function with URPC
+ * Unregister custom function with URPC. Wait until calls of the function running in other threads return,
+ * so it must not be called from a handler
  * @param[in] func_id: Function ID assigned by URPC (func_id)
  * Return URPC_SUCCESS on success, error code on failure, the specific error code is as follows
  * -URPC_ERR_EINVAL: Invalid parameter
@@ -401,7 +403,9 @@ uint64_t urpc_func_id_get(uint32_t urpc_chid, const char *name);
  * Call URPC function
  * @param[in] chid: Channel ID for function call (chid)
  * @param[in] wr: Basic description of call task (wr)
- * @param[in] option: Extended parameters for call task (option)
+ * @param[in] option: Extended parameters for call task (option), with FUNC_CALL_FLAG_TIMEOUT and
+ * FUNC_CALL_FLAG_POLL_TIMEOUT, the timeout is checked by later urpc_func_poll calls of the calling thread instead of
+ * the timer thread, so the calling thread must keep polling until the response or the timeout event
  * Return Request handle (req_h) on success, URPC_U64_FAIL on failure (get error code from errno),
  * the specific errno is as follows
  * URPC_ERR_EINVAL: Invalid parameter
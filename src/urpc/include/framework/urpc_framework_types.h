@@ -446,6 +446,7 @@ typedef struct urpc_call_wr {
 #define FUNC_CALL_FLAG_USER_CTX         (1 << 3)    // enable arg user_ctx when func_call
 #define FUNC_CALL_FLAG_CALL_MODE        (1 << 4)    // enable arg call_mode when func_call
 #define FUNC_CALL_FLAG_FUNC_DEFINED     (1 << 5)    // enable arg func_defined when func_call
+#define FUNC_CALL_FLAG_POLL_TIMEOUT     (1 << 6)    // timeout is checked by urpc_func_poll of the calling thread
 
 #define FUNC_CALL_MODE_EARLY_RSP    (1)         // call mode early_rsp, server will not send urpc rsp to client
 #define FUNC_CALL_MODE_ACK          (1 << 1)    // call mode ack, server should send urpc ack to client
@@ -887,9 +888,18 @@ typedef struct urpc_async_event {
 #define URPC_CHANNEL_CONN_FLAG_CTRL_MSG    (1 << 2) // enable ctrl_msg
 #define URPC_CHANNEL_CONN_FLAG_BIND_LOCAL  (1 << 3) // enable bind local info
 #define URPC_CHANNEL_CONN_FLAG_TIMEOUT     (1 << 4) // enable timeout
+#define URPC_CHANNEL_CONN_FLAG_QUEUE_SELECT (1 << 5) // enable queue select policy, only for attach
 
 #define URPC_CHANNEL_CONN_FEATURE_NONBLOCK (1)
 
+/* how urpc_func_call selects local and remote queue of a channel when queue handle is not given in call option */
+typedef enum urpc_queue_select_policy {
+    URPC_QUEUE_SELECT_RR,           // round robin, by default
+    URPC_QUEUE_SELECT_LEAST_LOAD,   // queue with least requests waiting for response, ties in round robin
+    URPC_QUEUE_SELECT_P2C,          // less loaded one of two random queues
+    URPC_QUEUE_SELECT_MAX,
+} urpc_queue_select_policy_t;
+
 typedef struct urpc_channel_connect_option {
     uint32_t flag;              // flag of the option, indicating which fields are valid
     uint32_t feature;           // connect feature
@@ -897,6 +907,7 @@ typedef struct urpc_channel_connect_option {
     urpc_ctrl_msg_t *ctrl_msg;  // msg transferred in control path
     urpc_host_info_t local;     // bind local
     int timeout;                // timeout duration (in milliseconds, -1 indicates infinite waiting, 0 is invalid)
+    urpc_queue_select_policy_t queue_select;   // queue select policy of the channel
 } urpc_channel_connect_option_t;
 
 typedef enum urpc_channel_queue_type {
@@ -158,6 +158,16 @@ typedef struct umq_ops {
     */
     umq_buf_t* (*umq_tp_dequeue)(uint64_t umqh_tp);
 
+    /**
+    * User should ensure thread safety if io_lock_free is true
+    * Dequeue up to max umq buf in one poll, optional
+    * @param[in] umqh_tp: umq handle
+    * @param[out] bufs: each element is one message, fragments of the message are linked by qbuf_next
+    * @param[in] max: size of bufs, no more than UMQ_BATCH_SIZE
+    * Return count of bufs dequeued, error code on failure
+    */
+    int (*umq_tp_dequeue_burst)(uint64_t umqh_tp, umq_buf_t **bufs, uint32_t max);
+
     /**
     * User should ensure thread safety if io_lock_free is true
     * Notify umq to send buf
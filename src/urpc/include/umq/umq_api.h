@@ -118,6 +118,31 @@ umq_buf_t *umq_buf_alloc(uint32_t request_size, uint32_t request_qbuf_num, uint6
  */
 void umq_buf_free(umq_buf_t *qbuf);
 
+/**
+ * User should ensure thread safety if io_lock_free is true
+ * Alloc num umq bufs into array out instead of one qbuf list, out[i] is the qbuf of one request. if a request
+ * takes more than one qbuf, its qbufs are linked with qbuf_next and the last one ends with NULL.
+ * For the global memory pool, qbufs are taken from thread local cache directly without walking a list twice.
+ * @param[in] umqh: umq handle, use for mode ipc/ubmm, UMQ_INVALID_HANDLE for global memory pool
+ * @param[in] request_size: size of each request, [0, UMQ_MAX_BUF_REQUEST_SIZE]
+ * @param[in] num: count of requests, size of out should not be less than num
+ * @param[in] option: alloc option param, can be NULL
+ * @param[out] out: array of allocated qbufs
+ * Return 0 on success and all requests are allocated, error code on failure and nothing is allocated
+ */
+int umq_buf_alloc_bulk(uint64_t umqh, uint32_t request_size, uint32_t num, umq_alloc_option_t *option,
+    umq_buf_t **out);
+
+/**
+ * User should ensure thread safety if io_lock_free is true
+ * Free an array of umq bufs, each element is one qbuf or qbuf list returned by umq_buf_alloc_bulk, umq_buf_alloc
+ * or umq_dequeue_burst. Consecutive elements from the global memory pool are released to thread local cache as a
+ * whole, consecutive elements of the same umq are linked and released by one call of its transport.
+ * @param[in] bufs: array of qbufs, NULL element is skipped
+ * @param[in] num: count of elements in bufs
+ */
+void umq_buf_free_bulk(umq_buf_t **bufs, uint32_t num);
+
 /**
  * User should ensure thread safety if io_lock_free is true
  * Break and free the qbufs of first batch
@@ -169,6 +194,16 @@ int umq_enqueue(uint64_t umqh, umq_buf_t *qbuf, umq_buf_t **bad_qbuf);
  */
 umq_buf_t *umq_dequeue(uint64_t umqh);
 
+/**
+ * User should ensure thread safety if io_lock_free is true
+ * Dequeue up to max umq buf with one poll of transport, unlike umq_dequeue messages are not merged into one list
+ * @param[in] umqh: umq handle
+ * @param[out] bufs: each element is one message, fragments of the message are linked by qbuf_next
+ * @param[in] max: size of bufs, no more than UMQ_BATCH_SIZE bufs are returned once
+ * Return count of bufs dequeued, 0 if nothing is ready, error code on failure
+ */
+int umq_dequeue_burst(uint64_t umqh, umq_buf_t **bufs, uint32_t max);
+
 /**
  * User should ensure thread safety if io_lock_free is true
  * Notify umq to send buf
@@ -215,6 +250,15 @@ void umq_ack_interrupt(uint64_t umqh, uint32_t nevents, umq_interrupt_option_t *
  */
 void umq_dfx_cmd_process(umq_dfx_cmd_t *cmd, umq_dfx_result_t *result_ctl);
 
+/** Thread safety function
+ * Get latency at quantile from a perf record returned by UMQ_PERF_CMD_GET_RESULT
+ * @param[in] record: perf record of one thread, or perf_record[perf_record_num] merged from all threads
+ * @param[in] type: record type
+ * @param[in] quantile: in [0, 1], e.g. 0.5 for median, 0.9999 for p99.99
+ * Return latency in ns, 0 if no sample is recorded
+ */
+uint64_t umq_perf_quantile_get(const umq_perf_record_t *record, umq_perf_record_type_t type, double quantile);
+
 /**
  * Split the head linked list at the node
  * The new list starts from node and continues to the end of the original list
@@ -52,6 +52,7 @@ typedef enum umq_buf_status {
     UMQ_BUF_FLOW_CONTROL_UPDATE = 128,  /* Umq flow control window is updated, this is not error case */
     UMQ_MEMPOOL_UPDATE_SUCCESS,
     UMQ_MEMPOOL_UPDATE_FAILED,
+    UMQ_BUF_READ_PARTIAL,               /* Chunk of rendezvous message read in pipeline mode, more chunks follow */
 } umq_buf_status_t;
 
 #ifdef __cplusplus
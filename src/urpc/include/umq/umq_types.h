@@ -152,6 +152,8 @@ typedef struct umq_trans_info {
 #define UMQ_FEATURE_ENABLE_STATS            (1 << 2)    // enable stats collection
 #define UMQ_FEATURE_ENABLE_PERF             (1 << 3)    // enable performance collection
 #define UMQ_FEATURE_ENABLE_FLOW_CONTROL     (1 << 4)    // enable flow control
+#define UMQ_FEATURE_ENABLE_LOCK_FREE_QBUF_POOL  (1 << 5)    // global qbuf pool uses lock free stack instead of mutex
+#define UMQ_FEATURE_ENABLE_NUMA_QBUF_POOL       (1 << 6)    // partition qbuf pool by numa node, alloc from local node
 
 typedef struct umq_flow_control_cfg {
     // set when rx >= initial_window at first, [1, rx_depth], otherwise use rx_depth / 2 by default
@@ -160,6 +162,9 @@ typedef struct umq_flow_control_cfg {
     uint16_t notify_interval;
     // use atomic variables as flow control window
     bool use_atomic_window;
+    /* adaptive window grant: pending credits ride on every send to the peer, notify_interval is only the initial
+     * interval of standalone notifications and adapts to consumption, queues sharing one rq get equal shares */
+    bool adaptive;
 } umq_flow_control_cfg_t;
 
 typedef enum umq_buf_block_size {
@@ -177,6 +182,38 @@ typedef struct umq_buf_block_cfg {
     umq_buf_block_size_t small_block_size;
 } umq_buf_block_cfg_t;
 
+typedef enum umq_io_buf_backing {
+    UMQ_IO_BUF_BACKING_NORMAL,          // base pages from memalign
+    UMQ_IO_BUF_BACKING_THP,             // anonymous mapping advised with MADV_HUGEPAGE
+    UMQ_IO_BUF_BACKING_HUGETLB_2M,      // MAP_HUGETLB with 2M pages, fall back to THP if not available
+    UMQ_IO_BUF_BACKING_HUGETLB_1G,      // MAP_HUGETLB with 1G pages, fall back to 2M pages if not available
+
+    UMQ_IO_BUF_BACKING_MAX,
+} umq_io_buf_backing_t;
+
+typedef struct umq_io_buf_cfg {
+    umq_io_buf_backing_t backing;   // applies to default qbuf pool and memory expanded by huge qbuf pools
+    bool prefault;                  // touch all pages in umq_init instead of on first use
+} umq_io_buf_cfg_t;
+
+typedef enum umq_ipc_wait_mode {
+    UMQ_IPC_WAIT_ADAPTIVE,          // spin window is tuned by observed event interval, up to spin_window_us
+    UMQ_IPC_WAIT_FIXED,             // spin for spin_window_us, then sleep
+    UMQ_IPC_WAIT_SLEEP,             // sleep at once, no spin
+    UMQ_IPC_WAIT_MODE_MAX,
+} umq_ipc_wait_mode_t;
+
+#define UMQ_IPC_SPIN_WINDOW_DEFAULT_US (50)
+
+/*
+ * umq_wait_interrupt on ipc queue spins for a while before sleeping on futex,
+ * umq_notify issues FUTEX_WAKE only when the waiter is asleep
+ */
+typedef struct umq_ipc_wait_cfg {
+    umq_ipc_wait_mode_t mode;
+    uint32_t spin_window_us;        // 0 means UMQ_IPC_SPIN_WINDOW_DEFAULT_US
+} umq_ipc_wait_cfg_t;
+
 typedef struct umq_init_cfg {
     umq_buf_mode_t buf_mode;
     uint32_t feature;               // feature flags
@@ -185,6 +222,8 @@ typedef struct umq_init_cfg {
     uint8_t trans_info_num;
     umq_flow_control_cfg_t flow_control; // used when UMQ_FEATURE_ENABLE_FLOW_CONTROL is set
     umq_buf_block_cfg_t block_cfg;
+    umq_io_buf_cfg_t io_buf_cfg;
+    umq_ipc_wait_cfg_t ipc_wait_cfg; // used by interrupt mode of ipc queue
     uint16_t cna;
     uint32_t ubmm_eid;
     umq_trans_info_t trans_info[MAX_UMQ_TRANS_INFO_NUM];
@@ -200,6 +239,56 @@ typedef struct umq_init_cfg {
 #define UMQ_CREATE_FLAG_SHARE_RQ            (1 << 5)        // enable arg share_rq_umqh when create umq
 #define UMQ_CREATE_FLAG_UMQ_CTX             (1 << 6)        // enable arg umq_ctx when create umq
 #define UMQ_CREATE_FLAG_SUB_UMQ             (1 << 7)        // just indicates the umq is sub queue
+#define UMQ_CREATE_FLAG_READ_PIPELINE       (1 << 8)        // enable arg read_pipeline when create umq
+
+/*
+ * rendezvous message of ub plus mode is pulled by receiver with one urma read for each buffer of sender.
+ * by default all reads are posted at once into buffers allocated for the whole message, and the message is
+ * reported after the last read is done. in pipeline mode at most window reads are in flight, buffer of each chunk
+ * is allocated when its read is posted. with partial_deliver, every chunk is reported once it lands, chunks before
+ * the last one come with status UMQ_BUF_READ_PARTIAL, so that application can consume and free them early
+ */
+typedef struct umq_read_pipeline_cfg {
+    uint32_t window;                // reads in flight for one message, [1, tx_depth]
+    bool partial_deliver;
+} umq_read_pipeline_cfg_t;
+
+#define UMQ_CREATE_FLAG_EAGER_THRESH        (1 << 9)        // enable arg eager_thresh when create umq
+
+/*
+ * message of ub plus mode no larger than eager threshold is sent in place, larger one is pulled by receiver
+ * (rendezvous). eager threshold never exceeds rx buf size of remote. in adaptive modes, completion latency of both
+ * paths is sampled online for each size class, and the threshold is moved one class at a time to where the
+ * faster path changes. a few messages around the threshold are sent on the other path to keep estimates fresh
+ */
+typedef enum umq_eager_thresh_mode {
+    UMQ_EAGER_THRESH_FIXED,             // threshold never changes, default mode
+    UMQ_EAGER_THRESH_ADAPTIVE_MEAN,     // threshold minimizes mean completion latency
+    UMQ_EAGER_THRESH_ADAPTIVE_TAIL,     // threshold minimizes p99 completion latency
+    UMQ_EAGER_THRESH_MODE_MAX,
+} umq_eager_thresh_mode_t;
+
+typedef struct umq_eager_thresh_cfg {
+    umq_eager_thresh_mode_t mode;
+    uint32_t thresh;                    // threshold of fixed mode or initial one of adaptive modes, 0 for remote rx
+                                        // buf size
+} umq_eager_thresh_cfg_t;
+
+#define UMQ_CREATE_FLAG_RX_POOL             (1 << 10)       // enable arg rx_pool when create umq
+
+/*
+ * by default every queue of base api posts rx_depth receive buffers when it is bound, and posts a new one for each
+ * buffer consumed. with rx pool, receive buffers of the jfr, which is shared by queues created with share_rq_umqh,
+ * are managed as a whole: only high_watermark buffers are posted no matter how many queues are bound, once posted
+ * falls below low_watermark they are refilled up to high_watermark in one batch, and an alarm is raised when posted
+ * falls to alarm_watermark. high_watermark doubles on every alarm and decays back to the configured one while
+ * traffic stays below it. set on the queue owning the jfr, queues sharing its rq follow it. base api only
+ */
+typedef struct umq_rx_pool_cfg {
+    uint32_t high_watermark;        // [min(64, rx_depth), rx_depth], 0 for rx_depth / 8 and no less than the minimum
+    uint32_t low_watermark;         // (alarm_watermark, high_watermark), 0 for high_watermark / 2
+    uint32_t alarm_watermark;       // [1, low_watermark), 0 for low_watermark / 4
+} umq_rx_pool_cfg_t;
 
 typedef struct umq_create_option {
     /*************Required paramenters start*****************/
@@ -211,6 +300,8 @@ typedef struct umq_create_option {
     /*************Required paramenters end*******************/
     /*************Optional paramenters start*****************/
     uint32_t rx_buf_size;
+    /* for ipc, the shared pool holds tx_depth messages of tx_buf_size, it is clamped to stay under 2GB, with
+     * at least one small buf per message, larger messages may then fail to allocate while the pool is busy */
     uint32_t tx_buf_size;
     uint32_t rx_depth;
     uint32_t tx_depth;
@@ -218,6 +309,9 @@ typedef struct umq_create_option {
     uint64_t umq_ctx;
 
     umq_queue_mode_t mode;      // mode of queue, QUEUE_MODE_POLLING for default
+    umq_read_pipeline_cfg_t read_pipeline;  // only valid for ub plus mode
+    umq_eager_thresh_cfg_t eager_thresh;    // only valid for ub plus mode
+    umq_rx_pool_cfg_t rx_pool;              // only valid for ub and ub plus mode
     /*************Optional paramenters end*******************/
 } umq_create_option_t;
 
@@ -286,11 +380,17 @@ typedef struct umq_flow_control_stats {
     uint64_t total_remote_rx_consumed;
     uint64_t total_remote_rx_received_error;
     uint64_t total_flow_controlled_wr;
+    uint64_t notify_interval;                   // current interval of standalone notifications
+    uint64_t total_local_rx_notify_standalone;  // notifications sent without user data, adaptive mode only
+    uint64_t total_local_rx_notify_starved;     // notifications sent after the peer ran out of window
 } umq_flow_control_stats_t;
 
 typedef enum umq_dfx_module_id {
     UMQ_DFX_MODULE_PERF,
     UMQ_DFX_MODULE_STATS,
+    UMQ_DFX_MODULE_QBUF_POOL,
+    UMQ_DFX_MODULE_IPC_WAKEUP,
+    UMQ_DFX_MODULE_EAGER_THRESH,
     UMQ_DFX_MODULE_MAX
 } umq_dfx_module_id_t;
 
@@ -310,6 +410,24 @@ typedef enum umq_stats_cmd_id {
     UMQ_STATS_CMD_MAX
 } umq_stats_cmd_id_t;
 
+typedef enum umq_qbuf_pool_cmd_id {
+    UMQ_QBUF_POOL_CMD_CLEAR,
+    UMQ_QBUF_POOL_CMD_GET_RESULT,
+    UMQ_QBUF_POOL_CMD_MAX
+} umq_qbuf_pool_cmd_id_t;
+
+typedef enum umq_ipc_wakeup_cmd_id {
+    UMQ_IPC_WAKEUP_CMD_CLEAR,
+    UMQ_IPC_WAKEUP_CMD_GET_RESULT,
+    UMQ_IPC_WAKEUP_CMD_MAX
+} umq_ipc_wakeup_cmd_id_t;
+
+typedef enum umq_eager_thresh_cmd_id {
+    UMQ_EAGER_THRESH_CMD_CLEAR,
+    UMQ_EAGER_THRESH_CMD_GET_RESULT,
+    UMQ_EAGER_THRESH_CMD_MAX
+} umq_eager_thresh_cmd_id_t;
+
 typedef enum umq_stats_type {
     UMQ_STATS_TYPE_SEND,                   // send cnt
     UMQ_STATS_TYPE_RECEIVE,                // recv cnt
@@ -362,6 +480,69 @@ typedef struct umq_stats_infos {
     umq_stats_info_instance_t stats_info[0];
 } umq_stats_infos_t;
 
+typedef enum umq_qbuf_pool_kind {
+    UMQ_QBUF_POOL_KIND_SMALL,              // global pool of small qbuf
+    UMQ_QBUF_POOL_KIND_SHM,                // global pools of shared memory qbuf, accumulated over all queues
+    UMQ_QBUF_POOL_KIND_HUGE,               // global pools of middle, big and huge qbuf
+    UMQ_QBUF_POOL_KIND_MAX,
+} umq_qbuf_pool_kind_t;
+
+typedef struct umq_qbuf_pool_contention_stats {
+    uint64_t fetch_cnt;                    // count of batches fetched from global pool
+    uint64_t return_cnt;                   // count of batches returned to global pool
+    uint64_t empty_cnt;                    // count of fetch failed because global pool is empty
+    uint64_t contention_cnt;               // count of mutex found held, or cas retried in lock free mode
+} umq_qbuf_pool_contention_stats_t;
+
+typedef struct umq_qbuf_pool_stats_infos {
+    bool lock_free;
+    umq_qbuf_pool_contention_stats_t stats[UMQ_QBUF_POOL_KIND_MAX];
+} umq_qbuf_pool_stats_infos_t;
+
+typedef struct umq_ipc_wakeup_stats {
+    uint64_t wait_cnt;                     // count of wait calls
+    uint64_t spin_hit_cnt;                 // count of events found within spin window, no syscall taken
+    uint64_t sleep_cnt;                    // count of waiters went to sleep on futex
+    uint64_t timeout_cnt;                  // count of waits returned without event
+    uint64_t spin_ns;                      // total time spent spinning
+    uint64_t wake_cnt;                     // count of FUTEX_WAKE issued by notify
+    uint64_t wake_skip_cnt;                // count of notify without FUTEX_WAKE because no waiter was asleep
+    uint64_t spin_window_ns;               // spin window tuned by last wait
+} umq_ipc_wakeup_stats_t;
+
+/* size class i holds messages in (2^(i+9), 2^(i+10)] bytes, class 0 holds messages up to 1KB, the last class holds
+ * all messages above 1GB */
+#define UMQ_EAGER_THRESH_CLASS_NUM (22u)
+
+typedef struct umq_eager_thresh_stats {
+    umq_eager_thresh_mode_t mode;
+    uint32_t thresh;                       // messages larger than thresh are sent by rendezvous
+    uint64_t eager_cnt;                    // count of messages sent in place
+    uint64_t rndv_cnt;                     // count of messages pulled by receiver
+    uint64_t probe_cnt;                    // count of messages sent on the other path to refresh estimate
+    uint64_t thresh_update_cnt;            // count of threshold moves
+    uint64_t eager_lat_ns[UMQ_EAGER_THRESH_CLASS_NUM];   // latency estimate of each size class, 0 if not sampled
+    uint64_t rndv_lat_ns[UMQ_EAGER_THRESH_CLASS_NUM];    // mean or p99 according to mode
+} umq_eager_thresh_stats_t;
+
+typedef struct umq_rx_pool_stats {
+    uint32_t rx_depth;
+    uint32_t posted;                    // receive buffers posted on the jfr now
+    uint32_t high_watermark;            // current watermarks, grow under load
+    uint32_t low_watermark;
+    uint32_t alarm_watermark;
+    uint32_t queue_num;                 // bound queues receiving from the jfr
+    uint64_t refill_cnt;
+    uint64_t refill_buf_cnt;
+    uint64_t refill_fail_cnt;           // refills stopped by buffer allocation or post failure
+    uint64_t alarm_cnt;                 // posted fell to alarm watermark
+    uint64_t exhausted_cnt;             // posted fell to 0, senders may get receiver not ready
+    uint64_t refill_lat_p50_ns;         // from posted falling below low watermark to the end of refill
+    uint64_t refill_lat_p99_ns;
+    uint64_t refill_lat_max_ns;
+    uint64_t saved_bytes_per_queue;     // rx buffer memory each bound queue saves against rx_depth buffers per queue
+} umq_rx_pool_stats_t;
+
 #define UMQ_PERF_QUANTILE_MAX_NUM (8u)
 
 typedef enum umq_perf_record_type {
@@ -414,15 +595,21 @@ typedef enum umq_perf_record_type {
     UMQ_PERF_RECORD_TYPE_MAX,
 } umq_perf_record_type_t;
 
+/* log-linear latency histogram, values below 64ns have one bucket each, every power of two above is split into
+ * 32 sub buckets, up to 2^36ns. use umq_perf_quantile_get to read any quantile within 1.6% precision */
+#define UMQ_PERF_HIST_BUCKET_NUM (1024u)
+
 typedef struct umq_perf_record {
     struct {
-        uint64_t accumulation;
-        uint64_t min;
-        uint64_t max;
+        uint64_t accumulation;                      // in ns
+        uint64_t min;                               // in ns
+        uint64_t max;                               // in ns
         uint64_t cnt;
         uint64_t bucket[UMQ_PERF_QUANTILE_MAX_NUM + 1];
     } type_record[UMQ_PERF_RECORD_TYPE_MAX];
     bool is_used;
+    // appended after the fields above to keep their layout, read by umq_perf_quantile_get
+    uint64_t hist[UMQ_PERF_RECORD_TYPE_MAX][UMQ_PERF_HIST_BUCKET_NUM];
 } umq_perf_record_t;
 
 typedef struct perf_in_param {
@@ -433,6 +620,8 @@ typedef struct perf_in_param {
 
 typedef struct umq_perf_infos {
     uint32_t perf_record_num;
+    /* record of each running thread, followed by perf_record[perf_record_num] which is merged from all threads,
+     * including the exited ones */
     umq_perf_record_t *perf_record[0];
 } umq_perf_infos_t;
 
@@ -441,9 +630,13 @@ typedef struct umq_dfx_cmd {
     union {
         umq_perf_cmd_id_t perf_cmd_id;
         umq_stats_cmd_id_t stats_cmd_id;
+        umq_qbuf_pool_cmd_id_t qbuf_pool_cmd_id;
+        umq_ipc_wakeup_cmd_id_t ipc_wakeup_cmd_id;
+        umq_eager_thresh_cmd_id_t eager_thresh_cmd_id;
     };
     union {
         perf_in_param_t perf_in_param;
+        uint64_t umqh;                      // queue to query for eager thresh module
     };
 } umq_dfx_cmd_t;
 
@@ -452,12 +645,18 @@ typedef struct umq_dfx_result {
     union {
         umq_perf_cmd_id_t perf_cmd_id;
         umq_stats_cmd_id_t stats_cmd_id;
+        umq_qbuf_pool_cmd_id_t qbuf_pool_cmd_id;
+        umq_ipc_wakeup_cmd_id_t ipc_wakeup_cmd_id;
+        umq_eager_thresh_cmd_id_t eager_thresh_cmd_id;
     };
     int err_code;
     union {
         char *perf_char;
         umq_perf_infos_t *perf_out_param;
         umq_stats_infos_t *stats_out_param;
+        umq_qbuf_pool_stats_infos_t *qbuf_pool_out_param;
+        umq_ipc_wakeup_stats_t *ipc_wakeup_out_param;
+        umq_eager_thresh_stats_t *eager_thresh_out_param;
     };
 } umq_dfx_result_t;
 
@@ -515,6 +714,9 @@ typedef struct umq_route_list {
 
 typedef enum umq_user_ctl_opcode {
     UMQ_OPCODE_FLOW_CONTROL_STATS_QUERY = 0,
+    UMQ_OPCODE_EAGER_THRESH_STATS_QUERY,        // out is umq_eager_thresh_stats_t
+    UMQ_OPCODE_EAGER_THRESH_STATS_CLEAR,        // no output, clear decision counters
+    UMQ_OPCODE_RX_POOL_STATS_QUERY,             // out is umq_rx_pool_stats_t
 
     UMQ_OPCODE_MAX,
 } umq_user_ctl_opcode_t;
@@ -536,8 +738,18 @@ typedef enum umq_mempool_import_state {
     MEMPOOL_STATE_IMPORTED,          // the remote side has imported the memory from the memory pool
 } mempool_import_state_t;
 
+#define UMQ_MEMPOOL_NUMA_NODE_MAX (8)
+
+typedef struct umq_mempool_numa_state {
+    uint32_t node_id;
+    uint64_t total_cnt;             // qbufs with data homed on this node
+    uint64_t free_cnt;              // qbufs with data in global pool of this node, thread caches excluded
+} umq_mempool_numa_state_t;
+
 typedef struct umq_mempool_state {
     mempool_import_state_t import_state;
+    uint32_t numa_node_num;         // 0 if mempool is not partitioned by numa node
+    umq_mempool_numa_state_t numa_state[UMQ_MEMPOOL_NUMA_NODE_MAX];
 } umq_mempool_state_t;
 
 #define UMQ_MAX_EID_CNT 64
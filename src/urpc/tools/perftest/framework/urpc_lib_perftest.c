@@ -20,9 +20,12 @@
 #include "urpc_framework_errno.h"
 
 #include "urpc_lib_perftest_allocator.h"
+#include "urpc_lib_perftest_crypto.h"
+#include "urpc_lib_perftest_default_alloc.h"
 #include "urpc_lib_perftest_latency.h"
 #include "urpc_lib_perftest_param.h"
 #include "urpc_lib_perftest_qps.h"
+#include "urpc_lib_perftest_queue_select.h"
 #include "urpc_lib_perftest_util.h"
 
 #define URPC_PERFTEST_DEPTH_MARGIN 8
@@ -994,6 +997,20 @@ int main(int argc, char *argv[])
     if (urpc_perftest_parse_arguments(argc, argv, &cfg) != 0) {
         return -1;
     }
+    if (cfg.case_type == PERFTEST_CASE_CRYPTO) {
+        return urpc_perftest_run_crypto(&cfg);
+    }
+    if (cfg.case_type == PERFTEST_CASE_QUEUE_SELECT) {
+        return urpc_perftest_run_queue_select(&cfg);
+    }
+    if (cfg.case_type == PERFTEST_CASE_DEFAULT_ALLOC) {
+        if (urpc_perftest_server_client_init(&cfg) != 0) {
+            return -1;
+        }
+        int alloc_ret = urpc_perftest_run_default_alloc(&cfg);
+        urpc_uninit();
+        return alloc_ret;
+    }
     (void)urpc_ctrl_msg_cb_register(ctrl_msg_callback);
     int ret;
     if (cfg.instance_mode == SERVER) {
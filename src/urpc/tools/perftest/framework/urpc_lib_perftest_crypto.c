@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: urpc lib perftest crypto test case, local per message encryption cost
+ * Create: 2026-01-12
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "crypto.h"
+#include "perftest_util.h"
+#include "protocol_utils.h"
+#include "urpc_util.h"
+
+#include "urpc_lib_perftest_crypto.h"
+
+#define CRYPTO_PERFTEST_MIN_SIZE        (64)
+#define CRYPTO_PERFTEST_MAX_SIZE        (64 * 1024)
+#define CRYPTO_PERFTEST_BYTES           (256 * 1024 * 1024)     // bytes encrypted by each thread for each size
+#define CRYPTO_PERFTEST_MAX_ROUND       (200000)
+#define CRYPTO_PERFTEST_MAX_THREAD      (64)
+
+typedef enum crypto_perftest_mode {
+    CRYPTO_PERFTEST_PER_MSG_CTX,        // new ctx and key setup for each message, as before ctx cache
+    CRYPTO_PERFTEST_CACHED_CTX,         // per thread keyed ctx, only iv is set for each message
+    CRYPTO_PERFTEST_COPIED_CTX,         // crypto_encrypt_ctx_init, caller owned copy of the keyed ctx
+    CRYPTO_PERFTEST_MODE_MAX
+} crypto_perftest_mode_t;
+
+static const char *g_crypto_perftest_mode_name[CRYPTO_PERFTEST_MODE_MAX] = {
+    "per msg ctx",
+    "cached ctx",
+    "copied ctx",
+};
+
+typedef struct crypto_perftest_arg {
+    pthread_t thread;
+    urpc_cipher_t *cipher_opt;
+    pthread_barrier_t *barrier;
+    crypto_perftest_mode_t mode;
+    uint32_t size;
+    uint32_t round;
+    uint64_t cost_ns;
+    int ret;
+} crypto_perftest_arg_t;
+
+static EVP_CIPHER_CTX *crypto_perftest_per_msg_ctx(urpc_cipher_t *cipher_opt, unsigned char *iv)
+{
+    EVP_CIPHER_CTX *ctx = EVP_CIPHER_CTX_new();
+    if (ctx == NULL) {
+        return NULL;
+    }
+
+    uint64_t counter = atomic_fetch_add(&cipher_opt->counter, 1);
+    memcpy(iv, &cipher_opt->chid, sizeof(uint32_t));
+    memcpy(iv + sizeof(uint32_t), &counter, sizeof(uint64_t));
+    if (EVP_EncryptInit_ex(ctx, cipher_opt->cipher, NULL, cipher_opt->crypto_key.key, iv) == 0) {
+        EVP_CIPHER_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+static int crypto_perftest_encrypt(crypto_perftest_arg_t *arg, unsigned char *buf)
+{
+    unsigned char iv[URPC_AES_IV_LEN];
+    unsigned char tag[URPC_AES_TAG_LEN];
+    EVP_CIPHER_CTX *ctx;
+    if (arg->mode == CRYPTO_PERFTEST_CACHED_CTX) {
+        ctx = crypto_encrypt_ctx_get(arg->cipher_opt, iv);
+    } else if (arg->mode == CRYPTO_PERFTEST_COPIED_CTX) {
+        ctx = crypto_encrypt_ctx_init(arg->cipher_opt, iv, URPC_AES_IV_LEN);
+    } else {
+        ctx = crypto_perftest_per_msg_ctx(arg->cipher_opt, iv);
+    }
+    if (ctx == NULL) {
+        return -1;
+    }
+
+    int out_len = 0;
+    int ret = 0;
+    if (EVP_EncryptUpdate(ctx, buf, &out_len, buf, (int)arg->size) != 1 ||
+        EVP_EncryptFinal_ex(ctx, buf + out_len, &out_len) != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, URPC_AES_TAG_LEN, tag) != 1) {
+        ret = -1;
+    }
+
+    if (arg->mode != CRYPTO_PERFTEST_CACHED_CTX) {
+        EVP_CIPHER_CTX_free(ctx);
+    }
+    return ret;
+}
+
+static void *crypto_perftest_thread(void *data)
+{
+    crypto_perftest_arg_t *arg = (crypto_perftest_arg_t *)data;
+    unsigned char *buf = (unsigned char *)calloc(1, CRYPTO_PERFTEST_MAX_SIZE);
+    if (buf == NULL) {
+        arg->ret = -1;
+    }
+
+    (void)pthread_barrier_wait(arg->barrier);
+    uint64_t begin = get_timestamp_ns();
+    for (uint32_t i = 0; i < arg->round && arg->ret == 0 && !is_perftest_force_quit(); i++) {
+        arg->ret = crypto_perftest_encrypt(arg, buf);
+    }
+    arg->cost_ns = get_timestamp_ns() - begin;
+
+    free(buf);
+    return NULL;
+}
+
+static int crypto_perftest_run_mode(
+    perftest_framework_config_t *cfg, urpc_cipher_t *cipher_opt, crypto_perftest_arg_t *args, uint32_t size,
+    crypto_perftest_mode_t mode, double *ns_per_msg)
+{
+    pthread_barrier_t barrier;
+    if (pthread_barrier_init(&barrier, NULL, cfg->thread_num) != 0) {
+        LOG_PRINT("barrier init failed\n");
+        return -1;
+    }
+
+    uint32_t round = CRYPTO_PERFTEST_BYTES / size;
+    round = round > CRYPTO_PERFTEST_MAX_ROUND ? CRYPTO_PERFTEST_MAX_ROUND : round;
+    uint32_t created = 0;
+    int ret = 0;
+    for (; created < cfg->thread_num; created++) {
+        crypto_perftest_arg_t *arg = &args[created];
+        memset(arg, 0, sizeof(crypto_perftest_arg_t));
+        arg->cipher_opt = cipher_opt;
+        arg->barrier = &barrier;
+        arg->mode = mode;
+        arg->size = size;
+        arg->round = round;
+        if (pthread_create(&arg->thread, NULL, crypto_perftest_thread, arg) != 0) {
+            LOG_PRINT("create crypto test thread failed\n");
+            ret = -1;
+            break;
+        }
+    }
+    // threads left waiting on barrier are never released, nothing more can be done here
+    if (ret != 0) {
+        return ret;
+    }
+
+    uint64_t max_cost = 0;
+    for (uint32_t i = 0; i < created; i++) {
+        (void)pthread_join(args[i].thread, NULL);
+        ret = args[i].ret != 0 ? args[i].ret : ret;
+        max_cost = args[i].cost_ns > max_cost ? args[i].cost_ns : max_cost;
+    }
+    (void)pthread_barrier_destroy(&barrier);
+    *ns_per_msg = (double)max_cost / round;
+    return ret;
+}
+
+int urpc_perftest_run_crypto(perftest_framework_config_t *cfg)
+{
+    if (cfg->thread_num == 0 || cfg->thread_num > CRYPTO_PERFTEST_MAX_THREAD) {
+        LOG_PRINT("thread num %u invalid, crypto test supports 1 to %u threads\n", cfg->thread_num,
+            CRYPTO_PERFTEST_MAX_THREAD);
+        return -1;
+    }
+
+    crypto_key_t crypto_key;
+    urpc_cipher_t cipher_opt = {0};
+    if (crypto_ssl_gen_crypto_key(&crypto_key) != 0 || crypto_cipher_init(&cipher_opt, &crypto_key) != 0) {
+        LOG_PRINT("cipher init failed\n");
+        return -1;
+    }
+    cipher_opt.chid = crypto_gen_rand_channel_id(0);
+
+    crypto_perftest_arg_t *args = (crypto_perftest_arg_t *)calloc(cfg->thread_num, sizeof(crypto_perftest_arg_t));
+    if (args == NULL) {
+        crypto_cipher_uninit(&cipher_opt);
+        return -1;
+    }
+
+    int ret = 0;
+    (void)printf("%-10s", "size(B)");
+    for (uint32_t mode = 0; mode < CRYPTO_PERFTEST_MODE_MAX; mode++) {
+        (void)printf("%-24s", g_crypto_perftest_mode_name[mode]);
+    }
+    (void)printf("%s\n", "saved by cached ctx");
+    for (uint32_t size = CRYPTO_PERFTEST_MIN_SIZE; size <= CRYPTO_PERFTEST_MAX_SIZE && ret == 0; size <<= 1) {
+        double ns_per_msg[CRYPTO_PERFTEST_MODE_MAX] = {0};
+        for (uint32_t mode = 0; mode < CRYPTO_PERFTEST_MODE_MAX && ret == 0; mode++) {
+            ret = crypto_perftest_run_mode(cfg, &cipher_opt, args, size, (crypto_perftest_mode_t)mode,
+                &ns_per_msg[mode]);
+        }
+        if (ret != 0) {
+            LOG_PRINT("crypto test failed, size %u\n", size);
+            break;
+        }
+
+        (void)printf("%-10u", size);
+        for (uint32_t mode = 0; mode < CRYPTO_PERFTEST_MODE_MAX; mode++) {
+            (void)printf("%-12.1f%-12s", ns_per_msg[mode], "ns/msg");
+        }
+        (void)printf("%.1f%%\n", (ns_per_msg[CRYPTO_PERFTEST_PER_MSG_CTX] - ns_per_msg[CRYPTO_PERFTEST_CACHED_CTX]) *
+            100.0 / ns_per_msg[CRYPTO_PERFTEST_PER_MSG_CTX]);
+    }
+
+    free(args);
+    crypto_cipher_uninit(&cipher_opt);
+    return ret;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: urpc lib perftest crypto test case, local per message encryption cost
+ * Create: 2026-01-12
+ */
+
+#ifndef URPC_LIB_PERFTEST_CRYPTO_H
+#define URPC_LIB_PERFTEST_CRYPTO_H
+
+#include "urpc_lib_perftest_param.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* encrypt messages of 64B to 64KB on thread_num threads sharing one cipher, as a channel does, and print the
+ * cost of one message with a cipher ctx set up per message and with the per thread cached ctx */
+int urpc_perftest_run_crypto(perftest_framework_config_t *cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // URPC_LIB_PERFTEST_CRYPTO_H
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: urpc lib perftest default allocator test case, get/put cost per request
+ * Create: 2026-10-17
+ */
+
+#include "allocator.h"
+#include "perftest_util.h"
+#include "urpc_framework_errno.h"
+#include "urpc_util.h"
+
+#include "urpc_lib_perftest_default_alloc.h"
+
+#define DEFAULT_ALLOC_PERFTEST_MIN_SIZE     (4UL << 10)
+#define DEFAULT_ALLOC_PERFTEST_MAX_SIZE     (8UL << 20)
+#define DEFAULT_ALLOC_PERFTEST_ROUND        (1000)
+
+typedef enum default_alloc_perftest_buf {
+    DEFAULT_ALLOC_PERFTEST_BUF_SMALL,       // DEFAULT_SGE_SIZE buffers
+    DEFAULT_ALLOC_PERFTEST_BUF_LARGE,       // DEFAULT_LARGE_SGE_MAX_SIZE buffers
+    DEFAULT_ALLOC_PERFTEST_BUF_MAX
+} default_alloc_perftest_buf_t;
+
+// cost of one get/put pair in ns, -1 if the allocator rejects the request size
+static double default_alloc_perftest_run_size(urpc_allocator_t *allocator, uint64_t size,
+    urpc_allocator_option_t *option)
+{
+    urpc_sge_t *sge;
+    uint32_t num;
+    if (allocator->get(&sge, &num, size, option) != URPC_SUCCESS) {
+        return -1;
+    }
+    (void)allocator->put(sge, num, option);
+
+    uint64_t begin = get_timestamp_ns();
+    for (uint32_t i = 0; i < DEFAULT_ALLOC_PERFTEST_ROUND; i++) {
+        if (allocator->get(&sge, &num, size, option) != URPC_SUCCESS) {
+            LOG_PRINT("get %lu bytes failed in round %u\n", size, i);
+            return -1;
+        }
+        (void)allocator->put(sge, num, option);
+    }
+    return (double)(get_timestamp_ns() - begin) / DEFAULT_ALLOC_PERFTEST_ROUND;
+}
+
+int urpc_perftest_run_default_alloc(perftest_framework_config_t *cfg)
+{
+    (void)cfg;
+    default_allocator_cfg_t alloc_cfg = {
+        .need_large_sge = true,
+        .large_sge_size = DEFAULT_LARGE_SGE_MAX_SIZE,
+    };
+    if (urpc_default_allocator_init(&alloc_cfg) != URPC_SUCCESS) {
+        LOG_PRINT("default allocator init failed\n");
+        return -1;
+    }
+
+    urpc_allocator_t *allocator = default_allocator_get();
+    urpc_allocator_option_t option[DEFAULT_ALLOC_PERFTEST_BUF_MAX] = {
+        [DEFAULT_ALLOC_PERFTEST_BUF_SMALL] = {.qcustom_flag = 0},
+        [DEFAULT_ALLOC_PERFTEST_BUF_LARGE] = {.qcustom_flag = QALLOCA_LARGE_SIZE_FLAG},
+    };
+    (void)printf("%-12s%-24s%s\n", "size(KB)", "128B buffers(ns/req)", "8KB buffers(ns/req)");
+    for (uint64_t size = DEFAULT_ALLOC_PERFTEST_MIN_SIZE; size <= DEFAULT_ALLOC_PERFTEST_MAX_SIZE; size <<= 1) {
+        (void)printf("%-12lu", size >> 10);
+        for (uint32_t buf = 0; buf < DEFAULT_ALLOC_PERFTEST_BUF_MAX; buf++) {
+            double cost = default_alloc_perftest_run_size(allocator, size, &option[buf]);
+            if (cost < 0) {
+                (void)printf("%-24s", "fail");
+            } else {
+                (void)printf("%-24.1f", cost);
+            }
+        }
+        (void)printf("\n");
+    }
+
+    urpc_default_allocator_uninit();
+    return 0;
+}
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: urpc lib perftest default allocator test case, get/put cost per request
+ * Create: 2026-10-17
+ */
+
+#ifndef URPC_LIB_PERFTEST_DEFAULT_ALLOC_H
+#define URPC_LIB_PERFTEST_DEFAULT_ALLOC_H
+
+#include "urpc_lib_perftest_param.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* get and put requests of 4KB to 8MB through the default allocator, in its buffers of 128B and of 8KB, and print
+ * the cost of one get/put pair. urpc must be initialized, as memory of the allocator is registered to the device */
+int urpc_perftest_run_default_alloc(perftest_framework_config_t *cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // URPC_LIB_PERFTEST_DEFAULT_ALLOC_H
@@ -57,6 +57,12 @@ static void usage(void)
     (void)printf("  -c, --test-case <case index>        test case to be performed(default: 0)\n");
     (void)printf("                                      0: test urpc latency(default)\n");
     (void)printf("                                      1: test urpc qps\n");
+    (void)printf("                                      3: test encryption cost per message of 64B to 64KB "
+                 "locally, on -n threads\n");
+    (void)printf("                                      4: test request latency of queue select policies with one "
+                 "slow remote queue, simulated locally\n");
+    (void)printf("                                      5: test default allocator get/put cost per request of 4KB "
+                 "to 8MB locally, urpc is initialized with -d or local ip\n");
     (void)printf("      --server                        to launch server.\n");
     (void)printf("      --client                        to launch client.\n");
     (void)printf("      --hw-offload                    set URPC_FEATURE_HWUB_OFFLOAD, default not set\n");
@@ -159,7 +165,7 @@ int urpc_perftest_parse_arguments(int argc, char **argv, perftest_framework_conf
                 break;
             case 'c':
                 cfg->case_type = (uint32_t)strtoul(optarg, NULL, 0);
-                if (cfg->case_type >= PERFTEST_CASE_MAX) {
+                if (cfg->case_type == PERFTEST_CASE_BUF || cfg->case_type >= PERFTEST_CASE_MAX) {
                     LOG_PRINT("get case_type %d failed\n", (int)cfg->case_type);
                     return -1;
                 }
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: urpc lib perftest queue select test case, request latency with one slow remote queue
+ * Create: 2026-01-16
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "channel.h"
+#include "perftest_util.h"
+#include "urpc_dbuf_stat.h"
+#include "util_epoch.h"
+
+#include "urpc_lib_perftest_queue_select.h"
+
+#define QSEL_PERFTEST_QUEUE_NUM         (4)
+#define QSEL_PERFTEST_REQ_NUM           (500000)
+#define QSEL_PERFTEST_SERVICE_NS        (10000)     // service time of one request on a normal queue
+#define QSEL_PERFTEST_SLOW_FACTOR       (2)         // queue 0 serves this times slower
+#define QSEL_PERFTEST_LOAD_PERCENT      (50)        // arrival rate to total service rate of the queues
+#define QSEL_PERFTEST_SEED              (0x2545f491)
+
+static const char *g_qsel_perftest_policy_name[URPC_QUEUE_SELECT_MAX] = {
+    "round robin",
+    "least load",
+    "power of two",
+};
+
+typedef struct qsel_perftest_done {
+    uint64_t time;
+    uint32_t slot;
+} qsel_perftest_done_t;
+
+typedef struct qsel_perftest_ctx {
+    urpc_channel_info_t channel;
+    queue_t queue[QSEL_PERFTEST_QUEUE_NUM];
+    queue_node_t node[QSEL_PERFTEST_QUEUE_NUM];
+    uint64_t free_at[QSEL_PERFTEST_QUEUE_NUM];     // virtual time the queue finishes its backlog
+    qsel_perftest_done_t *heap;                     // requests in flight, by time of response
+    uint32_t heap_num;
+    uint64_t *latency;
+    uint32_t seed;
+} qsel_perftest_ctx_t;
+
+static void qsel_perftest_heap_push(qsel_perftest_ctx_t *ctx, qsel_perftest_done_t done)
+{
+    uint32_t i = ctx->heap_num++;
+    while (i > 0 && ctx->heap[(i - 1) / 2].time > done.time) {
+        ctx->heap[i] = ctx->heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    ctx->heap[i] = done;
+}
+
+static qsel_perftest_done_t qsel_perftest_heap_pop(qsel_perftest_ctx_t *ctx)
+{
+    qsel_perftest_done_t top = ctx->heap[0];
+    qsel_perftest_done_t last = ctx->heap[--ctx->heap_num];
+    uint32_t i = 0;
+    while (2 * i + 1 < ctx->heap_num) {
+        uint32_t child = 2 * i + 1;
+        if (child + 1 < ctx->heap_num && ctx->heap[child + 1].time < ctx->heap[child].time) {
+            child++;
+        }
+        if (ctx->heap[child].time >= last.time) {
+            break;
+        }
+        ctx->heap[i] = ctx->heap[child];
+        i = child;
+    }
+    ctx->heap[i] = last;
+    return top;
+}
+
+static double qsel_perftest_rand(qsel_perftest_ctx_t *ctx)
+{
+    ctx->seed ^= ctx->seed << 13;
+    ctx->seed ^= ctx->seed >> 17;
+    ctx->seed ^= ctx->seed << 5;
+    return ((double)ctx->seed + 1.0) / ((double)UINT32_MAX + 2.0);
+}
+
+static int qsel_perftest_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static uint64_t qsel_perftest_service_ns(uint32_t queue_idx)
+{
+    return queue_idx == 0 ? QSEL_PERFTEST_SERVICE_NS * QSEL_PERFTEST_SLOW_FACTOR : QSEL_PERFTEST_SERVICE_NS;
+}
+
+// open loop poisson arrivals, each queue serves its requests one by one in arrival order
+static int qsel_perftest_run_policy(qsel_perftest_ctx_t *ctx, urpc_queue_select_policy_t policy, uint32_t *slow_num)
+{
+    double capacity = (QSEL_PERFTEST_QUEUE_NUM - 1) + 1.0 / QSEL_PERFTEST_SLOW_FACTOR;
+    double mean_gap_ns = QSEL_PERFTEST_SERVICE_NS * 100.0 / (capacity * QSEL_PERFTEST_LOAD_PERCENT);
+
+    ctx->channel.queue_select = policy;
+    ctx->seed = QSEL_PERFTEST_SEED;
+    ctx->heap_num = 0;
+    memset(ctx->free_at, 0, sizeof(ctx->free_at));
+    *slow_num = 0;
+
+    double now = 0;
+    for (uint32_t i = 0; i < QSEL_PERFTEST_REQ_NUM && !is_perftest_force_quit(); i++) {
+        now += -log(qsel_perftest_rand(ctx)) * mean_gap_ns;
+        uint64_t arrive = (uint64_t)now;
+        // responses received before this request uncount their queues, as req_entry_put does
+        while (ctx->heap_num > 0 && ctx->heap[0].time <= arrive) {
+            channel_queue_load_sub(&ctx->channel.r_selector, qsel_perftest_heap_pop(ctx).slot);
+        }
+
+        uint32_t slot;
+        queue_t *queue = channel_get_next_remote_queue(&ctx->channel, &slot);
+        if (queue == NULL) {
+            LOG_PRINT("select remote queue failed\n");
+            return -1;
+        }
+        channel_queue_load_add(&ctx->channel.r_selector, slot);
+
+        uint32_t idx = (uint32_t)(queue - ctx->queue);
+        uint64_t start = ctx->free_at[idx] > arrive ? ctx->free_at[idx] : arrive;
+        ctx->free_at[idx] = start + qsel_perftest_service_ns(idx);
+        ctx->latency[i] = ctx->free_at[idx] - arrive;
+        *slow_num += idx == 0 ? 1 : 0;
+        qsel_perftest_done_t done = {.time = ctx->free_at[idx], .slot = slot};
+        qsel_perftest_heap_push(ctx, done);
+    }
+
+    while (ctx->heap_num > 0) {
+        channel_queue_load_sub(&ctx->channel.r_selector, qsel_perftest_heap_pop(ctx).slot);
+    }
+    return 0;
+}
+
+static void qsel_perftest_uninit(qsel_perftest_ctx_t *ctx)
+{
+    URPC_SLIST_INIT(&ctx->channel.r_queue_nodes_head);
+    channel_queue_snapshot_update(&ctx->channel, true);
+    util_epoch_synchronize();
+    urpc_dbuf_free(ctx->channel.r_selector.snapshot);
+    free(ctx->heap);
+    free(ctx->latency);
+    free(ctx);
+}
+
+int urpc_perftest_run_queue_select(perftest_framework_config_t *cfg)
+{
+    (void)cfg;
+    qsel_perftest_ctx_t *ctx = (qsel_perftest_ctx_t *)calloc(1, sizeof(qsel_perftest_ctx_t));
+    if (ctx == NULL) {
+        return -1;
+    }
+    URPC_SLIST_INIT(&ctx->channel.l_queue_nodes_head);
+    URPC_SLIST_INIT(&ctx->channel.r_queue_nodes_head);
+    // insert at head, queue 0 the slow one is the first in snapshot
+    for (int i = QSEL_PERFTEST_QUEUE_NUM - 1; i >= 0; i--) {
+        ctx->queue[i].status = QUEUE_STATUS_READY;
+        ctx->node[i].urpc_qh = (uint64_t)(uintptr_t)&ctx->queue[i];
+        URPC_SLIST_INSERT_HEAD(&ctx->channel.r_queue_nodes_head, &ctx->node[i], node);
+    }
+    channel_queue_snapshot_update(&ctx->channel, true);
+    ctx->heap = (qsel_perftest_done_t *)calloc(QSEL_PERFTEST_REQ_NUM, sizeof(qsel_perftest_done_t));
+    ctx->latency = (uint64_t *)calloc(QSEL_PERFTEST_REQ_NUM, sizeof(uint64_t));
+    if (ctx->channel.r_selector.snapshot == NULL || ctx->heap == NULL || ctx->latency == NULL) {
+        LOG_PRINT("queue select test init failed\n");
+        qsel_perftest_uninit(ctx);
+        return -1;
+    }
+
+    (void)printf("%u remote queues, queue 0 is %ux slower, %u%% load, service time %uus\n", QSEL_PERFTEST_QUEUE_NUM,
+        QSEL_PERFTEST_SLOW_FACTOR, QSEL_PERFTEST_LOAD_PERCENT, QSEL_PERFTEST_SERVICE_NS / 1000);
+    (void)printf("%-16s%-12s%-12s%-12s%-12s%s\n", "policy", "p50(us)", "p99(us)", "p99.9(us)", "max(us)",
+        "to slow queue");
+    int ret = 0;
+    for (uint32_t policy = 0; policy < URPC_QUEUE_SELECT_MAX && ret == 0; policy++) {
+        uint32_t slow_num = 0;
+        ret = qsel_perftest_run_policy(ctx, (urpc_queue_select_policy_t)policy, &slow_num);
+        if (ret != 0) {
+            break;
+        }
+        qsort(ctx->latency, QSEL_PERFTEST_REQ_NUM, sizeof(uint64_t), qsel_perftest_cmp);
+        (void)printf("%-16s%-12.1f%-12.1f%-12.1f%-12.1f%.1f%%\n", g_qsel_perftest_policy_name[policy],
+            ctx->latency[QSEL_PERFTEST_REQ_NUM / 2] / 1000.0,
+            ctx->latency[(uint64_t)QSEL_PERFTEST_REQ_NUM * 99 / 100] / 1000.0,
+            ctx->latency[(uint64_t)QSEL_PERFTEST_REQ_NUM * 999 / 1000] / 1000.0,
+            ctx->latency[QSEL_PERFTEST_REQ_NUM - 1] / 1000.0, slow_num * 100.0 / QSEL_PERFTEST_REQ_NUM);
+    }
+
+    qsel_perftest_uninit(ctx);
+    return ret;
+}
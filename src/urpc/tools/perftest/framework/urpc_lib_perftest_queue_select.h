@@ -0,0 +1,25 @@
+/*
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: urpc lib perftest queue select test case, request latency with one slow remote queue
+ * Create: 2026-01-16
+ */
+
+#ifndef URPC_LIB_PERFTEST_QUEUE_SELECT_H
+#define URPC_LIB_PERFTEST_QUEUE_SELECT_H
+
+#include "urpc_lib_perftest_param.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* send requests to the remote queues of a channel through its queue select policy, one of the queues serves
+ * slower than others, and print the latency percentiles of each policy. queues are served in virtual time, so
+ * the result does not depend on devices or cpu of the host */
+int urpc_perftest_run_queue_select(perftest_framework_config_t *cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // URPC_LIB_PERFTEST_QUEUE_SELECT_H
@@ -50,6 +50,10 @@ typedef enum perftest_instance_mode {
 typedef enum perftest_case_type {
     PERFTEST_CASE_LAT,
     PERFTEST_CASE_QPS,
+    PERFTEST_CASE_BUF,      // local qbuf alloc/free test, only supported by umq perftest
+    PERFTEST_CASE_CRYPTO,   // local datapath encryption test, only supported by urpc framework perftest
+    PERFTEST_CASE_QUEUE_SELECT, // local channel queue select test, only supported by urpc framework perftest
+    PERFTEST_CASE_DEFAULT_ALLOC, // local default allocator get/put test, only supported by urpc framework perftest
     PERFTEST_CASE_MAX
 } perftest_case_type_t;
 
@@ -14,6 +14,7 @@
 #include <pthread.h>
 #include <stddef.h>
 #include <stdarg.h>
+#include <time.h>
 
 #include "umq_api.h"
 #include "umq_pro_api.h"
@@ -24,6 +25,7 @@
 #include "perftest_qps.h"
 #include "umq_perftest_qps.h"
 #include "umq_perftest_latency.h"
+#include "umq_perftest_buf.h"
 
 #define PERFTEST_STR_SIZE 1024
 #define PERFTEST_WAIT_TIMEOUT_US 100
@@ -33,7 +35,9 @@
 ================================================================================"
 #define UMQ_PERFTEST_UNDERLINE "--------------------------------------------------------------------------------------\
 -----------------------------------------------------------------------------------"
-#define UMQ_PERFTEST_ERTF_INFO_STR_SIZE (1024 + 1024 * 5 * 2) // head size: 1024, thread size: 1024 * 5, thread num: 2
+#define UMQ_PERFTEST_PERF_INFO_HEAD_SIZE (1024)
+#define UMQ_PERFTEST_PERF_INFO_THREAD_SIZE (1024 * 8)
+#define UMQ_PERFTEST_PERF_TITLE_MAX_LEN (32)
 #define UMQ_PERFTEST_PERF_REC_NAME_MAX_LEN 20 // stay synchronized with the output format
 static char g_perf_record_type_name[UMQ_PERF_RECORD_TYPE_MAX][UMQ_PERFTEST_PERF_REC_NAME_MAX_LEN] = {
     "umq_enqueue",
@@ -174,65 +178,46 @@ static inline int umq_perftest_write_perf_recode_msg(char *str_buf, int all_str_
     return ret;
 }
 
-static uint64_t umq_perftest_perf_cal_quantile(
-    umq_perf_record_t *record, umq_perf_record_type_t type, uint64_t count, uint64_t *thresh, uint32_t thresh_num)
-{
-    if (thresh_num == 0) {
-        return 0;
-    }
-
-    uint32_t idx;
-    uint64_t quantile_cnt = count;
-    for (idx = 0; idx < thresh_num; ++idx) {
-        if (record->type_record[type].bucket[idx] >= quantile_cnt) {
-            break;
-        }
-        quantile_cnt -= record->type_record[type].bucket[idx];
-    }
-
-    // the queried quantile cnt exceeds the maximum thresh records, return the max thresh
-    if (idx >= thresh_num) {
-        return thresh[thresh_num - 1];
-    }
-
-    if (record->type_record[type].bucket[idx] == 0) {
-        return 0;
-    }
-
-    uint64_t base = (idx == 0) ? 0 : thresh[idx - 1];
-    return ((double)quantile_cnt / record->type_record[type].bucket[idx]) * (thresh[idx] - base) + base;
-}
-
-static int umq_perftest_perf_analyse_and_output(
-    char *perf_info_str, int perf_info_size, umq_perf_record_t *perf_rec, uint64_t *thresh, uint32_t thresh_num)
+static int umq_perftest_perf_analyse_and_output(char *perf_info_str, int perf_info_size, umq_perf_record_t *perf_rec)
 {
     int ret = 0;
     for (int type = 0; type < UMQ_PERF_RECORD_TYPE_MAX; ++type) {
         uint64_t ave_cost = perf_rec->type_record[type].cnt != 0 ?
                             (perf_rec->type_record[type].accumulation / perf_rec->type_record[type].cnt) : 0;
-        uint64_t median = umq_perftest_perf_cal_quantile(perf_rec, type,
-            (uint64_t)(0.5 * perf_rec->type_record[type].cnt), thresh, thresh_num);
-        uint64_t p90 = umq_perftest_perf_cal_quantile(perf_rec, type,
-            (uint64_t)(0.9 * perf_rec->type_record[type].cnt), thresh, thresh_num);
-        uint64_t p99 = umq_perftest_perf_cal_quantile(perf_rec, type,
-            (uint64_t)(0.99 * perf_rec->type_record[type].cnt), thresh, thresh_num);
+        uint64_t min = perf_rec->type_record[type].cnt != 0 ? perf_rec->type_record[type].min : 0;
         ret += umq_perftest_write_perf_recode_msg(perf_info_str + ret, perf_info_size - ret,
-            "%-20s %-20lu %-20lu %-20lu %-20lu %-20lu %-20lu %-20lu\n",
-            g_perf_record_type_name[type], perf_rec->type_record[type].cnt, ave_cost,
-            perf_rec->type_record[type].min, perf_rec->type_record[type].max, median, p90, p99);
+            "%-20s %-14lu %-14lu %-14lu %-14lu %-14lu %-14lu %-14lu %-14lu %-14lu\n",
+            g_perf_record_type_name[type], perf_rec->type_record[type].cnt, ave_cost, min,
+            perf_rec->type_record[type].max, umq_perf_quantile_get(perf_rec, type, 0.5),
+            umq_perf_quantile_get(perf_rec, type, 0.9), umq_perf_quantile_get(perf_rec, type, 0.99),
+            umq_perf_quantile_get(perf_rec, type, 0.999), umq_perf_quantile_get(perf_rec, type, 0.9999));
     }
     return ret;
 }
 
-static int umq_perftest_perf_info_string_get(char *perf_info, int perf_info_size,
-    umq_perf_record_t **perf_record_table, uint32_t table_num, uint64_t *thresh, uint32_t thresh_num)
+static int umq_perftest_perf_thread_string_get(char *perf_info, int perf_info_size, umq_perf_record_t *perf_rec,
+    const char *title)
+{
+    int str_size = 0;
+    str_size += umq_perftest_write_perf_recode_msg(perf_info + str_size, perf_info_size - str_size,
+        "                                                                           %s\n", title);
+    str_size += umq_perftest_write_perf_recode_msg(perf_info + str_size, perf_info_size - str_size,
+        "%s\n", UMQ_PERFTEST_UNDERLINE);
+    str_size += umq_perftest_perf_analyse_and_output(perf_info + str_size, perf_info_size - str_size, perf_rec);
+    str_size += umq_perftest_write_perf_recode_msg(perf_info + str_size, perf_info_size - str_size,
+        "%s\n", UMQ_PERFTEST_UNDERLINE);
+    return str_size;
+}
+
+static int umq_perftest_perf_info_string_get(char *perf_info, int perf_info_size, umq_perf_infos_t *perf_record)
 {
-    if (perf_info == NULL || perf_record_table == NULL) {
+    if (perf_info == NULL || perf_record == NULL) {
         return UMQ_FAIL;
     }
 
     int str_size = 0;
     char *ret_str = perf_info;
+    char title[UMQ_PERFTEST_PERF_TITLE_MAX_LEN];
     (void)memset(perf_info, 0, perf_info_size);
 
     str_size += umq_perftest_write_perf_recode_msg(ret_str + str_size, perf_info_size - str_size,
@@ -242,26 +227,19 @@ static int umq_perftest_perf_info_string_get(char *perf_info, int perf_info_size
     str_size += umq_perftest_write_perf_recode_msg(ret_str + str_size, perf_info_size - str_size,
         "%s\n", UMQ_PERFTEST_EQUALS);
     str_size += umq_perftest_write_perf_recode_msg(ret_str + str_size, perf_info_size - str_size,
-        "%-20s %-20s %-20s %-20s %-20s %-20s %-20s %-20s\n",
-        "Type", "Sample Num", "Average (ns)", "Minimum (ns)", "Maxinum (ns)", "Median (ns)", "P90 (ns)", "P99 (ns)");
+        "%-20s %-14s %-14s %-14s %-14s %-14s %-14s %-14s %-14s %-14s\n", "Type", "Sample Num", "Average (ns)",
+        "Minimum (ns)", "Maxinum (ns)", "Median (ns)", "P90 (ns)", "P99 (ns)", "P99.9 (ns)", "P99.99 (ns)");
     str_size += umq_perftest_write_perf_recode_msg(ret_str + str_size, perf_info_size - str_size,
         "%s\n", UMQ_PERFTEST_UNDERLINE);
-    umq_perf_record_t **recv_perf = perf_record_table;
 
     // Ananlyse the recved perf data
-    for (uint32_t i = 0; i < table_num; ++i) {
-        if (!recv_perf[i]->is_used) {
-            continue;
-        }
-        str_size += umq_perftest_write_perf_recode_msg(ret_str + str_size, perf_info_size - str_size,
-            "                                                                           Data Thread %u\n", i);
-        str_size += umq_perftest_write_perf_recode_msg(ret_str + str_size, perf_info_size - str_size,
-            "%s\n", UMQ_PERFTEST_UNDERLINE);
-        str_size += umq_perftest_perf_analyse_and_output(ret_str + str_size, perf_info_size - str_size,
-            recv_perf[i], thresh, thresh_num);
-        str_size += umq_perftest_write_perf_recode_msg(ret_str + str_size, perf_info_size - str_size,
-            "%s\n", UMQ_PERFTEST_UNDERLINE);
+    for (uint32_t i = 0; i < perf_record->perf_record_num; ++i) {
+        (void)snprintf(title, sizeof(title), "Data Thread %u", i);
+        str_size += umq_perftest_perf_thread_string_get(ret_str + str_size, perf_info_size - str_size,
+            perf_record->perf_record[i], title);
     }
+    str_size += umq_perftest_perf_thread_string_get(ret_str + str_size, perf_info_size - str_size,
+        perf_record->perf_record[perf_record->perf_record_num], "All Threads");
     str_size += umq_perftest_write_perf_recode_msg(ret_str + str_size, perf_info_size - str_size,
         "%s\n", UMQ_PERFTEST_EQUALS);
     return str_size;
@@ -288,11 +266,37 @@ static int umq_perftest_start_perf(umq_perftest_config_t *cfg)
     return 0;
 }
 
+// show how many notifies and waits avoided futex syscall by spinning
+static void umq_perftest_show_ipc_wakeup(umq_perftest_config_t *cfg)
+{
+    if (cfg->trans_mode != UMQ_TRANS_MODE_IPC || !cfg->config.interrupt) {
+        return;
+    }
+
+    umq_dfx_cmd_t dfx_cmd = {
+        .module_id = UMQ_DFX_MODULE_IPC_WAKEUP,
+        .ipc_wakeup_cmd_id = UMQ_IPC_WAKEUP_CMD_GET_RESULT,
+    };
+    umq_dfx_result_t result_ctl = {0};
+    umq_dfx_cmd_process(&dfx_cmd, &result_ctl);
+    if (result_ctl.err_code != 0) {
+        LOG_PRINT("get ipc wakeup stats failed\n");
+        return;
+    }
+
+    umq_ipc_wakeup_stats_t *stats = result_ctl.ipc_wakeup_out_param;
+    (void)printf("ipc wakeup, wait: %lu, spin hit: %lu, sleep: %lu, timeout: %lu, spin ns: %lu, spin window ns: %lu, "
+        "wake: %lu, wake skipped: %lu\n", stats->wait_cnt, stats->spin_hit_cnt, stats->sleep_cnt, stats->timeout_cnt,
+        stats->spin_ns, stats->spin_window_ns, stats->wake_cnt, stats->wake_skip_cnt);
+}
+
 static void umq_perftest_finish_perf(umq_perftest_config_t *cfg)
 {
     umq_dfx_cmd_t dfx_cmd;
     umq_dfx_result_t result_ctl = {0};
 
+    umq_perftest_show_ipc_wakeup(cfg);
+
     if ((cfg->feature & UMQ_FEATURE_ENABLE_PERF) != 0) {
         // stop perf
         dfx_cmd.module_id = UMQ_DFX_MODULE_PERF;
@@ -312,19 +316,18 @@ static void umq_perftest_finish_perf(umq_perftest_config_t *cfg)
             return;
         }
 
-        // procrss raw data and output
-        char *perf_info_str_buf = (char *)malloc(UMQ_PERFTEST_ERTF_INFO_STR_SIZE);
+        // procrss raw data and output, one more section for the merge of all threads
+        umq_perf_infos_t *perf_record = (umq_perf_infos_t *)result_ctl.perf_out_param;
+        int str_buf_size = UMQ_PERFTEST_PERF_INFO_HEAD_SIZE +
+            UMQ_PERFTEST_PERF_INFO_THREAD_SIZE * (int)(perf_record->perf_record_num + 1);
+        char *perf_info_str_buf = (char *)malloc(str_buf_size);
         if (perf_info_str_buf == NULL) {
             LOG_PRINT("malloc perf info str failed\n");
             return;
         }
-        umq_perf_infos_t *perf_record = (umq_perf_infos_t *)result_ctl.perf_out_param;
-        uint64_t *thresh_array = cfg->thresh_array;
-        uint32_t thresh_num = cfg->thresh_num;
-        int str_size = umq_perftest_perf_info_string_get(perf_info_str_buf, UMQ_PERFTEST_ERTF_INFO_STR_SIZE,
-            perf_record->perf_record, perf_record->perf_record_num, thresh_array, thresh_num);
-        if (str_size >= UMQ_PERFTEST_ERTF_INFO_STR_SIZE) {
-            perf_info_str_buf[UMQ_PERFTEST_ERTF_INFO_STR_SIZE - 1] = '\0';
+        int str_size = umq_perftest_perf_info_string_get(perf_info_str_buf, str_buf_size, perf_record);
+        if (str_size >= str_buf_size) {
+            perf_info_str_buf[str_buf_size - 1] = '\0';
             LOG_PRINT("perf info str buf too small\n");
         }
         printf("%s\n", perf_info_str_buf);
@@ -342,6 +345,7 @@ static int umq_perftest_init_umq(umq_perftest_config_t *cfg)
     umq_config->buf_mode = cfg->buf_mode;
     umq_config->feature = cfg->feature;
     umq_config->flow_control.use_atomic_window = cfg->use_atomic_window;
+    umq_config->flow_control.adaptive = cfg->adaptive_window;
     umq_config->flow_control.notify_interval =
         cfg->config.case_type == PERFTEST_CASE_LAT ? (cfg->config.rx_depth >> 1) : 0;
     umq_config->headroom_size = 0;
@@ -350,16 +354,26 @@ static int umq_perftest_init_umq(umq_perftest_config_t *cfg)
     umq_config->trans_info[0].trans_mode = (umq_trans_mode_t)cfg->trans_mode;
     umq_config->cna = cfg->cna;
     umq_config->ubmm_eid = cfg->deid;
+    umq_config->io_buf_cfg = cfg->io_buf_cfg;
+    umq_config->ipc_wait_cfg = cfg->ipc_wait_cfg;
     if (fill_dev_info(&umq_config->trans_info[0].dev_info, cfg) != 0) {
         free(umq_config);
         return -1;
     }
 
+    struct timespec start;
+    struct timespec end;
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
     if (umq_init(umq_config) != UMQ_SUCCESS) {
         LOG_PRINT("umq_init failed\n");
         free(umq_config);
         return -1;
     }
+    (void)clock_gettime(CLOCK_MONOTONIC, &end);
+    // startup cost grows with prefault, compare it with the first touch cost of buf test case
+    LOG_PRINT("umq_init cost: %.3f ms, io buf backing: %u, prefault: %d\n",
+        (double)(end.tv_sec - start.tv_sec) * 1000 + (double)(end.tv_nsec - start.tv_nsec) / 1000000,
+        (uint32_t)cfg->io_buf_cfg.backing, (int)cfg->io_buf_cfg.prefault);
 
     umq_perftest_show_feature(umq_config->feature);
 
@@ -379,6 +393,10 @@ static int umq_perftest_create_umqh(umq_perftest_config_t *cfg)
         .tx_depth = cfg->config.tx_depth,
         .mode = cfg->config.interrupt ? UMQ_MODE_INTERRUPT : UMQ_MODE_POLLING,
     };
+    if (cfg->read_pipeline.window != 0) {
+        option.create_flag |= UMQ_CREATE_FLAG_READ_PIPELINE;
+        option.read_pipeline = cfg->read_pipeline;
+    }
     char *name = cfg->config.instance_mode == PERF_INSTANCE_SERVER ? "umq_perftest_server" : "umq_perftest_client";
     (void)sprintf(option.name, "%s", name);
     if (fill_dev_info(&option.dev_info, cfg) != 0) {
@@ -622,6 +640,19 @@ UNINIT:
     return ret;
 }
 
+static int umq_perftest_run_local(umq_perftest_config_t *cfg)
+{
+    // buf test runs in local process only, no umqh or peer is needed
+    if (umq_perftest_init_umq(cfg) != 0) {
+        return -1;
+    }
+
+    int ret = umq_perftest_run_buf(cfg);
+
+    umq_uninit();
+    return ret;
+}
+
 static int umq_perftest_server_exchange_and_bind(umq_perftest_config_t *cfg)
 {
     /* 1. serevr recv client bind info
@@ -755,7 +786,9 @@ int main(int argc, char *argv[])
     }
 
     int ret;
-    if (g_umq_perftest_ctx.cfg.config.instance_mode == PERF_INSTANCE_SERVER) {
+    if (g_umq_perftest_ctx.cfg.config.case_type == PERFTEST_CASE_BUF) {
+        ret = umq_perftest_run_local(&g_umq_perftest_ctx.cfg);
+    } else if (g_umq_perftest_ctx.cfg.config.instance_mode == PERF_INSTANCE_SERVER) {
         ret = umq_perftest_run_server(&g_umq_perftest_ctx.cfg);
     } else {
         ret = umq_perftest_run_client(&g_umq_perftest_ctx.cfg);
@@ -0,0 +1,197 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: umq perftest qbuf alloc/free test case
+ * Create: 2025-11-20
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "umq_api.h"
+#include "perftest_util.h"
+#include "perftest_thread.h"
+#include "umq_perftest_buf.h"
+
+#define UMQ_PERFTEST_BUF_BURST      (16)    // count of qbufs allocated before freeing them in one round
+#define UMQ_PERFTEST_NS_PER_SEC     (1000000000ULL)
+#define UMQ_PERFTEST_NS_PER_MS      (1000ULL)
+#define UMQ_PERFTEST_BUF_COLD_MAX   (65536) // max count of distinct qbufs touched in cold pass
+
+typedef struct umq_perftest_buf_worker {
+    pthread_t tid;
+    uint32_t idx;
+    umq_perftest_config_t *cfg;
+    pthread_barrier_t *barrier;
+    bool bulk;                  // use umq_buf_alloc_bulk/umq_buf_free_bulk for the whole burst
+    uint64_t ops;
+    uint64_t fail_cnt;
+    uint64_t cost_ns;
+} umq_perftest_buf_worker_t;
+
+static uint64_t umq_perftest_buf_now_ns(void)
+{
+    struct timespec ts;
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * UMQ_PERFTEST_NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static void *umq_perftest_buf_worker_run(void *arg)
+{
+    umq_perftest_buf_worker_t *worker = (umq_perftest_buf_worker_t *)arg;
+    umq_perftest_config_t *cfg = worker->cfg;
+    umq_buf_t *bufs[UMQ_PERFTEST_BUF_BURST];
+
+    if (cfg->config.cpu_affinity != UINT32_MAX) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cfg->config.cpu_affinity + worker->idx, &set);
+        (void)pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    // warm up thread local cache before timing
+    umq_buf_free(umq_buf_alloc(cfg->config.size, 1, UMQ_INVALID_HANDLE, NULL));
+
+    (void)pthread_barrier_wait(worker->barrier);
+    uint64_t start = umq_perftest_buf_now_ns();
+    for (uint32_t round = 0; round < cfg->test_round && !is_perftest_force_quit(); round += UMQ_PERFTEST_BUF_BURST) {
+        if (worker->bulk) {
+            if (umq_buf_alloc_bulk(UMQ_INVALID_HANDLE, cfg->config.size, UMQ_PERFTEST_BUF_BURST, NULL, bufs) != 0) {
+                worker->fail_cnt += UMQ_PERFTEST_BUF_BURST;
+                continue;
+            }
+            for (uint32_t i = 0; i < UMQ_PERFTEST_BUF_BURST; i++) {
+                bufs[i]->buf_data[0] = (char)round;
+            }
+            umq_buf_free_bulk(bufs, UMQ_PERFTEST_BUF_BURST);
+            worker->ops += UMQ_PERFTEST_BUF_BURST;
+            continue;
+        }
+
+        for (uint32_t i = 0; i < UMQ_PERFTEST_BUF_BURST; i++) {
+            bufs[i] = umq_buf_alloc(cfg->config.size, 1, UMQ_INVALID_HANDLE, NULL);
+            if (bufs[i] == NULL) {
+                worker->fail_cnt++;
+                continue;
+            }
+            // write data like a sender does, so that tlb misses of the backing pages are counted
+            bufs[i]->buf_data[0] = (char)round;
+        }
+        for (uint32_t i = 0; i < UMQ_PERFTEST_BUF_BURST; i++) {
+            umq_buf_free(bufs[i]);
+        }
+        worker->ops += UMQ_PERFTEST_BUF_BURST;
+    }
+    worker->cost_ns = umq_perftest_buf_now_ns() - start;
+
+    return NULL;
+}
+
+static int umq_perftest_buf_run_round(umq_perftest_config_t *cfg, uint32_t thread_num, bool bulk)
+{
+    umq_perftest_buf_worker_t *workers =
+        (umq_perftest_buf_worker_t *)calloc(thread_num, sizeof(umq_perftest_buf_worker_t));
+    if (workers == NULL) {
+        LOG_PRINT("calloc buf workers failed\n");
+        return -1;
+    }
+
+    pthread_barrier_t barrier;
+    (void)pthread_barrier_init(&barrier, NULL, thread_num);
+    for (uint32_t i = 0; i < thread_num; i++) {
+        workers[i].idx = i;
+        workers[i].cfg = cfg;
+        workers[i].barrier = &barrier;
+        workers[i].bulk = bulk;
+        if (pthread_create(&workers[i].tid, NULL, umq_perftest_buf_worker_run, &workers[i]) != 0) {
+            // workers already created are blocked on barrier and can not be released, quit the test
+            LOG_PRINT("create buf worker %u failed\n", i);
+            exit(-1);
+        }
+    }
+
+    uint64_t total_ops = 0;
+    uint64_t total_fail = 0;
+    uint64_t max_cost_ns = 0;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        (void)pthread_join(workers[i].tid, NULL);
+        total_ops += workers[i].ops;
+        total_fail += workers[i].fail_cnt;
+        max_cost_ns = workers[i].cost_ns > max_cost_ns ? workers[i].cost_ns : max_cost_ns;
+    }
+    (void)pthread_barrier_destroy(&barrier);
+    free(workers);
+
+    // every op is one alloc and one free, the slowest thread decides the wall time of the round
+    double mops = max_cost_ns == 0 ? 0 : (double)total_ops * UMQ_PERFTEST_NS_PER_MS / (double)max_cost_ns;
+    double ns_per_op = total_ops == 0 ? 0 : (double)max_cost_ns * thread_num / (double)total_ops;
+    (void)printf("%-10u %-8s %-16lu %-16.3f %-16.1f %-10lu\n", thread_num, bulk ? "bulk" : "single", total_ops, mops,
+        ns_per_op, total_fail);
+    return 0;
+}
+
+/* hold and touch as many distinct qbufs as possible once, each of them takes page fault at first time unless
+ * io buf is prefaulted. run before steady state rounds */
+static int umq_perftest_buf_run_cold(umq_perftest_config_t *cfg)
+{
+    uint32_t max_num = cfg->test_round < UMQ_PERFTEST_BUF_COLD_MAX ? cfg->test_round : UMQ_PERFTEST_BUF_COLD_MAX;
+    umq_buf_t **bufs = (umq_buf_t **)calloc(max_num, sizeof(umq_buf_t *));
+    if (bufs == NULL) {
+        LOG_PRINT("calloc cold bufs failed\n");
+        return -1;
+    }
+
+    uint32_t num = 0;
+    uint64_t start = umq_perftest_buf_now_ns();
+    for (; num < max_num && !is_perftest_force_quit(); num++) {
+        bufs[num] = umq_buf_alloc(cfg->config.size, 1, UMQ_INVALID_HANDLE, NULL);
+        if (bufs[num] == NULL) {
+            break;
+        }
+        bufs[num]->buf_data[0] = 0;
+    }
+    uint64_t cost_ns = umq_perftest_buf_now_ns() - start;
+
+    for (uint32_t i = 0; i < num; i++) {
+        umq_buf_free(bufs[i]);
+    }
+    free(bufs);
+
+    (void)printf("cold pass, bufs: %u, ns/buf: %.1f\n", num, num == 0 ? 0 : (double)cost_ns / (double)num);
+    return 0;
+}
+
+int umq_perftest_run_buf(umq_perftest_config_t *cfg)
+{
+    uint32_t max_thread = cfg->config.thread_num;
+    if (max_thread == 0 || max_thread > PERFTEST_THREAD_MAX_NUM) {
+        LOG_PRINT("thread num %u invalid, should be in [1, %u]\n", max_thread, PERFTEST_THREAD_MAX_NUM);
+        return -1;
+    }
+
+    (void)printf("umq buf alloc/free, size: %u, rounds per thread: %u, burst: %u\n",
+        cfg->config.size, cfg->test_round, UMQ_PERFTEST_BUF_BURST);
+    if (umq_perftest_buf_run_cold(cfg) != 0) {
+        return -1;
+    }
+
+    (void)printf("%-10s %-8s %-16s %-16s %-16s %-10s\n", "threads", "api", "alloc+free", "Mops/s", "ns/op", "fail");
+    uint32_t thread_num = 1;
+    while (!is_perftest_force_quit()) {
+        // compare one umq_buf_alloc per qbuf with one umq_buf_alloc_bulk per burst
+        if (umq_perftest_buf_run_round(cfg, thread_num, false) != 0 ||
+            umq_perftest_buf_run_round(cfg, thread_num, true) != 0) {
+            return -1;
+        }
+
+        if (thread_num == max_thread) {
+            break;
+        }
+        // double the thread count each round, and make sure the requested thread count is the last one
+        thread_num = (thread_num << 1) > max_thread ? max_thread : (thread_num << 1);
+    }
+
+    return 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: umq perftest qbuf alloc/free test case
+ * Create: 2025-11-20
+ */
+
+#ifndef UMQ_PERFTEST_BUF_H
+#define UMQ_PERFTEST_BUF_H
+
+#include "umq_perftest_param.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * touch distinct qbufs once to show first touch cost, then run umq_buf_alloc/umq_buf_free and
+ * umq_buf_alloc_bulk/umq_buf_free_bulk on 1, 2, 4 ... cfg->config.thread_num threads concurrently
+ * and print throughput for each thread count.
+ * umq must have been inited.
+ */
+int umq_perftest_run_buf(umq_perftest_config_t *cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // UMQ_PERFTEST_BUF_H
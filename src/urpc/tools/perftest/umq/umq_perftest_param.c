@@ -36,9 +36,18 @@ static struct option g_long_options[] = {
     {"deid", required_argument, NULL, 'D'},
     {"eid-index", required_argument, NULL, 'E'},
     {"use_atomic_window", no_argument, NULL, 'A'},
+    {"adaptive-window", no_argument, NULL, 'a'},
     {"buf_multiplex", no_argument, NULL, 'B'},
     {"num", required_argument, NULL, 'n'},
     {"perf-thresh", required_argument, NULL, 't'},
+    {"thread-num", required_argument, NULL, 'm'},
+    {"io-buf-backing", required_argument, NULL, 'H'},
+    {"prefault", no_argument, NULL, 'P'},
+    {"ipc-wait-mode", required_argument, NULL, 'W'},
+    {"ipc-spin-us", required_argument, NULL, 'L'},
+    {"dequeue-burst", no_argument, NULL, 'Q'},
+    {"read-window", required_argument, NULL, 'w'},
+    {"read-partial", no_argument, NULL, 'i'},
     {NULL, 0, NULL, 0}
 };
 // clang-format on
@@ -53,6 +62,7 @@ static void usage(void)
     (void)printf("  -c, --test-case <case index>        test case to be performed(default: 0)\n");
     (void)printf("                                      0: test umq latency(default)\n");
     (void)printf("                                      1: test umq qps\n");
+    (void)printf("                                      2: test umq buf alloc/free, no peer needed\n");
     (void)printf("  -u, --cpu-core <cpu_core>           from which cpu core to set affinity for each thread\n");
     (void)printf("      --server                        to launch server.\n");
     (void)printf("      --client                        to launch client.\n");
@@ -68,8 +78,19 @@ static void usage(void)
     (void)printf("      --rx-depth                      set queue rx-depth(default 512).\n");
     (void)printf("      --eid-index                     set eid index.\n");
     (void)printf("      --use_atomic_window             use atomic window when enable flow control.\n");
+    (void)printf("      --adaptive-window               adapt notify interval of flow control window.\n");
     (void)printf("      --num                           set number of iterations.\n");
-    (void)printf("      --perf-thresh                   set perf thresh array, length not exceed 8.\n");
+    (void)printf("      --perf-thresh                   no longer used, perf quantiles are read from histogram.\n");
+    (void)printf("      --thread-num                    set max thread num of buf test(default 1).\n");
+    (void)printf("      --io-buf-backing                set umq_io_buf_backing_t, 0: normal(default), 1: thp,\n");
+    (void)printf("                                      2: hugetlb 2M, 3: hugetlb 1G.\n");
+    (void)printf("      --prefault                      prefault io buf in umq_init.\n");
+    (void)printf("      --ipc-wait-mode                 ipc interrupt wait mode, 0: adaptive(default),\n");
+    (void)printf("                                      1: fixed spin window, 2: sleep without spin.\n");
+    (void)printf("      --ipc-spin-us                   set max spin window of ipc interrupt mode(default 50).\n");
+    (void)printf("      --dequeue-burst                 qps server of base api dequeues with umq_dequeue_burst.\n");
+    (void)printf("      --read-window <n>               pipeline rendezvous read with n chunks in flight(default 0, off).\n");
+    (void)printf("      --read-partial                  deliver each landed chunk of pipeline read at once.\n");
     (void)printf("  -h, --help                          show help info.\n\n");
 }
 
@@ -85,13 +106,22 @@ static void init_cfg(umq_perftest_config_t *cfg)
     config->rx_depth = DEFAULT_DEPTH;
     config->interrupt = false;
     config->buf_multiplex = false;
+    config->thread_num = 1;
 
     cfg->buf_mode = UMQ_BUF_SPLIT;
     cfg->trans_mode = UMQ_TRANS_MODE_IB;
     cfg->eid_idx = 0;
     cfg->use_atomic_window = false;
+    cfg->adaptive_window = false;
+    cfg->dequeue_burst = false;
+    cfg->read_pipeline.window = 0;
+    cfg->read_pipeline.partial_deliver = false;
     cfg->test_round = DEFAULT_LAT_TEST_ROUND;
     cfg->thresh_num = 0;
+    cfg->io_buf_cfg.backing = UMQ_IO_BUF_BACKING_NORMAL;
+    cfg->io_buf_cfg.prefault = false;
+    cfg->ipc_wait_cfg.mode = UMQ_IPC_WAIT_ADAPTIVE;
+    cfg->ipc_wait_cfg.spin_window_us = UMQ_IPC_SPIN_WINDOW_DEFAULT_US;
 }
 
 int umq_perftest_parse_arguments(int argc, char **argv, umq_perftest_config_t *cfg)
@@ -115,7 +145,7 @@ int umq_perftest_parse_arguments(int argc, char **argv, umq_perftest_config_t *c
                 break;
             case 'c':
                 cfg->config.case_type = (uint32_t)strtoul(optarg, NULL, 0);
-                if (cfg->config.case_type >= PERFTEST_CASE_MAX) {
+                if (cfg->config.case_type >= PERFTEST_CASE_CRYPTO) {
                     LOG_PRINT("get case_type %d failed\n", (int)cfg->config.case_type);
                     return -1;
                 }
@@ -167,6 +197,9 @@ int umq_perftest_parse_arguments(int argc, char **argv, umq_perftest_config_t *c
             case 'A':
                 cfg->use_atomic_window = true;
                 break;
+            case 'a':
+                cfg->adaptive_window = true;
+                break;
             case 'B':
                 cfg->config.buf_multiplex = true;
                 break;
@@ -182,6 +215,38 @@ int umq_perftest_parse_arguments(int argc, char **argv, umq_perftest_config_t *c
             case 'n':
                 cfg->test_round = (uint32_t)strtoul(optarg, NULL, 0);
                 break;
+            case 'm':
+                cfg->config.thread_num = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'H':
+                cfg->io_buf_cfg.backing = (umq_io_buf_backing_t)strtoul(optarg, NULL, 0);
+                if (cfg->io_buf_cfg.backing >= UMQ_IO_BUF_BACKING_MAX) {
+                    LOG_PRINT("get io buf backing %u failed\n", (uint32_t)cfg->io_buf_cfg.backing);
+                    return -1;
+                }
+                break;
+            case 'P':
+                cfg->io_buf_cfg.prefault = true;
+                break;
+            case 'W':
+                cfg->ipc_wait_cfg.mode = (umq_ipc_wait_mode_t)strtoul(optarg, NULL, 0);
+                if (cfg->ipc_wait_cfg.mode >= UMQ_IPC_WAIT_MODE_MAX) {
+                    LOG_PRINT("get ipc wait mode %u failed\n", (uint32_t)cfg->ipc_wait_cfg.mode);
+                    return -1;
+                }
+                break;
+            case 'L':
+                cfg->ipc_wait_cfg.spin_window_us = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'Q':
+                cfg->dequeue_burst = true;
+                break;
+            case 'w':
+                cfg->read_pipeline.window = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                cfg->read_pipeline.partial_deliver = true;
+                break;
             case 't':
                 start_idx = optind - 1;
                 while (start_idx < argc && *argv[start_idx] != '-' && cfg->thresh_num < UMQ_PERF_QUANTILE_MAX_NUM) {
@@ -35,6 +35,11 @@ typedef struct umq_perftest_config {
     uint16_t eid_idx;
     bool buf_multiplex;
     bool use_atomic_window;
+    bool adaptive_window;
+    bool dequeue_burst;
+    umq_read_pipeline_cfg_t read_pipeline;
+    umq_io_buf_cfg_t io_buf_cfg;
+    umq_ipc_wait_cfg_t ipc_wait_cfg;
     uint64_t thresh_array[UMQ_PERF_QUANTILE_MAX_NUM];
     uint16_t thresh_num;
 } umq_perftest_config_t;
@@ -92,7 +92,8 @@ static void umq_perftest_server_run_qps_base_interrupt(uint64_t umqh, umq_perfte
         uint32_t rest_data_size = 0;
         while (tmp_buf) {
             rest_data_size = tmp_buf->total_data_size;
-            poll_num++;
+            // chunks of pipeline read are counted once the last chunk of message lands
+            poll_num += tmp_buf->status == UMQ_BUF_READ_PARTIAL ? 0 : 1;
             while (tmp_buf && rest_data_size > 0) {
                 if (rest_data_size < tmp_buf->data_size) { // if cannot add up to total_size, return fail
                     LOG_PRINT("rest size is negative\n");
@@ -128,7 +129,8 @@ static void umq_perftest_server_run_qps_base_polling(uint64_t umqh, umq_perftest
         uint32_t rest_data_size = 0;
         while (tmp_buf) {
             rest_data_size = tmp_buf->total_data_size;
-            poll_num++;
+            // chunks of pipeline read are counted once the last chunk of message lands
+            poll_num += tmp_buf->status == UMQ_BUF_READ_PARTIAL ? 0 : 1;
             while (tmp_buf && rest_data_size > 0) {
                 if (rest_data_size < tmp_buf->data_size) { // if cannot add up to total_size, return fail
                     LOG_PRINT("rest size is negative\n");
@@ -144,10 +146,38 @@ static void umq_perftest_server_run_qps_base_polling(uint64_t umqh, umq_perftest
     }
 }
 
+// each dequeued buf is one message, no need to walk fragments to count messages
+static void umq_perftest_server_run_qps_base_burst(uint64_t umqh, umq_perftest_qps_arg_t *qps_arg)
+{
+    umq_buf_t *polled_buf[UMQ_BATCH_SIZE];
+    uint32_t thread_inx = perftest_thread_index();
+    uint64_t start_cycle = get_cycles();
+    double cycles_to_units = get_cpu_mhz(false);
+    while (!is_perftest_force_quit() && (get_cycles() - start_cycle) / cycles_to_units < ITER_MAX_WAIT_TIME_US) {
+        int poll_num = umq_dequeue_burst(umqh, polled_buf, UMQ_BATCH_SIZE);
+        if (poll_num < 0) {
+            LOG_PRINT("umq_dequeue_burst failed, ret %d\n", poll_num);
+            return;
+        }
+        if (poll_num == 0) {
+            continue;
+        }
+
+        uint32_t msg_num = 0;
+        for (int i = 0; i < poll_num; i++) {
+            msg_num += polled_buf[i]->status == UMQ_BUF_READ_PARTIAL ? 0 : 1;
+        }
+        umq_buf_free_bulk(polled_buf, (uint32_t)poll_num);
+        (void)atomic_fetch_add(&g_umq_perftest_qps_ctx.reqs[thread_inx], msg_num);
+    }
+}
+
 static void umq_perftest_server_run_qps_base(uint64_t umqh, umq_perftest_qps_arg_t *qps_arg)
 {
     if (qps_arg->cfg->config.interrupt) {
         umq_perftest_server_run_qps_base_interrupt(umqh, qps_arg);
+    } else if (qps_arg->cfg->dequeue_burst) {
+        umq_perftest_server_run_qps_base_burst(umqh, qps_arg);
     } else {
         umq_perftest_server_run_qps_base_polling(umqh, qps_arg);
     }
@@ -228,9 +258,7 @@ static void umq_perftest_server_run_qps_pro_interrupt(uint64_t umqh, umq_perftes
         } while (poll_num == 0 && !is_perftest_force_quit());
 
         require_rx_cnt += (uint32_t)poll_num;
-        for (int i = 0; i < poll_num; ++i) {
-            umq_buf_free(polled_buf[i]);
-        }
+        umq_buf_free_bulk(polled_buf, (uint32_t)poll_num);
         (void)atomic_fetch_add(&g_umq_perftest_qps_ctx.reqs[thread_inx], poll_num);
 
         // batch fill rx
@@ -272,9 +300,7 @@ static void umq_perftest_server_run_qps_pro_polling(uint64_t umqh, umq_perftest_
         }
 
         require_rx_cnt += (uint32_t)poll_num;
-        for (int i = 0; i < poll_num; ++i) {
-            umq_buf_free(polled_buf[i]);
-        }
+        umq_buf_free_bulk(polled_buf, (uint32_t)poll_num);
         (void)atomic_fetch_add(&g_umq_perftest_qps_ctx.reqs[thread_inx], poll_num);
 
         // batch fill rx
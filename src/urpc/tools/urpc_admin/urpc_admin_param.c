@@ -51,7 +51,8 @@ static int g_urpc_channel_cmd_bits[] = {
 
 static int g_urpc_perf_cmd_bits[] = {
     URPC_CMD_BITS_PERF,
-    URPC_CMD_BITS_THRESH
+    URPC_CMD_BITS_THRESH,
+    URPC_CMD_BITS_QUANTILE
 };
 
 static int g_urpc_stats_cmd_bits[] = {
@@ -74,6 +75,7 @@ static int g_urpc_handshaker_cmd_bits[] = {
 
 static int g_urpc_perf[] = {URPC_CMD_BITS_PERF};
 static int g_urpc_perf_with_thresh[] = {URPC_CMD_BITS_PERF, URPC_CMD_BITS_THRESH};
+static int g_urpc_perf_with_quantile[] = {URPC_CMD_BITS_PERF, URPC_CMD_BITS_QUANTILE};
 static urpc_cmd_map_t g_urpc_perf_cmd_map[] = {
     {
         .cmd_bits = g_urpc_perf,
@@ -91,6 +93,14 @@ static urpc_cmd_map_t g_urpc_perf_cmd_map[] = {
         .module_id = (uint16_t)URPC_IPC_MODULE_PERF,
         .cmd_id = URPC_U16_FAIL,
     },
+    {
+        .cmd_bits = g_urpc_perf_with_quantile,
+        .cmd_num = sizeof(g_urpc_perf_with_quantile) / sizeof(int),
+        .cmd_set = NULL,
+        .cmd_set_num = 0,
+        .module_id = (uint16_t)URPC_IPC_MODULE_PERF,
+        .cmd_id = URPC_U16_FAIL,
+    },
 };
 
 static int g_urpc_stats[] = {URPC_CMD_BITS_STATS};
@@ -240,6 +250,7 @@ static struct option g_long_options[] = {
     {"dbuf-usage", no_argument, NULL, 'D'},
     {"perf", required_argument, NULL, 'P'},
     {"thresh", required_argument, NULL, 't'},
+    {"quantile", required_argument, NULL, 'Q'},
     {"channel", optional_argument, NULL, 'c'},
     {"handshaker-info", no_argument, NULL, 'T'},
     {"task-id", required_argument, NULL, 'i'},
@@ -259,8 +270,10 @@ static void usage(void)
     (void)printf("This corresponds to command group, and you can specify two options at the same time.\n");
     (void)printf("  --perf=<cmd>                                urpc performance stats, 0: PERF_START, 1: PERF_STOP, "
                  "2: PERF_CLEAR\n");
-    (void)printf("  --thresh=<t1,t2,...>                        perf record thresh value in nanosecond for quantile "
-                 "calculation, support maximum 8 configurations\n\n");
+    (void)printf("  --thresh=<t1,t2,...>                        no longer used, use --quantile with PERF_STOP "
+                 "instead\n");
+    (void)printf("  --quantile=<q1,q2,...>                      perf record quantiles in [0, 1] reported on PERF_STOP, "
+                 "support maximum 8 configurations, default 0.5,0.9,0.99,0.999,0.9999\n\n");
     (void)printf("Show urpc statistics:\n");
     (void)printf("This corresponds to command group, and you can specify two options at the same time.\n");
     (void)printf("  -s, --stats                                 show urpc statistics\n");
@@ -421,6 +434,42 @@ static int parse_threshold(const char *thresh, urpc_admin_config_t *cfg)
     return 0;
 }
 
+static int parse_quantile(const char *quantile, urpc_admin_config_t *cfg)
+{
+    char param[PARSE_THRESHOLD_STRING_SIZE] = {0};
+    char *num = NULL;
+    char *end = NULL;
+
+    (void)snprintf(param, PARSE_THRESHOLD_STRING_SIZE, "%s", quantile);
+    cfg->perf.quantile_num = 0;
+    num = strtok(param, ",");
+    if (num == NULL) {
+        (void)printf("invalid input param, empty quantile\n");
+        return -1;
+    }
+
+    while (num != NULL) {
+        errno = 0;
+        double val = strtod(num, &end);
+        if (errno != 0 || *end != '\0' || !(val >= 0 && val <= 1)) {
+            (void)printf("invalid input param, quantile %s is not in [0, 1]\n", num);
+            return -1;
+        }
+
+        if (cfg->perf.quantile_num >= URPC_PERF_QUANTILE_MAX_NUM) {
+            (void)printf("The IO quantile number has reached the maximum %u, "
+                         "the input setting will be discard.\n",
+                URPC_PERF_QUANTILE_MAX_NUM);
+            return 0;
+        }
+
+        cfg->perf.quantile[cfg->perf.quantile_num++] = val;
+        num = strtok(NULL, ",");
+    }
+
+    return 0;
+}
+
 int urpc_admin_args_parse(int argc, char **argv, urpc_admin_config_t *cfg)
 {
     if (argc == 1) {
@@ -497,8 +546,15 @@ int urpc_admin_args_parse(int argc, char **argv, urpc_admin_config_t *cfg)
                 if (parse_threshold(optarg, cfg) != 0) {
                     return -1;
                 }
+                (void)printf("--thresh is no longer used, use --quantile with PERF_STOP instead\n");
                 urpc_bitmap_set1(bitmap, URPC_CMD_BITS_THRESH);
                 break;
+            case 'Q':
+                if (parse_quantile(optarg, cfg) != 0) {
+                    return -1;
+                }
+                urpc_bitmap_set1(bitmap, URPC_CMD_BITS_QUANTILE);
+                break;
             case 'D':
                 urpc_bitmap_set1(bitmap, URPC_CMD_BITS_DBUF);
                 break;
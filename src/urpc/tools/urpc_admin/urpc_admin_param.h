@@ -27,6 +27,7 @@ typedef enum urpc_cmd_bits {
 
     URPC_CMD_BITS_PERF,
     URPC_CMD_BITS_THRESH,
+    URPC_CMD_BITS_QUANTILE,
 
     URPC_CMD_BITS_STATS,
     URPC_CMD_BITS_QUEUE_ID,
@@ -55,6 +56,8 @@ typedef struct urpc_admin_config {
     struct {
         uint64_t count_thresh[URPC_PERF_QUANTILE_MAX_NUM];
         uint8_t count_thresh_num;
+        double quantile[URPC_PERF_QUANTILE_MAX_NUM];
+        uint8_t quantile_num;
     } perf;
     uint64_t bitmap;
 } urpc_admin_config_t;
@@ -10,8 +10,12 @@
 #include "umq_errno.h"
 #include "umq_vlog.h"
 #include "perf.h"
+#include "umq_qbuf_pool.h"
+#include "msg_ring.h"
 #include "dfx.h"
 
+static umq_eager_thresh_stats_t g_umq_eager_thresh_stats_snapshot;
+
 int umq_dfx_init(umq_init_cfg_t *cfg)
 {
     if (((cfg->feature & UMQ_FEATURE_ENABLE_PERF) != 0) && umq_perf_init() != UMQ_SUCCESS) {
@@ -54,6 +58,78 @@ static void umq_dfx_process_perf_cmd(umq_dfx_cmd_t *cmd, umq_dfx_result_t *resul
     }
 }
 
+static void umq_dfx_process_qbuf_pool_cmd(umq_dfx_cmd_t *cmd, umq_dfx_result_t *result_ctl)
+{
+    umq_qbuf_pool_cmd_id_t cmd_id = cmd->qbuf_pool_cmd_id;
+    switch (cmd_id) {
+        case UMQ_QBUF_POOL_CMD_CLEAR:
+            result_ctl->err_code = umq_qbuf_pool_stats_clear();
+            result_ctl->qbuf_pool_cmd_id = UMQ_QBUF_POOL_CMD_CLEAR;
+            break;
+        case UMQ_QBUF_POOL_CMD_GET_RESULT:
+            result_ctl->err_code = umq_qbuf_pool_stats_get(&result_ctl->qbuf_pool_out_param);
+            result_ctl->qbuf_pool_cmd_id = UMQ_QBUF_POOL_CMD_GET_RESULT;
+            break;
+        case UMQ_QBUF_POOL_CMD_MAX:
+        default:
+            result_ctl->err_code = UMQ_FAIL;
+            result_ctl->qbuf_pool_cmd_id = UMQ_QBUF_POOL_CMD_MAX;
+            break;
+    }
+}
+
+static void umq_dfx_process_ipc_wakeup_cmd(umq_dfx_cmd_t *cmd, umq_dfx_result_t *result_ctl)
+{
+    umq_ipc_wakeup_cmd_id_t cmd_id = cmd->ipc_wakeup_cmd_id;
+    switch (cmd_id) {
+        case UMQ_IPC_WAKEUP_CMD_CLEAR:
+            result_ctl->err_code = msg_ring_wakeup_stats_clear();
+            result_ctl->ipc_wakeup_cmd_id = UMQ_IPC_WAKEUP_CMD_CLEAR;
+            break;
+        case UMQ_IPC_WAKEUP_CMD_GET_RESULT:
+            result_ctl->err_code = msg_ring_wakeup_stats_get(&result_ctl->ipc_wakeup_out_param);
+            result_ctl->ipc_wakeup_cmd_id = UMQ_IPC_WAKEUP_CMD_GET_RESULT;
+            break;
+        case UMQ_IPC_WAKEUP_CMD_MAX:
+        default:
+            result_ctl->err_code = UMQ_FAIL;
+            result_ctl->ipc_wakeup_cmd_id = UMQ_IPC_WAKEUP_CMD_MAX;
+            break;
+    }
+}
+
+static int umq_dfx_eager_thresh_user_ctl(uint64_t umqh, umq_user_ctl_opcode_t opcode, umq_eager_thresh_stats_t *stats)
+{
+    umq_user_ctl_in_t in = {.opcode = opcode};
+    umq_user_ctl_out_t out = {
+        .addr = (uint64_t)(uintptr_t)stats,
+        .len = stats == NULL ? 0 : sizeof(umq_eager_thresh_stats_t),
+    };
+    return umq_user_ctl(umqh, &in, &out);
+}
+
+static void umq_dfx_process_eager_thresh_cmd(umq_dfx_cmd_t *cmd, umq_dfx_result_t *result_ctl)
+{
+    umq_eager_thresh_cmd_id_t cmd_id = cmd->eager_thresh_cmd_id;
+    switch (cmd_id) {
+        case UMQ_EAGER_THRESH_CMD_CLEAR:
+            result_ctl->err_code = umq_dfx_eager_thresh_user_ctl(cmd->umqh, UMQ_OPCODE_EAGER_THRESH_STATS_CLEAR, NULL);
+            result_ctl->eager_thresh_cmd_id = UMQ_EAGER_THRESH_CMD_CLEAR;
+            break;
+        case UMQ_EAGER_THRESH_CMD_GET_RESULT:
+            result_ctl->err_code = umq_dfx_eager_thresh_user_ctl(cmd->umqh, UMQ_OPCODE_EAGER_THRESH_STATS_QUERY,
+                &g_umq_eager_thresh_stats_snapshot);
+            result_ctl->eager_thresh_out_param = &g_umq_eager_thresh_stats_snapshot;
+            result_ctl->eager_thresh_cmd_id = UMQ_EAGER_THRESH_CMD_GET_RESULT;
+            break;
+        case UMQ_EAGER_THRESH_CMD_MAX:
+        default:
+            result_ctl->err_code = UMQ_FAIL;
+            result_ctl->eager_thresh_cmd_id = UMQ_EAGER_THRESH_CMD_MAX;
+            break;
+    }
+}
+
 void umq_dfx_cmd_process(umq_dfx_cmd_t *cmd, umq_dfx_result_t *result_ctl)
 {
     if ((cmd == NULL) || (result_ctl == NULL)) {
@@ -67,6 +143,18 @@ void umq_dfx_cmd_process(umq_dfx_cmd_t *cmd, umq_dfx_result_t *result_ctl)
             umq_dfx_process_perf_cmd(cmd, result_ctl);
             result_ctl->module_id = UMQ_DFX_MODULE_PERF;
             break;
+        case UMQ_DFX_MODULE_QBUF_POOL:
+            umq_dfx_process_qbuf_pool_cmd(cmd, result_ctl);
+            result_ctl->module_id = UMQ_DFX_MODULE_QBUF_POOL;
+            break;
+        case UMQ_DFX_MODULE_IPC_WAKEUP:
+            umq_dfx_process_ipc_wakeup_cmd(cmd, result_ctl);
+            result_ctl->module_id = UMQ_DFX_MODULE_IPC_WAKEUP;
+            break;
+        case UMQ_DFX_MODULE_EAGER_THRESH:
+            umq_dfx_process_eager_thresh_cmd(cmd, result_ctl);
+            result_ctl->module_id = UMQ_DFX_MODULE_EAGER_THRESH;
+            break;
         case UMQ_DFX_MODULE_STATS:
         default:
             result_ctl->err_code = UMQ_FAIL;
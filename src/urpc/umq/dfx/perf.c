@@ -6,32 +6,90 @@
  */
 
 #include <pthread.h>
+#include <string.h>
 
 #include "umq_errno.h"
 #include "urpc_util.h"
 #include "umq_vlog.h"
+#include "util_hist.h"
 #include "perf.h"
 
-#define UMQ_PERF_MAX_THRESH_NS         (100000u)
-#define UMQ_PERF_REC_MAX_NUM           (64u)
+#define UMQ_PERF_MAX_THRESH_NS               (100000u)
 
 #define UMQ_PERF_IO_DIRECTION_ALL_OFFSET     (0)
 #define UMQ_PERF_IO_DIRECTION_TX_OFFSET      (1)
 #define UMQ_PERF_IO_DIRECTION_RX_OFFSET      (2)
 
-static __thread uint32_t g_perf_record_index = -1;
-static __thread pthread_once_t g_dp_thread_run_once = PTHREAD_ONCE_INIT;
+_Static_assert(UMQ_PERF_HIST_BUCKET_NUM == UTIL_HIST_BUCKET_NUM,
+    "UMQ_PERF_HIST_BUCKET_NUM is inconsistent with UTIL_HIST_BUCKET_NUM");
+
+// each thread writes its own record without lock, records are merged when perf info is read
+typedef struct umq_perf_thread_record {
+    umq_perf_record_t record;
+    struct umq_perf_thread_record *next;
+} umq_perf_thread_record_t;
+
+static __thread umq_perf_record_t *g_perf_record = NULL;
+static __thread uint32_t g_perf_record_gen = 0;
 static bool g_umq_perf_record_enable = false;
+// bumped by each init, so that records cached by threads before last uninit are not used
+static uint32_t g_umq_perf_gen = 0;
 
 typedef struct umq_perf_record_ctx {
-    umq_perf_record_t perf_record_table[UMQ_PERF_REC_MAX_NUM];
+    umq_perf_thread_record_t *record_list;      // records are only freed at uninit, and reused after thread exits
+    uint32_t record_num;
+    umq_perf_record_t exited_record;            // merged from the records of exited threads
+    umq_perf_record_t total_record;             // merged from all records when perf info is read
     uint64_t perf_quantile_thresh[UMQ_PERF_QUANTILE_MAX_NUM + 1];
+    double ns_per_cycle;
     umq_perf_infos_t *perf_record_msg;
+    pthread_key_t thread_key;
     pthread_mutex_t lock;
 } umq_perf_record_ctx_t;
 
 static umq_perf_record_ctx_t *g_umq_perf_record_ctx;
 
+static void umq_clear_perf_record(umq_perf_record_t *record)
+{
+    for (int type = 0; type < UMQ_PERF_RECORD_TYPE_MAX; ++type) {
+        record->type_record[type].accumulation = 0;
+        record->type_record[type].min = UINT64_MAX;
+        record->type_record[type].max = 0;
+        record->type_record[type].cnt = 0;
+        (void)memset(record->type_record[type].bucket, 0, sizeof(record->type_record[type].bucket));
+        util_hist_clear((util_hist_t *)record->hist[type]);
+    }
+}
+
+static void umq_merge_perf_record(umq_perf_record_t *dst, const umq_perf_record_t *src)
+{
+    for (int type = 0; type < UMQ_PERF_RECORD_TYPE_MAX; ++type) {
+        if (src->type_record[type].cnt == 0) {
+            continue;
+        }
+        dst->type_record[type].accumulation += src->type_record[type].accumulation;
+        (src->type_record[type].min < dst->type_record[type].min) ?
+            dst->type_record[type].min = src->type_record[type].min : 0;
+        (src->type_record[type].max > dst->type_record[type].max) ?
+            dst->type_record[type].max = src->type_record[type].max : 0;
+        dst->type_record[type].cnt += src->type_record[type].cnt;
+        for (uint32_t i = 0; i < UMQ_PERF_QUANTILE_MAX_NUM + 1; ++i) {
+            dst->type_record[type].bucket[i] += src->type_record[type].bucket[i];
+        }
+        util_hist_merge((util_hist_t *)dst->hist[type], (const util_hist_t *)src->hist[type]);
+    }
+}
+
+static void umq_perf_record_release(void *arg)
+{
+    umq_perf_record_t *record = (umq_perf_record_t *)arg;
+    (void)pthread_mutex_lock(&g_umq_perf_record_ctx->lock);
+    umq_merge_perf_record(&g_umq_perf_record_ctx->exited_record, record);
+    umq_clear_perf_record(record);
+    record->is_used = false;
+    (void)pthread_mutex_unlock(&g_umq_perf_record_ctx->lock);
+}
+
 int umq_perf_init(void)
 {
     if (g_umq_perf_record_ctx != NULL) {
@@ -39,12 +97,20 @@ int umq_perf_init(void)
         return -UMQ_ERR_EEXIST;
     }
 
-    g_umq_perf_record_ctx = (umq_perf_record_ctx_t *)calloc(1, sizeof(umq_perf_record_ctx_t));
-    if (g_umq_perf_record_ctx == NULL) {
+    umq_perf_record_ctx_t *ctx = (umq_perf_record_ctx_t *)calloc(1, sizeof(umq_perf_record_ctx_t));
+    if (ctx == NULL) {
         UMQ_VLOG_ERR("malloc for umq_perf_record failed\n");
         return -UMQ_ERR_ENOMEM;
     }
-    pthread_mutex_init(&g_umq_perf_record_ctx->lock, NULL);
+    if (pthread_key_create(&ctx->thread_key, umq_perf_record_release) != 0) {
+        UMQ_VLOG_ERR("create perf thread key failed\n");
+        free(ctx);
+        return -UMQ_ERR_ENOMEM;
+    }
+    umq_clear_perf_record(&ctx->exited_record);
+    pthread_mutex_init(&ctx->lock, NULL);
+    g_umq_perf_record_ctx = ctx;
+    g_umq_perf_gen++;
     return UMQ_SUCCESS;
 }
 
@@ -54,54 +120,51 @@ void umq_perf_uninit(void)
         return;
     }
     g_umq_perf_record_enable = false;
+    (void)pthread_key_delete(g_umq_perf_record_ctx->thread_key);
     (void)pthread_mutex_lock(&g_umq_perf_record_ctx->lock);
     if (g_umq_perf_record_ctx->perf_record_msg != NULL) {
         free(g_umq_perf_record_ctx->perf_record_msg);
         g_umq_perf_record_ctx->perf_record_msg = NULL;
     }
+    umq_perf_thread_record_t *cur = g_umq_perf_record_ctx->record_list;
+    while (cur != NULL) {
+        umq_perf_thread_record_t *next = cur->next;
+        free(cur);
+        cur = next;
+    }
     (void)pthread_mutex_unlock(&g_umq_perf_record_ctx->lock);
     pthread_mutex_destroy(&g_umq_perf_record_ctx->lock);
     free(g_umq_perf_record_ctx);
     g_umq_perf_record_ctx = NULL;
 }
 
-static void umq_clear_perf_record_item(uint32_t record_idx)
-{
-    umq_perf_record_t *cur_record = &g_umq_perf_record_ctx->perf_record_table[record_idx];
-    for (int type = 0; type < UMQ_PERF_RECORD_TYPE_MAX; ++type) {
-        cur_record->type_record[type].accumulation = 0;
-        cur_record->type_record[type].min = UINT64_MAX;
-        cur_record->type_record[type].max = 0;
-        cur_record->type_record[type].cnt = 0;
-        (void)memset(cur_record->type_record[type].bucket, 0, sizeof(cur_record->type_record[type].bucket));
-    }
-}
-
-void umq_perf_record_alloc(void)
+static void umq_perf_record_alloc(void)
 {
-    uint32_t idx;
+    umq_perf_thread_record_t *cur;
     (void)pthread_mutex_lock(&g_umq_perf_record_ctx->lock);
-    for (idx = 0; idx < UMQ_PERF_REC_MAX_NUM; ++idx) {
-        if (!g_umq_perf_record_ctx->perf_record_table[idx].is_used) {
+    for (cur = g_umq_perf_record_ctx->record_list; cur != NULL; cur = cur->next) {
+        if (!cur->record.is_used) {
             break;
         }
     }
-    if (idx == UMQ_PERF_REC_MAX_NUM) {
-        (void)pthread_mutex_unlock(&g_umq_perf_record_ctx->lock);
-        UMQ_VLOG_WARN("perf_rec table capacity %u were exhausted, alloc perf_rec failed\n", UMQ_PERF_REC_MAX_NUM);
-        return;
+    if (cur == NULL) {
+        cur = (umq_perf_thread_record_t *)malloc(sizeof(umq_perf_thread_record_t));
+        if (cur == NULL) {
+            (void)pthread_mutex_unlock(&g_umq_perf_record_ctx->lock);
+            UMQ_LIMIT_VLOG_WARN("malloc for perf_rec of thread failed\n");
+            return;
+        }
+        umq_clear_perf_record(&cur->record);
+        cur->next = g_umq_perf_record_ctx->record_list;
+        g_umq_perf_record_ctx->record_list = cur;
+        g_umq_perf_record_ctx->record_num++;
     }
-
-    umq_clear_perf_record_item(idx);
-    g_umq_perf_record_ctx->perf_record_table[idx].is_used = true;
+    cur->record.is_used = true;
+    (void)pthread_setspecific(g_umq_perf_record_ctx->thread_key, &cur->record);
     (void)pthread_mutex_unlock(&g_umq_perf_record_ctx->lock);
 
-    g_perf_record_index = idx;
-}
-
-static void umq_dp_thread_run_once(void)
-{
-    umq_perf_record_alloc();
+    g_perf_record = &cur->record;
+    g_perf_record_gen = g_umq_perf_gen;
 }
 
 uint64_t umq_perf_get_start_timestamp(void)
@@ -109,7 +172,10 @@ uint64_t umq_perf_get_start_timestamp(void)
     if (!g_umq_perf_record_enable) {
         return 0;
     }
-    pthread_once(&g_dp_thread_run_once, umq_dp_thread_run_once);
+    if (URPC_UNLIKELY(g_perf_record == NULL || g_perf_record_gen != g_umq_perf_gen)) {
+        g_perf_record = NULL;
+        umq_perf_record_alloc();
+    }
     return urpc_get_cpu_cycles();
 }
 
@@ -130,8 +196,8 @@ static inline uint32_t find_perf_record_bucket(uint64_t delta)
 
 static inline void umq_perf_fill_perf_record(umq_perf_record_type_t type, uint64_t start)
 {
-    uint64_t delta = urpc_get_cpu_cycles() - start;
-    umq_perf_record_t *cur_rec = &g_umq_perf_record_ctx->perf_record_table[g_perf_record_index];
+    uint64_t delta = (uint64_t)((double)(urpc_get_cpu_cycles() - start) * g_umq_perf_record_ctx->ns_per_cycle);
+    umq_perf_record_t *cur_rec = g_perf_record;
     cur_rec->type_record[type].accumulation += delta;
     (delta < cur_rec->type_record[type].min) ? cur_rec->type_record[type].min = delta : 0;
     (delta > cur_rec->type_record[type].max) ? cur_rec->type_record[type].max = delta : 0;
@@ -139,12 +205,13 @@ static inline void umq_perf_fill_perf_record(umq_perf_record_type_t type, uint64
     if (bucket_idx != UINT32_MAX) {
         ++cur_rec->type_record[type].bucket[bucket_idx];
     }
+    util_hist_record((util_hist_t *)cur_rec->hist[type], delta);
     ++cur_rec->type_record[type].cnt;
 }
 
 void umq_perf_record_write(umq_perf_record_type_t type, uint64_t start)
 {
-    if (!g_umq_perf_record_enable || start == 0 || g_perf_record_index >= UMQ_PERF_REC_MAX_NUM) {
+    if (!g_umq_perf_record_enable || start == 0 || g_perf_record == NULL) {
         return;
     }
     umq_perf_fill_perf_record(type, start);
@@ -152,7 +219,7 @@ void umq_perf_record_write(umq_perf_record_type_t type, uint64_t start)
 
 void umq_perf_record_write_with_direction(umq_perf_record_type_t type, uint64_t start, umq_io_direction_t direction)
 {
-    if (!g_umq_perf_record_enable || start == 0 || g_perf_record_index >= UMQ_PERF_REC_MAX_NUM) {
+    if (!g_umq_perf_record_enable || start == 0 || g_perf_record == NULL) {
         return;
     }
 
@@ -164,6 +231,15 @@ void umq_perf_record_write_with_direction(umq_perf_record_type_t type, uint64_t
     umq_perf_fill_perf_record(type + perf_record_type_map[direction], start);
 }
 
+// caller should hold the lock
+static void umq_clear_all_perf_record(void)
+{
+    for (umq_perf_thread_record_t *cur = g_umq_perf_record_ctx->record_list; cur != NULL; cur = cur->next) {
+        umq_clear_perf_record(&cur->record);
+    }
+    umq_clear_perf_record(&g_umq_perf_record_ctx->exited_record);
+}
+
 int umq_perf_start(uint64_t *thresh_array, uint32_t thresh_num)
 {
     // IO perf record has been started, user must stop it first before restart
@@ -172,28 +248,30 @@ int umq_perf_start(uint64_t *thresh_array, uint32_t thresh_num)
         return -UMQ_ERR_EINVAL;
     }
 
-    for (uint32_t i = 0; i < UMQ_PERF_REC_MAX_NUM; ++i) {
-        umq_clear_perf_record_item(i);
-    }
-
     if (thresh_num > UMQ_PERF_QUANTILE_MAX_NUM) {
-        UMQ_VLOG_ERR(
-            "configured thresh num %u exceeds the max thresh_num %u, only the minimum %d of them are used\n",
-            thresh_num, UMQ_PERF_QUANTILE_MAX_NUM, UMQ_PERF_QUANTILE_MAX_NUM);
+        UMQ_VLOG_ERR("configured thresh num %u exceeds the max thresh_num %u\n", thresh_num,
+            UMQ_PERF_QUANTILE_MAX_NUM);
         return -UMQ_ERR_EAGAIN;
     }
 
-    // set quantile bucket
+    (void)pthread_mutex_lock(&g_umq_perf_record_ctx->lock);
+    umq_clear_all_perf_record();
+    (void)pthread_mutex_unlock(&g_umq_perf_record_ctx->lock);
+
+    // set quantile bucket, thresh is in ns as samples are
     uint32_t idx = 0;
+    (void)memset(g_umq_perf_record_ctx->perf_quantile_thresh, 0, sizeof(g_umq_perf_record_ctx->perf_quantile_thresh));
     for (uint32_t i = 0; i < thresh_num; ++i) {
         if (thresh_array[i] > UMQ_PERF_MAX_THRESH_NS) {
             continue;
         }
         if (idx == 0 || thresh_array[i] > g_umq_perf_record_ctx->perf_quantile_thresh[idx - 1]) {
-            g_umq_perf_record_ctx->perf_quantile_thresh[idx++] = thresh_array[i] * urpc_get_cpu_hz() / NS_PER_SEC;
+            g_umq_perf_record_ctx->perf_quantile_thresh[idx++] = thresh_array[i];
         }
     }
 
+    // samples are recorded in ns, so that quantiles of all records share the same histogram buckets
+    g_umq_perf_record_ctx->ns_per_cycle = (double)NS_PER_SEC / (double)urpc_get_cpu_hz();
     g_umq_perf_record_enable = true;
     UMQ_VLOG_INFO("IO perf record started successfully, set %u thresh\n", idx);
     return UMQ_SUCCESS;
@@ -213,17 +291,14 @@ int umq_perf_stop(void)
 
 int umq_perf_clear(void)
 {
-    if (g_umq_perf_record_enable) {
+    if (g_umq_perf_record_ctx == NULL || g_umq_perf_record_enable) {
         UMQ_VLOG_ERR("IO perf has been started\n");
         return -UMQ_ERR_EEXIST;
     }
 
     (void)pthread_mutex_lock(&g_umq_perf_record_ctx->lock);
-    for (uint32_t i = 0; i < UMQ_PERF_REC_MAX_NUM; ++i) {
-        umq_clear_perf_record_item(i);
-    }
-
-    (void)memset(g_umq_perf_record_ctx->perf_quantile_thresh, 0, UMQ_PERF_QUANTILE_MAX_NUM * sizeof(uint64_t));
+    umq_clear_all_perf_record();
+    (void)memset(g_umq_perf_record_ctx->perf_quantile_thresh, 0, sizeof(g_umq_perf_record_ctx->perf_quantile_thresh));
     if (g_umq_perf_record_ctx->perf_record_msg != NULL) {
         free(g_umq_perf_record_ctx->perf_record_msg);
         g_umq_perf_record_ctx->perf_record_msg = NULL;
@@ -233,27 +308,6 @@ int umq_perf_clear(void)
     return UMQ_SUCCESS;
 }
 
-static inline uint64_t cpu_cycles_to_ns(uint64_t cycles)
-{
-    // The CPU frequency is around X GHz, so dividing by CPU hz will solve the overflow issue.
-    if (cycles != 0 && UINT64_MAX / cycles <= NS_PER_SEC) {
-        return cycles / urpc_get_cpu_hz() * NS_PER_SEC;
-    } else {
-        return cycles * NS_PER_SEC / urpc_get_cpu_hz();
-    }
-}
-
-static inline void umq_perf_convert_cycles_to_ns(umq_perf_record_t *perf_rec)
-{
-    for (int type = 0; type < UMQ_PERF_RECORD_TYPE_MAX; ++type) {
-        perf_rec->type_record[type].accumulation = cpu_cycles_to_ns(perf_rec->type_record[type].accumulation);
-        // min default value is inited as UINT64_MAX, we output it as 0 for readability
-        perf_rec->type_record[type].min =
-            perf_rec->type_record[type].min == UINT64_MAX ? 0 : cpu_cycles_to_ns(perf_rec->type_record[type].min);
-        perf_rec->type_record[type].max = cpu_cycles_to_ns(perf_rec->type_record[type].max);
-    }
-}
-
 int umq_perf_info_get(umq_perf_infos_t **perf_info)
 {
     if (g_umq_perf_record_ctx == NULL || g_umq_perf_record_enable) {
@@ -262,27 +316,49 @@ int umq_perf_info_get(umq_perf_infos_t **perf_info)
     }
 
     (void)pthread_mutex_lock(&g_umq_perf_record_ctx->lock);
+    // thread num may grow since last get, so the message is rebuilt every time, one more slot for the total record
+    free(g_umq_perf_record_ctx->perf_record_msg);
+    g_umq_perf_record_ctx->perf_record_msg = (umq_perf_infos_t *)malloc(
+        sizeof(umq_perf_infos_t) + sizeof(umq_perf_record_t *) * (g_umq_perf_record_ctx->record_num + 1));
     if (g_umq_perf_record_ctx->perf_record_msg == NULL) {
-        g_umq_perf_record_ctx->perf_record_msg =
-            (umq_perf_infos_t *)malloc(sizeof(umq_perf_record_t) * UMQ_PERF_REC_MAX_NUM + sizeof(uint32_t));
-        if (g_umq_perf_record_ctx->perf_record_msg == NULL) {
-            UMQ_VLOG_ERR("malloc for perf_record_msg failed\n");
-            return UMQ_FAIL;
-        }
+        (void)pthread_mutex_unlock(&g_umq_perf_record_ctx->lock);
+        UMQ_VLOG_ERR("malloc for perf_record_msg failed\n");
+        return -UMQ_ERR_ENOMEM;
     }
 
-    g_umq_perf_record_ctx->perf_record_msg->perf_record_num = 0;
-    for (uint32_t i = 0; i < UMQ_PERF_REC_MAX_NUM; ++i) {
-        if (!g_umq_perf_record_ctx->perf_record_table[i].is_used) {
+    umq_perf_infos_t *msg = g_umq_perf_record_ctx->perf_record_msg;
+    umq_perf_record_t *total = &g_umq_perf_record_ctx->total_record;
+    umq_clear_perf_record(total);
+    umq_merge_perf_record(total, &g_umq_perf_record_ctx->exited_record);
+    total->is_used = true;
+    msg->perf_record_num = 0;
+    for (umq_perf_thread_record_t *cur = g_umq_perf_record_ctx->record_list; cur != NULL; cur = cur->next) {
+        if (!cur->record.is_used) {
             continue;
         }
-        g_umq_perf_record_ctx->perf_record_msg->perf_record[i] = &g_umq_perf_record_ctx->perf_record_table[i];
-        g_umq_perf_record_ctx->perf_record_msg->perf_record_num++;
-        umq_perf_convert_cycles_to_ns(g_umq_perf_record_ctx->perf_record_msg->perf_record[i]);
+        umq_merge_perf_record(total, &cur->record);
+        msg->perf_record[msg->perf_record_num++] = &cur->record;
     }
+    msg->perf_record[msg->perf_record_num] = total;
 
-    *perf_info = g_umq_perf_record_ctx->perf_record_msg;
-    UMQ_VLOG_INFO("Perf record stopped\n");
+    *perf_info = msg;
     (void)pthread_mutex_unlock(&g_umq_perf_record_ctx->lock);
-    return 0;
+    return UMQ_SUCCESS;
+}
+
+uint64_t umq_perf_quantile_get(const umq_perf_record_t *record, umq_perf_record_type_t type, double quantile)
+{
+    if (record == NULL || type >= UMQ_PERF_RECORD_TYPE_MAX || quantile < 0 || quantile > 1) {
+        UMQ_VLOG_ERR("invalid parameter\n");
+        return 0;
+    }
+
+    uint64_t value = util_hist_quantile((const util_hist_t *)record->hist[type],
+        record->type_record[type].cnt, quantile);
+    // the middle of bucket may be out of the range recorded
+    if (record->type_record[type].cnt != 0) {
+        value = value < record->type_record[type].min ? record->type_record[type].min : value;
+        value = value > record->type_record[type].max ? record->type_record[type].max : value;
+    }
+    return value;
 }
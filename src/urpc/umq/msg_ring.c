@@ -13,7 +13,15 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <errno.h>
-
+#include <time.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stddef.h>
+
+#include "urpc_util.h"
+#include "urpc_thread_closure.h"
+#include "umq_errno.h"
 #include "umq_vlog.h"
 #include "msg_ring.h"
 
@@ -21,29 +29,187 @@
 #define NUM_RING_HEADERS  (2)
 
 typedef struct shm_ring_buf_hdr {
-    volatile uint32_t avail_buf_size;
+    uint32_t avail_buf_size;
 } shm_ring_buf_hdr_t;
 
+// header of record in byte stream mode, records are aligned to MSG_RING_REC_ALIGN
+typedef struct shm_ring_rec_hdr {
+    uint32_t len;               // payload length, or bytes skipped to ring end for padding record
+    uint32_t flag;
+} shm_ring_rec_hdr_t;
+
+#define MSG_RING_DEPTH_MAX (1U << 31)
+#define MSG_RING_REC_ALIGN (8U)
+#define MSG_RING_REC_FLAG_PAD (1U)
+#define MSG_RING_SPIN_WINDOW_MIN_NS (1000)
+#define MSG_RING_SPIN_CHECK_INTERVAL (64)      // read clock once every such spins
+
 #if defined(__x86_64__)
-#define MB() asm volatile("mfence" ::: "memory")
-#define RMB() asm volatile("lfence" ::: "memory")
-#define WMB() asm volatile("sfence" ::: "memory")
+#define MSG_RING_CPU_RELAX() asm volatile("pause" ::: "memory")
 #elif defined(__aarch64__)
-#define DSB(opt) asm volatile("DSB " #opt : : : "memory")
-#define MB() DSB(sy)
-#define RMB() DSB(ld)
-#define WMB() DSB(st)
+#define MSG_RING_CPU_RELAX() asm volatile("yield" ::: "memory")
+#else
+#define MSG_RING_CPU_RELAX() asm volatile("" ::: "memory")
 #endif
 
+#define MSG_RING_STATS_ALIGN (64)
+// counters of umq_ipc_wakeup_stats_t, spin_window_ns is the last field and is not summed
+#define MSG_RING_WAKEUP_CNT_NUM (offsetof(umq_ipc_wakeup_stats_t, spin_window_ns) / sizeof(uint64_t))
+
+// wakeup stats of one thread, written by that thread only so that wait and notify take no shared cache line
+typedef struct msg_ring_wakeup_stats_block {
+    umq_ipc_wakeup_stats_t stats;
+    uint64_t last_wait_ns;          // spin_window_ns of the block which waited last is reported
+    struct msg_ring_wakeup_stats_block *next;
+} __attribute__((aligned(MSG_RING_STATS_ALIGN))) msg_ring_wakeup_stats_block_t;
+
+static pthread_mutex_t g_msg_ring_wakeup_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static msg_ring_wakeup_stats_block_t *g_msg_ring_wakeup_stats_blocks;      // blocks of live threads
+static msg_ring_wakeup_stats_block_t g_msg_ring_wakeup_stats_retired;      // stats folded from exited threads
+static msg_ring_wakeup_stats_block_t g_msg_ring_wakeup_stats_base;         // sums at last clear
+static msg_ring_wakeup_stats_block_t g_msg_ring_wakeup_stats_discard;      // taken if a block can not be allocated
+static __thread msg_ring_wakeup_stats_block_t *g_msg_ring_wakeup_stats_local;
+static umq_ipc_wakeup_stats_t g_msg_ring_wakeup_stats_snapshot;
+
+/*
+ * pi is published with release after slots are written, and ci with release after slots are read.
+ * peer index is loaded with acquire only when the cached copy says the ring is full or empty,
+ * so that producer and consumer do not bounce each other's cache line on every call
+ */
+static inline uint32_t msg_ring_depth_align(uint32_t depth)
+{
+    uint32_t aligned = 1;
+    while (aligned < depth) {
+        aligned <<= 1;
+    }
+    return aligned;
+}
+
+static inline uint32_t msg_ring_rec_size(uint32_t len)
+{
+    return (uint32_t)((sizeof(shm_ring_rec_hdr_t) + len + MSG_RING_REC_ALIGN - 1) & ~(MSG_RING_REC_ALIGN - 1));
+}
+
+/*
+ * bytes of one ring. slot mode: depth slots of max_buf_size.
+ * byte stream mode: the same footprint rounded down to power of 2, but not less than two records of max size,
+ * so that a record and the padding before it always fit
+ */
+static inline uint64_t msg_ring_ring_size(uint32_t depth, uint32_t max_buf_size, bool byte_stream)
+{
+    uint64_t size = (uint64_t)msg_ring_depth_align(depth) * max_buf_size;
+    if (!byte_stream) {
+        return size;
+    }
+
+    uint64_t min_size = (uint64_t)msg_ring_rec_size(max_buf_size - (uint32_t)sizeof(shm_ring_buf_hdr_t)) << 1;
+    uint64_t aligned = 1;
+    while ((aligned << 1) <= size) {
+        aligned <<= 1;
+    }
+    while (aligned < min_size) {
+        aligned <<= 1;
+    }
+    return aligned;
+}
+
+static inline char *msg_ring_slot(void *ring, uint32_t idx, uint32_t depth, uint32_t max_buf_size)
+{
+    return (char *)ring + (uint64_t)(idx & (depth - 1)) * max_buf_size;
+}
+
+// free slots seen by producer, refresh cached ci only if it is not enough
+static inline uint32_t msg_ring_free_cnt(shm_ring_hdr_t *hdr, uint32_t pi, uint32_t depth, uint32_t *cached_ci,
+    uint32_t need)
+{
+    uint32_t free_cnt = depth - (pi - *cached_ci);
+    if (free_cnt >= need) {
+        return free_cnt;
+    }
+    *cached_ci = __atomic_load_n(&hdr->ci, __ATOMIC_ACQUIRE);
+    return depth - (pi - *cached_ci);
+}
+
+// used slots seen by consumer, refresh cached pi only if it is not enough
+static inline uint32_t msg_ring_used_cnt(shm_ring_hdr_t *hdr, uint32_t ci, uint32_t *cached_pi, uint32_t need)
+{
+    uint32_t used_cnt = *cached_pi - ci;
+    if (used_cnt >= need) {
+        return used_cnt;
+    }
+    *cached_pi = __atomic_load_n(&hdr->pi, __ATOMIC_ACQUIRE);
+    return *cached_pi - ci;
+}
+
+static void msg_ring_hdr_init(shm_ring_hdr_t *hdr, uint32_t depth, uint32_t max_buf_size, bool byte_stream)
+{
+    hdr->version = MSG_RING_LAYOUT_VERSION;
+    hdr->depth = depth;
+    hdr->max_buf_size = max_buf_size;
+    hdr->byte_stream = byte_stream ? 1 : 0;
+    hdr->pi = 0;
+    hdr->ci = 0;
+    atomic_init(&hdr->cq_event_flag, 0);
+    atomic_init(&hdr->pending_events, 0);
+    atomic_init(&hdr->sleeping_waiters, 0);
+    // peer checks magic first, publish it after all other fields
+    __atomic_store_n(&hdr->magic, MSG_RING_MAGIC, __ATOMIC_RELEASE);
+}
+
+static int msg_ring_hdr_check(shm_ring_hdr_t *hdr, uint32_t depth, uint32_t max_buf_size, bool byte_stream)
+{
+    uint32_t magic = __atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE);
+    if (magic != MSG_RING_MAGIC || hdr->version != MSG_RING_LAYOUT_VERSION) {
+        UMQ_VLOG_ERR("msg ring layout mismatch, magic: 0x%x, version: %u, expect version: %u\n", magic,
+            hdr->version, MSG_RING_LAYOUT_VERSION);
+        return -1;
+    }
+
+    if (hdr->depth != depth || hdr->max_buf_size != max_buf_size) {
+        UMQ_VLOG_ERR("msg ring option mismatch, depth: %u, max_buf_size: %u, expect depth: %u, max_buf_size: %u\n",
+            hdr->depth, hdr->max_buf_size, depth, max_buf_size);
+        return -1;
+    }
+
+    if (hdr->byte_stream != (byte_stream ? 1U : 0U)) {
+        UMQ_VLOG_ERR("msg ring mode mismatch, byte_stream: %u, expect: %d\n", hdr->byte_stream, byte_stream);
+        return -1;
+    }
+    return 0;
+}
+
+uint64_t msg_ring_shm_size(msg_ring_option_t *opt)
+{
+    return NUM_RING_HEADERS * (uint64_t)sizeof(shm_ring_hdr_t) +
+        msg_ring_ring_size(opt->tx_depth, opt->tx_max_buf_size, opt->byte_stream) +
+        msg_ring_ring_size(opt->rx_depth, opt->rx_max_buf_size, opt->byte_stream);
+}
+
 msg_ring_t *msg_ring_create(char *msg_ring_name, uint32_t msg_ring_name_len, msg_ring_option_t *opt)
 {
     int ret;
     void *ptr;
-    uint32_t shm_size;
+    uint32_t shm_size = 0;
     if (msg_ring_name_len > MAX_MSG_RING_NAME) {
         return NULL;
     }
 
+    if (opt->tx_depth == 0 || opt->tx_depth > MSG_RING_DEPTH_MAX || opt->rx_depth == 0 ||
+        opt->rx_depth > MSG_RING_DEPTH_MAX || opt->tx_max_buf_size <= sizeof(shm_ring_buf_hdr_t) ||
+        opt->rx_max_buf_size <= sizeof(shm_ring_buf_hdr_t)) {
+        UMQ_VLOG_ERR("msg ring option invalid, tx_depth: %u, rx_depth: %u, tx_max_buf_size: %u, "
+            "rx_max_buf_size: %u\n", opt->tx_depth, opt->rx_depth, opt->tx_max_buf_size, opt->rx_max_buf_size);
+        return NULL;
+    }
+
+    uint64_t tx_ring_size = msg_ring_ring_size(opt->tx_depth, opt->tx_max_buf_size, opt->byte_stream);
+    uint64_t rx_ring_size = msg_ring_ring_size(opt->rx_depth, opt->rx_max_buf_size, opt->byte_stream);
+    if (tx_ring_size > MSG_RING_DEPTH_MAX || rx_ring_size > MSG_RING_DEPTH_MAX) {
+        UMQ_VLOG_ERR("msg ring size exceeds limit, tx_ring_size: %lu, rx_ring_size: %lu\n", tx_ring_size,
+            rx_ring_size);
+        return NULL;
+    }
+
     msg_ring_t *msg_ring_h = (msg_ring_t *)calloc(1, sizeof(msg_ring_t));
     if (msg_ring_h == NULL) {
         UMQ_VLOG_ERR("msg ring calloc failed\n");
@@ -55,8 +221,12 @@ msg_ring_t *msg_ring_create(char *msg_ring_name, uint32_t msg_ring_name_len, msg
     (void)memcpy(msg_ring_h->msg_ring_name, msg_ring_name, msg_ring_name_len);
 
     if (opt->addr == NULL) {
-        shm_size = opt->tx_depth * opt->tx_max_buf_size +
-                   opt->rx_depth * opt->rx_max_buf_size + NUM_RING_HEADERS * (uint32_t)sizeof(shm_ring_hdr_t);
+        uint64_t total_size = msg_ring_shm_size(opt);
+        if (total_size > UINT32_MAX) {
+            UMQ_VLOG_ERR("msg ring size %lu exceeds limit\n", total_size);
+            goto ERR_SHM_OPEN;
+        }
+        shm_size = (uint32_t)total_size;
 
         if (opt->owner) {
             shm_fd = shm_open(msg_ring_name, O_CREAT | O_RDWR | O_EXCL, SHM_MODE);
@@ -91,32 +261,42 @@ msg_ring_t *msg_ring_create(char *msg_ring_name, uint32_t msg_ring_name_len, msg
         ptr = opt->addr;
     }
 
-    /* msg_ring share memory layout
-     * tx ring | rx ring | tx ring header | rx ring header
+    /* msg_ring share memory layout, headers are placed first to keep them cache line aligned
+     * tx ring header | rx ring header | tx ring | rx ring
      */
-    msg_ring_h->shm_tx_ring = ptr;
-    msg_ring_h->shm_rx_ring = msg_ring_h->shm_tx_ring + opt->tx_depth * opt->tx_max_buf_size;
-    msg_ring_h->shm_tx_ring_hdr =
-        (shm_ring_hdr_t *)(msg_ring_h->shm_rx_ring + opt->rx_depth * opt->rx_max_buf_size);
-    msg_ring_h->shm_rx_ring_hdr = (shm_ring_hdr_t *)(msg_ring_h->shm_tx_ring_hdr + sizeof(shm_ring_hdr_t));
+    uint32_t tx_depth = msg_ring_depth_align(opt->tx_depth);
+    uint32_t rx_depth = msg_ring_depth_align(opt->rx_depth);
+    msg_ring_h->shm_tx_ring_hdr = (shm_ring_hdr_t *)ptr;
+    msg_ring_h->shm_rx_ring_hdr = msg_ring_h->shm_tx_ring_hdr + 1;
+    msg_ring_h->shm_tx_ring = (void *)(msg_ring_h->shm_rx_ring_hdr + 1);
+    msg_ring_h->shm_rx_ring = (char *)msg_ring_h->shm_tx_ring + tx_ring_size;
+    bool byte_stream = opt->byte_stream;
     if (opt->owner) {
-        msg_ring_h->shm_tx_ring_hdr->ci = 0;
-        msg_ring_h->shm_tx_ring_hdr->pi = 0;
-        atomic_init(&msg_ring_h->shm_tx_ring_hdr->cq_event_flag, 0);
-        atomic_init(&msg_ring_h->shm_tx_ring_hdr->pending_events, 0);
-
-        msg_ring_h->shm_rx_ring_hdr->ci = 0;
-        msg_ring_h->shm_rx_ring_hdr->pi = 0;
-        atomic_init(&msg_ring_h->shm_rx_ring_hdr->cq_event_flag, 0);
-        atomic_init(&msg_ring_h->shm_rx_ring_hdr->pending_events, 0);
+        msg_ring_hdr_init(msg_ring_h->shm_tx_ring_hdr, tx_depth, opt->tx_max_buf_size, byte_stream);
+        msg_ring_hdr_init(msg_ring_h->shm_rx_ring_hdr, rx_depth, opt->rx_max_buf_size, byte_stream);
+    } else if (msg_ring_hdr_check(msg_ring_h->shm_tx_ring_hdr, tx_depth, opt->tx_max_buf_size, byte_stream) != 0 ||
+        msg_ring_hdr_check(msg_ring_h->shm_rx_ring_hdr, rx_depth, opt->rx_max_buf_size, byte_stream) != 0) {
+        goto ERR_HDR_CHECK;
     }
 
+    msg_ring_h->byte_stream = byte_stream;
+    msg_ring_h->tx_ring_size = (uint32_t)tx_ring_size;
+    msg_ring_h->rx_ring_size = (uint32_t)rx_ring_size;
+
     msg_ring_h->tx_max_buf_size = opt->tx_max_buf_size;
-    msg_ring_h->tx_depth = opt->tx_depth;
+    msg_ring_h->tx_depth = tx_depth;
+    msg_ring_h->tx_cached_pi = __atomic_load_n(&msg_ring_h->shm_tx_ring_hdr->pi, __ATOMIC_ACQUIRE);
+    msg_ring_h->tx_cached_ci = __atomic_load_n(&msg_ring_h->shm_tx_ring_hdr->ci, __ATOMIC_ACQUIRE);
     msg_ring_h->rx_max_buf_size = opt->rx_max_buf_size;
-    msg_ring_h->rx_depth = opt->rx_depth;
+    msg_ring_h->rx_depth = rx_depth;
+    msg_ring_h->rx_cached_pi = __atomic_load_n(&msg_ring_h->shm_rx_ring_hdr->pi, __ATOMIC_ACQUIRE);
+    msg_ring_h->rx_cached_ci = __atomic_load_n(&msg_ring_h->shm_rx_ring_hdr->ci, __ATOMIC_ACQUIRE);
     return msg_ring_h;
 
+ERR_HDR_CHECK:
+    if (opt->addr == NULL) {
+        munmap(ptr, shm_size);
+    }
 ERR_SHM_MMAP:
 ERR_SHM_SIZE:
     if (shm_fd != -1) {
@@ -134,8 +314,8 @@ ERR_SHM_OPEN:
 void msg_ring_destroy(msg_ring_t *msg_ring_h)
 {
     if (msg_ring_h->shm_fd != -1) {
-        munmap(msg_ring_h->shm_tx_ring, msg_ring_h->shm_size);
-        msg_ring_h->shm_tx_ring = NULL;
+        munmap(msg_ring_h->shm_tx_ring_hdr, msg_ring_h->shm_size);
+        msg_ring_h->shm_tx_ring_hdr = NULL;
         close(msg_ring_h->shm_fd);
         msg_ring_h->shm_fd = -1;
         if (msg_ring_h->owner) {
@@ -145,208 +325,543 @@ void msg_ring_destroy(msg_ring_t *msg_ring_h)
     free(msg_ring_h);
 }
 
-int msg_ring_post_tx(msg_ring_t *msg_ring_h, char *tx_buf, uint32_t tx_buf_size)
+static inline void msg_ring_slot_write(char *slot, char *buf, uint32_t buf_size)
 {
-    uint32_t payload_size = msg_ring_h->tx_max_buf_size - (uint32_t)sizeof(shm_ring_buf_hdr_t);
-    if (tx_buf_size > payload_size) {
-        UMQ_LIMIT_VLOG_ERR("post tx failed, payload_size %u is less than tx_buf_size %u\n",
-                           payload_size, tx_buf_size);
+    shm_ring_buf_hdr_t *ring_buf_hdr = (shm_ring_buf_hdr_t *)slot;
+    (void)memcpy((char *)(ring_buf_hdr + 1), buf, buf_size);
+    ring_buf_hdr->avail_buf_size = buf_size;
+}
+
+static inline int msg_ring_slot_read(char *slot, char *buf, uint32_t max_buf_size, uint32_t *avail_buf_size)
+{
+    shm_ring_buf_hdr_t *ring_buf_hdr = (shm_ring_buf_hdr_t *)slot;
+    uint32_t size = ring_buf_hdr->avail_buf_size;
+    if (max_buf_size < size) {
+        UMQ_LIMIT_VLOG_ERR("max_buf_size %u is less than avail_buf_size %u\n", max_buf_size, size);
+        return -1;
+    }
+    (void)memcpy(buf, (char *)(ring_buf_hdr + 1), size);
+    *avail_buf_size = size;
+    return 0;
+}
+
+static inline int msg_ring_post(shm_ring_hdr_t *hdr, void *ring, uint32_t depth, uint32_t max_buf_size,
+    uint32_t *cached_ci, char *buf, uint32_t buf_size)
+{
+    uint32_t payload_size = max_buf_size - (uint32_t)sizeof(shm_ring_buf_hdr_t);
+    if (buf_size > payload_size) {
+        UMQ_LIMIT_VLOG_ERR("post failed, payload_size %u is less than buf_size %u\n", payload_size, buf_size);
         return -1;
     }
 
-    shm_ring_hdr_t *tx_ring_hdr = (shm_ring_hdr_t *)msg_ring_h->shm_tx_ring_hdr;
-    if ((tx_ring_hdr->pi + 1) % msg_ring_h->tx_depth == tx_ring_hdr->ci) {
-        UMQ_LIMIT_VLOG_ERR("post tx failed, the queue is full\n");
+    uint32_t pi = __atomic_load_n(&hdr->pi, __ATOMIC_RELAXED);
+    if (msg_ring_free_cnt(hdr, pi, depth, cached_ci, 1) == 0) {
+        UMQ_LIMIT_VLOG_ERR("post failed, the queue is full\n");
         return -EAGAIN;
     }
 
-    MB();
-    shm_ring_buf_hdr_t *ring_buf_hdr = (shm_ring_buf_hdr_t *)(msg_ring_h->shm_tx_ring +
-        tx_ring_hdr->pi * msg_ring_h->tx_max_buf_size);
-    char *ring_buf_p = (char *)(ring_buf_hdr + 1);
-    (void)memcpy(ring_buf_p, tx_buf, tx_buf_size);
-    ring_buf_hdr->avail_buf_size = tx_buf_size;
+    msg_ring_slot_write(msg_ring_slot(ring, pi, depth, max_buf_size), buf, buf_size);
+    // Ensure that we post buf before we update pi
+    __atomic_store_n(&hdr->pi, pi + 1, __ATOMIC_RELEASE);
+    return 0;
+}
 
-    // Ensure that we post tx_buf before we update pi
-    WMB();
-    tx_ring_hdr->pi = (tx_ring_hdr->pi + 1) % msg_ring_h->tx_depth;
+static inline int msg_ring_poll(shm_ring_hdr_t *hdr, void *ring, uint32_t depth, uint32_t max_buf_size,
+    uint32_t *cached_pi, char *buf, uint32_t buf_max_size, uint32_t *avail_buf_size)
+{
+    uint32_t ci = __atomic_load_n(&hdr->ci, __ATOMIC_RELAXED);
+    if (msg_ring_used_cnt(hdr, ci, cached_pi, 1) == 0) {
+        return -1;
+    }
+
+    if (msg_ring_slot_read(msg_ring_slot(ring, ci, depth, max_buf_size), buf, buf_max_size, avail_buf_size) != 0) {
+        return -1;
+    }
+    // Ensure that we poll buf before we update ci
+    __atomic_store_n(&hdr->ci, ci + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static inline int msg_ring_poll_batch(shm_ring_hdr_t *hdr, void *ring, uint32_t depth, uint32_t max_buf_size,
+    uint32_t *cached_pi, char **buf, uint32_t buf_max_size, uint32_t *avail_buf_size, uint32_t max_cnt)
+{
+    uint32_t ci = __atomic_load_n(&hdr->ci, __ATOMIC_RELAXED);
+    uint32_t left_cnt = msg_ring_used_cnt(hdr, ci, cached_pi, max_cnt);
+    uint32_t cnt = left_cnt < max_cnt ? left_cnt : max_cnt;
+    if (cnt == 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < cnt; ++i) {
+        if (msg_ring_slot_read(msg_ring_slot(ring, ci + i, depth, max_buf_size), buf[i], buf_max_size,
+            &avail_buf_size[i]) != 0) {
+            return -1;
+        }
+    }
+
+    // Ensure that we poll buf before we update ci
+    __atomic_store_n(&hdr->ci, ci + cnt, __ATOMIC_RELEASE);
+    return (int)cnt;
+}
 
+/*
+ * byte stream mode, records are packed back to back. a record never wraps: if it does not fit before ring end,
+ * a padding record covering the rest of ring is written first and the record starts at offset 0
+ */
+static inline int msg_ring_stream_post(shm_ring_hdr_t *hdr, void *ring, uint32_t ring_size, uint32_t max_buf_size,
+    uint32_t *cached_ci, char **buf, uint32_t *buf_size, uint32_t cnt)
+{
+    uint32_t payload_size = max_buf_size - (uint32_t)sizeof(shm_ring_buf_hdr_t);
+    uint32_t pi = __atomic_load_n(&hdr->pi, __ATOMIC_RELAXED);
+    uint32_t end = pi;
+    for (uint32_t i = 0; i < cnt; ++i) {
+        if (buf_size[i] > payload_size) {
+            UMQ_LIMIT_VLOG_ERR("post failed, payload_size %u is less than buf_size %u\n", payload_size, buf_size[i]);
+            return -1;
+        }
+        uint32_t rec_size = msg_ring_rec_size(buf_size[i]);
+        uint32_t off = end & (ring_size - 1);
+        end += (off + rec_size > ring_size) ? (ring_size - off) + rec_size : rec_size;
+    }
+
+    if (msg_ring_free_cnt(hdr, pi, ring_size, cached_ci, end - pi) < end - pi) {
+        return -EAGAIN;
+    }
+
+    for (uint32_t i = 0; i < cnt; ++i) {
+        uint32_t rec_size = msg_ring_rec_size(buf_size[i]);
+        uint32_t off = pi & (ring_size - 1);
+        if (off + rec_size > ring_size) {
+            shm_ring_rec_hdr_t *pad = (shm_ring_rec_hdr_t *)((char *)ring + off);
+            pad->len = ring_size - off;
+            pad->flag = MSG_RING_REC_FLAG_PAD;
+            pi += ring_size - off;
+            off = 0;
+        }
+        shm_ring_rec_hdr_t *rec = (shm_ring_rec_hdr_t *)((char *)ring + off);
+        rec->len = buf_size[i];
+        rec->flag = 0;
+        (void)memcpy((char *)(rec + 1), buf[i], buf_size[i]);
+        pi += rec_size;
+    }
+
+    // Ensure that we post records before we update pi
+    __atomic_store_n(&hdr->pi, pi, __ATOMIC_RELEASE);
     return 0;
 }
 
+static inline int msg_ring_stream_poll(shm_ring_hdr_t *hdr, void *ring, uint32_t ring_size, uint32_t *cached_pi,
+    char **buf, uint32_t buf_max_size, uint32_t *avail_buf_size, uint32_t max_cnt)
+{
+    uint32_t ci = __atomic_load_n(&hdr->ci, __ATOMIC_RELAXED);
+    uint32_t used = msg_ring_used_cnt(hdr, ci, cached_pi, 1);
+    if (used > ring_size) {
+        UMQ_LIMIT_VLOG_ERR("poll failed, used bytes %u exceed ring size %u\n", used, ring_size);
+        return -1;
+    }
+
+    /* records are written by peer in share memory, each length is read once and checked against both bytes
+     * posted and ring end before it is used, so that a corrupted length never reads out of ring */
+    uint32_t end = ci + used;
+    uint32_t cnt = 0;
+    while (cnt < max_cnt && ci != end) {
+        uint32_t off = ci & (ring_size - 1);
+        uint32_t limit = end - ci < ring_size - off ? end - ci : ring_size - off;
+        shm_ring_rec_hdr_t *rec = (shm_ring_rec_hdr_t *)((char *)ring + off);
+        uint32_t len = __atomic_load_n(&rec->len, __ATOMIC_RELAXED);
+        if ((__atomic_load_n(&rec->flag, __ATOMIC_RELAXED) & MSG_RING_REC_FLAG_PAD) != 0) {
+            if (len == 0 || len > limit) {
+                UMQ_LIMIT_VLOG_ERR("poll failed, invalid padding length %u, limit %u\n", len, limit);
+                return -1;
+            }
+            ci += len;
+            continue;
+        }
+        if (len > limit || msg_ring_rec_size(len) > limit) {
+            UMQ_LIMIT_VLOG_ERR("poll failed, invalid record length %u, limit %u\n", len, limit);
+            return -1;
+        }
+        if (buf_max_size < len) {
+            UMQ_LIMIT_VLOG_ERR("max_buf_size %u is less than avail_buf_size %u\n", buf_max_size, len);
+            return -1;
+        }
+        (void)memcpy(buf[cnt], (char *)(rec + 1), len);
+        avail_buf_size[cnt++] = len;
+        ci += msg_ring_rec_size(len);
+    }
+
+    // Ensure that we poll records before we update ci, padding records consumed are released too
+    __atomic_store_n(&hdr->ci, ci, __ATOMIC_RELEASE);
+    return (int)cnt;
+}
+
+int msg_ring_post_tx(msg_ring_t *msg_ring_h, char *tx_buf, uint32_t tx_buf_size)
+{
+    if (msg_ring_h->byte_stream) {
+        int ret = msg_ring_stream_post(msg_ring_h->shm_tx_ring_hdr, msg_ring_h->shm_tx_ring, msg_ring_h->tx_ring_size,
+            msg_ring_h->tx_max_buf_size, &msg_ring_h->tx_cached_ci, &tx_buf, &tx_buf_size, 1);
+        if (ret == -EAGAIN) {
+            UMQ_LIMIT_VLOG_ERR("post tx failed, the queue is full\n");
+        }
+        return ret;
+    }
+
+    return msg_ring_post(msg_ring_h->shm_tx_ring_hdr, msg_ring_h->shm_tx_ring, msg_ring_h->tx_depth,
+        msg_ring_h->tx_max_buf_size, &msg_ring_h->tx_cached_ci, tx_buf, tx_buf_size);
+}
+
 int msg_ring_post_tx_batch(msg_ring_t *msg_ring_h, char **tx_buf, uint32_t *tx_buf_size, uint32_t tx_buf_cnt)
 {
+    if (msg_ring_h->byte_stream) {
+        if (msg_ring_stream_post(msg_ring_h->shm_tx_ring_hdr, msg_ring_h->shm_tx_ring, msg_ring_h->tx_ring_size,
+            msg_ring_h->tx_max_buf_size, &msg_ring_h->tx_cached_ci, tx_buf, tx_buf_size, tx_buf_cnt) != 0) {
+            UMQ_LIMIT_VLOG_ERR("post tx batch failed, tx_cnt %u\n", tx_buf_cnt);
+            return -1;
+        }
+        return 0;
+    }
+
+    shm_ring_hdr_t *tx_ring_hdr = msg_ring_h->shm_tx_ring_hdr;
+    uint32_t payload_size = msg_ring_h->tx_max_buf_size - (uint32_t)sizeof(shm_ring_buf_hdr_t);
+    for (uint32_t i = 0; i < tx_buf_cnt; ++i) {
+        if (tx_buf_size[i] > payload_size) {
+            UMQ_LIMIT_VLOG_ERR("post tx batch failed, payload_size %u is less than tx_buf_size %u\n",
+                               payload_size, tx_buf_size[i]);
+            return -1;
+        }
+    }
+
     // rest empty count
-    shm_ring_hdr_t *tx_ring_hdr = (shm_ring_hdr_t *)msg_ring_h->shm_tx_ring_hdr;
-    uint32_t left_cnt = (tx_ring_hdr->ci + msg_ring_h->tx_depth - tx_ring_hdr->pi - 1) % msg_ring_h->tx_depth;
+    uint32_t pi = __atomic_load_n(&tx_ring_hdr->pi, __ATOMIC_RELAXED);
+    uint32_t left_cnt = msg_ring_free_cnt(tx_ring_hdr, pi, msg_ring_h->tx_depth, &msg_ring_h->tx_cached_ci,
+        tx_buf_cnt);
     if (left_cnt < tx_buf_cnt) {
         UMQ_LIMIT_VLOG_ERR("post tx batch failed, rest tx_depth %u is less than tx_cnt %u\n",
                            left_cnt, tx_buf_cnt);
         return -1;
     }
 
-    MB();
     for (uint32_t i = 0; i < tx_buf_cnt; ++i) {
-        shm_ring_buf_hdr_t *ring_buf_hdr = (shm_ring_buf_hdr_t *)(msg_ring_h->shm_tx_ring +
-            ((tx_ring_hdr->pi + i) % msg_ring_h->tx_depth) * msg_ring_h->tx_max_buf_size);
-        char *ring_buf_p = (char *)(ring_buf_hdr + 1);
-        (void)memcpy(ring_buf_p, tx_buf[i], tx_buf_size[i]);
-        ring_buf_hdr->avail_buf_size = tx_buf_size[i];
+        msg_ring_slot_write(msg_ring_slot(msg_ring_h->shm_tx_ring, pi + i, msg_ring_h->tx_depth,
+            msg_ring_h->tx_max_buf_size), tx_buf[i], tx_buf_size[i]);
     }
 
     // Ensure that we post tx_buf before we update pi
-    WMB();
-    tx_ring_hdr->pi = (tx_ring_hdr->pi + tx_buf_cnt) % msg_ring_h->tx_depth;
-
+    __atomic_store_n(&tx_ring_hdr->pi, pi + tx_buf_cnt, __ATOMIC_RELEASE);
     return 0;
 }
 
 int msg_ring_poll_tx(msg_ring_t *msg_ring_h, char *tx_buf, uint32_t tx_max_buf_size, uint32_t *avail_buf_size)
 {
-    shm_ring_hdr_t *tx_ring_hdr = (shm_ring_hdr_t *)msg_ring_h->shm_tx_ring_hdr;
-    if (tx_ring_hdr->pi == tx_ring_hdr->ci) {
-        return -1;
+    if (msg_ring_h->byte_stream) {
+        return msg_ring_stream_poll(msg_ring_h->shm_tx_ring_hdr, msg_ring_h->shm_tx_ring, msg_ring_h->tx_ring_size,
+            &msg_ring_h->tx_cached_pi, &tx_buf, tx_max_buf_size, avail_buf_size, 1) == 1 ? 0 : -1;
     }
+    return msg_ring_poll(msg_ring_h->shm_tx_ring_hdr, msg_ring_h->shm_tx_ring, msg_ring_h->tx_depth,
+        msg_ring_h->tx_max_buf_size, &msg_ring_h->tx_cached_pi, tx_buf, tx_max_buf_size, avail_buf_size);
+}
 
-    RMB();
-    shm_ring_buf_hdr_t *ring_buf_hdr = (shm_ring_buf_hdr_t *)(msg_ring_h->shm_tx_ring +
-        tx_ring_hdr->ci * msg_ring_h->tx_max_buf_size);
-    char *ring_buf_p = (char *)(ring_buf_hdr + 1);
-    if (tx_max_buf_size < ring_buf_hdr->avail_buf_size) {
-        UMQ_LIMIT_VLOG_ERR("tx_max_buf_size %u is less than avail_buf_size %u\n", tx_max_buf_size,
-                           ring_buf_hdr->avail_buf_size);
-        return -1;
+int msg_ring_poll_tx_batch(msg_ring_t *msg_ring_h, char **tx_buf, uint32_t tx_max_buf_size,
+    uint32_t *avail_buf_size, uint32_t max_cnt)
+{
+    if (msg_ring_h->byte_stream) {
+        return msg_ring_stream_poll(msg_ring_h->shm_tx_ring_hdr, msg_ring_h->shm_tx_ring, msg_ring_h->tx_ring_size,
+            &msg_ring_h->tx_cached_pi, tx_buf, tx_max_buf_size, avail_buf_size, max_cnt);
     }
-    (void)memcpy(tx_buf, ring_buf_p, ring_buf_hdr->avail_buf_size);
-    *avail_buf_size = ring_buf_hdr->avail_buf_size;
+    return msg_ring_poll_batch(msg_ring_h->shm_tx_ring_hdr, msg_ring_h->shm_tx_ring, msg_ring_h->tx_depth,
+        msg_ring_h->tx_max_buf_size, &msg_ring_h->tx_cached_pi, tx_buf, tx_max_buf_size, avail_buf_size, max_cnt);
+}
 
-    // Ensure that we poll tx_buf before we update ci
-    MB();
-    tx_ring_hdr->ci = (tx_ring_hdr->ci + 1) % msg_ring_h->tx_depth;
+int msg_ring_post_rx(msg_ring_t *msg_ring_h, char *rx_buf, uint32_t rx_buf_size)
+{
+    if (msg_ring_h->byte_stream) {
+        int ret = msg_ring_stream_post(msg_ring_h->shm_rx_ring_hdr, msg_ring_h->shm_rx_ring, msg_ring_h->rx_ring_size,
+            msg_ring_h->rx_max_buf_size, &msg_ring_h->rx_cached_ci, &rx_buf, &rx_buf_size, 1);
+        if (ret == -EAGAIN) {
+            UMQ_LIMIT_VLOG_ERR("post rx failed, the queue is full\n");
+        }
+        return ret;
+    }
+    return msg_ring_post(msg_ring_h->shm_rx_ring_hdr, msg_ring_h->shm_rx_ring, msg_ring_h->rx_depth,
+        msg_ring_h->rx_max_buf_size, &msg_ring_h->rx_cached_ci, rx_buf, rx_buf_size);
+}
 
-    return 0;
+int msg_ring_poll_rx(msg_ring_t *msg_ring_h, char *rx_buf, uint32_t rx_max_buf_size, uint32_t *avail_buf_size)
+{
+    if (msg_ring_h->byte_stream) {
+        return msg_ring_stream_poll(msg_ring_h->shm_rx_ring_hdr, msg_ring_h->shm_rx_ring, msg_ring_h->rx_ring_size,
+            &msg_ring_h->rx_cached_pi, &rx_buf, rx_max_buf_size, avail_buf_size, 1) == 1 ? 0 : -1;
+    }
+    return msg_ring_poll(msg_ring_h->shm_rx_ring_hdr, msg_ring_h->shm_rx_ring, msg_ring_h->rx_depth,
+        msg_ring_h->rx_max_buf_size, &msg_ring_h->rx_cached_pi, rx_buf, rx_max_buf_size, avail_buf_size);
 }
 
-int msg_ring_poll_tx_batch(msg_ring_t *msg_ring_h, char **tx_buf, uint32_t tx_max_buf_size,
+int msg_ring_poll_rx_batch(msg_ring_t *msg_ring_h, char **rx_buf, uint32_t rx_max_buf_size,
     uint32_t *avail_buf_size, uint32_t max_cnt)
 {
-    shm_ring_hdr_t *tx_ring_hdr = (shm_ring_hdr_t *)msg_ring_h->shm_tx_ring_hdr;
-    if (tx_ring_hdr->pi == tx_ring_hdr->ci) {
-        return 0;
+    if (msg_ring_h->byte_stream) {
+        return msg_ring_stream_poll(msg_ring_h->shm_rx_ring_hdr, msg_ring_h->shm_rx_ring, msg_ring_h->rx_ring_size,
+            &msg_ring_h->rx_cached_pi, rx_buf, rx_max_buf_size, avail_buf_size, max_cnt);
     }
+    return msg_ring_poll_batch(msg_ring_h->shm_rx_ring_hdr, msg_ring_h->shm_rx_ring, msg_ring_h->rx_depth,
+        msg_ring_h->rx_max_buf_size, &msg_ring_h->rx_cached_pi, rx_buf, rx_max_buf_size, avail_buf_size, max_cnt);
+}
 
-    uint32_t i = 0;
-    uint32_t left_cnt = (tx_ring_hdr->pi + msg_ring_h->tx_depth - tx_ring_hdr->ci) % msg_ring_h->tx_depth;
-    uint32_t max_cnt_ = left_cnt < max_cnt ? left_cnt : max_cnt;
-    char *tx_buf_;
-    RMB();
-    for (; i < max_cnt_; ++i) {
-        shm_ring_buf_hdr_t *ring_buf_hdr = (shm_ring_buf_hdr_t *)(msg_ring_h->shm_tx_ring +
-            ((tx_ring_hdr->ci + i) % msg_ring_h->tx_depth) * msg_ring_h->tx_max_buf_size);
-        char *ring_buf_p = (char *)(ring_buf_hdr + 1);
-        tx_buf_ = tx_buf[i];
-        if (tx_max_buf_size < ring_buf_hdr->avail_buf_size) {
-            UMQ_LIMIT_VLOG_ERR("tx_max_buf_size %u is less than avail_buf_size %u\n", tx_max_buf_size,
-                               ring_buf_hdr->avail_buf_size);
-            return -1;
-        }
-        (void)memcpy(tx_buf_, ring_buf_p, ring_buf_hdr->avail_buf_size);
-        avail_buf_size[i] = ring_buf_hdr->avail_buf_size;
+static void msg_ring_wakeup_stats_fold(msg_ring_wakeup_stats_block_t *dst, msg_ring_wakeup_stats_block_t *src)
+{
+    uint64_t *dst_cnt = (uint64_t *)&dst->stats;
+    uint64_t *src_cnt = (uint64_t *)&src->stats;
+    for (uint32_t i = 0; i < MSG_RING_WAKEUP_CNT_NUM; i++) {
+        dst_cnt[i] += __atomic_load_n(&src_cnt[i], __ATOMIC_RELAXED);
+    }
+    uint64_t last_wait_ns = __atomic_load_n(&src->last_wait_ns, __ATOMIC_RELAXED);
+    if (last_wait_ns > dst->last_wait_ns) {
+        dst->last_wait_ns = last_wait_ns;
+        dst->stats.spin_window_ns = __atomic_load_n(&src->stats.spin_window_ns, __ATOMIC_RELAXED);
+    }
+}
+
+// counts of an exited thread are kept in the retired block
+static void msg_ring_wakeup_stats_block_put(uint64_t id)
+{
+    msg_ring_wakeup_stats_block_t *block = (msg_ring_wakeup_stats_block_t *)(uintptr_t)id;
+    (void)pthread_mutex_lock(&g_msg_ring_wakeup_stats_lock);
+    msg_ring_wakeup_stats_block_t **prev = &g_msg_ring_wakeup_stats_blocks;
+    while (*prev != block) {
+        prev = &(*prev)->next;
     }
+    *prev = block->next;
+    msg_ring_wakeup_stats_fold(&g_msg_ring_wakeup_stats_retired, block);
+    (void)pthread_mutex_unlock(&g_msg_ring_wakeup_stats_lock);
+    g_msg_ring_wakeup_stats_local = NULL;
+    free(block);
+}
 
-    // Ensure that we poll tx_buf before we update ci
-    MB();
-    tx_ring_hdr->ci = (tx_ring_hdr->ci + i) % msg_ring_h->tx_depth;
+static msg_ring_wakeup_stats_block_t *msg_ring_wakeup_stats_block_get(void)
+{
+    if (URPC_LIKELY(g_msg_ring_wakeup_stats_local != NULL)) {
+        return g_msg_ring_wakeup_stats_local;
+    }
 
-    return i;
+    msg_ring_wakeup_stats_block_t *block = (msg_ring_wakeup_stats_block_t *)aligned_alloc(MSG_RING_STATS_ALIGN,
+        sizeof(msg_ring_wakeup_stats_block_t));
+    if (block == NULL) {
+        UMQ_LIMIT_VLOG_WARN("malloc ipc wakeup stats failed, stats of this thread are dropped\n");
+        g_msg_ring_wakeup_stats_local = &g_msg_ring_wakeup_stats_discard;
+        return g_msg_ring_wakeup_stats_local;
+    }
+    (void)memset(block, 0, sizeof(msg_ring_wakeup_stats_block_t));
+    (void)pthread_mutex_lock(&g_msg_ring_wakeup_stats_lock);
+    block->next = g_msg_ring_wakeup_stats_blocks;
+    g_msg_ring_wakeup_stats_blocks = block;
+    (void)pthread_mutex_unlock(&g_msg_ring_wakeup_stats_lock);
+    urpc_thread_closure_register(THREAD_CLOSURE_MSG_RING, (uint64_t)(uintptr_t)block, msg_ring_wakeup_stats_block_put);
+    g_msg_ring_wakeup_stats_local = block;
+    return block;
 }
 
-int msg_ring_post_rx(msg_ring_t *msg_ring_h, char *rx_buf, uint32_t rx_buf_size)
+// owner only, queries read the counter concurrently
+static inline void msg_ring_wakeup_stats_add(uint64_t *cnt, uint64_t val)
 {
-    uint32_t payload_size = msg_ring_h->rx_max_buf_size - (uint32_t)sizeof(shm_ring_buf_hdr_t);
-    if (rx_buf_size > payload_size) {
-        UMQ_LIMIT_VLOG_ERR("post rx failed, payload_size %u is less than rx_buf_size %u\n",
-                           payload_size, rx_buf_size);
-        return -1;
+    __atomic_store_n(cnt, __atomic_load_n(cnt, __ATOMIC_RELAXED) + val, __ATOMIC_RELAXED);
+}
+
+static inline void msg_ring_wakeup_stats_spin_window_set(msg_ring_wakeup_stats_block_t *block,
+    uint64_t spin_window_ns, uint64_t now)
+{
+    __atomic_store_n(&block->stats.spin_window_ns, spin_window_ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&block->last_wait_ns, now, __ATOMIC_RELAXED);
+}
+
+void msg_ring_waiter_init(msg_ring_waiter_t *waiter, umq_ipc_wait_cfg_t *cfg)
+{
+    uint32_t spin_window_us = cfg->spin_window_us == 0 ? UMQ_IPC_SPIN_WINDOW_DEFAULT_US : cfg->spin_window_us;
+    waiter->mode = cfg->mode < UMQ_IPC_WAIT_MODE_MAX ? cfg->mode : UMQ_IPC_WAIT_ADAPTIVE;
+    waiter->max_spin_window_ns = (uint64_t)spin_window_us * NS_PER_US;
+    waiter->spin_window_ns = waiter->mode == UMQ_IPC_WAIT_SLEEP ? 0 : waiter->max_spin_window_ns;
+}
+
+/*
+ * adaptive mode moves spin window a quarter of the way to the target each wait.
+ * event found in spin window at t: target is 2t, leaves room for jitter.
+ * event arrived after sleeping at t: spinning up to t would have saved the syscall, target is 2t if it fits in
+ * max window, otherwise peer is idle and spinning only burns cpu, target is the min window
+ */
+static void msg_ring_waiter_tune(msg_ring_waiter_t *waiter, uint64_t event_ns, bool event)
+{
+    if (waiter->mode != UMQ_IPC_WAIT_ADAPTIVE) {
+        return;
     }
 
-    shm_ring_hdr_t *rx_ring_hdr = (shm_ring_hdr_t *)msg_ring_h->shm_rx_ring_hdr;
-    if ((rx_ring_hdr->pi + 1) % msg_ring_h->rx_depth == rx_ring_hdr->ci) {
-        UMQ_LIMIT_VLOG_ERR("post rx failed, the queue is full\n");
-        return -EAGAIN;
+    uint64_t target = event_ns << 1;
+    if (!event || event_ns > waiter->max_spin_window_ns) {
+        target = MSG_RING_SPIN_WINDOW_MIN_NS;
+    } else if (target > waiter->max_spin_window_ns) {
+        target = waiter->max_spin_window_ns;
+    } else if (target < MSG_RING_SPIN_WINDOW_MIN_NS) {
+        target = MSG_RING_SPIN_WINDOW_MIN_NS;
     }
 
-    MB();
-    shm_ring_buf_hdr_t *ring_buf_hdr = (shm_ring_buf_hdr_t *)(msg_ring_h->shm_rx_ring +
-        rx_ring_hdr->pi * msg_ring_h->rx_max_buf_size);
-    char *ring_buf_p = (char *)(ring_buf_hdr + 1);
-    (void)memcpy(ring_buf_p, rx_buf, rx_buf_size);
-    ring_buf_hdr->avail_buf_size = rx_buf_size;
+    if (target > waiter->spin_window_ns) {
+        waiter->spin_window_ns += (target - waiter->spin_window_ns) >> 2;
+    } else {
+        waiter->spin_window_ns -= (waiter->spin_window_ns - target) >> 2;
+    }
+}
 
-    // Ensure that we poll rx_buf before we update pi
-    WMB();
-    rx_ring_hdr->pi = (rx_ring_hdr->pi + 1) % msg_ring_h->rx_depth;
+static inline int msg_ring_futex_wake(atomic_int *addr, int n)
+{
+    return syscall(SYS_futex, addr, FUTEX_WAKE, n, NULL, NULL, 0);
+}
 
-    return 0;
+static inline int msg_ring_futex_wait(atomic_int *addr, int val, int timeout)
+{
+    int ret = -1;
+    struct timespec ts;
+    struct timespec *ts_ptr = NULL;
+    if (timeout >= 0) {
+        ts.tv_sec = timeout / MS_PER_SEC;
+        ts.tv_nsec = (timeout % MS_PER_SEC) * NS_PER_MS;
+        ts_ptr = &ts;
+    }
+
+    do { // handle spurious wakeup
+        ret = syscall(SYS_futex, addr, FUTEX_WAIT, val, ts_ptr, NULL, 0);
+        if (ret == 0 || errno == EAGAIN || errno == EINTR) {
+            continue;
+        } else if (ret == -1) {
+            break;
+        }
+    } while (atomic_load(addr) == val);
+
+    return ret;
 }
 
-int msg_ring_poll_rx(msg_ring_t *msg_ring_h, char *rx_buf, uint32_t rx_max_buf_size, uint32_t *avail_buf_size)
+void msg_ring_event_notify(shm_ring_hdr_t *hdr)
 {
-    shm_ring_hdr_t *rx_ring_hdr = (shm_ring_hdr_t *)msg_ring_h->shm_rx_ring_hdr;
-    if (rx_ring_hdr->pi == rx_ring_hdr->ci) {
-        return -1;
+    // seq_cst store and load, pairs with waiter which increases sleeping_waiters then checks cq_event_flag.
+    // one of them must see the other, so that a waiter never sleeps on an event already set
+    atomic_store(&hdr->cq_event_flag, 1);
+    atomic_fetch_add(&hdr->pending_events, 1);
+    msg_ring_wakeup_stats_block_t *stats = msg_ring_wakeup_stats_block_get();
+    if (atomic_load(&hdr->sleeping_waiters) == 0) {
+        msg_ring_wakeup_stats_add(&stats->stats.wake_skip_cnt, 1);
+        return;
     }
 
-    RMB();
-    shm_ring_buf_hdr_t *ring_buf_hdr = (shm_ring_buf_hdr_t *)(msg_ring_h->shm_rx_ring +
-        rx_ring_hdr->ci * msg_ring_h->rx_max_buf_size);
-    char *ring_buf_p =  (char *)(ring_buf_hdr + 1);
-    if (rx_max_buf_size < ring_buf_hdr->avail_buf_size) {
-        UMQ_LIMIT_VLOG_ERR("rx_max_buf_size %u is less than avail_buf_size %u\n", rx_max_buf_size,
-                           ring_buf_hdr->avail_buf_size);
+    msg_ring_wakeup_stats_add(&stats->stats.wake_cnt, 1);
+    (void)msg_ring_futex_wake(&hdr->cq_event_flag, 1);
+}
+
+static uint64_t msg_ring_event_spin(shm_ring_hdr_t *hdr, uint64_t start, uint64_t spin_window_ns)
+{
+    uint64_t spent = 0;
+    uint32_t spin_cnt = 0;
+    while (atomic_load_explicit(&hdr->cq_event_flag, memory_order_acquire) == 0) {
+        if (++spin_cnt % MSG_RING_SPIN_CHECK_INTERVAL == 0) {
+            spent = get_timestamp_ns() - start;
+            if (spent >= spin_window_ns) {
+                break;
+            }
+        }
+        MSG_RING_CPU_RELAX();
+    }
+    return spin_cnt == 0 ? 0 : get_timestamp_ns() - start;
+}
+
+int msg_ring_event_wait(shm_ring_hdr_t *hdr, msg_ring_waiter_t *waiter, int timeout)
+{
+    if (timeout < -1) {
         return -1;
     }
-    (void)memcpy(rx_buf, ring_buf_p, ring_buf_hdr->avail_buf_size);
-    *avail_buf_size = ring_buf_hdr->avail_buf_size;
 
-    // Ensure that we poll rx_buf before we update ci
-    MB();
-    rx_ring_hdr->ci = (rx_ring_hdr->ci + 1) % msg_ring_h->rx_depth;
+    msg_ring_wakeup_stats_block_t *stats = msg_ring_wakeup_stats_block_get();
+    msg_ring_wakeup_stats_add(&stats->stats.wait_cnt, 1);
+    uint64_t spin_window_ns = waiter->spin_window_ns;
+    if (timeout >= 0 && spin_window_ns > (uint64_t)timeout * NS_PER_MS) {
+        spin_window_ns = (uint64_t)timeout * NS_PER_MS;
+    }
 
-    return 0;
+    uint64_t start = get_timestamp_ns();
+    uint64_t spent = spin_window_ns == 0 ? 0 : msg_ring_event_spin(hdr, start, spin_window_ns);
+    msg_ring_wakeup_stats_add(&stats->stats.spin_ns, spent);
+    if (atomic_load_explicit(&hdr->cq_event_flag, memory_order_acquire) != 0) {
+        msg_ring_wakeup_stats_add(&stats->stats.spin_hit_cnt, 1);
+        msg_ring_waiter_tune(waiter, spent, true);
+        msg_ring_wakeup_stats_spin_window_set(stats, waiter->spin_window_ns, start + spent);
+        return atomic_load(&hdr->pending_events);
+    }
+
+    int ret = 0;
+    int left = timeout;
+    if (timeout > 0) {
+        uint64_t spent_ms = spent / NS_PER_MS;
+        left = spent_ms >= (uint64_t)timeout ? 0 : timeout - (int)spent_ms;
+    }
+    if (left != 0) {
+        msg_ring_wakeup_stats_add(&stats->stats.sleep_cnt, 1);
+        atomic_fetch_add(&hdr->sleeping_waiters, 1);
+        ret = msg_ring_futex_wait(&hdr->cq_event_flag, 0, left);
+        atomic_fetch_sub(&hdr->sleeping_waiters, 1);
+    }
+
+    bool event = atomic_load(&hdr->cq_event_flag) != 0;
+    uint64_t end = get_timestamp_ns();
+    msg_ring_waiter_tune(waiter, end - start, event);
+    msg_ring_wakeup_stats_spin_window_set(stats, waiter->spin_window_ns, end);
+    if (event) {
+        return atomic_load(&hdr->pending_events);
+    }
+
+    msg_ring_wakeup_stats_add(&stats->stats.timeout_cnt, 1);
+    return (ret == 0 || errno == ETIMEDOUT || errno == EAGAIN) ? 0 : ret;
 }
 
-int msg_ring_poll_rx_batch(msg_ring_t *msg_ring_h, char **rx_buf, uint32_t rx_max_buf_size,
-    uint32_t *avail_buf_size, uint32_t max_cnt)
+void msg_ring_event_ack(shm_ring_hdr_t *hdr, uint32_t nevents)
 {
-    shm_ring_hdr_t *rx_ring_hdr = (shm_ring_hdr_t *)msg_ring_h->shm_rx_ring_hdr;
-    if (rx_ring_hdr->pi == rx_ring_hdr->ci) {
-        return 0;
+    atomic_fetch_sub(&hdr->pending_events, nevents);
+    if (atomic_load(&hdr->pending_events) == 0) {
+        atomic_store(&hdr->cq_event_flag, 0);
     }
+}
 
-    uint32_t i = 0;
-    uint32_t left_cnt = (rx_ring_hdr->pi + msg_ring_h->rx_depth - rx_ring_hdr->ci) % msg_ring_h->rx_depth;
-    uint32_t max_cnt_ = left_cnt < max_cnt ? left_cnt : max_cnt;
-    char *rx_buf_ = rx_buf[0];
-    RMB();
+// stats of live and exited threads, caller holds the lock
+static void msg_ring_wakeup_stats_sum(msg_ring_wakeup_stats_block_t *sum)
+{
+    *sum = g_msg_ring_wakeup_stats_retired;
+    for (msg_ring_wakeup_stats_block_t *block = g_msg_ring_wakeup_stats_blocks; block != NULL; block = block->next) {
+        msg_ring_wakeup_stats_fold(sum, block);
+    }
+}
 
-    for (; i < max_cnt_; ++i) {
-        shm_ring_buf_hdr_t *ring_buf_hdr = (shm_ring_buf_hdr_t *)(msg_ring_h->shm_rx_ring +
-            ((rx_ring_hdr->ci + i) % msg_ring_h->rx_depth) * msg_ring_h->rx_max_buf_size);
-        char *ring_buf_p = (char *)(ring_buf_hdr + 1);
-        if (rx_max_buf_size < ring_buf_hdr->avail_buf_size) {
-            UMQ_LIMIT_VLOG_ERR("rx_max_buf_size %u is less than avail_buf_size %u\n", rx_max_buf_size,
-                               ring_buf_hdr->avail_buf_size);
-            return -1;
-        }
-        rx_buf_ = rx_buf[i];
-        (void)memcpy(rx_buf_, ring_buf_p, ring_buf_hdr->avail_buf_size);
-        avail_buf_size[i] = ring_buf_hdr->avail_buf_size;
+int msg_ring_wakeup_stats_get(umq_ipc_wakeup_stats_t **stats)
+{
+    if (stats == NULL) {
+        return -UMQ_ERR_EINVAL;
     }
 
-    // Ensure that we poll rx_buf before we update ci
-    MB();
-    rx_ring_hdr->ci = (rx_ring_hdr->ci + i) % msg_ring_h->rx_depth;
+    msg_ring_wakeup_stats_block_t sum;
+    (void)pthread_mutex_lock(&g_msg_ring_wakeup_stats_lock);
+    msg_ring_wakeup_stats_sum(&sum);
+    uint64_t *sum_cnt = (uint64_t *)&sum.stats;
+    uint64_t *base_cnt = (uint64_t *)&g_msg_ring_wakeup_stats_base.stats;
+    uint64_t *snapshot_cnt = (uint64_t *)&g_msg_ring_wakeup_stats_snapshot;
+    for (uint32_t i = 0; i < MSG_RING_WAKEUP_CNT_NUM; i++) {
+        snapshot_cnt[i] = sum_cnt[i] - base_cnt[i];
+    }
+    // 0 if no thread has waited since last clear
+    g_msg_ring_wakeup_stats_snapshot.spin_window_ns =
+        sum.last_wait_ns > g_msg_ring_wakeup_stats_base.last_wait_ns ? sum.stats.spin_window_ns : 0;
+    (void)pthread_mutex_unlock(&g_msg_ring_wakeup_stats_lock);
+    *stats = &g_msg_ring_wakeup_stats_snapshot;
+    return UMQ_SUCCESS;
+}
 
-    return i;
-}
\ No newline at end of file
+// counters are written by their threads only, clear keeps the sums as base instead of zeroing them
+int msg_ring_wakeup_stats_clear(void)
+{
+    (void)pthread_mutex_lock(&g_msg_ring_wakeup_stats_lock);
+    msg_ring_wakeup_stats_sum(&g_msg_ring_wakeup_stats_base);
+    (void)pthread_mutex_unlock(&g_msg_ring_wakeup_stats_lock);
+    return UMQ_SUCCESS;
+}
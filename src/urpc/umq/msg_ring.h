@@ -10,6 +10,8 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+
+#include "umq_types.h"
 #ifndef __cplusplus
 #include <stdatomic.h>
 #else
@@ -22,40 +24,84 @@ extern "C" {
 #endif
 
 #define MAX_MSG_RING_NAME 31
+#define MSG_RING_CACHE_LINE_SIZE (64)
+#define MSG_RING_MAGIC (0x4d52494eU)       // "MRIN"
+#define MSG_RING_LAYOUT_VERSION (4)
 
+/*
+ * ring header in share memory, producer and consumer write to different cache lines.
+ * pi and ci are free running, slot index is pi/ci masked by (depth - 1).
+ * in byte stream mode pi and ci count bytes, and are masked by (ring size - 1)
+ */
 typedef struct shm_ring_hdr {
-    volatile uint32_t pi;
-    volatile uint32_t ci;
-    atomic_int cq_event_flag;   // 0: 无事件, 1: 有事件
+    // written once by owner, checked by peer before using the ring
+    uint32_t magic;
+    uint32_t version;
+    uint32_t depth;
+    uint32_t max_buf_size;
+    uint32_t byte_stream;
+    // written by producer only
+    uint32_t pi __attribute__((aligned(MSG_RING_CACHE_LINE_SIZE)));
+    // written by consumer only
+    uint32_t ci __attribute__((aligned(MSG_RING_CACHE_LINE_SIZE)));
+    atomic_int cq_event_flag __attribute__((aligned(MSG_RING_CACHE_LINE_SIZE)));   // 0: 无事件, 1: 有事件
     atomic_int pending_events;  // 事件计数器
-} shm_ring_hdr_t;
+    atomic_int sleeping_waiters;    // count of waiters sleeping on cq_event_flag
+} __attribute__((aligned(MSG_RING_CACHE_LINE_SIZE))) shm_ring_hdr_t;
 
 typedef struct msg_ring {
     char msg_ring_name[MAX_MSG_RING_NAME + 1];
     int shm_fd;
     uint32_t shm_size;
     bool owner;
+    bool byte_stream;
 
     void *shm_tx_ring;
     shm_ring_hdr_t *shm_tx_ring_hdr;
     uint32_t tx_max_buf_size;
     uint32_t tx_depth;
+    uint32_t tx_ring_size;      // bytes of tx ring
+    uint32_t tx_cached_pi;      // last pi seen by tx consumer
+    uint32_t tx_cached_ci;      // last ci seen by tx producer
 
     void *shm_rx_ring;
     shm_ring_hdr_t *shm_rx_ring_hdr;
     uint32_t rx_max_buf_size;
     uint32_t rx_depth;
+    uint32_t rx_ring_size;      // bytes of rx ring
+    uint32_t rx_cached_pi;      // last pi seen by rx consumer
+    uint32_t rx_cached_ci;      // last ci seen by rx producer
 } msg_ring_t;
 
 typedef struct msg_ring_option {
     bool owner;
     uint32_t tx_max_buf_size;
-    uint32_t tx_depth;
+    uint32_t tx_depth;          // rounded up to power of 2
     uint32_t rx_max_buf_size;
-    uint32_t rx_depth;
+    uint32_t rx_depth;          // rounded up to power of 2
     void *addr;
+    /*
+     * pack variable length records back to back instead of fixed slots of max_buf_size,
+     * ring of depth * max_buf_size bytes then holds far more small messages than depth.
+     * both sides must use the same mode
+     */
+    bool byte_stream;
 } msg_ring_option_t;
 
+/*
+ * per waiter state of spin-then-sleep policy, not shared with peer
+ */
+typedef struct msg_ring_waiter {
+    umq_ipc_wait_mode_t mode;
+    uint64_t spin_window_ns;        // current spin window
+    uint64_t max_spin_window_ns;
+} msg_ring_waiter_t;
+
+/*
+ * size of share memory used by msg ring with opt, addr passed in opt must have this size at least
+ */
+uint64_t msg_ring_shm_size(msg_ring_option_t *opt);
+
 msg_ring_t *msg_ring_create(char *msg_ring_name, uint32_t msg_ring_name_len, msg_ring_option_t *opt);
 
 void msg_ring_destroy(msg_ring_t *msg_ring_h);
@@ -76,6 +122,24 @@ int msg_ring_poll_rx(msg_ring_t *msg_ring_h, char *rx_buf, uint32_t rx_max_buf_s
 int msg_ring_poll_rx_batch(msg_ring_t *msg_ring_h, char **rx_buf, uint32_t rx_max_buf_size,
     uint32_t *avail_buf_size, uint32_t max_cnt);
 
+void msg_ring_waiter_init(msg_ring_waiter_t *waiter, umq_ipc_wait_cfg_t *cfg);
+
+/*
+ * set event flag of hdr and wake up waiter only if it is sleeping
+ */
+void msg_ring_event_notify(shm_ring_hdr_t *hdr);
+
+/*
+ * spin for spin window of waiter, then sleep until event flag of hdr is set or timeout(ms, -1 means forever).
+ * return pending event count, 0 if timeout, or -1 if failed
+ */
+int msg_ring_event_wait(shm_ring_hdr_t *hdr, msg_ring_waiter_t *waiter, int timeout);
+
+void msg_ring_event_ack(shm_ring_hdr_t *hdr, uint32_t nevents);
+
+int msg_ring_wakeup_stats_get(umq_ipc_wakeup_stats_t **stats);
+int msg_ring_wakeup_stats_clear(void);
+
 #ifdef __cplusplus
 }
 #endif
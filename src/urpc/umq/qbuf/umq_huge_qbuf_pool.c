@@ -11,10 +11,35 @@
 #include "umq_vlog.h"
 #include "umq_huge_qbuf_pool.h"
 
+#include "urpc_thread_closure.h"
+
 #define HUGE_QBUF_POOL_NUM_MAX (64)
 #define HUGE_QBUF_POOL_IDX_SHIFT (1)
 #define HUGE_QBUF_HEAD_POWER_OF_TWO (7)
 
+/* thread local cache watermarks of each size type.
+ * batch_cnt: count of buffers in each magazine moved between global pool and thread local cache
+ * low: once an allocation has to go to global pool, thread local cache is refilled to hold at least low buffers
+ *      with magazines already in global pool, so that following allocations are served locally
+ * high: released magazines are returned to global pool when thread local cache holds more buffers than it */
+typedef struct huge_qbuf_tls_watermark {
+    uint32_t batch_cnt;
+    uint32_t low;
+    uint32_t high;
+} huge_qbuf_tls_watermark_t;
+
+static const huge_qbuf_tls_watermark_t g_huge_qbuf_tls_watermark[HUGE_QBUF_POOL_SIZE_TYPE_MAX] = {
+    [HUGE_QBUF_POOL_SIZE_TYPE_MID] = {.batch_cnt = 32, .low = 64, .high = 128},
+    [HUGE_QBUF_POOL_SIZE_TYPE_BIG] = {.batch_cnt = 8, .low = 16, .high = 32},
+    [HUGE_QBUF_POOL_SIZE_TYPE_HUGE] = {.batch_cnt = 2, .low = 2, .high = 4},
+};
+
+typedef struct local_huge_qbuf_pool {
+    bool inited;
+    uint32_t generation;        // generation of g_huge_pool_ctx the cached buffers belong to
+    local_block_pool_t block_pool[HUGE_QBUF_POOL_SIZE_TYPE_MAX];
+} local_huge_qbuf_pool_t;
+
 typedef struct huge_pool_info {
     void *data_buffer;      // start address(this address must be 8K-aligned) of the data area.
                             // (1) in COMBINE mode, it is the starting position of all data(head + data);
@@ -42,12 +67,14 @@ typedef struct huge_pool {
 
 typedef struct huge_pool_ctx {
     bool inited;
+    uint32_t generation;        // bumped on uninit, thread caches of older generations hold freed buffers
     uint32_t headroom_size;     // reserve head room size
     umq_buf_mode_t mode;
     huge_pool_t pool[HUGE_QBUF_POOL_SIZE_TYPE_MAX];
 } huge_pool_ctx_t;
 
 static huge_pool_ctx_t g_huge_pool_ctx = {0};
+static __thread local_huge_qbuf_pool_t g_huge_thread_cache = {0};
 
 static uint32_t (*g_huge_pool_size[HUGE_QBUF_POOL_SIZE_TYPE_MAX])(void) = {
     umq_buf_size_middle,
@@ -65,6 +92,9 @@ static int umq_huge_qbuf_pool_init(huge_qbuf_pool_size_type_t type, huge_pool_t
     }
 
     huge_pool_info_t *pool_info = &pool->pool_info[pool->pool_idx];
+    uint32_t batch_cnt = g_huge_qbuf_tls_watermark[type].batch_cnt;
+    qbuf_magazine_t mag;
+    qbuf_magazine_init(&mag);
 
     if (pool->memory_init_callback(mempool_id, type, &buf_addr) != UMQ_SUCCESS) {
         UMQ_VLOG_ERR("memory generation callback executes failed\n");
@@ -85,10 +115,8 @@ static int umq_huge_qbuf_pool_init(huge_qbuf_pool_size_type_t type, huge_pool_t
             buf->buf_data = pool_info->data_buffer + i * pool->block_size;
             buf->mempool_id = mempool_id;
             (void)memset(buf->qbuf_ext, 0, sizeof(buf->qbuf_ext));
-            QBUF_LIST_INSERT_HEAD(&pool->block_pool.head_with_data, buf);
+            global_pool_insert_head(&pool->block_pool, true, &mag, buf, batch_cnt);
         }
-
-        pool->block_pool.buf_cnt_with_data += pool->total_block_num;
     } else if (g_huge_pool_ctx.mode == UMQ_BUF_COMBINE) {
         pool_info->data_buffer = buf_addr;
         pool_info->header_buffer = NULL;
@@ -103,11 +131,10 @@ static int umq_huge_qbuf_pool_init(huge_qbuf_pool_size_type_t type, huge_pool_t
             buf->buf_data = (char *)buf + sizeof(umq_buf_t);
             buf->mempool_id = mempool_id;
             (void)memset(buf->qbuf_ext, 0, sizeof(buf->qbuf_ext));
-            QBUF_LIST_INSERT_HEAD(&pool->block_pool.head_with_data, buf);
+            global_pool_insert_head(&pool->block_pool, true, &mag, buf, batch_cnt);
         }
-
-        pool->block_pool.buf_cnt_with_data += pool->total_block_num;
     }
+    global_pool_init_push_magazine(&pool->block_pool, true, &mag);
 
     pool->pool_idx++;
 
@@ -150,6 +177,83 @@ uint32_t umq_huge_qbuf_get_size_by_type(huge_qbuf_pool_size_type_t type)
     return blk_size;
 }
 
+static void release_huge_thread_cache(uint64_t id);
+
+// buffers cached by this thread before the pool was uninited are gone with its memory, forget them
+static void drop_stale_huge_thread_cache(void)
+{
+    for (uint32_t i = 0; i < HUGE_QBUF_POOL_SIZE_TYPE_MAX; i++) {
+        umq_qbuf_local_block_pool_init(&g_huge_thread_cache.block_pool[i]);
+    }
+    g_huge_thread_cache.generation = g_huge_pool_ctx.generation;
+}
+
+static ALWAYS_INLINE local_block_pool_t *get_huge_thread_cache(huge_qbuf_pool_size_type_t type)
+{
+    if (!g_huge_thread_cache.inited) {
+        for (uint32_t i = 0; i < HUGE_QBUF_POOL_SIZE_TYPE_MAX; i++) {
+            umq_qbuf_local_block_pool_init(&g_huge_thread_cache.block_pool[i]);
+        }
+        g_huge_thread_cache.generation = g_huge_pool_ctx.generation;
+        g_huge_thread_cache.inited = true;
+        urpc_thread_closure_register(THREAD_CLOSURE_HUGE_QBUF, 0, release_huge_thread_cache);
+    } else if (g_huge_thread_cache.generation != g_huge_pool_ctx.generation) {
+        drop_stale_huge_thread_cache();
+    }
+
+    return &g_huge_thread_cache.block_pool[type];
+}
+
+// release all thread cache to global pool of each size type. should be called when thread exits
+static void release_huge_thread_cache(uint64_t id)
+{
+    if (!g_huge_thread_cache.inited || !g_huge_pool_ctx.inited) {
+        return;
+    }
+    if (g_huge_thread_cache.generation != g_huge_pool_ctx.generation) {
+        drop_stale_huge_thread_cache();
+        return;
+    }
+
+    for (uint32_t i = 0; i < HUGE_QBUF_POOL_SIZE_TYPE_MAX; i++) {
+        flush_local_cache(&g_huge_pool_ctx.pool[i].block_pool, &g_huge_thread_cache.block_pool[i]);
+    }
+    g_huge_thread_cache.inited = false;
+}
+
+/* top thread local cache up to the low watermark with magazines in global pool, without expanding for that,
+ * then fetch until it holds at least need_cnt buffers, expanding global pool with memory_init_callback if
+ * it is not enough */
+static int huge_fetch_from_global(huge_qbuf_pool_size_type_t type, huge_pool_t *pool,
+    local_block_pool_t *local_pool, uint32_t need_cnt)
+{
+    qbuf_magazine_t mag;
+    global_pool_lock(&pool->block_pool);
+    while (local_pool->buf_cnt_with_data < g_huge_qbuf_tls_watermark[type].low &&
+        global_pool_pop_magazine(&pool->block_pool, true, &mag)) {
+        global_pool_stats_inc(&pool->block_pool.stats->fetch_cnt, 1);
+        qbuf_magazine_splice(&mag, &local_pool->head_with_data, &local_pool->buf_cnt_with_data);
+    }
+    while (local_pool->buf_cnt_with_data < need_cnt) {
+        if (global_pool_pop_magazine(&pool->block_pool, true, &mag)) {
+            global_pool_stats_inc(&pool->block_pool.stats->fetch_cnt, 1);
+            qbuf_magazine_splice(&mag, &local_pool->head_with_data, &local_pool->buf_cnt_with_data);
+            continue;
+        }
+
+        global_pool_stats_inc(&pool->block_pool.stats->empty_cnt, 1);
+        if (umq_huge_qbuf_pool_init(type, pool) != UMQ_SUCCESS) {
+            global_pool_unlock(&pool->block_pool);
+            UMQ_VLOG_ERR("buffer not enough, local count: %lu, need count: %u\n",
+                local_pool->buf_cnt_with_data, need_cnt);
+            return -UMQ_ERR_ENOMEM;
+        }
+    }
+    global_pool_unlock(&pool->block_pool);
+
+    return UMQ_SUCCESS;
+}
+
 static int do_umq_huge_qbuf_config_init(huge_qbuf_pool_cfg_t *cfg)
 {
     huge_pool_t *pool = &g_huge_pool_ctx.pool[cfg->type];
@@ -158,7 +262,7 @@ static int do_umq_huge_qbuf_config_init(huge_qbuf_pool_cfg_t *cfg)
         return -UMQ_ERR_EEXIST;
     }
 
-    umq_qbuf_block_pool_init(&pool->block_pool);
+    umq_qbuf_block_pool_init(&pool->block_pool, umq_qbuf_pool_contention_stats_ctx(UMQ_QBUF_POOL_KIND_HUGE));
 
     pool->total_size = cfg->total_size;
     pool->data_size = g_huge_pool_size[cfg->type]();
@@ -193,6 +297,7 @@ void umq_huge_qbuf_pool_uninit(void)
         return;
     }
 
+    release_huge_thread_cache(0);
     for (uint32_t i = 0; i < HUGE_QBUF_POOL_SIZE_TYPE_MAX; i++) {
         huge_pool_t *pool = &g_huge_pool_ctx.pool[i];
         for (uint32_t j = 0; j < pool->pool_idx; j++) {
@@ -205,6 +310,8 @@ void umq_huge_qbuf_pool_uninit(void)
         umq_huge_qbuf_config_uninit(i);
     }
 
+    // only this thread cache is flushed above, other threads find their caches stale on next use
+    g_huge_pool_ctx.generation++;
     g_huge_pool_ctx.inited = false;
 }
 
@@ -252,8 +359,8 @@ void umq_huge_qbuf_config_uninit(huge_qbuf_pool_size_type_t type)
     pool->inited = false;
 }
 
-static ALWAYS_INLINE void umq_huge_qbuf_alloc_data_with_split(huge_pool_t *pool, uint32_t request_size,
-    uint32_t num, umq_buf_list_t *list, uint32_t headroom_size)
+static ALWAYS_INLINE void umq_huge_qbuf_alloc_data_with_split(huge_pool_t *pool, local_block_pool_t *local_pool,
+    uint32_t request_size, uint32_t num, umq_buf_list_t *list, uint32_t headroom_size)
 {
     uint32_t cnt = 0;
     umq_buf_t *cur_node;
@@ -267,7 +374,7 @@ static ALWAYS_INLINE void umq_huge_qbuf_alloc_data_with_split(huge_pool_t *pool,
     huge_pool_info_t *pool_info = NULL;
     uint32_t pool_idx = 0;
 
-    QBUF_LIST_FOR_EACH(cur_node, &pool->block_pool.head_with_data) {
+    QBUF_LIST_FOR_EACH(cur_node, &local_pool->head_with_data) {
         // when the current mempool_id is equal  to last_mempool_id, there is no need to calculate pool_info
         if (last_mempool_id != cur_node->mempool_id) {
             last_mempool_id = cur_node->mempool_id;
@@ -300,18 +407,18 @@ static ALWAYS_INLINE void umq_huge_qbuf_alloc_data_with_split(huge_pool_t *pool,
         }
     }
 
-    umq_buf_t *head = QBUF_LIST_FIRST(&pool->block_pool.head_with_data);
+    umq_buf_t *head = QBUF_LIST_FIRST(&local_pool->head_with_data);
     // switch head node
-    QBUF_LIST_FIRST(&pool->block_pool.head_with_data) = QBUF_LIST_NEXT(cur_node);
+    QBUF_LIST_FIRST(&local_pool->head_with_data) = QBUF_LIST_NEXT(cur_node);
     QBUF_LIST_NEXT(cur_node) = QBUF_LIST_FIRST(list);
 
     // set output
     QBUF_LIST_FIRST(list) = head;
-    pool->block_pool.buf_cnt_with_data -= num;
+    local_pool->buf_cnt_with_data -= num;
 }
 
-static ALWAYS_INLINE void umq_huge_qbuf_alloc_data_with_combine(huge_pool_t *pool, uint32_t request_size,
-    uint32_t num, umq_buf_list_t *list, uint32_t headroom_size)
+static ALWAYS_INLINE void umq_huge_qbuf_alloc_data_with_combine(huge_pool_t *pool, local_block_pool_t *local_pool,
+    uint32_t request_size, uint32_t num, umq_buf_list_t *list, uint32_t headroom_size)
 {
     uint32_t cnt = 0;
     umq_buf_t *cur_node;
@@ -323,7 +430,7 @@ static ALWAYS_INLINE void umq_huge_qbuf_alloc_data_with_combine(huge_pool_t *poo
     uint32_t max_data_capacity = max_data_size - headroom_size_temp;
     bool first_fragment = true;
 
-    QBUF_LIST_FOR_EACH(cur_node, &pool->block_pool.head_with_data) {
+    QBUF_LIST_FOR_EACH(cur_node, &local_pool->head_with_data) {
         cur_node->buf_data = cur_node->data + headroom_size_temp;
         cur_node->buf_size = blk_size;
         cur_node->headroom_size = headroom_size_temp;
@@ -348,14 +455,14 @@ static ALWAYS_INLINE void umq_huge_qbuf_alloc_data_with_combine(huge_pool_t *poo
         }
     }
 
-    umq_buf_t *head = QBUF_LIST_FIRST(&pool->block_pool.head_with_data);
+    umq_buf_t *head = QBUF_LIST_FIRST(&local_pool->head_with_data);
     // switch head node
-    QBUF_LIST_FIRST(&pool->block_pool.head_with_data) = QBUF_LIST_NEXT(cur_node);
+    QBUF_LIST_FIRST(&local_pool->head_with_data) = QBUF_LIST_NEXT(cur_node);
     QBUF_LIST_NEXT(cur_node) = QBUF_LIST_FIRST(list);
 
     // set output
     QBUF_LIST_FIRST(list) = head;
-    pool->block_pool.buf_cnt_with_data -= num;
+    local_pool->buf_cnt_with_data -= num;
 }
 
 int umq_huge_qbuf_alloc(huge_qbuf_pool_size_type_t type, uint32_t request_size, uint32_t num,
@@ -367,8 +474,7 @@ int umq_huge_qbuf_alloc(huge_qbuf_pool_size_type_t type, uint32_t request_size,
     }
 
     huge_pool_t *pool = &g_huge_pool_ctx.pool[type];
-
-    (void)pthread_mutex_lock(&pool->block_pool.global_mutex);
+    local_block_pool_t *local_pool = get_huge_thread_cache(type);
 
     uint32_t actual_buf_count;
     uint32_t headroom_size =
@@ -383,19 +489,21 @@ int umq_huge_qbuf_alloc(huge_qbuf_pool_size_type_t type, uint32_t request_size,
         actual_buf_count = num * ((request_size + headroom_size + align_size - 1) / (align_size));
     }
 
-    while (pool->block_pool.buf_cnt_with_data < actual_buf_count) {
-        if (umq_huge_qbuf_pool_init(type, pool) != UMQ_SUCCESS) {
-            (void)pthread_mutex_unlock(&pool->block_pool.global_mutex);
-            UMQ_VLOG_ERR("buffer not enough, rest count: %u\n", pool->block_pool.buf_cnt_with_data);
+    if (local_pool->buf_cnt_with_data < actual_buf_count) {
+        // reuse buffers released by this thread before fetching from global
+        qbuf_magazine_splice(&local_pool->mag_with_data, &local_pool->head_with_data, &local_pool->buf_cnt_with_data);
+        if (local_pool->buf_cnt_with_data < actual_buf_count &&
+            huge_fetch_from_global(type, pool, local_pool, actual_buf_count) != UMQ_SUCCESS) {
             return -UMQ_ERR_ENOMEM;
         }
     }
+
     if (g_huge_pool_ctx.mode == UMQ_BUF_SPLIT) {
-        umq_huge_qbuf_alloc_data_with_split(pool, request_size, actual_buf_count, list, headroom_size);
+        umq_huge_qbuf_alloc_data_with_split(pool, local_pool, request_size, actual_buf_count, list, headroom_size);
     } else {
-        umq_huge_qbuf_alloc_data_with_combine(pool, request_size, actual_buf_count, list, headroom_size);
+        umq_huge_qbuf_alloc_data_with_combine(pool, local_pool, request_size, actual_buf_count, list,
+            headroom_size);
     }
-    (void)pthread_mutex_unlock(&pool->block_pool.global_mutex);
 
     return UMQ_SUCCESS;
 }
@@ -425,23 +533,10 @@ void umq_huge_qbuf_free(umq_buf_list_t *list)
     }
 
     huge_qbuf_pool_size_type_t type = umq_huge_qbuf_get_type_by_mempool_id(QBUF_LIST_FIRST(list)->mempool_id);
-    huge_pool_t *pool = &g_huge_pool_ctx.pool[type];
-    uint32_t remove_cnt = 0;
-    umq_buf_t *cur_node = NULL;
-    umq_buf_t *last_node = NULL;
-
-    (void)pthread_mutex_lock(&pool->block_pool.global_mutex);
-    QBUF_LIST_FOR_EACH(cur_node, list) {
-        remove_cnt++;
-        last_node = cur_node;
-    }
-
-    // switch head node
-    umq_buf_t *head = QBUF_LIST_FIRST(&pool->block_pool.head_with_data); // record original head node
-    QBUF_LIST_FIRST(&pool->block_pool.head_with_data) = QBUF_LIST_FIRST(list); // switch head node
-    QBUF_LIST_NEXT(last_node) = head; // append head node to last node
-    pool->block_pool.buf_cnt_with_data += remove_cnt;
-    (void)pthread_mutex_unlock(&pool->block_pool.global_mutex);
+    local_block_pool_t *local_pool = get_huge_thread_cache(type);
+    // once batch_cnt nodes released, move them to local head, or to global if local head reaches high watermark
+    release_to_local_cache(&g_huge_pool_ctx.pool[type].block_pool, local_pool, true, list,
+        g_huge_qbuf_tls_watermark[type].batch_cnt, g_huge_qbuf_tls_watermark[type].high);
 }
 
 int umq_huge_qbuf_register_seg(
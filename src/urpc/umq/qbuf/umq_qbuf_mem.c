@@ -0,0 +1,180 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: realize memory backing function for qbuf pool
+ * Create: 2025-12-01
+ * Note:
+ * History: 2025-12-01
+ */
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "umq_errno.h"
+#include "umq_vlog.h"
+#include "umq_qbuf_mem.h"
+
+#define QBUF_MEM_HUGE_2M (2ULL << 20)
+#define QBUF_MEM_HUGE_1G (1ULL << 30)
+#define QBUF_MEM_ROUND_UP(size, align) (((size) + (align) - 1) / (align) * (align))
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT (26)
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+static const char *g_qbuf_mem_backing_str[UMQ_IO_BUF_BACKING_MAX] = {
+    [UMQ_IO_BUF_BACKING_NORMAL] = "normal",
+    [UMQ_IO_BUF_BACKING_THP] = "thp",
+    [UMQ_IO_BUF_BACKING_HUGETLB_2M] = "hugetlb-2M",
+    [UMQ_IO_BUF_BACKING_HUGETLB_1G] = "hugetlb-1G",
+};
+
+const char *umq_qbuf_mem_backing_str(umq_io_buf_backing_t backing)
+{
+    if (backing >= UMQ_IO_BUF_BACKING_MAX) {
+        return "unknown";
+    }
+    return g_qbuf_mem_backing_str[backing];
+}
+
+static uint64_t qbuf_mem_page_size(umq_io_buf_backing_t backing)
+{
+    if (backing == UMQ_IO_BUF_BACKING_HUGETLB_1G) {
+        return QBUF_MEM_HUGE_1G;
+    } else if (backing == UMQ_IO_BUF_BACKING_HUGETLB_2M) {
+        return QBUF_MEM_HUGE_2M;
+    }
+    return (uint64_t)sysconf(_SC_PAGESIZE);
+}
+
+// hugetlb mapping is aligned to its page size, which covers any qbuf alignment
+static int qbuf_mem_map_hugetlb(umq_qbuf_mem_t *mem, uint64_t size, uint64_t align, umq_io_buf_backing_t backing)
+{
+    uint64_t page_size = qbuf_mem_page_size(backing);
+    if (page_size % align != 0) {
+        return -UMQ_ERR_EINVAL;
+    }
+
+    int huge_flag = backing == UMQ_IO_BUF_BACKING_HUGETLB_1G ? MAP_HUGE_1GB : MAP_HUGE_2MB;
+    uint64_t map_size = QBUF_MEM_ROUND_UP(size, page_size);
+    void *addr = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_flag,
+        -1, 0);
+    if (addr == MAP_FAILED) {
+        UMQ_VLOG_WARN("map %lu bytes with %s pages failed, errno: %d\n", map_size,
+            umq_qbuf_mem_backing_str(backing), errno);
+        return -UMQ_ERR_ENOMEM;
+    }
+
+    mem->addr = addr;
+    mem->map_size = map_size;
+    mem->backing = backing;
+    return UMQ_SUCCESS;
+}
+
+// reserve one more huge page and trim both ends, so that THP can back the range from its first byte
+static int qbuf_mem_map_thp(umq_qbuf_mem_t *mem, uint64_t size, uint64_t align)
+{
+    uint64_t align_size = align > QBUF_MEM_HUGE_2M ? align : QBUF_MEM_HUGE_2M;
+    uint64_t map_size = QBUF_MEM_ROUND_UP(size, QBUF_MEM_HUGE_2M);
+    uint64_t reserve_size = map_size + align_size;
+    char *reserve = (char *)mmap(NULL, reserve_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserve == (char *)MAP_FAILED) {
+        UMQ_VLOG_WARN("map %lu bytes failed, errno: %d\n", reserve_size, errno);
+        return -UMQ_ERR_ENOMEM;
+    }
+
+    char *addr = (char *)QBUF_MEM_ROUND_UP((uintptr_t)reserve, align_size);
+    uint64_t head = (uint64_t)(addr - reserve);
+    uint64_t tail = reserve_size - head - map_size;
+    if (head > 0) {
+        (void)munmap(reserve, head);
+    }
+    if (tail > 0) {
+        (void)munmap(addr + map_size, tail);
+    }
+
+    mem->addr = addr;
+    mem->map_size = map_size;
+    mem->backing = UMQ_IO_BUF_BACKING_THP;
+    if (madvise(addr, map_size, MADV_HUGEPAGE) != 0) {
+        // THP is disabled in kernel, the mapping still works with base pages
+        UMQ_VLOG_WARN("madvise hugepage failed, errno: %d, use base pages\n", errno);
+        mem->backing = UMQ_IO_BUF_BACKING_NORMAL;
+    }
+    return UMQ_SUCCESS;
+}
+
+int umq_qbuf_mem_alloc(umq_qbuf_mem_t *mem, uint64_t size, uint64_t align, umq_io_buf_backing_t backing)
+{
+    if (mem == NULL || size == 0 || align == 0 || backing >= UMQ_IO_BUF_BACKING_MAX) {
+        UMQ_VLOG_ERR("invalid parameter\n");
+        return -UMQ_ERR_EINVAL;
+    }
+
+    (void)memset(mem, 0, sizeof(umq_qbuf_mem_t));
+    mem->size = size;
+    if (backing == UMQ_IO_BUF_BACKING_HUGETLB_1G &&
+        qbuf_mem_map_hugetlb(mem, size, align, UMQ_IO_BUF_BACKING_HUGETLB_1G) == UMQ_SUCCESS) {
+        return UMQ_SUCCESS;
+    }
+
+    if (backing >= UMQ_IO_BUF_BACKING_HUGETLB_2M &&
+        qbuf_mem_map_hugetlb(mem, size, align, UMQ_IO_BUF_BACKING_HUGETLB_2M) == UMQ_SUCCESS) {
+        return UMQ_SUCCESS;
+    }
+
+    if (backing >= UMQ_IO_BUF_BACKING_THP && qbuf_mem_map_thp(mem, size, align) == UMQ_SUCCESS) {
+        return UMQ_SUCCESS;
+    }
+
+    mem->addr = memalign(align, size);
+    if (mem->addr == NULL) {
+        UMQ_VLOG_ERR("memory alloc failed\n");
+        return -UMQ_ERR_ENOMEM;
+    }
+    mem->backing = UMQ_IO_BUF_BACKING_NORMAL;
+    return UMQ_SUCCESS;
+}
+
+void umq_qbuf_mem_free(umq_qbuf_mem_t *mem)
+{
+    if (mem->addr == NULL) {
+        return;
+    }
+
+    if (mem->map_size != 0) {
+        (void)munmap(mem->addr, mem->map_size);
+    } else {
+        free(mem->addr);
+    }
+    (void)memset(mem, 0, sizeof(umq_qbuf_mem_t));
+}
+
+void umq_qbuf_mem_prefault(umq_qbuf_mem_t *mem)
+{
+    if (mem->addr == NULL) {
+        return;
+    }
+
+#ifdef MADV_POPULATE_WRITE
+    if (madvise(mem->addr, mem->size, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+#endif
+
+    // qbuf headers may be inited already, write access must keep content of each page
+    uint64_t page_size = qbuf_mem_page_size(mem->backing);
+    for (uint64_t offset = 0; offset < mem->size; offset += page_size) {
+        (void)__atomic_fetch_add((char *)mem->addr + offset, 0, __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,51 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: define memory backing function for qbuf pool
+ * Create: 2025-12-01
+ * Note:
+ * History: 2025-12-01
+ */
+
+#ifndef UMQ_QBUF_MEM_H
+#define UMQ_QBUF_MEM_H
+
+#include <stdint.h>
+
+#include "umq_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct umq_qbuf_mem {
+    void *addr;
+    uint64_t size;                  // size requested by caller
+    uint64_t map_size;              // size really mapped, 0 if memory comes from memalign
+    umq_io_buf_backing_t backing;   // backing really used after fallback
+} umq_qbuf_mem_t;
+
+/*
+ * alloc memory with backing in cfg, addr is aligned to align at least.
+ * hugetlb falls back to smaller hugetlb pages, then to THP, then to base pages.
+ * pages are not touched unless umq_qbuf_mem_prefault is called
+ */
+int umq_qbuf_mem_alloc(umq_qbuf_mem_t *mem, uint64_t size, uint64_t align, umq_io_buf_backing_t backing);
+
+/*
+ * free memory allocated by umq_qbuf_mem_alloc, mem is reset
+ */
+void umq_qbuf_mem_free(umq_qbuf_mem_t *mem);
+
+/*
+ * touch every page of mem so that page faults are not taken on io path
+ */
+void umq_qbuf_mem_prefault(umq_qbuf_mem_t *mem);
+
+const char *umq_qbuf_mem_backing_str(umq_io_buf_backing_t backing);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
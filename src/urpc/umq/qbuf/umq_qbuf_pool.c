@@ -7,22 +7,50 @@
  * History: 2025-7-26
  */
 
-#include <malloc.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 
 #include "umq_errno.h"
 #include "umq_vlog.h"
 #include "umq_qbuf_pool.h"
+#include "umq_qbuf_mem.h"
 
 #include "urpc_thread_closure.h"
 
 #define QBUF_POOL_TLS_MAX (2048) // max count of thread local buffer storage
 #define QBUF_POOL_BATCH_CNT (512) // batch size when fetch from global or return to global
+#define QBUF_POOL_NUMA_NODE_MAX UMQ_MEMPOOL_NUMA_NODE_MAX
+#define QBUF_POOL_NUMA_ONLINE_PATH "/sys/devices/system/node/online"
+#define QBUF_POOL_NUMA_LINE_LEN (256)
+#define QBUF_POOL_NUMA_MASK_BITS (64)
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED (1)
+#endif
+
+typedef struct qbuf_pool_contention_stats_slot {
+    umq_qbuf_pool_contention_stats_t stats;
+} __attribute__((aligned(QBUF_POOL_CACHE_LINE_SIZE))) qbuf_pool_contention_stats_slot_t;
 
 typedef struct local_qbuf_pool {
     bool inited;
+    uint32_t partition_idx;     // partition of the numa node this thread runs on when cache is created
     local_block_pool_t block_pool;
 } local_qbuf_pool_t;
 
+// qbufs of one partition are consecutive in each zone, [start, start + num) by index
+typedef struct qbuf_pool_partition {
+    global_block_pool_t block_pool;
+    uint32_t node_id;
+    uint64_t with_data_start;
+    uint64_t with_data_num;
+    uint64_t without_data_start;
+    uint64_t without_data_num;
+} __attribute__((aligned(QBUF_POOL_CACHE_LINE_SIZE))) qbuf_pool_partition_t;
+
 typedef struct qbuf_pool {
     bool inited;
     void *data_buffer;          // 数据区起始地址，COMBINE模式为所有的数据起始位置，SPLIT模式为所有的数据起始位置+头部区大小，需要8K对齐
@@ -36,21 +64,26 @@ typedef struct qbuf_pool {
 
     uint64_t total_block_num;
     umq_buf_mode_t mode;
+    bool numa_aware;
 
-    global_block_pool_t block_pool;
+    uint32_t partition_num;     // 1 if numa aware is disabled or there is only one numa node
+    qbuf_pool_partition_t partition[QBUF_POOL_NUMA_NODE_MAX];
 } qbuf_pool_t;
 
 static qbuf_pool_t g_qbuf_pool = {0};
 static __thread local_qbuf_pool_t g_thread_cache = {0};
 static uint8_t g_umq_qbuf_size_pow_samll = UMQ_QBUF_SIZE_POW_8K;
 
-static void *g_buffer_addr = NULL;
-static uint64_t g_total_len = 0;
+// counters are updated by all threads, keep each kind in its own cache line
+static qbuf_pool_contention_stats_slot_t g_qbuf_pool_contention_stats[UMQ_QBUF_POOL_KIND_MAX] = {0};
+static umq_qbuf_pool_stats_infos_t g_qbuf_pool_stats_info = {0};
+
+static umq_qbuf_mem_t g_io_buf_mem = {0};
 
-void *umq_io_buf_malloc(umq_buf_mode_t buf_mode, uint64_t size)
+void *umq_io_buf_malloc(umq_buf_mode_t buf_mode, uint64_t size, umq_io_buf_backing_t backing)
 {
-    if (g_buffer_addr != NULL) {
-        return g_buffer_addr;
+    if (g_io_buf_mem.addr != NULL) {
+        return g_io_buf_mem.addr;
     }
 
     uint64_t min_size = umq_buf_size_small();
@@ -58,46 +91,44 @@ void *umq_io_buf_malloc(umq_buf_mode_t buf_mode, uint64_t size)
         min_size = (UMQ_EMPTY_HEADER_COEFFICIENT + 1) * (uint32_t)sizeof(umq_buf_t) + umq_buf_size_small();
     }
 
+    uint64_t total_len = UMQ_BUF_DEFAULT_TOTAL_SIZE;
     if (size > 0) {
         if (size < min_size) {
             UMQ_VLOG_ERR("memory size %lu invalid, expect at least %lu\n", size, min_size);
             return NULL;
         }
 
-        g_total_len = size;
-    } else {
-        g_total_len = UMQ_BUF_DEFAULT_TOTAL_SIZE;
+        total_len = size;
     }
 
-    g_buffer_addr = (void *)memalign(umq_buf_size_small(), g_total_len);
-    if (g_buffer_addr == NULL) {
-        UMQ_VLOG_ERR("memory alloc failed\n");
+    if (umq_qbuf_mem_alloc(&g_io_buf_mem, total_len, umq_buf_size_small(), backing) != UMQ_SUCCESS) {
         return NULL;
     }
 
-    UMQ_VLOG_INFO("malloc umq io buf %lu bytes\n", g_total_len);
+    UMQ_VLOG_INFO("malloc umq io buf %lu bytes, backing: %s\n", total_len,
+        umq_qbuf_mem_backing_str(g_io_buf_mem.backing));
 
-    return g_buffer_addr;
+    return g_io_buf_mem.addr;
 }
 
 void umq_io_buf_free(void)
 {
-    if (g_buffer_addr != NULL) {
-        free(g_buffer_addr);
-        g_buffer_addr = NULL;
-    }
+    umq_qbuf_mem_free(&g_io_buf_mem);
+}
 
-    g_total_len = 0;
+void umq_io_buf_prefault(void)
+{
+    umq_qbuf_mem_prefault(&g_io_buf_mem);
 }
 
 void *umq_io_buf_addr(void)
 {
-    return g_buffer_addr;
+    return g_io_buf_mem.addr;
 }
 
 uint64_t umq_io_buf_size(void)
 {
-    return g_total_len;
+    return g_io_buf_mem.size;
 }
 
 int umq_buf_size_pow_small_set(umq_buf_block_size_t block_size)
@@ -132,22 +163,263 @@ void umq_qbuf_config_get(qbuf_pool_cfg_t *cfg)
     cfg->data_size = g_qbuf_pool.data_size;
     cfg->headroom_size = g_qbuf_pool.headroom_size;
     cfg->mode = g_qbuf_pool.mode;
+    cfg->lock_free = g_qbuf_pool.partition[0].block_pool.lock_free;
+    cfg->numa_aware = g_qbuf_pool.numa_aware;
+}
+
+void umq_qbuf_pool_numa_state_get(umq_mempool_state_t *state)
+{
+    if (!g_qbuf_pool.inited || g_qbuf_pool.partition_num == 1) {
+        state->numa_node_num = 0;
+        return;
+    }
+
+    state->numa_node_num = g_qbuf_pool.partition_num;
+    for (uint32_t i = 0; i < g_qbuf_pool.partition_num; i++) {
+        qbuf_pool_partition_t *partition = &g_qbuf_pool.partition[i];
+        state->numa_state[i].node_id = partition->node_id;
+        state->numa_state[i].total_cnt = partition->with_data_num;
+        state->numa_state[i].free_cnt = __atomic_load_n(&partition->block_pool.buf_cnt_with_data, __ATOMIC_RELAXED);
+    }
+}
+
+umq_qbuf_pool_contention_stats_t *umq_qbuf_pool_contention_stats_ctx(umq_qbuf_pool_kind_t kind)
+{
+    return &g_qbuf_pool_contention_stats[kind].stats;
+}
+
+int umq_qbuf_pool_stats_get(umq_qbuf_pool_stats_infos_t **stats_info)
+{
+    if (stats_info == NULL) {
+        UMQ_VLOG_ERR("invalid parameter\n");
+        return -UMQ_ERR_EINVAL;
+    }
+
+    g_qbuf_pool_stats_info.lock_free = g_qbuf_pool.partition[0].block_pool.lock_free;
+    for (uint32_t i = 0; i < UMQ_QBUF_POOL_KIND_MAX; i++) {
+        umq_qbuf_pool_contention_stats_t *src = &g_qbuf_pool_contention_stats[i].stats;
+        umq_qbuf_pool_contention_stats_t *dst = &g_qbuf_pool_stats_info.stats[i];
+        dst->fetch_cnt = __atomic_load_n(&src->fetch_cnt, __ATOMIC_RELAXED);
+        dst->return_cnt = __atomic_load_n(&src->return_cnt, __ATOMIC_RELAXED);
+        dst->empty_cnt = __atomic_load_n(&src->empty_cnt, __ATOMIC_RELAXED);
+        dst->contention_cnt = __atomic_load_n(&src->contention_cnt, __ATOMIC_RELAXED);
+    }
+
+    *stats_info = &g_qbuf_pool_stats_info;
+    return UMQ_SUCCESS;
+}
+
+int umq_qbuf_pool_stats_clear(void)
+{
+    for (uint32_t i = 0; i < UMQ_QBUF_POOL_KIND_MAX; i++) {
+        umq_qbuf_pool_contention_stats_t *stats = &g_qbuf_pool_contention_stats[i].stats;
+        __atomic_store_n(&stats->fetch_cnt, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->return_cnt, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->empty_cnt, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats->contention_cnt, 0, __ATOMIC_RELAXED);
+    }
+    return UMQ_SUCCESS;
+}
+
+// parse online numa node list such as "0-1,3", return count of node ids filled
+static uint32_t qbuf_pool_numa_nodes_get(uint32_t *node_ids, uint32_t max_num)
+{
+    FILE *fp = fopen(QBUF_POOL_NUMA_ONLINE_PATH, "r");
+    if (fp == NULL) {
+        return 0;
+    }
+
+    char line[QBUF_POOL_NUMA_LINE_LEN];
+    char *ret = fgets(line, sizeof(line), fp);
+    (void)fclose(fp);
+    if (ret == NULL) {
+        return 0;
+    }
+
+    uint32_t num = 0;
+    char *cur = line;
+    while (num < max_num) {
+        char *end = NULL;
+        unsigned long first = strtoul(cur, &end, 10);
+        if (end == cur) {
+            break;
+        }
+
+        unsigned long last = first;
+        if (*end == '-') {
+            cur = end + 1;
+            last = strtoul(cur, &end, 10);
+            if (end == cur) {
+                break;
+            }
+        }
+
+        for (unsigned long id = first; id <= last && num < max_num; id++) {
+            node_ids[num++] = (uint32_t)id;
+        }
+
+        if (*end != ',') {
+            break;
+        }
+        cur = end + 1;
+    }
+
+    return num;
+}
+
+// prefer node_id for pages fully covered by [addr, addr + len), take effect when pages are touched first time
+static void qbuf_pool_numa_bind(void *addr, uint64_t len, uint32_t node_id)
+{
+    uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = round_up((uint64_t)(uintptr_t)addr, page_size);
+    uint64_t end = ((uint64_t)(uintptr_t)addr + len) & ~(page_size - 1);
+    if (end <= start || node_id >= QBUF_POOL_NUMA_MASK_BITS - 1) {
+        return;
+    }
+
+    unsigned long nodemask = 1UL << node_id;
+    if (syscall(SYS_mbind, start, end - start, MPOL_PREFERRED, &nodemask, QBUF_POOL_NUMA_MASK_BITS, 0) != 0) {
+        UMQ_VLOG_WARN("bind qbuf memory to numa node %u failed, errno: %d\n", node_id, errno);
+    }
+}
+
+static uint32_t qbuf_pool_local_partition_get(void)
+{
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if (g_qbuf_pool.partition_num <= 1 || syscall(SYS_getcpu, &cpu, &node, NULL) != 0) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < g_qbuf_pool.partition_num; i++) {
+        if (g_qbuf_pool.partition[i].node_id == node) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// find home partition of qbuf by its index in header zone(split) or data zone(combine)
+static ALWAYS_INLINE uint32_t qbuf_home_partition_get(umq_buf_t *buf, bool with_data)
+{
+    if (g_qbuf_pool.partition_num == 1) {
+        return 0;
+    }
+
+    uint64_t id;
+    if (g_qbuf_pool.mode == UMQ_BUF_COMBINE) {
+        id = (uint64_t)((char *)buf - (char *)g_qbuf_pool.data_buffer) / g_qbuf_pool.block_size;
+    } else if (with_data) {
+        id = (uint64_t)((char *)buf - (char *)g_qbuf_pool.header_buffer) / sizeof(umq_buf_t);
+    } else {
+        id = (uint64_t)((char *)buf - (char *)g_qbuf_pool.ext_header_buffer) / sizeof(umq_buf_t);
+    }
+
+    for (uint32_t i = g_qbuf_pool.partition_num - 1; i > 0; i--) {
+        qbuf_pool_partition_t *partition = &g_qbuf_pool.partition[i];
+        if (id >= (with_data ? partition->with_data_start : partition->without_data_start)) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/* put magazine back to global pool. a thread may hold qbufs of several partitions after refilling from remote
+ * nodes, so magazine is split by home partition of each qbuf when pool is partitioned */
+static void qbuf_pool_put_magazine(qbuf_magazine_t *mag, bool with_data)
+{
+    if (mag->cnt == 0) {
+        return;
+    }
+
+    if (g_qbuf_pool.partition_num == 1) {
+        global_pool_put_magazine(&g_qbuf_pool.partition[0].block_pool, with_data, mag);
+        return;
+    }
+
+    qbuf_magazine_t split[QBUF_POOL_NUMA_NODE_MAX];
+    for (uint32_t i = 0; i < g_qbuf_pool.partition_num; i++) {
+        qbuf_magazine_init(&split[i]);
+    }
+
+    umq_buf_t *cur = mag->first;
+    while (cur != NULL) {
+        umq_buf_t *next = QBUF_LIST_NEXT(cur);
+        qbuf_magazine_put_chain(&split[qbuf_home_partition_get(cur, with_data)], cur, cur, 1);
+        cur = next;
+    }
+    qbuf_magazine_init(mag);
+
+    for (uint32_t i = 0; i < g_qbuf_pool.partition_num; i++) {
+        if (split[i].cnt != 0) {
+            global_pool_put_magazine(&g_qbuf_pool.partition[i].block_pool, with_data, &split[i]);
+        }
+    }
+}
+
+/* same as flush_local_magazine, except that a full magazine goes back to home partitions of its qbufs instead
+ * of a single global pool */
+static ALWAYS_INLINE void qbuf_pool_flush_local_magazine(local_block_pool_t *cache, bool with_data)
+{
+    qbuf_magazine_t *mag = with_data ? &cache->mag_with_data : &cache->mag_without_data;
+    umq_buf_list_t *local_head = with_data ? &cache->head_with_data : &cache->head_without_data;
+    uint64_t *local_buf_cnt = with_data ? &cache->buf_cnt_with_data : &cache->buf_cnt_without_data;
+
+    if (mag->cnt < QBUF_POOL_BATCH_CNT) {
+        return;
+    }
+
+    if (*local_buf_cnt < QBUF_POOL_TLS_MAX) {
+        qbuf_magazine_splice(mag, local_head, local_buf_cnt);
+        return;
+    }
+
+    qbuf_pool_put_magazine(mag, with_data);
 }
 
 static void release_thread_cache(uint64_t id);
 
-static ALWAYS_INLINE local_block_pool_t *get_thread_cache(void)
+static ALWAYS_INLINE local_qbuf_pool_t *get_thread_cache(void)
 {
     if (!g_thread_cache.inited) {
-        QBUF_LIST_INIT(&g_thread_cache.block_pool.head_with_data);
-        g_thread_cache.block_pool.buf_cnt_with_data = 0;
-        QBUF_LIST_INIT(&g_thread_cache.block_pool.head_without_data);
-        g_thread_cache.block_pool.buf_cnt_without_data = 0;
+        umq_qbuf_local_block_pool_init(&g_thread_cache.block_pool);
+        g_thread_cache.partition_idx = qbuf_pool_local_partition_get();
         g_thread_cache.inited = true;
         urpc_thread_closure_register(THREAD_CLOSURE_QBUF, 0, release_thread_cache);
     }
 
-    return &g_thread_cache.block_pool;
+    return &g_thread_cache;
+}
+
+/* refill thread cache from partition of local numa node first, partitions of remote nodes are tried in turn
+ * only when local one runs out. return count of qbufs refilled */
+static int32_t qbuf_pool_refill(local_qbuf_pool_t *cache, bool with_data)
+{
+    local_block_pool_t *local_pool = &cache->block_pool;
+    uint32_t local_idx = cache->partition_idx < g_qbuf_pool.partition_num ? cache->partition_idx : 0;
+    qbuf_magazine_t *local_mag = with_data ? &local_pool->mag_with_data : &local_pool->mag_without_data;
+    if (g_qbuf_pool.partition_num == 1 || local_mag->cnt != 0) {
+        return refill_local_cache(&g_qbuf_pool.partition[local_idx].block_pool, local_pool, with_data);
+    }
+
+    qbuf_magazine_t mag;
+    bool found = false;
+    for (uint32_t i = 0; i < g_qbuf_pool.partition_num && !found; i++) {
+        uint32_t idx = (local_idx + i) % g_qbuf_pool.partition_num;
+        found = global_pool_get_magazine(&g_qbuf_pool.partition[idx].block_pool, with_data, &mag);
+    }
+    if (!found) {
+        UMQ_VLOG_ERR("%s not enough in all numa partitions\n", with_data ? "buf with data" : "buf with no data");
+        return UMQ_FAIL;
+    }
+
+    int32_t cnt = (int32_t)mag.cnt;
+    if (with_data) {
+        qbuf_magazine_splice(&mag, &local_pool->head_with_data, &local_pool->buf_cnt_with_data);
+    } else {
+        qbuf_magazine_splice(&mag, &local_pool->head_without_data, &local_pool->buf_cnt_without_data);
+    }
+    return cnt;
 }
 
 // release all thread cache to global pool. should be called when thread exits
@@ -157,19 +429,55 @@ static ALWAYS_INLINE void release_thread_cache(uint64_t id)
         return;
     }
 
-    local_block_pool_t *local_pool = get_thread_cache();
-    (void)pthread_mutex_lock(&g_qbuf_pool.block_pool.global_mutex);
-    if (local_pool->head_with_data.first != NULL) {
-        uint32_t cnt = release_batch(&local_pool->head_with_data, &g_qbuf_pool.block_pool.head_with_data);
-        g_qbuf_pool.block_pool.buf_cnt_with_data += cnt;
+    local_block_pool_t *cache = &get_thread_cache()->block_pool;
+    merge_local_cache(cache);
+    qbuf_pool_put_magazine(&cache->mag_with_data, true);
+    qbuf_pool_put_magazine(&cache->mag_without_data, false);
+    g_thread_cache.inited = false;
+}
+
+// split qbufs of each zone evenly into one partition per online numa node
+static void qbuf_pool_partition_init(qbuf_pool_cfg_t *cfg, uint64_t with_data_num, uint64_t without_data_num)
+{
+    uint32_t node_ids[QBUF_POOL_NUMA_NODE_MAX] = {0};
+    uint32_t node_num = cfg->numa_aware ? qbuf_pool_numa_nodes_get(node_ids, QBUF_POOL_NUMA_NODE_MAX) : 0;
+    g_qbuf_pool.partition_num = node_num > 1 ? node_num : 1;
+
+    for (uint32_t i = 0; i < g_qbuf_pool.partition_num; i++) {
+        qbuf_pool_partition_t *partition = &g_qbuf_pool.partition[i];
+        umq_qbuf_block_pool_init(&partition->block_pool,
+            umq_qbuf_pool_contention_stats_ctx(UMQ_QBUF_POOL_KIND_SMALL));
+        partition->node_id = node_ids[i];
+        partition->with_data_start = with_data_num * i / g_qbuf_pool.partition_num;
+        partition->with_data_num = with_data_num * (i + 1) / g_qbuf_pool.partition_num - partition->with_data_start;
+        partition->without_data_start = without_data_num * i / g_qbuf_pool.partition_num;
+        partition->without_data_num =
+            without_data_num * (i + 1) / g_qbuf_pool.partition_num - partition->without_data_start;
+        if (g_qbuf_pool.partition_num == 1) {
+            continue;
+        }
+
+        // bind before qbufs are initialized, so that first touch places pages on the node
+        if (cfg->mode == UMQ_BUF_SPLIT) {
+            qbuf_pool_numa_bind((char *)g_qbuf_pool.data_buffer + partition->with_data_start * g_qbuf_pool.block_size,
+                partition->with_data_num * g_qbuf_pool.block_size, partition->node_id);
+            qbuf_pool_numa_bind((char *)g_qbuf_pool.header_buffer + partition->with_data_start * sizeof(umq_buf_t),
+                partition->with_data_num * sizeof(umq_buf_t), partition->node_id);
+            qbuf_pool_numa_bind(
+                (char *)g_qbuf_pool.ext_header_buffer + partition->without_data_start * sizeof(umq_buf_t),
+                partition->without_data_num * sizeof(umq_buf_t), partition->node_id);
+        } else {
+            qbuf_pool_numa_bind((char *)g_qbuf_pool.data_buffer + partition->with_data_start * g_qbuf_pool.block_size,
+                partition->with_data_num * g_qbuf_pool.block_size, partition->node_id);
+        }
     }
+}
 
-    if (local_pool->head_without_data.first != NULL) {
-        uint32_t cnt = release_batch(&local_pool->head_without_data, &g_qbuf_pool.block_pool.head_without_data);
-        g_qbuf_pool.block_pool.buf_cnt_without_data += cnt;
+static void qbuf_pool_partition_uninit(void)
+{
+    for (uint32_t i = 0; i < g_qbuf_pool.partition_num; i++) {
+        umq_qbuf_block_pool_uninit(&g_qbuf_pool.partition[i].block_pool);
     }
-    (void)pthread_mutex_unlock(&g_qbuf_pool.block_pool.global_mutex);
-    g_thread_cache.inited = false;
 }
 
 int umq_qbuf_pool_init(qbuf_pool_cfg_t *cfg)
@@ -179,12 +487,19 @@ int umq_qbuf_pool_init(qbuf_pool_cfg_t *cfg)
         return -UMQ_ERR_EEXIST;
     }
 
-    umq_qbuf_block_pool_init(&g_qbuf_pool.block_pool);
+    if (cfg->mode != UMQ_BUF_SPLIT && cfg->mode != UMQ_BUF_COMBINE) {
+        UMQ_VLOG_ERR("buf mode: %d is invalid\n", cfg->mode);
+        return -UMQ_ERR_EINVAL;
+    }
+
     g_qbuf_pool.mode = cfg->mode;
     g_qbuf_pool.total_size = cfg->total_size;
     g_qbuf_pool.headroom_size = cfg->headroom_size;
     g_qbuf_pool.data_size = cfg->data_size;
+    g_qbuf_pool.numa_aware = cfg->numa_aware;
 
+    qbuf_magazine_t mag;
+    qbuf_magazine_init(&mag);
     if (cfg->mode == UMQ_BUF_SPLIT) {
         uint32_t blk_size = umq_buf_size_small();
         uint64_t blk_num = cfg->total_size /
@@ -196,36 +511,46 @@ int umq_qbuf_pool_init(qbuf_pool_cfg_t *cfg)
         g_qbuf_pool.data_buffer = cfg->buf_addr;
         g_qbuf_pool.header_buffer = cfg->buf_addr + blk_num * blk_size;
         g_qbuf_pool.ext_header_buffer = g_qbuf_pool.header_buffer + blk_num * sizeof(umq_buf_t);
+        qbuf_pool_partition_init(cfg, blk_num, blk_num * UMQ_EMPTY_HEADER_COEFFICIENT);
 
-        for (uint64_t i = 0; i < blk_num; i++) {
-            umq_buf_t *buf = id_to_buf_with_data_split((char *)g_qbuf_pool.header_buffer, i);
-            buf->umqh = UMQ_INVALID_HANDLE;
-            buf->buf_size = blk_size + (uint32_t)sizeof(umq_buf_t);
-            buf->data_size = blk_size;
-            buf->total_data_size = buf->data_size;
-            buf->headroom_size = 0;
-            buf->buf_data = g_qbuf_pool.data_buffer + i * blk_size;
-            buf->mempool_id = 0;
-            (void)memset(buf->qbuf_ext, 0, sizeof(buf->qbuf_ext));
-            QBUF_LIST_INSERT_HEAD(&g_qbuf_pool.block_pool.head_with_data, buf);
-        }
+        for (uint32_t p = 0; p < g_qbuf_pool.partition_num; p++) {
+            qbuf_pool_partition_t *partition = &g_qbuf_pool.partition[p];
+            if (cfg->lock_free) {
+                umq_qbuf_block_pool_lock_free_enable(&partition->block_pool, (char *)g_qbuf_pool.header_buffer,
+                    sizeof(umq_buf_t), (char *)g_qbuf_pool.ext_header_buffer, sizeof(umq_buf_t));
+            }
 
-        uint64_t head_without_data_count = blk_num * UMQ_EMPTY_HEADER_COEFFICIENT;
-        for (uint64_t i = 0; i < head_without_data_count; i++) {
-            umq_buf_t *head_buf = id_to_buf_without_data_split((char *)g_qbuf_pool.ext_header_buffer, i);
-            head_buf->umqh = UMQ_INVALID_HANDLE;
-            head_buf->buf_size = (uint32_t)sizeof(umq_buf_t);
-            head_buf->data_size = 0;
-            head_buf->total_data_size = 0;
-            head_buf->headroom_size = 0;
-            head_buf->buf_data = NULL;
-            head_buf->mempool_id = 0;
-            (void)memset(head_buf->qbuf_ext, 0, sizeof(head_buf->qbuf_ext));
-            QBUF_LIST_INSERT_HEAD(&g_qbuf_pool.block_pool.head_without_data, head_buf);
+            uint64_t end = partition->with_data_start + partition->with_data_num;
+            for (uint64_t i = partition->with_data_start; i < end; i++) {
+                umq_buf_t *buf = id_to_buf_with_data_split((char *)g_qbuf_pool.header_buffer, i);
+                buf->umqh = UMQ_INVALID_HANDLE;
+                buf->buf_size = blk_size + (uint32_t)sizeof(umq_buf_t);
+                buf->data_size = blk_size;
+                buf->total_data_size = buf->data_size;
+                buf->headroom_size = 0;
+                buf->buf_data = g_qbuf_pool.data_buffer + i * blk_size;
+                buf->mempool_id = 0;
+                (void)memset(buf->qbuf_ext, 0, sizeof(buf->qbuf_ext));
+                global_pool_insert_head(&partition->block_pool, true, &mag, buf, QBUF_POOL_BATCH_CNT);
+            }
+            global_pool_init_push_magazine(&partition->block_pool, true, &mag);
+
+            end = partition->without_data_start + partition->without_data_num;
+            for (uint64_t i = partition->without_data_start; i < end; i++) {
+                umq_buf_t *head_buf = id_to_buf_without_data_split((char *)g_qbuf_pool.ext_header_buffer, i);
+                head_buf->umqh = UMQ_INVALID_HANDLE;
+                head_buf->buf_size = (uint32_t)sizeof(umq_buf_t);
+                head_buf->data_size = 0;
+                head_buf->total_data_size = 0;
+                head_buf->headroom_size = 0;
+                head_buf->buf_data = NULL;
+                head_buf->mempool_id = 0;
+                (void)memset(head_buf->qbuf_ext, 0, sizeof(head_buf->qbuf_ext));
+                global_pool_insert_head(&partition->block_pool, false, &mag, head_buf, QBUF_POOL_BATCH_CNT);
+            }
+            global_pool_init_push_magazine(&partition->block_pool, false, &mag);
         }
-        g_qbuf_pool.block_pool.buf_cnt_with_data = blk_num;
-        g_qbuf_pool.block_pool.buf_cnt_without_data = head_without_data_count;
-    } else if (cfg->mode == UMQ_BUF_COMBINE) {
+    } else {
         uint32_t blk_size = umq_buf_size_small();
         uint64_t blk_num = cfg->total_size / blk_size;
 
@@ -235,27 +560,33 @@ int umq_qbuf_pool_init(qbuf_pool_cfg_t *cfg)
 
         g_qbuf_pool.block_size = blk_size;
         g_qbuf_pool.total_block_num = blk_num;
+        qbuf_pool_partition_init(cfg, blk_num, 0);
+
+        for (uint32_t p = 0; p < g_qbuf_pool.partition_num; p++) {
+            qbuf_pool_partition_t *partition = &g_qbuf_pool.partition[p];
+            if (cfg->lock_free) {
+                umq_qbuf_block_pool_lock_free_enable(&partition->block_pool, (char *)g_qbuf_pool.data_buffer,
+                    blk_size, NULL, sizeof(umq_buf_t));
+            }
 
-        for (uint64_t i = 0; i < blk_num; i++) {
-            umq_buf_t *buf = id_to_buf_combine((char *)g_qbuf_pool.data_buffer, i, g_qbuf_pool.block_size);
-            buf->umqh = UMQ_INVALID_HANDLE;
-            buf->buf_size = blk_size;
-            buf->data_size = blk_size - (uint32_t)sizeof(umq_buf_t);
-            buf->total_data_size = buf->data_size;
-            buf->headroom_size = 0;
-            buf->buf_data = (char *)buf + sizeof(umq_buf_t);
-            buf->mempool_id = 0;
-            (void)memset(buf->qbuf_ext, 0, sizeof(buf->qbuf_ext));
-            QBUF_LIST_INSERT_HEAD(&g_qbuf_pool.block_pool.head_with_data, buf);
+            uint64_t end = partition->with_data_start + partition->with_data_num;
+            for (uint64_t i = partition->with_data_start; i < end; i++) {
+                umq_buf_t *buf = id_to_buf_combine((char *)g_qbuf_pool.data_buffer, i, g_qbuf_pool.block_size);
+                buf->umqh = UMQ_INVALID_HANDLE;
+                buf->buf_size = blk_size;
+                buf->data_size = blk_size - (uint32_t)sizeof(umq_buf_t);
+                buf->total_data_size = buf->data_size;
+                buf->headroom_size = 0;
+                buf->buf_data = (char *)buf + sizeof(umq_buf_t);
+                buf->mempool_id = 0;
+                (void)memset(buf->qbuf_ext, 0, sizeof(buf->qbuf_ext));
+                global_pool_insert_head(&partition->block_pool, true, &mag, buf, QBUF_POOL_BATCH_CNT);
+            }
+            global_pool_init_push_magazine(&partition->block_pool, true, &mag);
         }
-        g_qbuf_pool.block_pool.buf_cnt_with_data = blk_num;
-        g_qbuf_pool.block_pool.buf_cnt_without_data = 0;
-    } else {
-        umq_qbuf_block_pool_uninit(&g_qbuf_pool.block_pool);
-        UMQ_VLOG_ERR("buf mode: %d is invalid\n", cfg->mode);
-        return -UMQ_ERR_EINVAL;
     }
 
+    UMQ_VLOG_INFO("qbuf pool inited with %u numa partition(s)\n", g_qbuf_pool.partition_num);
     g_qbuf_pool.inited = true;
     return UMQ_SUCCESS;
 }
@@ -266,10 +597,21 @@ void umq_qbuf_pool_uninit(void)
         return;
     }
     release_thread_cache(0);
-    umq_qbuf_block_pool_uninit(&g_qbuf_pool.block_pool);
+    qbuf_pool_partition_uninit();
     memset(&g_qbuf_pool, 0, sizeof(qbuf_pool_t));
 }
 
+// count of qbufs with data taken by one request
+static ALWAYS_INLINE uint32_t qbuf_pool_frag_cnt(uint32_t request_size, uint32_t headroom_size)
+{
+    if (g_qbuf_pool.mode == UMQ_BUF_SPLIT) {
+        return (request_size + headroom_size + umq_buf_size_small() - 1) >> umq_buf_size_pow_small();
+    }
+
+    uint32_t align_size = umq_buf_size_small() - sizeof(umq_buf_t);
+    return (request_size + headroom_size + align_size - 1) / align_size;
+}
+
 int umq_qbuf_alloc(uint32_t request_size, uint32_t num, umq_alloc_option_t *option, umq_buf_list_t *list)
 {
     if (!g_qbuf_pool.inited) {
@@ -277,18 +619,11 @@ int umq_qbuf_alloc(uint32_t request_size, uint32_t num, umq_alloc_option_t *opti
         return -UMQ_ERR_ENOMEM;
     }
 
-    local_block_pool_t *local_pool = get_thread_cache();
+    local_qbuf_pool_t *cache = get_thread_cache();
+    local_block_pool_t *local_pool = &cache->block_pool;
     bool flag = (option != NULL && (option->flag & UMQ_ALLOC_FLAG_HEAD_ROOM_SIZE) != 0);
     uint32_t headroom_size = flag ? option->headroom_size : g_qbuf_pool.headroom_size;
-    uint32_t actual_buf_count;
-
-    if (g_qbuf_pool.mode == UMQ_BUF_SPLIT) {
-        actual_buf_count =
-            num * ((request_size + headroom_size + umq_buf_size_small() - 1) >> umq_buf_size_pow_small());
-    } else {
-        uint32_t align_size = umq_buf_size_small() - sizeof(umq_buf_t);
-        actual_buf_count = num * ((request_size + headroom_size + align_size - 1) / align_size);
-    }
+    uint32_t actual_buf_count = num * qbuf_pool_frag_cnt(request_size, headroom_size);
 
     if (request_size == 0) {
         if (flag && headroom_size > 0) {
@@ -302,7 +637,7 @@ int umq_qbuf_alloc(uint32_t request_size, uint32_t num, umq_alloc_option_t *opti
         }
 
         while (local_pool->buf_cnt_without_data < num) {
-            if (fetch_from_global(&g_qbuf_pool.block_pool, local_pool, false, QBUF_POOL_BATCH_CNT) <= 0) {
+            if (qbuf_pool_refill(cache, false) <= 0) {
                 return -UMQ_ERR_ENOMEM;
             }
         }
@@ -313,7 +648,7 @@ int umq_qbuf_alloc(uint32_t request_size, uint32_t num, umq_alloc_option_t *opti
     }
 
     while (local_pool->buf_cnt_with_data < actual_buf_count) {
-        if (fetch_from_global(&g_qbuf_pool.block_pool, local_pool, true, QBUF_POOL_BATCH_CNT) <= 0) {
+        if (qbuf_pool_refill(cache, true) <= 0) {
             UMQ_VLOG_ERR("fetch from global failed, current size: %u, alloc num: %u\n",
                 local_pool->buf_cnt_with_data, actual_buf_count);
             return -UMQ_ERR_ENOMEM;
@@ -335,27 +670,99 @@ void umq_qbuf_free(umq_buf_list_t *list)
         return;
     }
 
-    local_block_pool_t *local_pool = get_thread_cache();
+    local_block_pool_t *local_pool = &get_thread_cache()->block_pool;
     // split mode and buf is in head no data zone
-    if (g_qbuf_pool.mode == UMQ_BUF_SPLIT && (void *)QBUF_LIST_FIRST(list) >= g_qbuf_pool.ext_header_buffer) {
-        // put buf list before head of head_without_data
-        uint32_t cnt = release_batch(list, &local_pool->head_without_data);
-        local_pool->buf_cnt_without_data += cnt;
-
-        // if local list node count reaches QBUF_POOL_TLS_MAX + QBUF_POOL_BATCH_CNT, return some nodes to global
-        if (local_pool->buf_cnt_without_data >= QBUF_POOL_TLS_MAX + QBUF_POOL_BATCH_CNT) {
-            return_to_global(&g_qbuf_pool.block_pool, local_pool, false, QBUF_POOL_TLS_MAX);
+    bool with_data =
+        !(g_qbuf_pool.mode == UMQ_BUF_SPLIT && (void *)QBUF_LIST_FIRST(list) >= g_qbuf_pool.ext_header_buffer);
+    /* once QBUF_POOL_BATCH_CNT nodes released, move them to local head, or to home partitions of the released
+     * qbufs if local head is full */
+    (void)qbuf_magazine_put(with_data ? &local_pool->mag_with_data : &local_pool->mag_without_data, list);
+    qbuf_pool_flush_local_magazine(local_pool, with_data);
+}
+
+int umq_qbuf_alloc_bulk(uint32_t request_size, uint32_t num, umq_alloc_option_t *option, umq_buf_t **out)
+{
+    if (!g_qbuf_pool.inited) {
+        UMQ_VLOG_ERR("qbuf pool has not been inited\n");
+        return -UMQ_ERR_ENOMEM;
+    }
+
+    local_qbuf_pool_t *cache = get_thread_cache();
+    local_block_pool_t *local_pool = &cache->block_pool;
+    bool flag = (option != NULL && (option->flag & UMQ_ALLOC_FLAG_HEAD_ROOM_SIZE) != 0);
+    uint32_t headroom_size = flag ? option->headroom_size : g_qbuf_pool.headroom_size;
+
+    if (request_size == 0) {
+        if (flag && headroom_size > 0) {
+            UMQ_VLOG_ERR("headroom_size not supported when request_size is 0\n");
+            return -UMQ_ERR_EINVAL;
+        }
+
+        if (g_qbuf_pool.mode != UMQ_BUF_SPLIT) {
+            UMQ_VLOG_ERR("cannot alloc memory size 0 in combine mode\n");
+            return -UMQ_ERR_ENOMEM;
         }
 
+        while (local_pool->buf_cnt_without_data < num) {
+            if (qbuf_pool_refill(cache, false) <= 0) {
+                return -UMQ_ERR_ENOMEM;
+            }
+        }
+
+        umq_qbuf_alloc_nodata_bulk(local_pool, num, out);
+        return UMQ_SUCCESS;
+    }
+
+    uint32_t frag_cnt = qbuf_pool_frag_cnt(request_size, headroom_size);
+    uint64_t actual_buf_count = (uint64_t)num * frag_cnt;
+    while (local_pool->buf_cnt_with_data < actual_buf_count) {
+        if (qbuf_pool_refill(cache, true) <= 0) {
+            UMQ_VLOG_ERR("fetch from global failed, current size: %lu, alloc num: %lu\n",
+                local_pool->buf_cnt_with_data, actual_buf_count);
+            return -UMQ_ERR_ENOMEM;
+        }
+    }
+
+    umq_qbuf_alloc_data_bulk(local_pool, request_size, num, frag_cnt, out, headroom_size, g_qbuf_pool.mode);
+    return UMQ_SUCCESS;
+}
+
+void umq_qbuf_free_bulk(umq_buf_t **bufs, uint32_t num)
+{
+    if (!g_qbuf_pool.inited) {
+        UMQ_VLOG_ERR("qbuf pool has not been inited\n");
         return;
     }
 
-    uint32_t cnt = release_batch(list, &local_pool->head_with_data);
-    local_pool->buf_cnt_with_data += cnt;
+    // chains are collected per zone first, so that local magazine is touched once for each zone
+    qbuf_magazine_t released[2];
+    qbuf_magazine_init(&released[0]);
+    qbuf_magazine_init(&released[1]);
+    for (uint32_t i = 0; i < num; i++) {
+        if (i + 1 < num) {
+            __builtin_prefetch(bufs[i + 1], 1);
+        }
+
+        umq_buf_t *first = bufs[i];
+        umq_buf_t *last = first;
+        uint64_t cnt = 1;
+        while (QBUF_LIST_NEXT(last) != NULL) {
+            last = QBUF_LIST_NEXT(last);
+            cnt++;
+        }
+        // split mode and buf is in head no data zone
+        bool with_data = !(g_qbuf_pool.mode == UMQ_BUF_SPLIT && (void *)first >= g_qbuf_pool.ext_header_buffer);
+        qbuf_magazine_put_chain(&released[with_data], first, last, cnt);
+    }
 
-    // if local list node count reaches QBUF_POOL_TLS_MAX + QBUF_POOL_BATCH_CNT, return some nodes to global
-    if (local_pool->buf_cnt_with_data > QBUF_POOL_TLS_MAX + QBUF_POOL_BATCH_CNT) {
-        return_to_global(&g_qbuf_pool.block_pool, local_pool, true, QBUF_POOL_TLS_MAX);
+    local_block_pool_t *local_pool = &get_thread_cache()->block_pool;
+    for (uint32_t i = 0; i < 2; i++) {
+        if (released[i].cnt == 0) {
+            continue;
+        }
+        qbuf_magazine_t *mag = i != 0 ? &local_pool->mag_with_data : &local_pool->mag_without_data;
+        qbuf_magazine_put_chain(mag, released[i].first, released[i].last, released[i].cnt);
+        qbuf_pool_flush_local_magazine(local_pool, i != 0);
     }
 }
 
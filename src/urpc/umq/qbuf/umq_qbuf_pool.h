@@ -39,6 +39,8 @@ typedef struct qbuf_pool_cfg {
     uint32_t data_size;         // size of one data slab
     uint32_t headroom_size;     // reserve head room size
     umq_buf_mode_t mode;
+    bool lock_free;             // global pool uses lock free stack instead of mutex
+    bool numa_aware;            // split buffer into one partition per numa node, threads alloc from local node first
 } qbuf_pool_cfg_t;
 
 int umq_buf_size_pow_small_set(umq_buf_block_size_t block_size);
@@ -81,8 +83,10 @@ static inline uint32_t umq_buf_size_huge(void)
     return umq_buf_size_small() * umq_buf_size_mul_huge();
 }
 
-void *umq_io_buf_malloc(umq_buf_mode_t buf_mode, uint64_t size);
+void *umq_io_buf_malloc(umq_buf_mode_t buf_mode, uint64_t size, umq_io_buf_backing_t backing);
 void umq_io_buf_free(void);
+// touch all pages of io buf, call it after qbuf pool init so that numa binding of partitions takes effect
+void umq_io_buf_prefault(void);
 void *umq_io_buf_addr(void);
 uint64_t umq_io_buf_size(void);
 
@@ -110,6 +114,18 @@ int umq_qbuf_alloc(uint32_t request_size, uint32_t num, umq_alloc_option_t *opti
  */
 void umq_qbuf_free(umq_buf_list_t *list);
 
+/*
+ * alloc num requests from qbuf pool into array out, out[i] is the qbuf chain of one request ended with NULL.
+ * all or none of the requests are allocated.
+ */
+int umq_qbuf_alloc_bulk(uint32_t request_size, uint32_t num, umq_alloc_option_t *option, umq_buf_t **out);
+
+/*
+ * release num qbuf chains in array bufs to qbuf pool, each chain is returned by umq_qbuf_alloc or
+ * umq_qbuf_alloc_bulk. tail of each chain is linked to the next one so that they are released as a whole.
+ */
+void umq_qbuf_free_bulk(umq_buf_t **bufs, uint32_t num);
+
 /*
  * reset head room size of qbuf
  * if headroom_size is not appropriate, UMQ_FAIL will be returned
@@ -124,21 +140,67 @@ umq_buf_t *umq_qbuf_data_to_head(void *data);
 
 void umq_qbuf_config_get(qbuf_pool_cfg_t *cfg);
 
+/*
+ * fill per numa node occupancy of default mempool, numa_node_num is 0 if pool is not partitioned
+ */
+void umq_qbuf_pool_numa_state_get(umq_mempool_state_t *state);
+
+/* magazine is a pre-linked chain of free qbufs which records its own tail and count, so that a whole batch
+ * can be moved between thread local cache and global pool in O(1) */
+typedef struct qbuf_magazine {
+    umq_buf_t *first;
+    umq_buf_t *last;
+    uint64_t cnt;
+} qbuf_magazine_t;
+
+/* link of magazines stacked in global pool. it is stored in qbuf_ext of the first qbuf of each magazine,
+ * which is unused while qbuf is free */
+typedef struct qbuf_magazine_link {
+    umq_buf_t *next;            // first qbuf of next magazine in stack
+    umq_buf_t *last;
+    uint64_t cnt;
+} qbuf_magazine_link_t;
+
+#define QBUF_MAGAZINE_LINK(qbuf)    ((qbuf_magazine_link_t *)(qbuf)->qbuf_ext)
+
 typedef struct local_block_pool {
     umq_buf_list_t head_with_data;
     uint64_t buf_cnt_with_data;
     umq_buf_list_t head_without_data;
     uint64_t buf_cnt_without_data;
+    qbuf_magazine_t mag_with_data;      // qbufs released by this thread, moved to head or global pool as a whole
+    qbuf_magazine_t mag_without_data;
 } local_block_pool_t;
 
+/* lock free stack of magazines. qbuf is identified by its index in region, so that top can be tagged with
+ * a generation and swapped by 64 bit cas without ABA problem */
+typedef struct qbuf_lock_free_stack {
+    uint64_t top;                       // generation(high 32 bits) | index + 1(low 32 bits), 0 index means empty
+    char *base;                         // address of qbuf with index 0
+    uint64_t stride;                    // distance between adjacent qbufs
+} qbuf_lock_free_stack_t;
+
+#define QBUF_POOL_CACHE_LINE_SIZE   (64)
+#define QBUF_LF_STACK_IDX_MASK      (0xffffffffULL)
+#define QBUF_LF_STACK_GEN_SHIFT     (32)
+
 typedef struct global_block_pool {
     pthread_mutex_t global_mutex;
-    umq_buf_list_t head_with_data;
+    umq_buf_t *mag_top_with_data;       // first qbuf of the magazine on top of stack
     uint64_t buf_cnt_with_data;
-    umq_buf_list_t head_without_data;
+    umq_buf_t *mag_top_without_data;
     uint64_t buf_cnt_without_data;
+    bool lock_free;                     // use lf_stack instead of mag_top and global_mutex
+    qbuf_lock_free_stack_t lf_stack_with_data;
+    qbuf_lock_free_stack_t lf_stack_without_data;
+    umq_qbuf_pool_contention_stats_t *stats;
 } global_block_pool_t;
 
+/* contention stats of global pool, shared by all global pools of the same kind */
+umq_qbuf_pool_contention_stats_t *umq_qbuf_pool_contention_stats_ctx(umq_qbuf_pool_kind_t kind);
+int umq_qbuf_pool_stats_get(umq_qbuf_pool_stats_infos_t **stats_info);
+int umq_qbuf_pool_stats_clear(void);
+
 static ALWAYS_INLINE uint64_t round_up(uint64_t size, uint64_t align)
 {
     return (size + align - 1) & ~(align - 1);
@@ -150,167 +212,376 @@ static ALWAYS_INLINE void *floor_to_align(void *ptr, uint64_t align)
     return (void *)((uint64_t)(uintptr_t)ptr & ~(align - 1));
 }
 
-/* get n elements from input and insert them at the head of output
- * input list elements count must more than n
- */
-static ALWAYS_INLINE uint32_t allocate_batch(umq_buf_list_t *input, uint32_t n, umq_buf_list_t *output)
+static ALWAYS_INLINE void qbuf_magazine_init(qbuf_magazine_t *mag)
 {
-    uint32_t cnt = 0;
-    umq_buf_t *cur_node;
-    QBUF_LIST_FOR_EACH(cur_node, input) {
-        if (++cnt == n) {
-            break;
-        }
+    mag->first = NULL;
+    mag->last = NULL;
+    mag->cnt = 0;
+}
+
+static ALWAYS_INLINE void qbuf_magazine_insert_head(qbuf_magazine_t *mag, umq_buf_t *qbuf)
+{
+    QBUF_LIST_NEXT(qbuf) = mag->first;
+    mag->first = qbuf;
+    if (mag->last == NULL) {
+        mag->last = qbuf;
     }
+    mag->cnt++;
+}
 
-    umq_buf_t *input_head = QBUF_LIST_FIRST(input);
-    umq_buf_t *output_head = QBUF_LIST_FIRST(output);
-    // switch head node
-    QBUF_LIST_FIRST(input) = QBUF_LIST_NEXT(cur_node);
-    QBUF_LIST_FIRST(output) = input_head;
-    // set output
-    QBUF_LIST_NEXT(cur_node) = output_head;
-    return cnt;
+// put a chain of cnt qbufs whose tail is already known at the head of magazine in O(1)
+static ALWAYS_INLINE void qbuf_magazine_put_chain(qbuf_magazine_t *mag, umq_buf_t *first, umq_buf_t *last,
+    uint64_t cnt)
+{
+    QBUF_LIST_NEXT(last) = mag->first;
+    if (mag->last == NULL) {
+        mag->last = last;
+    }
+    mag->first = first;
+    mag->cnt += cnt;
 }
 
-// release input to output and return count of elements released
-static ALWAYS_INLINE uint32_t release_batch(umq_buf_list_t *input, umq_buf_list_t *output)
+// put all elements of list at the head of magazine and return count of elements put
+static ALWAYS_INLINE uint32_t qbuf_magazine_put(qbuf_magazine_t *mag, umq_buf_list_t *list)
 {
     uint32_t cnt = 0;
     umq_buf_t *cur_node;
     umq_buf_t *last_node = NULL;
-    QBUF_LIST_FOR_EACH(cur_node, input) {
+    QBUF_LIST_FOR_EACH(cur_node, list) {
         ++cnt;
         last_node = cur_node;
     }
 
-    umq_buf_t *output_head = QBUF_LIST_FIRST(output);
-    // switch head node
-    QBUF_LIST_FIRST(output) = QBUF_LIST_FIRST(input);
-    // set output
-    QBUF_LIST_NEXT(last_node) = output_head;
+    if (last_node == NULL) {
+        return 0;
+    }
+
+    qbuf_magazine_put_chain(mag, QBUF_LIST_FIRST(list), last_node, cnt);
     return cnt;
 }
 
-// fetch list nodes from to global to local cache
-static ALWAYS_INLINE int32_t fetch_from_global(
-        global_block_pool_t *global_pool, local_block_pool_t *cache_pool, bool with_data, uint32_t batch_count)
-{
-    uint32_t count = 0;
-    uint64_t *global_buf_cnt;
-    umq_buf_list_t *global_head;
-    uint64_t *local_buf_cnt;
-    umq_buf_list_t *local_head;
-    pthread_mutex_lock(&global_pool->global_mutex);
-    if (with_data) {
-        global_buf_cnt = &global_pool->buf_cnt_with_data;
-        global_head = &global_pool->head_with_data;
+// move all elements of magazine to the head of list in O(1)
+static ALWAYS_INLINE void qbuf_magazine_splice(qbuf_magazine_t *mag, umq_buf_list_t *list, uint64_t *list_cnt)
+{
+    if (mag->cnt == 0) {
+        return;
+    }
 
-        local_buf_cnt = &cache_pool->buf_cnt_with_data;
-        local_head = &cache_pool->head_with_data;
-    } else {
-        global_buf_cnt = &global_pool->buf_cnt_without_data;
-        global_head = &global_pool->head_without_data;
+    QBUF_LIST_NEXT(mag->last) = QBUF_LIST_FIRST(list);
+    QBUF_LIST_FIRST(list) = mag->first;
+    *list_cnt += mag->cnt;
+    qbuf_magazine_init(mag);
+}
 
-        local_buf_cnt = &cache_pool->buf_cnt_without_data;
-        local_head = &cache_pool->head_without_data;
+static ALWAYS_INLINE void global_pool_stats_inc(uint64_t *counter, uint64_t val)
+{
+    (void)__atomic_fetch_add(counter, val, __ATOMIC_RELAXED);
+}
+
+// lock global_mutex, record contention if it is held by others
+static ALWAYS_INLINE void global_pool_lock(global_block_pool_t *global_pool)
+{
+    if (pthread_mutex_trylock(&global_pool->global_mutex) == 0) {
+        return;
     }
 
-    if (*global_buf_cnt < batch_count) {
-        pthread_mutex_unlock(&global_pool->global_mutex);
-        UMQ_VLOG_ERR("%s not enough, rest count: %u\n", with_data ? "buf with data" : "buf with no data",
-            *global_buf_cnt);
-        return UMQ_FAIL;
+    global_pool_stats_inc(&global_pool->stats->contention_cnt, 1);
+    (void)pthread_mutex_lock(&global_pool->global_mutex);
+}
+
+static ALWAYS_INLINE void global_pool_unlock(global_block_pool_t *global_pool)
+{
+    (void)pthread_mutex_unlock(&global_pool->global_mutex);
+}
+
+static ALWAYS_INLINE uint64_t qbuf_lock_free_stack_idx(qbuf_lock_free_stack_t *stack, umq_buf_t *qbuf)
+{
+    return (uint64_t)((char *)qbuf - stack->base) / stack->stride + 1;
+}
+
+static ALWAYS_INLINE umq_buf_t *qbuf_lock_free_stack_qbuf(qbuf_lock_free_stack_t *stack, uint64_t top)
+{
+    uint64_t idx = top & QBUF_LF_STACK_IDX_MASK;
+    return idx == 0 ? NULL : (umq_buf_t *)(uintptr_t)(stack->base + (idx - 1) * stack->stride);
+}
+
+// push magazine to lock free stack, return count of cas retried
+static ALWAYS_INLINE uint64_t qbuf_lock_free_stack_push(qbuf_lock_free_stack_t *stack, qbuf_magazine_t *mag)
+{
+    qbuf_magazine_link_t *link = QBUF_MAGAZINE_LINK(mag->first);
+    uint64_t idx = qbuf_lock_free_stack_idx(stack, mag->first);
+    uint64_t retry = 0;
+    uint64_t old_top = __atomic_load_n(&stack->top, __ATOMIC_RELAXED);
+    uint64_t new_top;
+
+    link->last = mag->last;
+    link->cnt = mag->cnt;
+    do {
+        __atomic_store_n(&link->next, qbuf_lock_free_stack_qbuf(stack, old_top), __ATOMIC_RELAXED);
+        new_top = (((old_top >> QBUF_LF_STACK_GEN_SHIFT) + 1) << QBUF_LF_STACK_GEN_SHIFT) | idx;
+        if (__atomic_compare_exchange_n(&stack->top, &old_top, new_top, true, __ATOMIC_RELEASE,
+            __ATOMIC_RELAXED)) {
+            return retry;
+        }
+        retry++;
+    } while (true);
+}
+
+/* pop magazine from lock free stack, return false if stack is empty. next of top magazine may be read after
+ * it is popped by others, the generation changed since then makes the cas fail */
+static ALWAYS_INLINE bool qbuf_lock_free_stack_pop(qbuf_lock_free_stack_t *stack, qbuf_magazine_t *mag,
+    uint64_t *retry)
+{
+    uint64_t old_top = __atomic_load_n(&stack->top, __ATOMIC_ACQUIRE);
+    uint64_t new_top;
+    umq_buf_t *first;
+
+    *retry = 0;
+    do {
+        first = qbuf_lock_free_stack_qbuf(stack, old_top);
+        if (first == NULL) {
+            return false;
+        }
+
+        umq_buf_t *next = __atomic_load_n(&QBUF_MAGAZINE_LINK(first)->next, __ATOMIC_RELAXED);
+        new_top = (((old_top >> QBUF_LF_STACK_GEN_SHIFT) + 1) << QBUF_LF_STACK_GEN_SHIFT) |
+            (next == NULL ? 0 : qbuf_lock_free_stack_idx(stack, next));
+        if (__atomic_compare_exchange_n(&stack->top, &old_top, new_top, true, __ATOMIC_ACQUIRE,
+            __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        (*retry)++;
+    } while (true);
+
+    qbuf_magazine_link_t *link = QBUF_MAGAZINE_LINK(first);
+    mag->first = first;
+    mag->last = link->last;
+    mag->cnt = link->cnt;
+    (void)memset(link, 0, sizeof(qbuf_magazine_link_t));
+    return true;
+}
+
+// push magazine to global pool in O(1), global_mutex should be held by caller unless during init
+static ALWAYS_INLINE void global_pool_push_magazine(global_block_pool_t *global_pool, bool with_data,
+    qbuf_magazine_t *mag)
+{
+    if (mag->cnt == 0) {
+        return;
     }
 
-    count = allocate_batch(global_head, batch_count, local_head);
-    *global_buf_cnt -= count;
-    *local_buf_cnt += count;
+    umq_buf_t **top = with_data ? &global_pool->mag_top_with_data : &global_pool->mag_top_without_data;
+    uint64_t *global_buf_cnt = with_data ? &global_pool->buf_cnt_with_data : &global_pool->buf_cnt_without_data;
+    qbuf_magazine_link_t *link = QBUF_MAGAZINE_LINK(mag->first);
+    link->next = *top;
+    link->last = mag->last;
+    link->cnt = mag->cnt;
+    *top = mag->first;
+    *global_buf_cnt += mag->cnt;
+    qbuf_magazine_init(mag);
+}
 
-    pthread_mutex_unlock(&global_pool->global_mutex);
-    return count;
+/* push magazine to global pool of either mode without taking global_mutex.
+ * only used during pool init, or with global_mutex held by caller */
+static ALWAYS_INLINE void global_pool_init_push_magazine(global_block_pool_t *global_pool, bool with_data,
+    qbuf_magazine_t *mag)
+{
+    if (!global_pool->lock_free) {
+        global_pool_push_magazine(global_pool, with_data, mag);
+        return;
+    }
+
+    if (mag->cnt == 0) {
+        return;
+    }
+
+    qbuf_lock_free_stack_t *stack = with_data ? &global_pool->lf_stack_with_data : &global_pool->lf_stack_without_data;
+    uint64_t *global_buf_cnt = with_data ? &global_pool->buf_cnt_with_data : &global_pool->buf_cnt_without_data;
+    (void)__atomic_fetch_add(global_buf_cnt, mag->cnt, __ATOMIC_RELAXED);
+    (void)qbuf_lock_free_stack_push(stack, mag);
+    qbuf_magazine_init(mag);
 }
 
-// flush list nodes from local cache to global
-static ALWAYS_INLINE void return_to_global(
-        global_block_pool_t *global_pool, local_block_pool_t *cache, bool with_data, uint32_t threshold)
+/* insert qbuf to magazine which is being built, the magazine is pushed to global pool once it reaches batch_count.
+ * only used during pool init, remainder of magazine should be pushed by caller at last */
+static ALWAYS_INLINE void global_pool_insert_head(global_block_pool_t *global_pool, bool with_data,
+    qbuf_magazine_t *mag, umq_buf_t *qbuf, uint32_t batch_count)
 {
-    uint32_t cnt = 0;
-    uint32_t remove_cnt = 0;
-    umq_buf_t *cur_node = NULL;
-    umq_buf_t *switch_node = NULL;
-    umq_buf_t *last_node = NULL;
-    uint64_t *global_buf_cnt;
-    umq_buf_list_t *global_head;
-    uint64_t *local_buf_cnt;
-    umq_buf_list_t *local_head;
-    (void)pthread_mutex_lock(&global_pool->global_mutex);
-    if (with_data) {
-        global_buf_cnt = &global_pool->buf_cnt_with_data;
-        global_head = &global_pool->head_with_data;
+    qbuf_magazine_insert_head(mag, qbuf);
+    if (mag->cnt >= batch_count) {
+        global_pool_init_push_magazine(global_pool, with_data, mag);
+    }
+}
 
-        local_buf_cnt = &cache->buf_cnt_with_data;
-        local_head = &cache->head_with_data;
-    } else {
-        global_buf_cnt = &global_pool->buf_cnt_without_data;
-        global_head = &global_pool->head_without_data;
+// pop magazine from global pool in O(1), global_mutex should be held by caller
+static ALWAYS_INLINE bool global_pool_pop_magazine(global_block_pool_t *global_pool, bool with_data,
+    qbuf_magazine_t *mag)
+{
+    umq_buf_t **top = with_data ? &global_pool->mag_top_with_data : &global_pool->mag_top_without_data;
+    uint64_t *global_buf_cnt = with_data ? &global_pool->buf_cnt_with_data : &global_pool->buf_cnt_without_data;
+    if (*top == NULL) {
+        return false;
+    }
+
+    qbuf_magazine_link_t *link = QBUF_MAGAZINE_LINK(*top);
+    mag->first = *top;
+    mag->last = link->last;
+    mag->cnt = link->cnt;
+    *top = link->next;
+    *global_buf_cnt -= mag->cnt;
+    (void)memset(link, 0, sizeof(qbuf_magazine_link_t));
+    return true;
+}
 
-        local_buf_cnt =  &cache->buf_cnt_without_data;
-        local_head = &cache->head_without_data;
+// put magazine to global pool of either mode
+static ALWAYS_INLINE void global_pool_put_magazine(global_block_pool_t *global_pool, bool with_data,
+    qbuf_magazine_t *mag)
+{
+    if (mag->cnt == 0) {
+        return;
     }
 
-    QBUF_LIST_FOR_EACH(cur_node, local_head) {
-        if (++cnt <= threshold) {
-            switch_node = cur_node;
-        } else {
-            remove_cnt++;
-            last_node = cur_node;
+    global_pool_stats_inc(&global_pool->stats->return_cnt, 1);
+    if (global_pool->lock_free) {
+        qbuf_lock_free_stack_t *stack =
+            with_data ? &global_pool->lf_stack_with_data : &global_pool->lf_stack_without_data;
+        uint64_t *global_buf_cnt = with_data ? &global_pool->buf_cnt_with_data : &global_pool->buf_cnt_without_data;
+        (void)__atomic_fetch_add(global_buf_cnt, mag->cnt, __ATOMIC_RELAXED);
+        uint64_t retry = qbuf_lock_free_stack_push(stack, mag);
+        if (retry != 0) {
+            global_pool_stats_inc(&global_pool->stats->contention_cnt, retry);
         }
+        qbuf_magazine_init(mag);
+        return;
     }
 
-    // switch head node
-    umq_buf_t *head = QBUF_LIST_FIRST(global_head); // record original head node
-    QBUF_LIST_FIRST(global_head) = QBUF_LIST_NEXT(switch_node); // switch head node
-    QBUF_LIST_NEXT(last_node) = head; // append head node to last node
-    QBUF_LIST_NEXT(switch_node) = NULL; // break chain between switch_node and next of switch_node
-    *global_buf_cnt += remove_cnt;
-    *local_buf_cnt -= remove_cnt;
+    global_pool_lock(global_pool);
+    global_pool_push_magazine(global_pool, with_data, mag);
+    global_pool_unlock(global_pool);
+}
 
-    (void)pthread_mutex_unlock(&global_pool->global_mutex);
+// get magazine from global pool of either mode, return false if global pool is empty
+static ALWAYS_INLINE bool global_pool_get_magazine(global_block_pool_t *global_pool, bool with_data,
+    qbuf_magazine_t *mag)
+{
+    bool ret;
+    if (global_pool->lock_free) {
+        qbuf_lock_free_stack_t *stack =
+            with_data ? &global_pool->lf_stack_with_data : &global_pool->lf_stack_without_data;
+        uint64_t retry;
+        ret = qbuf_lock_free_stack_pop(stack, mag, &retry);
+        if (retry != 0) {
+            global_pool_stats_inc(&global_pool->stats->contention_cnt, retry);
+        }
+        if (ret) {
+            uint64_t *global_buf_cnt =
+                with_data ? &global_pool->buf_cnt_with_data : &global_pool->buf_cnt_without_data;
+            (void)__atomic_fetch_sub(global_buf_cnt, mag->cnt, __ATOMIC_RELAXED);
+        }
+    } else {
+        global_pool_lock(global_pool);
+        ret = global_pool_pop_magazine(global_pool, with_data, mag);
+        global_pool_unlock(global_pool);
+    }
+
+    global_pool_stats_inc(ret ? &global_pool->stats->fetch_cnt : &global_pool->stats->empty_cnt, 1);
+    return ret;
 }
 
-// flush polled buf to global
-static ALWAYS_INLINE void return_qbuf_to_global(global_block_pool_t *global_pool, umq_buf_t *buf, bool with_data)
+// fetch one magazine from global to local cache, lock hold time does not depend on count of qbufs moved
+static ALWAYS_INLINE int32_t fetch_from_global(
+        global_block_pool_t *global_pool, local_block_pool_t *cache_pool, bool with_data)
 {
-    uint32_t cnt = 0;
-    umq_buf_t *cur_node = NULL;
-    umq_buf_t *last_node = NULL;
+    qbuf_magazine_t mag;
+    if (!global_pool_get_magazine(global_pool, with_data, &mag)) {
+        UMQ_VLOG_ERR("%s not enough, rest count: 0\n", with_data ? "buf with data" : "buf with no data");
+        return UMQ_FAIL;
+    }
+
+    int32_t cnt = (int32_t)mag.cnt;
+    if (with_data) {
+        qbuf_magazine_splice(&mag, &cache_pool->head_with_data, &cache_pool->buf_cnt_with_data);
+    } else {
+        qbuf_magazine_splice(&mag, &cache_pool->head_without_data, &cache_pool->buf_cnt_without_data);
+    }
+    return cnt;
+}
 
-    uint64_t *global_buf_cnt;
-    umq_buf_list_t *global_head;
+/* refill local cache, qbufs released by this thread are reused first, then fetch from global.
+ * return count of qbufs refilled */
+static ALWAYS_INLINE int32_t refill_local_cache(
+        global_block_pool_t *global_pool, local_block_pool_t *cache_pool, bool with_data)
+{
+    qbuf_magazine_t *mag = with_data ? &cache_pool->mag_with_data : &cache_pool->mag_without_data;
+    if (mag->cnt == 0) {
+        return fetch_from_global(global_pool, cache_pool, with_data);
+    }
 
-    (void)pthread_mutex_lock(&global_pool->global_mutex);
+    int32_t cnt = (int32_t)mag->cnt;
     if (with_data) {
-        global_buf_cnt = &global_pool->buf_cnt_with_data;
-        global_head = &global_pool->head_with_data;
+        qbuf_magazine_splice(mag, &cache_pool->head_with_data, &cache_pool->buf_cnt_with_data);
     } else {
-        global_buf_cnt = &global_pool->buf_cnt_without_data;
-        global_head = &global_pool->head_without_data;
+        qbuf_magazine_splice(mag, &cache_pool->head_without_data, &cache_pool->buf_cnt_without_data);
     }
+    return cnt;
+}
 
-    cur_node = buf;
-    while (cur_node != NULL) {
-        last_node = cur_node;
-        cur_node = QBUF_LIST_NEXT(cur_node);
-        cnt++;
+/* once local magazine is full(reaches batch_count), it is moved to local head if local head holds less than
+ * threshold qbufs, or returned to global pool as a whole */
+static ALWAYS_INLINE void flush_local_magazine(global_block_pool_t *global_pool, local_block_pool_t *cache,
+    bool with_data, uint32_t batch_count, uint32_t threshold)
+{
+    qbuf_magazine_t *mag = with_data ? &cache->mag_with_data : &cache->mag_without_data;
+    umq_buf_list_t *local_head = with_data ? &cache->head_with_data : &cache->head_without_data;
+    uint64_t *local_buf_cnt = with_data ? &cache->buf_cnt_with_data : &cache->buf_cnt_without_data;
+
+    if (mag->cnt < batch_count) {
+        return;
     }
-    // switch head node
-    umq_buf_t *head = QBUF_LIST_FIRST(global_head); // record original head node
-    QBUF_LIST_FIRST(global_head) = buf; // switch head node
-    QBUF_LIST_NEXT(last_node) = head; // append head node to last node
-    *global_buf_cnt += cnt;
 
-    (void)pthread_mutex_unlock(&global_pool->global_mutex);
+    if (*local_buf_cnt < threshold) {
+        qbuf_magazine_splice(mag, local_head, local_buf_cnt);
+        return;
+    }
+
+    global_pool_put_magazine(global_pool, with_data, mag);
+}
+
+// put released list into local magazine, then flush the magazine if it is full
+static ALWAYS_INLINE void release_to_local_cache(global_block_pool_t *global_pool, local_block_pool_t *cache,
+    bool with_data, umq_buf_list_t *list, uint32_t batch_count, uint32_t threshold)
+{
+    (void)qbuf_magazine_put(with_data ? &cache->mag_with_data : &cache->mag_without_data, list);
+    flush_local_magazine(global_pool, cache, with_data, batch_count, threshold);
+}
+
+// move local head into local magazine, local head does not record its tail so it is walked once
+static ALWAYS_INLINE void merge_local_cache(local_block_pool_t *cache)
+{
+    (void)qbuf_magazine_put(&cache->mag_with_data, &cache->head_with_data);
+    QBUF_LIST_INIT(&cache->head_with_data);
+    cache->buf_cnt_with_data = 0;
+    (void)qbuf_magazine_put(&cache->mag_without_data, &cache->head_without_data);
+    QBUF_LIST_INIT(&cache->head_without_data);
+    cache->buf_cnt_without_data = 0;
+}
+
+// flush all qbufs of local cache to global, should be called when thread exits
+static ALWAYS_INLINE void flush_local_cache(global_block_pool_t *global_pool, local_block_pool_t *cache)
+{
+    merge_local_cache(cache);
+    global_pool_put_magazine(global_pool, true, &cache->mag_with_data);
+    global_pool_put_magazine(global_pool, false, &cache->mag_without_data);
+}
+
+// flush polled buf to global
+static ALWAYS_INLINE void return_qbuf_to_global(global_block_pool_t *global_pool, umq_buf_t *buf, bool with_data)
+{
+    qbuf_magazine_t mag;
+    umq_buf_list_t list;
+    qbuf_magazine_init(&mag);
+    QBUF_LIST_FIRST(&list) = buf;
+    (void)qbuf_magazine_put(&mag, &list);
+    global_pool_put_magazine(global_pool, with_data, &mag);
 }
 
 static ALWAYS_INLINE umq_buf_t *id_to_buf_with_data_split(char *addr, uint32_t id)
@@ -365,7 +636,7 @@ static ALWAYS_INLINE void umq_qbuf_alloc_data_with_split(local_block_pool_t *loc
     bool first_fragment = true;
 
     QBUF_LIST_FOR_EACH(cur_node, &local_pool->head_with_data) {
-        cur_node->buf_data = floor_to_align(cur_node->buf_data, umq_buf_size_small()) + headroom_size_temp;
+        cur_node->buf_data = (char *)floor_to_align(cur_node->buf_data, umq_buf_size_small()) + headroom_size_temp;
         cur_node->buf_size = umq_buf_size_small() + (uint32_t)sizeof(umq_buf_t);
         cur_node->headroom_size = headroom_size_temp;
         cur_node->total_data_size = total_data_size;
@@ -446,6 +717,65 @@ static ALWAYS_INLINE void umq_qbuf_alloc_data_with_combine(local_block_pool_t *l
     local_pool->buf_cnt_with_data -= num;
 }
 
+// take num qbufs without data from local head into out, each element of out is one qbuf
+static ALWAYS_INLINE void umq_qbuf_alloc_nodata_bulk(local_block_pool_t *local_pool, uint32_t num, umq_buf_t **out)
+{
+    umq_buf_t *cur_node = QBUF_LIST_FIRST(&local_pool->head_without_data);
+    for (uint32_t i = 0; i < num; i++) {
+        umq_buf_t *next = QBUF_LIST_NEXT(cur_node);
+        if (next != NULL) {
+            __builtin_prefetch(next, 1);
+        }
+        QBUF_LIST_NEXT(cur_node) = NULL;
+        out[i] = cur_node;
+        cur_node = next;
+    }
+
+    QBUF_LIST_FIRST(&local_pool->head_without_data) = cur_node;
+    local_pool->buf_cnt_without_data -= num;
+}
+
+/* take num * frag_cnt qbufs from local head into out, each element of out is a chain of frag_cnt qbufs holding one
+ * request. local head is walked only once, header of next qbuf is prefetched while current one is being inited */
+static ALWAYS_INLINE void umq_qbuf_alloc_data_bulk(local_block_pool_t *local_pool, uint32_t request_size,
+    uint32_t num, uint32_t frag_cnt, umq_buf_t **out, uint32_t headroom_size, umq_buf_mode_t mode)
+{
+    uint32_t block_size = umq_buf_size_small();
+    uint32_t max_data_size = mode == UMQ_BUF_SPLIT ? block_size : block_size - (uint32_t)sizeof(umq_buf_t);
+    uint32_t buf_size = mode == UMQ_BUF_SPLIT ? block_size + (uint32_t)sizeof(umq_buf_t) : block_size;
+    umq_buf_t *cur_node = QBUF_LIST_FIRST(&local_pool->head_with_data);
+
+    for (uint32_t i = 0; i < num; i++) {
+        uint32_t remaining_size = request_size;
+        umq_buf_t *last_node = cur_node;
+        out[i] = cur_node;
+        for (uint32_t frag = 0; frag < frag_cnt; frag++) {
+            umq_buf_t *next = QBUF_LIST_NEXT(cur_node);
+            if (next != NULL) {
+                __builtin_prefetch(next, 1);
+            }
+
+            uint32_t headroom_size_temp = frag == 0 ? headroom_size : 0;
+            uint32_t max_data_capacity = max_data_size - headroom_size_temp;
+            cur_node->buf_data = mode == UMQ_BUF_SPLIT ?
+                (char *)floor_to_align(cur_node->buf_data, block_size) + headroom_size_temp :
+                cur_node->data + headroom_size_temp;
+            cur_node->buf_size = buf_size;
+            cur_node->headroom_size = headroom_size_temp;
+            cur_node->total_data_size = frag == 0 ? request_size : 0;
+            cur_node->first_fragment = frag == 0;
+            cur_node->data_size = remaining_size >= max_data_capacity ? max_data_capacity : remaining_size;
+            remaining_size -= cur_node->data_size;
+            last_node = cur_node;
+            cur_node = next;
+        }
+        QBUF_LIST_NEXT(last_node) = NULL;
+    }
+
+    QBUF_LIST_FIRST(&local_pool->head_with_data) = cur_node;
+    local_pool->buf_cnt_with_data -= (uint64_t)num * frag_cnt;
+}
+
 static ALWAYS_INLINE int headroom_reset_with_split(umq_buf_t *qbuf, uint16_t headroom_size, uint32_t block_size)
 {
     umq_buf_t *data = qbuf;
@@ -521,15 +851,44 @@ static ALWAYS_INLINE int headroom_reset(umq_buf_t *qbuf, uint16_t headroom_size,
     return headroom_reset_with_combine(qbuf, headroom_size, block_size);
 }
 
-static ALWAYS_INLINE void umq_qbuf_block_pool_init(global_block_pool_t *block_pool)
+static ALWAYS_INLINE void umq_qbuf_local_block_pool_init(local_block_pool_t *block_pool)
 {
     QBUF_LIST_INIT(&block_pool->head_with_data);
+    block_pool->buf_cnt_with_data = 0;
     QBUF_LIST_INIT(&block_pool->head_without_data);
+    block_pool->buf_cnt_without_data = 0;
+    qbuf_magazine_init(&block_pool->mag_with_data);
+    qbuf_magazine_init(&block_pool->mag_without_data);
+}
+
+static ALWAYS_INLINE void umq_qbuf_block_pool_init(global_block_pool_t *block_pool,
+    umq_qbuf_pool_contention_stats_t *stats)
+{
+    block_pool->mag_top_with_data = NULL;
+    block_pool->mag_top_without_data = NULL;
     block_pool->buf_cnt_with_data = 0;
     block_pool->buf_cnt_without_data = 0;
+    block_pool->lock_free = false;
+    (void)memset(&block_pool->lf_stack_with_data, 0, sizeof(qbuf_lock_free_stack_t));
+    (void)memset(&block_pool->lf_stack_without_data, 0, sizeof(qbuf_lock_free_stack_t));
+    block_pool->stats = stats;
     (void)pthread_mutex_init(&block_pool->global_mutex, NULL);
 }
 
+/* switch global pool to lock free mode, should be called before any qbuf is pushed.
+ * qbufs with data are located at base_with_data + n * stride_with_data, so as qbufs without data */
+static ALWAYS_INLINE void umq_qbuf_block_pool_lock_free_enable(global_block_pool_t *block_pool,
+    char *base_with_data, uint64_t stride_with_data, char *base_without_data, uint64_t stride_without_data)
+{
+    block_pool->lock_free = true;
+    block_pool->lf_stack_with_data.top = 0;
+    block_pool->lf_stack_with_data.base = base_with_data;
+    block_pool->lf_stack_with_data.stride = stride_with_data;
+    block_pool->lf_stack_without_data.top = 0;
+    block_pool->lf_stack_without_data.base = base_without_data;
+    block_pool->lf_stack_without_data.stride = stride_without_data;
+}
+
 static ALWAYS_INLINE void umq_qbuf_block_pool_uninit(global_block_pool_t *block_pool)
 {
     pthread_mutex_destroy(&block_pool->global_mutex);
@@ -96,14 +96,7 @@ static int release_thread_cache(local_qbuf_pool_t *tls_mgmt_pool)
     local_block_pool_t *lblk_pool = &local_pool->block_pool;
 
     // return thread local buffer storage to global pool
-    (void)pthread_mutex_lock(&gblk_pool->global_mutex);
-    if (lblk_pool->head_with_data.first != NULL) {
-        gblk_pool->buf_cnt_with_data += release_batch(&lblk_pool->head_with_data, &gblk_pool->head_with_data);
-    }
-    if (lblk_pool->head_without_data.first != NULL) {
-        gblk_pool->buf_cnt_without_data += release_batch(&lblk_pool->head_without_data, &gblk_pool->head_without_data);
-    }
-    (void)pthread_mutex_unlock(&gblk_pool->global_mutex);
+    flush_local_cache(gblk_pool, lblk_pool);
 
     // reset local record and free resource
     tls_mgmt_pool->pool = NULL;
@@ -185,8 +178,7 @@ static queue_local_pool_t *register_thread_cache(qbuf_pool_t *pool)
     }
 
     local_pool->global_pool = pool;
-    QBUF_LIST_INIT(&local_pool->block_pool.head_with_data);
-    QBUF_LIST_INIT(&local_pool->block_pool.head_without_data);
+    umq_qbuf_local_block_pool_init(&local_pool->block_pool);
     urpc_thread_closure_register(THREAD_CLOSURE_QBUF, 0, release_thread_cache_array);
     g_thread_cache[pool->id].pool = local_pool;
 
@@ -205,7 +197,6 @@ static ALWAYS_INLINE queue_local_pool_t *get_thread_cache(qbuf_pool_t *pool)
 
 static void umq_shm_global_split_pool_init(shm_qbuf_pool_cfg_t *cfg, qbuf_pool_t *pool)
 {
-    QBUF_LIST_INIT(&pool->block_pool.head_without_data);
     uint32_t blk_size = umq_buf_size_small();
     uint64_t blk_num = cfg->total_size / ((UMQ_EMPTY_HEADER_COEFFICIENT + 1) * (uint64_t)sizeof(umq_buf_t) + blk_size);
 
@@ -220,6 +211,13 @@ static void umq_shm_global_split_pool_init(shm_qbuf_pool_cfg_t *cfg, qbuf_pool_t
         return;
     }
 
+    if (cfg->lock_free) {
+        umq_qbuf_block_pool_lock_free_enable(&pool->block_pool, (char *)pool->header_buffer, sizeof(umq_buf_t),
+            (char *)pool->ext_header_buffer, sizeof(umq_buf_t));
+    }
+
+    qbuf_magazine_t mag;
+    qbuf_magazine_init(&mag);
     for (uint64_t i = 0; i < blk_num; i++) {
         umq_buf_t *buf = id_to_buf_with_data_split((char *)pool->header_buffer, i);
         buf->umqh = pool->umqh;
@@ -231,8 +229,9 @@ static void umq_shm_global_split_pool_init(shm_qbuf_pool_cfg_t *cfg, qbuf_pool_t
         buf->buf_data = pool->data_buffer + i * blk_size;
         buf->mempool_id = 0;
         (void)memset(buf->qbuf_ext, 0, sizeof(buf->qbuf_ext));
-        QBUF_LIST_INSERT_HEAD(&pool->block_pool.head_with_data, buf);
+        global_pool_insert_head(&pool->block_pool, true, &mag, buf, SHM_QBUF_POOL_BATCH_CNT);
     }
+    global_pool_init_push_magazine(&pool->block_pool, true, &mag);
 
     uint64_t head_without_data_count = blk_num * UMQ_EMPTY_HEADER_COEFFICIENT;
     for (uint64_t i = 0; i < head_without_data_count; i++) {
@@ -246,10 +245,9 @@ static void umq_shm_global_split_pool_init(shm_qbuf_pool_cfg_t *cfg, qbuf_pool_t
         head_buf->buf_data = NULL;
         head_buf->mempool_id = 0;
         (void)memset(head_buf->qbuf_ext, 0, sizeof(head_buf->qbuf_ext));
-        QBUF_LIST_INSERT_HEAD(&pool->block_pool.head_without_data, head_buf);
+        global_pool_insert_head(&pool->block_pool, false, &mag, head_buf, SHM_QBUF_POOL_BATCH_CNT);
     }
-    pool->block_pool.buf_cnt_with_data = blk_num;
-    pool->block_pool.buf_cnt_without_data = head_without_data_count;
+    global_pool_init_push_magazine(&pool->block_pool, false, &mag);
 }
 
 static void umq_shm_global_combine_pool_init(shm_qbuf_pool_cfg_t *cfg, qbuf_pool_t *pool)
@@ -268,6 +266,13 @@ static void umq_shm_global_combine_pool_init(shm_qbuf_pool_cfg_t *cfg, qbuf_pool
         return;
     }
 
+    if (cfg->lock_free) {
+        umq_qbuf_block_pool_lock_free_enable(&pool->block_pool, (char *)pool->data_buffer, blk_size, NULL,
+            sizeof(umq_buf_t));
+    }
+
+    qbuf_magazine_t mag;
+    qbuf_magazine_init(&mag);
     for (uint64_t i = 0; i < blk_num; i++) {
         umq_buf_t *buf = id_to_buf_combine((char *)pool->data_buffer, i, pool->block_size);
         buf->umqh = pool->umqh;
@@ -279,10 +284,9 @@ static void umq_shm_global_combine_pool_init(shm_qbuf_pool_cfg_t *cfg, qbuf_pool
         buf->buf_data = (char *)buf + sizeof(umq_buf_t);
         buf->mempool_id = 0;
         (void)memset(buf->qbuf_ext, 0, sizeof(buf->qbuf_ext));
-        QBUF_LIST_INSERT_HEAD(&pool->block_pool.head_with_data, buf);
+        global_pool_insert_head(&pool->block_pool, true, &mag, buf, SHM_QBUF_POOL_BATCH_CNT);
     }
-    pool->block_pool.buf_cnt_with_data = blk_num;
-    pool->block_pool.buf_cnt_without_data = 0;
+    global_pool_init_push_magazine(&pool->block_pool, true, &mag);
 }
 
 // Internal function, validation performed by the caller
@@ -293,8 +297,7 @@ uint64_t umq_shm_global_pool_init(shm_qbuf_pool_cfg_t *cfg)
         return UMQ_INVALID_HANDLE;
     }
 
-    (void)pthread_mutex_init(&pool->block_pool.global_mutex, NULL);
-    QBUF_LIST_INIT(&pool->block_pool.head_with_data);
+    umq_qbuf_block_pool_init(&pool->block_pool, umq_qbuf_pool_contention_stats_ctx(UMQ_QBUF_POOL_KIND_SHM));
     pool->type = cfg->type;
     pool->mode = cfg->mode;
     pool->total_size = cfg->total_size;
@@ -323,22 +326,22 @@ void umq_shm_global_pool_uninit(uint64_t pool)
     }
 
     unregister_all_thread_cache(_pool);
-    pthread_mutex_destroy(&_pool->block_pool.global_mutex);
+    umq_qbuf_block_pool_uninit(&_pool->block_pool);
     free(_pool);
 }
 
-static ALWAYS_INLINE int umq_shm_dequeue_qbuf(msg_ring_t *msg_ring, uint64_t *offset, uint32_t num)
+static ALWAYS_INLINE int umq_shm_dequeue_qbuf(msg_ring_t *msg_ring, umq_shm_qbuf_desc_t *desc, uint32_t num)
 {
     uint32_t max_num = num > SHM_QBUF_POOL_BATCH_CNT ? SHM_QBUF_POOL_BATCH_CNT : num;
-    uint64_t *rx_data_ptr[SHM_QBUF_POOL_BATCH_CNT];
+    umq_shm_qbuf_desc_t *rx_data_ptr[SHM_QBUF_POOL_BATCH_CNT];
     for (uint32_t i = 0; i < max_num; i++) {
-        rx_data_ptr[i] = &offset[i];
+        rx_data_ptr[i] = &desc[i];
     }
 
-    // poll offset from shm, then transform to qbuf
+    // poll descriptor from shm, then transform to qbuf
     uint32_t polled_buf_size[SHM_QBUF_POOL_BATCH_CNT];
-    int ret =
-        msg_ring_poll_rx_batch(msg_ring, (char **)&rx_data_ptr, sizeof(uint64_t), polled_buf_size, max_num);
+    int ret = msg_ring_poll_rx_batch(msg_ring, (char **)&rx_data_ptr, sizeof(umq_shm_qbuf_desc_t),
+        polled_buf_size, max_num);
     if (ret < 0) {
         UMQ_VLOG_ERR("ipc poll rx failed\n");
         return -UMQ_ERR_EAGAIN;
@@ -347,25 +350,52 @@ static ALWAYS_INLINE int umq_shm_dequeue_qbuf(msg_ring_t *msg_ring, uint64_t *of
     return ret;
 }
 
-// transform offset and its qbuf_data and qbuf_next to pointer
-static ALWAYS_INLINE umq_buf_t *umq_shm_offset_to_qbuf_pointer(uint64_t offset, uint64_t pool, uint64_t umqh)
+/* transform descriptor and qbuf_data and qbuf_next of the chain to pointer. the chain is written by peer, walk
+ * no more than qbuf_cnt of descriptor so that a broken chain can not loop forever. if the chain does not match
+ * the descriptor, NULL is returned and walked is set to the qbufs transformed so far, ending with NULL qbuf_next,
+ * for the caller to reclaim */
+static ALWAYS_INLINE umq_buf_t *umq_shm_desc_to_qbuf_pointer(umq_shm_qbuf_desc_t *desc, uint64_t pool, uint64_t umqh,
+    umq_buf_t **walked)
 {
-    umq_buf_t *head, *next, *result;
-    result = umq_offset_to_qbuf(offset, pool);
-    if (result == NULL) {
+    umq_buf_t *result = umq_offset_to_qbuf(desc->offset & UMQ_OFFSET_DATA_BITS, pool);
+    *walked = NULL;
+    if (result == NULL || desc->qbuf_cnt == 0) {
+        UMQ_LIMIT_VLOG_ERR("qbuf descriptor is invalid, qbuf count: %u\n", desc->qbuf_cnt);
         return NULL;
     }
 
-    next = result;
-    do {
-        head = next;
+    umq_buf_t *head = result;
+    uint64_t total_size = 0;
+    for (uint32_t i = 0; i < desc->qbuf_cnt; i++) {
+        uint64_t next_offset = (uint64_t)(uintptr_t)head->qbuf_next;
         head->buf_data = umq_offset_to_qbuf_data((uint64_t)(uintptr_t)head->buf_data, head->data_size, pool);
-        head->qbuf_next = umq_offset_to_qbuf((uint64_t)(uintptr_t)head->qbuf_next, pool);
         head->umqh = umqh;
-        next = head->qbuf_next;
-    } while (next != NULL);
+        total_size += head->data_size;
+        if (i + 1 == desc->qbuf_cnt) {
+            head->qbuf_next = NULL;
+            if (next_offset != QBUF_INVALID_OFFSET) {
+                UMQ_LIMIT_VLOG_ERR("qbuf chain is longer than descriptor, qbuf count: %u\n", desc->qbuf_cnt);
+                *walked = result;
+                return NULL;
+            }
+            break;
+        }
 
-return result;
+        head->qbuf_next = umq_offset_to_qbuf(next_offset, pool);
+        if (head->qbuf_next == NULL) {
+            UMQ_LIMIT_VLOG_ERR("qbuf chain is shorter than descriptor, qbuf count: %u\n", desc->qbuf_cnt);
+            *walked = result;
+            return NULL;
+        }
+        head = head->qbuf_next;
+    }
+
+    if (total_size != desc->total_size) {
+        UMQ_LIMIT_VLOG_ERR("qbuf chain size %lu mismatch descriptor size %u\n", total_size, desc->total_size);
+        *walked = result;
+        return NULL;
+    }
+    return result;
 }
 
 static ALWAYS_INLINE bool is_with_data(umq_buf_t *qbuf, qbuf_pool_t *pool)
@@ -380,16 +410,21 @@ static ALWAYS_INLINE bool is_with_data(umq_buf_t *qbuf, qbuf_pool_t *pool)
 static ALWAYS_INLINE void umq_shm_poll_and_fill_global(qbuf_pool_t *pool)
 {
     // poll released buf from msg_ring rx, and return them to global pool
-    uint64_t qbuf_offset[SHM_QBUF_POOL_BATCH_CNT];
+    umq_shm_qbuf_desc_t desc[SHM_QBUF_POOL_BATCH_CNT];
     uint32_t max_count = SHM_QBUF_POOL_BATCH_CNT;
-    int ret = umq_shm_dequeue_qbuf(pool->msg_ring, qbuf_offset, max_count);
+    int ret = umq_shm_dequeue_qbuf(pool->msg_ring, desc, max_count);
     if (ret < 0) {
         UMQ_VLOG_ERR("umq_shm_dequeue_qbuf return: %d\n", ret);
         return;
     }
 
     for (int i = 0; i < ret; i++) {
-        umq_buf_t *qbuf = umq_shm_offset_to_qbuf_pointer(qbuf_offset[i], (uint64_t)(uintptr_t)pool, pool->umqh);
+        umq_buf_t *walked;
+        umq_buf_t *qbuf = umq_shm_desc_to_qbuf_pointer(&desc[i], (uint64_t)(uintptr_t)pool, pool->umqh, &walked);
+        if (qbuf == NULL) {
+            // the released chain is broken, still take back the part of it that was walked
+            qbuf = walked;
+        }
         if (qbuf == NULL) {
             continue;
         }
@@ -487,7 +522,7 @@ int umq_shm_qbuf_alloc(
         // fetch from global first, if thread local qbuf is not enough for allocate operation
         while (lblk_pool->buf_cnt_without_data < num) {
             umq_shm_poll_and_fill_global(_pool);
-            if (fetch_from_global(gblk_pool, lblk_pool, false, SHM_QBUF_POOL_BATCH_CNT) <= 0) {
+            if (refill_local_cache(gblk_pool, lblk_pool, false) <= 0) {
                 return -UMQ_ERR_ENOMEM;
             }
         }
@@ -500,7 +535,7 @@ int umq_shm_qbuf_alloc(
     // fetch from global first, if thread local qbuf is not enough for allocate operation
     while (lblk_pool->buf_cnt_with_data < actual_buf_count) {
         umq_shm_poll_and_fill_global(_pool);
-        if (fetch_from_global(gblk_pool, lblk_pool, true, SHM_QBUF_POOL_BATCH_CNT) <= 0) {
+        if (refill_local_cache(gblk_pool, lblk_pool, true) <= 0) {
             UMQ_VLOG_ERR("fetch from global failed, current size: %u, alloc num: %u\n",
                 lblk_pool->buf_cnt_with_data, actual_buf_count);
             return -UMQ_ERR_ENOMEM;
@@ -516,9 +551,9 @@ int umq_shm_qbuf_alloc(
     return UMQ_SUCCESS;
 }
 
-static ALWAYS_INLINE int umq_shm_enqueue_qbuf(msg_ring_t *msg_ring, uint64_t offset)
+static ALWAYS_INLINE int umq_shm_enqueue_qbuf(msg_ring_t *msg_ring, umq_shm_qbuf_desc_t *desc)
 {
-    int ret = msg_ring_post_rx(msg_ring, (char *)&offset, sizeof(uint64_t));
+    int ret = msg_ring_post_rx(msg_ring, (char *)desc, sizeof(umq_shm_qbuf_desc_t));
     if (ret != 0) {
         UMQ_VLOG_ERR("msg_ring post rx failed\n");
         return ret;
@@ -526,23 +561,31 @@ static ALWAYS_INLINE int umq_shm_enqueue_qbuf(msg_ring_t *msg_ring, uint64_t off
     return UMQ_SUCCESS;
 }
 
-static ALWAYS_INLINE uint64_t umq_shm_qbuf_pointer_to_offset(umq_buf_t *qbuf, uint64_t pool)
+// transform qbuf chain and its qbuf_data and qbuf_next to offset, and describe the chain in desc
+static ALWAYS_INLINE void umq_shm_qbuf_pointer_to_desc(umq_buf_t *qbuf, uint64_t pool, umq_shm_qbuf_desc_t *desc)
 {
     umq_buf_t *head, *next = qbuf;
+    uint32_t qbuf_cnt = 0;
+    uint32_t total_size = 0;
     do {
         head = next;
         next = head->qbuf_next;
+        qbuf_cnt++;
+        total_size += head->data_size;
         head->buf_data = (char *)(uintptr_t)umq_qbuf_data_to_offset(head->buf_data, pool);
         head->qbuf_next = (umq_buf_t *)(uintptr_t)umq_qbuf_to_offset(head->qbuf_next, pool);
     } while (next != NULL);
 
-    return umq_qbuf_to_offset(qbuf, pool);
+    desc->offset = umq_qbuf_to_offset(qbuf, pool);
+    desc->qbuf_cnt = qbuf_cnt;
+    desc->total_size = total_size;
 }
 
 static ALWAYS_INLINE void post_release_buf(qbuf_pool_t *pool, umq_buf_list_t *list)
 {
-    uint64_t offset = umq_shm_qbuf_pointer_to_offset(QBUF_LIST_FIRST(list), (uint64_t)(uintptr_t)pool);
-    umq_shm_enqueue_qbuf(pool->msg_ring, offset);
+    umq_shm_qbuf_desc_t desc;
+    umq_shm_qbuf_pointer_to_desc(QBUF_LIST_FIRST(list), (uint64_t)(uintptr_t)pool, &desc);
+    umq_shm_enqueue_qbuf(pool->msg_ring, &desc);
 }
 
 void umq_shm_qbuf_free(uint64_t pool, umq_buf_list_t *list)
@@ -570,27 +613,13 @@ void umq_shm_qbuf_free(uint64_t pool, umq_buf_list_t *list)
     // split mode and buf is in head no data zone
     if (_pool->mode == UMQ_BUF_SPLIT &&
         (void *)QBUF_LIST_FIRST(list) >= _pool->ext_header_buffer) {
-        // put buf list before head of head_without_data
-        uint32_t cnt = release_batch(list, &lblk_pool->head_without_data);
-        lblk_pool->buf_cnt_without_data += cnt;
-
-        /* if local list node count reaches SHM_QBUF_POOL_TLS_MAX + SHM_QBUF_POOL_BATCH_CNT,
-         * return some nodes to global */
-        if (lblk_pool->buf_cnt_without_data >= SHM_QBUF_POOL_TLS_MAX + SHM_QBUF_POOL_BATCH_CNT) {
-            return_to_global(gblk_pool, lblk_pool, false, SHM_QBUF_POOL_TLS_MAX);
-        }
-
+        /* once SHM_QBUF_POOL_BATCH_CNT nodes released, move them to local head,
+         * or to global if local head is full */
+        release_to_local_cache(gblk_pool, lblk_pool, false, list, SHM_QBUF_POOL_BATCH_CNT, SHM_QBUF_POOL_TLS_MAX);
         return;
     }
 
-    uint32_t cnt = release_batch(list, &lblk_pool->head_with_data);
-    lblk_pool->buf_cnt_with_data += cnt;
-
-    /* if local list node count reaches SHM_QBUF_POOL_TLS_MAX + SHM_QBUF_POOL_BATCH_CNT,
-     * return some nodes to global */
-    if (lblk_pool->buf_cnt_with_data > SHM_QBUF_POOL_TLS_MAX + SHM_QBUF_POOL_BATCH_CNT) {
-        return_to_global(gblk_pool, lblk_pool, true, SHM_QBUF_POOL_TLS_MAX);
-    }
+    release_to_local_cache(gblk_pool, lblk_pool, true, list, SHM_QBUF_POOL_BATCH_CNT, SHM_QBUF_POOL_TLS_MAX);
 }
 
 int umq_shm_qbuf_headroom_reset(uint64_t pool, umq_buf_t *qbuf, uint16_t headroom_size)
@@ -677,33 +706,116 @@ char *umq_offset_to_qbuf_data(uint64_t offset, uint32_t data_size, uint64_t pool
 }
 
 int umq_shm_qbuf_enqueue(umq_buf_t *qbuf, uint64_t umq, uint64_t pool, bool rendezvous,
-    int (*enqueue)(uint64_t umq, uint64_t *offset, uint32_t num))
+    int (*enqueue)(uint64_t umq, umq_shm_qbuf_desc_t *desc, uint32_t num))
 {
-    uint64_t qbuf_offset = umq_shm_qbuf_pointer_to_offset(qbuf, pool);
-    if (qbuf_offset == QBUF_INVALID_OFFSET) {
+    umq_shm_qbuf_desc_t desc;
+    umq_shm_qbuf_pointer_to_desc(qbuf, pool, &desc);
+    if (desc.offset == QBUF_INVALID_OFFSET) {
         return UMQ_FAIL;
     }
 
     if (rendezvous) {
-        qbuf_offset |= UMQ_RENDEZVOUS_FLAG;
+        desc.offset |= UMQ_RENDEZVOUS_FLAG;
     }
 
-    int ret = enqueue(umq, &qbuf_offset, 1);
+    uint64_t umqh = qbuf->umqh;
+    int ret = enqueue(umq, &desc, 1);
     if (ret != UMQ_SUCCESS) {
-        umq_shm_offset_to_qbuf_pointer((qbuf_offset & UMQ_OFFSET_DATA_BITS), pool, qbuf->umqh);
+        // the chain is still owned by the caller, restore it only
+        umq_buf_t *walked;
+        (void)umq_shm_desc_to_qbuf_pointer(&desc, pool, umqh, &walked);
     }
     return ret;
 }
 
+// a received chain which does not match its descriptor is dropped, the qbufs walked before the mismatch are freed
+static umq_buf_t *umq_shm_desc_to_qbuf_pointer_or_reclaim(umq_shm_qbuf_desc_t *desc, uint64_t pool, uint64_t umqh)
+{
+    umq_buf_t *walked;
+    umq_buf_t *qbuf = umq_shm_desc_to_qbuf_pointer(desc, pool, umqh, &walked);
+    if (qbuf == NULL && walked != NULL) {
+        umq_buf_list_t list;
+        QBUF_LIST_FIRST(&list) = walked;
+        umq_shm_qbuf_free(pool, &list);
+    }
+    return qbuf;
+}
+
 umq_buf_t *umq_shm_qbuf_dequeue(uint64_t umq, uint64_t umq_tp, uint64_t pool, bool *rendezvous,
-    int (*dequeue)(uint64_t umq, uint64_t *offset, uint32_t num))
+    int (*dequeue)(uint64_t umq, umq_shm_qbuf_desc_t *desc, uint32_t num))
 {
-    uint64_t offset;
-    int cnt = dequeue(umq_tp, &offset, 1);
+    umq_shm_qbuf_desc_t desc;
+    int cnt = dequeue(umq_tp, &desc, 1);
     if (cnt <= 0) {
         return NULL;
     }
-    *rendezvous = (offset & UMQ_RENDEZVOUS_FLAG);
+    *rendezvous = (desc.offset & UMQ_RENDEZVOUS_FLAG);
 
-    return umq_shm_offset_to_qbuf_pointer((offset & UMQ_OFFSET_DATA_BITS), pool, umq);
-}
\ No newline at end of file
+    return umq_shm_desc_to_qbuf_pointer_or_reclaim(&desc, pool, umq);
+}
+int umq_shm_qbuf_dequeue_burst(uint64_t umq, uint64_t umq_tp, uint64_t pool, umq_buf_t **bufs, bool *rendezvous,
+    uint32_t max, int (*dequeue)(uint64_t umq, umq_shm_qbuf_desc_t *desc, uint32_t num))
+{
+    umq_shm_qbuf_desc_t desc[max];
+    int cnt = dequeue(umq_tp, desc, max);
+    if (cnt <= 0) {
+        return cnt;
+    }
+
+    int buf_cnt = 0;
+    for (int i = 0; i < cnt; i++) {
+        umq_buf_t *qbuf = umq_shm_desc_to_qbuf_pointer_or_reclaim(&desc[i], pool, umq);
+        if (qbuf == NULL) {
+            continue;
+        }
+        if (rendezvous != NULL) {
+            rendezvous[buf_cnt] = (desc[i].offset & UMQ_RENDEZVOUS_FLAG);
+        }
+        bufs[buf_cnt++] = qbuf;
+    }
+    return buf_cnt;
+}
+
+// a message ends at the buf whose data size adds up to total_data_size of its first buf
+static umq_buf_t *shm_qbuf_cut_msg(umq_buf_t *head)
+{
+    umq_buf_t *last = head;
+    uint32_t rest_data_size = head->total_data_size;
+    while (last->qbuf_next != NULL && rest_data_size > last->data_size) {
+        rest_data_size -= last->data_size;
+        last = last->qbuf_next;
+    }
+    umq_buf_t *next = last->qbuf_next;
+    last->qbuf_next = NULL;
+    return next;
+}
+
+uint32_t umq_shm_qbuf_cut_msgs(umq_buf_t **pending, umq_buf_t **chains, uint32_t chain_cnt, umq_buf_t **msgs,
+    uint32_t max)
+{
+    uint32_t cnt = 0;
+    uint32_t idx = 0;
+    umq_buf_t *cur = *pending;
+    while (cnt < max) {
+        if (cur == NULL) {
+            if (idx == chain_cnt) {
+                break;
+            }
+            cur = chains[idx++];
+            continue;
+        }
+        msgs[cnt++] = cur;
+        cur = shm_qbuf_cut_msg(cur);
+    }
+
+    // link the rest, they are returned first next time
+    *pending = cur;
+    umq_buf_t **link = pending;
+    for (; idx < chain_cnt; idx++) {
+        while (*link != NULL) {
+            link = &(*link)->qbuf_next;
+        }
+        *link = chains[idx];
+    }
+    return cnt;
+}
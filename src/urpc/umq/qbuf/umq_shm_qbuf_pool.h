@@ -19,6 +19,17 @@
 extern "C" {
 #endif
 
+/* descriptor carried by msg_ring instead of payload. it points to a qbuf chain in shared qbuf pool, and the
+ * ownership of the chain moves to peer with it, until peer releases the chain back with another descriptor */
+typedef struct umq_shm_qbuf_desc {
+    uint64_t offset;        // offset of first qbuf in shared qbuf pool, the highest bit is rendezvous flag
+    uint32_t qbuf_cnt;      // count of qbufs in the chain, peer walks no more than this
+    uint32_t total_size;    // sum of data size of all qbufs in the chain
+} umq_shm_qbuf_desc_t;
+
+// msg_ring slot holds payload size ahead of payload
+#define UMQ_SHM_QBUF_DESC_SLOT_SIZE ((uint32_t)(sizeof(uint32_t) + sizeof(umq_shm_qbuf_desc_t)))
+
 typedef enum shm_qbuf_pool_type {
     SHM_QBUF_POOL_TYPE_LOCAL,
     SHM_QBUF_POOL_TYPE_REMOTE
@@ -38,6 +49,7 @@ typedef struct shm_qbuf_pool_cfg {
         } local;
     };
     msg_ring_t *msg_ring;
+    bool lock_free;             // global pool uses lock free stack instead of mutex, only for local type
 } shm_qbuf_pool_cfg_t;
 
 /*
@@ -91,16 +103,33 @@ umq_buf_t *umq_offset_to_qbuf(uint64_t offset, uint64_t pool);
 char *umq_offset_to_qbuf_data(uint64_t offset, uint32_t data_size, uint64_t pool);
 
 /*
- * transfer qbuf/qbuf data ptr to offset, and enqueue qbuf offset to ring
+ * transfer qbuf/qbuf data ptr to offset, and enqueue descriptor of qbuf chain to ring
  */
 int umq_shm_qbuf_enqueue(umq_buf_t *qbuf, uint64_t umq, uint64_t pool, bool rendezvous,
-    int (*enqueue)(uint64_t umq, uint64_t *offset, uint32_t num));
+    int (*enqueue)(uint64_t umq, umq_shm_qbuf_desc_t *desc, uint32_t num));
 
 /*
- * dequeue qbuf offset from ring, and transfer qbuf/qbuf data offset to ptr
+ * dequeue descriptor from ring, and transfer qbuf/qbuf data offset to ptr.
+ * NULL is returned if the chain does not match its descriptor
  */
 umq_buf_t *umq_shm_qbuf_dequeue(uint64_t umq, uint64_t umq_tp, uint64_t pool, bool *rendezvous,
-    int (*dequeue)(uint64_t umq, uint64_t *offset, uint32_t num));
+    int (*dequeue)(uint64_t umq, umq_shm_qbuf_desc_t *desc, uint32_t num));
+
+/*
+ * dequeue up to max descriptors from ring in one poll, bufs[i] is the chain of the i-th valid descriptor.
+ * descriptors whose chain does not match are dropped. rendezvous can be NULL if flags are not cared.
+ * Return count of bufs filled, or error code returned by dequeue
+ */
+int umq_shm_qbuf_dequeue_burst(uint64_t umq, uint64_t umq_tp, uint64_t pool, umq_buf_t **bufs, bool *rendezvous,
+    uint32_t max, int (*dequeue)(uint64_t umq, umq_shm_qbuf_desc_t *desc, uint32_t num));
+
+/*
+ * one descriptor carries the whole chain of an enqueue, which may be several messages. cut messages by
+ * total_data_size from *pending first, then from chains in order, until max messages are written to msgs.
+ * chains left are linked to *pending. Return count of messages written to msgs
+ */
+uint32_t umq_shm_qbuf_cut_msgs(umq_buf_t **pending, umq_buf_t **chains, uint32_t chain_cnt, umq_buf_t **msgs,
+    uint32_t max);
 
 #ifdef __cplusplus
 }
@@ -696,6 +696,99 @@ void umq_buf_free(umq_buf_t *qbuf)
     umq->tp_ops->umq_tp_buf_free(qbuf, umq->umqh_tp);
 }
 
+// break qbuf list allocated for num requests into array out, one request per element
+static void umq_buf_list_to_array(umq_buf_t *qbuf, uint32_t num, umq_buf_t **out)
+{
+    umq_buf_t *cur_node = qbuf;
+    for (uint32_t i = 0; i < num && cur_node != NULL; i++) {
+        out[i] = cur_node;
+        uint32_t rest_data_size = cur_node->total_data_size;
+        while (QBUF_LIST_NEXT(cur_node) != NULL && rest_data_size > cur_node->data_size) {
+            rest_data_size -= cur_node->data_size;
+            cur_node = QBUF_LIST_NEXT(cur_node);
+        }
+        umq_buf_t *next_node = QBUF_LIST_NEXT(cur_node);
+        QBUF_LIST_NEXT(cur_node) = NULL;
+        cur_node = next_node;
+    }
+}
+
+int umq_buf_alloc_bulk(uint64_t umqh, uint32_t request_size, uint32_t num, umq_alloc_option_t *option,
+    umq_buf_t **out)
+{
+    if (!g_umq_inited || num == 0 || out == NULL || request_size > UMQ_MAX_BUF_REQUEST_SIZE) {
+        UMQ_VLOG_ERR("param invalid or umq not initialized\n");
+        return -UMQ_ERR_EINVAL;
+    }
+    uint32_t headroom_size = (option != NULL && (option->flag & UMQ_ALLOC_FLAG_HEAD_ROOM_SIZE) != 0) ?
+        option->headroom_size : umq_qbuf_headroom_get();
+    if (headroom_size > UMQ_HEADROOM_SIZE_LIMIT) {
+        UMQ_VLOG_ERR("headroom size %u exceeds the maximum value\n", headroom_size);
+        return -UMQ_ERR_EINVAL;
+    }
+
+    uint32_t factor = (umq_qbuf_mode_get() == UMQ_BUF_SPLIT) ? 0 : sizeof(umq_buf_t);
+    if (umqh == UMQ_INVALID_HANDLE && request_size + headroom_size + factor < umq_buf_size_middle()) {
+        return umq_qbuf_alloc_bulk(request_size, num, option, out);
+    }
+
+    // huge qbuf pool and shared memory pools of transport only alloc qbuf list
+    umq_buf_t *qbuf = umq_buf_alloc(request_size, num, umqh, option);
+    if (qbuf == NULL) {
+        return -UMQ_ERR_ENOMEM;
+    }
+    umq_buf_list_to_array(qbuf, num, out);
+    return UMQ_SUCCESS;
+}
+
+// link the run of qbufs owned by the same umq into one list, so that transport releases them in one call
+static uint32_t umq_buf_link_same_umq(umq_buf_t **bufs, uint32_t num)
+{
+    uint32_t cnt = 1;
+    umq_buf_t *tail = bufs[0];
+    for (; cnt < num && bufs[cnt] != NULL && bufs[cnt]->umqh == bufs[0]->umqh; cnt++) {
+        while (tail->qbuf_next != NULL) {
+            tail = tail->qbuf_next;
+        }
+        tail->qbuf_next = bufs[cnt];
+        tail = bufs[cnt];
+    }
+    return cnt;
+}
+
+void umq_buf_free_bulk(umq_buf_t **bufs, uint32_t num)
+{
+    if (!g_umq_inited || bufs == NULL) {
+        return;
+    }
+
+    // release each run of qbufs from the global memory pool or from the same umq as a whole, others one by one
+    uint32_t start = 0;
+    uint32_t i = 0;
+    while (i < num) {
+        umq_buf_t *qbuf = bufs[i];
+        if (qbuf != NULL && qbuf->umqh == UMQ_INVALID_HANDLE && qbuf->mempool_id == UMQ_QBUF_DEFAULT_MEMPOOL_ID) {
+            i++;
+            continue;
+        }
+
+        if (i > start) {
+            umq_qbuf_free_bulk(bufs + start, i - start);
+        }
+        uint32_t cnt = 1;
+        if (qbuf != NULL && qbuf->umqh != UMQ_INVALID_HANDLE) {
+            cnt = umq_buf_link_same_umq(bufs + i, num - i);
+        }
+        umq_buf_free(qbuf);
+        i += cnt;
+        start = i;
+    }
+
+    if (num > start) {
+        umq_qbuf_free_bulk(bufs + start, num - start);
+    }
+}
+
 umq_buf_t *umq_buf_break_and_free(umq_buf_t *qbuf)
 {
     if (!g_umq_inited || qbuf == NULL) {
@@ -817,6 +910,28 @@ umq_buf_t *umq_dequeue(uint64_t umqh)
     return umq_buf;
 }
 
+int umq_dequeue_burst(uint64_t umqh, umq_buf_t **bufs, uint32_t max)
+{
+    uint64_t start_timestamp = umq_perf_get_start_timestamp();
+    umq_t *umq = (umq_t *)(uintptr_t)umqh;
+
+    if ((umq == NULL) || (umq->umqh_tp == UMQ_INVALID_HANDLE) || (umq->tp_ops == NULL) ||
+        (umq->tp_ops->umq_tp_dequeue_burst == NULL)) {
+        UMQ_VLOG_ERR("umqh invalid\n");
+        return -UMQ_ERR_EINVAL;
+    }
+
+    if (bufs == NULL || max == 0) {
+        UMQ_VLOG_ERR("parameter invalid\n");
+        return -UMQ_ERR_EINVAL;
+    }
+
+    uint32_t max_cnt = max > UMQ_BATCH_SIZE ? UMQ_BATCH_SIZE : max;
+    int cnt = umq->tp_ops->umq_tp_dequeue_burst(umq->umqh_tp, bufs, max_cnt);
+    umq_perf_record_write_dequeue(start_timestamp, cnt <= 0);
+    return cnt;
+}
+
 void umq_notify(uint64_t umqh)
 {
     uint64_t start_timestamp = umq_perf_get_start_timestamp();
@@ -1086,7 +1201,14 @@ int umq_mempool_state_get(uint64_t umqh, uint32_t mempool_id, umq_mempool_state_
         return -UMQ_ERR_EINVAL;
     }
 
-    return umq->tp_ops->umq_tp_mempool_state_get(umq->umqh_tp, mempool_id, mempool_state);
+    int ret = umq->tp_ops->umq_tp_mempool_state_get(umq->umqh_tp, mempool_id, mempool_state);
+    if (ret != UMQ_SUCCESS || mempool_id != UMQ_QBUF_DEFAULT_MEMPOOL_ID) {
+        mempool_state->numa_node_num = 0;
+        return ret;
+    }
+
+    umq_qbuf_pool_numa_state_get(mempool_state);
+    return UMQ_SUCCESS;
 }
 
 int umq_mempool_state_refresh(uint64_t umqh, uint32_t mempool_id)
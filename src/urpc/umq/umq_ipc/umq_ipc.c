@@ -90,6 +90,11 @@ static umq_buf_t *umq_tp_ipc_dequeue(uint64_t umqh_tp)
     return umq_ipc_dequeue_impl(umqh_tp);
 }
 
+static int umq_tp_ipc_dequeue_burst(uint64_t umqh_tp, umq_buf_t **bufs, uint32_t max)
+{
+    return umq_ipc_dequeue_burst_impl(umqh_tp, bufs, max);
+}
+
 static void umq_tp_ipc_notify(uint64_t umqh_tp)
 {
     umq_ipc_notify_impl(umqh_tp);
@@ -127,6 +132,7 @@ static umq_ops_t g_umq_ipc_ops = {
     .umq_tp_buf_headroom_reset = umq_tp_ipc_buf_headroom_reset,
     .umq_tp_enqueue = umq_tp_ipc_enqueue,
     .umq_tp_dequeue = umq_tp_ipc_dequeue,
+    .umq_tp_dequeue_burst = umq_tp_ipc_dequeue_burst,
     .umq_tp_notify = umq_tp_ipc_notify,
     .umq_tp_rearm_interrupt = umq_tp_ipc_rearm_interrupt,
     .umq_tp_wait_interrupt = umq_tp_ipc_wait_interrupt,
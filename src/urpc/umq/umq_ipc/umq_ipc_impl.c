@@ -3,7 +3,6 @@
  * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
  * Description: ipc impl realization for UMQ
  */
-#include <sys/syscall.h>
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
@@ -11,7 +10,6 @@
 #include <sys/mman.h>
 #include <unistd.h>
 #include <stdio.h>
-#include <linux/futex.h>
 
 #include "msg_ring.h"
 #include "umq_vlog.h"
@@ -24,6 +22,7 @@ typedef struct umq_ipc_init_ctx {
     uint32_t feature;
     volatile uint32_t ref_cnt;
     bool io_lock_free;
+    umq_ipc_wait_cfg_t wait_cfg;
 } umq_ipc_init_ctx_t;
 
 typedef struct umq_ipc_ring_info {
@@ -44,6 +43,7 @@ typedef struct ipc_bind_ctx {
     uint64_t qbuf_pool_handle;
     msg_ring_t *remote_msg_ring;
     umq_ipc_ring_info_t remote_ring;
+    umq_buf_t *rx_pending;  // messages polled but not returned by umq_dequeue_burst yet
 } ipc_bind_ctx_t;
 
 typedef struct umq_ipc_info {
@@ -56,6 +56,7 @@ typedef struct umq_ipc_info {
     uint32_t umq_id;
     uint64_t umqh;
     umq_queue_mode_t queue_mode;
+    msg_ring_waiter_t waiter[UMQ_IO_MAX];   // spin window of umq_wait_interrupt in each direction
 } umq_ipc_info_t;
 
 typedef struct umq_ipc_bind_info {
@@ -104,6 +105,7 @@ uint8_t *umq_ipc_ctx_init_impl(umq_init_cfg_t *cfg)
 
         g_ipc_ctx->io_lock_free = cfg->io_lock_free;
         g_ipc_ctx->feature = cfg->feature;
+        g_ipc_ctx->wait_cfg = cfg->ipc_wait_cfg;
         g_ipc_ctx->ref_cnt = 1;
         break;
     }
@@ -216,17 +218,42 @@ static ALWAYS_INLINE int fill_ring_info(umq_create_option_t *option, umq_ipc_rin
     ring->tx_depth = (option->create_flag & UMQ_CREATE_FLAG_TX_DEPTH) ? option->tx_depth : UMQ_DEFAULT_DEPTH;
     ring->rx_depth = ring->tx_depth;
 
-    uint64_t data_zone_size =
-        ring->tx_depth * (umq_buf_size_small() + sizeof(umq_buf_t) * (1 + UMQ_EMPTY_HEADER_COEFFICIENT));
-
     // transmit queue and manage queue size calculate
-    uint64_t post_data_size = sizeof(uint32_t) + sizeof(uint64_t);
-    uint64_t tx_post_queue_size = sizeof(shm_ring_hdr_t) + ring->tx_depth * post_data_size;
-    uint64_t rx_post_queue_size = sizeof(shm_ring_hdr_t) + ring->tx_depth * post_data_size;
-    uint64_t rounded_post_size = round_up(tx_post_queue_size + rx_post_queue_size, umq_buf_size_small());
+    msg_ring_option_t ring_option = {
+        .tx_max_buf_size = UMQ_SHM_QBUF_DESC_SLOT_SIZE,
+        .tx_depth = ring->tx_depth,
+        .rx_max_buf_size = UMQ_SHM_QBUF_DESC_SLOT_SIZE,
+        .rx_depth = ring->tx_depth,
+    };
+    uint64_t rounded_post_size = round_up(msg_ring_shm_size(&ring_option), umq_buf_size_small());
     ring->transmit_queue_buf_size = rounded_post_size;
 
-    ring->shm_size = round_up(data_zone_size + rounded_post_size, umq_buf_size_small());
+    /* every in-flight message may be a qbuf chain of tx_buf_size, size data zone so that tx_depth of them fit.
+     * the blocks per message are clamped to keep shm under INT32_MAX, down to one block per message as before */
+    uint64_t blk_total_size = umq_buf_size_small() + sizeof(umq_buf_t) * (1 + UMQ_EMPTY_HEADER_COEFFICIENT);
+    uint64_t blk_per_msg = (ring->tx_buf_size + umq_buf_size_small() - 1) / umq_buf_size_small();
+    uint64_t depth_blk_size = (uint64_t)ring->tx_depth * blk_total_size;
+    if (depth_blk_size != 0 && rounded_post_size < INT32_MAX) {
+        uint64_t data_zone_max = ((uint64_t)INT32_MAX - rounded_post_size) & ~((uint64_t)umq_buf_size_small() - 1);
+        uint64_t blk_per_msg_max = data_zone_max / depth_blk_size;
+        if (blk_per_msg > blk_per_msg_max) {
+            UMQ_VLOG_WARN("shm data zone is clamped to %lu blocks per message, tx_buf_size: %u, tx_depth: %u\n",
+                blk_per_msg_max, ring->tx_buf_size, ring->tx_depth);
+            blk_per_msg = blk_per_msg_max;
+        }
+    }
+    if (blk_per_msg == 0) {
+        blk_per_msg = 1;
+    }
+    uint64_t data_zone_size = ring->tx_depth * blk_per_msg * blk_total_size;
+
+    uint64_t shm_size = round_up(data_zone_size + rounded_post_size, umq_buf_size_small());
+    if (shm_size > INT32_MAX) {
+        UMQ_VLOG_ERR("shm size %lu exceeds limit, tx_buf_size: %u, tx_depth: %u\n", shm_size, ring->tx_buf_size,
+            ring->tx_depth);
+        return -UMQ_ERR_EINVAL;
+    }
+    ring->shm_size = (int)shm_size;
     ring->owner = owner;
 
     return UMQ_SUCCESS;
@@ -259,6 +286,9 @@ uint64_t umq_ipc_create_impl(uint64_t umqh, uint8_t *ipc_ctx, umq_create_option_
     }
 
     tp->queue_mode = (option->create_flag & UMQ_CREATE_FLAG_QUEUE_MODE) ? option->mode : UMQ_MODE_POLLING;
+    for (uint32_t i = 0; i < UMQ_IO_MAX; i++) {
+        msg_ring_waiter_init(&tp->waiter[i], &ctx->wait_cfg);
+    }
     if (umq_ipc_map_memory(&tp->local_ring) != 0) {
         UMQ_VLOG_ERR("ipc map memory failed\n");
         goto FREE_TP;
@@ -266,9 +296,9 @@ uint64_t umq_ipc_create_impl(uint64_t umqh, uint8_t *ipc_ctx, umq_create_option_
 
     msg_ring_option_t ipc_option = {
         .owner = true,
-        .tx_max_buf_size = sizeof(uint64_t) + sizeof(uint32_t),
+        .tx_max_buf_size = UMQ_SHM_QBUF_DESC_SLOT_SIZE,
         .tx_depth = tp->local_ring.tx_depth,
-        .rx_max_buf_size = sizeof(uint64_t) + sizeof(uint32_t),
+        .rx_max_buf_size = UMQ_SHM_QBUF_DESC_SLOT_SIZE,
         // rx ring is used to recycle buffers, so its count is equal to tx depth
         .rx_depth = tp->local_ring.tx_depth,
         .addr = tp->local_ring.addr,
@@ -296,6 +326,7 @@ uint64_t umq_ipc_create_impl(uint64_t umqh, uint8_t *ipc_ctx, umq_create_option_
             .id = tp->umq_id,
         },
         .msg_ring = tp->local_msg_ring,
+        .lock_free = global_pool_cfg.lock_free,
     };
 
     tp->qbuf_pool_handle = umq_shm_global_pool_init(&sm_qbuf_pool_cfg);
@@ -419,9 +450,9 @@ int32_t umq_ipc_bind_impl(uint64_t umqh_tp, uint8_t *bind_info, uint32_t bind_in
 
     msg_ring_option_t ipc_option = {
         .owner = false,
-        .tx_max_buf_size = sizeof(uint64_t) + sizeof(uint32_t),
+        .tx_max_buf_size = UMQ_SHM_QBUF_DESC_SLOT_SIZE,
         .tx_depth = ctx->remote_ring.tx_depth,
-        .rx_max_buf_size = sizeof(uint64_t) + sizeof(uint32_t),
+        .rx_max_buf_size = UMQ_SHM_QBUF_DESC_SLOT_SIZE,
         .rx_depth = ctx->remote_ring.tx_depth,
         .addr = ctx->remote_ring.addr,
     };
@@ -470,6 +501,7 @@ int32_t umq_ipc_unbind_impl(uint64_t umqh_tp)
         return -UMQ_ERR_ENODEV;
     }
 
+    umq_buf_free(tp->bind_ctx->rx_pending);
     msg_ring_destroy(tp->bind_ctx->remote_msg_ring);
     umq_ipc_unmap_memory(&tp->bind_ctx->remote_ring);
 
@@ -510,7 +542,7 @@ static ALWAYS_INLINE bool is_remote_addr(umq_ipc_info_t *tp, umq_buf_t *qbuf)
     return (addr_from <= addr) && (addr < addr_to);
 }
 
-static ALWAYS_INLINE int enqueue_data(uint64_t umqh_tp, uint64_t *offset, uint32_t num)
+static ALWAYS_INLINE int enqueue_data(uint64_t umqh_tp, umq_shm_qbuf_desc_t *desc, uint32_t num)
 {
     umq_ipc_info_t *tp = (umq_ipc_info_t *)(uintptr_t)umqh_tp;
     if (num > UMQ_POST_POLL_BATCH) {
@@ -519,11 +551,13 @@ static ALWAYS_INLINE int enqueue_data(uint64_t umqh_tp, uint64_t *offset, uint32
     }
 
     uint32_t sizes[num];
+    char *tx_buf[num];
     for (uint32_t i = 0; i < num; i++) {
-        sizes[i] = sizeof(uint64_t);
+        sizes[i] = sizeof(umq_shm_qbuf_desc_t);
+        tx_buf[i] = (char *)&desc[i];
     }
 
-    int ret = msg_ring_post_tx_batch(tp->local_msg_ring, (char **)&offset, sizes, num);
+    int ret = msg_ring_post_tx_batch(tp->local_msg_ring, tx_buf, sizes, num);
     if (ret != 0) {
         UMQ_LIMIT_VLOG_ERR("ipc post tx failed\n");
         return ret;
@@ -551,18 +585,18 @@ int umq_ipc_enqueue_impl(uint64_t umqh_tp, umq_buf_t *qbuf, umq_buf_t **bad_qbuf
     return ret;
 }
 
-static ALWAYS_INLINE int dequeue_data(uint64_t umq_tp, uint64_t *offset, uint32_t num)
+static ALWAYS_INLINE int dequeue_data(uint64_t umq_tp, umq_shm_qbuf_desc_t *desc, uint32_t num)
 {
-    uint64_t *rx_data_ptr[num];
+    umq_shm_qbuf_desc_t *rx_data_ptr[num];
     for (uint32_t i = 0; i < num; i++) {
-        rx_data_ptr[i] = &offset[i];
+        rx_data_ptr[i] = &desc[i];
     }
 
     umq_ipc_info_t *tp = (umq_ipc_info_t *)(uintptr_t)umq_tp;
-    // poll offset from shm, then transform to qbuf
+    // poll descriptor from shm, then transform to qbuf
     uint32_t polled_buf_size[num];
     int ret = msg_ring_poll_tx_batch(tp->bind_ctx->remote_msg_ring, (char **)&rx_data_ptr,
-        sizeof(uint64_t), polled_buf_size, num);
+        sizeof(umq_shm_qbuf_desc_t), polled_buf_size, num);
     if (ret < 0) {
         UMQ_LIMIT_VLOG_ERR("ipc poll rx failed\n");
         return -UMQ_ERR_EINVAL;
@@ -579,6 +613,13 @@ umq_buf_t *umq_ipc_dequeue_impl(uint64_t umqh_tp)
         return NULL;
     }
 
+    // messages left by umq_dequeue_burst come first
+    if (tp->bind_ctx->rx_pending != NULL) {
+        umq_buf_t *pending = tp->bind_ctx->rx_pending;
+        tp->bind_ctx->rx_pending = NULL;
+        return pending;
+    }
+
     // poll shm queue
     bool rendezvous = false;
     umq_buf_t *polled_buf = umq_shm_qbuf_dequeue(tp->umqh, umqh_tp, tp->bind_ctx->qbuf_pool_handle,
@@ -590,6 +631,30 @@ umq_buf_t *umq_ipc_dequeue_impl(uint64_t umqh_tp)
     return polled_buf;
 }
 
+int umq_ipc_dequeue_burst_impl(uint64_t umqh_tp, umq_buf_t **bufs, uint32_t max)
+{
+    umq_ipc_info_t *tp = (umq_ipc_info_t *)(uintptr_t)umqh_tp;
+    if (tp->bind_ctx == NULL) {
+        UMQ_LIMIT_VLOG_ERR("umq has not been binded\n");
+        return -UMQ_ERR_ENODEV;
+    }
+
+    uint32_t cnt = umq_shm_qbuf_cut_msgs(&tp->bind_ctx->rx_pending, NULL, 0, bufs, max);
+    if (cnt == max) {
+        return (int)cnt;
+    }
+
+    // one scan of shm ring for all descriptors ready, descriptors are not polled ahead of consumer
+    umq_buf_t *chains[max - cnt];
+    int chain_cnt = umq_shm_qbuf_dequeue_burst(tp->umqh, umqh_tp, tp->bind_ctx->qbuf_pool_handle, chains, NULL,
+        max - cnt, dequeue_data);
+    if (chain_cnt <= 0) {
+        return cnt > 0 ? (int)cnt : chain_cnt;
+    }
+    cnt += umq_shm_qbuf_cut_msgs(&tp->bind_ctx->rx_pending, chains, (uint32_t)chain_cnt, bufs + cnt, max - cnt);
+    return (int)cnt;
+}
+
 umq_buf_t *umq_ipc_buf_alloc_impl(uint32_t request_size, uint32_t request_qbuf_num, uint64_t umqh_tp,
     umq_alloc_option_t *option)
 {
@@ -651,11 +716,6 @@ int umq_tp_ipc_buf_headroom_reset_impl(umq_buf_t *qbuf, uint16_t headroom_size)
     return umq_shm_qbuf_headroom_reset(qbuf_pool_handle, qbuf, headroom_size);
 }
 
-static ALWAYS_INLINE int futex_wake(atomic_int *addr, int n)
-{
-    return syscall(SYS_futex, addr, FUTEX_WAKE, n, NULL, NULL, 0);
-}
-
 void umq_ipc_notify_impl(uint64_t umqh_tp)
 {
     umq_ipc_info_t *tp = (umq_ipc_info_t *)(uintptr_t)umqh_tp;
@@ -664,10 +724,8 @@ void umq_ipc_notify_impl(uint64_t umqh_tp)
         return;
     }
 
-    // notify peer that some events triggered
-    atomic_store(&tp->local_msg_ring->shm_tx_ring_hdr->cq_event_flag, 1);
-    atomic_fetch_add(&tp->local_msg_ring->shm_tx_ring_hdr->pending_events, 1);
-    futex_wake(&tp->local_msg_ring->shm_tx_ring_hdr->cq_event_flag, 1);
+    // notify peer that some events triggered, syscall is taken only if peer is sleeping
+    msg_ring_event_notify(tp->local_msg_ring->shm_tx_ring_hdr);
 }
 
 int umq_ipc_rearm_interrupt_impl(uint64_t umqh_tp, bool solicated, umq_interrupt_option_t *option)
@@ -686,31 +744,6 @@ int umq_ipc_rearm_interrupt_impl(uint64_t umqh_tp, bool solicated, umq_interrupt
     return UMQ_SUCCESS;
 }
 
-static ALWAYS_INLINE int futex_wait(atomic_int *addr, int val, int timeout)
-{
-    int ret = -1;
-    struct timespec ts;
-    struct timespec *ts_ptr = NULL;
-    if (timeout >= 0) {
-        ts.tv_sec = timeout / MS_PER_SEC;
-        ts.tv_nsec = (timeout % MS_PER_SEC) * NS_PER_MS;
-        ts_ptr = &ts;
-    } else if (timeout < -1) {
-        return ret;
-    }
-
-    do { // handle spurious wakeup
-        ret = syscall(SYS_futex, addr, FUTEX_WAIT, val, ts_ptr, NULL, 0);
-        if (ret == 0 || errno == EAGAIN || errno == EINTR) {
-            continue;
-        } else if (ret == -1) {
-            break;
-        }
-    } while (atomic_load(addr) == val);
-
-    return ret;
-}
-
 int32_t umq_ipc_wait_interrupt_impl(uint64_t wait_umqh_tp, int time_out, umq_interrupt_option_t *option)
 {
     if ((option->flag & UMQ_INTERRUPT_FLAG_IO_DIRECTION) == 0 || option->direction <= UMQ_IO_ALL ||
@@ -727,14 +760,7 @@ int32_t umq_ipc_wait_interrupt_impl(uint64_t wait_umqh_tp, int time_out, umq_int
     shm_ring_hdr_t *hdr = option->direction == UMQ_IO_TX ? tp->local_msg_ring->shm_tx_ring_hdr :
         tp->bind_ctx->remote_msg_ring->shm_tx_ring_hdr;
 
-    int ret = futex_wait(&hdr->cq_event_flag, 0, time_out);
-    if (ret == 0 || errno == EAGAIN) {
-        return atomic_load(&hdr->pending_events);
-    } else if (errno == ETIMEDOUT) {
-        return 0;
-    }
-
-    return ret;
+    return msg_ring_event_wait(hdr, &tp->waiter[option->direction], time_out);
 }
 
 void umq_ipc_ack_interrupt_impl(uint64_t umqh_tp, uint32_t nevents, umq_interrupt_option_t *option)
@@ -753,8 +779,5 @@ void umq_ipc_ack_interrupt_impl(uint64_t umqh_tp, uint32_t nevents, umq_interrup
     shm_ring_hdr_t *hdr = option->direction == UMQ_IO_TX ? tp->local_msg_ring->shm_tx_ring_hdr :
         tp->bind_ctx->remote_msg_ring->shm_tx_ring_hdr;
 
-    atomic_fetch_sub(&hdr->pending_events, nevents);
-    if (atomic_load(&hdr->pending_events) == 0) {
-        atomic_store(&hdr->cq_event_flag, 0);
-    }
+    msg_ring_event_ack(hdr, nevents);
 }
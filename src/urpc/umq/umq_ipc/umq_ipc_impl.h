@@ -45,6 +45,7 @@ int umq_ipc_poll_impl(uint64_t umqh_tp, umq_io_direction_t io_direction, umq_buf
 int umq_ipc_enqueue_impl(uint64_t umqh_tp, umq_buf_t *qbuf, umq_buf_t **bad_qbuf);
 
 umq_buf_t *umq_ipc_dequeue_impl(uint64_t umqh_tp);
+int umq_ipc_dequeue_burst_impl(uint64_t umqh_tp, umq_buf_t **bufs, uint32_t max);
 
 void umq_ipc_notify_impl(uint64_t umqh_tp);
 
@@ -0,0 +1,182 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: UMQ UB eager/rendezvous threshold
+ * Create: 2025-12-29
+ * Note:
+ * History: 2025-12-29
+ */
+
+#include <string.h>
+
+#include "umq_types.h"
+#include "umq_ub_eager_thresh.h"
+
+#define UB_EAGER_THRESH_PROBE_INTERVAL      32          // one of messages around threshold is sent on the other path
+#define UB_EAGER_THRESH_UPDATE_INTERVAL     16          // samples between two threshold updates
+#define UB_EAGER_THRESH_MIN_SAMPLE          4           // estimate with fewer samples is not trusted
+#define UB_EAGER_THRESH_HYSTERESIS          10          // in percent, the other path must be faster by this much
+#define UB_EAGER_THRESH_SAMPLE_TIMEOUT_NS   1000000000  // sample whose message never completes is dropped
+#define UB_EAGER_THRESH_MEAN_SHIFT          3           // weight of new sample in mean is 1/8
+#define UB_EAGER_THRESH_TAIL_SHIFT          4           // step of p99 estimate is 1/16 of estimate
+#define UB_EAGER_THRESH_TAIL_FP_SHIFT       6
+#define UB_EAGER_THRESH_TAIL_QUANTILE       99
+
+static inline uint64_t eager_thresh_cls_size(uint32_t cls)
+{
+    return cls == UMQ_EAGER_THRESH_CLASS_NUM - 1 ? UINT32_MAX : (1ULL << (cls + UMQ_EAGER_THRESH_CLASS_MIN_BITS));
+}
+
+void umq_ub_eager_thresh_init(ub_eager_thresh_t *et, const umq_eager_thresh_cfg_t *cfg)
+{
+    (void)memset(et, 0, sizeof(ub_eager_thresh_t));
+    et->mode = cfg->mode;
+    et->thresh = cfg->thresh == 0 ? UINT32_MAX : cfg->thresh;
+    et->thresh_cls = umq_ub_eager_thresh_cls(et->thresh);
+    et->max_eager_cls = UMQ_EAGER_THRESH_CLASS_NUM - 1;
+}
+
+bool umq_ub_eager_thresh_select_adaptive(ub_eager_thresh_t *et, uint32_t size, uint32_t max_eager_size)
+{
+    uint32_t cls = umq_ub_eager_thresh_cls(size);
+    bool eager_ok = size <= max_eager_size;
+    et->max_eager_cls = umq_ub_eager_thresh_cls(max_eager_size);
+    uint32_t thresh_cls = __atomic_load_n(&et->thresh_cls, __ATOMIC_RELAXED);
+    bool eager = eager_ok && cls <= thresh_cls;
+
+    // only the two classes beside threshold decide where it moves, keep estimates of both paths fresh there
+    if ((cls == thresh_cls || cls == thresh_cls + 1) && eager_ok &&
+        ++et->probe_tick % UB_EAGER_THRESH_PROBE_INTERVAL == 0) {
+        ub_msg_path_t other = eager ? UB_MSG_PATH_RNDV : UB_MSG_PATH_EAGER;
+        if (__atomic_load_n(&et->sample[other].state, __ATOMIC_RELAXED) == UB_EAGER_THRESH_SAMPLE_FREE) {
+            eager = !eager;
+            et->probe_cnt++;
+        }
+    }
+
+    et->cnt[eager ? UB_MSG_PATH_EAGER : UB_MSG_PATH_RNDV]++;
+    return eager;
+}
+
+void umq_ub_eager_thresh_sample_start(ub_eager_thresh_t *et, ub_msg_path_t path, uint64_t key, uint32_t size)
+{
+    if (et->mode == UMQ_EAGER_THRESH_FIXED) {
+        return;
+    }
+
+    ub_eager_thresh_sample_t *sample = &et->sample[path];
+    uint32_t state = __atomic_load_n(&sample->state, __ATOMIC_ACQUIRE);
+    if (state == UB_EAGER_THRESH_SAMPLE_BUSY) {
+        return;
+    }
+    uint64_t now = get_timestamp_ns();
+    if (state == UB_EAGER_THRESH_SAMPLE_PENDING && now - sample->start_ns < UB_EAGER_THRESH_SAMPLE_TIMEOUT_NS) {
+        return;
+    }
+    if (!__atomic_compare_exchange_n(&sample->state, &state, UB_EAGER_THRESH_SAMPLE_BUSY, false,
+        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    sample->key = key;
+    sample->start_ns = now;
+    sample->cls = umq_ub_eager_thresh_cls(size);
+    __atomic_store_n(&sample->state, UB_EAGER_THRESH_SAMPLE_PENDING, __ATOMIC_RELEASE);
+}
+
+static void eager_thresh_est_update(ub_eager_thresh_est_t *est, uint64_t lat_ns)
+{
+    uint64_t lat_fp = lat_ns << UB_EAGER_THRESH_TAIL_FP_SHIFT;
+    if (est->cnt++ == 0) {
+        est->mean_ns = lat_ns;
+        est->tail_fp = lat_fp;
+        return;
+    }
+
+    int64_t diff = (int64_t)lat_ns - (int64_t)est->mean_ns;
+    est->mean_ns = (uint64_t)((int64_t)est->mean_ns + diff / (1 << UB_EAGER_THRESH_MEAN_SHIFT));
+
+    /* stochastic quantile estimate: step up on samples above the estimate and 1/99 of the step down otherwise,
+     * which settles where 1% of samples are above */
+    uint64_t step = (est->tail_fp >> UB_EAGER_THRESH_TAIL_SHIFT) + 1;
+    if (lat_fp > est->tail_fp) {
+        est->tail_fp += step;
+    } else {
+        uint64_t down = step * (100 - UB_EAGER_THRESH_TAIL_QUANTILE) / UB_EAGER_THRESH_TAIL_QUANTILE;
+        est->tail_fp = est->tail_fp > down ? est->tail_fp - down : 0;
+    }
+}
+
+static uint64_t eager_thresh_est_get(const ub_eager_thresh_t *et, ub_msg_path_t path, uint32_t cls)
+{
+    const ub_eager_thresh_est_t *est = &et->est[path][cls];
+    if (est->cnt == 0) {
+        return 0;
+    }
+    return et->mode == UMQ_EAGER_THRESH_ADAPTIVE_TAIL ? est->tail_fp >> UB_EAGER_THRESH_TAIL_FP_SHIFT : est->mean_ns;
+}
+
+// true if path a is faster than path b in the class by more than hysteresis
+static bool eager_thresh_faster(const ub_eager_thresh_t *et, ub_msg_path_t a, ub_msg_path_t b, uint32_t cls)
+{
+    if (et->est[a][cls].cnt < UB_EAGER_THRESH_MIN_SAMPLE || et->est[b][cls].cnt < UB_EAGER_THRESH_MIN_SAMPLE) {
+        return false;
+    }
+    return eager_thresh_est_get(et, a, cls) * (100 + UB_EAGER_THRESH_HYSTERESIS) <
+        eager_thresh_est_get(et, b, cls) * 100;
+}
+
+// move threshold by at most one class, toward the class where the faster path changes
+static void eager_thresh_update(ub_eager_thresh_t *et)
+{
+    uint32_t thresh_cls = __atomic_load_n(&et->thresh_cls, __ATOMIC_RELAXED);
+    uint32_t new_cls = thresh_cls > et->max_eager_cls ? et->max_eager_cls : thresh_cls;
+    if (new_cls > 0 && eager_thresh_faster(et, UB_MSG_PATH_RNDV, UB_MSG_PATH_EAGER, new_cls)) {
+        new_cls--;
+        et->thresh_update_cnt++;
+    } else if (new_cls < et->max_eager_cls &&
+        eager_thresh_faster(et, UB_MSG_PATH_EAGER, UB_MSG_PATH_RNDV, new_cls + 1)) {
+        new_cls++;
+        et->thresh_update_cnt++;
+    }
+
+    if (new_cls != thresh_cls) {
+        __atomic_store_n(&et->thresh_cls, new_cls, __ATOMIC_RELAXED);
+    }
+}
+
+void umq_ub_eager_thresh_sample_finish(ub_eager_thresh_t *et, ub_msg_path_t path)
+{
+    ub_eager_thresh_sample_t *sample = &et->sample[path];
+    uint64_t now = get_timestamp_ns();
+    eager_thresh_est_update(&et->est[path][sample->cls], now - sample->start_ns);
+    __atomic_store_n(&sample->state, UB_EAGER_THRESH_SAMPLE_FREE, __ATOMIC_RELEASE);
+
+    if (++et->sample_cnt % UB_EAGER_THRESH_UPDATE_INTERVAL == 0) {
+        eager_thresh_update(et);
+    }
+}
+
+void umq_ub_eager_thresh_stats_query(ub_eager_thresh_t *et, uint32_t max_eager_size, umq_eager_thresh_stats_t *out)
+{
+    out->mode = et->mode;
+    uint64_t thresh = et->mode == UMQ_EAGER_THRESH_FIXED ? et->thresh :
+        eager_thresh_cls_size(__atomic_load_n(&et->thresh_cls, __ATOMIC_RELAXED));
+    out->thresh = thresh < max_eager_size ? (uint32_t)thresh : max_eager_size;
+    out->eager_cnt = et->cnt[UB_MSG_PATH_EAGER];
+    out->rndv_cnt = et->cnt[UB_MSG_PATH_RNDV];
+    out->probe_cnt = et->probe_cnt;
+    out->thresh_update_cnt = et->thresh_update_cnt;
+    for (uint32_t i = 0; i < UMQ_EAGER_THRESH_CLASS_NUM; i++) {
+        out->eager_lat_ns[i] = eager_thresh_est_get(et, UB_MSG_PATH_EAGER, i);
+        out->rndv_lat_ns[i] = eager_thresh_est_get(et, UB_MSG_PATH_RNDV, i);
+    }
+}
+
+void umq_ub_eager_thresh_stats_clear(ub_eager_thresh_t *et)
+{
+    et->cnt[UB_MSG_PATH_EAGER] = 0;
+    et->cnt[UB_MSG_PATH_RNDV] = 0;
+    et->probe_cnt = 0;
+    et->thresh_update_cnt = 0;
+}
@@ -0,0 +1,82 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: eager/rendezvous threshold header file for UMQ
+ * Create: 2025-12-29
+ * Note:
+ * History: 2025-12-29
+ */
+
+#ifndef UMQ_UB_EAGER_THRESH_H
+#define UMQ_UB_EAGER_THRESH_H
+
+#include "umq_ub_private.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UMQ_EAGER_THRESH_CLASS_MIN_BITS (10)    // class 0 holds messages up to 1KB
+
+typedef enum ub_eager_thresh_sample_state {
+    UB_EAGER_THRESH_SAMPLE_FREE,
+    UB_EAGER_THRESH_SAMPLE_BUSY,                // being filled by the post side
+    UB_EAGER_THRESH_SAMPLE_PENDING,             // waiting for the release of message buffers
+} ub_eager_thresh_sample_state_t;
+
+static inline uint32_t umq_ub_eager_thresh_cls(uint64_t size)
+{
+    if (size <= (1ULL << UMQ_EAGER_THRESH_CLASS_MIN_BITS)) {
+        return 0;
+    }
+
+    // ceil of log2(size)
+    uint32_t bits = (uint32_t)(64 - __builtin_clzll(size - 1));
+    uint32_t cls = bits - UMQ_EAGER_THRESH_CLASS_MIN_BITS;
+    return cls < UMQ_EAGER_THRESH_CLASS_NUM ? cls : UMQ_EAGER_THRESH_CLASS_NUM - 1;
+}
+
+void umq_ub_eager_thresh_init(ub_eager_thresh_t *et, const umq_eager_thresh_cfg_t *cfg);
+bool umq_ub_eager_thresh_select_adaptive(ub_eager_thresh_t *et, uint32_t size, uint32_t max_eager_size);
+
+/**
+ * Select the path of a message
+ * @param[in] et: eager threshold of queue
+ * @param[in] size: total data size of message
+ * @param[in] max_eager_size: rx buf size of remote, larger message can only be pulled by receiver
+ * Return true if message is sent in place, false if it is pulled by receiver
+ */
+static inline bool umq_ub_eager_thresh_select(ub_eager_thresh_t *et, uint32_t size, uint32_t max_eager_size)
+{
+    if (et->mode != UMQ_EAGER_THRESH_FIXED) {
+        return umq_ub_eager_thresh_select_adaptive(et, size, max_eager_size);
+    }
+
+    bool eager = size <= max_eager_size && size <= et->thresh;
+    et->cnt[eager ? UB_MSG_PATH_EAGER : UB_MSG_PATH_RNDV]++;
+    return eager;
+}
+
+// time a message posted on path if no message of the path is being timed, only in adaptive modes
+void umq_ub_eager_thresh_sample_start(ub_eager_thresh_t *et, ub_msg_path_t path, uint64_t key, uint32_t size);
+void umq_ub_eager_thresh_sample_finish(ub_eager_thresh_t *et, ub_msg_path_t path);
+
+// buffers of a message are released, key is the same as umq_ub_eager_thresh_sample_start
+static inline void umq_ub_eager_thresh_sample_done(ub_eager_thresh_t *et, ub_msg_path_t path, uint64_t key)
+{
+    ub_eager_thresh_sample_t *sample = &et->sample[path];
+    if (__atomic_load_n(&sample->state, __ATOMIC_ACQUIRE) != UB_EAGER_THRESH_SAMPLE_PENDING || sample->key != key) {
+        return;
+    }
+
+    umq_ub_eager_thresh_sample_finish(et, path);
+}
+
+void umq_ub_eager_thresh_stats_query(ub_eager_thresh_t *et, uint32_t max_eager_size, umq_eager_thresh_stats_t *out);
+void umq_ub_eager_thresh_stats_clear(ub_eager_thresh_t *et);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -93,6 +93,23 @@ static ALWAYS_INLINE uint16_t local_rx_posted_load_non_atomic(struct ub_flow_con
     return fc->local_rx_posted;
 }
 
+static ALWAYS_INLINE void flow_control_stats_query_credit(struct ub_flow_control *fc, umq_flow_control_stats_t *out)
+{
+    if (!fc->adaptive) {
+        out->notify_interval = fc->notify_interval;
+        out->total_local_rx_notify_standalone = 0;
+        out->total_local_rx_notify_starved = 0;
+        return;
+    }
+
+    // local rx posted is kept in credit pool shared by queues of jfr, report what can be granted to the peer
+    out->local_rx_posted = fc->credit.pool == NULL ? 0 : util_credit_avail(&fc->credit);
+    out->total_local_rx_notified = __atomic_load_n(&fc->credit.total_granted, __ATOMIC_RELAXED);
+    out->notify_interval = __atomic_load_n(&fc->credit.interval, __ATOMIC_RELAXED);
+    out->total_local_rx_notify_standalone = __atomic_load_n(&fc->credit.total_standalone, __ATOMIC_RELAXED);
+    out->total_local_rx_notify_starved = __atomic_load_n(&fc->credit.total_starved, __ATOMIC_RELAXED);
+}
+
 static ALWAYS_INLINE void flow_control_stats_query_non_atomic(struct ub_flow_control *fc, umq_flow_control_stats_t *out)
 {
     out->local_rx_posted = fc->local_rx_posted;
@@ -104,6 +121,7 @@ static ALWAYS_INLINE void flow_control_stats_query_non_atomic(struct ub_flow_con
     out->total_remote_rx_consumed = fc->total_remote_rx_consumed;
     out->total_remote_rx_received_error = fc->total_remote_rx_received_error;
     out->total_flow_controlled_wr = fc->total_flow_controlled_wr;
+    flow_control_stats_query_credit(fc, out);
 }
 
 static ALWAYS_INLINE uint16_t remote_rx_window_inc_atomic(struct ub_flow_control *fc, uint16_t new_win)
@@ -234,6 +252,7 @@ static ALWAYS_INLINE void flow_control_stats_query_atomic(struct ub_flow_control
     out->total_remote_rx_consumed = __atomic_load_n(&fc->total_remote_rx_consumed, __ATOMIC_RELAXED);
     out->total_remote_rx_received_error = __atomic_load_n(&fc->total_remote_rx_received_error, __ATOMIC_RELAXED);
     out->total_flow_controlled_wr = __atomic_load_n(&fc->total_flow_controlled_wr, __ATOMIC_RELAXED);
+    flow_control_stats_query_credit(fc, out);
 }
 
 int umq_ub_flow_control_init(ub_flow_control_t *fc, ub_queue_t *queue, uint32_t feature, umq_flow_control_cfg_t *cfg)
@@ -261,6 +280,8 @@ int umq_ub_flow_control_init(ub_flow_control_t *fc, ub_queue_t *queue, uint32_t
         fc->notify_interval = 1;
     }
 
+    fc->adaptive = cfg->adaptive;
+
     if (cfg->use_atomic_window) {
         fc->ops.remote_rx_window_inc = remote_rx_window_inc_atomic;
         fc->ops.remote_rx_window_dec = remote_rx_window_dec_atomic;
@@ -285,7 +306,8 @@ int umq_ub_flow_control_init(ub_flow_control_t *fc, ub_queue_t *queue, uint32_t
         fc->ops.stats_query = flow_control_stats_query_non_atomic;
     }
 
-    UMQ_VLOG_INFO("umq flow control init success, use %s window\n", cfg->use_atomic_window ? "atomic" : "non-atomic");
+    UMQ_VLOG_INFO("umq flow control init success, use %s window, %s notify interval\n",
+                  cfg->use_atomic_window ? "atomic" : "non-atomic", cfg->adaptive ? "adaptive" : "fixed");
 
     return UMQ_SUCCESS;
 }
@@ -296,10 +318,12 @@ void umq_ub_flow_control_uninit(ub_flow_control_t *fc)
         return;
     }
 
+    util_credit_leave(&fc->credit);
+
     UMQ_VLOG_INFO("umq flow control uninit success\n");
 }
 
-int umq_ub_window_init(ub_flow_control_t *fc, umq_ub_bind_info_t *info)
+int umq_ub_window_init(ub_flow_control_t *fc, ub_queue_t *queue, umq_ub_bind_info_t *info)
 {
     if (!fc->enabled) {
         return UMQ_SUCCESS;
@@ -316,9 +340,24 @@ int umq_ub_window_init(ub_flow_control_t *fc, umq_ub_bind_info_t *info)
     fc->remote_tx_depth = info->tx_depth;
     fc->remote_rx_window = 0; // remote window need to be updated after remote rx_posted
 
+    if (fc->adaptive) {
+        // the peer is one more sender of the jfr, credits of rx posted are shared with other queues of the jfr
+        util_credit_leave(&fc->credit);
+        util_credit_join(&fc->credit, &queue->jfr_ctx->credit_pool, fc->notify_interval);
+    }
+
     return UMQ_SUCCESS;
 }
 
+void umq_ub_window_uninit(ub_flow_control_t *fc)
+{
+    if (!fc->enabled || !fc->adaptive) {
+        return;
+    }
+
+    util_credit_leave(&fc->credit);
+}
+
 void umq_ub_window_read(ub_flow_control_t *fc, ub_queue_t *queue)
 {
     if (!fc->enabled || queue->bind_ctx == NULL) {
@@ -354,15 +393,106 @@ void umq_ub_rq_posted_notifier_inc(ub_flow_control_t *fc, uint16_t rx_posted)
         return;
     }
 
+    if (fc->adaptive) {
+        // window was granted but not delivered, return it to credit pool
+        if (fc->credit.pool != NULL) {
+            util_credit_revoke(&fc->credit, rx_posted);
+        }
+        return;
+    }
+
     (void)fc->ops.local_rx_posted_inc(fc, rx_posted);
 }
 
+static void flow_control_notify_send(ub_flow_control_t *fc, ub_queue_t *queue, uint16_t notify)
+{
+    umq_ub_imm_t imm = {
+        .flow_control = {
+            .umq_private = UMQ_UB_IMM_PRIVATE, .type = IMM_TYPE_FLOW_CONTROL, .in_user_buf = 0, .window = notify}
+        };
+    // user_ctx used as notify for recovery on tx error
+    urma_jfs_wr_t urma_wr = {.user_ctx = notify,
+        .send = {.imm_data = imm.value},
+        .flag = {.bs = {.complete_enable = 1, .inline_flag = 1}},
+        .tjetty = queue->bind_ctx->tjetty,
+        .opcode = URMA_OPC_SEND_IMM};
+    urma_jfs_wr_t *bad_wr = NULL;
+    urma_status_t status = urma_post_jetty_send_wr(queue->jetty, &urma_wr, &bad_wr);
+    if (status == URMA_SUCCESS) {
+        return;
+    }
+
+    UMQ_LIMIT_VLOG_ERR("flow control window send failed, status %d, local eid: " EID_FMT ", "
+                       "local jetty_id: %u, remote eid: " EID_FMT ", remote jetty_id: %u\n", (int)status,
+                       EID_ARGS(queue->jetty->jetty_id.eid), queue->jetty->jetty_id.id,
+                       EID_ARGS(queue->bind_ctx->tjetty->id.eid), queue->bind_ctx->tjetty->id.id);
+    umq_ub_window_inc(fc, 1);
+    umq_ub_rq_posted_notifier_inc(fc, notify);
+}
+
+static void flow_control_initial_window_set(ub_flow_control_t *fc, ub_queue_t *queue, uint16_t notify)
+{
+    uint16_t *remote_data = (uint16_t *)(uintptr_t)umq_ub_notify_buf_addr_get(queue, OFFSET_FLOW_CONTROL);
+    *remote_data = notify;
+    fc->local_set = true;
+
+    if (!fc->remote_get) {
+        umq_ub_window_read(fc, queue);
+    }
+}
+
+void umq_ub_credit_notify(ub_flow_control_t *fc, ub_queue_t *queue)
+{
+    if (queue->bind_ctx == NULL || fc->credit.pool == NULL) {
+        return;
+    }
+
+    uint32_t avail = util_credit_avail(&fc->credit);
+    if (avail == 0) {
+        return;
+    }
+
+    if (!fc->local_set) {
+        // initial window is limited by fair share when other queues share the jfr
+        uint32_t share = util_credit_share(&fc->credit);
+        uint32_t initial_window = fc->initial_window < share ? fc->initial_window : share;
+        if (avail < initial_window) {
+            return;
+        }
+
+        uint16_t notify = (uint16_t)util_credit_take(&fc->credit, initial_window);
+        if (notify != 0) {
+            flow_control_initial_window_set(fc, queue, notify);
+        }
+        return;
+    }
+
+    if (umq_ub_window_dec(fc, queue, 1) != 1) {
+        return;
+    }
+
+    uint32_t notify = util_credit_grant(&fc->credit, UTIL_CREDIT_GRANT_STANDALONE);
+    if (notify == 0) {
+        umq_ub_window_inc(fc, 1);
+        return;
+    }
+
+    flow_control_notify_send(fc, queue, (uint16_t)notify);
+}
+
 void umq_ub_rq_posted_notifier_update(ub_flow_control_t *fc, ub_queue_t *queue, uint16_t rx_posted)
 {
     if (rx_posted == 0 || !fc->enabled) {
         return;
     }
 
+    if (fc->adaptive) {
+        util_credit_post(&queue->jfr_ctx->credit_pool, rx_posted);
+        (void)__atomic_add_fetch(&fc->total_local_rx_posted, rx_posted, __ATOMIC_RELAXED);
+        umq_ub_credit_notify(fc, queue);
+        return;
+    }
+
     uint16_t notify = fc->ops.local_rx_posted_inc(fc, rx_posted);
     if (queue->bind_ctx == NULL) {
         return;
@@ -379,14 +509,7 @@ void umq_ub_rq_posted_notifier_update(ub_flow_control_t *fc, ub_queue_t *queue,
             return;
         }
 
-        uint16_t *remote_data = (uint16_t *)(uintptr_t)umq_ub_notify_buf_addr_get(queue, OFFSET_FLOW_CONTROL);
-        *remote_data = notify;
-        fc->local_set = true;
-
-        if (!fc->remote_get) {
-            umq_ub_window_read(fc, queue);
-        }
-
+        flow_control_initial_window_set(fc, queue, notify);
         return;
     }
 
@@ -404,28 +527,7 @@ void umq_ub_rq_posted_notifier_update(ub_flow_control_t *fc, ub_queue_t *queue,
         return;
     }
 
-    umq_ub_imm_t imm = {
-        .flow_control = {
-            .umq_private = UMQ_UB_IMM_PRIVATE, .type = IMM_TYPE_FLOW_CONTROL, .in_user_buf = 0, .window = notify}
-        };
-    // user_ctx used as notify for recovery on tx error
-    urma_jfs_wr_t urma_wr = {.user_ctx = notify,
-        .send = {.imm_data = imm.value},
-        .flag = {.bs = {.complete_enable = 1, .inline_flag = 1}},
-        .tjetty = queue->bind_ctx->tjetty,
-        .opcode = URMA_OPC_SEND_IMM};
-    urma_jfs_wr_t *bad_wr = NULL;
-    urma_status_t status = urma_post_jetty_send_wr(queue->jetty, &urma_wr, &bad_wr);
-    if (status == URMA_SUCCESS) {
-        return;
-    }
-
-    UMQ_LIMIT_VLOG_ERR("flow control window send failed, status %d, local eid: " EID_FMT ", "
-                       "local jetty_id: %u, remote eid: " EID_FMT ", remote jetty_id: %u\n", (int)status,
-                       EID_ARGS(queue->jetty->jetty_id.eid), queue->jetty->jetty_id.id,
-                       EID_ARGS(queue->bind_ctx->tjetty->id.eid), queue->bind_ctx->tjetty->id.id);
-    umq_ub_window_inc(fc, 1);
-    umq_ub_rq_posted_notifier_inc(fc, notify);
+    flow_control_notify_send(fc, queue, notify);
 }
 
 void umq_ub_fill_tx_imm(ub_flow_control_t *fc, urma_jfs_wr_t *urma_wr, umq_buf_pro_t *buf_pro)
@@ -435,12 +537,20 @@ void umq_ub_fill_tx_imm(ub_flow_control_t *fc, urma_jfs_wr_t *urma_wr, umq_buf_p
         return;
     }
 
-    uint16_t notify = fc->ops.local_rx_posted_load(fc);
-    if (notify < fc->notify_interval) {
-        return;
+    uint16_t notify;
+    if (fc->adaptive) {
+        // the send goes to the peer anyway, whatever can be granted rides on it
+        if (!fc->local_set || fc->credit.pool == NULL) {
+            return;
+        }
+        notify = (uint16_t)util_credit_grant(&fc->credit, UTIL_CREDIT_GRANT_PIGGYBACK);
+    } else {
+        notify = fc->ops.local_rx_posted_load(fc);
+        if (notify < fc->notify_interval) {
+            return;
+        }
+        notify = fc->ops.local_rx_posted_exchange(fc);
     }
-
-    notify = fc->ops.local_rx_posted_exchange(fc);
     if (notify == 0) {
         return;
     }
@@ -477,7 +587,11 @@ void umq_ub_recover_tx_imm(ub_queue_t *queue, urma_jfs_wr_t *urma_wr, uint16_t w
                 continue;
             }
 
-            umq_ub_rq_posted_notifier_update(&queue->flow_control, queue, imm.flow_control.window);
+            if (queue->flow_control.adaptive) {
+                umq_ub_rq_posted_notifier_inc(&queue->flow_control, imm.flow_control.window);
+            } else {
+                umq_ub_rq_posted_notifier_update(&queue->flow_control, queue, imm.flow_control.window);
+            }
             buf_pro = (umq_buf_pro_t *)(((umq_buf_t *)(uintptr_t)urma_wr[i].user_ctx)->qbuf_ext);
             buf_pro->opcode = UMQ_OPC_SEND;
             buf_pro->imm_data = 0;
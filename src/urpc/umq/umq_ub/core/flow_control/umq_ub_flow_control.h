@@ -19,9 +19,12 @@ extern "C" {
 
 int umq_ub_flow_control_init(ub_flow_control_t *fc, ub_queue_t *queue, uint32_t feature, umq_flow_control_cfg_t *cfg);
 void umq_ub_flow_control_uninit(ub_flow_control_t *fc);
-int umq_ub_window_init(ub_flow_control_t *fc, umq_ub_bind_info_t *info);
+int umq_ub_window_init(ub_flow_control_t *fc, ub_queue_t *queue, umq_ub_bind_info_t *info);
+void umq_ub_window_uninit(ub_flow_control_t *fc);
 void umq_ub_window_read(ub_flow_control_t *fc, ub_queue_t *queue);
 void umq_ub_rq_posted_notifier_update(ub_flow_control_t *fc, ub_queue_t *queue, uint16_t rx_posted);
+// adaptive mode, send a standalone window notification if it is due
+void umq_ub_credit_notify(ub_flow_control_t *fc, ub_queue_t *queue);
 void umq_ub_fill_tx_imm(ub_flow_control_t *fc, urma_jfs_wr_t *urma_wr, umq_buf_pro_t *buf_pro);
 void umq_ub_recover_tx_imm(ub_queue_t *queue, urma_jfs_wr_t *urma_wr, uint16_t wr_index, umq_buf_t *bad);
 
@@ -50,6 +53,18 @@ static inline uint16_t umq_ub_window_dec(ub_flow_control_t *fc, ub_queue_t *queu
 
 void umq_ub_rq_posted_notifier_inc(ub_flow_control_t *fc, uint16_t rx_posted);
 
+// adaptive mode, one message sent by the peer of jetty is received on jfr of queue
+static inline void umq_ub_credit_consume(ub_queue_t *queue, uint32_t jetty_id)
+{
+    ub_flow_control_t *fc = jetty_id == queue->jetty->jetty_id.id ? &queue->flow_control :
+        queue->dev_ctx->fc_jetty_table[jetty_id];
+    if (fc == NULL || fc->credit.pool == NULL) {
+        return;
+    }
+
+    util_credit_consume(&fc->credit, 1);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -468,6 +468,79 @@ PUT_ALL_RX_CTX:
     return UMQ_FAIL;
 }
 
+int umq_ub_post_rx_bulk_inner_impl(ub_queue_t *queue, umq_buf_t **bufs, uint32_t num, uint32_t *posted_cnt)
+{
+    uint32_t max_sge_num = queue->max_rx_sge;
+    urma_jfr_wr_t recv_wr[UMQ_POST_POLL_BATCH] = {0};
+    urma_sge_t sges[UMQ_POST_POLL_BATCH][max_sge_num];
+    urma_target_seg_t **tseg_list = queue->dev_ctx->tseg_list;
+    urma_jfr_wr_t *bad_wr = NULL;
+    uint32_t wr_index = 0;
+    int ret = UMQ_SUCCESS;
+
+    *posted_cnt = 0;
+    if (num > UMQ_POST_POLL_BATCH) {
+        UMQ_LIMIT_VLOG_ERR("wr count exceeds %d, not supported\n", UMQ_POST_POLL_BATCH);
+        return -UMQ_ERR_EINVAL;
+    }
+
+    // each element of bufs is the qbuf chain of one wr, ended with NULL already
+    for (; wr_index < num; wr_index++) {
+        uint32_t sge_num = 0;
+        for (umq_buf_t *buffer = bufs[wr_index]; buffer != NULL; buffer = QBUF_LIST_NEXT(buffer)) {
+            if (sge_num >= max_sge_num) {
+                UMQ_LIMIT_VLOG_ERR("sge num exceed max sge num[%u]\n", max_sge_num);
+                ret = UMQ_FAIL;
+                goto POST_WR;
+            }
+            sges[wr_index][sge_num].addr = (uint64_t)(uintptr_t)buffer->buf_data;
+            sges[wr_index][sge_num].len = buffer->data_size;
+            sges[wr_index][sge_num].user_tseg = NULL;
+            sges[wr_index][sge_num].tseg = tseg_list[buffer->mempool_id];
+            sge_num++;
+        }
+
+        rx_buf_ctx_t *rx_buf_ctx = queue_rx_buf_ctx_get(&queue->jfr_ctx->rx_buf_ctx_list);
+        if (rx_buf_ctx == NULL) {
+            UMQ_LIMIT_VLOG_ERR("rx buf ctx is used up\n");
+            ret = UMQ_FAIL;
+            goto POST_WR;
+        }
+        rx_buf_ctx->buffer = bufs[wr_index];
+        recv_wr[wr_index].src.sge = sges[wr_index];
+        recv_wr[wr_index].src.num_sge = sge_num;
+        recv_wr[wr_index].user_ctx = (uint64_t)(uintptr_t)rx_buf_ctx;
+        recv_wr[wr_index].next = &recv_wr[wr_index + 1];
+    }
+
+POST_WR:
+    // post wrs built before failure, if any
+    if (wr_index == 0) {
+        return ret;
+    }
+
+    recv_wr[wr_index - 1].next = NULL;
+    uint32_t post_num = wr_index;
+    uint64_t start_timestamp = umq_perf_get_start_timestamp_with_feature(queue->dev_ctx->feature);
+    if (urma_post_jetty_recv_wr(queue->jetty, recv_wr, &bad_wr) != URMA_SUCCESS) {
+        umq_perf_record_write(UMQ_PERF_RECORD_TRANSPORT_POST_RECV, start_timestamp);
+        UMQ_LIMIT_VLOG_ERR("urma_post_jetty_recv_wr failed, eid: " EID_FMT ", jetty_id: %u\n",
+                           EID_ARGS(queue->jetty->jetty_id.eid), queue->jetty->jetty_id.id);
+        // wrs before bad_wr are posted, rx buf ctx of the others are put back
+        post_num = bad_wr == NULL ? 0 : (uint32_t)(bad_wr - recv_wr);
+        for (uint32_t i = post_num; i < wr_index; i++) {
+            queue_rx_buf_ctx_put(&queue->jfr_ctx->rx_buf_ctx_list, (rx_buf_ctx_t *)(uintptr_t)recv_wr[i].user_ctx);
+        }
+        ret = -UMQ_ERR_EAGAIN;
+    } else {
+        umq_perf_record_write_with_feature(UMQ_PERF_RECORD_TRANSPORT_POST_RECV, start_timestamp,
+            queue->dev_ctx->feature);
+    }
+    umq_ub_rq_posted_notifier_update(&queue->flow_control, queue, (uint16_t)post_num);
+    *posted_cnt = post_num;
+    return ret;
+}
+
 int umq_ub_post_rx(uint64_t umqh, umq_buf_t *qbuf, umq_buf_t **bad_qbuf)
 {
     ub_queue_t *queue = (ub_queue_t *)(uintptr_t)umqh;
@@ -658,6 +731,9 @@ int umq_ub_poll_rx(uint64_t umqh, umq_buf_t **buf, uint32_t buf_count)
             UMQ_LIMIT_VLOG_ERR("UB RX reports cr[%d] status[%d], remote eid " EID_FMT ", remote jetty_id %u\n", i,
                                cr[i].status, EID_ARGS(cr[i].remote_id.eid), cr[i].remote_id.id);
         } else {
+            if (queue->flow_control.adaptive) {
+                umq_ub_credit_consume(queue, cr[i].local_id);
+            }
             umq_buf_t *tmp_buf = buf[qbuf_cnt];
             uint32_t total_data_size = cr[i].completion_len;
             tmp_buf->total_data_size = total_data_size;
@@ -670,6 +746,11 @@ int umq_ub_poll_rx(uint64_t umqh, umq_buf_t **buf, uint32_t buf_count)
         ++qbuf_cnt;
     }
 
+    // credits consumed may make a standalone notification due, the peer can not send until it gets one
+    if (queue->flow_control.adaptive && rx_cr_cnt > 0) {
+        umq_ub_credit_notify(&queue->flow_control, queue);
+    }
+
     umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
     return qbuf_cnt;
 }
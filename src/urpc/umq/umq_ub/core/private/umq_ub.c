@@ -10,6 +10,8 @@
 #include "perf.h"
 #include "umq_qbuf_pool.h"
 #include "umq_ub_flow_control.h"
+#include "umq_ub_eager_thresh.h"
+#include "umq_ub_rx_pool.h"
 #include "qbuf_list.h"
 #include "umq_ub_api.h"
 
@@ -292,7 +294,7 @@ int umq_ub_bind_inner_impl(ub_queue_t *queue, umq_ub_bind_info_t *info)
     }
     // if mode is UB, post rx here. if mode is UB PRO, no need to post rx
     if ((queue->dev_ctx->feature & UMQ_FEATURE_API_PRO) == 0) {
-        int ret = umq_ub_prefill_rx_buf(queue);
+        int ret = queue->jfr_ctx->rx_pool != NULL ? umq_ub_rx_pool_bind(queue) : umq_ub_prefill_rx_buf(queue);
         if (ret != UMQ_SUCCESS) {
             goto UNIMPORT_JETTY;
         }
@@ -672,6 +674,33 @@ int check_and_set_param(umq_ub_ctx_t *dev_ctx, umq_create_option_t *option, ub_q
         queue->tx_depth = dev_ctx->dev_attr.dev_cap.max_jfc_depth < UMQ_DEFAULT_DEPTH ?
                           dev_ctx->dev_attr.dev_cap.max_jfc_depth : UMQ_DEFAULT_DEPTH;
     }
+    if (option->create_flag & UMQ_CREATE_FLAG_READ_PIPELINE) {
+        if (option->read_pipeline.window == 0 || option->read_pipeline.window > queue->tx_depth) {
+            UMQ_VLOG_ERR("read pipeline window [%u] is invalid, tx depth [%u]\n", option->read_pipeline.window,
+                         queue->tx_depth);
+            return -UMQ_ERR_EINVAL;
+        }
+        queue->read_pipeline = option->read_pipeline;
+    }
+    umq_eager_thresh_cfg_t eager_thresh = {.mode = UMQ_EAGER_THRESH_FIXED, .thresh = 0};
+    if (option->create_flag & UMQ_CREATE_FLAG_EAGER_THRESH) {
+        if (option->eager_thresh.mode < 0 || option->eager_thresh.mode >= UMQ_EAGER_THRESH_MODE_MAX) {
+            UMQ_VLOG_ERR("eager thresh mode[%d] is invalid\n", option->eager_thresh.mode);
+            return -UMQ_ERR_EINVAL;
+        }
+        eager_thresh = option->eager_thresh;
+    }
+    umq_ub_eager_thresh_init(&queue->eager_thresh, &eager_thresh);
+    if ((option->create_flag & UMQ_CREATE_FLAG_RX_POOL) != 0) {
+        if ((dev_ctx->feature & UMQ_FEATURE_API_PRO) != 0) {
+            UMQ_VLOG_ERR("rx pool is not supported with feature api pro\n");
+            return -UMQ_ERR_EINVAL;
+        }
+        if ((option->create_flag & UMQ_CREATE_FLAG_SHARE_RQ) != 0) {
+            UMQ_VLOG_ERR("rx pool can only be set on the queue owning the rq\n");
+            return -UMQ_ERR_EINVAL;
+        }
+    }
     if (option->create_flag & UMQ_CREATE_FLAG_QUEUE_MODE) {
         if (option->mode < 0 || option->mode >= UMQ_MODE_MAX) {
             UMQ_VLOG_ERR("queue mode[%d] is invalid\n", option->mode);
@@ -754,6 +783,7 @@ void umq_ub_jfr_ctx_destroy(ub_queue_t *queue)
         }
     }
     rx_buf_ctx_list_uninit(&queue->jfr_ctx->rx_buf_ctx_list);
+    umq_ub_rx_pool_destroy(queue->jfr_ctx);
     free(queue->jfr_ctx);
     queue->jfr_ctx = NULL;
 }
@@ -815,11 +845,19 @@ int umq_ub_jfr_ctx_create(ub_queue_t *queue, umq_ub_ctx_t *dev_ctx, umq_create_o
         UMQ_VLOG_ERR("rx buf ctx list init failed\n");
         goto DELETE_JFR;
     }
+    if ((option->create_flag & UMQ_CREATE_FLAG_RX_POOL) != 0 &&
+        umq_ub_rx_pool_create(queue->jfr_ctx, queue, &option->rx_pool) != UMQ_SUCCESS) {
+        goto UNINIT_RX_BUF_CTX_LIST;
+    }
+    util_credit_pool_init(&queue->jfr_ctx->credit_pool, queue->rx_depth);
     queue->jfr_ctx->ref_cnt = 1;
     UMQ_VLOG_INFO("create jfr_ctx success, eid: " EID_FMT ", jfr_id: %u\n",
                   EID_ARGS(queue->jfr_ctx->jfr->jfr_id.eid), queue->jfr_ctx->jfr->jfr_id.id);
     return UMQ_SUCCESS;
 
+UNINIT_RX_BUF_CTX_LIST:
+    rx_buf_ctx_list_uninit(&queue->jfr_ctx->rx_buf_ctx_list);
+
 DELETE_JFR:
     (void)urma_delete_jfr(queue->jfr_ctx->jfr);
 
@@ -1110,7 +1148,7 @@ static ALWAYS_INLINE uint32_t umq_ub_get_read_pre_allocate_max_total_size(
     return UINT32_MAX;
 }
 
-umq_buf_t *umq_ub_read_ctx_create(ub_queue_t *queue, umq_imm_head_t *umq_imm_head, uint16_t buf_num, uint16_t msg_id)
+static umq_buf_t *umq_ub_read_ctx_buf_alloc(uint16_t buf_num, uint16_t msg_id)
 {
     umq_buf_t *ctx_buf = umq_buf_alloc(sizeof(user_ctx_t), 1, UMQ_INVALID_HANDLE, NULL);
     if (ctx_buf == NULL) {
@@ -1123,24 +1161,64 @@ umq_buf_t *umq_ub_read_ctx_create(ub_queue_t *queue, umq_imm_head_t *umq_imm_hea
                                          .sub_type = IMM_TYPE_REVERSE_PULL_MEM_DONE}};
     buf_pro->imm_data = imm_temp.value;
     user_ctx_t *user_ctx = (user_ctx_t *)ctx_buf->buf_data;
+    user_ctx->dst_buf = NULL;
+    user_ctx->pipe = NULL;
+    user_ctx->wr_total = buf_num;
+    user_ctx->msg_id = msg_id;
+    user_ctx->wr_cnt = 0;
+    return ctx_buf;
+}
 
+umq_buf_t *umq_ub_read_ctx_create(ub_queue_t *queue, umq_imm_head_t *umq_imm_head, uint16_t buf_num, uint16_t msg_id)
+{
     uint32_t total_size = umq_ub_get_read_pre_allocate_max_total_size(umq_imm_head->mem_interval, buf_num);
     if (total_size == UINT32_MAX) {
-        umq_buf_free(ctx_buf);
         UMQ_LIMIT_VLOG_ERR("get total data size failed\n");
         return NULL;
     }
 
+    umq_buf_t *ctx_buf = umq_ub_read_ctx_buf_alloc(buf_num, msg_id);
+    if (ctx_buf == NULL) {
+        return NULL;
+    }
+
+    user_ctx_t *user_ctx = (user_ctx_t *)ctx_buf->buf_data;
     user_ctx->dst_buf = umq_buf_alloc(total_size, 1, UMQ_INVALID_HANDLE, NULL);
     if (user_ctx->dst_buf == NULL) {
         umq_buf_free(ctx_buf);
         UMQ_LIMIT_VLOG_ERR("dst_buf malloc failed\n");
         return NULL;
     }
+    return ctx_buf;
+}
 
-    user_ctx->wr_total = buf_num;
-    user_ctx->msg_id = msg_id;
-    user_ctx->wr_cnt = 0;
+static umq_buf_t *umq_ub_read_pipe_create(
+    umq_imm_head_t *umq_imm_head, ub_ref_sge_t *ref_sge, uint16_t buf_num, uint16_t msg_id)
+{
+    // dst buf of a chunk is one block of the size interval, same as a buf of the whole message allocated at once
+    uint32_t chunk_size = umq_ub_get_read_pre_allocate_max_total_size(umq_imm_head->mem_interval, 1);
+    if (chunk_size == UINT32_MAX) {
+        UMQ_LIMIT_VLOG_ERR("get chunk data size failed\n");
+        return NULL;
+    }
+
+    umq_ub_read_pipe_t *pipe = (umq_ub_read_pipe_t *)calloc(1,
+        sizeof(umq_ub_read_pipe_t) + buf_num * (sizeof(ub_ref_sge_t) + sizeof(umq_buf_t *)));
+    if (pipe == NULL) {
+        UMQ_LIMIT_VLOG_ERR("read pipe malloc failed\n");
+        return NULL;
+    }
+    (void)memcpy(pipe->ref_sge, ref_sge, buf_num * sizeof(ub_ref_sge_t));
+    pipe->chunk = (umq_buf_t **)(uintptr_t)(pipe->ref_sge + buf_num);
+    pipe->chunk_size = chunk_size;
+    pipe->buf_num = buf_num;
+
+    umq_buf_t *ctx_buf = umq_ub_read_ctx_buf_alloc(buf_num, msg_id);
+    if (ctx_buf == NULL) {
+        free(pipe);
+        return NULL;
+    }
+    ((user_ctx_t *)ctx_buf->buf_data)->pipe = pipe;
     return ctx_buf;
 }
 
@@ -1246,9 +1324,87 @@ static inline void umq_ub_read_ctx_destroy(umq_buf_t *ctx_buf)
     if (user_ctx->dst_buf != NULL) {
         umq_buf_free(user_ctx->dst_buf);
     }
+    free(user_ctx->pipe);
     umq_buf_free(ctx_buf);
 }
 
+static inline void umq_ub_read_post_err_log(ub_queue_t *queue, urma_status_t status)
+{
+    UMQ_LIMIT_VLOG_ERR("urma_post_jetty_send_wr failed, status %d, local eid: " EID_FMT ", "
+                       "local jetty_id: %u, remote eid: " EID_FMT ", remote jetty_id: %u\n", (int)status,
+                       EID_ARGS(queue->jetty->jetty_id.eid), queue->jetty->jetty_id.id,
+                       EID_ARGS(queue->bind_ctx->tjetty->id.eid), queue->bind_ctx->tjetty->id.id);
+}
+
+// keep window reads in flight, dst buf of each chunk is allocated just before its read is posted
+static void umq_ub_read_pipe_post(ub_queue_t *queue, umq_buf_t *ctx_buf)
+{
+    umq_ub_read_pipe_t *pipe = ((user_ctx_t *)ctx_buf->buf_data)->pipe;
+    while (!pipe->failed && pipe->posted < pipe->buf_num &&
+        (uint32_t)(pipe->posted - pipe->landed) < queue->read_pipeline.window) {
+        ub_ref_sge_t *ref_sge = &pipe->ref_sge[pipe->posted];
+        urma_sge_t src_sge = {
+            .addr = ref_sge->addr,
+            .len = ref_sge->length,
+            .tseg = queue->imported_tseg_list[ref_sge->mempool_id],
+        };
+        if (src_sge.tseg == NULL || ref_sge->length > pipe->chunk_size) {
+            UMQ_LIMIT_VLOG_ERR("imported memory handle not exist or chunk size %u invalid\n", ref_sge->length);
+            pipe->failed = true;
+            return;
+        }
+
+        umq_buf_t *chunk = umq_buf_alloc(pipe->chunk_size, 1, UMQ_INVALID_HANDLE, NULL);
+        if (chunk == NULL) {
+            UMQ_LIMIT_VLOG_ERR("chunk buf malloc failed\n");
+            pipe->failed = true;
+            return;
+        }
+        chunk->data_size = ref_sge->length;
+        chunk->total_data_size = ref_sge->length;
+        urma_sge_t dst_sge = {
+            .addr = (uint64_t)(uintptr_t)chunk->buf_data,
+            .len = ref_sge->length,
+            .tseg = queue->dev_ctx->tseg_list[chunk->mempool_id],
+        };
+
+        urma_status_t status = umq_ub_read_post_send(queue, &src_sge, &dst_sge, ctx_buf);
+        if (status != URMA_SUCCESS) {
+            umq_ub_read_post_err_log(queue, status);
+            umq_buf_free(chunk);
+            pipe->failed = true;
+            return;
+        }
+        pipe->chunk[pipe->posted++] = chunk;
+        pipe->total_data_size += ref_sge->length;
+        umq_inc_ref(queue->dev_ctx->io_lock_free, &queue->tx_outstanding, 1);
+    }
+}
+
+static int umq_ub_read_pipeline(ub_queue_t *queue, umq_buf_t *rx_buf, umq_ub_imm_t imm)
+{
+    umq_imm_head_t *umq_imm_head = (umq_imm_head_t *)(uintptr_t)rx_buf->buf_data;
+    ub_ref_sge_t *ref_sge = (ub_ref_sge_t *)(uintptr_t)(umq_imm_head + 1);
+    if (imm.ub_plus.msg_num == 0) {
+        UMQ_LIMIT_VLOG_ERR("rendezvous message without buffer\n");
+        return -UMQ_ERR_EINVAL;
+    }
+
+    // ref sge is copied, rx_buf is released once reads of the first window are posted
+    umq_buf_t *ctx_buf = umq_ub_read_pipe_create(umq_imm_head, ref_sge, imm.ub_plus.msg_num, imm.ub_plus.msg_id);
+    if (ctx_buf == NULL) {
+        UMQ_LIMIT_VLOG_ERR("create read pipe failed\n");
+        return -UMQ_ERR_ENOMEM;
+    }
+
+    umq_ub_read_pipe_post(queue, ctx_buf);
+    if (((user_ctx_t *)ctx_buf->buf_data)->pipe->posted == 0) {
+        umq_ub_read_ctx_destroy(ctx_buf);
+        return UMQ_FAIL;
+    }
+    return UMQ_SUCCESS;
+}
+
 int umq_ub_read(uint64_t umqh_tp, umq_buf_t *rx_buf, umq_ub_imm_t imm)
 {
     ub_queue_t *queue = (ub_queue_t *)(uintptr_t)umqh_tp;
@@ -1256,6 +1412,9 @@ int umq_ub_read(uint64_t umqh_tp, umq_buf_t *rx_buf, umq_ub_imm_t imm)
         UMQ_LIMIT_VLOG_ERR("umq has not been binded\n");
         return -UMQ_ERR_ENODEV;
     }
+    if (queue->read_pipeline.window != 0) {
+        return umq_ub_read_pipeline(queue, rx_buf, imm);
+    }
 
     uint16_t buf_num = imm.ub_plus.msg_num;
     uint16_t msg_id = imm.ub_plus.msg_id;
@@ -1298,10 +1457,7 @@ int umq_ub_read(uint64_t umqh_tp, umq_buf_t *rx_buf, umq_ub_imm_t imm)
         urma_status_t status = umq_ub_read_post_send(queue, src_sge + i, dst_sge + i, ctx_buf);
         if (status != URMA_SUCCESS) {
             umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
-            UMQ_LIMIT_VLOG_ERR("urma_post_jetty_send_wr failed, status %d, local eid: " EID_FMT ", "
-                               "local jetty_id: %u, remote eid: " EID_FMT ", remote jetty_id: %u\n", (int)status,
-                               EID_ARGS(queue->jetty->jetty_id.eid), queue->jetty->jetty_id.id,
-                               EID_ARGS(queue->bind_ctx->tjetty->id.eid), queue->bind_ctx->tjetty->id.id);
+            umq_ub_read_post_err_log(queue, status);
             if (i == 0) {
                 goto FREE_CTX_BUF;
             } else {
@@ -1352,6 +1508,7 @@ static int process_send_imm(umq_buf_t *rx_buf, umq_ub_imm_t imm, uint64_t umqh)
              * and the address of the first qbuf is placed in the user_ctx of the 128th wr, then released
              */
             (void)umq_buf_break_and_free(buffer);
+            umq_ub_eager_thresh_sample_done(&queue->eager_thresh, UB_MSG_PATH_RNDV, msg_id);
             util_id_allocator_release(&g_umq_ub_id_allocator, msg_id);
         }
         umq_buf_free(rx_buf); // release rx
@@ -1403,42 +1560,106 @@ static int umq_ub_read_done(ub_queue_t *queue, uint16_t msg_id)
     return umq_ub_send_imm(queue, imm.value, &sge, 0);
 }
 
+// a chunk of pipeline read landed, return the chunk or the whole message to report, NULL if nothing to report
+static umq_buf_t *umq_ub_read_pipe_wr_done(ub_queue_t *queue, umq_buf_t *ctx_buf)
+{
+    user_ctx_t *user_ctx = (user_ctx_t *)ctx_buf->buf_data;
+    umq_ub_read_pipe_t *pipe = user_ctx->pipe;
+    umq_buf_t *chunk = pipe->chunk[pipe->landed++];
+    umq_buf_t *report = NULL;
+    if (queue->read_pipeline.partial_deliver) {
+        chunk->io_direction = UMQ_IO_RX;
+        report = chunk;
+    } else if (pipe->head == NULL) {
+        pipe->head = chunk;
+        pipe->tail = chunk;
+    } else {
+        pipe->tail->qbuf_next = chunk;
+        pipe->tail = chunk;
+    }
+
+    // the window slides as soon as a chunk lands
+    umq_ub_read_pipe_post(queue, ctx_buf);
+    bool finished = pipe->landed == pipe->posted && (pipe->failed || pipe->posted == pipe->buf_num);
+    if (report != NULL) {
+        report->status = !finished ? UMQ_BUF_READ_PARTIAL : (pipe->failed ? UMQ_BUF_LOC_OPERATION_ERR : UMQ_BUF_SUCCESS);
+    }
+    if (!finished) {
+        return report;
+    }
+
+    // buffers of sender are released even if part of message is given up, since no read is in flight
+    if (umq_ub_read_done(queue, user_ctx->msg_id) != UMQ_SUCCESS) {
+        UMQ_LIMIT_VLOG_ERR("umq ub send imm failed\n");
+    }
+    if (pipe->head != NULL) {
+        if (pipe->failed) {
+            UMQ_LIMIT_VLOG_ERR("read pipe failed, %u of %u chunks are dropped\n", pipe->landed, pipe->buf_num);
+            umq_buf_free(pipe->head);
+        } else {
+            pipe->head->total_data_size = pipe->total_data_size;
+            pipe->head->io_direction = UMQ_IO_RX;
+            report = pipe->head;
+        }
+    }
+    umq_ub_read_ctx_destroy(ctx_buf);
+    return report;
+}
+
+// a read of rendezvous message is done, return the buf to report, NULL if nothing to report yet
+static umq_buf_t *umq_ub_read_wr_done(ub_queue_t *queue, umq_buf_t *ctx_buf)
+{
+    user_ctx_t *user_ctx = (user_ctx_t *)ctx_buf->buf_data;
+    if (user_ctx->pipe != NULL) {
+        return umq_ub_read_pipe_wr_done(queue, ctx_buf);
+    }
+
+    user_ctx->wr_cnt++;
+    if (user_ctx->wr_cnt != user_ctx->wr_total) {
+        return NULL;
+    }
+    if (umq_ub_read_done(queue, user_ctx->msg_id) != UMQ_SUCCESS) {
+        UMQ_LIMIT_VLOG_ERR("umq ub send imm failed\n");
+    }
+    umq_buf_t *dst_buf = user_ctx->dst_buf;
+    if (dst_buf != NULL) {
+        dst_buf->io_direction = UMQ_IO_RX;
+    }
+    umq_buf_free(ctx_buf);
+    return dst_buf;
+}
+
 static void umq_ub_rev_pull_tx_cqe(
     ub_queue_t *queue, umq_buf_t *cur_tx_buf, umq_buf_t **buf, int *qbuf_cnt, int *return_rx_cnt)
 {
-    user_ctx_t *user_ctx = (user_ctx_t *)cur_tx_buf->buf_data;
-    user_ctx->wr_cnt++;
-    if (user_ctx->wr_cnt == user_ctx->wr_total) {
-        if (umq_ub_read_done(queue, user_ctx->msg_id) != UMQ_SUCCESS) {
-            UMQ_LIMIT_VLOG_ERR("umq ub send imm failed\n");
-        }
-        umq_buf_t *tmp = cur_tx_buf;
-        if (user_ctx->dst_buf) {
-            cur_tx_buf = user_ctx->dst_buf;
-            cur_tx_buf->io_direction = UMQ_IO_RX;
-            if (*return_rx_cnt == 0) {
-                buf[*return_rx_cnt] = cur_tx_buf;
-            } else {
-                buf[*return_rx_cnt] = cur_tx_buf;
-                buf[*return_rx_cnt - 1]->qbuf_next = cur_tx_buf;
-            }
-            (*return_rx_cnt)++;
-            ++(*qbuf_cnt);
-        }
-        umq_buf_free(tmp);
+    umq_buf_t *dst_buf = umq_ub_read_wr_done(queue, cur_tx_buf);
+    if (dst_buf == NULL) {
+        return;
+    }
+    buf[*return_rx_cnt] = dst_buf;
+    if (*return_rx_cnt != 0) {
+        buf[*return_rx_cnt - 1]->qbuf_next = dst_buf;
     }
+    (*return_rx_cnt)++;
+    ++(*qbuf_cnt);
 }
 
 static void umq_ub_non_rev_pull_tx_cqe(ub_queue_t *queue, umq_buf_t *cur_tx_buf, int *qbuf_cnt)
 {
+    umq_ub_eager_thresh_sample_done(&queue->eager_thresh, UB_MSG_PATH_EAGER, (uint64_t)(uintptr_t)cur_tx_buf);
     (void)umq_buf_break_and_free(cur_tx_buf);
     ++(*qbuf_cnt);
 }
 
-int umq_ub_dequeue_plus_with_poll_tx(ub_queue_t *queue, urma_cr_t *cr, umq_buf_t **buf, int return_rx_cnt)
+int umq_ub_dequeue_plus_with_poll_tx(
+    ub_queue_t *queue, urma_cr_t *cr, umq_buf_t **buf, int return_rx_cnt, int max_cr_cnt)
 {
+    // every tx cqe may complete a reverse pull and append its dst buf to buf, buf must not be overflowed
+    if (max_cr_cnt <= 0) {
+        return return_rx_cnt;
+    }
     umq_buf_t *tx_buf[UMQ_POST_POLL_BATCH];
-    int tx_cr_cnt = urma_poll_jfc(queue->jfs_jfc, UMQ_POST_POLL_BATCH, cr);
+    int tx_cr_cnt = urma_poll_jfc(queue->jfs_jfc, max_cr_cnt, cr);
     if (tx_cr_cnt < 0) {
         UMQ_LIMIT_VLOG_ERR("UB TX reports tx_cr_cnt[%d]\n", tx_cr_cnt);
         return return_rx_cnt;
@@ -1535,7 +1756,14 @@ static int umq_ub_send_big_data(ub_queue_t *queue, umq_buf_t **buffer)
         .ub_plus = {.umq_private = UMQ_UB_IMM_PRIVATE, .type = IMM_TYPE_UB_PLUS, .sub_type = IMM_TYPE_UB_PLUS_DEFAULT}
     };
     buf_pro->imm_data = imm_temp.value;
-    uint16_t msg_id = util_id_allocator_get(&g_umq_ub_id_allocator);
+    uint32_t id = util_id_allocator_get(&g_umq_ub_id_allocator);
+    if (id >= UMQ_MAX_ID_NUM) {
+        // truncated id would alias msg id 0, which means no buffer to release on peer
+        UMQ_LIMIT_VLOG_ERR("msg id is used up\n");
+        umq_buf_free(send_buf);
+        return -UMQ_ERR_EAGAIN;
+    }
+    uint16_t msg_id = (uint16_t)id;
     queue->addr_list[msg_id] = (uint64_t)(uintptr_t)(*buffer);
 
     umq_imm_head_t *umq_imm_head = (umq_imm_head_t *)(uintptr_t)send_buf->buf_data;
@@ -1543,7 +1771,8 @@ static int umq_ub_send_big_data(ub_queue_t *queue, umq_buf_t **buffer)
     ub_ref_sge_t *ref_sge = (ub_ref_sge_t *)(uintptr_t)(umq_imm_head + 1);
 
     ub_import_mempool_info_t import_mempool_info[UMQ_MAX_TSEG_NUM];
-    uint32_t rest_size = (*buffer)->total_data_size;
+    uint32_t total_size = (*buffer)->total_data_size;
+    uint32_t rest_size = total_size;
     int32_t buf_index = 0;
     uint16_t ref_sge_num = (umq_buf_size_small() - sizeof(umq_imm_head_t)) / sizeof(ub_ref_sge_t);
     urma_sge_t sge;
@@ -1592,13 +1821,16 @@ static int umq_ub_send_big_data(ub_queue_t *queue, umq_buf_t **buffer)
                                     .msg_num = (uint16_t)buf_index}};
     int ret = umq_ub_send_imm(queue, imm.value, &sge, user_ctx);
     if (ret != UMQ_SUCCESS) {
+        util_id_allocator_release(&g_umq_ub_id_allocator, msg_id);
         umq_buf_free(send_buf);
         UMQ_LIMIT_VLOG_ERR("umq_ub_send_imm failed\n");
         return ret;
     }
+    umq_ub_eager_thresh_sample_start(&queue->eager_thresh, UB_MSG_PATH_RNDV, msg_id, total_size);
     return UMQ_SUCCESS;
 
 FREE_BUF:
+    util_id_allocator_release(&g_umq_ub_id_allocator, msg_id);
     umq_buf_free(send_buf);
     return UMQ_FAIL;
 }
@@ -1625,7 +1857,7 @@ int umq_ub_plus_fill_wr_impl(umq_buf_t *qbuf, ub_queue_t *queue, urma_jfs_wr_t *
         }
         buf_pro->opcode = UMQ_OPC_SEND_IMM;
         uint32_t rest_size = buffer->total_data_size;
-        if (rest_size > remote_rx_buf_size) {
+        if (!umq_ub_eager_thresh_select(&queue->eager_thresh, rest_size, remote_rx_buf_size)) {
             int ret = umq_ub_send_big_data(queue, &buffer);
             if (ret != UMQ_SUCCESS) {
                 UMQ_LIMIT_VLOG_ERR("send big data failed\n");
@@ -1645,6 +1877,7 @@ int umq_ub_plus_fill_wr_impl(umq_buf_t *qbuf, ub_queue_t *queue, urma_jfs_wr_t *
         sges_ptr = sges[wr_index];
         sge_num = 0;
         uint64_t user_ctx = (uint64_t)(uintptr_t)buffer;
+        umq_ub_eager_thresh_sample_start(&queue->eager_thresh, UB_MSG_PATH_EAGER, user_ctx, rest_size);
         while (buffer && rest_size > 0) { // try to add up to total_size
             if (sge_num++ >= max_sge_num) {
                 UMQ_LIMIT_VLOG_ERR("sge num exceed max sge num[%u]\n", max_sge_num);
@@ -1737,34 +1970,31 @@ static int umq_report_incomplete_and_merge_rx(
 
 void umq_ub_fill_rx_buffer(ub_queue_t *queue, int rx_cnt)
 {
+    if (queue->jfr_ctx->rx_pool != NULL) {
+        umq_ub_rx_pool_consume(queue, (uint32_t)rx_cnt);
+        return;
+    }
+
     atomic_fetch_add_explicit(&queue->require_rx_count, rx_cnt, memory_order_relaxed);
     uint32_t require_rx_count = umq_get_post_rx_num(queue->rx_depth, &queue->require_rx_count);
-    if (require_rx_count > 0) {
-        umq_buf_list_t head;
-        uint32_t cur_batch_count = 0;
-        do {
-            cur_batch_count = require_rx_count > UMQ_POST_POLL_BATCH ? UMQ_POST_POLL_BATCH : require_rx_count;
-            QBUF_LIST_INIT(&head);
-            if (umq_qbuf_alloc(queue->rx_buf_size, cur_batch_count, NULL, &head) != UMQ_SUCCESS) {
-                atomic_fetch_add_explicit(&queue->require_rx_count, cur_batch_count, memory_order_relaxed);
-                UMQ_LIMIT_VLOG_ERR("alloc rx failed\n");
-                break;
-            }
-            umq_buf_t *bad_buf = NULL;
-            if (umq_ub_post_rx_inner_impl(queue, QBUF_LIST_FIRST(&head), &bad_buf) != UMQ_SUCCESS) {
-                UMQ_LIMIT_VLOG_ERR("post rx failed\n");
-                QBUF_LIST_FIRST(&head) = bad_buf;
-                uint32_t fail_count = 0;
-                while (bad_buf) {
-                    fail_count++;
-                    bad_buf = bad_buf->qbuf_next;
-                }
-                umq_qbuf_free(&head);
-                atomic_fetch_add_explicit(&queue->require_rx_count, fail_count, memory_order_relaxed);
-                break;
-            }
-            require_rx_count -= cur_batch_count;
-        } while (require_rx_count > 0);
+    umq_buf_t *bufs[UMQ_POST_POLL_BATCH];
+    while (require_rx_count > 0) {
+        uint32_t cur_batch_count = require_rx_count > UMQ_POST_POLL_BATCH ? UMQ_POST_POLL_BATCH : require_rx_count;
+        // rx bufs are taken from thread local cache into array, no qbuf list is walked before posting
+        if (umq_qbuf_alloc_bulk(queue->rx_buf_size, cur_batch_count, NULL, bufs) != UMQ_SUCCESS) {
+            atomic_fetch_add_explicit(&queue->require_rx_count, require_rx_count, memory_order_relaxed);
+            UMQ_LIMIT_VLOG_ERR("alloc rx failed\n");
+            break;
+        }
+
+        uint32_t posted_cnt = 0;
+        if (umq_ub_post_rx_bulk_inner_impl(queue, bufs, cur_batch_count, &posted_cnt) != UMQ_SUCCESS) {
+            UMQ_LIMIT_VLOG_ERR("post rx failed\n");
+            umq_qbuf_free_bulk(bufs + posted_cnt, cur_batch_count - posted_cnt);
+            atomic_fetch_add_explicit(&queue->require_rx_count, require_rx_count - posted_cnt, memory_order_relaxed);
+            break;
+        }
+        require_rx_count -= cur_batch_count;
     }
 }
 
@@ -1777,16 +2007,16 @@ static inline umq_buf_t *umq_get_buf_by_user_ctx(ub_queue_t *queue, uint64_t use
     return buf;
 }
 
-int umq_ub_dequeue_with_poll_rx(ub_queue_t *queue, urma_cr_t *cr, umq_buf_t **buf)
+int umq_ub_dequeue_with_poll_rx(ub_queue_t *queue, urma_cr_t *cr, umq_buf_t **buf, int max_cr_cnt)
 {
     int qbuf_cnt = 0;
     // merge rx buffer
     umq_buf_t *previous_last = NULL;
     if (queue->state == QUEUE_STATE_ERR) {
-        return umq_report_incomplete_and_merge_rx(queue, UMQ_POST_POLL_BATCH, buf, &previous_last);
+        return umq_report_incomplete_and_merge_rx(queue, max_cr_cnt, buf, &previous_last);
     }
 
-    int rx_cr_cnt = urma_poll_jfc(queue->jfr_ctx->jfr_jfc, UMQ_POST_POLL_BATCH, cr);
+    int rx_cr_cnt = urma_poll_jfc(queue->jfr_ctx->jfr_jfc, max_cr_cnt, cr);
     if (rx_cr_cnt < 0) {
         UMQ_LIMIT_VLOG_ERR("UB RX reports rx_cr_cnt[%d]\n", rx_cr_cnt);
         return rx_cr_cnt;
@@ -1814,17 +2044,17 @@ int umq_ub_dequeue_with_poll_rx(ub_queue_t *queue, urma_cr_t *cr, umq_buf_t **bu
     return qbuf_cnt;
 }
 
-int umq_ub_dequeue_plus_with_poll_rx(uint64_t umqh_tp, urma_cr_t *cr, umq_buf_t **buf)
+int umq_ub_dequeue_plus_with_poll_rx(uint64_t umqh_tp, urma_cr_t *cr, umq_buf_t **buf, int max_cr_cnt)
 {
     ub_queue_t *queue = (ub_queue_t *)(uintptr_t)umqh_tp;
     // merge rx buffer
     umq_buf_t *previous_last = NULL;
     if (queue->state == QUEUE_STATE_ERR) {
-        return umq_report_incomplete_and_merge_rx(queue, UMQ_POST_POLL_BATCH, buf, &previous_last);
+        return umq_report_incomplete_and_merge_rx(queue, max_cr_cnt, buf, &previous_last);
     }
 
     int qbuf_cnt = 0;
-    int rx_cr_cnt = urma_poll_jfc(queue->jfr_ctx->jfr_jfc, UMQ_POST_POLL_BATCH, cr);
+    int rx_cr_cnt = urma_poll_jfc(queue->jfr_ctx->jfr_jfc, max_cr_cnt, cr);
     if (rx_cr_cnt < 0) {
         UMQ_LIMIT_VLOG_ERR("UB RX reports rx_cr_cnt[%d]\n", rx_cr_cnt);
         return rx_cr_cnt;
@@ -1947,22 +2177,13 @@ void umq_ub_enqueue_plus_with_poll_tx(ub_queue_t *queue, umq_buf_t **buf)
         umq_buf_pro_t *buf_pro = (umq_buf_pro_t *)buf[qbuf_cnt]->qbuf_ext;
         umq_ub_imm_t imm = {.value = buf_pro->imm_data};
         if (imm.bs.type == IMM_TYPE_UB_PLUS && imm.ub_plus.sub_type == IMM_TYPE_REVERSE_PULL_MEM_DONE) {
-            user_ctx_t *user_ctx = (user_ctx_t *)buf[qbuf_cnt]->buf_data;
-            user_ctx->wr_cnt++;
-            if (user_ctx->wr_cnt == user_ctx->wr_total) {
-                if (umq_ub_read_done(queue, user_ctx->msg_id) != UMQ_SUCCESS) {
-                    UMQ_LIMIT_VLOG_ERR("umq ub send imm failed\n");
-                }
-                umq_buf_t *tmp = buf[qbuf_cnt];
-                if (user_ctx->dst_buf) {
-                    buf[qbuf_cnt] = user_ctx->dst_buf;
-                    buf[qbuf_cnt]->io_direction = UMQ_IO_RX;
-                    ++qbuf_cnt;
-                }
-                umq_buf_free(tmp);
+            umq_buf_t *dst_buf = umq_ub_read_wr_done(queue, buf[qbuf_cnt]);
+            if (dst_buf != NULL) {
+                buf[qbuf_cnt++] = dst_buf;
             }
             continue;
         }
+        umq_ub_eager_thresh_sample_done(&queue->eager_thresh, UB_MSG_PATH_EAGER, cr[i].user_ctx);
         (void)umq_buf_break_and_free(buf[qbuf_cnt]);
         ++qbuf_cnt;
     }
@@ -2128,7 +2349,8 @@ void umq_flush_rx(ub_queue_t *queue, uint32_t max_retry_times)
     int rx_cnt = 0;
     uint32_t retry_times = 0;
     umq_buf_t *buf[UMQ_POST_POLL_BATCH];
-    uint32_t remain = queue->rx_depth - atomic_load_explicit(&queue->require_rx_count, memory_order_acquire);
+    uint32_t remain = queue->jfr_ctx->rx_pool != NULL ? umq_ub_rx_pool_posted(queue->jfr_ctx->rx_pool) :
+        queue->rx_depth - atomic_load_explicit(&queue->require_rx_count, memory_order_acquire);
     while (remain > 0 && retry_times < max_retry_times) {
         rx_cnt = umq_ub_poll_rx((uint64_t)(uintptr_t)queue, buf, UMQ_POST_POLL_BATCH);
         if (rx_cnt < 0) {
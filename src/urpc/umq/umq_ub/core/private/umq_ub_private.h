@@ -25,6 +25,8 @@
 #include "umq_vlog.h"
 #include "umq_errno.h"
 #include "util_id_generator.h"
+#include "util_credit.h"
+#include "util_hist.h"
 #include "umq_inner.h"
 #include "umq_qbuf_pool.h"
 #include "umq_ub_imm_data.h"
@@ -130,8 +132,44 @@ typedef struct ub_flow_control {
     bool local_set;
     bool remote_get;
     bool enabled;
+    bool adaptive;
+    util_credit_t credit;       // adaptive mode, local rx posted is granted from credit pool of jfr_ctx
 } ub_flow_control_t;
 
+typedef enum ub_msg_path {
+    UB_MSG_PATH_EAGER,          // message is sent in place
+    UB_MSG_PATH_RNDV,           // message is pulled by receiver
+    UB_MSG_PATH_MAX,
+} ub_msg_path_t;
+
+// one message of each path is timed at a time, from post to the release of its buffers
+typedef struct ub_eager_thresh_sample {
+    uint64_t key;               // first qbuf of eager message, or msg id of rendezvous message
+    uint64_t start_ns;
+    uint32_t cls;
+    volatile uint32_t state;
+} ub_eager_thresh_sample_t;
+
+typedef struct ub_eager_thresh_est {
+    uint64_t mean_ns;
+    uint64_t tail_fp;           // p99 estimate in 1/64 ns
+    uint64_t cnt;
+} ub_eager_thresh_est_t;
+
+typedef struct ub_eager_thresh {
+    umq_eager_thresh_mode_t mode;
+    uint32_t thresh;            // fixed mode, in bytes
+    volatile uint32_t thresh_cls;   // adaptive modes, size classes up to thresh_cls are sent in place
+    uint32_t max_eager_cls;     // size class of remote rx buf size
+    uint64_t probe_tick;
+    uint64_t sample_cnt;
+    uint64_t cnt[UB_MSG_PATH_MAX];
+    uint64_t probe_cnt;
+    uint64_t thresh_update_cnt;
+    ub_eager_thresh_sample_t sample[UB_MSG_PATH_MAX];
+    ub_eager_thresh_est_t est[UB_MSG_PATH_MAX][UMQ_EAGER_THRESH_CLASS_NUM];
+} ub_eager_thresh_t;
+
 typedef struct remote_eid_hmap_node {
     struct urpc_hmap_node node;
     urma_eid_t eid;
@@ -164,6 +202,7 @@ typedef struct umq_ub_ctx {
     umq_trans_info_t trans_info;
     uint64_t remote_notify_addr;
     uint64_t *umq_ctx_jetty_table;
+    struct ub_flow_control **fc_jetty_table;    // adaptive flow control, owner of rx completion on shared jfr
 } umq_ub_ctx_t;
 
 typedef struct rx_buf_ctx {
@@ -207,12 +246,37 @@ typedef struct ub_bind_ctx {
     uint64_t remote_notify_addr;
 } ub_bind_ctx_t;
 
+typedef struct ub_rx_pool {
+    volatile uint32_t posted;           // rx bufs on the jfr, reserved before they are posted
+    volatile uint32_t refilling;        // only one thread refills at a time
+    volatile uint32_t queue_num;        // bound queues receiving from the jfr
+    uint32_t depth;
+    uint32_t buf_size;
+    umq_rx_pool_cfg_t cfg;              // watermarks configured, current ones decay back to them
+    volatile uint32_t high_watermark;
+    volatile uint32_t low_watermark;
+    volatile uint32_t alarm_watermark;
+    volatile uint32_t alarmed;          // alarm raised since posted fell below low watermark
+    uint32_t calm_refill;               // refills since last alarm
+    volatile uint64_t low_ts;           // when posted fell below low watermark, 0 if it is above
+    volatile uint64_t refill_cnt;
+    volatile uint64_t refill_buf_cnt;
+    volatile uint64_t refill_fail_cnt;
+    volatile uint64_t alarm_cnt;
+    volatile uint64_t exhausted_cnt;
+    volatile uint64_t refill_lat_cnt;
+    volatile uint64_t refill_lat_max;
+    util_hist_t refill_lat;             // recorded by the refilling thread only
+} ub_rx_pool_t;
+
 typedef struct jfr_ctx {
     urma_jfr_t *jfr;
     urma_jfc_t *jfr_jfc;
     urma_jfce_t *jfr_jfce;
     volatile uint32_t ref_cnt;
     rx_buf_ctx_list_t rx_buf_ctx_list;
+    util_credit_pool_t credit_pool;     // rx posted not granted to queues sharing the jfr yet
+    ub_rx_pool_t *rx_pool;              // NULL if each queue keeps rx_depth rx bufs posted
 } jfr_ctx_t;
 
 typedef struct ub_queue {
@@ -255,13 +319,30 @@ typedef struct ub_queue {
     umq_buf_t *notify_buf;      // qbuf for manage message exchange, such as mem import/initial flow control window
     uint64_t umqh;
     uint64_t share_rq_umqh;
+    umq_read_pipeline_cfg_t read_pipeline;  // window 0 means all reads of rendezvous message are posted at once
+    ub_eager_thresh_t eager_thresh;
 } ub_queue_t;
 
+// reads of one rendezvous message in pipeline mode, read completions of one jetty come in the order of post
+typedef struct umq_ub_read_pipe {
+    umq_buf_t *head;            // landed chunks not reported yet, used without partial_deliver
+    umq_buf_t *tail;
+    umq_buf_t **chunk;          // dst buf of each chunk, in the order of ref_sge
+    uint32_t chunk_size;        // data size of dst buf allocated for each chunk
+    uint32_t total_data_size;
+    uint16_t buf_num;
+    uint16_t posted;
+    uint16_t landed;
+    bool failed;                // chunks not posted yet are given up
+    ub_ref_sge_t ref_sge[0];
+} umq_ub_read_pipe_t;
+
 typedef struct user_ctx {
     umq_buf_t *dst_buf;
     uint32_t wr_cnt;
     uint32_t wr_total;
     uint32_t msg_id;
+    umq_ub_read_pipe_t *pipe;   // NULL if all reads are posted at once
 } user_ctx_t;
 
 typedef struct ub_queue_ctx_list {
@@ -292,6 +373,9 @@ void rx_buf_ctx_list_uninit(rx_buf_ctx_list_t *rx_buf_ctx_list);
 
 // for control plane on umq ub api
 int umq_ub_post_rx_inner_impl(ub_queue_t *queue, umq_buf_t *qbuf, umq_buf_t **bad_qbuf);
+/* post one rx wr for each qbuf chain in bufs, num should not exceed UMQ_POST_POLL_BATCH.
+ * posted_cnt returns count of leading chains posted, the others are still owned by caller */
+int umq_ub_post_rx_bulk_inner_impl(ub_queue_t *queue, umq_buf_t **bufs, uint32_t num, uint32_t *posted_cnt);
 int umq_ub_data_plan_import_mem(uint64_t umqh_tp, umq_buf_t *rx_buf, uint32_t ref_seg_num);
 rx_buf_ctx_t *queue_rx_buf_ctx_flush(rx_buf_ctx_list_t *rx_buf_ctx_list);
 
@@ -344,12 +428,13 @@ util_id_allocator_t *umq_ub_id_allocator_get(void);
 umq_buf_t *umq_ub_read_ctx_create(ub_queue_t *queue, umq_imm_head_t *umq_imm_head, uint16_t buf_num, uint16_t msg_id);
 
 int umq_ub_plus_fill_wr_impl(umq_buf_t *qbuf, ub_queue_t *queue, urma_jfs_wr_t *urma_wr_ptr, uint32_t remain_tx);
-int umq_ub_dequeue_plus_with_poll_tx(ub_queue_t *queue, urma_cr_t *cr, umq_buf_t **buf, int return_rx_cnt);
+int umq_ub_dequeue_plus_with_poll_tx(
+    ub_queue_t *queue, urma_cr_t *cr, umq_buf_t **buf, int return_rx_cnt, int max_cr_cnt);
 void fill_big_data_ref_sge(ub_queue_t *queue, ub_ref_sge_t *ref_sge,
     umq_buf_t *buffer, ub_import_mempool_info_t *import_mempool_info, umq_imm_head_t *umq_imm_head);
 void umq_ub_fill_rx_buffer(ub_queue_t *queue, int rx_cnt);
-int umq_ub_dequeue_with_poll_rx(ub_queue_t *queue, urma_cr_t *cr, umq_buf_t **buf);
-int umq_ub_dequeue_plus_with_poll_rx(uint64_t umqh_tp, urma_cr_t *cr, umq_buf_t **buf);
+int umq_ub_dequeue_with_poll_rx(ub_queue_t *queue, urma_cr_t *cr, umq_buf_t **buf, int max_cr_cnt);
+int umq_ub_dequeue_plus_with_poll_rx(uint64_t umqh_tp, urma_cr_t *cr, umq_buf_t **buf, int max_cr_cnt);
 void process_bad_qbuf(urma_jfs_wr_t *bad_wr, umq_buf_t **bad_qbuf, umq_buf_t *qbuf, ub_queue_t *queue);
 void umq_ub_enqueue_with_poll_tx(ub_queue_t *queue, umq_buf_t **buf);
 void umq_ub_enqueue_plus_with_poll_tx(ub_queue_t *queue, umq_buf_t **buf);
@@ -0,0 +1,234 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: UMQ UB shared rx buffer pool
+ * Create: 2025-12-31
+ * Note:
+ * History: 2025-12-31
+ */
+
+#include <stdlib.h>
+
+#include "umq_types.h"
+#include "umq_ub_rx_pool.h"
+
+#define UB_RX_POOL_DEFAULT_HIGH_SHIFT   3       // high watermark is 1/8 of rx_depth by default
+#define UB_RX_POOL_CALM_REFILL          64      // refills without alarm before high watermark decays
+#define UB_RX_POOL_DECAY_SHIFT          3       // high watermark decays by 1/8 of its distance to configured one
+
+typedef enum ub_rx_pool_alarm_state {
+    UB_RX_POOL_ALARM_NONE,
+    UB_RX_POOL_ALARM_RAISED,                    // raised by consumer, watermarks not raised yet
+    UB_RX_POOL_ALARM_HANDLED,                   // watermarks raised by refilling thread
+} ub_rx_pool_alarm_state_t;
+
+// low and alarm watermarks keep their configured ratio to high watermark
+static void rx_pool_watermark_set(ub_rx_pool_t *pool, uint32_t high)
+{
+    uint32_t low = (uint32_t)((uint64_t)high * pool->cfg.low_watermark / pool->cfg.high_watermark);
+    uint32_t alarm = (uint32_t)((uint64_t)high * pool->cfg.alarm_watermark / pool->cfg.high_watermark);
+    __atomic_store_n(&pool->alarm_watermark, alarm, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->low_watermark, low, __ATOMIC_RELAXED);
+    __atomic_store_n(&pool->high_watermark, high, __ATOMIC_RELAXED);
+}
+
+int umq_ub_rx_pool_create(jfr_ctx_t *jfr_ctx, ub_queue_t *queue, const umq_rx_pool_cfg_t *cfg)
+{
+    uint32_t depth = queue->rx_depth;
+    uint32_t min_high = depth < UMQ_POST_POLL_BATCH ? depth : UMQ_POST_POLL_BATCH;
+    uint32_t high = depth >> UB_RX_POOL_DEFAULT_HIGH_SHIFT;
+    high = cfg->high_watermark != 0 ? cfg->high_watermark : (high < min_high ? min_high : high);
+    if (high < min_high || high > depth) {
+        UMQ_VLOG_ERR("rx pool high watermark[%u] is invalid, rx depth[%u]\n", high, depth);
+        return -UMQ_ERR_EINVAL;
+    }
+    uint32_t low = cfg->low_watermark != 0 ? cfg->low_watermark : high >> 1;
+    uint32_t alarm = cfg->alarm_watermark != 0 ? cfg->alarm_watermark : low >> 2;
+    if (low == 0 || low >= high || alarm >= low) {
+        UMQ_VLOG_ERR("rx pool watermarks are invalid, high[%u], low[%u], alarm[%u]\n", high, low, alarm);
+        return -UMQ_ERR_EINVAL;
+    }
+
+    ub_rx_pool_t *pool = (ub_rx_pool_t *)calloc(1, sizeof(ub_rx_pool_t));
+    if (pool == NULL) {
+        UMQ_VLOG_ERR("rx pool calloc failed\n");
+        return -UMQ_ERR_ENOMEM;
+    }
+    pool->depth = depth;
+    pool->buf_size = queue->rx_buf_size;
+    pool->cfg.high_watermark = high;
+    pool->cfg.low_watermark = low;
+    pool->cfg.alarm_watermark = alarm;
+    rx_pool_watermark_set(pool, high);
+    jfr_ctx->rx_pool = pool;
+    UMQ_VLOG_INFO("create rx pool, rx depth %u, high watermark %u, low watermark %u, alarm watermark %u\n",
+                  depth, high, low, alarm);
+    return UMQ_SUCCESS;
+}
+
+void umq_ub_rx_pool_destroy(jfr_ctx_t *jfr_ctx)
+{
+    free(jfr_ctx->rx_pool);
+    jfr_ctx->rx_pool = NULL;
+}
+
+// high watermark grows on alarm and decays back after enough calm refills, only called by refilling thread
+static void rx_pool_watermark_adjust(ub_rx_pool_t *pool)
+{
+    uint32_t state = UB_RX_POOL_ALARM_RAISED;
+    if (__atomic_compare_exchange_n(&pool->alarmed, &state, UB_RX_POOL_ALARM_HANDLED, false, __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED)) {
+        uint32_t high = pool->high_watermark << 1;
+        rx_pool_watermark_set(pool, high > pool->depth ? pool->depth : high);
+        pool->calm_refill = 0;
+        return;
+    }
+    if (state != UB_RX_POOL_ALARM_NONE || ++pool->calm_refill < UB_RX_POOL_CALM_REFILL) {
+        return;
+    }
+
+    pool->calm_refill = 0;
+    uint32_t high = pool->high_watermark;
+    if (high > pool->cfg.high_watermark) {
+        uint32_t step = (high - pool->cfg.high_watermark) >> UB_RX_POOL_DECAY_SHIFT;
+        rx_pool_watermark_set(pool, high - (step == 0 ? 1 : step));
+    }
+}
+
+static int rx_pool_refill(ub_queue_t *queue, ub_rx_pool_t *pool)
+{
+    uint32_t idle = 0;
+    if (!__atomic_compare_exchange_n(&pool->refilling, &idle, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        // the other thread is refilling, it posts up to high watermark anyway
+        return UMQ_SUCCESS;
+    }
+
+    rx_pool_watermark_adjust(pool);
+    int ret = UMQ_SUCCESS;
+    uint32_t posted = __atomic_load_n(&pool->posted, __ATOMIC_RELAXED);
+    uint32_t need = posted < pool->high_watermark ? pool->high_watermark - posted : 0;
+    umq_buf_t *bufs[UMQ_POST_POLL_BATCH];
+    while (need > 0) {
+        uint32_t batch = need > UMQ_POST_POLL_BATCH ? UMQ_POST_POLL_BATCH : need;
+        if (umq_qbuf_alloc_bulk(pool->buf_size, batch, NULL, bufs) != UMQ_SUCCESS) {
+            UMQ_LIMIT_VLOG_ERR("rx pool alloc rx failed\n");
+            ret = -UMQ_ERR_ENOMEM;
+            break;
+        }
+
+        // reserved before post, cr of a buf may be polled by other thread as soon as it is posted
+        (void)__atomic_add_fetch(&pool->posted, batch, __ATOMIC_RELEASE);
+        uint32_t posted_cnt = 0;
+        ret = umq_ub_post_rx_bulk_inner_impl(queue, bufs, batch, &posted_cnt);
+        pool->refill_buf_cnt += posted_cnt;
+        if (ret != UMQ_SUCCESS) {
+            UMQ_LIMIT_VLOG_ERR("rx pool post rx failed\n");
+            umq_qbuf_free_bulk(bufs + posted_cnt, batch - posted_cnt);
+            (void)__atomic_sub_fetch(&pool->posted, batch - posted_cnt, __ATOMIC_RELAXED);
+            break;
+        }
+        need -= batch;
+    }
+    pool->refill_cnt++;
+    pool->refill_fail_cnt += ret == UMQ_SUCCESS ? 0 : 1;
+
+    if (__atomic_load_n(&pool->posted, __ATOMIC_RELAXED) >= __atomic_load_n(&pool->low_watermark, __ATOMIC_RELAXED)) {
+        uint64_t low_ts = __atomic_exchange_n(&pool->low_ts, 0, __ATOMIC_RELAXED);
+        if (low_ts != 0) {
+            uint64_t lat = get_timestamp_ns() - low_ts;
+            util_hist_record(&pool->refill_lat, lat);
+            pool->refill_lat_cnt++;
+            pool->refill_lat_max = lat > pool->refill_lat_max ? lat : pool->refill_lat_max;
+        }
+        __atomic_store_n(&pool->alarmed, UB_RX_POOL_ALARM_NONE, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&pool->refilling, 0, __ATOMIC_RELEASE);
+    return ret;
+}
+
+int umq_ub_rx_pool_bind(ub_queue_t *queue)
+{
+    ub_rx_pool_t *pool = queue->jfr_ctx->rx_pool;
+    (void)__atomic_add_fetch(&pool->queue_num, 1, __ATOMIC_RELAXED);
+    umq_inc_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
+    int ret = rx_pool_refill(queue, pool);
+    umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
+    if (ret != UMQ_SUCCESS) {
+        (void)__atomic_sub_fetch(&pool->queue_num, 1, __ATOMIC_RELAXED);
+    }
+    return ret;
+}
+
+void umq_ub_rx_pool_unbind(ub_queue_t *queue)
+{
+    ub_rx_pool_t *pool = queue->jfr_ctx->rx_pool;
+    uint32_t num = __atomic_load_n(&pool->queue_num, __ATOMIC_RELAXED);
+    while (num > 0 && !__atomic_compare_exchange_n(&pool->queue_num, &num, num - 1, true, __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED)) {
+    }
+}
+
+// posted fell below low watermark, start timing the refill and raise alarm once if it is going to run out
+static void rx_pool_low_check(ub_queue_t *queue, ub_rx_pool_t *pool, uint32_t posted)
+{
+    if (__atomic_load_n(&pool->low_ts, __ATOMIC_RELAXED) == 0) {
+        uint64_t low_ts = 0;
+        (void)__atomic_compare_exchange_n(&pool->low_ts, &low_ts, get_timestamp_ns(), false, __ATOMIC_RELAXED,
+            __ATOMIC_RELAXED);
+    }
+    if (posted == 0) {
+        (void)__atomic_add_fetch(&pool->exhausted_cnt, 1, __ATOMIC_RELAXED);
+    }
+    if (posted > __atomic_load_n(&pool->alarm_watermark, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    uint32_t state = UB_RX_POOL_ALARM_NONE;
+    if (!__atomic_compare_exchange_n(&pool->alarmed, &state, UB_RX_POOL_ALARM_RAISED, false, __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED)) {
+        return;
+    }
+    (void)__atomic_add_fetch(&pool->alarm_cnt, 1, __ATOMIC_RELAXED);
+    UMQ_LIMIT_VLOG_WARN("rx pool is running out, jfr_id: %u, posted %u, alarm watermark %u, high watermark %u, "
+                        "bound queues %u\n", queue->jfr_ctx->jfr->jfr_id.id, posted, pool->alarm_watermark,
+                        pool->high_watermark, pool->queue_num);
+}
+
+void umq_ub_rx_pool_consume(ub_queue_t *queue, uint32_t num)
+{
+    ub_rx_pool_t *pool = queue->jfr_ctx->rx_pool;
+    uint32_t posted = __atomic_sub_fetch(&pool->posted, num, __ATOMIC_RELAXED);
+    if (posted >= __atomic_load_n(&pool->low_watermark, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    if (num > 0) {
+        rx_pool_low_check(queue, pool, posted);
+    }
+    (void)rx_pool_refill(queue, pool);
+}
+
+void umq_ub_rx_pool_stats_query(const ub_rx_pool_t *pool, umq_rx_pool_stats_t *out)
+{
+    out->rx_depth = pool->depth;
+    out->posted = __atomic_load_n(&pool->posted, __ATOMIC_RELAXED);
+    out->high_watermark = __atomic_load_n(&pool->high_watermark, __ATOMIC_RELAXED);
+    out->low_watermark = __atomic_load_n(&pool->low_watermark, __ATOMIC_RELAXED);
+    out->alarm_watermark = __atomic_load_n(&pool->alarm_watermark, __ATOMIC_RELAXED);
+    out->queue_num = __atomic_load_n(&pool->queue_num, __ATOMIC_RELAXED);
+    out->refill_cnt = pool->refill_cnt;
+    out->refill_buf_cnt = pool->refill_buf_cnt;
+    out->refill_fail_cnt = pool->refill_fail_cnt;
+    out->alarm_cnt = __atomic_load_n(&pool->alarm_cnt, __ATOMIC_RELAXED);
+    out->exhausted_cnt = __atomic_load_n(&pool->exhausted_cnt, __ATOMIC_RELAXED);
+
+    uint64_t lat_cnt = pool->refill_lat_cnt;
+    out->refill_lat_p50_ns = util_hist_quantile(&pool->refill_lat, lat_cnt, 0.5);
+    out->refill_lat_p99_ns = util_hist_quantile(&pool->refill_lat, lat_cnt, 0.99);
+    out->refill_lat_max_ns = pool->refill_lat_max;
+
+    // without rx pool each bound queue keeps rx_depth rx bufs posted
+    uint64_t per_queue = (uint64_t)out->queue_num * pool->depth;
+    out->saved_bytes_per_queue = out->queue_num == 0 || per_queue <= out->posted ? 0 :
+        (per_queue - out->posted) * pool->buf_size / out->queue_num;
+}
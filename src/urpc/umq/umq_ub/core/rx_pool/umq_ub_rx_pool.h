@@ -0,0 +1,47 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: shared rx buffer pool header file for UMQ
+ * Create: 2025-12-31
+ * Note:
+ * History: 2025-12-31
+ */
+
+#ifndef UMQ_UB_RX_POOL_H
+#define UMQ_UB_RX_POOL_H
+
+#include "umq_ub_private.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Create rx pool of jfr_ctx, watermarks not set in cfg take their default
+ * @param[in] jfr_ctx: jfr_ctx being created
+ * @param[in] queue: queue owning the jfr, rx_depth and rx_buf_size are taken from it
+ * @param[in] cfg: watermarks configured
+ * Return UMQ_SUCCESS, or -UMQ_ERR_EINVAL if watermarks are invalid, -UMQ_ERR_ENOMEM if alloc failed
+ */
+int umq_ub_rx_pool_create(jfr_ctx_t *jfr_ctx, ub_queue_t *queue, const umq_rx_pool_cfg_t *cfg);
+void umq_ub_rx_pool_destroy(jfr_ctx_t *jfr_ctx);
+
+// queue starts to receive from the jfr, rx bufs are refilled up to high watermark if they are not yet
+int umq_ub_rx_pool_bind(ub_queue_t *queue);
+void umq_ub_rx_pool_unbind(ub_queue_t *queue);
+
+// num rx bufs are polled from the jfr by queue, refill if posted falls below low watermark
+void umq_ub_rx_pool_consume(ub_queue_t *queue, uint32_t num);
+
+static inline uint32_t umq_ub_rx_pool_posted(const ub_rx_pool_t *pool)
+{
+    return __atomic_load_n(&pool->posted, __ATOMIC_ACQUIRE);
+}
+
+void umq_ub_rx_pool_stats_query(const ub_rx_pool_t *pool, umq_rx_pool_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
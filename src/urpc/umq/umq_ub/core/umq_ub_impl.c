@@ -25,8 +25,11 @@
 #include "umq_qbuf_pool.h"
 #include "umq_inner.h"
 #include "umq_huge_qbuf_pool.h"
+#include "umq_qbuf_mem.h"
 #include "util_id_generator.h"
 #include "umq_ub_flow_control.h"
+#include "umq_ub_eager_thresh.h"
+#include "umq_ub_rx_pool.h"
 #include "umq_ub_imm_data.h"
 #include "umq_ub_private.h"
 #include "umq_ub_impl.h"
@@ -36,16 +39,22 @@
 
 static umq_ub_ctx_t *g_ub_ctx = NULL;
 static uint32_t g_ub_ctx_count = 0;
+// memory expanded by huge qbuf pools, indexed by mempool id
+static umq_qbuf_mem_t g_huge_qbuf_mem[UINT8_MAX + 1];
+static umq_io_buf_cfg_t g_huge_qbuf_io_buf_cfg;
 
 static int huge_qbuf_pool_memory_init(uint8_t mempool_id, huge_qbuf_pool_size_type_t type, void **buffer_addr)
 {
     uint32_t blk_size = umq_huge_qbuf_get_size_by_type(type);
     uint32_t total_len = blk_size * HUGE_QBUF_BUFFER_INC_BATCH;
-    void *addr = (void *)memalign(UMQ_QBUF_ALIGN_SIZE, total_len);
-    if (addr == NULL) {
-        UMQ_VLOG_ERR("memory alloc failed\n");
+    umq_qbuf_mem_t *mem = &g_huge_qbuf_mem[mempool_id];
+    if (umq_qbuf_mem_alloc(mem, total_len, UMQ_QBUF_ALIGN_SIZE, g_huge_qbuf_io_buf_cfg.backing) != UMQ_SUCCESS) {
         return -UMQ_ERR_ENOMEM;
     }
+    void *addr = mem->addr;
+    if (g_huge_qbuf_io_buf_cfg.prefault) {
+        umq_qbuf_mem_prefault(mem);
+    }
 
     uint32_t failed_idx = 0;
     int ret = 0;
@@ -63,14 +72,18 @@ static int huge_qbuf_pool_memory_init(uint8_t mempool_id, huge_qbuf_pool_size_ty
 
 UNREGISTER_MEM:
     umq_ub_unregister_seg(g_ub_ctx, failed_idx, mempool_id);
-    free(addr);
+    umq_qbuf_mem_free(mem);
     return ret;
 }
 
 static void huge_qbuf_pool_memory_uninit(uint8_t mempool_id, void *buf_addr)
 {
     umq_ub_unregister_seg(g_ub_ctx, g_ub_ctx_count, mempool_id);
-    free(buf_addr);
+    if (g_huge_qbuf_mem[mempool_id].addr != buf_addr) {
+        UMQ_VLOG_ERR("huge qbuf memory of mempool %u mismatch\n", mempool_id);
+        return;
+    }
+    umq_qbuf_mem_free(&g_huge_qbuf_mem[mempool_id]);
 }
 
 int umq_ub_log_config_set_impl(umq_log_config_t *config)
@@ -105,6 +118,8 @@ int32_t umq_ub_huge_qbuf_pool_init(umq_init_cfg_t *cfg)
         .memory_init_callback = huge_qbuf_pool_memory_init,
         .memory_uninit_callback = huge_qbuf_pool_memory_uninit,
     };
+    // expansion happens on io path, the backing is decided here once
+    g_huge_qbuf_io_buf_cfg = cfg->io_buf_cfg;
 
     for (i = 0; i < HUGE_QBUF_POOL_SIZE_TYPE_MAX; i++) {
         pool_cfg.data_size = umq_huge_qbuf_get_size_by_type(i);
@@ -176,7 +191,7 @@ int umq_ub_bind_impl(uint64_t umqh, uint8_t *bind_info, uint32_t bind_info_size)
         return ret;
     }
 
-    if (umq_ub_window_init(&queue->flow_control, info) != UMQ_SUCCESS) {
+    if (umq_ub_window_init(&queue->flow_control, queue, info) != UMQ_SUCCESS) {
         return -UMQ_ERR_EINVAL;
     }
     return umq_ub_bind_inner_impl(queue, info);
@@ -392,6 +407,37 @@ static int umq_find_ub_device(umq_trans_info_t *info, umq_ub_ctx_t *ub_ctx)
     return UMQ_SUCCESS;
 }
 
+static int umq_ub_jetty_table_create(umq_ub_ctx_t *ub_ctx, umq_init_cfg_t *cfg)
+{
+    ub_ctx->umq_ctx_jetty_table = (uint64_t *)calloc(ub_ctx->dev_attr.dev_cap.max_jetty, sizeof(uint64_t));
+    if (ub_ctx->umq_ctx_jetty_table == NULL) {
+        UMQ_VLOG_ERR("calloc umq_ctx_jetty_table failed\n");
+        return -UMQ_ERR_ENOMEM;
+    }
+
+    // rx completions on shared jfr are counted to the queue of local jetty only in adaptive flow control
+    if ((cfg->feature & UMQ_FEATURE_ENABLE_FLOW_CONTROL) == 0 || !cfg->flow_control.adaptive) {
+        return UMQ_SUCCESS;
+    }
+    ub_ctx->fc_jetty_table = (ub_flow_control_t **)calloc(ub_ctx->dev_attr.dev_cap.max_jetty,
+        sizeof(ub_flow_control_t *));
+    if (ub_ctx->fc_jetty_table == NULL) {
+        UMQ_VLOG_ERR("calloc fc_jetty_table failed\n");
+        free(ub_ctx->umq_ctx_jetty_table);
+        ub_ctx->umq_ctx_jetty_table = NULL;
+        return -UMQ_ERR_ENOMEM;
+    }
+    return UMQ_SUCCESS;
+}
+
+static void umq_ub_jetty_table_destroy(umq_ub_ctx_t *ub_ctx)
+{
+    free(ub_ctx->umq_ctx_jetty_table);
+    ub_ctx->umq_ctx_jetty_table = NULL;
+    free(ub_ctx->fc_jetty_table);
+    ub_ctx->fc_jetty_table = NULL;
+}
+
 uint8_t *umq_ub_ctx_init_impl(umq_init_cfg_t *cfg)
 {
     if (g_ub_ctx_count > 0) {
@@ -437,10 +483,7 @@ uint8_t *umq_ub_ctx_init_impl(umq_init_cfg_t *cfg)
             goto ROLLBACK_UB_CTX;
         }
 
-        g_ub_ctx[g_ub_ctx_count].umq_ctx_jetty_table = (uint64_t *)calloc(
-            g_ub_ctx[g_ub_ctx_count].dev_attr.dev_cap.max_jetty, sizeof(uint64_t));
-        if (g_ub_ctx[g_ub_ctx_count].umq_ctx_jetty_table == NULL) {
-            UMQ_VLOG_ERR("calloc umq_ctx_jetty_table failed\n");
+        if (umq_ub_jetty_table_create(&g_ub_ctx[g_ub_ctx_count], cfg) != UMQ_SUCCESS) {
             umq_ub_delete_urma_ctx(&g_ub_ctx[g_ub_ctx_count]);
             umq_ub_ctx_imported_info_destroy(&g_ub_ctx[g_ub_ctx_count]);
             goto ROLLBACK_UB_CTX;
@@ -461,7 +504,7 @@ uint8_t *umq_ub_ctx_init_impl(umq_init_cfg_t *cfg)
         goto ROLLBACK_UB_CTX;
     }
 
-    if (umq_io_buf_malloc(cfg->buf_mode, total_io_buf_size) == NULL) {
+    if (umq_io_buf_malloc(cfg->buf_mode, total_io_buf_size, cfg->io_buf_cfg.backing) == NULL) {
         goto ROLLBACK_UB_CTX;
     }
 
@@ -471,12 +514,17 @@ uint8_t *umq_ub_ctx_init_impl(umq_init_cfg_t *cfg)
         .data_size = umq_buf_size_small(),
         .headroom_size = cfg->headroom_size,
         .mode = cfg->buf_mode,
+        .lock_free = (cfg->feature & UMQ_FEATURE_ENABLE_LOCK_FREE_QBUF_POOL) != 0,
+        .numa_aware = (cfg->feature & UMQ_FEATURE_ENABLE_NUMA_QBUF_POOL) != 0,
     };
     int ret = umq_qbuf_pool_init(&qbuf_cfg);
     if (ret != UMQ_SUCCESS && ret != -UMQ_ERR_EEXIST) {
         UMQ_VLOG_ERR("qbuf poll init failed\n");
         goto IO_BUF_FREE;
     }
+    if (ret == UMQ_SUCCESS && cfg->io_buf_cfg.prefault) {
+        umq_io_buf_prefault();
+    }
     umq_ub_queue_ctx_list_init();
 
     return (uint8_t *)(uintptr_t)g_ub_ctx;
@@ -488,8 +536,7 @@ ROLLBACK_UB_CTX:
     for (uint32_t i = 0; i < g_ub_ctx_count; i++) {
         umq_ub_ctx_imported_info_destroy(&g_ub_ctx[i]);
         umq_ub_delete_urma_ctx(&g_ub_ctx[i]);
-        free(g_ub_ctx[i].umq_ctx_jetty_table);
-        g_ub_ctx[i].umq_ctx_jetty_table = NULL;
+        umq_ub_jetty_table_destroy(&g_ub_ctx[i]);
     }
     g_ub_ctx_count = 0;
     (void)urma_uninit();
@@ -524,8 +571,7 @@ void umq_ub_ctx_uninit_impl(uint8_t *ctx)
         umq_ub_ctx_imported_info_destroy(&context[i]);
         umq_dec_ref(context[i].io_lock_free, &context[i].ref_cnt, 1);
         urma_delete_context(context[i].urma_ctx);
-        free(context[i].umq_ctx_jetty_table);
-        context[i].umq_ctx_jetty_table = NULL;
+        umq_ub_jetty_table_destroy(&context[i]);
     }
 
     umq_qbuf_pool_uninit();
@@ -614,6 +660,9 @@ uint64_t umq_ub_create_impl(uint64_t umqh, uint8_t *ctx, umq_create_option_t *op
         queue->umq_ctx = option->umq_ctx;
         dev_ctx->umq_ctx_jetty_table[queue->jetty->jetty_id.id] = option->umq_ctx;
     }
+    if (dev_ctx->fc_jetty_table != NULL) {
+        dev_ctx->fc_jetty_table[queue->jetty->jetty_id.id] = &queue->flow_control;
+    }
 
     queue->notify_buf = umq_buf_alloc(umq_buf_size_small(), 1, UMQ_INVALID_HANDLE, NULL);
     if (queue->notify_buf == NULL) {
@@ -634,6 +683,9 @@ DELETE_JETTY:
     if ((option->create_flag & UMQ_CREATE_FLAG_UMQ_CTX) != 0) {
         dev_ctx->umq_ctx_jetty_table[queue->jetty->jetty_id.id] = 0;
     }
+    if (dev_ctx->fc_jetty_table != NULL) {
+        dev_ctx->fc_jetty_table[queue->jetty->jetty_id.id] = NULL;
+    }
     (void)urma_delete_jetty(queue->jetty);
 DELETE_JFS_JFC:
     (void)urma_delete_jfc(queue->jfs_jfc);
@@ -681,6 +733,9 @@ int32_t umq_ub_destroy_impl(uint64_t umqh)
     if ((queue->create_flag & UMQ_CREATE_FLAG_UMQ_CTX) != 0) {
         queue->dev_ctx->umq_ctx_jetty_table[queue->jetty->jetty_id.id] = 0;
     }
+    if (queue->dev_ctx->fc_jetty_table != NULL) {
+        queue->dev_ctx->fc_jetty_table[queue->jetty->jetty_id.id] = NULL;
+    }
     if (urma_delete_jetty(queue->jetty) != URMA_SUCCESS) {
         UMQ_VLOG_ERR("delete jetty failed\n");
     }
@@ -849,6 +904,10 @@ int umq_ub_unbind_impl(uint64_t umqh)
                   EID_ARGS(tjetty->id.eid), tjetty->id.id);
     (void)urma_unbind_jetty(queue->jetty);
     (void)urma_unimport_jetty(tjetty);
+    umq_ub_window_uninit(&queue->flow_control);
+    if (queue->jfr_ctx->rx_pool != NULL) {
+        umq_ub_rx_pool_unbind(queue);
+    }
     if (queue->create_flag & UMQ_CREATE_FLAG_SUB_UMQ) {
         UMQ_VLOG_DEBUG("sub umq only need set tx res error\n");
         umq_modify_ubq_to_err(queue, UMQ_IO_TX);
@@ -980,7 +1039,7 @@ umq_buf_t *umq_ub_dequeue_impl(uint64_t umqh_tp)
     }
     urma_cr_t cr[UMQ_POST_POLL_BATCH];
     umq_inc_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
-    int rx_cnt = umq_ub_dequeue_with_poll_rx(queue, cr, buf);
+    int rx_cnt = umq_ub_dequeue_with_poll_rx(queue, cr, buf, UMQ_POST_POLL_BATCH);
     if (rx_cnt <= 0) {
         umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
         return NULL;
@@ -1003,20 +1062,75 @@ umq_buf_t *umq_ub_dequeue_impl_plus(uint64_t umqh_tp)
     umq_inc_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
     urma_cr_t cr[UMQ_POST_POLL_BATCH];
     int return_rx_cnt;
-    int rx_cnt = umq_ub_dequeue_plus_with_poll_rx(umqh_tp, cr, buf);
+    int rx_cnt = umq_ub_dequeue_plus_with_poll_rx(umqh_tp, cr, buf, UMQ_POST_POLL_BATCH);
     if (rx_cnt < 0) {
         umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
         return NULL;
     } else if (rx_cnt == 0) {
-        return_rx_cnt = umq_ub_dequeue_plus_with_poll_tx(queue, cr, buf, rx_cnt);
+        return_rx_cnt = umq_ub_dequeue_plus_with_poll_tx(queue, cr, buf, rx_cnt, UMQ_POST_POLL_BATCH);
         umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
         return return_rx_cnt > 0 ? buf[0] : NULL;
     }
-    return_rx_cnt = umq_ub_dequeue_plus_with_poll_tx(queue, cr, buf, rx_cnt);
+    return_rx_cnt = umq_ub_dequeue_plus_with_poll_tx(queue, cr, buf, rx_cnt, UMQ_POST_POLL_BATCH - rx_cnt);
     umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
     return buf[0];
 }
 
+// polled rx buffers are merged into one list, break it at the head of next message so that bufs[i] is one message
+static void umq_ub_split_rx_buffer(umq_buf_t **bufs, int cnt)
+{
+    for (int i = 0; i < cnt - 1; i++) {
+        umq_buf_t *tmp_buf = bufs[i];
+        while (tmp_buf->qbuf_next != NULL && tmp_buf->qbuf_next != bufs[i + 1]) {
+            tmp_buf = tmp_buf->qbuf_next;
+        }
+        tmp_buf->qbuf_next = NULL;
+    }
+}
+
+int umq_ub_dequeue_burst_impl(uint64_t umqh_tp, umq_buf_t **bufs, uint32_t max)
+{
+    ub_queue_t *queue = (ub_queue_t *)(uintptr_t)umqh_tp;
+    if (queue->bind_ctx == NULL) {
+        UMQ_LIMIT_VLOG_ERR("umq has not been binded\n");
+        return -UMQ_ERR_ENODEV;
+    }
+    int max_cnt = max > UMQ_POST_POLL_BATCH ? UMQ_POST_POLL_BATCH : (int)max;
+    urma_cr_t cr[UMQ_POST_POLL_BATCH];
+    umq_inc_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
+    int rx_cnt = umq_ub_dequeue_with_poll_rx(queue, cr, bufs, max_cnt);
+    if (rx_cnt <= 0) {
+        umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
+        return rx_cnt;
+    }
+    umq_ub_fill_rx_buffer(queue, rx_cnt);
+    umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
+    umq_ub_split_rx_buffer(bufs, rx_cnt);
+    return rx_cnt;
+}
+
+int umq_ub_dequeue_burst_impl_plus(uint64_t umqh_tp, umq_buf_t **bufs, uint32_t max)
+{
+    ub_queue_t *queue = (ub_queue_t *)(uintptr_t)umqh_tp;
+    if (queue->bind_ctx == NULL) {
+        UMQ_LIMIT_VLOG_ERR("umq has not been binded\n");
+        return -UMQ_ERR_ENODEV;
+    }
+    int max_cnt = max > UMQ_POST_POLL_BATCH ? UMQ_POST_POLL_BATCH : (int)max;
+    urma_cr_t cr[UMQ_POST_POLL_BATCH];
+    umq_inc_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
+    int rx_cnt = umq_ub_dequeue_plus_with_poll_rx(umqh_tp, cr, bufs, max_cnt);
+    if (rx_cnt < 0) {
+        umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
+        return rx_cnt;
+    }
+    // reverse pulled messages completed by tx cqe are appended after rx messages
+    int cnt = umq_ub_dequeue_plus_with_poll_tx(queue, cr, bufs, rx_cnt, max_cnt - rx_cnt);
+    umq_dec_ref(queue->dev_ctx->io_lock_free, &queue->ref_cnt, 1);
+    umq_ub_split_rx_buffer(bufs, cnt);
+    return cnt;
+}
+
 void umq_ub_record_rendezvous_buf(uint64_t umqh_tp, uint16_t msg_id, umq_buf_t *buf)
 {
     ub_queue_t *queue = (ub_queue_t *)(uintptr_t)umqh_tp;
@@ -1208,10 +1322,7 @@ int umq_ub_dev_add_impl(umq_trans_info_t *info, umq_init_cfg_t *cfg)
         goto DELETE_IMPORT_INFO;
     }
 
-    g_ub_ctx[g_ub_ctx_count].umq_ctx_jetty_table = (uint64_t *)calloc(
-        g_ub_ctx[g_ub_ctx_count].dev_attr.dev_cap.max_jetty, sizeof(uint64_t));
-    if (g_ub_ctx[g_ub_ctx_count].umq_ctx_jetty_table == NULL) {
-        UMQ_VLOG_ERR("calloc umq_ctx_jetty_table failed\n");
+    if (umq_ub_jetty_table_create(&g_ub_ctx[g_ub_ctx_count], cfg) != UMQ_SUCCESS) {
         goto DELETE_URMA_CTX;
     }
     // register seg
@@ -1241,8 +1352,7 @@ UNREGISTER_MEM:
     (void)umq_qbuf_unregister_seg((uint8_t *)&g_ub_ctx[g_ub_ctx_count], umq_ub_unregister_seg_callback);
 
 FREE_UMQ_CTX_TBL:
-    free(g_ub_ctx[g_ub_ctx_count].umq_ctx_jetty_table);
-    g_ub_ctx[g_ub_ctx_count].umq_ctx_jetty_table = NULL;
+    umq_ub_jetty_table_destroy(&g_ub_ctx[g_ub_ctx_count]);
 
 DELETE_URMA_CTX:
     (void)umq_ub_delete_urma_ctx(&g_ub_ctx[g_ub_ctx_count]);
@@ -1326,15 +1436,36 @@ int umq_ub_get_route_list_impl(const umq_route_t *route, umq_route_list_t *route
 int umq_ub_user_ctl_impl(uint64_t umqh_tp, umq_user_ctl_in_t *in, umq_user_ctl_out_t *out)
 {
     ub_queue_t *queue = (ub_queue_t *)(uintptr_t)umqh_tp;
-    if (in->opcode != UMQ_OPCODE_FLOW_CONTROL_STATS_QUERY || out->addr == 0 ||
-        out->len != sizeof(umq_flow_control_stats_t) || !queue->flow_control.enabled) {
-        UMQ_VLOG_ERR("umq ub user ctl parameter invalid\n");
-        return -UMQ_ERR_EINVAL;
+    switch (in->opcode) {
+        case UMQ_OPCODE_FLOW_CONTROL_STATS_QUERY:
+            if (out->addr == 0 || out->len != sizeof(umq_flow_control_stats_t) || !queue->flow_control.enabled) {
+                break;
+            }
+            queue->flow_control.ops.stats_query(&queue->flow_control,
+                (umq_flow_control_stats_t *)(uintptr_t)out->addr);
+            return UMQ_SUCCESS;
+        case UMQ_OPCODE_EAGER_THRESH_STATS_QUERY:
+            if (out->addr == 0 || out->len != sizeof(umq_eager_thresh_stats_t)) {
+                break;
+            }
+            umq_ub_eager_thresh_stats_query(&queue->eager_thresh, queue->remote_rx_buf_size,
+                (umq_eager_thresh_stats_t *)(uintptr_t)out->addr);
+            return UMQ_SUCCESS;
+        case UMQ_OPCODE_EAGER_THRESH_STATS_CLEAR:
+            umq_ub_eager_thresh_stats_clear(&queue->eager_thresh);
+            return UMQ_SUCCESS;
+        case UMQ_OPCODE_RX_POOL_STATS_QUERY:
+            if (out->addr == 0 || out->len != sizeof(umq_rx_pool_stats_t) || queue->jfr_ctx->rx_pool == NULL) {
+                break;
+            }
+            umq_ub_rx_pool_stats_query(queue->jfr_ctx->rx_pool, (umq_rx_pool_stats_t *)(uintptr_t)out->addr);
+            return UMQ_SUCCESS;
+        default:
+            break;
     }
 
-    umq_flow_control_stats_t *stats = (umq_flow_control_stats_t *)(uintptr_t)out->addr;
-    queue->flow_control.ops.stats_query(&queue->flow_control, stats);
-    return UMQ_SUCCESS;
+    UMQ_VLOG_ERR("umq ub user ctl parameter invalid\n");
+    return -UMQ_ERR_EINVAL;
 }
 
 int umq_ub_mempool_state_get_impl(uint64_t umqh_tp, uint32_t mempool_id, umq_mempool_state_t *mempool_state)
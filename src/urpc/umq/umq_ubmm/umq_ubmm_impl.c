@@ -44,6 +44,7 @@ typedef struct ubmm_bind_ctx {
     uint64_t remote_notify_addr;
     uint64_t qbuf_pool_handle;
     umq_ubmm_ring_buffer_t remote_ring;
+    umq_buf_t *rx_pending;  // messages polled from shm but not returned by umq_dequeue_burst yet
 } ubmm_bind_ctx_t;
 
 typedef struct umq_ubmm_info {
@@ -87,7 +88,7 @@ typedef struct umq_ubmm_ref_sge_info {
     char ub_ref_info[0];
 } __attribute__((packed)) umq_ubmm_ref_sge_info_t;
 
-static const uint32_t UMQ_IPC_DATA_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+static const uint32_t UMQ_IPC_DATA_SIZE = UMQ_SHM_QBUF_DESC_SLOT_SIZE;
 static umq_ubmm_init_ctx_t *g_ubmm_ctx = NULL;
 static uint32_t g_ubmm_ctx_count = 0;
 static util_id_allocator_t g_umq_id_allocator = {0};
@@ -143,7 +144,7 @@ uint8_t *umq_ubmm_ctx_init_impl(umq_init_cfg_t *cfg)
         goto UNINIT_UB;
     }
 
-    if (umq_io_buf_malloc(cfg->buf_mode, total_io_buf_size) == NULL) {
+    if (umq_io_buf_malloc(cfg->buf_mode, total_io_buf_size, cfg->io_buf_cfg.backing) == NULL) {
         goto UNINIT_UB;
     }
 
@@ -153,12 +154,17 @@ uint8_t *umq_ubmm_ctx_init_impl(umq_init_cfg_t *cfg)
         .data_size = umq_buf_size_small(),
         .headroom_size = cfg->headroom_size,
         .mode = cfg->buf_mode,
+        .lock_free = (cfg->feature & UMQ_FEATURE_ENABLE_LOCK_FREE_QBUF_POOL) != 0,
+        .numa_aware = (cfg->feature & UMQ_FEATURE_ENABLE_NUMA_QBUF_POOL) != 0,
     };
     int ret = umq_qbuf_pool_init(&qbuf_cfg);
     if (ret != UMQ_SUCCESS && ret != -UMQ_ERR_EEXIST) {
         UMQ_VLOG_ERR("qbuf poll init failed\n");
         goto IO_BUF_FREE;
     }
+    if (ret == UMQ_SUCCESS && cfg->io_buf_cfg.prefault) {
+        umq_io_buf_prefault();
+    }
 
     return (uint8_t *)(uintptr_t)g_ubmm_ctx;
 IO_BUF_FREE:
@@ -267,10 +273,13 @@ uint64_t umq_ubmm_create_impl(uint64_t umqh, uint8_t *ubmm_ctx, umq_create_optio
     uint64_t data_zone_size = tp->local_ring.tx_depth * (umq_buf_size_small() + sizeof(umq_buf_t) * header_multiply);
 
     // transmit queue and manage queue size calculate
-    uint64_t post_data_size = sizeof(uint32_t) + sizeof(uint64_t);
-    uint64_t tx_post_queue_size = sizeof(shm_ring_hdr_t) + tp->local_ring.tx_depth * post_data_size;
-    uint64_t rx_post_queue_size = sizeof(shm_ring_hdr_t) + tp->local_ring.tx_depth * post_data_size * header_multiply;
-    uint64_t rounded_post_size = round_up(tx_post_queue_size + rx_post_queue_size, umq_buf_size_small());
+    msg_ring_option_t ring_option = {
+        .tx_max_buf_size = UMQ_IPC_DATA_SIZE,
+        .tx_depth = tp->local_ring.tx_depth,
+        .rx_max_buf_size = UMQ_IPC_DATA_SIZE,
+        .rx_depth = tp->local_ring.tx_depth * header_multiply,
+    };
+    uint64_t rounded_post_size = round_up(msg_ring_shm_size(&ring_option), umq_buf_size_small());
 
     uint64_t total_size = round_up(data_zone_size + rounded_post_size, UMQ_SIZE_4M);
     obmem_export_memory_param_t export_param = {
@@ -320,6 +329,7 @@ uint64_t umq_ubmm_create_impl(uint64_t umqh, uint8_t *ubmm_ctx, umq_create_optio
             .id = tp->umq_id,
         },
         .msg_ring = tp->local_msg_ring,
+        .lock_free = global_pool_cfg.lock_free,
     };
 
     tp->qbuf_pool_handle = umq_shm_global_pool_init(&sm_qbuf_pool_cfg);
@@ -554,6 +564,7 @@ int32_t umq_ubmm_unbind_impl(uint64_t umqh_tp)
         return -UMQ_ERR_EAGAIN;
     }
 
+    umq_buf_free(tp->bind_ctx->rx_pending);
     msg_ring_destroy(tp->bind_ctx->remote_msg_ring);
     umq_shm_global_pool_uninit(tp->bind_ctx->qbuf_pool_handle);
     obmem_release_import_memory(tp->bind_ctx->remote_ring.handle, tp->bind_ctx->remote_ring.addr,
@@ -660,7 +671,7 @@ int umq_tp_ubmm_buf_headroom_reset_impl(umq_buf_t *qbuf, uint16_t headroom_size)
     return umq_shm_qbuf_headroom_reset(qbuf_pool_handle, qbuf, headroom_size);
 }
 
-static ALWAYS_INLINE int enqueue_data(uint64_t umqh_tp, uint64_t *offset, uint32_t num)
+static ALWAYS_INLINE int enqueue_data(uint64_t umqh_tp, umq_shm_qbuf_desc_t *desc, uint32_t num)
 {
     umq_ubmm_info_t *tp = (umq_ubmm_info_t *)(uintptr_t)umqh_tp;
     if (num > UMQ_POST_POLL_BATCH) {
@@ -669,11 +680,13 @@ static ALWAYS_INLINE int enqueue_data(uint64_t umqh_tp, uint64_t *offset, uint32
     }
 
     uint32_t sizes[num];
+    char *tx_buf[num];
     for (uint32_t i = 0; i < num; i++) {
-        sizes[i] = sizeof(uint64_t);
+        sizes[i] = sizeof(umq_shm_qbuf_desc_t);
+        tx_buf[i] = (char *)&desc[i];
     }
 
-    int ret = msg_ring_post_tx_batch(tp->local_msg_ring, (char **)&offset, sizes, num);
+    int ret = msg_ring_post_tx_batch(tp->local_msg_ring, tx_buf, sizes, num);
     if (ret != 0) {
         UMQ_LIMIT_VLOG_ERR("ipc post tx failed\n");
         return ret;
@@ -737,18 +750,18 @@ int umq_ubmm_plus_enqueue_impl(uint64_t umqh_tp, umq_buf_t *qbuf, umq_buf_t **ba
     return ret;
 }
 
-static ALWAYS_INLINE int dequeue_data(uint64_t umq, uint64_t *offset, uint32_t num)
+static ALWAYS_INLINE int dequeue_data(uint64_t umq, umq_shm_qbuf_desc_t *desc, uint32_t num)
 {
-    uint64_t *rx_data_ptr[num];
+    umq_shm_qbuf_desc_t *rx_data_ptr[num];
     for (uint32_t i = 0; i < num; i++) {
-        rx_data_ptr[i] = &offset[i];
+        rx_data_ptr[i] = &desc[i];
     }
 
     umq_ubmm_info_t *tp = (umq_ubmm_info_t *)(uintptr_t)umq;
-    // poll offset from shm, then transform to qbuf
+    // poll descriptor from shm, then transform to qbuf
     uint32_t polled_buf_size[num];
     int ret = msg_ring_poll_tx_batch(tp->bind_ctx->remote_msg_ring, (char **)&rx_data_ptr,
-        sizeof(uint64_t), polled_buf_size, num);
+        sizeof(umq_shm_qbuf_desc_t), polled_buf_size, num);
     if (ret < 0) {
         UMQ_LIMIT_VLOG_ERR("ipc poll rx failed\n");
         return -UMQ_ERR_EAGAIN;
@@ -757,6 +770,23 @@ static ALWAYS_INLINE int dequeue_data(uint64_t umq, uint64_t *offset, uint32_t n
     return ret;
 }
 
+// rendezvous descriptor only carries ref sge of peer, data is read by ub and reported by ub dequeue later
+static void umq_ubmm_rendezvous_read(umq_ubmm_info_t *tp, umq_buf_t *polled_buf)
+{
+    umq_ubmm_ref_sge_info_t *ref_sge_info = (umq_ubmm_ref_sge_info_t *)polled_buf->buf_data;
+    umq_ub_imm_t imm_data = {
+        .ub_plus = {
+            .msg_id = ref_sge_info->msg_id,
+            .msg_num = ref_sge_info->sge_num,
+        }
+    };
+    (void)umq_qbuf_headroom_reset(polled_buf, sizeof(umq_ubmm_ref_sge_info_t));
+    if (umq_ub_read(tp->ub_handle, polled_buf, imm_data) != UMQ_SUCCESS) {
+        UMQ_LIMIT_VLOG_DEBUG("send read failed\n");
+        umq_buf_free(polled_buf);
+    }
+}
+
 umq_buf_t *umq_ubmm_plus_dequeue_impl(uint64_t umqh_tp)
 {
     umq_ubmm_info_t *tp = (umq_ubmm_info_t *)(uintptr_t)umqh_tp;
@@ -771,6 +801,21 @@ umq_buf_t *umq_ubmm_plus_dequeue_impl(uint64_t umqh_tp)
         UMQ_LIMIT_VLOG_DEBUG("ub dequeue return nothing\n");
     }
 
+    // messages left by umq_dequeue_burst come before shm queue
+    if (tp->bind_ctx->rx_pending != NULL) {
+        umq_buf_t *pending = tp->bind_ctx->rx_pending;
+        tp->bind_ctx->rx_pending = NULL;
+        if (buf == NULL) {
+            return pending;
+        }
+        umq_buf_t *tmp_buf = buf;
+        while (tmp_buf->qbuf_next) {
+            tmp_buf = tmp_buf->qbuf_next;
+        }
+        tmp_buf->qbuf_next = pending;
+        return buf;
+    }
+
     // poll shm queue
     bool rendezvous = false;
     umq_buf_t *polled_buf = umq_shm_qbuf_dequeue(tp->umqh, umqh_tp, tp->bind_ctx->qbuf_pool_handle,
@@ -778,18 +823,7 @@ umq_buf_t *umq_ubmm_plus_dequeue_impl(uint64_t umqh_tp)
     if (polled_buf == NULL) {
         UMQ_LIMIT_VLOG_DEBUG("umq_shm_qbuf_dequeue return nothing\n");
     } else if (rendezvous) {
-        umq_ubmm_ref_sge_info_t *ref_sge_info = (umq_ubmm_ref_sge_info_t *)polled_buf->buf_data;
-        umq_ub_imm_t imm_data = {
-            .ub_plus = {
-                .msg_id = ref_sge_info->msg_id,
-                .msg_num = ref_sge_info->sge_num,
-            }
-        };
-        (void)umq_qbuf_headroom_reset(polled_buf, sizeof(umq_ubmm_ref_sge_info_t));
-        if (umq_ub_read(tp->ub_handle, polled_buf, imm_data) != UMQ_SUCCESS) {
-            UMQ_LIMIT_VLOG_DEBUG("send read failed\n");
-            umq_buf_free(polled_buf);
-        }
+        umq_ubmm_rendezvous_read(tp, polled_buf);
     } else {
         if (buf == NULL) {
             buf = polled_buf;
@@ -805,6 +839,47 @@ umq_buf_t *umq_ubmm_plus_dequeue_impl(uint64_t umqh_tp)
     return buf;
 }
 
+int umq_ubmm_plus_dequeue_burst_impl(uint64_t umqh_tp, umq_buf_t **bufs, uint32_t max)
+{
+    umq_ubmm_info_t *tp = (umq_ubmm_info_t *)(uintptr_t)umqh_tp;
+    if (tp->bind_ctx == NULL) {
+        UMQ_LIMIT_VLOG_ERR("umq has not been binded\n");
+        return -UMQ_ERR_ENODEV;
+    }
+
+    // try to dequeue ub to get read data and handle notify
+    int cnt = umq_ub_dequeue_burst_impl_plus(tp->ub_handle, bufs, max);
+    if (cnt < 0) {
+        UMQ_LIMIT_VLOG_DEBUG("ub dequeue failed, ret: %d\n", cnt);
+        cnt = 0;
+    }
+    uint32_t msg_cnt = (uint32_t)cnt;
+    msg_cnt += umq_shm_qbuf_cut_msgs(&tp->bind_ctx->rx_pending, NULL, 0, bufs + msg_cnt, max - msg_cnt);
+    if (msg_cnt == max) {
+        return (int)msg_cnt;
+    }
+
+    // poll shm queue for the rest slots, rendezvous bufs are not returned until read done
+    umq_buf_t *chains[max - msg_cnt];
+    bool rendezvous[max - msg_cnt];
+    int polled_cnt = umq_shm_qbuf_dequeue_burst(tp->umqh, umqh_tp, tp->bind_ctx->qbuf_pool_handle, chains,
+        rendezvous, max - msg_cnt, dequeue_data);
+    if (polled_cnt <= 0) {
+        return (int)msg_cnt;
+    }
+
+    uint32_t chain_cnt = 0;
+    for (int i = 0; i < polled_cnt; i++) {
+        if (rendezvous[i]) {
+            umq_ubmm_rendezvous_read(tp, chains[i]);
+            continue;
+        }
+        chains[chain_cnt++] = chains[i];
+    }
+    msg_cnt += umq_shm_qbuf_cut_msgs(&tp->bind_ctx->rx_pending, chains, chain_cnt, bufs + msg_cnt, max - msg_cnt);
+    return (int)msg_cnt;
+}
+
 void umq_ubmm_notify_impl(uint64_t umqh_tp)
 {
     umq_ubmm_info_t *tp = (umq_ubmm_info_t *)(uintptr_t)umqh_tp;
@@ -41,6 +41,7 @@ int umq_tp_ubmm_buf_headroom_reset_impl(umq_buf_t *qbuf, uint16_t headroom_size)
 int umq_ubmm_plus_enqueue_impl(uint64_t umqh_tp, umq_buf_t *qbuf, umq_buf_t **bad_qbuf);
 
 umq_buf_t *umq_ubmm_plus_dequeue_impl(uint64_t umqh_tp);
+int umq_ubmm_plus_dequeue_burst_impl(uint64_t umqh_tp, umq_buf_t **bufs, uint32_t max);
 
 void umq_ubmm_notify_impl(uint64_t umqh_tp);
 
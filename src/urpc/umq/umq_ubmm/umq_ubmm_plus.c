@@ -101,6 +101,11 @@ static umq_buf_t *umq_tp_ubmm_plus_dequeue(uint64_t umqh_tp)
     return umq_ubmm_plus_dequeue_impl(umqh_tp);
 }
 
+static int umq_tp_ubmm_plus_dequeue_burst(uint64_t umqh_tp, umq_buf_t **bufs, uint32_t max)
+{
+    return umq_ubmm_plus_dequeue_burst_impl(umqh_tp, bufs, max);
+}
+
 static void umq_tp_ubmm_plus_notify(uint64_t umqh_tp)
 {
     umq_ubmm_notify_impl(umqh_tp);
@@ -137,6 +142,7 @@ static umq_ops_t g_umq_ubmm_plus_ops = {
     .umq_tp_buf_headroom_reset = umq_tp_ubmm_plus_buf_headroom_reset,
     .umq_tp_enqueue = umq_tp_ubmm_plus_enqueue,
     .umq_tp_dequeue = umq_tp_ubmm_plus_dequeue,
+    .umq_tp_dequeue_burst = umq_tp_ubmm_plus_dequeue_burst,
     .umq_tp_notify = umq_tp_ubmm_plus_notify,
     .umq_tp_rearm_interrupt = umq_tp_ubmm_plus_rearm_interrupt,
     .umq_tp_wait_interrupt = umq_tp_ubmm_plus_wait_interrupt,
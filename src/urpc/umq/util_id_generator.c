@@ -5,14 +5,88 @@
  * Create: 2025-9-12
  */
 
+#include <stdbool.h>
 #include <stdint.h>
-#include <pthread.h>
 #include <stdlib.h>
+#include "umq_vlog.h"
 #include "util_id_generator.h"
 
+#define UTIL_ID_STACK_IDX_MASK      (0xffffffffULL)
+#define UTIL_ID_STACK_GEN_SHIFT     (32)
+#define UTIL_ID_BITS_PER_WORD       (64)
+
+static inline uint64_t util_id_stack_top_next(uint64_t old_top, uint32_t idx)
+{
+    return (((old_top >> UTIL_ID_STACK_GEN_SHIFT) + 1) << UTIL_ID_STACK_GEN_SHIFT) | idx;
+}
+
+/* pop released id from stack, return false if stack is empty. link of top id may be read after it is popped
+ * and pushed again by others, the generation changed since then makes the cas fail */
+static bool util_id_stack_pop(util_id_allocator_t *id_allocator, uint32_t *id)
+{
+    uint64_t old_top = __atomic_load_n(&id_allocator->top, __ATOMIC_ACQUIRE);
+    uint64_t new_top;
+    uint32_t idx;
+
+    do {
+        idx = (uint32_t)(old_top & UTIL_ID_STACK_IDX_MASK);
+        if (idx == 0) {
+            return false;
+        }
+        uint32_t next = __atomic_load_n(&id_allocator->available_ids[idx - 1], __ATOMIC_RELAXED);
+        new_top = util_id_stack_top_next(old_top, next);
+    } while (!__atomic_compare_exchange_n(&id_allocator->top, &old_top, new_top, true, __ATOMIC_ACQUIRE,
+        __ATOMIC_ACQUIRE));
+
+    *id = idx - 1;
+    return true;
+}
+
+static void util_id_stack_push(util_id_allocator_t *id_allocator, uint32_t id)
+{
+    uint64_t old_top = __atomic_load_n(&id_allocator->top, __ATOMIC_RELAXED);
+    uint64_t new_top;
+
+    do {
+        __atomic_store_n(&id_allocator->available_ids[id], (uint32_t)(old_top & UTIL_ID_STACK_IDX_MASK),
+            __ATOMIC_RELAXED);
+        new_top = util_id_stack_top_next(old_top, id + 1);
+    } while (!__atomic_compare_exchange_n(&id_allocator->top, &old_top, new_top, true, __ATOMIC_RELEASE,
+        __ATOMIC_RELAXED));
+}
+
+static inline void util_id_allocated_set(util_id_allocator_t *id_allocator, uint32_t id)
+{
+    (void)__atomic_fetch_or(&id_allocator->allocated[id / UTIL_ID_BITS_PER_WORD],
+        1ULL << (id % UTIL_ID_BITS_PER_WORD), __ATOMIC_RELAXED);
+}
+
+// clear allocated bit of id, return false if it is not set
+static inline bool util_id_allocated_clear(util_id_allocator_t *id_allocator, uint32_t id)
+{
+    uint64_t bit = 1ULL << (id % UTIL_ID_BITS_PER_WORD);
+    return (__atomic_fetch_and(&id_allocator->allocated[id / UTIL_ID_BITS_PER_WORD], ~bit, __ATOMIC_RELAXED) &
+        bit) != 0;
+}
+
+// take an id never allocated, return false if all of them have been taken
+static bool util_id_fresh_get(util_id_allocator_t *id_allocator, uint32_t *id)
+{
+    uint32_t next_id = __atomic_load_n(&id_allocator->next_id, __ATOMIC_RELAXED);
+    do {
+        if (next_id >= id_allocator->max_num) {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&id_allocator->next_id, &next_id, next_id + 1, true, __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED));
+
+    *id = next_id;
+    return true;
+}
+
 int util_id_allocator_init(util_id_allocator_t *id_allocator, uint32_t max_num, uint32_t start_id)
 {
-    if (id_allocator->available_ids != NULL) {
+    if (id_allocator->available_ids != NULL || max_num == 0 || max_num == UINT32_MAX) {
         return -1;
     }
 
@@ -21,47 +95,56 @@ int util_id_allocator_init(util_id_allocator_t *id_allocator, uint32_t max_num,
         return -1;
     }
 
-    id_allocator->num_available = 0;
+    id_allocator->allocated = (uint64_t *)calloc(
+        (max_num + UTIL_ID_BITS_PER_WORD - 1) / UTIL_ID_BITS_PER_WORD, sizeof(uint64_t));
+    if (id_allocator->allocated == NULL) {
+        free(id_allocator->available_ids);
+        id_allocator->available_ids = NULL;
+        return -1;
+    }
+
+    id_allocator->top = 0;
     id_allocator->next_id = start_id;
     id_allocator->max_num = max_num;
-    (void)pthread_mutex_init(&id_allocator->lock, NULL);
 
     return 0;
 }
 
 void util_id_allocator_uninit(util_id_allocator_t *id_allocator)
 {
-    (void)pthread_mutex_destroy(&id_allocator->lock);
     free(id_allocator->available_ids);
     id_allocator->available_ids = NULL;
+    free(id_allocator->allocated);
+    id_allocator->allocated = NULL;
 }
 
 uint32_t util_id_allocator_get(util_id_allocator_t *id_allocator)
 {
     uint32_t id;
-    (void)pthread_mutex_lock(&id_allocator->lock);
-    if (id_allocator->num_available > 0) {
-        id = id_allocator->available_ids[--id_allocator->num_available];
-    } else {
-        id = id_allocator->next_id++;
-        if (id >= id_allocator->max_num) {
-            id_allocator->next_id--;
-        }
+    // released ids are reused first, so that ids stay in a small range
+    if (util_id_stack_pop(id_allocator, &id) || util_id_fresh_get(id_allocator, &id)) {
+        util_id_allocated_set(id_allocator, id);
+        return id;
     }
-    (void)pthread_mutex_unlock(&id_allocator->lock);
 
-    return id;
+    // ids may be released after stack is found empty
+    if (util_id_stack_pop(id_allocator, &id)) {
+        util_id_allocated_set(id_allocator, id);
+        return id;
+    }
+    return id_allocator->max_num;
 }
 
 void util_id_allocator_release(util_id_allocator_t *id_allocator, uint32_t util_id)
 {
-    if (id_allocator->available_ids == NULL) {
+    if (id_allocator->available_ids == NULL || util_id >= id_allocator->max_num) {
         return;
     }
-    (void)pthread_mutex_lock(&id_allocator->lock);
-    if (id_allocator->num_available < id_allocator->max_num) {
-        id_allocator->available_ids[id_allocator->num_available++] = util_id;
+
+    // only the release which clears the bit pushes id, so that id is never in stack twice
+    if (!util_id_allocated_clear(id_allocator, util_id)) {
+        UMQ_LIMIT_VLOG_ERR("id %u is released but not in use\n", util_id);
+        return;
     }
-    (void)pthread_mutex_unlock(&id_allocator->lock);
-    return;
+    util_id_stack_push(id_allocator, util_id);
 }
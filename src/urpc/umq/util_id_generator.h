@@ -8,21 +8,37 @@
 #ifndef UTIL_ID_GENERATOR_H
 #define UTIL_ID_GENERATOR_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* ids never allocated are taken by moving next_id forward, released ids are kept in a lock free stack.
+ * stack is linked through available_ids indexed by id, and its top is tagged with a generation, so that
+ * it can be swapped by 64 bit cas without ABA problem. allocated records ids in use, so that an id released
+ * twice or never got, e.g. taken from a stale message of peer, is rejected instead of linking the stack to itself */
 typedef struct util_id_allocator {
-    uint32_t *available_ids;
-    uint32_t num_available;
+    uint32_t *available_ids;    // available_ids[id] is next released id + 1 in stack, 0 ends the stack
+    uint64_t *allocated;        // one bit per id, set while id is in use
+    uint64_t top;               // generation(high 32 bits) | released id + 1(low 32 bits), 0 id means empty
     uint32_t next_id;
     uint32_t max_num;
-    pthread_mutex_t lock;
 } util_id_allocator_t;
 
 int util_id_allocator_init(util_id_allocator_t *id_allocator, uint32_t max_num, uint32_t start_id);
 void util_id_allocator_uninit(util_id_allocator_t *id_allocator);
+
+/*
+ * get an id in [start_id, max_num), max_num is returned if all ids are in use.
+ * thread safe and lock free
+ */
 uint32_t util_id_allocator_get(util_id_allocator_t *id_allocator);
+
+/*
+ * release id got from util_id_allocator_get, release of an id not in use is logged and ignored.
+ * thread safe and lock free
+ */
 void util_id_allocator_release(util_id_allocator_t *id_allocator, uint32_t util_id);
 
 #ifdef __cplusplus
@@ -8,11 +8,50 @@
 #include <errno.h>
 #include <string.h>
 
+#include "urpc_dbuf_stat.h"
 #include "util_log.h"
 #include "urpc_util.h"
 
 #include "urpc_slab.h"
 
+#define ESLAB_CACHE_SLOT_NUM (64)    // threads are mapped to slots, threads beyond it share slots
+#define ESLAB_CACHE_SIZE (28)        // ids held by one slot, a slot fills two cache lines
+#define ESLAB_CACHE_BATCH (ESLAB_CACHE_SIZE / 2)
+#define ESLAB_CACHE_MIN_TOTAL (1024) // smaller slab has no cache, ids held in slots are a large part of it
+#define ESLAB_CACHE_ALIGN (64)
+#define ESLAB_CACHE_POISON (UINT32_MAX - 1)  // first word of a cached object, changed means use after free
+
+/* magazines in front of the shared free list. a thread takes its own slot with one exchange and never waits for
+ * it, when the slot is taken by another thread mapped to it, the shared free list is used instead. a slot refills
+ * and drains ESLAB_CACHE_BATCH ids under slab->lock at once */
+typedef struct eslab_cache_slot {
+    uint32_t busy;
+    uint32_t num;
+    uint32_t id[ESLAB_CACHE_SIZE];
+} __attribute__((aligned(ESLAB_CACHE_ALIGN))) eslab_cache_slot_t;
+
+typedef struct eslab_cache {
+    eslab_cache_slot_t slot[ESLAB_CACHE_SLOT_NUM];
+    void *head;  // address allocated, slots are aligned in it
+} eslab_cache_t;
+
+static uint32_t g_eslab_thread_num;
+static __thread uint32_t g_eslab_thread_slot = UINT32_MAX;
+
+static eslab_cache_t *eslab_cache_create(void)
+{
+    void *head = urpc_dbuf_calloc(URPC_DBUF_TYPE_UTIL, 1, sizeof(eslab_cache_t) + ESLAB_CACHE_ALIGN);
+    if (head == NULL) {
+        UTIL_LOG_WARN("calloc eslab cache failed, use shared free list only\n");
+        return NULL;
+    }
+
+    eslab_cache_t *cache =
+        (eslab_cache_t *)(((uintptr_t)head + ESLAB_CACHE_ALIGN - 1) & ~((uintptr_t)ESLAB_CACHE_ALIGN - 1));
+    cache->head = head;
+    return cache;
+}
+
 void eslab_init(eslab_t *slab, void *addr, uint32_t obj_size, uint32_t total)
 {
     uint64_t i;
@@ -28,27 +67,55 @@ void eslab_init(eslab_t *slab, void *addr, uint32_t obj_size, uint32_t total)
     slab->obj_size = obj_size;
     slab->total = total;
     slab->next_free = 0;
+    slab->cache = total >= ESLAB_CACHE_MIN_TOTAL ? eslab_cache_create() : NULL;
     (void)pthread_spin_init(&slab->lock, PTHREAD_PROCESS_PRIVATE);
 }
 
 void eslab_uninit(eslab_t *slab)
 {
+    if (slab->cache != NULL) {
+        urpc_dbuf_free(slab->cache->head);
+        slab->cache = NULL;
+    }
     (void)pthread_spin_destroy(&slab->lock);
 }
 
-void *eslab_alloc(eslab_t *slab, uint32_t *id)
+static inline eslab_cache_slot_t *eslab_cache_slot_get(eslab_cache_t *cache)
 {
-    (void)pthread_spin_lock(&slab->lock);
+    if (URPC_UNLIKELY(g_eslab_thread_slot == UINT32_MAX)) {
+        g_eslab_thread_slot = __atomic_fetch_add(&g_eslab_thread_num, 1, __ATOMIC_RELAXED) % ESLAB_CACHE_SLOT_NUM;
+    }
+
+    return &cache->slot[g_eslab_thread_slot];
+}
+
+static inline bool eslab_cache_slot_trylock(eslab_cache_slot_t *slot)
+{
+    return __atomic_load_n(&slot->busy, __ATOMIC_RELAXED) == 0 &&
+        __atomic_exchange_n(&slot->busy, 1, __ATOMIC_ACQUIRE) == 0;
+}
+
+static inline void eslab_cache_slot_lock(eslab_cache_slot_t *slot)
+{
+    while (!eslab_cache_slot_trylock(slot)) {
+    }
+}
 
+static inline void eslab_cache_slot_unlock(eslab_cache_slot_t *slot)
+{
+    __atomic_store_n(&slot->busy, 0, __ATOMIC_RELEASE);
+}
+
+// slab->lock held
+static inline void *eslab_pop(eslab_t *slab, uint32_t *id)
+{
     if (URPC_UNLIKELY(slab->next_free == UINT32_MAX)) {
-        (void)pthread_spin_unlock(&slab->lock);
         errno = URPC_ERR_ENOMEM;
         return NULL;
     }
 
     // Non-public interface, ensure that the parameter is not NULL.
     if (URPC_UNLIKELY(slab->next_free >= slab->total)) {
-        (void)pthread_spin_unlock(&slab->lock);
         UTIL_LOG_DEBUG("eslab alloc out of range, next_free = %u, total = %u\n", slab->next_free, slab->total);
         errno = URPC_ERR_EPERM;
         return NULL;
@@ -59,16 +126,22 @@ void *eslab_alloc(eslab_t *slab, uint32_t *id)
     slab->next_free = *(uint32_t *)buf;
     /* next block still in use, means use after free */
     if (URPC_UNLIKELY(slab->next_free >= slab->total && slab->next_free != UINT32_MAX)) {
-        (void)pthread_spin_unlock(&slab->lock);
         UTIL_LOG_DEBUG("eslab alloc out of range, next_free = %u, total = %u\n", slab->next_free, slab->total);
         errno = URPC_ERR_EPERM;
         return NULL;
     }
+    return buf;
+}
+
+static void *eslab_alloc_shared(eslab_t *slab, uint32_t *id)
+{
+    (void)pthread_spin_lock(&slab->lock);
+    void *buf = eslab_pop(slab, id);
     (void)pthread_spin_unlock(&slab->lock);
     return buf;
 }
 
-void eslab_free(eslab_t *slab, uint32_t id, void *buf)
+static void eslab_free_shared(eslab_t *slab, uint32_t id, void *buf)
 {
     (void)pthread_spin_lock(&slab->lock);
     *(uint32_t *)buf = slab->next_free;
@@ -76,6 +149,181 @@ void eslab_free(eslab_t *slab, uint32_t id, void *buf)
     (void)pthread_spin_unlock(&slab->lock);
 }
 
+// slot locked and empty, return the number of ids moved from shared free list
+static uint32_t eslab_cache_refill(eslab_t *slab, eslab_cache_slot_t *slot)
+{
+    uint32_t num = 0;
+    uint32_t id;
+    void *buf;
+
+    (void)pthread_spin_lock(&slab->lock);
+    while (num < ESLAB_CACHE_BATCH && (buf = eslab_pop(slab, &id)) != NULL) {
+        *(uint32_t *)buf = ESLAB_CACHE_POISON;
+        slot->id[num++] = id;
+    }
+    (void)pthread_spin_unlock(&slab->lock);
+
+    slot->num = num;
+    return num;
+}
+
+// slot locked, move the oldest num ids back to shared free list
+static void eslab_cache_drain(eslab_t *slab, eslab_cache_slot_t *slot, uint32_t num)
+{
+    (void)pthread_spin_lock(&slab->lock);
+    for (uint32_t i = 0; i < num; i++) {
+        *(uint32_t *)eslab_id_to_addr(slab, slot->id[i]) = slab->next_free;
+        slab->next_free = slot->id[i];
+    }
+    (void)pthread_spin_unlock(&slab->lock);
+
+    slot->num -= num;
+    (void)memmove(&slot->id[0], &slot->id[num], slot->num * sizeof(uint32_t));
+}
+
+// shared free list is empty, take back ids held by all slots. one slot is locked at a time
+static void eslab_cache_flush(eslab_t *slab)
+{
+    for (uint32_t i = 0; i < ESLAB_CACHE_SLOT_NUM; i++) {
+        eslab_cache_slot_t *slot = &slab->cache->slot[i];
+        if (__atomic_load_n(&slot->num, __ATOMIC_RELAXED) == 0) {
+            continue;
+        }
+        eslab_cache_slot_lock(slot);
+        eslab_cache_drain(slab, slot, slot->num);
+        eslab_cache_slot_unlock(slot);
+    }
+}
+
+void *eslab_alloc(eslab_t *slab, uint32_t *id)
+{
+    eslab_cache_t *cache = slab->cache;
+    if (cache == NULL) {
+        return eslab_alloc_shared(slab, id);
+    }
+
+    eslab_cache_slot_t *slot = eslab_cache_slot_get(cache);
+    if (URPC_UNLIKELY(!eslab_cache_slot_trylock(slot))) {
+        return eslab_alloc_shared(slab, id);
+    }
+
+    if (URPC_UNLIKELY(slot->num == 0 && eslab_cache_refill(slab, slot) == 0)) {
+        eslab_cache_slot_unlock(slot);
+        eslab_cache_flush(slab);
+        return eslab_alloc_shared(slab, id);
+    }
+
+    uint32_t cur = slot->id[--slot->num];
+    eslab_cache_slot_unlock(slot);
+
+    void *buf = eslab_id_to_addr(slab, cur);
+    /* cached block has been written, means use after free */
+    if (URPC_UNLIKELY(*(uint32_t *)buf != ESLAB_CACHE_POISON)) {
+        UTIL_LOG_DEBUG("eslab cached object %u is changed after free, total = %u\n", cur, slab->total);
+        errno = URPC_ERR_EPERM;
+        return NULL;
+    }
+    *id = cur;
+    return buf;
+}
+
+void eslab_free(eslab_t *slab, uint32_t id, void *buf)
+{
+    eslab_cache_t *cache = slab->cache;
+    if (cache == NULL) {
+        eslab_free_shared(slab, id, buf);
+        return;
+    }
+
+    eslab_cache_slot_t *slot = eslab_cache_slot_get(cache);
+    if (URPC_UNLIKELY(!eslab_cache_slot_trylock(slot))) {
+        eslab_free_shared(slab, id, buf);
+        return;
+    }
+
+    if (URPC_UNLIKELY(slot->num == ESLAB_CACHE_SIZE)) {
+        eslab_cache_drain(slab, slot, ESLAB_CACHE_BATCH);
+    }
+    *(uint32_t *)buf = ESLAB_CACHE_POISON;
+    slot->id[slot->num++] = id;
+    eslab_cache_slot_unlock(slot);
+}
+
+// slab->lock held, the last object of a run is pushed first, so the run is popped in ascending order
+static void eslab_push_runs(eslab_t *slab, const eslab_run_t *run, uint32_t run_num)
+{
+    for (uint32_t i = run_num; i > 0; i--) {
+        for (uint32_t id = run[i - 1].id + run[i - 1].num; id > run[i - 1].id; id--) {
+            *(uint32_t *)eslab_id_to_addr(slab, id - 1) = slab->next_free;
+            slab->next_free = id - 1;
+        }
+    }
+}
+
+// slab->lock held
+static uint32_t eslab_pop_runs(eslab_t *slab, uint32_t num, eslab_run_t *run, uint32_t max_run)
+{
+    uint32_t run_num = 0;
+    uint32_t id;
+
+    for (uint32_t i = 0; i < num; i++) {
+        if (eslab_pop(slab, &id) == NULL) {
+            goto PUT_BACK;
+        }
+
+        eslab_run_t *last = run_num == 0 ? NULL : &run[run_num - 1];
+        if (last != NULL && id == last->id + last->num) {
+            last->num++;
+        } else if (last != NULL && id + 1 == last->id) {
+            last->id = id;
+            last->num++;
+        } else if (run_num < max_run) {
+            run[run_num].id = id;
+            run[run_num].num = 1;
+            run_num++;
+        } else {
+            eslab_run_t one = {.id = id, .num = 1};
+            eslab_push_runs(slab, &one, 1);
+            errno = URPC_ERR_ENOMEM;
+            goto PUT_BACK;
+        }
+    }
+    return run_num;
+
+PUT_BACK:
+    eslab_push_runs(slab, run, run_num);
+    return 0;
+}
+
+uint32_t eslab_alloc_runs(eslab_t *slab, uint32_t num, eslab_run_t *run, uint32_t max_run)
+{
+    if (URPC_UNLIKELY(num == 0 || num > slab->total || max_run == 0)) {
+        errno = URPC_ERR_EINVAL;
+        return 0;
+    }
+
+    (void)pthread_spin_lock(&slab->lock);
+    uint32_t run_num = eslab_pop_runs(slab, num, run, max_run);
+    (void)pthread_spin_unlock(&slab->lock);
+    if (run_num != 0 || slab->cache == NULL || errno != URPC_ERR_ENOMEM) {
+        return run_num;
+    }
+
+    // objects may be held by front cache
+    eslab_cache_flush(slab);
+    (void)pthread_spin_lock(&slab->lock);
+    run_num = eslab_pop_runs(slab, num, run, max_run);
+    (void)pthread_spin_unlock(&slab->lock);
+    return run_num;
+}
+
+void eslab_free_runs(eslab_t *slab, const eslab_run_t *run, uint32_t run_num)
+{
+    (void)pthread_spin_lock(&slab->lock);
+    eslab_push_runs(slab, run, run_num);
+    (void)pthread_spin_unlock(&slab->lock);
+}
+
 // return first used object
 void *eslab_get_first_used_object_lockless(eslab_t *slab)
 {
@@ -92,6 +340,17 @@ void *eslab_get_first_used_object_lockless(eslab_t *slab)
         next_free = *(uint32_t *)((uintptr_t)slab->addr + next_free * slab->obj_size);
     }
 
+    for (uint32_t i = 0; slab->cache != NULL && i < ESLAB_CACHE_SLOT_NUM; i++) {
+        eslab_cache_slot_t *slot = &slab->cache->slot[i];
+        for (uint32_t j = 0; j < slot->num; j++) {
+            if (slot->id[j] >= slab_num || idle_slab[slot->id[j]]) {
+                UTIL_LIMIT_LOG_DEBUG("idle slab cache must not contain invalid or duplicate ids\n");
+                return NULL;
+            }
+            idle_slab[slot->id[j]] = true;
+        }
+    }
+
     for (uint32_t i = 0; i < slab_num; i++) {
         if (!idle_slab[i]) {
             return (void *)((uintptr_t)slab->addr + i * slab->obj_size);
@@ -99,3 +358,18 @@ void *eslab_get_first_used_object_lockless(eslab_t *slab)
     }
     return NULL;
 }
+
+void *eslab_get_first_used_object(eslab_t *slab)
+{
+    // slots are locked before slab->lock, the same order as refill and drain
+    for (uint32_t i = 0; slab->cache != NULL && i < ESLAB_CACHE_SLOT_NUM; i++) {
+        eslab_cache_slot_lock(&slab->cache->slot[i]);
+    }
+    (void)pthread_spin_lock(&slab->lock);
+    void *buf = eslab_get_first_used_object_lockless(slab);
+    (void)pthread_spin_unlock(&slab->lock);
+    for (uint32_t i = 0; slab->cache != NULL && i < ESLAB_CACHE_SLOT_NUM; i++) {
+        eslab_cache_slot_unlock(&slab->cache->slot[i]);
+    }
+    return buf;
+}
@@ -17,19 +17,39 @@
 extern "C" {
 #endif
 
+struct eslab_cache;
+
 typedef struct eslab {
     pthread_spinlock_t lock;
     void *addr;          // Start address of this slab-controlled memory
     uint32_t obj_size;   // Object size inside the slab
     uint32_t total;      // Total number of the objects
     uint32_t next_free;  // The index of next available object
+    struct eslab_cache *cache;  // Per thread front cache of eslab_alloc/eslab_free, NULL for small slab
 } eslab_t;
 
+// objects adjacent in memory, taken and returned together
+typedef struct eslab_run {
+    uint32_t id;   // The index of first object
+    uint32_t num;  // Number of objects from id
+} eslab_run_t;
+
 void eslab_init(eslab_t *slab, void *addr, uint32_t obj_size, uint32_t total);
 void eslab_uninit(eslab_t *slab);
 void *eslab_alloc(eslab_t *slab, uint32_t *id);
 void eslab_free(eslab_t *slab, uint32_t id, void *buf);
+
+/**
+ * Take num objects from the shared free list in one critical section, adjacent ids are merged into one run.
+ * Return the number of runs, or 0 with errno set if num objects are not available or need more than max_run runs,
+ * in which case nothing is taken.
+ */
+uint32_t eslab_alloc_runs(eslab_t *slab, uint32_t num, eslab_run_t *run, uint32_t max_run);
+// return runs in one critical section, objects of a run are taken in order by next eslab_alloc_runs
+void eslab_free_runs(eslab_t *slab, const eslab_run_t *run, uint32_t run_num);
 void *eslab_get_first_used_object_lockless(eslab_t *slab);
+// objects held by front cache are idle, the cache is locked during the walk
+void *eslab_get_first_used_object(eslab_t *slab);
 
 static inline void *eslab_alloc_lockless(eslab_t *slab, uint32_t *id)
 {
@@ -90,14 +110,6 @@ static inline bool eslab_validate_addr(eslab_t *slab, void *addr)
         ((uint64_t)(uintptr_t)addr <= (uint64_t)(uintptr_t)slab->addr + ((uint64_t)slab->obj_size * slab->total));
 }
 
-static inline void *eslab_get_first_used_object(eslab_t *slab)
-{
-    (void)pthread_spin_lock(&slab->lock);
-    void *buf = eslab_get_first_used_object_lockless(slab);
-    (void)pthread_spin_unlock(&slab->lock);
-    return buf;
-}
-
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,12 @@ typedef enum urpc_thread_closure_type {
     THREAD_CLOSURE_PERF,
     THREAD_CLOSURE_QBUF,
     THREAD_CLOSURE_POOL,
+    THREAD_CLOSURE_HUGE_QBUF,
+    THREAD_CLOSURE_QUEUE_STATS,
+    THREAD_CLOSURE_EPOCH,
+    THREAD_CLOSURE_CRYPTO,
+    THREAD_CLOSURE_TIMER_WHEEL,
+    THREAD_CLOSURE_MSG_RING,
 
     THREAD_CLOSURE_MAX,
 } urpc_thread_closure_type_t;
@@ -0,0 +1,133 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util receiver side credit flow control
+ * Create: 2025-12-30
+ */
+
+#include <string.h>
+
+#include "util_credit.h"
+
+#define UTIL_CREDIT_INTERVAL_SHIFT  (4)     // initial interval is 1/16 of share by default
+
+static inline uint32_t credit_max_interval(uint32_t share)
+{
+    return share < 2 ? 1 : share >> 1;
+}
+
+void util_credit_pool_init(util_credit_pool_t *pool, uint32_t capacity)
+{
+    pool->pending = 0;
+    pool->sender_num = 0;
+    pool->capacity = capacity == 0 ? 1 : capacity;
+}
+
+void util_credit_join(util_credit_t *credit, util_credit_pool_t *pool, uint32_t interval)
+{
+    (void)memset(credit, 0, sizeof(util_credit_t));
+    credit->pool = pool;
+    (void)__atomic_add_fetch(&pool->sender_num, 1, __ATOMIC_RELAXED);
+
+    uint32_t share = util_credit_share(credit);
+    if (interval == 0) {
+        interval = share >> UTIL_CREDIT_INTERVAL_SHIFT;
+    }
+    uint32_t max_interval = credit_max_interval(share);
+    credit->interval = interval == 0 ? 1 : (interval > max_interval ? max_interval : interval);
+}
+
+void util_credit_leave(util_credit_t *credit)
+{
+    if (credit->pool == NULL) {
+        return;
+    }
+
+    util_credit_post(credit->pool, __atomic_exchange_n(&credit->outstanding, 0, __ATOMIC_RELAXED));
+    (void)__atomic_sub_fetch(&credit->pool->sender_num, 1, __ATOMIC_RELAXED);
+    credit->pool = NULL;
+}
+
+uint32_t util_credit_avail(const util_credit_t *credit)
+{
+    uint32_t share = util_credit_share(credit);
+    uint32_t outstanding = __atomic_load_n(&credit->outstanding, __ATOMIC_RELAXED);
+    if (outstanding >= share) {
+        return 0;
+    }
+
+    uint32_t pending = __atomic_load_n(&credit->pool->pending, __ATOMIC_RELAXED);
+    return pending < share - outstanding ? pending : share - outstanding;
+}
+
+uint32_t util_credit_take(util_credit_t *credit, uint32_t max)
+{
+    uint32_t num, pending = __atomic_load_n(&credit->pool->pending, __ATOMIC_RELAXED);
+    do {
+        num = pending < max ? pending : max;
+        if (num == 0) {
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&credit->pool->pending, &pending, pending - num, true, __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED));
+
+    (void)__atomic_add_fetch(&credit->outstanding, num, __ATOMIC_RELAXED);
+    (void)__atomic_add_fetch(&credit->total_granted, num, __ATOMIC_RELAXED);
+    return num;
+}
+
+uint32_t util_credit_grant(util_credit_t *credit, util_credit_grant_mode_t mode)
+{
+    if (mode == UTIL_CREDIT_GRANT_PIGGYBACK) {
+        (void)__atomic_add_fetch(&credit->tx_cnt, 1, __ATOMIC_RELAXED);
+        uint32_t avail = util_credit_avail(credit);
+        return avail == 0 ? 0 : util_credit_take(credit, avail);
+    }
+
+    uint32_t avail = util_credit_avail(credit);
+    if (avail == 0) {
+        return 0;
+    }
+
+    uint32_t share = util_credit_share(credit);
+    uint32_t outstanding = __atomic_load_n(&credit->outstanding, __ATOMIC_RELAXED);
+    uint32_t interval = __atomic_load_n(&credit->interval, __ATOMIC_RELAXED);
+    uint32_t tx_cnt = __atomic_load_n(&credit->tx_cnt, __ATOMIC_RELAXED);
+    // messages were sent to sender since last standalone grant, more of them are likely to carry credits soon
+    uint32_t thresh = tx_cnt != credit->tx_cnt_granted ? interval << 1 : interval;
+    thresh = thresh > share ? share : thresh;
+    // sender without credit can not send at all, grant whatever is available
+    if (outstanding != 0 && avail < thresh) {
+        return 0;
+    }
+
+    uint32_t num = util_credit_take(credit, avail);
+    if (num == 0) {
+        return 0;
+    }
+    credit->tx_cnt_granted = tx_cnt;
+    (void)__atomic_add_fetch(&credit->total_standalone, 1, __ATOMIC_RELAXED);
+
+    uint32_t max_interval = credit_max_interval(share);
+    if (outstanding == 0) {
+        // sender ran out of credits before the grant, it must be granted earlier
+        (void)__atomic_add_fetch(&credit->total_starved, 1, __ATOMIC_RELAXED);
+        interval = interval > 1 ? interval >> 1 : 1;
+    } else if (outstanding >= interval && interval < max_interval) {
+        // credits left still cover a whole interval, a larger interval saves standalone grants
+        interval++;
+    }
+    __atomic_store_n(&credit->interval, interval > max_interval ? max_interval : interval, __ATOMIC_RELAXED);
+    return num;
+}
+
+void util_credit_revoke(util_credit_t *credit, uint32_t num)
+{
+    uint32_t after, before = __atomic_load_n(&credit->outstanding, __ATOMIC_RELAXED);
+    do {
+        after = before > num ? before - num : 0;
+    } while (!__atomic_compare_exchange_n(&credit->outstanding, &before, after, true, __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED));
+    (void)__atomic_sub_fetch(&credit->total_granted, num, __ATOMIC_RELAXED);
+    util_credit_post(credit->pool, num);
+}
@@ -0,0 +1,103 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util receiver side credit flow control
+ * Create: 2025-12-30
+ */
+
+#ifndef UTIL_CREDIT_H
+#define UTIL_CREDIT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* receive buffers posted by one receiver are granted to senders as credits, one credit for one message.
+ * each sender may hold at most capacity / sender_num credits not consumed yet, so a busy sender can not
+ * starve the others. credits are granted in two ways:
+ * 1. piggyback: a message is sent to the sender anyway, all available credits ride on it;
+ * 2. standalone: a message is sent only for the grant, it is sent when interval credits are available.
+ * interval adapts to consumption: it grows by one while the sender still has plenty of credits at grant time,
+ * and halves when the sender has used up all its credits before the grant */
+
+typedef struct util_credit_pool {
+    volatile uint32_t pending;      // posted receive buffers not granted yet
+    volatile uint32_t sender_num;
+    uint32_t capacity;              // receive buffers shared by senders
+} util_credit_pool_t;
+
+typedef struct util_credit {
+    util_credit_pool_t *pool;
+    volatile uint32_t outstanding;  // granted and not consumed yet
+    volatile uint32_t interval;     // credits available before a standalone grant
+    volatile uint32_t tx_cnt;       // messages to sender, which can carry credits
+    uint32_t tx_cnt_granted;        // tx_cnt at last standalone grant
+    volatile uint64_t total_granted;
+    volatile uint64_t total_consumed;
+    volatile uint64_t total_standalone;
+    volatile uint64_t total_starved;    // standalone grants made when sender has no credit
+} util_credit_t;
+
+typedef enum util_credit_grant_mode {
+    UTIL_CREDIT_GRANT_PIGGYBACK,
+    UTIL_CREDIT_GRANT_STANDALONE,
+} util_credit_grant_mode_t;
+
+void util_credit_pool_init(util_credit_pool_t *pool, uint32_t capacity);
+
+// receive buffers are posted, or returned without being consumed
+static inline void util_credit_post(util_credit_pool_t *pool, uint32_t num)
+{
+    (void)__atomic_add_fetch(&pool->pending, num, __ATOMIC_RELAXED);
+}
+
+// sender joins pool with interval as initial notify interval, interval 0 means share / 16
+void util_credit_join(util_credit_t *credit, util_credit_pool_t *pool, uint32_t interval);
+// credits outstanding return to pool, receive buffers behind them are still posted
+void util_credit_leave(util_credit_t *credit);
+
+// fair share of sender, capacity of pool divided by senders
+static inline uint32_t util_credit_share(const util_credit_t *credit)
+{
+    uint32_t num = __atomic_load_n(&credit->pool->sender_num, __ATOMIC_RELAXED);
+    uint32_t share = num == 0 ? credit->pool->capacity : credit->pool->capacity / num;
+    return share == 0 ? 1 : share;
+}
+
+// credits can be granted to sender now, no more than its share
+uint32_t util_credit_avail(const util_credit_t *credit);
+
+/**
+ * Grant credits to sender
+ * @param[in] credit: credit of sender
+ * @param[in] mode: UTIL_CREDIT_GRANT_PIGGYBACK when a message is sent anyway, all available credits are granted;
+ *                  UTIL_CREDIT_GRANT_STANDALONE when a message would be sent only for credits, it is granted when due
+ * Return credits granted, 0 if nothing to grant or not due
+ */
+uint32_t util_credit_grant(util_credit_t *credit, util_credit_grant_mode_t mode);
+
+// take up to max credits regardless of interval, used for initial window
+uint32_t util_credit_take(util_credit_t *credit, uint32_t max);
+
+// granted credits failed to reach sender, they return to pool
+void util_credit_revoke(util_credit_t *credit, uint32_t num);
+
+// sender consumed credits, num messages are received
+static inline void util_credit_consume(util_credit_t *credit, uint32_t num)
+{
+    uint32_t after, before = __atomic_load_n(&credit->outstanding, __ATOMIC_RELAXED);
+    do {
+        after = before > num ? before - num : 0;
+    } while (!__atomic_compare_exchange_n(&credit->outstanding, &before, after, true, __ATOMIC_RELAXED,
+        __ATOMIC_RELAXED));
+    (void)__atomic_add_fetch(&credit->total_consumed, num, __ATOMIC_RELAXED);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
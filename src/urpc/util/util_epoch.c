@@ -0,0 +1,147 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util epoch based reclamation
+ * Create: 2026-01-05
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "urpc_dbuf_stat.h"
+#include "urpc_thread_closure.h"
+#include "util_log.h"
+#include "util_epoch.h"
+
+typedef struct util_epoch_retired {
+    struct util_epoch_retired *next;
+    void *ptr;
+    void (*free_func)(void *ptr);
+    uint64_t epoch;                 // global epoch when ptr was retired
+} util_epoch_retired_t;
+
+volatile uint64_t g_util_epoch = UTIL_EPOCH_IDLE + 1;
+__thread util_epoch_reader_t *g_util_epoch_reader;
+
+// readers are never freed, released ones are taken again by new threads
+static util_epoch_reader_t *g_util_epoch_readers;
+static pthread_mutex_t g_util_epoch_retired_lock = PTHREAD_MUTEX_INITIALIZER;
+static util_epoch_retired_t *g_util_epoch_retired;
+static uint32_t g_util_epoch_retired_num;
+
+static void util_epoch_reader_put(uint64_t id)
+{
+    util_epoch_reader_t *reader = (util_epoch_reader_t *)(uintptr_t)id;
+    reader->nest = 0;
+    __atomic_store_n(&reader->epoch, UTIL_EPOCH_IDLE, __ATOMIC_RELEASE);
+    __atomic_store_n(&reader->in_use, false, __ATOMIC_RELEASE);
+    g_util_epoch_reader = NULL;
+}
+
+util_epoch_reader_t *util_epoch_reader_get(void)
+{
+    util_epoch_reader_t *reader = __atomic_load_n(&g_util_epoch_readers, __ATOMIC_ACQUIRE);
+    for (; reader != NULL; reader = reader->next) {
+        bool in_use = false;
+        if (!__atomic_load_n(&reader->in_use, __ATOMIC_RELAXED) &&
+            __atomic_compare_exchange_n(&reader->in_use, &in_use, true, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            goto FOUND;
+        }
+    }
+
+    void *head = urpc_dbuf_calloc(URPC_DBUF_TYPE_UTIL, 1, sizeof(util_epoch_reader_t) + UTIL_EPOCH_ALIGN);
+    if (head == NULL) {
+        UTIL_LOG_ERR("calloc epoch reader failed\n");
+        return NULL;
+    }
+    reader = (util_epoch_reader_t *)(((uintptr_t)head + UTIL_EPOCH_ALIGN - 1) & ~((uintptr_t)UTIL_EPOCH_ALIGN - 1));
+    reader->head = head;
+    reader->in_use = true;
+    reader->next = __atomic_load_n(&g_util_epoch_readers, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&g_util_epoch_readers, &reader->next, reader, true, __ATOMIC_RELEASE,
+        __ATOMIC_RELAXED)) {
+    }
+
+FOUND:
+    g_util_epoch_reader = reader;
+    urpc_thread_closure_register(THREAD_CLOSURE_EPOCH, (uint64_t)(uintptr_t)reader, util_epoch_reader_put);
+    return reader;
+}
+
+static uint64_t util_epoch_min_active(void)
+{
+    // pairs with fence in util_epoch_read_lock: either reader is seen here, or it sees object unpublished
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint64_t min = UINT64_MAX;
+    util_epoch_reader_t *reader = __atomic_load_n(&g_util_epoch_readers, __ATOMIC_ACQUIRE);
+    for (; reader != NULL; reader = reader->next) {
+        uint64_t epoch = __atomic_load_n(&reader->epoch, __ATOMIC_ACQUIRE);
+        if (epoch != UTIL_EPOCH_IDLE && epoch < min) {
+            min = epoch;
+        }
+    }
+    return min;
+}
+
+void util_epoch_retire(void *ptr, void (*free_func)(void *ptr))
+{
+    util_epoch_retired_t *retired =
+        (util_epoch_retired_t *)urpc_dbuf_malloc(URPC_DBUF_TYPE_UTIL, sizeof(util_epoch_retired_t));
+    if (retired == NULL) {
+        UTIL_LOG_WARN("malloc epoch retired failed, free after readers left\n");
+        util_epoch_synchronize();
+        free_func(ptr);
+        return;
+    }
+    retired->ptr = ptr;
+    retired->free_func = free_func;
+
+    (void)pthread_mutex_lock(&g_util_epoch_retired_lock);
+    // readers announcing a later epoch load after this, they see ptr unpublished
+    retired->epoch = __atomic_fetch_add(&g_util_epoch, 1, __ATOMIC_SEQ_CST);
+    retired->next = g_util_epoch_retired;
+    g_util_epoch_retired = retired;
+    g_util_epoch_retired_num++;
+    (void)pthread_mutex_unlock(&g_util_epoch_retired_lock);
+
+    (void)util_epoch_reclaim();
+}
+
+uint32_t util_epoch_reclaim(void)
+{
+    util_epoch_retired_t *expired = NULL;
+
+    (void)pthread_mutex_lock(&g_util_epoch_retired_lock);
+    uint64_t min = util_epoch_min_active();
+    util_epoch_retired_t **cur = &g_util_epoch_retired;
+    while (*cur != NULL) {
+        util_epoch_retired_t *retired = *cur;
+        if (retired->epoch < min) {
+            *cur = retired->next;
+            retired->next = expired;
+            expired = retired;
+            g_util_epoch_retired_num--;
+        } else {
+            cur = &retired->next;
+        }
+    }
+    uint32_t remain = g_util_epoch_retired_num;
+    (void)pthread_mutex_unlock(&g_util_epoch_retired_lock);
+
+    while (expired != NULL) {
+        util_epoch_retired_t *next = expired->next;
+        expired->free_func(expired->ptr);
+        urpc_dbuf_free(expired);
+        expired = next;
+    }
+    return remain;
+}
+
+void util_epoch_synchronize(void)
+{
+    uint64_t epoch = __atomic_fetch_add(&g_util_epoch, 1, __ATOMIC_SEQ_CST);
+    while (util_epoch_min_active() <= epoch) {
+        (void)sched_yield();
+    }
+    (void)util_epoch_reclaim();
+}
@@ -0,0 +1,84 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util epoch based reclamation
+ * Create: 2026-01-05
+ */
+
+#ifndef UTIL_EPOCH_H
+#define UTIL_EPOCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* readers access shared objects between util_epoch_read_lock and util_epoch_read_unlock without any lock.
+ * writer unpublishes an object first, then retires it, the object is freed once every reader which may still
+ * see it has left its read section. a reader announces the global epoch at read lock, object retired in epoch e
+ * is freed when no reader stays in an epoch not larger than e.
+ * read sections may nest, and must not call util_epoch_synchronize */
+
+#define UTIL_EPOCH_IDLE (0)
+#define UTIL_EPOCH_ALIGN (64)
+
+typedef struct util_epoch_reader {
+    volatile uint64_t epoch;        // epoch announced by the reader, UTIL_EPOCH_IDLE out of read section
+    uint32_t nest;
+    volatile bool in_use;           // taken by a thread, released at thread exit
+    struct util_epoch_reader *next;
+    void *head;
+} __attribute__((aligned(UTIL_EPOCH_ALIGN))) util_epoch_reader_t;
+
+extern volatile uint64_t g_util_epoch;
+extern __thread util_epoch_reader_t *g_util_epoch_reader;
+
+// slow path of util_epoch_read_lock, take a reader for current thread, return NULL if alloc failed
+util_epoch_reader_t *util_epoch_reader_get(void);
+
+// return false if no reader could be taken for current thread, nothing is protected then
+static inline bool util_epoch_read_lock(void)
+{
+    util_epoch_reader_t *reader = g_util_epoch_reader;
+    if (__builtin_expect(reader == NULL, 0)) {
+        reader = util_epoch_reader_get();
+        if (reader == NULL) {
+            return false;
+        }
+    }
+
+    if (reader->nest++ == 0) {
+        __atomic_store_n(&reader->epoch, __atomic_load_n(&g_util_epoch, __ATOMIC_ACQUIRE), __ATOMIC_RELAXED);
+        // announce must be visible before shared objects are loaded, pairs with fence in reclaim
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+    return true;
+}
+
+static inline void util_epoch_read_unlock(void)
+{
+    util_epoch_reader_t *reader = g_util_epoch_reader;
+    if (--reader->nest == 0) {
+        __atomic_store_n(&reader->epoch, UTIL_EPOCH_IDLE, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * Free ptr by free_func once no reader can see it, ptr must be unpublished already.
+ * If the retire record can not be allocated, wait for readers and free ptr at once.
+ */
+void util_epoch_retire(void *ptr, void (*free_func)(void *ptr));
+
+// free retired objects which no reader can see any more, return the number of objects still retired
+uint32_t util_epoch_reclaim(void);
+
+// wait until readers in read section at call have left, then free all retired objects
+void util_epoch_synchronize(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util log-linear histogram
+ * Create: 2025-12-10
+ */
+
+#include <string.h>
+
+#include "util_hist.h"
+
+void util_hist_clear(util_hist_t *hist)
+{
+    (void)memset(hist->bucket, 0, sizeof(hist->bucket));
+}
+
+void util_hist_merge(util_hist_t *dst, const util_hist_t *src)
+{
+    for (uint32_t i = 0; i < UTIL_HIST_BUCKET_NUM; i++) {
+        dst->bucket[i] += src->bucket[i];
+    }
+}
+
+uint64_t util_hist_value(uint32_t index)
+{
+    if (index < (2u << UTIL_HIST_SUB_BUCKET_BITS)) {
+        return index;
+    }
+
+    uint32_t shift = index / UTIL_HIST_SUB_BUCKET_NUM - 1;
+    uint64_t lowest = (uint64_t)(index - shift * UTIL_HIST_SUB_BUCKET_NUM) << shift;
+    return lowest + ((1ULL << shift) >> 1);
+}
+
+uint64_t util_hist_quantile(const util_hist_t *hist, uint64_t cnt, double quantile)
+{
+    if (cnt == 0) {
+        return 0;
+    }
+
+    // rank of the sample at quantile, counted from 1
+    uint64_t rank = (uint64_t)(quantile * (double)cnt + 0.5);
+    rank = rank == 0 ? 1 : (rank > cnt ? cnt : rank);
+    for (uint32_t i = 0; i < UTIL_HIST_BUCKET_NUM; i++) {
+        if (hist->bucket[i] >= rank) {
+            return util_hist_value(i);
+        }
+        rank -= hist->bucket[i];
+    }
+
+    // cnt is more than samples in hist, return the highest bucket recorded
+    for (uint32_t i = UTIL_HIST_BUCKET_NUM; i > 0; i--) {
+        if (hist->bucket[i - 1] != 0) {
+            return util_hist_value(i - 1);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util log-linear histogram
+ * Create: 2025-12-10
+ */
+
+#ifndef UTIL_HIST_H
+#define UTIL_HIST_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* values below 64 have one bucket each, every power of two above is split into 32 equal sub buckets.
+ * a value is reported as the middle of its bucket, so relative error is no more than 1/64 (1.6%).
+ * values from 2^36 (about 68s in ns) on are counted in the last bucket */
+#define UTIL_HIST_SUB_BUCKET_BITS   (5)
+#define UTIL_HIST_SUB_BUCKET_NUM    (1u << UTIL_HIST_SUB_BUCKET_BITS)
+#define UTIL_HIST_MAX_BITS          (36)
+#define UTIL_HIST_BUCKET_NUM        ((UTIL_HIST_MAX_BITS - UTIL_HIST_SUB_BUCKET_BITS + 1) * UTIL_HIST_SUB_BUCKET_NUM)
+
+typedef struct util_hist {
+    uint64_t bucket[UTIL_HIST_BUCKET_NUM];
+} util_hist_t;
+
+static inline uint32_t util_hist_index(uint64_t value)
+{
+    if (value < (2ULL << UTIL_HIST_SUB_BUCKET_BITS)) {
+        return (uint32_t)value;
+    }
+    if (value >= (1ULL << UTIL_HIST_MAX_BITS)) {
+        return UTIL_HIST_BUCKET_NUM - 1;
+    }
+
+    // (value >> shift) is in [32, 64), buckets of each power of two follow the previous one
+    uint32_t shift = (uint32_t)(63 - __builtin_clzll(value)) - UTIL_HIST_SUB_BUCKET_BITS;
+    return shift * UTIL_HIST_SUB_BUCKET_NUM + (uint32_t)(value >> shift);
+}
+
+// single writer, no lock or atomic is needed on the record path
+static inline void util_hist_record(util_hist_t *hist, uint64_t value)
+{
+    hist->bucket[util_hist_index(value)]++;
+}
+
+void util_hist_clear(util_hist_t *hist);
+void util_hist_merge(util_hist_t *dst, const util_hist_t *src);
+
+// middle value of the bucket
+uint64_t util_hist_value(uint32_t index);
+
+/**
+ * Get the value at quantile from the histogram
+ * @param[in] hist: histogram
+ * @param[in] cnt: count of samples recorded in hist
+ * @param[in] quantile: in [0, 1], e.g. 0.999 for p99.9
+ * Return the value at quantile, 0 if hist is empty
+ */
+uint64_t util_hist_quantile(const util_hist_t *hist, uint64_t cnt, double quantile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
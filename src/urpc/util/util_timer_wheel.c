@@ -0,0 +1,471 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util per thread hierarchical timing wheel
+ * Create: 2026-01-14
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "urpc_dbuf_stat.h"
+#include "urpc_framework_errno.h"
+#include "urpc_thread_closure.h"
+#include "urpc_util.h"
+#include "util_log.h"
+#include "util_timer_wheel.h"
+
+struct util_timer_wheel {
+    urpc_list_t slots[UTIL_TIMER_WHEEL_LEVEL_NUM][UTIL_TIMER_WHEEL_LEVEL_SIZE];
+    uint32_t level_num[UTIL_TIMER_WHEEL_LEVEL_NUM];    // timers linked in each level
+    uint32_t pending_num;
+    uint64_t cur;                       // next tick to process
+    uint64_t start_ns;
+    uint64_t tick_ns;
+    pthread_t owner;
+    int fd;
+    bool fd_armed;
+    util_tw_timer_t *volatile mailbox;  // timers cancelled by other threads, linked by cancel_next
+    util_timer_wheel_stats_t stats;
+};
+
+static __thread util_timer_wheel_t *g_util_timer_wheel;
+
+static inline bool util_timer_wheel_is_owner(util_timer_wheel_t *tw)
+{
+    return pthread_equal(tw->owner, pthread_self()) != 0;
+}
+
+static inline uint64_t util_timer_wheel_now_tick(util_timer_wheel_t *tw)
+{
+    return (get_timestamp_ns() - tw->start_ns) / tw->tick_ns;
+}
+
+static void util_tw_timer_link(util_timer_wheel_t *tw, util_tw_timer_t *timer)
+{
+    if (timer->expire < tw->cur) {
+        timer->expire = tw->cur;
+    }
+    uint64_t delta = timer->expire - tw->cur;
+    if (URPC_UNLIKELY(delta > UTIL_TIMER_WHEEL_MAX_TICKS)) {
+        delta = UTIL_TIMER_WHEEL_MAX_TICKS;
+        timer->expire = tw->cur + delta;
+    }
+
+    uint32_t level = 0;
+    while (level < UTIL_TIMER_WHEEL_LEVEL_NUM - 1 && delta >= (1ULL << (UTIL_TIMER_WHEEL_LEVEL_BITS * (level + 1)))) {
+        level++;
+    }
+    uint64_t idx = (timer->expire >> (UTIL_TIMER_WHEEL_LEVEL_BITS * level)) & UTIL_TIMER_WHEEL_LEVEL_MASK;
+    urpc_list_push_back(&tw->slots[level][idx], &timer->entry);
+    timer->level = level;
+    tw->level_num[level]++;
+    tw->pending_num++;
+}
+
+static void util_tw_timer_unlink(util_timer_wheel_t *tw, util_tw_timer_t *timer)
+{
+    urpc_list_remove(&timer->entry);
+    tw->level_num[timer->level]--;
+    tw->pending_num--;
+}
+
+static void util_timer_wheel_fd_arm(util_timer_wheel_t *tw, bool arm)
+{
+    struct itimerspec time_cfg = {0};
+    if (arm) {
+        time_cfg.it_value.tv_nsec = (long)tw->tick_ns;
+        time_cfg.it_interval.tv_nsec = (long)tw->tick_ns;
+    }
+    if (timerfd_settime(tw->fd, 0, &time_cfg, NULL) < 0) {
+        UTIL_LOG_WARN("set timer_fd failed, %s\n", strerror(errno));
+        return;
+    }
+    tw->fd_armed = arm;
+}
+
+// timers cancelled by other threads become idle here, detach them from tw as well when tw is being destroyed
+static void util_timer_wheel_mailbox_drain(util_timer_wheel_t *tw, bool detach)
+{
+    if (__atomic_load_n(&tw->mailbox, __ATOMIC_RELAXED) == NULL) {
+        return;
+    }
+
+    util_tw_timer_t *timer = __atomic_exchange_n(&tw->mailbox, NULL, __ATOMIC_ACQUIRE);
+    util_tw_timer_t *deferred = NULL;
+    while (timer != NULL) {
+        util_tw_timer_t *next = timer->cancel_next;
+        if (timer->state == UTIL_TW_TIMER_DEFERRED) {
+            // the mailbox is LIFO, cancels queued before follow in the list, call it once they are drained
+            timer->cancel_next = deferred;
+            deferred = timer;
+            timer = next;
+            continue;
+        }
+        if (detach) {
+            // before in_mailbox is cleared, an idle timer may be freed by its user after that
+            timer->tw = NULL;
+        }
+        // the timer may be queued again once in_mailbox is cleared, state is loaded after, pairs with cancel
+        __atomic_store_n(&timer->in_mailbox, 0, __ATOMIC_SEQ_CST);
+        // not canceling means the owner has added it again after the cancel
+        if (__atomic_load_n(&timer->state, __ATOMIC_SEQ_CST) == UTIL_TW_TIMER_CANCELING) {
+            if (urpc_list_is_in_list(&timer->entry)) {
+                util_tw_timer_unlink(tw, timer);
+            }
+            tw->stats.remote_cancelled++;
+            __atomic_store_n(&timer->state, UTIL_TW_TIMER_IDLE, __ATOMIC_RELEASE);
+        }
+        timer = next;
+    }
+
+    while (deferred != NULL) {
+        util_tw_timer_t *next = deferred->cancel_next;
+        deferred->func(deferred->args);
+        urpc_dbuf_free(deferred);
+        deferred = next;
+    }
+}
+
+// timers in the current slot of higher levels move down once the lower levels wrap
+static void util_timer_wheel_cascade(util_timer_wheel_t *tw)
+{
+    for (uint32_t level = 1; level < UTIL_TIMER_WHEEL_LEVEL_NUM; level++) {
+        uint64_t idx = (tw->cur >> (UTIL_TIMER_WHEEL_LEVEL_BITS * level)) & UTIL_TIMER_WHEEL_LEVEL_MASK;
+        urpc_list_t *slot = &tw->slots[level][idx];
+        while (!urpc_list_is_empty(slot)) {
+            util_tw_timer_t *timer;
+            INIT_CONTAINER_PTR(timer, slot->next, entry);
+            util_tw_timer_unlink(tw, timer);
+            util_tw_timer_link(tw, timer);
+            tw->stats.cascaded++;
+        }
+        if (idx != 0) {
+            break;
+        }
+    }
+}
+
+static uint32_t util_timer_wheel_expire(util_timer_wheel_t *tw)
+{
+    urpc_list_t *slot = &tw->slots[0][tw->cur & UTIL_TIMER_WHEEL_LEVEL_MASK];
+    uint64_t tick = tw->cur++;
+    if (urpc_list_is_empty(slot)) {
+        return 0;
+    }
+
+    // take the whole slot first, timers added by callbacks land in the slot for later rounds
+    urpc_list_t expired;
+    expired.next = slot->next;
+    expired.prev = slot->prev;
+    expired.next->prev = &expired;
+    expired.prev->next = &expired;
+    urpc_list_init(slot);
+
+    uint32_t fired = 0;
+    while (!urpc_list_is_empty(&expired)) {
+        util_tw_timer_t *timer;
+        INIT_CONTAINER_PTR(timer, expired.next, entry);
+        util_tw_timer_unlink(tw, timer);
+
+        bool periodic = timer->period != 0;
+        uint32_t state = UTIL_TW_TIMER_PENDING;
+        if (!__atomic_compare_exchange_n(&timer->state, &state,
+            periodic ? UTIL_TW_TIMER_RUNNING : UTIL_TW_TIMER_IDLE, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            // cancelled by other thread, becomes idle when mailbox is drained
+            continue;
+        }
+
+        tw->stats.expired++;
+        fired++;
+        timer->func(timer->args);
+        if (!periodic) {
+            continue;
+        }
+
+        // not running any more if cancelled or added again by callback
+        state = UTIL_TW_TIMER_RUNNING;
+        if (__atomic_compare_exchange_n(&timer->state, &state, UTIL_TW_TIMER_PENDING, false, __ATOMIC_ACQ_REL,
+            __ATOMIC_ACQUIRE)) {
+            timer->expire = tick + timer->period;
+            util_tw_timer_link(tw, timer);
+        }
+    }
+    return fired;
+}
+
+uint32_t util_timer_wheel_poll(util_timer_wheel_t *tw)
+{
+    util_timer_wheel_mailbox_drain(tw, false);
+
+    uint64_t target = util_timer_wheel_now_tick(tw);
+    uint32_t fired = 0;
+    while (tw->cur < target) {
+        if ((tw->cur & UTIL_TIMER_WHEEL_LEVEL_MASK) == 0) {
+            util_timer_wheel_cascade(tw);
+        }
+        if (tw->level_num[0] != 0) {
+            fired += util_timer_wheel_expire(tw);
+            continue;
+        }
+
+        // nothing expires before lowest level in use cascades, skip to there
+        uint32_t level = 1;
+        while (level < UTIL_TIMER_WHEEL_LEVEL_NUM && tw->level_num[level] == 0) {
+            level++;
+        }
+        uint64_t next = target;
+        if (level < UTIL_TIMER_WHEEL_LEVEL_NUM) {
+            next = (tw->cur | ((1ULL << (UTIL_TIMER_WHEEL_LEVEL_BITS * level)) - 1)) + 1;
+        }
+        tw->cur = next < target ? next : target;
+    }
+
+    if (tw->fd_armed && tw->pending_num == 0) {
+        util_timer_wheel_fd_arm(tw, false);
+    }
+    return fired;
+}
+
+util_timer_wheel_t *util_timer_wheel_create(uint32_t tick_us, uint32_t flags)
+{
+    if (tick_us < UTIL_TIMER_WHEEL_MIN_TICK_US || tick_us >= US_PER_SEC) {
+        UTIL_LOG_ERR("timer wheel tick %u us is out of range(%u ~ %u us)\n", tick_us, UTIL_TIMER_WHEEL_MIN_TICK_US,
+            US_PER_SEC - 1);
+        return NULL;
+    }
+
+    util_timer_wheel_t *tw = (util_timer_wheel_t *)urpc_dbuf_calloc(URPC_DBUF_TYPE_TIMEOUT, 1,
+        sizeof(util_timer_wheel_t));
+    if (tw == NULL) {
+        UTIL_LOG_ERR("calloc timer wheel failed\n");
+        return NULL;
+    }
+
+    for (uint32_t level = 0; level < UTIL_TIMER_WHEEL_LEVEL_NUM; level++) {
+        for (uint32_t slot = 0; slot < UTIL_TIMER_WHEEL_LEVEL_SIZE; slot++) {
+            urpc_list_init(&tw->slots[level][slot]);
+        }
+    }
+    tw->tick_ns = (uint64_t)tick_us * NS_PER_US;
+    tw->start_ns = get_timestamp_ns();
+    tw->owner = pthread_self();
+    tw->fd = -1;
+
+    if ((flags & UTIL_TIMER_WHEEL_FLAG_FD) != 0) {
+        tw->fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (tw->fd < 0) {
+            UTIL_LOG_ERR("create timer_fd failed, %s\n", strerror(errno));
+            urpc_dbuf_free(tw);
+            return NULL;
+        }
+    }
+
+    return tw;
+}
+
+void util_timer_wheel_destroy(util_timer_wheel_t *tw)
+{
+    if (tw == NULL) {
+        return;
+    }
+
+    util_timer_wheel_mailbox_drain(tw, true);
+    for (uint32_t level = 0; level < UTIL_TIMER_WHEEL_LEVEL_NUM; level++) {
+        for (uint32_t slot = 0; slot < UTIL_TIMER_WHEEL_LEVEL_SIZE; slot++) {
+            while (!urpc_list_is_empty(&tw->slots[level][slot])) {
+                util_tw_timer_t *timer;
+                INIT_CONTAINER_PTR(timer, tw->slots[level][slot].next, entry);
+                util_tw_timer_unlink(tw, timer);
+                // cancel or add after destroy must not touch tw
+                timer->tw = NULL;
+                __atomic_store_n(&timer->state, UTIL_TW_TIMER_IDLE, __ATOMIC_RELEASE);
+            }
+        }
+    }
+
+    if (tw->fd >= 0) {
+        (void)close(tw->fd);
+    }
+    if (g_util_timer_wheel == tw) {
+        g_util_timer_wheel = NULL;
+    }
+    urpc_dbuf_free(tw);
+}
+
+static void util_timer_wheel_thread_put(uint64_t id)
+{
+    util_timer_wheel_destroy((util_timer_wheel_t *)(uintptr_t)id);
+}
+
+util_timer_wheel_t *util_timer_wheel_thread_get(uint32_t tick_us, uint32_t flags)
+{
+    if (URPC_LIKELY(g_util_timer_wheel != NULL)) {
+        return g_util_timer_wheel;
+    }
+
+    util_timer_wheel_t *tw = util_timer_wheel_create(tick_us, flags);
+    if (tw == NULL) {
+        return NULL;
+    }
+    g_util_timer_wheel = tw;
+    urpc_thread_closure_register(THREAD_CLOSURE_TIMER_WHEEL, (uint64_t)(uintptr_t)tw, util_timer_wheel_thread_put);
+    return tw;
+}
+
+util_timer_wheel_t *util_timer_wheel_thread_peek(void)
+{
+    return g_util_timer_wheel;
+}
+
+void util_tw_timer_init(util_tw_timer_t *timer, void (*func)(void *args), void *args)
+{
+    memset(timer, 0, sizeof(util_tw_timer_t));
+    timer->func = func;
+    timer->args = args;
+}
+
+int util_tw_timer_add(util_timer_wheel_t *tw, util_tw_timer_t *timer, uint64_t timeout_us, bool periodic)
+{
+    if (URPC_UNLIKELY(tw == NULL || timer == NULL || timer->func == NULL || !util_timer_wheel_is_owner(tw))) {
+        UTIL_LOG_ERR("add timer failed: invalid timer or not added by owner of the wheel\n");
+        return URPC_FAIL;
+    }
+    if (URPC_UNLIKELY(timer->tw != NULL && timer->tw != tw && !util_tw_timer_is_idle(timer))) {
+        UTIL_LOG_ERR("add timer failed: timer is in use by other wheel\n");
+        return URPC_FAIL;
+    }
+
+    if (urpc_list_is_in_list(&timer->entry)) {
+        util_tw_timer_unlink(tw, timer);
+    }
+
+    uint64_t timeout_ns = timeout_us * NS_PER_US;
+    uint64_t ticks = (timeout_ns + tw->tick_ns - 1) / tw->tick_ns;
+    // tick t is processed once time reaches its end, take the first tick ending after the deadline
+    uint64_t deadline_ns = get_timestamp_ns() - tw->start_ns + timeout_ns;
+    uint64_t expire = (deadline_ns + tw->tick_ns - 1) / tw->tick_ns;
+    timer->expire = expire == 0 ? 0 : expire - 1;
+    timer->period = periodic ? (ticks == 0 ? 1 : ticks) : 0;
+    timer->tw = tw;
+    util_tw_timer_link(tw, timer);
+    __atomic_store_n(&timer->state, UTIL_TW_TIMER_PENDING, __ATOMIC_RELEASE);
+    tw->stats.added++;
+
+    if (tw->fd >= 0 && !tw->fd_armed) {
+        util_timer_wheel_fd_arm(tw, true);
+    }
+    return URPC_SUCCESS;
+}
+
+static void util_timer_wheel_mailbox_push(util_timer_wheel_t *tw, util_tw_timer_t *timer)
+{
+    util_tw_timer_t *head = __atomic_load_n(&tw->mailbox, __ATOMIC_RELAXED);
+    do {
+        timer->cancel_next = head;
+    } while (!__atomic_compare_exchange_n(&tw->mailbox, &head, timer, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static bool util_tw_timer_cancel_remote(util_tw_timer_t *timer)
+{
+    util_timer_wheel_t *tw = timer->tw;
+    uint32_t state = __atomic_load_n(&timer->state, __ATOMIC_ACQUIRE);
+    do {
+        if (state != UTIL_TW_TIMER_PENDING && state != UTIL_TW_TIMER_RUNNING) {
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&timer->state, &state, UTIL_TW_TIMER_CANCELING, false, __ATOMIC_SEQ_CST,
+        __ATOMIC_ACQUIRE));
+
+    // still in mailbox means owner has not drained it, and will see the state set above
+    if (__atomic_exchange_n(&timer->in_mailbox, 1, __ATOMIC_SEQ_CST) != 0) {
+        return true;
+    }
+    util_timer_wheel_mailbox_push(tw, timer);
+    return true;
+}
+
+bool util_tw_timer_cancel(util_tw_timer_t *timer)
+{
+    if (URPC_UNLIKELY(timer == NULL)) {
+        return false;
+    }
+
+    // an idle timer may still point to a wheel which has been destroyed, only a pending or running one is linked
+    uint32_t state = __atomic_load_n(&timer->state, __ATOMIC_ACQUIRE);
+    util_timer_wheel_t *tw = timer->tw;
+    if ((state != UTIL_TW_TIMER_PENDING && state != UTIL_TW_TIMER_RUNNING) || tw == NULL) {
+        return false;
+    }
+
+    if (!util_timer_wheel_is_owner(tw)) {
+        return util_tw_timer_cancel_remote(timer);
+    }
+
+    // only other threads change state concurrently, from pending or running to canceling
+    if (!__atomic_compare_exchange_n(&timer->state, &state, UTIL_TW_TIMER_IDLE, false, __ATOMIC_ACQ_REL,
+        __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    if (urpc_list_is_in_list(&timer->entry)) {
+        util_tw_timer_unlink(tw, timer);
+    }
+    tw->stats.cancelled++;
+    return true;
+}
+
+util_timer_wheel_t *util_tw_timer_cancel_wheel(util_tw_timer_t *timer)
+{
+    while (!util_tw_timer_is_idle(timer)) {
+        util_timer_wheel_t *tw = __atomic_load_n(&timer->tw, __ATOMIC_ACQUIRE);
+        if (tw != NULL) {
+            return tw;
+        }
+        // detached by destroy of its wheel, which sets it idle right after
+        (void)sched_yield();
+    }
+    return NULL;
+}
+
+int util_timer_wheel_defer(util_timer_wheel_t *tw, void (*func)(void *args), void *args)
+{
+    util_tw_timer_t *work = (util_tw_timer_t *)urpc_dbuf_calloc(URPC_DBUF_TYPE_TIMEOUT, 1, sizeof(util_tw_timer_t));
+    if (work == NULL) {
+        UTIL_LOG_ERR("calloc timer wheel deferred work failed\n");
+        return URPC_FAIL;
+    }
+    work->func = func;
+    work->args = args;
+    work->state = UTIL_TW_TIMER_DEFERRED;
+    util_timer_wheel_mailbox_push(tw, work);
+    return URPC_SUCCESS;
+}
+
+int util_timer_wheel_fd_get(util_timer_wheel_t *tw)
+{
+    return tw->fd;
+}
+
+uint32_t util_timer_wheel_fd_process(util_timer_wheel_t *tw)
+{
+    uint64_t expirations = 0;
+    if (read(tw->fd, &expirations, sizeof(uint64_t)) != sizeof(uint64_t) && errno != EAGAIN) {
+        UTIL_LOG_WARN("timer_fd readable event failed, %s\n", strerror(errno));
+    }
+    return util_timer_wheel_poll(tw);
+}
+
+uint32_t util_timer_wheel_pending_num(util_timer_wheel_t *tw)
+{
+    return tw->pending_num;
+}
+
+void util_timer_wheel_stats_get(util_timer_wheel_t *tw, util_timer_wheel_stats_t *stats)
+{
+    *stats = tw->stats;
+}
@@ -0,0 +1,128 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util per thread hierarchical timing wheel
+ * Create: 2026-01-14
+ */
+
+#ifndef UTIL_TIMER_WHEEL_H
+#define UTIL_TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "urpc_list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* a timing wheel is owned by the thread which created it, and is driven by that thread only, either by calling
+ * util_timer_wheel_poll from its poll loop, or by util_timer_wheel_fd_process when the fd of the wheel is readable
+ * in its epoll loop. no lock is taken: timers are added and cancelled by the owner in O(1), other threads cancel
+ * through a lock free mailbox which the owner drains on its next poll.
+ * levels are 8 bits each, a timer is put in level n when it expires in [256^n, 256^(n+1)) ticks and cascades to
+ * a lower level when the lower levels wrap, so 4 levels cover 2^32 ticks, 59 hours with a 50us tick */
+
+#define UTIL_TIMER_WHEEL_LEVEL_NUM (4)
+#define UTIL_TIMER_WHEEL_LEVEL_BITS (8)
+#define UTIL_TIMER_WHEEL_LEVEL_SIZE (1u << UTIL_TIMER_WHEEL_LEVEL_BITS)
+#define UTIL_TIMER_WHEEL_LEVEL_MASK (UTIL_TIMER_WHEEL_LEVEL_SIZE - 1)
+#define UTIL_TIMER_WHEEL_MAX_TICKS ((1ULL << (UTIL_TIMER_WHEEL_LEVEL_BITS * UTIL_TIMER_WHEEL_LEVEL_NUM)) - 1)
+
+#define UTIL_TIMER_WHEEL_MIN_TICK_US (50)
+#define UTIL_TIMER_WHEEL_DEFAULT_TICK_US (100)
+
+#define UTIL_TIMER_WHEEL_FLAG_FD (1u)      // create a timerfd, readable every tick while any timer is pending
+
+typedef enum util_tw_timer_state {
+    UTIL_TW_TIMER_IDLE,
+    UTIL_TW_TIMER_PENDING,
+    UTIL_TW_TIMER_RUNNING,          // callback of a periodic timer is running
+    UTIL_TW_TIMER_CANCELING,        // cancelled by other thread, still linked until owner drains the mailbox
+    UTIL_TW_TIMER_DEFERRED,         // not a user timer, queued by util_timer_wheel_defer to call func on owner
+} util_tw_timer_state_t;
+
+struct util_timer_wheel;
+typedef struct util_timer_wheel util_timer_wheel_t;
+
+// embedded in its user, memory must stay valid until the timer is idle
+typedef struct util_tw_timer {
+    urpc_list_t entry;
+    util_timer_wheel_t *tw;
+    struct util_tw_timer *cancel_next;  // link in mailbox of tw
+    void (*func)(void *args);
+    void *args;
+    uint64_t expire;                // in ticks of tw
+    uint64_t period;                // in ticks, 0 for one shot timer
+    uint32_t level;                 // level of tw the timer is linked in
+    volatile uint32_t state;
+    volatile uint32_t in_mailbox;
+} util_tw_timer_t;
+
+typedef struct util_timer_wheel_stats {
+    uint64_t added;
+    uint64_t expired;
+    uint64_t cancelled;
+    uint64_t remote_cancelled;
+    uint64_t cascaded;
+} util_timer_wheel_stats_t;
+
+// tick_us not less than UTIL_TIMER_WHEEL_MIN_TICK_US, the calling thread becomes the owner
+util_timer_wheel_t *util_timer_wheel_create(uint32_t tick_us, uint32_t flags);
+// owner only, pending timers are dropped without callback, become idle and are detached from tw
+void util_timer_wheel_destroy(util_timer_wheel_t *tw);
+
+// wheel of calling thread, created on first call and destroyed at thread exit, args only matter on first call
+util_timer_wheel_t *util_timer_wheel_thread_get(uint32_t tick_us, uint32_t flags);
+// wheel of calling thread, NULL if it has not been created
+util_timer_wheel_t *util_timer_wheel_thread_peek(void);
+
+void util_tw_timer_init(util_tw_timer_t *timer, void (*func)(void *args), void *args);
+
+/**
+ * Owner only. Start timer on tw, restart it if it is pending already. A one shot timer is idle before its callback
+ * is called, so the callback may free it or add it again; a periodic timer must not be freed in its callback.
+ * timeout_us is rounded up to ticks, and clamped to UTIL_TIMER_WHEEL_MAX_TICKS.
+ */
+int util_tw_timer_add(util_timer_wheel_t *tw, util_tw_timer_t *timer, uint64_t timeout_us, bool periodic);
+
+/**
+ * Any thread. Return true if the callback will not be called any more because of this cancel, false if the
+ * timer is idle, already fired or cancelled. Cancel from the owner unlinks at once; from other threads the timer
+ * is queued to mailbox of its owner, and must stay valid until util_tw_timer_is_idle.
+ */
+bool util_tw_timer_cancel(util_tw_timer_t *timer);
+
+static inline bool util_tw_timer_is_idle(const util_tw_timer_t *timer)
+{
+    return __atomic_load_n(&timer->state, __ATOMIC_ACQUIRE) == UTIL_TW_TIMER_IDLE &&
+        __atomic_load_n(&timer->in_mailbox, __ATOMIC_ACQUIRE) == 0;
+}
+
+// any thread, wheel which has still to drain the cancel of a cancelled timer, NULL once the timer is idle
+util_timer_wheel_t *util_tw_timer_cancel_wheel(util_tw_timer_t *timer);
+
+/**
+ * Any thread. Call func(args) on the owner of tw after it has drained every cancel queued to its mailbox before
+ * this call, from its next poll or from destroy, so memory of timers cancelled by other threads is freed there.
+ * Return URPC_FAIL if out of memory.
+ */
+int util_timer_wheel_defer(util_timer_wheel_t *tw, void (*func)(void *args), void *args);
+
+// owner only, drain mailbox and expire timers up to now, return the number of callbacks called
+uint32_t util_timer_wheel_poll(util_timer_wheel_t *tw);
+
+// timerfd of the wheel for owner epoll loop, -1 if not created with UTIL_TIMER_WHEEL_FLAG_FD
+int util_timer_wheel_fd_get(util_timer_wheel_t *tw);
+// owner only, read fd of the wheel when it is readable, then poll
+uint32_t util_timer_wheel_fd_process(util_timer_wheel_t *tw);
+
+uint32_t util_timer_wheel_pending_num(util_timer_wheel_t *tw);
+void util_timer_wheel_stats_get(util_timer_wheel_t *tw, util_timer_wheel_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -8,6 +8,7 @@
 #include "gtest/gtest.h"
 #include "mockcpp/mockcpp.hpp"
 #include <sys/eventfd.h>
+#include <thread>
 #include "urma_api.h"
 #include "urpc_framework_api.h"
 #include "urpc_framework_types.h"
@@ -156,6 +157,63 @@ TEST_F(ChannelTest, channel_alloc_test) {
     ASSERT_EQ(result, URPC_SUCCESS);
 }
 
+TEST_F(ChannelTest, req_entry_tw_timer_test) {
+    urpc_channel_info_t *channel = channel_alloc();
+    ASSERT_NE(channel, nullptr);
+    util_timer_wheel_t *tw = util_timer_wheel_thread_get(UTIL_TIMER_WHEEL_MIN_TICK_US, 0);
+    ASSERT_NE(tw, nullptr);
+
+    // put cancels the timeout of the request on the wheel of its thread
+    req_entry_t *entry = req_entry_get(channel, NULL);
+    ASSERT_NE(entry, nullptr);
+    entry->local_chid = channel->id;
+    ASSERT_EQ(util_tw_timer_add(tw, &entry->tw_timer, US_PER_SEC, false), URPC_SUCCESS);
+    entry->tw_armed = URPC_TRUE;
+    EXPECT_FALSE(is_req_entry_tw_timeout(entry));
+    req_entry_put(entry);
+    EXPECT_TRUE(util_tw_timer_is_idle(&entry->tw_timer));
+    EXPECT_EQ(util_timer_wheel_pending_num(tw), 0U);
+
+    // the request is put by its timeout callback when the wheel is polled
+    entry = req_entry_get(channel, NULL);
+    ASSERT_NE(entry, nullptr);
+    entry->local_chid = channel->id;
+    ASSERT_EQ(util_tw_timer_add(tw, &entry->tw_timer, UTIL_TIMER_WHEEL_MIN_TICK_US, false), URPC_SUCCESS);
+    entry->tw_armed = URPC_TRUE;
+    uint64_t end_ns = get_timestamp_ns() + NS_PER_MS;
+    while (get_timestamp_ns() < end_ns) {
+        (void)util_timer_wheel_poll(tw);
+    }
+    (void)util_timer_wheel_poll(tw);
+    EXPECT_EQ(entry->valid, 0);
+    EXPECT_EQ(entry->tw_armed, URPC_FALSE);
+
+    // put by other thread cancels through the mailbox, the timer is idle once the wheel is polled
+    entry = req_entry_get(channel, NULL);
+    ASSERT_NE(entry, nullptr);
+    entry->local_chid = channel->id;
+    ASSERT_EQ(util_tw_timer_add(tw, &entry->tw_timer, US_PER_SEC, false), URPC_SUCCESS);
+    entry->tw_armed = URPC_TRUE;
+    std::thread t([&]() { req_entry_put(entry); });
+    t.join();
+    EXPECT_FALSE(util_tw_timer_is_idle(&entry->tw_timer));
+    (void)util_timer_wheel_poll(tw);
+    EXPECT_TRUE(util_tw_timer_is_idle(&entry->tw_timer));
+
+    // free by other thread hands the table to the wheel, which frees it once the cancel is drained
+    entry = req_entry_get(channel, NULL);
+    ASSERT_NE(entry, nullptr);
+    entry->local_chid = channel->id;
+    ASSERT_EQ(util_tw_timer_add(tw, &entry->tw_timer, US_PER_SEC, false), URPC_SUCCESS);
+    entry->tw_armed = URPC_TRUE;
+    uint32_t chid = channel->id;
+    std::thread freer([&]() { EXPECT_EQ(channel_free(chid), URPC_SUCCESS); });
+    freer.join();
+    EXPECT_FALSE(util_tw_timer_is_idle(&entry->tw_timer));
+    (void)util_timer_wheel_poll(tw);
+    EXPECT_EQ(util_timer_wheel_pending_num(tw), 0U);
+}
+
 TEST_F(ChannelTest, channel_free_test_with_invalid_channel_id) {
     // 创建一个无效的通道ID
     uint32_t chid = 1;
@@ -0,0 +1,222 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: urpc channel queue select policy test
+ */
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "urpc_dbuf_stat.h"
+#include "urpc_framework_types.h"
+#include "util_epoch.h"
+#include "channel.h"
+
+#define TEST_SELECT_QUEUE_NUM 4
+#define TEST_SELECT_ROUND 4000
+
+class ChannelQueueSelectTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        channel = (urpc_channel_info_t *)calloc(1, sizeof(urpc_channel_info_t));
+        ASSERT_NE(channel, nullptr);
+        URPC_SLIST_INIT(&channel->r_queue_nodes_head);
+        URPC_SLIST_INIT(&channel->l_queue_nodes_head);
+        for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM; i++) {
+            queue[i].status = QUEUE_STATUS_READY;
+            node[i].urpc_qh = (uint64_t)(uintptr_t)&queue[i];
+            Add(i);
+        }
+    }
+
+    void TearDown() override
+    {
+        URPC_SLIST_INIT(&channel->r_queue_nodes_head);
+        channel_queue_snapshot_update(channel, true);
+        util_epoch_synchronize();
+        urpc_dbuf_free(channel->r_selector.snapshot);
+        free(channel);
+    }
+
+    void Add(uint32_t i)
+    {
+        URPC_SLIST_INSERT_HEAD(&channel->r_queue_nodes_head, &node[i], node);
+        channel_queue_snapshot_update(channel, true);
+    }
+
+    void Remove(uint32_t i)
+    {
+        URPC_SLIST_REMOVE(&channel->r_queue_nodes_head, &node[i], queue_node, node);
+        channel_queue_snapshot_update(channel, true);
+    }
+
+    uint32_t Index(queue_t *q)
+    {
+        return (uint32_t)(q - &queue[0]);
+    }
+
+    uint32_t SlotOf(uint32_t i)
+    {
+        channel_queue_snapshot_t *snapshot = channel->r_selector.snapshot;
+        for (uint32_t j = 0; j < snapshot->num; j++) {
+            if (snapshot->entry[j].queue == &queue[i]) {
+                return snapshot->entry[j].slot;
+            }
+        }
+        return CHANNEL_QUEUE_SLOT_INVALID;
+    }
+
+    urpc_channel_info_t *channel = nullptr;
+    queue_t queue[TEST_SELECT_QUEUE_NUM] = {};
+    queue_node_t node[TEST_SELECT_QUEUE_NUM] = {};
+};
+
+TEST_F(ChannelQueueSelectTest, TestRoundRobinSkipNotReady)
+{
+    uint32_t count[TEST_SELECT_QUEUE_NUM] = {0};
+    uint32_t slot;
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM * 10; i++) {
+        queue_t *q = channel_get_next_remote_queue(channel, &slot);
+        ASSERT_NE(q, nullptr);
+        // load is not counted under round robin
+        EXPECT_EQ(slot, (uint32_t)CHANNEL_QUEUE_SLOT_INVALID);
+        count[Index(q)]++;
+    }
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM; i++) {
+        EXPECT_EQ(count[i], 10U);
+    }
+
+    queue[1].status = QUEUE_STATUS_ERR;
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM * 10; i++) {
+        EXPECT_NE(Index(channel_get_next_remote_queue(channel, &slot)), 1U);
+    }
+
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM; i++) {
+        queue[i].status = QUEUE_STATUS_ERR;
+    }
+    EXPECT_EQ(channel_get_next_remote_queue(channel, &slot), nullptr);
+    EXPECT_EQ(channel_get_next_local_queue(channel, &slot), nullptr);
+}
+
+TEST_F(ChannelQueueSelectTest, TestSlotKeptAndReused)
+{
+    uint32_t slot[TEST_SELECT_QUEUE_NUM];
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM; i++) {
+        slot[i] = SlotOf(i);
+        EXPECT_EQ(slot[i], i);
+    }
+
+    // other queues keep their slots, so that loads counted before stay with them
+    Remove(1);
+    EXPECT_EQ(channel->r_selector.snapshot->num, (uint32_t)TEST_SELECT_QUEUE_NUM - 1);
+    EXPECT_EQ(SlotOf(1), (uint32_t)CHANNEL_QUEUE_SLOT_INVALID);
+    EXPECT_EQ(SlotOf(0), slot[0]);
+    EXPECT_EQ(SlotOf(2), slot[2]);
+    EXPECT_EQ(SlotOf(3), slot[3]);
+
+    // slot of removed queue is taken by the next added one
+    Add(1);
+    EXPECT_EQ(SlotOf(1), slot[1]);
+}
+
+TEST_F(ChannelQueueSelectTest, TestLeastLoad)
+{
+    channel->queue_select = URPC_QUEUE_SELECT_LEAST_LOAD;
+    uint32_t slot;
+    // ties are broken in round robin
+    uint32_t count[TEST_SELECT_QUEUE_NUM] = {0};
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM; i++) {
+        queue_t *q = channel_get_next_remote_queue(channel, &slot);
+        ASSERT_NE(q, nullptr);
+        EXPECT_EQ(slot, SlotOf(Index(q)));
+        count[Index(q)]++;
+    }
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM; i++) {
+        EXPECT_EQ(count[i], 1U);
+    }
+
+    // requests stay on queue 2 only, others get them all
+    channel_queue_load_add(&channel->r_selector, SlotOf(2));
+    for (uint32_t i = 0; i < TEST_SELECT_ROUND; i++) {
+        queue_t *q = channel_get_next_remote_queue(channel, &slot);
+        EXPECT_NE(Index(q), 2U);
+        channel_queue_load_add(&channel->r_selector, slot);
+        channel_queue_load_sub(&channel->r_selector, slot);
+    }
+
+    // outstanding requests pile up evenly
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM * 10 - 1; i++) {
+        (void)channel_get_next_remote_queue(channel, &slot);
+        channel_queue_load_add(&channel->r_selector, slot);
+    }
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM; i++) {
+        EXPECT_EQ(channel->r_selector.load[SlotOf(i)], 10U);
+    }
+}
+
+TEST_F(ChannelQueueSelectTest, TestPowerOfTwoChoices)
+{
+    channel->queue_select = URPC_QUEUE_SELECT_P2C;
+    // the most loaded queue loses every comparison
+    channel_queue_load_add(&channel->r_selector, SlotOf(3));
+    uint32_t count[TEST_SELECT_QUEUE_NUM] = {0};
+    uint32_t slot;
+    for (uint32_t i = 0; i < TEST_SELECT_ROUND; i++) {
+        queue_t *q = channel_get_next_remote_queue(channel, &slot);
+        ASSERT_NE(q, nullptr);
+        EXPECT_EQ(slot, SlotOf(Index(q)));
+        count[Index(q)]++;
+    }
+    EXPECT_EQ(count[3], 0U);
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM - 1; i++) {
+        EXPECT_GT(count[i], (uint32_t)TEST_SELECT_ROUND / TEST_SELECT_QUEUE_NUM);
+    }
+
+    // a queue not ready is never chosen even if it is idle
+    queue[0].status = QUEUE_STATUS_ERR;
+    for (uint32_t i = 0; i < TEST_SELECT_ROUND; i++) {
+        queue_t *q = channel_get_next_remote_queue(channel, &slot);
+        ASSERT_NE(q, nullptr);
+        EXPECT_NE(Index(q), 0U);
+    }
+
+    // single queue
+    for (uint32_t i = 0; i < TEST_SELECT_QUEUE_NUM - 1; i++) {
+        Remove(i);
+    }
+    EXPECT_EQ(Index(channel_get_next_remote_queue(channel, &slot)), 3U);
+}
+
+// callers keep selecting while queues are removed and added again, a retired snapshot must stay intact
+TEST_F(ChannelQueueSelectTest, TestSelectDuringUpdate)
+{
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> done(0);
+    std::vector<std::thread> callers;
+    for (uint32_t t = 0; t < 3; t++) {
+        callers.emplace_back([&]() {
+            uint32_t slot;
+            while (!stop.load()) {
+                queue_t *q = channel_get_next_remote_queue(channel, &slot);
+                ASSERT_NE(q, nullptr);
+                ASSERT_LT(Index(q), (uint32_t)TEST_SELECT_QUEUE_NUM);
+                done++;
+            }
+        });
+    }
+
+    // queue 0 stays, callers always find a queue
+    for (uint32_t round = 0; round < 2000 || done.load() < TEST_SELECT_ROUND; round++) {
+        uint32_t i = 1 + round % (TEST_SELECT_QUEUE_NUM - 1);
+        channel->queue_select = (urpc_queue_select_policy_t)(round % URPC_QUEUE_SELECT_MAX);
+        Remove(i);
+        Add(i);
+    }
+    stop = true;
+    for (auto &t : callers) {
+        t.join();
+    }
+    EXPECT_GT(done.load(), 0U);
+}
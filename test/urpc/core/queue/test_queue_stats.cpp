@@ -0,0 +1,203 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: urpc queue stats test, per thread counters and their cost against shared counters
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "queue.h"
+#include "urpc_util.h"
+
+#define TEST_QUEUE_STATS_THREAD_NUM 4
+#define TEST_QUEUE_STATS_LOOP_NUM 1000000
+#define TEST_QUEUE_STATS_SGE_NUM 2
+#define TEST_QUEUE_STATS_BYTES 512
+
+// layout before per thread counters: all threads add to counters inline in the queue, next to hot fields
+typedef struct test_legacy_queue {
+    volatile uint16_t tx_wr_cnt;
+    volatile uint64_t stats[STATS_TYPE_MAX];
+    volatile uint64_t error_stats[ERR_STATS_TYPE_MAX];
+} test_legacy_queue_t;
+
+static void test_legacy_sge_stats_record(test_legacy_queue_t *q, urpc_stats_type_t type, uint32_t sge_num,
+    uint32_t completion_len)
+{
+    (void)__sync_add_and_fetch(&q->stats[type], 1);
+    (void)__sync_add_and_fetch(&q->stats[type + QUEUE_STATS_TYPE_SGE_OFFSET], sge_num);
+    (void)__sync_add_and_fetch(&q->stats[type + QUEUE_STATS_TYPE_BYTES_OFFSET], completion_len);
+}
+
+class QueueStatsTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        local_q = (queue_local_t *)calloc(1, sizeof(queue_local_t));
+        ASSERT_NE(local_q, nullptr);
+        ASSERT_EQ(queue_stats_init(local_q), 0);
+    }
+
+    void TearDown() override
+    {
+        queue_stats_uninit(local_q);
+        free(local_q);
+    }
+
+    uint64_t Stats(urpc_stats_type_t type)
+    {
+        uint64_t stats[STATS_TYPE_MAX];
+        queue_stats_get(&local_q->queue, stats, STATS_TYPE_MAX);
+        return stats[type];
+    }
+
+    queue_local_t *local_q = nullptr;
+};
+
+// run func on thread_num threads at once, return ns of the slowest one
+template <typename F> static uint64_t TestRunThreads(uint32_t thread_num, F func)
+{
+    std::atomic<uint32_t> ready(0);
+    std::atomic<bool> start(false);
+    std::vector<uint64_t> cost(thread_num, 0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&, i]() {
+            ready++;
+            while (!start.load()) {
+            }
+            uint64_t begin = get_timestamp_ns();
+            func(i);
+            cost[i] = get_timestamp_ns() - begin;
+        });
+    }
+    while (ready.load() != thread_num) {
+    }
+    start.store(true);
+
+    uint64_t max_cost = 0;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads[i].join();
+        max_cost = cost[i] > max_cost ? cost[i] : max_cost;
+    }
+    return max_cost;
+}
+
+TEST_F(QueueStatsTest, TestAggregateAcrossThreads)
+{
+    (void)TestRunThreads(TEST_QUEUE_STATS_THREAD_NUM, [this](uint32_t) {
+        for (uint32_t j = 0; j < 1000; j++) {
+            queue_sge_stats_record(&local_q->queue, STATS_TYPE_REQUEST_SEND, TEST_QUEUE_STATS_SGE_NUM,
+                TEST_QUEUE_STATS_BYTES);
+            queue_error_stats_record(&local_q->queue, ERR_STATS_TYPE_POST);
+        }
+    });
+
+    EXPECT_EQ(Stats(STATS_TYPE_REQUEST_SEND), 1000U * TEST_QUEUE_STATS_THREAD_NUM);
+    EXPECT_EQ(Stats(STATS_TYPE_REQUEST_SGES_SEND), 1000U * TEST_QUEUE_STATS_THREAD_NUM * TEST_QUEUE_STATS_SGE_NUM);
+    EXPECT_EQ(Stats(STATS_TYPE_REQUEST_BYTES_SEND), 1000U * TEST_QUEUE_STATS_THREAD_NUM * TEST_QUEUE_STATS_BYTES);
+    uint64_t error_stats[ERR_STATS_TYPE_MAX];
+    queue_error_stats_get(&local_q->queue, error_stats, ERR_STATS_TYPE_MAX);
+    EXPECT_EQ(error_stats[ERR_STATS_TYPE_POST], 1000U * TEST_QUEUE_STATS_THREAD_NUM);
+
+    // threads got blocks of their own aligned to cache line, a slot may be reused once its thread exited
+    uint32_t block_num = 0;
+    for (uint32_t slot = 0; slot < QUEUE_STATS_SLOT_NUM; slot++) {
+        if (local_q->stats_block[slot] != nullptr) {
+            block_num++;
+            EXPECT_EQ((uintptr_t)local_q->stats_block[slot] % QUEUE_STATS_ALIGN, 0U);
+        }
+    }
+    EXPECT_GT(block_num, 1U);
+    EXPECT_LE(block_num, TEST_QUEUE_STATS_THREAD_NUM + 1U);
+}
+
+TEST_F(QueueStatsTest, TestSlotReusedAfterThreadExit)
+{
+    // threads one after another, the slot of an exited thread is taken by the next one and counts are kept
+    for (int i = 0; i < 8; i++) {
+        std::thread t([this]() { queue_stats_record(&local_q->queue, STATS_TYPE_ACK_SEND); });
+        t.join();
+    }
+
+    EXPECT_EQ(Stats(STATS_TYPE_ACK_SEND), 8U);
+    uint32_t block_num = 0;
+    for (uint32_t slot = 0; slot < QUEUE_STATS_SLOT_NUM; slot++) {
+        block_num += local_q->stats_block[slot] != nullptr ? 1 : 0;
+    }
+    EXPECT_EQ(block_num, 2U);
+}
+
+TEST_F(QueueStatsTest, TestSlotsUsedUp)
+{
+    // more threads alive at once than slots, the ones left over share slot 0
+    const uint32_t thread_num = QUEUE_STATS_SLOT_NUM + 8;
+    std::mutex lock;
+    std::condition_variable cond;
+    uint32_t recorded = 0;
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&]() {
+            queue_stats_record(&local_q->queue, STATS_TYPE_READ);
+            std::unique_lock<std::mutex> guard(lock);
+            recorded++;
+            cond.notify_all();
+            cond.wait(guard, [&]() { return recorded == thread_num; });
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(Stats(STATS_TYPE_READ), (uint64_t)thread_num);
+    EXPECT_GT(local_q->stats_block[QUEUE_STATS_SLOT_SHARED]->stats[STATS_TYPE_READ], 0U);
+}
+
+// the cost of one record on the poll and post paths, with all threads recording the same queue
+TEST_F(QueueStatsTest, TestRecordCostBench)
+{
+    test_legacy_queue_t *legacy = (test_legacy_queue_t *)calloc(1, sizeof(test_legacy_queue_t));
+    ASSERT_NE(legacy, nullptr);
+    uint32_t hw_threads = std::thread::hardware_concurrency();
+    uint32_t thread_num = hw_threads < TEST_QUEUE_STATS_THREAD_NUM ? TEST_QUEUE_STATS_THREAD_NUM : hw_threads;
+    thread_num = thread_num > TEST_QUEUE_STATS_THREAD_NUM * 2 ? TEST_QUEUE_STATS_THREAD_NUM * 2 : thread_num;
+
+    uint64_t legacy_ns = TestRunThreads(thread_num, [legacy](uint32_t i) {
+        for (uint32_t j = 0; j < TEST_QUEUE_STATS_LOOP_NUM; j++) {
+            // half of threads post and touch the hot field, the others poll
+            if ((i & 1) == 0) {
+                legacy->tx_wr_cnt++;
+                test_legacy_sge_stats_record(legacy, STATS_TYPE_REQUEST_SEND, TEST_QUEUE_STATS_SGE_NUM,
+                    TEST_QUEUE_STATS_BYTES);
+            } else {
+                test_legacy_sge_stats_record(legacy, STATS_TYPE_REQUEST_RECEIVE, TEST_QUEUE_STATS_SGE_NUM,
+                    TEST_QUEUE_STATS_BYTES);
+            }
+        }
+    });
+
+    uint64_t per_thread_ns = TestRunThreads(thread_num, [this](uint32_t i) {
+        for (uint32_t j = 0; j < TEST_QUEUE_STATS_LOOP_NUM; j++) {
+            if ((i & 1) == 0) {
+                local_q->tx_wr_cnt++;
+                queue_sge_stats_record(&local_q->queue, STATS_TYPE_REQUEST_SEND, TEST_QUEUE_STATS_SGE_NUM,
+                    TEST_QUEUE_STATS_BYTES);
+            } else {
+                queue_sge_stats_record(&local_q->queue, STATS_TYPE_REQUEST_RECEIVE, TEST_QUEUE_STATS_SGE_NUM,
+                    TEST_QUEUE_STATS_BYTES);
+            }
+        }
+    });
+
+    printf("%u threads, shared inline counters: %.2f ns/record, per thread counters: %.2f ns/record\n", thread_num,
+        (double)legacy_ns / TEST_QUEUE_STATS_LOOP_NUM, (double)per_thread_ns / TEST_QUEUE_STATS_LOOP_NUM);
+    uint64_t total = (uint64_t)TEST_QUEUE_STATS_LOOP_NUM * thread_num;
+    EXPECT_EQ(Stats(STATS_TYPE_REQUEST_SEND) + Stats(STATS_TYPE_REQUEST_RECEIVE), total);
+    EXPECT_EQ(legacy->stats[STATS_TYPE_REQUEST_SEND] + legacy->stats[STATS_TYPE_REQUEST_RECEIVE], total);
+    free(legacy);
+}
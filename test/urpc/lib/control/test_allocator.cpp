@@ -129,8 +129,10 @@ TEST_F(UT_Alloc, DefaultAllocTest) {
     uint64_t total_size = 2048;
     int ret = allocator->get(&sge, &num, total_size, NULL);
     ASSERT_EQ(ret, URPC_SUCCESS);
-    ASSERT_EQ(num, (uint32_t)16);
+    // 16 adjacent buffers of a fresh allocator are merged into one sge
+    ASSERT_EQ(num, (uint32_t)1);
     ASSERT_NE(sge, nullptr);
+    ASSERT_EQ(sge[0].length, (uint32_t)total_size);
     ret = allocator->put(sge, num, NULL);
     ASSERT_EQ(ret, URPC_SUCCESS);
 
@@ -152,4 +154,47 @@ TEST_F(UT_Alloc, DefaultAllocTest) {
     ASSERT_EQ(ret, URPC_SUCCESS);
 
     urpc_default_allocator_uninit();
-}
\ No newline at end of file
+}
+TEST_F(UT_Alloc, DefaultAllocRunsTest) {
+    MOCKER(urpc_mem_seg_register).stubs().will(returnValue((uint64_t)1));
+    MOCKER(urpc_mem_seg_unregister).stubs().will(returnValue(0));
+
+    default_allocator_cfg_t cfg = {
+        .need_large_sge = true,
+        .large_sge_size = DEFAULT_LARGE_SGE_MAX_SIZE,
+    };
+    ASSERT_EQ(urpc_default_allocator_init(&cfg), URPC_SUCCESS);
+    urpc_allocator_t *allocator = default_allocator_get();
+    urpc_allocator_option_t opt = {.qcustom_flag = QALLOCA_LARGE_SIZE_FLAG};
+    urpc_sge_t *sge[3];
+    uint32_t num[3];
+
+    // more buffers than a head holds, adjacent buffers still fit in one sge
+    ASSERT_EQ(allocator->get(&sge[0], &num[0], 1UL << 20, &opt), URPC_SUCCESS);
+    ASSERT_EQ(num[0], (uint32_t)1);
+    ASSERT_EQ(sge[0][0].length, (uint32_t)(1UL << 20));
+
+    // a hole in the middle of free buffers splits the next request into two sges
+    ASSERT_EQ(allocator->get(&sge[1], &num[1], DEFAULT_LARGE_SGE_MAX_SIZE * 4, &opt), URPC_SUCCESS);
+    ASSERT_EQ(allocator->get(&sge[2], &num[2], DEFAULT_LARGE_SGE_MAX_SIZE, &opt), URPC_SUCCESS);
+    ASSERT_EQ(allocator->put(sge[0], num[0], &opt), URPC_SUCCESS);
+    ASSERT_EQ(allocator->put(sge[1], num[1], &opt), URPC_SUCCESS);
+    ASSERT_EQ(allocator->get(&sge[0], &num[0], (1UL << 20) + DEFAULT_LARGE_SGE_MAX_SIZE * 4, &opt), URPC_SUCCESS);
+    ASSERT_EQ(num[0], (uint32_t)2);
+    ASSERT_EQ(sge[0][0].length + sge[0][1].length, (uint32_t)((1UL << 20) + DEFAULT_LARGE_SGE_MAX_SIZE * 4));
+
+    // sge length changed by user, all merged buffers are returned
+    sge[0][0].length = 1;
+    sge[0][1].length = 1;
+    ASSERT_EQ(allocator->put(sge[0], num[0], &opt), URPC_SUCCESS);
+    ASSERT_EQ(allocator->put(sge[2], num[2], &opt), URPC_SUCCESS);
+    ASSERT_EQ(allocator->get(&sge[0], &num[0], (uint64_t)DEFAULT_LARGE_SGE_MAX_SIZE * DEFAULT_LARGE_SGE_NUM, &opt),
+        URPC_SUCCESS);
+    ASSERT_EQ(allocator->put(sge[0], num[0], &opt), URPC_SUCCESS);
+
+    // more than slab holds
+    ASSERT_NE(allocator->get(&sge[0], &num[0], (uint64_t)DEFAULT_LARGE_SGE_MAX_SIZE * (DEFAULT_LARGE_SGE_NUM + 1),
+        &opt), URPC_SUCCESS);
+
+    urpc_default_allocator_uninit();
+}
@@ -4,6 +4,10 @@
  * Description: urpc crypto test
  */
 
+#include <set>
+#include <thread>
+#include <vector>
+
 #include "mockcpp/mockcpp.hpp"
 #include "gtest/gtest.h"
 
@@ -278,3 +282,157 @@ TEST_F(crypto_test, keepalive_encrypt_with_input_msg_test)
 
     crypto_cipher_uninit(&cipher_opt);
 }
+
+static int crypto_test_seal(EVP_CIPHER_CTX *ctx, unsigned char *data, int len, unsigned char *tag)
+{
+    int out = 0;
+    if (EVP_EncryptUpdate(ctx, data, &out, data, len) != 1 || EVP_EncryptFinal_ex(ctx, NULL, &out) != 1) {
+        return URPC_FAIL;
+    }
+    return EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, URPC_AES_TAG_LEN, tag) == 1 ? URPC_SUCCESS : URPC_FAIL;
+}
+
+static int crypto_test_open(EVP_CIPHER_CTX *ctx, unsigned char *data, int len, unsigned char *tag)
+{
+    int out = 0;
+    if (EVP_DecryptUpdate(ctx, data, &out, data, len) != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, URPC_AES_TAG_LEN, tag) != 1) {
+        return URPC_FAIL;
+    }
+    return EVP_DecryptFinal_ex(ctx, NULL, &out) == 1 ? URPC_SUCCESS : URPC_FAIL;
+}
+
+TEST_F(crypto_test, cached_ctx_roundtrip_test)
+{
+    urpc_cipher_t cipher_opt = {0};
+    crypto_key_t crypto_key;
+    ASSERT_EQ(crypto_ssl_gen_crypto_key(&crypto_key), URPC_SUCCESS);
+    ASSERT_EQ(crypto_cipher_init(&cipher_opt, &crypto_key), URPC_SUCCESS);
+    cipher_opt.chid = 1;
+
+    unsigned char plain[URPC_UT_USR_PAYLOAD_SIZE];
+    unsigned char data[URPC_UT_USR_PAYLOAD_SIZE];
+    unsigned char tag[URPC_AES_TAG_LEN];
+    unsigned char iv[URPC_AES_IV_LEN];
+    unsigned char last_iv[URPC_AES_IV_LEN] = {0};
+    for (uint32_t i = 0; i < sizeof(plain); i++) {
+        plain[i] = (unsigned char)i;
+    }
+
+    // thread ctx is reused by messages, each message gets a new iv
+    for (int round = 0; round < 4; round++) {
+        memcpy(data, plain, sizeof(data));
+        EVP_CIPHER_CTX *ctx = crypto_encrypt_ctx_get(&cipher_opt, iv);
+        ASSERT_NE(ctx, nullptr);
+        ASSERT_EQ(crypto_test_seal(ctx, data, sizeof(data), tag), URPC_SUCCESS);
+        ASSERT_NE(memcmp(iv, last_iv, URPC_AES_IV_LEN), 0);
+        memcpy(last_iv, iv, URPC_AES_IV_LEN);
+
+        ctx = crypto_decrypt_ctx_get(&cipher_opt, iv);
+        ASSERT_NE(ctx, nullptr);
+        ASSERT_EQ(crypto_test_open(ctx, data, sizeof(data), tag), URPC_SUCCESS);
+        ASSERT_EQ(memcmp(data, plain, sizeof(data)), 0);
+    }
+
+    // tampered message fails, and does not break next message
+    EVP_CIPHER_CTX *ctx = crypto_encrypt_ctx_get(&cipher_opt, iv);
+    ASSERT_NE(ctx, nullptr);
+    ASSERT_EQ(crypto_test_seal(ctx, data, sizeof(data), tag), URPC_SUCCESS);
+    data[0] ^= 1;
+    ASSERT_EQ(crypto_test_open(crypto_decrypt_ctx_get(&cipher_opt, iv), data, sizeof(data), tag), URPC_FAIL);
+
+    // ctx owned by caller, decrypted by ctx copied from thread cache
+    memcpy(data, plain, sizeof(data));
+    ctx = crypto_encrypt_ctx_init(&cipher_opt, iv, URPC_AES_IV_LEN);
+    ASSERT_NE(ctx, nullptr);
+    ASSERT_EQ(crypto_test_seal(ctx, data, sizeof(data), tag), URPC_SUCCESS);
+    EVP_CIPHER_CTX_free(ctx);
+    ASSERT_EQ(crypto_test_open(crypto_decrypt_ctx_get(&cipher_opt, iv), data, sizeof(data), tag), URPC_SUCCESS);
+    ASSERT_EQ(memcmp(data, plain, sizeof(data)), 0);
+
+    crypto_cipher_uninit(&cipher_opt);
+}
+
+TEST_F(crypto_test, cached_ctx_rekey_test)
+{
+    urpc_cipher_t cipher_opt = {0};
+    crypto_key_t key_a;
+    crypto_key_t key_b;
+    ASSERT_EQ(crypto_ssl_gen_crypto_key(&key_a), URPC_SUCCESS);
+    ASSERT_EQ(crypto_ssl_gen_crypto_key(&key_b), URPC_SUCCESS);
+
+    unsigned char data[URPC_UT_EXT_HEADER_SIZE] = {0};
+    unsigned char tag[URPC_AES_TAG_LEN];
+    unsigned char iv[URPC_AES_IV_LEN];
+    ASSERT_EQ(crypto_cipher_init(&cipher_opt, &key_a), URPC_SUCCESS);
+    ASSERT_EQ(crypto_test_seal(crypto_encrypt_ctx_get(&cipher_opt, iv), data, sizeof(data), tag), URPC_SUCCESS);
+    crypto_cipher_uninit(&cipher_opt);
+
+    // same cipher_opt keyed again, e.g. memory of a closed channel reused, cached ctx must not keep old key
+    ASSERT_EQ(crypto_cipher_init(&cipher_opt, &key_b), URPC_SUCCESS);
+    urpc_cipher_t cipher_b = {0};
+    ASSERT_EQ(crypto_cipher_init(&cipher_b, &key_b), URPC_SUCCESS);
+    ASSERT_EQ(crypto_test_seal(crypto_encrypt_ctx_get(&cipher_opt, iv), data, sizeof(data), tag), URPC_SUCCESS);
+    ASSERT_EQ(crypto_test_open(crypto_decrypt_ctx_get(&cipher_b, iv), data, sizeof(data), tag), URPC_SUCCESS);
+
+    crypto_cipher_uninit(&cipher_b);
+    crypto_cipher_uninit(&cipher_opt);
+}
+
+TEST_F(crypto_test, cached_ctx_wipe_on_uninit_test)
+{
+    urpc_cipher_t cipher_a = {0};
+    urpc_cipher_t cipher_b = {0};
+    crypto_key_t crypto_key;
+    ASSERT_EQ(crypto_ssl_gen_crypto_key(&crypto_key), URPC_SUCCESS);
+    ASSERT_EQ(crypto_cipher_init(&cipher_a, &crypto_key), URPC_SUCCESS);
+    ASSERT_EQ(crypto_cipher_init(&cipher_b, &crypto_key), URPC_SUCCESS);
+
+    unsigned char iv[URPC_AES_IV_LEN];
+    EVP_CIPHER_CTX *cached = crypto_encrypt_ctx_get(&cipher_a, iv);
+    ASSERT_NE(cached, nullptr);
+    EXPECT_NE(EVP_CIPHER_CTX_cipher(cached), nullptr);
+    crypto_cipher_uninit(&cipher_a);
+
+    // key schedule of an uninited cipher is wiped on next use of the thread cache, whichever channel it is for
+    ASSERT_NE(crypto_encrypt_ctx_get(&cipher_b, iv), nullptr);
+    EXPECT_EQ(EVP_CIPHER_CTX_cipher(cached), nullptr);
+
+    crypto_cipher_uninit(&cipher_b);
+}
+
+TEST_F(crypto_test, cached_ctx_iv_unique_test)
+{
+    urpc_cipher_t cipher_opt = {0};
+    crypto_key_t crypto_key;
+    ASSERT_EQ(crypto_ssl_gen_crypto_key(&crypto_key), URPC_SUCCESS);
+    ASSERT_EQ(crypto_cipher_init(&cipher_opt, &crypto_key), URPC_SUCCESS);
+
+    // iv counters reserved by threads in batch never overlap
+    const int thread_num = 4;
+    const int msg_num = 1000;
+    std::vector<std::vector<unsigned long long>> counters(thread_num);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; t++) {
+        threads.emplace_back([&cipher_opt, &counters, t]() {
+            unsigned char iv[URPC_AES_IV_LEN];
+            for (int i = 0; i < msg_num; i++) {
+                ASSERT_NE(crypto_encrypt_ctx_get(&cipher_opt, iv), nullptr);
+                unsigned long long counter;
+                memcpy(&counter, iv + sizeof(uint32_t), sizeof(counter));
+                counters[t].push_back(counter);
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    std::set<unsigned long long> all;
+    for (auto &c : counters) {
+        all.insert(c.begin(), c.end());
+    }
+    EXPECT_EQ(all.size(), (size_t)(thread_num * msg_num));
+
+    crypto_cipher_uninit(&cipher_opt);
+}
@@ -0,0 +1,187 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: keepalive expiry test, deadline wheel of logic servers against refresh, and its cost at scale
+ */
+#include <atomic>
+#include <thread>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+#include "keepalive.h"
+#include "urpc_util.h"
+
+#define TEST_EXPIRE_PEER_NUM 1000
+#define TEST_EXPIRE_SCALE_PEER_NUM 100000
+#define TEST_EXPIRE_SERVER_CHID_BASE (1u << 20)
+
+static void test_expire_info_fill(urpc_keepalive_task_info_t *info, urpc_instance_key_t *key, uint32_t idx)
+{
+    (void)memset(key, 0, sizeof(urpc_instance_key_t));
+    key->eid.in4.addr = idx;
+    key->pid = idx;
+
+    (void)memset(info, 0, sizeof(urpc_keepalive_task_info_t));
+    info->user_ctx = idx;
+    info->client_chid = idx;
+    info->server_chid = idx + TEST_EXPIRE_SERVER_CHID_BASE;
+    info->is_server = URPC_TRUE;
+}
+
+static void test_expire_id_fill(urpc_keepalive_id_t *id, uint32_t idx)
+{
+    id->client_chid = idx;
+    id->server_chid = idx + TEST_EXPIRE_SERVER_CHID_BASE;
+}
+
+class KeepaliveExpireTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(urpc_keepalive_task_init(), 0);
+        hz = urpc_get_cpu_hz();
+        check_time = urpc_keepalive_check_time_get() * hz;
+    }
+
+    void TearDown() override
+    {
+        urpc_keepalive_task_uninit();
+    }
+
+    void Create(uint32_t num)
+    {
+        urpc_instance_key_t key;
+        urpc_keepalive_task_info_t info;
+        for (uint32_t i = 0; i < num; i++) {
+            test_expire_info_fill(&info, &key, i);
+            ASSERT_EQ(urpc_keepalive_task_create(&key, &info), 0);
+        }
+    }
+
+    void Refresh(uint32_t idx)
+    {
+        urpc_keepalive_id_t id;
+        test_expire_id_fill(&id, idx);
+        urpc_keepalive_task_timestamp_update(&id, true);
+    }
+
+    bool Exist(uint32_t idx)
+    {
+        urpc_keepalive_id_t id;
+        urpc_keepalive_event_info_t info;
+        test_expire_id_fill(&id, idx);
+        return urpc_keepalive_task_entry_info_get(&id, true, &info) == 0;
+    }
+
+    uint64_t hz;
+    uint64_t check_time;
+};
+
+TEST_F(KeepaliveExpireTest, TestNotDueNotExpire)
+{
+    uint64_t begin = urpc_get_cpu_cycles();
+    Create(TEST_EXPIRE_PEER_NUM);
+
+    EXPECT_EQ(urpc_keepalive_task_timeout(urpc_get_cpu_cycles()), 0U);
+    EXPECT_EQ(urpc_keepalive_task_timeout(begin + check_time - hz), 0U);
+    for (uint32_t i = 0; i < TEST_EXPIRE_PEER_NUM; i++) {
+        ASSERT_TRUE(Exist(i));
+    }
+}
+
+TEST_F(KeepaliveExpireTest, TestRefreshedNotExpire)
+{
+    uint64_t begin = urpc_get_cpu_cycles();
+    Create(TEST_EXPIRE_PEER_NUM);
+
+    // refresh odd peers more than one bucket later than they were created
+    usleep(1200000);
+    for (uint32_t i = 1; i < TEST_EXPIRE_PEER_NUM; i += 2) {
+        Refresh(i);
+    }
+    uint64_t refreshed = urpc_get_cpu_cycles();
+
+    EXPECT_EQ(urpc_keepalive_task_timeout(begin + check_time + hz + hz / 20), (uint32_t)TEST_EXPIRE_PEER_NUM / 2);
+    for (uint32_t i = 0; i < TEST_EXPIRE_PEER_NUM; i++) {
+        ASSERT_EQ(Exist(i), (i & 1) == 1);
+    }
+
+    // refreshed peers have moved to the bucket of their new deadline
+    EXPECT_EQ(urpc_keepalive_task_timeout(refreshed + check_time + hz), (uint32_t)TEST_EXPIRE_PEER_NUM / 2);
+    for (uint32_t i = 0; i < TEST_EXPIRE_PEER_NUM; i++) {
+        ASSERT_FALSE(Exist(i));
+    }
+}
+
+TEST_F(KeepaliveExpireTest, TestStoppedNotExpire)
+{
+    urpc_instance_key_t key;
+    urpc_keepalive_task_info_t info;
+    uint64_t begin = urpc_get_cpu_cycles();
+    Create(TEST_EXPIRE_PEER_NUM);
+
+    // peers stopped for delayed release are out of the wheel, until refreshed again
+    for (uint32_t i = 0; i < 2; i++) {
+        test_expire_info_fill(&info, &key, i);
+        ASSERT_EQ(keepalive_task_stop(&key, &info), 0);
+    }
+    Refresh(1);
+    EXPECT_EQ(urpc_keepalive_task_timeout(begin + check_time + 2 * hz), (uint32_t)TEST_EXPIRE_PEER_NUM - 1);
+    EXPECT_TRUE(Exist(0));
+    EXPECT_FALSE(Exist(1));
+}
+
+// refresh keeps going while the check runs, no refreshed peer expires
+TEST_F(KeepaliveExpireTest, TestRefreshDuringCheck)
+{
+    Create(TEST_EXPIRE_PEER_NUM);
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> done(0);
+    std::thread refresher([&]() {
+        while (!stop.load()) {
+            for (uint32_t i = 0; i < TEST_EXPIRE_PEER_NUM; i++) {
+                Refresh(i);
+            }
+            done++;
+        }
+    });
+
+    uint64_t expired = 0;
+    while (done.load() < 100) {
+        expired += urpc_keepalive_task_timeout(urpc_get_cpu_cycles());
+        std::this_thread::yield();
+    }
+    stop = true;
+    refresher.join();
+    EXPECT_EQ(expired, 0U);
+}
+
+// check duration and refresh latency with 100k peers
+TEST_F(KeepaliveExpireTest, TestScaleBench)
+{
+    uint64_t begin = urpc_get_cpu_cycles();
+    Create(TEST_EXPIRE_SCALE_PEER_NUM);
+
+    uint64_t start = get_timestamp_ns();
+    for (uint32_t i = 0; i < TEST_EXPIRE_SCALE_PEER_NUM; i++) {
+        Refresh(i);
+    }
+    uint64_t refresh_ns = get_timestamp_ns() - start;
+
+    start = get_timestamp_ns();
+    EXPECT_EQ(urpc_keepalive_task_timeout(urpc_get_cpu_cycles()), 0U);
+    uint64_t idle_check_ns = get_timestamp_ns() - start;
+
+    start = get_timestamp_ns();
+    EXPECT_EQ(urpc_keepalive_task_timeout(begin + check_time - hz), 0U);
+    uint64_t due_check_ns = get_timestamp_ns() - start;
+
+    start = get_timestamp_ns();
+    EXPECT_EQ(urpc_keepalive_task_timeout(urpc_get_cpu_cycles() + check_time + 2 * hz),
+        (uint32_t)TEST_EXPIRE_SCALE_PEER_NUM);
+    uint64_t expire_check_ns = get_timestamp_ns() - start;
+
+    printf("%u peers, refresh: %.2f ns, check nothing due: %lu ns, check before deadline: %lu ns, "
+        "expire all: %lu us\n", TEST_EXPIRE_SCALE_PEER_NUM,
+        (double)refresh_ns / TEST_EXPIRE_SCALE_PEER_NUM, idle_check_ns, due_check_ns, expire_check_ns / NS_PER_US);
+}
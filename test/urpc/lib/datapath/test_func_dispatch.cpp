@@ -0,0 +1,266 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: urpc function dispatch test, handler lookup against register and unregister, and its cost
+ */
+#include <atomic>
+#include <pthread.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "func.h"
+#include "urpc_framework_api.h"
+#include "urpc_framework_errno.h"
+#include "urpc_util.h"
+
+#define TEST_DISPATCH_DEVICE_CLASS 0x001
+#define TEST_DISPATCH_SUB_CLASS 0x001
+#define TEST_DISPATCH_FUNC_NUM 128
+#define TEST_DISPATCH_TOTAL_NUM 2000000
+#define TEST_DISPATCH_MAX_THREAD_NUM 64
+#define TEST_DISPATCH_CTX_PAD 8      // counters of handlers in separate cache lines
+
+static void test_dispatch_handler(struct urpc_sge *args, uint32_t args_sge_num, void *ctx, struct urpc_sge **rsps,
+    uint32_t *rsps_sge_num)
+{
+    (void)args;
+    (void)args_sge_num;
+    (void)rsps;
+    (void)rsps_sge_num;
+    (*(uint64_t *)ctx)++;
+}
+
+class UrpcFuncDispatchTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(urpc_func_init(TEST_DISPATCH_DEVICE_CLASS, TEST_DISPATCH_SUB_CLASS), 0);
+        for (uint32_t i = 0; i < TEST_DISPATCH_FUNC_NUM; i++) {
+            ASSERT_EQ(Register(i, &func_id[i]), 0);
+        }
+    }
+
+    void TearDown() override
+    {
+        urpc_func_uninit();
+    }
+
+    int Register(uint32_t idx, uint64_t *id)
+    {
+        urpc_handler_info_t info = {URPC_HANDLER_SYNC, {test_dispatch_handler}, &ctx[idx][0], ""};
+        (void)snprintf(info.name, FUNCTION_NAME_LEN, "dispatch_%u", idx);
+        return urpc_func_register(&info, id);
+    }
+
+    int Exec(uint64_t id)
+    {
+        struct urpc_sge args = {};
+        struct urpc_sge *rsps = nullptr;
+        uint32_t rsps_sge_num = 0;
+        return urpc_func_exec(id, &args, 1, &rsps, &rsps_sge_num);
+    }
+
+    uint64_t func_id[TEST_DISPATCH_FUNC_NUM];
+    uint64_t ctx[TEST_DISPATCH_FUNC_NUM][TEST_DISPATCH_CTX_PAD] = {};
+};
+
+TEST_F(UrpcFuncDispatchTest, TestSlotsGrow)
+{
+    // method ids start from 4, slots have grown past their initial size while registering
+    EXPECT_EQ(func_id[TEST_DISPATCH_FUNC_NUM - 1] & 0x7fffff, (uint64_t)TEST_DISPATCH_FUNC_NUM + 3);
+    for (uint32_t i = 0; i < TEST_DISPATCH_FUNC_NUM; i++) {
+        ASSERT_EQ(Exec(func_id[i]), 0);
+        EXPECT_EQ(ctx[i][0], 1U);
+    }
+
+    // method id beyond slots
+    EXPECT_EQ(Exec(func_id[0] + 0x100000), -1);
+}
+
+TEST_F(UrpcFuncDispatchTest, TestUnregisterAndReuse)
+{
+    uint64_t id = func_id[1];
+    ASSERT_EQ(urpc_func_unregister(id), 0);
+    EXPECT_EQ(Exec(id), -1);
+    EXPECT_EQ(urpc_func_id_get(URPC_INVALID_ID_U32, "dispatch_1"), URPC_INVALID_FUNC_ID);
+
+    // the method id is taken again by next register
+    ASSERT_EQ(Register(1, &func_id[1]), 0);
+    EXPECT_EQ(func_id[1], id);
+    ASSERT_EQ(Exec(id), 0);
+    EXPECT_EQ(ctx[1][0], 1U);
+
+    void *addr = nullptr;
+    uint32_t len = 0;
+    ASSERT_EQ(urpc_func_info_get(&addr, &len), 0);
+    free(addr);
+}
+
+TEST_F(UrpcFuncDispatchTest, TestExecAfterUninit)
+{
+    urpc_func_uninit();
+    EXPECT_EQ(Exec(func_id[0]), -1);
+    ASSERT_EQ(urpc_func_init(TEST_DISPATCH_DEVICE_CLASS, TEST_DISPATCH_SUB_CLASS), 0);
+}
+
+// dispatchers keep calling while functions are unregistered and registered again
+TEST_F(UrpcFuncDispatchTest, TestDispatchDuringRegister)
+{
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> done(0);
+    std::vector<std::thread> dispatchers;
+    for (uint32_t t = 0; t < 4; t++) {
+        dispatchers.emplace_back([&, t]() {
+            uint32_t idx = t;
+            while (!stop.load()) {
+                int ret = Exec(func_id[idx % (TEST_DISPATCH_FUNC_NUM / 2)]);
+                ASSERT_TRUE(ret == 0 || ret == -1);
+                done++;
+                idx++;
+            }
+        });
+    }
+
+    // churn the lower half only, ids of the upper half stay valid for register to reuse ids
+    for (uint32_t round = 0; round < 200; round++) {
+        uint32_t idx = round % (TEST_DISPATCH_FUNC_NUM / 2);
+        ASSERT_EQ(urpc_func_unregister(func_id[idx]), 0);
+        ASSERT_EQ(Register(idx, &func_id[idx]), 0);
+    }
+    stop = true;
+    for (auto &t : dispatchers) {
+        t.join();
+    }
+    EXPECT_GT(done.load(), 0U);
+}
+
+typedef struct test_blocking_ctx {
+    std::atomic<bool> entered;
+    std::atomic<bool> release;
+} test_blocking_ctx_t;
+
+static void test_blocking_handler(struct urpc_sge *args, uint32_t args_sge_num, void *ctx, struct urpc_sge **rsps,
+    uint32_t *rsps_sge_num)
+{
+    (void)args;
+    (void)args_sge_num;
+    (void)rsps;
+    (void)rsps_sge_num;
+    test_blocking_ctx_t *blocking = (test_blocking_ctx_t *)ctx;
+    blocking->entered = true;
+    while (!blocking->release.load()) {
+        std::this_thread::yield();
+    }
+}
+
+// unregister returns only after running handler returns, so that caller can free ctx then
+TEST_F(UrpcFuncDispatchTest, TestUnregisterWaitHandler)
+{
+    test_blocking_ctx_t blocking;
+    blocking.entered = false;
+    blocking.release = false;
+    uint64_t id;
+    urpc_handler_info_t info = {URPC_HANDLER_SYNC, {test_blocking_handler}, &blocking, "blocking"};
+    ASSERT_EQ(urpc_func_register(&info, &id), 0);
+
+    std::thread dispatcher([&]() {
+        EXPECT_EQ(Exec(id), 0);
+    });
+    while (!blocking.entered.load()) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> returned(false);
+    std::thread unregister([&]() {
+        EXPECT_EQ(urpc_func_unregister(id), 0);
+        returned = true;
+    });
+    usleep(100000);
+    EXPECT_FALSE(returned.load());
+
+    blocking.release = true;
+    dispatcher.join();
+    unregister.join();
+    EXPECT_TRUE(returned.load());
+}
+
+// lookup as it was before: read lock on a process wide rwlock around handler lookup and call
+typedef struct test_locked_table {
+    pthread_rwlock_t lock;
+    urpc_handler_info_t info[TEST_DISPATCH_FUNC_NUM];
+} test_locked_table_t;
+
+static void test_locked_exec(test_locked_table_t *table, uint32_t idx)
+{
+    struct urpc_sge args = {};
+    struct urpc_sge *rsps = nullptr;
+    uint32_t rsps_sge_num = 0;
+    (void)pthread_rwlock_rdlock(&table->lock);
+    urpc_handler_info_t *info = &table->info[idx];
+    info->sync_handler(&args, 1, info->ctx, &rsps, &rsps_sge_num);
+    (void)pthread_rwlock_unlock(&table->lock);
+}
+
+template <typename F> static uint64_t TestDispatchRun(uint32_t thread_num, uint32_t loop, F func)
+{
+    std::atomic<uint32_t> ready(0);
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&, i]() {
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            for (uint32_t j = 0; j < loop; j++) {
+                func(i, j);
+            }
+        });
+    }
+    while (ready.load() != thread_num) {
+        std::this_thread::yield();
+    }
+    uint64_t begin = get_timestamp_ns();
+    start.store(true);
+    for (auto &t : threads) {
+        t.join();
+    }
+    return get_timestamp_ns() - begin;
+}
+
+// per request dispatch cost at 1 to 64 threads, each thread has a handler of its own
+TEST_F(UrpcFuncDispatchTest, TestDispatchCostBench)
+{
+    test_locked_table_t *table = (test_locked_table_t *)calloc(1, sizeof(test_locked_table_t));
+    ASSERT_NE(table, nullptr);
+    (void)pthread_rwlock_init(&table->lock, nullptr);
+    std::vector<uint64_t> counter(TEST_DISPATCH_MAX_THREAD_NUM * TEST_DISPATCH_CTX_PAD, 0);
+    for (uint32_t i = 0; i < TEST_DISPATCH_MAX_THREAD_NUM; i++) {
+        table->info[i] = {URPC_HANDLER_SYNC, {test_dispatch_handler}, &counter[i * TEST_DISPATCH_CTX_PAD], ""};
+    }
+
+    for (uint32_t thread_num = 1; thread_num <= TEST_DISPATCH_MAX_THREAD_NUM; thread_num <<= 1) {
+        uint32_t loop = TEST_DISPATCH_TOTAL_NUM / thread_num;
+        uint64_t locked_ns = TestDispatchRun(thread_num, loop, [table](uint32_t i, uint32_t) {
+            test_locked_exec(table, i);
+        });
+
+        for (uint32_t i = 0; i < thread_num; i++) {
+            ctx[i][0] = 0;
+        }
+        uint64_t epoch_ns = TestDispatchRun(thread_num, loop, [this](uint32_t i, uint32_t) {
+            (void)Exec(func_id[i]);
+        });
+        for (uint32_t i = 0; i < thread_num; i++) {
+            EXPECT_EQ(ctx[i][0], loop);
+        }
+
+        printf("%2u threads, rwlock: %.2f ns/dispatch, epoch: %.2f ns/dispatch\n", thread_num,
+            (double)locked_ns / ((uint64_t)loop * thread_num), (double)epoch_ns / ((uint64_t)loop * thread_num));
+    }
+
+    (void)pthread_rwlock_destroy(&table->lock);
+    free(table);
+}
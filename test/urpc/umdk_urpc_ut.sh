@@ -49,6 +49,7 @@ export GCOV_PREFIX="$REPORTS_PATH"
 ./core/test_core
 ./lib/test_lib
 ./protocol/test_protocol
+./umq/test_umq
 ./util/test_util
 
 echo "Generating coverage reports..."
@@ -0,0 +1,138 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util id allocator test
+ */
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util_id_generator.h"
+
+// same id space as msg id of UB rendezvous
+#define TEST_ID_MAX_NUM (1 << 16)
+#define TEST_ID_START (1)
+#define TEST_ID_ROUND (200000)
+#define TEST_ID_IN_FLIGHT (8)
+#define TEST_ID_MAX_THREAD (64)
+
+class UtilIdAllocatorTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        ASSERT_EQ(util_id_allocator_init(&m_allocator, TEST_ID_MAX_NUM, TEST_ID_START), 0);
+    }
+
+    void TearDown() override
+    {
+        util_id_allocator_uninit(&m_allocator);
+    }
+
+    util_id_allocator_t m_allocator = {};
+};
+
+TEST_F(UtilIdAllocatorTest, TestGetRelease)
+{
+    const uint32_t small_max = 4;
+    util_id_allocator_t allocator = {};
+    ASSERT_EQ(util_id_allocator_init(&allocator, small_max, TEST_ID_START), 0);
+    EXPECT_NE(util_id_allocator_init(&allocator, small_max, TEST_ID_START), 0);
+
+    EXPECT_EQ(util_id_allocator_get(&allocator), 1U);
+    EXPECT_EQ(util_id_allocator_get(&allocator), 2U);
+    EXPECT_EQ(util_id_allocator_get(&allocator), 3U);
+    // max_num is returned once ids are used up
+    EXPECT_EQ(util_id_allocator_get(&allocator), small_max);
+    EXPECT_EQ(util_id_allocator_get(&allocator), small_max);
+
+    // released ids are reused latest first, invalid id is ignored
+    util_id_allocator_release(&allocator, 2);
+    util_id_allocator_release(&allocator, 1);
+    util_id_allocator_release(&allocator, small_max);
+    EXPECT_EQ(util_id_allocator_get(&allocator), 1U);
+    EXPECT_EQ(util_id_allocator_get(&allocator), 2U);
+    EXPECT_EQ(util_id_allocator_get(&allocator), small_max);
+    util_id_allocator_uninit(&allocator);
+}
+
+// release of an id not in use, e.g. a duplicated message of peer, is ignored and does not break the stack
+TEST_F(UtilIdAllocatorTest, TestReleaseNotInUse)
+{
+    uint32_t id1 = util_id_allocator_get(&m_allocator);
+    uint32_t id2 = util_id_allocator_get(&m_allocator);
+    util_id_allocator_release(&m_allocator, id1);
+    util_id_allocator_release(&m_allocator, id1);
+    util_id_allocator_release(&m_allocator, id2 + 1);
+
+    EXPECT_EQ(util_id_allocator_get(&m_allocator), id1);
+    EXPECT_EQ(util_id_allocator_get(&m_allocator), id2 + 1);
+    util_id_allocator_release(&m_allocator, id2);
+    util_id_allocator_release(&m_allocator, id2);
+    EXPECT_EQ(util_id_allocator_get(&m_allocator), id2);
+    EXPECT_EQ(util_id_allocator_get(&m_allocator), id2 + 2);
+}
+
+// every thread holds a few ids like in-flight rendezvous messages, no id is owned by two threads at the same time
+static void test_id_worker(util_id_allocator_t *allocator, std::vector<std::atomic<uint32_t>> *owner, uint32_t idx,
+    std::atomic<bool> *start, std::atomic<uint64_t> *fail_cnt)
+{
+    while (!start->load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+
+    uint32_t ids[TEST_ID_IN_FLIGHT];
+    for (uint32_t round = 0; round < TEST_ID_ROUND; round += TEST_ID_IN_FLIGHT) {
+        for (uint32_t i = 0; i < TEST_ID_IN_FLIGHT; i++) {
+            ids[i] = util_id_allocator_get(allocator);
+            if (ids[i] < TEST_ID_START || ids[i] >= TEST_ID_MAX_NUM) {
+                fail_cnt->fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            uint32_t expected = 0;
+            if (!(*owner)[ids[i]].compare_exchange_strong(expected, idx + 1, std::memory_order_relaxed)) {
+                fail_cnt->fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        for (uint32_t i = 0; i < TEST_ID_IN_FLIGHT; i++) {
+            if (ids[i] < TEST_ID_START || ids[i] >= TEST_ID_MAX_NUM) {
+                continue;
+            }
+            (*owner)[ids[i]].store(0, std::memory_order_relaxed);
+            util_id_allocator_release(allocator, ids[i]);
+        }
+    }
+}
+
+TEST_F(UtilIdAllocatorTest, TestContentionScalability)
+{
+    std::vector<std::atomic<uint32_t>> owner(TEST_ID_MAX_NUM);
+    for (uint32_t thread_num = 1; thread_num <= TEST_ID_MAX_THREAD; thread_num <<= 1) {
+        for (auto &id_owner : owner) {
+            id_owner.store(0);
+        }
+        std::atomic<bool> start(false);
+        std::atomic<uint64_t> fail_cnt(0);
+        std::vector<std::thread> workers;
+        for (uint32_t i = 0; i < thread_num; i++) {
+            workers.emplace_back(test_id_worker, &m_allocator, &owner, i, &start, &fail_cnt);
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+
+        uint64_t ops = (uint64_t)thread_num * TEST_ID_ROUND;
+        printf("threads: %-3u get+release: %-9lu Mops/s: %-8.2f ns/op: %.2f\n", thread_num, ops,
+            (double)ops * 1000 / (double)cost.count(), (double)cost.count() / (double)ops);
+        EXPECT_EQ(fail_cnt.load(), 0U);
+    }
+
+    // ids in flight never exceed TEST_ID_MAX_THREAD * TEST_ID_IN_FLIGHT, so fresh ids are not used beyond that
+    EXPECT_LE(m_allocator.next_id, (uint32_t)(TEST_ID_START + TEST_ID_MAX_THREAD * TEST_ID_IN_FLIGHT));
+}
@@ -0,0 +1,56 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: umq qbuf memory backing test
+ */
+#include <cstdint>
+#include <cstring>
+
+#include "gtest/gtest.h"
+#include "umq_errno.h"
+#include "umq_qbuf_mem.h"
+
+#define TEST_QBUF_MEM_SIZE (3ULL * 1024 * 1024 + 4096)
+#define TEST_QBUF_MEM_ALIGN (8192)
+
+// hugepages may not be reserved on test machine, every backing must fall back to a usable memory
+TEST(UmqQbufMemTest, TestAllocFallback)
+{
+    for (uint32_t i = 0; i < UMQ_IO_BUF_BACKING_MAX; i++) {
+        umq_qbuf_mem_t mem;
+        ASSERT_EQ(umq_qbuf_mem_alloc(&mem, TEST_QBUF_MEM_SIZE, TEST_QBUF_MEM_ALIGN, (umq_io_buf_backing_t)i),
+            UMQ_SUCCESS);
+        ASSERT_NE(mem.addr, nullptr);
+        EXPECT_EQ((uintptr_t)mem.addr % TEST_QBUF_MEM_ALIGN, 0U);
+        EXPECT_EQ(mem.size, TEST_QBUF_MEM_SIZE);
+        EXPECT_LE(mem.backing, (umq_io_buf_backing_t)i);
+        EXPECT_NE(umq_qbuf_mem_backing_str(mem.backing), nullptr);
+
+        (void)memset(mem.addr, 0x5a, mem.size);
+        umq_qbuf_mem_free(&mem);
+        EXPECT_EQ(mem.addr, nullptr);
+    }
+}
+
+TEST(UmqQbufMemTest, TestPrefaultKeepContent)
+{
+    umq_qbuf_mem_t mem;
+    ASSERT_EQ(umq_qbuf_mem_alloc(&mem, TEST_QBUF_MEM_SIZE, TEST_QBUF_MEM_ALIGN, UMQ_IO_BUF_BACKING_THP),
+        UMQ_SUCCESS);
+    char *addr = (char *)mem.addr;
+    addr[0] = 1;
+    addr[TEST_QBUF_MEM_SIZE - 1] = 2;
+    umq_qbuf_mem_prefault(&mem);
+    EXPECT_EQ(addr[0], 1);
+    EXPECT_EQ(addr[TEST_QBUF_MEM_SIZE - 1], 2);
+    EXPECT_EQ(addr[TEST_QBUF_MEM_SIZE / 2], 0);
+    umq_qbuf_mem_free(&mem);
+}
+
+TEST(UmqQbufMemTest, TestAllocInvalid)
+{
+    umq_qbuf_mem_t mem;
+    EXPECT_EQ(umq_qbuf_mem_alloc(&mem, 0, TEST_QBUF_MEM_ALIGN, UMQ_IO_BUF_BACKING_NORMAL), -UMQ_ERR_EINVAL);
+    EXPECT_EQ(umq_qbuf_mem_alloc(&mem, TEST_QBUF_MEM_SIZE, TEST_QBUF_MEM_ALIGN, UMQ_IO_BUF_BACKING_MAX),
+        -UMQ_ERR_EINVAL);
+}
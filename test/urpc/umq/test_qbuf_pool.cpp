@@ -0,0 +1,397 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: umq qbuf pool test
+ */
+#include <atomic>
+#include <chrono>
+#include <malloc.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "umq_qbuf_pool.h"
+
+// each thread caches about one magazine(512 qbufs), 512M is enough for 64 threads in split mode
+#define TEST_QBUF_POOL_SIZE (512ULL * 1024 * 1024)
+#define TEST_QBUF_POOL_ALIGN (8192)
+#define TEST_QBUF_BURST (16)
+#define TEST_QBUF_ROUND (20000)
+#define TEST_QBUF_MAX_THREAD (64)
+
+class UmqQbufPoolTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        m_buf = memalign(TEST_QBUF_POOL_ALIGN, TEST_QBUF_POOL_SIZE);
+        ASSERT_NE(m_buf, nullptr);
+
+        qbuf_pool_cfg_t cfg = {};
+        cfg.buf_addr = m_buf;
+        cfg.total_size = TEST_QBUF_POOL_SIZE;
+        cfg.data_size = umq_buf_size_small();
+        cfg.headroom_size = 0;
+        cfg.mode = UMQ_BUF_SPLIT;
+        cfg.lock_free = LockFree();
+        cfg.numa_aware = NumaAware();
+        ASSERT_EQ(umq_qbuf_pool_init(&cfg), UMQ_SUCCESS);
+    }
+
+    void TearDown() override
+    {
+        umq_qbuf_pool_uninit();
+        free(m_buf);
+    }
+
+    virtual bool LockFree()
+    {
+        return false;
+    }
+
+    virtual bool NumaAware()
+    {
+        return false;
+    }
+
+    void *m_buf = nullptr;
+};
+
+class UmqQbufPoolLockFreeTest : public UmqQbufPoolTest {
+protected:
+    bool LockFree() override
+    {
+        return true;
+    }
+};
+
+class UmqQbufPoolNumaTest : public UmqQbufPoolTest {
+protected:
+    bool NumaAware() override
+    {
+        return true;
+    }
+};
+
+static uint32_t test_qbuf_list_count(umq_buf_list_t *list)
+{
+    uint32_t cnt = 0;
+    umq_buf_t *cur_node;
+    QBUF_LIST_FOR_EACH(cur_node, list) {
+        ++cnt;
+    }
+    return cnt;
+}
+
+static void test_qbuf_alloc_free_worker(std::atomic<bool> *start, std::atomic<uint64_t> *fail_cnt)
+{
+    while (!start->load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+
+    umq_buf_list_t list[TEST_QBUF_BURST];
+    for (uint32_t round = 0; round < TEST_QBUF_ROUND; round++) {
+        uint32_t alloc_cnt = 0;
+        for (uint32_t i = 0; i < TEST_QBUF_BURST; i++) {
+            QBUF_LIST_INIT(&list[i]);
+            if (umq_qbuf_alloc(umq_buf_size_small() >> 1, 1, NULL, &list[i]) != UMQ_SUCCESS) {
+                fail_cnt->fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            alloc_cnt++;
+        }
+
+        for (uint32_t i = 0; i < alloc_cnt; i++) {
+            umq_qbuf_free(&list[i]);
+        }
+    }
+}
+
+TEST_F(UmqQbufPoolTest, TestAllocFree)
+{
+    umq_buf_list_t list;
+    QBUF_LIST_INIT(&list);
+    ASSERT_EQ(umq_qbuf_alloc(umq_buf_size_small() >> 1, 1024, NULL, &list), UMQ_SUCCESS);
+    EXPECT_EQ(test_qbuf_list_count(&list), 1024U);
+    umq_qbuf_free(&list);
+
+    // buffers released by this thread are allocated again
+    QBUF_LIST_INIT(&list);
+    ASSERT_EQ(umq_qbuf_alloc(0, 1024, NULL, &list), UMQ_SUCCESS);
+    EXPECT_EQ(test_qbuf_list_count(&list), 1024U);
+    umq_qbuf_free(&list);
+}
+
+static void test_qbuf_alloc_free_scalability(void)
+{
+    for (uint32_t thread_num = 1; thread_num <= TEST_QBUF_MAX_THREAD; thread_num <<= 1) {
+        std::atomic<bool> start(false);
+        std::atomic<uint64_t> fail_cnt(0);
+        std::vector<std::thread> workers;
+        for (uint32_t i = 0; i < thread_num; i++) {
+            workers.emplace_back(test_qbuf_alloc_free_worker, &start, &fail_cnt);
+        }
+
+        auto begin = std::chrono::steady_clock::now();
+        start.store(true, std::memory_order_release);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+
+        uint64_t ops = (uint64_t)thread_num * TEST_QBUF_ROUND * TEST_QBUF_BURST;
+        printf("threads: %-3u alloc+free: %-9lu Mops/s: %-8.2f ns/op: %.2f\n", thread_num, ops,
+            (double)ops * 1000 / (double)cost.count(), (double)cost.count() / (double)ops);
+        EXPECT_EQ(fail_cnt.load(), 0U);
+    }
+}
+
+TEST_F(UmqQbufPoolTest, TestAllocFreeScalability)
+{
+    test_qbuf_alloc_free_scalability();
+}
+
+TEST_F(UmqQbufPoolLockFreeTest, TestAllocFree)
+{
+    umq_buf_list_t list;
+    QBUF_LIST_INIT(&list);
+    ASSERT_EQ(umq_qbuf_alloc(umq_buf_size_small() >> 1, 1024, NULL, &list), UMQ_SUCCESS);
+    EXPECT_EQ(test_qbuf_list_count(&list), 1024U);
+    umq_qbuf_free(&list);
+
+    QBUF_LIST_INIT(&list);
+    ASSERT_EQ(umq_qbuf_alloc(0, 1024, NULL, &list), UMQ_SUCCESS);
+    EXPECT_EQ(test_qbuf_list_count(&list), 1024U);
+    umq_qbuf_free(&list);
+}
+
+TEST_F(UmqQbufPoolLockFreeTest, TestAllocFreeScalability)
+{
+    test_qbuf_alloc_free_scalability();
+}
+
+// producer allocates and consumer releases, all qbufs flow through global pool
+TEST_F(UmqQbufPoolLockFreeTest, TestProducerConsumer)
+{
+    const uint32_t pair_num = 4;
+    const uint32_t msg_num = 100000;
+    const uint64_t max_in_flight = 4096;
+    std::vector<std::thread> workers;
+    std::vector<std::vector<umq_buf_t *>> rings(pair_num);
+    std::vector<std::mutex> locks(pair_num);
+    std::vector<std::atomic<uint64_t>> in_flight(pair_num);
+    std::atomic<uint64_t> fail_cnt(0);
+
+    for (auto &cnt : in_flight) {
+        cnt.store(0);
+    }
+    ASSERT_EQ(umq_qbuf_pool_stats_clear(), UMQ_SUCCESS);
+    for (uint32_t i = 0; i < pair_num; i++) {
+        workers.emplace_back([&, i]() {
+            for (uint32_t n = 0; n < msg_num; n++) {
+                // bound in-flight qbufs so that producers never exhaust global pool
+                while (in_flight[i].load(std::memory_order_relaxed) >= max_in_flight) {
+                    std::this_thread::yield();
+                }
+                umq_buf_list_t list;
+                QBUF_LIST_INIT(&list);
+                if (umq_qbuf_alloc(umq_buf_size_small() >> 1, 1, NULL, &list) != UMQ_SUCCESS) {
+                    fail_cnt.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                std::lock_guard<std::mutex> guard(locks[i]);
+                rings[i].push_back(QBUF_LIST_FIRST(&list));
+                in_flight[i].fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+        workers.emplace_back([&, i]() {
+            uint32_t released = 0;
+            while (released + fail_cnt.load(std::memory_order_relaxed) < msg_num) {
+                std::vector<umq_buf_t *> bufs;
+                {
+                    std::lock_guard<std::mutex> guard(locks[i]);
+                    bufs.swap(rings[i]);
+                }
+                for (umq_buf_t *buf : bufs) {
+                    umq_buf_list_t list;
+                    QBUF_LIST_FIRST(&list) = buf;
+                    umq_qbuf_free(&list);
+                }
+                released += (uint32_t)bufs.size();
+                in_flight[i].fetch_sub(bufs.size(), std::memory_order_relaxed);
+            }
+        });
+    }
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    EXPECT_EQ(fail_cnt.load(), 0U);
+    umq_qbuf_pool_stats_infos_t *info = NULL;
+    ASSERT_EQ(umq_qbuf_pool_stats_get(&info), UMQ_SUCCESS);
+    EXPECT_TRUE(info->lock_free);
+    EXPECT_GT(info->stats[UMQ_QBUF_POOL_KIND_SMALL].fetch_cnt, 0U);
+    EXPECT_GT(info->stats[UMQ_QBUF_POOL_KIND_SMALL].return_cnt, 0U);
+    printf("fetch: %lu return: %lu empty: %lu contention: %lu\n", info->stats[UMQ_QBUF_POOL_KIND_SMALL].fetch_cnt,
+        info->stats[UMQ_QBUF_POOL_KIND_SMALL].return_cnt, info->stats[UMQ_QBUF_POOL_KIND_SMALL].empty_cnt,
+        info->stats[UMQ_QBUF_POOL_KIND_SMALL].contention_cnt);
+}
+
+TEST_F(UmqQbufPoolTest, TestAllocFreeBulk)
+{
+    const uint32_t num = 1000;
+    std::vector<umq_buf_t *> bufs(num);
+    ASSERT_EQ(umq_qbuf_alloc_bulk(umq_buf_size_small() >> 1, num, NULL, bufs.data()), UMQ_SUCCESS);
+    for (umq_buf_t *buf : bufs) {
+        ASSERT_NE(buf, nullptr);
+        EXPECT_EQ(buf->qbuf_next, nullptr);
+        EXPECT_TRUE(buf->first_fragment);
+        EXPECT_EQ(buf->data_size, umq_buf_size_small() >> 1);
+        EXPECT_EQ(buf->total_data_size, umq_buf_size_small() >> 1);
+    }
+    umq_qbuf_free_bulk(bufs.data(), num);
+
+    // request larger than one block is a chain of fragments ended with NULL
+    uint32_t request_size = umq_buf_size_small() * 2 + 1;
+    ASSERT_EQ(umq_qbuf_alloc_bulk(request_size, num, NULL, bufs.data()), UMQ_SUCCESS);
+    for (umq_buf_t *buf : bufs) {
+        uint32_t frag_cnt = 0;
+        uint32_t data_size = 0;
+        for (umq_buf_t *cur = buf; cur != NULL; cur = cur->qbuf_next) {
+            EXPECT_EQ(cur->first_fragment, frag_cnt == 0);
+            data_size += cur->data_size;
+            frag_cnt++;
+        }
+        EXPECT_EQ(frag_cnt, 3U);
+        EXPECT_EQ(data_size, request_size);
+        EXPECT_EQ(buf->total_data_size, request_size);
+    }
+    umq_qbuf_free_bulk(bufs.data(), num);
+
+    ASSERT_EQ(umq_qbuf_alloc_bulk(0, num, NULL, bufs.data()), UMQ_SUCCESS);
+    for (umq_buf_t *buf : bufs) {
+        EXPECT_EQ(buf->qbuf_next, nullptr);
+        EXPECT_EQ(buf->buf_data, nullptr);
+    }
+    umq_qbuf_free_bulk(bufs.data(), num);
+
+    // everything released above can be allocated again as one list
+    umq_buf_list_t list;
+    QBUF_LIST_INIT(&list);
+    ASSERT_EQ(umq_qbuf_alloc(umq_buf_size_small() >> 1, num * 3, NULL, &list), UMQ_SUCCESS);
+    EXPECT_EQ(test_qbuf_list_count(&list), num * 3);
+    umq_qbuf_free(&list);
+}
+
+/* rx refill: allocate a batch, build one sge per qbuf as post rx does, release the batch once posted bufs come
+ * back. the list version walks the list to post, the bulk version walks an array taken from thread cache */
+TEST_F(UmqQbufPoolTest, TestRefillCost)
+{
+    const uint32_t batch = 64;
+    const uint32_t round_num = 20000;
+    const uint32_t size = umq_buf_size_small() >> 1;
+    uint64_t sge_sum = 0;
+
+    for (uint32_t bulk = 0; bulk <= 1; bulk++) {
+        umq_buf_t *bufs[batch];
+        auto begin = std::chrono::steady_clock::now();
+        for (uint32_t round = 0; round < round_num; round++) {
+            if (bulk != 0) {
+                ASSERT_EQ(umq_qbuf_alloc_bulk(size, batch, NULL, bufs), UMQ_SUCCESS);
+                for (uint32_t i = 0; i < batch; i++) {
+                    sge_sum += (uint64_t)(uintptr_t)bufs[i]->buf_data + bufs[i]->data_size;
+                }
+                umq_qbuf_free_bulk(bufs, batch);
+                continue;
+            }
+
+            umq_buf_list_t list;
+            QBUF_LIST_INIT(&list);
+            ASSERT_EQ(umq_qbuf_alloc(size, batch, NULL, &list), UMQ_SUCCESS);
+            umq_buf_t *cur_node;
+            QBUF_LIST_FOR_EACH(cur_node, &list) {
+                sge_sum += (uint64_t)(uintptr_t)cur_node->buf_data + cur_node->data_size;
+            }
+            umq_qbuf_free(&list);
+        }
+        auto cost = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+        printf("refill %-6s batch: %u ns/buf: %.2f\n", bulk != 0 ? "bulk" : "list", batch,
+            (double)cost.count() / ((double)round_num * batch));
+    }
+    EXPECT_NE(sge_sum, 0U);
+}
+
+static uint64_t test_qbuf_numa_free_cnt(umq_mempool_state_t *state)
+{
+    uint64_t free_cnt = 0;
+    for (uint32_t i = 0; i < state->numa_node_num; i++) {
+        free_cnt += state->numa_state[i].free_cnt;
+    }
+    return free_cnt;
+}
+
+TEST_F(UmqQbufPoolTest, TestNumaStateNotPartitioned)
+{
+    umq_mempool_state_t state = {};
+    state.numa_node_num = UMQ_MEMPOOL_NUMA_NODE_MAX;
+    umq_qbuf_pool_numa_state_get(&state);
+    EXPECT_EQ(state.numa_node_num, 0U);
+}
+
+TEST_F(UmqQbufPoolNumaTest, TestNumaState)
+{
+    uint64_t blk_num = TEST_QBUF_POOL_SIZE /
+        ((UMQ_EMPTY_HEADER_COEFFICIENT + 1) * sizeof(umq_buf_t) + umq_buf_size_small());
+    umq_mempool_state_t state = {};
+    umq_qbuf_pool_numa_state_get(&state);
+    ASSERT_LE(state.numa_node_num, (uint32_t)UMQ_MEMPOOL_NUMA_NODE_MAX);
+    if (state.numa_node_num == 0) {
+        // only one numa node is online, pool is not partitioned
+        return;
+    }
+
+    uint64_t total_cnt = 0;
+    for (uint32_t i = 0; i < state.numa_node_num; i++) {
+        total_cnt += state.numa_state[i].total_cnt;
+    }
+    EXPECT_EQ(total_cnt, blk_num);
+    EXPECT_EQ(test_qbuf_numa_free_cnt(&state), blk_num);
+
+    umq_buf_list_t list;
+    QBUF_LIST_INIT(&list);
+    ASSERT_EQ(umq_qbuf_alloc(umq_buf_size_small() >> 1, 1024, NULL, &list), UMQ_SUCCESS);
+    umq_qbuf_pool_numa_state_get(&state);
+    EXPECT_LE(test_qbuf_numa_free_cnt(&state), blk_num - 1024);
+    umq_qbuf_free(&list);
+}
+
+// one thread drains every partition, so its cache holds qbufs of remote partitions, which must go back home
+TEST_F(UmqQbufPoolNumaTest, TestFreeToHomePartition)
+{
+    uint64_t blk_num = TEST_QBUF_POOL_SIZE /
+        ((UMQ_EMPTY_HEADER_COEFFICIENT + 1) * sizeof(umq_buf_t) + umq_buf_size_small());
+    std::thread worker([blk_num]() {
+        std::vector<umq_buf_t *> bufs(blk_num);
+        ASSERT_EQ(umq_qbuf_alloc_bulk(umq_buf_size_small() >> 1, (uint32_t)blk_num, NULL, bufs.data()),
+            UMQ_SUCCESS);
+        // free in reverse order with a stride, so that released magazines mix qbufs of all partitions
+        for (uint32_t start = 0; start < TEST_QBUF_BURST; start++) {
+            for (uint64_t i = start; i < blk_num; i += TEST_QBUF_BURST) {
+                umq_qbuf_free_bulk(&bufs[blk_num - 1 - i], 1);
+            }
+        }
+    });
+    worker.join();
+
+    umq_mempool_state_t state = {};
+    umq_qbuf_pool_numa_state_get(&state);
+    for (uint32_t i = 0; i < state.numa_node_num; i++) {
+        EXPECT_EQ(state.numa_state[i].free_cnt, state.numa_state[i].total_cnt);
+    }
+}
+
+TEST_F(UmqQbufPoolNumaTest, TestAllocFreeScalability)
+{
+    test_qbuf_alloc_free_scalability();
+}
@@ -0,0 +1,163 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: umq shm qbuf pool test
+ */
+#include <malloc.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "umq_errno.h"
+#include "umq_shm_qbuf_pool.h"
+
+#define TEST_SHM_MSG_SIZE (64)
+#define TEST_SHM_BUF_NUM (32)
+#define TEST_SHM_POOL_BLK_NUM (8)
+#define TEST_SHM_RING_DEPTH (64)
+
+class UmqShmQbufCutTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        m_bufs.resize(TEST_SHM_BUF_NUM);
+        m_next = 0;
+    }
+
+    // build a chain like one descriptor carries, msg_frags[i] is count of qbufs of the i-th message
+    umq_buf_t *BuildChain(const std::vector<uint32_t> &msg_frags)
+    {
+        umq_buf_t *head = nullptr;
+        umq_buf_t *prev = nullptr;
+        for (uint32_t frag : msg_frags) {
+            for (uint32_t i = 0; i < frag; i++) {
+                umq_buf_t *cur = &m_bufs[m_next++];
+                *cur = {};
+                cur->data_size = TEST_SHM_MSG_SIZE;
+                cur->total_data_size = i == 0 ? frag * TEST_SHM_MSG_SIZE : 0;
+                if (prev != nullptr) {
+                    prev->qbuf_next = cur;
+                } else {
+                    head = cur;
+                }
+                prev = cur;
+            }
+        }
+        return head;
+    }
+
+    static uint32_t CountBufs(umq_buf_t *buf)
+    {
+        uint32_t cnt = 0;
+        for (; buf != nullptr; buf = buf->qbuf_next) {
+            cnt++;
+        }
+        return cnt;
+    }
+
+    std::vector<umq_buf_t> m_bufs;
+    uint32_t m_next;
+};
+
+TEST_F(UmqShmQbufCutTest, TestCutMsgs)
+{
+    umq_buf_t *chains[2] = {BuildChain({1, 3, 1}), BuildChain({2, 1})};
+    umq_buf_t *pending = nullptr;
+    umq_buf_t *msgs[4] = {};
+
+    // 5 messages in 2 chains, only 4 slots, the last message is left in pending
+    ASSERT_EQ(umq_shm_qbuf_cut_msgs(&pending, chains, 2, msgs, 4), 4U);
+    EXPECT_EQ(CountBufs(msgs[0]), 1U);
+    EXPECT_EQ(CountBufs(msgs[1]), 3U);
+    EXPECT_EQ(CountBufs(msgs[2]), 1U);
+    EXPECT_EQ(CountBufs(msgs[3]), 2U);
+    EXPECT_EQ(msgs[3], chains[1]);
+    ASSERT_NE(pending, nullptr);
+    EXPECT_EQ(CountBufs(pending), 1U);
+
+    // pending comes first, chains not reached are linked after pending
+    umq_buf_t *more[1] = {BuildChain({2})};
+    umq_buf_t *left = pending;
+    ASSERT_EQ(umq_shm_qbuf_cut_msgs(&pending, nullptr, 0, msgs, 1), 1U);
+    EXPECT_EQ(msgs[0], left);
+    EXPECT_EQ(pending, nullptr);
+    ASSERT_EQ(umq_shm_qbuf_cut_msgs(&pending, more, 1, msgs, 0), 0U);
+    EXPECT_EQ(pending, more[0]);
+    ASSERT_EQ(umq_shm_qbuf_cut_msgs(&pending, nullptr, 0, msgs, 4), 1U);
+    EXPECT_EQ(CountBufs(msgs[0]), 2U);
+    EXPECT_EQ(pending, nullptr);
+}
+
+static umq_shm_qbuf_desc_t g_test_shm_desc;
+
+static int test_shm_enqueue(uint64_t umq, umq_shm_qbuf_desc_t *desc, uint32_t num)
+{
+    g_test_shm_desc = *desc;
+    return UMQ_SUCCESS;
+}
+
+static int test_shm_dequeue(uint64_t umq, umq_shm_qbuf_desc_t *desc, uint32_t num)
+{
+    *desc = g_test_shm_desc;
+    return 1;
+}
+
+class UmqShmQbufDescTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        msg_ring_option_t opt = {};
+        opt.owner = true;
+        opt.tx_max_buf_size = UMQ_SHM_QBUF_DESC_SLOT_SIZE;
+        opt.tx_depth = TEST_SHM_RING_DEPTH;
+        opt.rx_max_buf_size = UMQ_SHM_QBUF_DESC_SLOT_SIZE;
+        opt.rx_depth = TEST_SHM_RING_DEPTH;
+        m_ring_shm = memalign(MSG_RING_CACHE_LINE_SIZE, msg_ring_shm_size(&opt));
+        ASSERT_NE(m_ring_shm, nullptr);
+        opt.addr = m_ring_shm;
+        m_ring = msg_ring_create((char *)"", 0, &opt);
+        ASSERT_NE(m_ring, nullptr);
+
+        shm_qbuf_pool_cfg_t cfg = {};
+        cfg.total_size = (uint64_t)TEST_SHM_POOL_BLK_NUM * umq_buf_size_small();
+        m_pool_shm = memalign(umq_buf_size_small(), cfg.total_size);
+        ASSERT_NE(m_pool_shm, nullptr);
+        cfg.buf_addr = m_pool_shm;
+        cfg.mode = UMQ_BUF_COMBINE;
+        cfg.type = SHM_QBUF_POOL_TYPE_LOCAL;
+        cfg.msg_ring = m_ring;
+        m_pool = umq_shm_global_pool_init(&cfg);
+        ASSERT_NE(m_pool, UMQ_INVALID_HANDLE);
+    }
+
+    void TearDown() override
+    {
+        umq_shm_global_pool_uninit(m_pool);
+        msg_ring_destroy(m_ring);
+        free(m_pool_shm);
+        free(m_ring_shm);
+    }
+
+    void *m_ring_shm = nullptr;
+    void *m_pool_shm = nullptr;
+    msg_ring_t *m_ring = nullptr;
+    uint64_t m_pool = UMQ_INVALID_HANDLE;
+};
+
+// a received chain that does not match its descriptor is dropped, and the qbufs walked are back in the pool
+TEST_F(UmqShmQbufDescTest, TestMismatchReclaim)
+{
+    uint32_t blk_data_size = umq_buf_size_small() - (uint32_t)sizeof(umq_buf_t);
+    umq_buf_list_t list;
+    QBUF_LIST_INIT(&list);
+    ASSERT_EQ(umq_shm_qbuf_alloc(m_pool, 3 * blk_data_size, 1, nullptr, &list), UMQ_SUCCESS);
+    ASSERT_EQ(umq_shm_qbuf_enqueue(QBUF_LIST_FIRST(&list), 0, m_pool, false, test_shm_enqueue), UMQ_SUCCESS);
+    ASSERT_EQ(g_test_shm_desc.qbuf_cnt, 3U);
+
+    g_test_shm_desc.total_size++;
+    bool rendezvous = false;
+    EXPECT_EQ(umq_shm_qbuf_dequeue(0, 0, m_pool, &rendezvous, test_shm_dequeue), nullptr);
+
+    QBUF_LIST_INIT(&list);
+    ASSERT_EQ(umq_shm_qbuf_alloc(m_pool, TEST_SHM_MSG_SIZE, TEST_SHM_POOL_BLK_NUM, nullptr, &list), UMQ_SUCCESS);
+    umq_shm_qbuf_free(m_pool, &list);
+}
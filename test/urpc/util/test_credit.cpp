@@ -0,0 +1,263 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util credit flow control test, senders and receiver are simulated tick by tick
+ */
+#include <deque>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util_credit.h"
+
+#define TEST_CREDIT_CAPACITY (64)
+#define TEST_CREDIT_LATENCY (2)         // ticks for a message or a grant to arrive
+#define TEST_CREDIT_UNLIMITED (UINT32_MAX)
+
+struct SimSender {
+    util_credit_t credit;               // receiver side state of sender
+    uint32_t window = 0;                // credits arrived at sender
+    uint64_t received = 0;              // messages of sender received
+    uint64_t granted = 0;
+    uint64_t standalone = 0;
+    uint64_t backlog = 0;               // messages waiting for credit
+    std::deque<std::pair<uint64_t, uint32_t>> grants;  // arrive tick, credits
+    bool joined = false;
+};
+
+class CreditSim {
+public:
+    CreditSim(uint32_t sender_num, uint32_t capacity) : senders(sender_num), capacity_(capacity)
+    {
+        util_credit_pool_init(&pool, capacity);
+        util_credit_post(&pool, capacity);
+        rq_posted = capacity;
+    }
+
+    void Join(uint32_t idx, uint32_t initial_window)
+    {
+        util_credit_join(&senders[idx].credit, &pool, 0);
+        senders[idx].joined = true;
+        Grant(idx, util_credit_take(&senders[idx].credit, initial_window), false);
+    }
+
+    /**
+     * Run one tick
+     * @param[in] demand: new messages of each sender in this tick
+     * @param[in] repost: buffers the receiver processes and posts again in this tick
+     * @param[in] reply: receiver sends a reply to each sender it received from in this tick
+     */
+    void Tick(const std::vector<uint32_t> &demand, uint32_t repost, bool reply)
+    {
+        std::vector<bool> replied(senders.size(), false);
+        for (uint32_t i = 0; i < senders.size(); i++) {
+            SimSender &s = senders[i];
+            while (!s.grants.empty() && s.grants.front().first <= now) {
+                s.window += s.grants.front().second;
+                s.grants.pop_front();
+            }
+            if (!s.joined) {
+                continue;
+            }
+            s.backlog = demand[i] == TEST_CREDIT_UNLIMITED ? s.window : s.backlog + demand[i];
+            uint32_t num = s.backlog < s.window ? (uint32_t)s.backlog : s.window;
+            s.window -= num;
+            s.backlog -= num;
+            for (uint32_t j = 0; j < num; j++) {
+                msgs.push_back({now + TEST_CREDIT_LATENCY, i});
+            }
+        }
+
+        while (!msgs.empty() && msgs.front().first <= now) {
+            uint32_t idx = msgs.front().second;
+            msgs.pop_front();
+            // receiver not ready, the message would be dropped or retried by the transport
+            ASSERT_GT(rq_posted, 0U);
+            rq_posted--;
+            held++;
+            util_credit_consume(&senders[idx].credit, 1);
+            senders[idx].received++;
+            replied[idx] = reply;
+        }
+
+        uint32_t num = held < repost ? held : repost;
+        held -= num;
+        rq_posted += num;
+        util_credit_post(&pool, num);
+
+        // the order senders are served in rotates, none of them is preferred
+        for (uint32_t k = 0; k < senders.size(); k++) {
+            uint32_t idx = (uint32_t)((now + k) % senders.size());
+            if (!senders[idx].joined) {
+                continue;
+            }
+            if (replied[idx]) {
+                Grant(idx, util_credit_grant(&senders[idx].credit, UTIL_CREDIT_GRANT_PIGGYBACK), false);
+            }
+            Grant(idx, util_credit_grant(&senders[idx].credit, UTIL_CREDIT_GRANT_STANDALONE), true);
+        }
+
+        // every posted buffer is either pending or granted to exactly one sender
+        uint64_t outstanding = 0;
+        for (auto &s : senders) {
+            outstanding += s.joined ? s.credit.outstanding : 0;
+        }
+        ASSERT_EQ(rq_posted, pool.pending + outstanding);
+        ASSERT_LE(rq_posted, capacity_);
+        now++;
+    }
+
+    std::vector<SimSender> senders;
+    util_credit_pool_t pool;
+    uint64_t now = 0;
+
+private:
+    void Grant(uint32_t idx, uint32_t num, bool standalone)
+    {
+        if (num == 0) {
+            return;
+        }
+        senders[idx].granted += num;
+        senders[idx].standalone += standalone ? 1 : 0;
+        senders[idx].grants.push_back({now + TEST_CREDIT_LATENCY, num});
+    }
+
+    std::deque<std::pair<uint64_t, uint32_t>> msgs;     // arrive tick, sender
+    uint32_t capacity_;
+    uint32_t rq_posted = 0;
+    uint32_t held = 0;                  // received and not processed yet
+};
+
+TEST(UtilCreditTest, TestPoolShare)
+{
+    util_credit_pool_t pool;
+    util_credit_t credit[2];
+    util_credit_pool_init(&pool, TEST_CREDIT_CAPACITY);
+    util_credit_post(&pool, TEST_CREDIT_CAPACITY);
+
+    util_credit_join(&credit[0], &pool, 0);
+    EXPECT_EQ(util_credit_share(&credit[0]), (uint32_t)TEST_CREDIT_CAPACITY);
+    EXPECT_EQ(credit[0].interval, (uint32_t)TEST_CREDIT_CAPACITY / 16);
+    EXPECT_EQ(util_credit_take(&credit[0], 48), 48U);
+
+    // second sender gets what is left, first one is over its new share and can not be granted more
+    util_credit_join(&credit[1], &pool, 0);
+    EXPECT_EQ(util_credit_share(&credit[1]), (uint32_t)TEST_CREDIT_CAPACITY / 2);
+    EXPECT_EQ(util_credit_avail(&credit[0]), 0U);
+    EXPECT_EQ(util_credit_avail(&credit[1]), 16U);
+    EXPECT_EQ(util_credit_grant(&credit[1], UTIL_CREDIT_GRANT_PIGGYBACK), 16U);
+    EXPECT_EQ(pool.pending, 0U);
+
+    // consumed buffers are posted again, they go to the sender below its share
+    util_credit_consume(&credit[0], 32);
+    util_credit_post(&pool, 32);
+    EXPECT_EQ(util_credit_avail(&credit[0]), 16U);
+    EXPECT_EQ(util_credit_avail(&credit[1]), 16U);
+
+    // grant lost on the way is revoked
+    EXPECT_EQ(util_credit_take(&credit[1], 8), 8U);
+    util_credit_revoke(&credit[1], 8);
+    EXPECT_EQ(credit[1].outstanding, 16U);
+    EXPECT_EQ(pool.pending, 32U);
+
+    util_credit_leave(&credit[0]);
+    EXPECT_EQ(pool.pending, 48U);
+    EXPECT_EQ(pool.sender_num, 1U);
+    EXPECT_EQ(util_credit_avail(&credit[1]), 48U);
+    util_credit_leave(&credit[1]);
+    EXPECT_EQ(pool.pending, (uint32_t)TEST_CREDIT_CAPACITY);
+}
+
+TEST(UtilCreditTest, TestSteadyIntervalGrows)
+{
+    CreditSim sim(1, TEST_CREDIT_CAPACITY);
+    sim.Join(0, TEST_CREDIT_CAPACITY / 2);
+    uint32_t initial_interval = sim.senders[0].credit.interval;
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_NO_FATAL_FAILURE(sim.Tick({1}, TEST_CREDIT_CAPACITY, false));
+    }
+
+    SimSender &s = sim.senders[0];
+    EXPECT_EQ(s.credit.interval, (uint32_t)TEST_CREDIT_CAPACITY / 2);
+    EXPECT_GT(s.credit.interval, initial_interval);
+    EXPECT_EQ(s.credit.total_starved, 0U);
+    // one message each tick, the sender never waits for credits
+    EXPECT_GE(s.received, 10000U - TEST_CREDIT_LATENCY);
+    // a fixed interval would send a grant every initial_interval messages
+    EXPECT_LT(s.standalone, s.received / initial_interval / 4);
+}
+
+TEST(UtilCreditTest, TestPiggybackOnReverseTraffic)
+{
+    CreditSim sim(1, TEST_CREDIT_CAPACITY);
+    sim.Join(0, TEST_CREDIT_CAPACITY / 2);
+    for (int i = 0; i < 10000; i++) {
+        ASSERT_NO_FATAL_FAILURE(sim.Tick({1}, TEST_CREDIT_CAPACITY, true));
+    }
+
+    SimSender &s = sim.senders[0];
+    EXPECT_GE(s.received, 10000U - TEST_CREDIT_LATENCY);
+    // replies carry the credits, standalone grants are not needed
+    EXPECT_LE(s.standalone, 1U);
+}
+
+TEST(UtilCreditTest, TestBurstIntervalShrinks)
+{
+    CreditSim sim(1, TEST_CREDIT_CAPACITY);
+    sim.Join(0, TEST_CREDIT_CAPACITY / 2);
+    // warm up with steady traffic so interval is large
+    for (int i = 0; i < 2000; i++) {
+        ASSERT_NO_FATAL_FAILURE(sim.Tick({1}, TEST_CREDIT_CAPACITY, false));
+    }
+    uint32_t steady_interval = sim.senders[0].credit.interval;
+
+    // bursts larger than the receive queue, the receiver processes two messages each tick
+    uint64_t demand = 0;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t burst = i % 500 == 0 ? 200 : 0;
+        demand += burst;
+        ASSERT_NO_FATAL_FAILURE(sim.Tick({burst}, 2, false));
+    }
+
+    SimSender &s = sim.senders[0];
+    EXPECT_LT(s.credit.interval, steady_interval);
+    EXPECT_GT(s.credit.total_starved, 0U);
+    // every burst is delivered before the next one, nothing is stuck
+    EXPECT_EQ(s.backlog, 0U);
+    EXPECT_EQ(s.received, 2000U + demand);
+}
+
+TEST(UtilCreditTest, TestManySendersFair)
+{
+    const uint32_t sender_num = 4;
+    CreditSim sim(sender_num, TEST_CREDIT_CAPACITY);
+    std::vector<uint32_t> demand(sender_num, TEST_CREDIT_UNLIMITED);
+    // senders join one by one, the first one holds the whole queue when the others join
+    for (uint32_t i = 0; i < sender_num; i++) {
+        sim.Join(i, TEST_CREDIT_CAPACITY / 2);
+        for (int t = 0; t < 100; t++) {
+            ASSERT_NO_FATAL_FAILURE(sim.Tick(demand, 8, false));
+        }
+    }
+    for (int t = 0; t < 1000; t++) {
+        ASSERT_NO_FATAL_FAILURE(sim.Tick(demand, 8, false));
+    }
+
+    std::vector<uint64_t> start(sender_num);
+    for (uint32_t i = 0; i < sender_num; i++) {
+        start[i] = sim.senders[i].received;
+    }
+    const uint32_t ticks = 10000;
+    for (uint32_t t = 0; t < ticks; t++) {
+        ASSERT_NO_FATAL_FAILURE(sim.Tick(demand, 8, false));
+    }
+
+    // the receiver is the bottleneck, each sender gets a quarter of it
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < sender_num; i++) {
+        uint64_t received = sim.senders[i].received - start[i];
+        total += received;
+        EXPECT_NEAR((double)received, ticks * 8.0 / sender_num, ticks * 8.0 / sender_num / 10) << "sender " << i;
+        EXPECT_LE(sim.senders[i].credit.outstanding, util_credit_share(&sim.senders[i].credit));
+    }
+    EXPECT_GE(total, ticks * 8 * 9 / 10);
+}
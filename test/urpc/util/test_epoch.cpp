@@ -0,0 +1,169 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util epoch based reclamation test
+ */
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util_epoch.h"
+
+#define TEST_EPOCH_THREAD_NUM (4)
+#define TEST_EPOCH_LOOP_NUM (20000)
+
+static std::atomic<uint32_t> g_test_epoch_freed(0);
+
+static void test_epoch_free(void *ptr)
+{
+    g_test_epoch_freed++;
+    free(ptr);
+}
+
+class UtilEpochTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        util_epoch_synchronize();
+        g_test_epoch_freed = 0;
+    }
+};
+
+TEST_F(UtilEpochTest, TestRetireWaitReader)
+{
+    std::atomic<int> step(0);
+    std::thread reader([&]() {
+        ASSERT_TRUE(util_epoch_read_lock());
+        step = 1;
+        while (step.load() != 2) {
+        }
+        util_epoch_read_unlock();
+        step = 3;
+        while (step.load() != 4) {
+        }
+    });
+    while (step.load() != 1) {
+    }
+
+    // reader entered before retire, object is kept
+    util_epoch_retire(malloc(8), test_epoch_free);
+    EXPECT_EQ(util_epoch_reclaim(), 1U);
+    EXPECT_EQ(g_test_epoch_freed.load(), 0U);
+
+    step = 2;
+    while (step.load() != 3) {
+    }
+    EXPECT_EQ(util_epoch_reclaim(), 0U);
+    EXPECT_EQ(g_test_epoch_freed.load(), 1U);
+    step = 4;
+    reader.join();
+}
+
+TEST_F(UtilEpochTest, TestLaterReaderNotBlock)
+{
+    std::atomic<int> step(0);
+    void *ptr = malloc(8);
+    util_epoch_retire(ptr, test_epoch_free);
+
+    std::thread reader([&]() {
+        ASSERT_TRUE(util_epoch_read_lock());
+        step = 1;
+        while (step.load() != 2) {
+        }
+        util_epoch_read_unlock();
+    });
+    while (step.load() != 1) {
+    }
+
+    // reader entered after retire, it can not see the object
+    EXPECT_EQ(util_epoch_reclaim(), 0U);
+    EXPECT_EQ(g_test_epoch_freed.load(), 1U);
+    step = 2;
+    reader.join();
+}
+
+TEST_F(UtilEpochTest, TestNestedReadLock)
+{
+    ASSERT_TRUE(util_epoch_read_lock());
+    ASSERT_TRUE(util_epoch_read_lock());
+    util_epoch_read_unlock();
+
+    std::thread writer([]() {
+        util_epoch_retire(malloc(8), test_epoch_free);
+        EXPECT_EQ(util_epoch_reclaim(), 1U);
+    });
+    writer.join();
+    EXPECT_EQ(g_test_epoch_freed.load(), 0U);
+
+    util_epoch_read_unlock();
+    EXPECT_EQ(util_epoch_reclaim(), 0U);
+    EXPECT_EQ(g_test_epoch_freed.load(), 1U);
+}
+
+TEST_F(UtilEpochTest, TestReaderReusedAfterThreadExit)
+{
+    std::thread first([]() {
+        ASSERT_TRUE(util_epoch_read_lock());
+        util_epoch_read_unlock();
+    });
+    first.join();
+
+    util_epoch_reader_t *reader = nullptr;
+    std::thread second([&reader]() {
+        ASSERT_TRUE(util_epoch_read_lock());
+        reader = g_util_epoch_reader;
+        util_epoch_read_unlock();
+    });
+    second.join();
+    EXPECT_NE(reader, nullptr);
+    EXPECT_EQ((uintptr_t)reader % UTIL_EPOCH_ALIGN, 0U);
+    EXPECT_EQ(reader->epoch, (uint64_t)UTIL_EPOCH_IDLE);
+}
+
+// readers follow a published pointer while a writer keeps replacing it, a retired object must stay intact
+TEST_F(UtilEpochTest, TestConcurrentReplace)
+{
+    struct test_obj {
+        uint64_t magic;
+    };
+    const uint64_t magic = 0x5a5a5a5a5a5a5a5a;
+    test_obj *init = (test_obj *)malloc(sizeof(test_obj));
+    init->magic = magic;
+    test_obj *published = init;
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> corrupted(0);
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < TEST_EPOCH_THREAD_NUM; i++) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                ASSERT_TRUE(util_epoch_read_lock());
+                test_obj *obj = __atomic_load_n(&published, __ATOMIC_ACQUIRE);
+                if (obj->magic != magic) {
+                    corrupted++;
+                }
+                util_epoch_read_unlock();
+            }
+        });
+    }
+
+    for (int i = 0; i < TEST_EPOCH_LOOP_NUM; i++) {
+        test_obj *obj = (test_obj *)malloc(sizeof(test_obj));
+        obj->magic = magic;
+        test_obj *old = __atomic_exchange_n(&published, obj, __ATOMIC_ACQ_REL);
+        util_epoch_retire(old, [](void *ptr) {
+            ((test_obj *)ptr)->magic = 0;
+            test_epoch_free(ptr);
+        });
+    }
+    stop = true;
+    for (auto &t : readers) {
+        t.join();
+    }
+
+    util_epoch_synchronize();
+    EXPECT_EQ(corrupted.load(), 0U);
+    EXPECT_EQ(g_test_epoch_freed.load(), (uint32_t)TEST_EPOCH_LOOP_NUM);
+    free(published);
+}
@@ -0,0 +1,86 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util log-linear histogram test
+ */
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util_hist.h"
+
+#define TEST_HIST_SAMPLE_NUM (1000000)
+// bucket is 1/32 of its power of two wide, the middle of bucket is within 1/64
+#define TEST_HIST_PRECISION (1.0 / 64)
+
+TEST(UtilHistTest, TestIndexValue)
+{
+    // linear part, one bucket for each value
+    for (uint64_t v = 0; v < 64; v++) {
+        EXPECT_EQ(util_hist_index(v), v);
+        EXPECT_EQ(util_hist_value((uint32_t)v), v);
+    }
+
+    uint32_t last_idx = 0;
+    for (uint64_t v = 64; v < (1ULL << UTIL_HIST_MAX_BITS); v += v / 97 + 1) {
+        uint32_t idx = util_hist_index(v);
+        ASSERT_LT(idx, UTIL_HIST_BUCKET_NUM);
+        ASSERT_GE(idx, last_idx);
+        last_idx = idx;
+        double err = std::fabs((double)util_hist_value(idx) - (double)v) / (double)v;
+        ASSERT_LE(err, TEST_HIST_PRECISION) << "value " << v;
+    }
+    EXPECT_EQ(util_hist_index((1ULL << UTIL_HIST_MAX_BITS) - 1), UTIL_HIST_BUCKET_NUM - 1);
+    EXPECT_EQ(util_hist_index(UINT64_MAX), UTIL_HIST_BUCKET_NUM - 1);
+}
+
+TEST(UtilHistTest, TestQuantile)
+{
+    util_hist_t hist;
+    util_hist_clear(&hist);
+    EXPECT_EQ(util_hist_quantile(&hist, 0, 0.5), 0U);
+
+    // latency like distribution, most samples around 1us with a long tail up to seconds
+    std::mt19937_64 rng(20251210);
+    std::lognormal_distribution<double> dist(std::log(1000.0), 1.5);
+    std::vector<uint64_t> samples(TEST_HIST_SAMPLE_NUM);
+    for (auto &sample : samples) {
+        sample = (uint64_t)dist(rng) + 1;
+        util_hist_record(&hist, sample);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    const double quantiles[] = {0, 0.5, 0.9, 0.99, 0.999, 0.9999, 1};
+    for (double q : quantiles) {
+        uint64_t rank = (uint64_t)(q * TEST_HIST_SAMPLE_NUM + 0.5);
+        uint64_t expect = samples[rank == 0 ? 0 : rank - 1];
+        uint64_t value = util_hist_quantile(&hist, TEST_HIST_SAMPLE_NUM, q);
+        EXPECT_LE(std::fabs((double)value - (double)expect) / (double)expect, TEST_HIST_PRECISION) << "quantile " << q;
+    }
+}
+
+TEST(UtilHistTest, TestMerge)
+{
+    util_hist_t hist[2];
+    util_hist_t total;
+    util_hist_clear(&hist[0]);
+    util_hist_clear(&hist[1]);
+    util_hist_clear(&total);
+
+    // one thread records fast samples and the other slow ones, tail comes from the slow thread only
+    for (uint64_t i = 1; i <= 9000; i++) {
+        util_hist_record(&hist[0], 100 + i % 10);
+    }
+    for (uint64_t i = 1; i <= 1000; i++) {
+        util_hist_record(&hist[1], 1000000 + i);
+    }
+    util_hist_merge(&total, &hist[0]);
+    util_hist_merge(&total, &hist[1]);
+
+    EXPECT_LE(util_hist_quantile(&total, 10000, 0.5), 110U);
+    EXPECT_LE(util_hist_quantile(&total, 10000, 0.9), 110U);
+    uint64_t p99 = util_hist_quantile(&total, 10000, 0.99);
+    EXPECT_LE(std::fabs((double)p99 - 1000900.0) / 1000900.0, TEST_HIST_PRECISION);
+}
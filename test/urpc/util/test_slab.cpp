@@ -3,8 +3,15 @@
  * Copyright (c) Huawei Technologies Co., Ltd. 2024-2024. All rights reserved.
  * Description: urpc dynamic buffer statistics test
  */
+#include <algorithm>
+#include <atomic>
+#include <set>
+#include <thread>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "urpc_slab.h"
+#include "urpc_util.h"
 
 TEST(UrpcESlabTest, TestESlabAllocOutOfRange)
 {
@@ -14,6 +21,7 @@ TEST(UrpcESlabTest, TestESlabAllocOutOfRange)
     slab.total = 10;
     slab.obj_size = 10;
     slab.addr = malloc(100);
+    slab.cache = nullptr;
     (void)pthread_spin_init(&slab.lock, PTHREAD_PROCESS_PRIVATE);
 
     void *result = eslab_alloc(&slab, &id);
@@ -32,6 +40,7 @@ TEST(UrpcESlabTest, TestESlabAllocUseAfterFree)
     slab.total = 10;
     slab.obj_size = 10;
     slab.addr = malloc(100);
+    slab.cache = nullptr;
     (void)pthread_spin_init(&slab.lock, PTHREAD_PROCESS_PRIVATE);
 
     void *result = eslab_alloc(&slab, &id);
@@ -41,3 +50,179 @@ TEST(UrpcESlabTest, TestESlabAllocUseAfterFree)
 
     free(slab.addr);
 }
+
+#define TEST_ESLAB_CACHE_TOTAL 4096
+#define TEST_ESLAB_OBJ_SIZE 64
+#define TEST_ESLAB_MAX_THREAD_NUM 64
+#define TEST_ESLAB_PAIR_NUM 2000000
+
+class UrpcESlabCacheTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        buf = malloc(TEST_ESLAB_CACHE_TOTAL * TEST_ESLAB_OBJ_SIZE);
+        ASSERT_NE(buf, nullptr);
+        eslab_init(&slab, buf, TEST_ESLAB_OBJ_SIZE, TEST_ESLAB_CACHE_TOTAL);
+        ASSERT_NE(slab.cache, nullptr);
+    }
+
+    void TearDown() override
+    {
+        eslab_uninit(&slab);
+        free(buf);
+    }
+
+    eslab_t slab;
+    void *buf;
+};
+
+TEST_F(UrpcESlabCacheTest, TestAllocAllAcrossThreads)
+{
+    // objects freed by another thread are held in its slot
+    std::thread other([this]() {
+        std::vector<void *> bufs;
+        for (uint32_t i = 0; i < 20; i++) {
+            bufs.push_back(eslab_get_buf(&slab));
+            ASSERT_NE(bufs.back(), nullptr);
+        }
+        for (void *b : bufs) {
+            eslab_put_buf(&slab, b);
+        }
+    });
+    other.join();
+
+    std::set<uint32_t> ids;
+    for (uint32_t i = 0; i < TEST_ESLAB_CACHE_TOTAL; i++) {
+        uint32_t id;
+        void *b = eslab_alloc(&slab, &id);
+        ASSERT_NE(b, nullptr);
+        ASSERT_EQ(b, eslab_id_to_addr(&slab, id));
+        ASSERT_TRUE(ids.insert(id).second);
+    }
+    uint32_t id;
+    EXPECT_EQ(eslab_alloc(&slab, &id), nullptr);
+    EXPECT_EQ(errno, URPC_ERR_ENOMEM);
+
+    for (uint32_t i : ids) {
+        eslab_free(&slab, i, eslab_id_to_addr(&slab, i));
+    }
+    EXPECT_EQ(eslab_get_first_used_object(&slab), nullptr);
+}
+
+TEST_F(UrpcESlabCacheTest, TestCachedUseAfterFree)
+{
+    uint32_t id;
+    void *b = eslab_alloc(&slab, &id);
+    ASSERT_NE(b, nullptr);
+    eslab_free(&slab, id, b);
+    *(uint32_t *)b = 0;
+
+    EXPECT_EQ(eslab_alloc(&slab, &id), nullptr);
+    EXPECT_EQ(errno, URPC_ERR_EPERM);
+}
+
+TEST_F(UrpcESlabCacheTest, TestFirstUsedObject)
+{
+    EXPECT_EQ(eslab_get_first_used_object(&slab), nullptr);
+
+    uint32_t id[3];
+    void *b[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        b[i] = eslab_alloc(&slab, &id[i]);
+        ASSERT_NE(b[i], nullptr);
+    }
+    // objects back in the cache of this thread are idle, the one still in use is found
+    eslab_free(&slab, id[0], b[0]);
+    eslab_free(&slab, id[2], b[2]);
+    EXPECT_EQ(eslab_get_first_used_object(&slab), b[1]);
+    EXPECT_EQ(eslab_get_first_used_object_lockless(&slab), b[1]);
+
+    eslab_free(&slab, id[1], b[1]);
+    EXPECT_EQ(eslab_get_first_used_object(&slab), nullptr);
+}
+
+// threads keep objects across calls and free them out of order, no object is handed out twice
+TEST_F(UrpcESlabCacheTest, TestConcurrentAllocFree)
+{
+    std::vector<uint8_t> owner(TEST_ESLAB_CACHE_TOTAL, 0);
+    std::atomic<uint32_t> dup(0);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < 8; t++) {
+        threads.emplace_back([&, t]() {
+            std::vector<uint32_t> held;
+            for (uint32_t i = 0; i < 50000; i++) {
+                uint32_t id;
+                if (held.size() < 100 && (i % 3) != 2) {
+                    if (eslab_alloc(&slab, &id) == nullptr) {
+                        continue;
+                    }
+                    if (__atomic_exchange_n(&owner[id], 1, __ATOMIC_ACQ_REL) != 0) {
+                        dup++;
+                    }
+                    held.push_back(id);
+                } else if (!held.empty()) {
+                    id = held[(i * 7 + t) % held.size()];
+                    held.erase(std::find(held.begin(), held.end(), id));
+                    __atomic_store_n(&owner[id], 0, __ATOMIC_RELEASE);
+                    eslab_free(&slab, id, eslab_id_to_addr(&slab, id));
+                }
+            }
+            for (uint32_t id : held) {
+                __atomic_store_n(&owner[id], 0, __ATOMIC_RELEASE);
+                eslab_free(&slab, id, eslab_id_to_addr(&slab, id));
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(dup.load(), 0U);
+    EXPECT_EQ(eslab_get_first_used_object(&slab), nullptr);
+}
+
+template <typename F> static uint64_t TestESlabRun(uint32_t thread_num, F func)
+{
+    std::atomic<uint32_t> ready(0);
+    std::atomic<bool> start(false);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&]() {
+            ready++;
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            for (uint32_t j = 0; j < TEST_ESLAB_PAIR_NUM / thread_num; j++) {
+                func();
+            }
+        });
+    }
+    while (ready.load() != thread_num) {
+        std::this_thread::yield();
+    }
+    uint64_t begin = get_timestamp_ns();
+    start.store(true);
+    for (auto &t : threads) {
+        t.join();
+    }
+    return get_timestamp_ns() - begin;
+}
+
+// alloc/free pair cost at 1 to 64 threads, shared free list only against front cache
+TEST_F(UrpcESlabCacheTest, TestAllocFreeBench)
+{
+    struct eslab_cache *cache = slab.cache;
+    for (uint32_t thread_num = 1; thread_num <= TEST_ESLAB_MAX_THREAD_NUM; thread_num <<= 1) {
+        uint64_t pair_num = (uint64_t)(TEST_ESLAB_PAIR_NUM / thread_num) * thread_num;
+        slab.cache = nullptr;
+        uint64_t shared_ns = TestESlabRun(thread_num, [this]() {
+            eslab_put_buf(&slab, eslab_get_buf(&slab));
+        });
+        slab.cache = cache;
+        uint64_t cache_ns = TestESlabRun(thread_num, [this]() {
+            eslab_put_buf(&slab, eslab_get_buf(&slab));
+        });
+        printf("%2u threads, shared: %.2f ns/pair, cache: %.2f ns/pair\n", thread_num,
+            (double)shared_ns / pair_num, (double)cache_ns / pair_num);
+    }
+    EXPECT_EQ(eslab_get_first_used_object(&slab), nullptr);
+}
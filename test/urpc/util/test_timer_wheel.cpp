@@ -0,0 +1,436 @@
+/*
+ * SPDX-License-Identifier: MIT
+ * Copyright (c) Huawei Technologies Co., Ltd. 2025-2025. All rights reserved.
+ * Description: util per thread timing wheel test, expiry, cancel from owner and other threads, and its cost
+ */
+#include <algorithm>
+#include <atomic>
+#include <sys/epoll.h>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "urpc_framework_errno.h"
+#include "urpc_timer.h"
+#include "urpc_util.h"
+#include "util_timer_wheel.h"
+
+#define TEST_TW_TICK_US 50
+#define TEST_TW_TIMER_NUM 1000
+#define TEST_TW_BENCH_NUM 200000
+#define TEST_TW_BENCH_THREAD_NUM 4
+#define TEST_TW_JITTER_NUM 2000
+#define TEST_TW_BENCH_TIMEOUT_MS 1000
+
+typedef struct test_tw_ctx {
+    util_tw_timer_t timer;
+    uint64_t deadline_ns;
+    uint64_t fired_ns;
+    uint32_t fired;
+} test_tw_ctx_t;
+
+static void test_tw_cb(void *args)
+{
+    test_tw_ctx_t *ctx = (test_tw_ctx_t *)args;
+    ctx->fired_ns = get_timestamp_ns();
+    ctx->fired++;
+}
+
+typedef struct test_tw_defer_ctx {
+    std::vector<test_tw_ctx_t> *ctx;
+    uint32_t idle_num;
+} test_tw_defer_ctx_t;
+
+static void test_tw_defer_cb(void *args)
+{
+    test_tw_defer_ctx_t *defer = (test_tw_defer_ctx_t *)args;
+    for (auto &c : *defer->ctx) {
+        defer->idle_num += util_tw_timer_is_idle(&c.timer) ? 1 : 0;
+    }
+}
+
+static void test_tw_poll_until(util_timer_wheel_t *tw, uint64_t end_ns)
+{
+    while (get_timestamp_ns() < end_ns) {
+        (void)util_timer_wheel_poll(tw);
+    }
+    (void)util_timer_wheel_poll(tw);
+}
+
+class UtilTimerWheelTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        tw = util_timer_wheel_create(TEST_TW_TICK_US, 0);
+        ASSERT_NE(tw, nullptr);
+        ctx.resize(TEST_TW_TIMER_NUM);
+        for (auto &c : ctx) {
+            util_tw_timer_init(&c.timer, test_tw_cb, &c);
+        }
+    }
+
+    void TearDown() override
+    {
+        util_timer_wheel_destroy(tw);
+    }
+
+    int Add(test_tw_ctx_t *c, uint64_t timeout_us, bool periodic = false)
+    {
+        c->deadline_ns = get_timestamp_ns() + timeout_us * NS_PER_US;
+        return util_tw_timer_add(tw, &c->timer, timeout_us, periodic);
+    }
+
+    util_timer_wheel_t *tw = nullptr;
+    std::vector<test_tw_ctx_t> ctx;
+};
+
+TEST_F(UtilTimerWheelTest, TestInvalidArgs)
+{
+    EXPECT_EQ(util_timer_wheel_create(UTIL_TIMER_WHEEL_MIN_TICK_US - 1, 0), nullptr);
+    EXPECT_EQ(util_tw_timer_add(nullptr, &ctx[0].timer, 100, false), URPC_FAIL);
+    util_tw_timer_t timer;
+    util_tw_timer_init(&timer, nullptr, nullptr);
+    EXPECT_EQ(util_tw_timer_add(tw, &timer, 100, false), URPC_FAIL);
+    EXPECT_FALSE(util_tw_timer_cancel(&timer));
+
+    // only the owner adds timers
+    std::thread other([this]() { EXPECT_EQ(util_tw_timer_add(tw, &ctx[0].timer, 100, false), URPC_FAIL); });
+    other.join();
+}
+
+// timeouts spread over levels 0 and 1, none fires early and all fire once
+TEST_F(UtilTimerWheelTest, TestExpireAcrossLevels)
+{
+    uint64_t max_timeout_us = 0;
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+        uint64_t timeout_us = (i % 4 == 0) ? (uint64_t)i * 100 : (uint64_t)(i % 200) * TEST_TW_TICK_US;
+        max_timeout_us = std::max(max_timeout_us, timeout_us);
+        ASSERT_EQ(Add(&ctx[i], timeout_us), URPC_SUCCESS);
+    }
+    EXPECT_EQ(util_timer_wheel_pending_num(tw), (uint32_t)TEST_TW_TIMER_NUM);
+
+    test_tw_poll_until(tw, get_timestamp_ns() + (max_timeout_us + 2 * TEST_TW_TICK_US) * NS_PER_US);
+    EXPECT_EQ(util_timer_wheel_pending_num(tw), 0U);
+    for (auto &c : ctx) {
+        EXPECT_EQ(c.fired, 1U);
+        EXPECT_GE(c.fired_ns, c.deadline_ns);
+        EXPECT_TRUE(util_tw_timer_is_idle(&c.timer));
+    }
+
+    util_timer_wheel_stats_t stats;
+    util_timer_wheel_stats_get(tw, &stats);
+    EXPECT_EQ(stats.expired, (uint64_t)TEST_TW_TIMER_NUM);
+    EXPECT_GT(stats.cascaded, 0U);
+}
+
+TEST_F(UtilTimerWheelTest, TestLocalCancelAndRestart)
+{
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+        ASSERT_EQ(Add(&ctx[i], 1000 + i), URPC_SUCCESS);
+    }
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i += 2) {
+        EXPECT_TRUE(util_tw_timer_cancel(&ctx[i].timer));
+        EXPECT_FALSE(util_tw_timer_cancel(&ctx[i].timer));
+    }
+    // restart moves the deadline
+    ASSERT_EQ(Add(&ctx[1], 20000), URPC_SUCCESS);
+    EXPECT_EQ(util_timer_wheel_pending_num(tw), (uint32_t)TEST_TW_TIMER_NUM / 2);
+
+    test_tw_poll_until(tw, get_timestamp_ns() + 3000 * NS_PER_US);
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+        EXPECT_EQ(ctx[i].fired, (i % 2 == 0 || i == 1) ? 0U : 1U);
+    }
+    EXPECT_EQ(util_timer_wheel_pending_num(tw), 1U);
+    EXPECT_TRUE(util_tw_timer_cancel(&ctx[1].timer));
+}
+
+typedef struct test_tw_periodic {
+    util_tw_timer_t timer;
+    uint32_t fired;
+    uint32_t stop_at;
+} test_tw_periodic_t;
+
+static void test_tw_periodic_cb(void *args)
+{
+    test_tw_periodic_t *p = (test_tw_periodic_t *)args;
+    if (++p->fired == p->stop_at) {
+        EXPECT_TRUE(util_tw_timer_cancel(&p->timer));
+    }
+}
+
+TEST_F(UtilTimerWheelTest, TestPeriodicCancelInCallback)
+{
+    test_tw_periodic_t p = {};
+    p.stop_at = 5;
+    util_tw_timer_init(&p.timer, test_tw_periodic_cb, &p);
+    ASSERT_EQ(util_tw_timer_add(tw, &p.timer, 200, true), URPC_SUCCESS);
+
+    test_tw_poll_until(tw, get_timestamp_ns() + 5 * NS_PER_MS);
+    EXPECT_EQ(p.fired, 5U);
+    EXPECT_TRUE(util_tw_timer_is_idle(&p.timer));
+    EXPECT_EQ(util_timer_wheel_pending_num(tw), 0U);
+}
+
+// other threads cancel while owner keeps polling, a cancelled timer never fires
+TEST_F(UtilTimerWheelTest, TestRemoteCancel)
+{
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+        ASSERT_EQ(Add(&ctx[i], 2000 + (i % 100) * 10), URPC_SUCCESS);
+    }
+
+    std::atomic<bool> done(false);
+    std::vector<uint32_t> cancelled(TEST_TW_TIMER_NUM, 0);
+    std::thread canceler([&]() {
+        for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i += 2) {
+            cancelled[i] = util_tw_timer_cancel(&ctx[i].timer) ? 1 : 0;
+        }
+        done = true;
+    });
+    while (!done.load()) {
+        (void)util_timer_wheel_poll(tw);
+    }
+    canceler.join();
+
+    test_tw_poll_until(tw, get_timestamp_ns() + 4 * NS_PER_MS);
+    uint32_t cancelled_num = 0;
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+        EXPECT_TRUE(util_tw_timer_is_idle(&ctx[i].timer));
+        if (cancelled[i] != 0) {
+            cancelled_num++;
+            EXPECT_EQ(ctx[i].fired, 0U);
+        } else {
+            EXPECT_EQ(ctx[i].fired, 1U);
+        }
+    }
+    util_timer_wheel_stats_t stats;
+    util_timer_wheel_stats_get(tw, &stats);
+    EXPECT_EQ(stats.remote_cancelled, (uint64_t)cancelled_num);
+    EXPECT_EQ(util_timer_wheel_pending_num(tw), 0U);
+}
+
+// destroy detaches pending and remotely cancelled timers, so they can be cancelled or added to another wheel later
+TEST_F(UtilTimerWheelTest, TestDestroyDetachTimers)
+{
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+        ASSERT_EQ(Add(&ctx[i], 1000), URPC_SUCCESS);
+    }
+    std::thread canceler([&]() {
+        for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i += 2) {
+            EXPECT_TRUE(util_tw_timer_cancel(&ctx[i].timer));
+        }
+    });
+    canceler.join();
+
+    util_timer_wheel_destroy(tw);
+    tw = util_timer_wheel_create(TEST_TW_TICK_US, 0);
+    ASSERT_NE(tw, nullptr);
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+        EXPECT_TRUE(util_tw_timer_is_idle(&ctx[i].timer));
+        EXPECT_EQ(ctx[i].timer.tw, nullptr);
+        EXPECT_FALSE(util_tw_timer_cancel(&ctx[i].timer));
+        ASSERT_EQ(Add(&ctx[i], TEST_TW_TICK_US), URPC_SUCCESS);
+    }
+
+    test_tw_poll_until(tw, get_timestamp_ns() + 2 * NS_PER_MS);
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+        EXPECT_EQ(ctx[i].fired, 1U);
+    }
+}
+
+// work deferred by other threads runs on the owner once the cancels queued before are drained, or at destroy
+TEST_F(UtilTimerWheelTest, TestDeferAfterRemoteCancel)
+{
+    for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+        ASSERT_EQ(Add(&ctx[i], US_PER_SEC), URPC_SUCCESS);
+    }
+    test_tw_defer_ctx_t defer = {&ctx, 0};
+    std::thread canceler([&]() {
+        for (uint32_t i = 0; i < TEST_TW_TIMER_NUM; i++) {
+            EXPECT_TRUE(util_tw_timer_cancel(&ctx[i].timer));
+            EXPECT_EQ(util_tw_timer_cancel_wheel(&ctx[i].timer), tw);
+        }
+        EXPECT_EQ(util_timer_wheel_defer(tw, test_tw_defer_cb, &defer), URPC_SUCCESS);
+    });
+    canceler.join();
+
+    EXPECT_EQ(defer.idle_num, 0U);
+    (void)util_timer_wheel_poll(tw);
+    EXPECT_EQ(defer.idle_num, (uint32_t)TEST_TW_TIMER_NUM);
+    EXPECT_EQ(util_tw_timer_cancel_wheel(&ctx[0].timer), nullptr);
+
+    defer.idle_num = 0;
+    ASSERT_EQ(Add(&ctx[0], US_PER_SEC), URPC_SUCCESS);
+    std::thread deferer([&]() {
+        EXPECT_TRUE(util_tw_timer_cancel(&ctx[0].timer));
+        EXPECT_EQ(util_timer_wheel_defer(tw, test_tw_defer_cb, &defer), URPC_SUCCESS);
+    });
+    deferer.join();
+    util_timer_wheel_destroy(tw);
+    tw = nullptr;
+    EXPECT_EQ(defer.idle_num, (uint32_t)TEST_TW_TIMER_NUM);
+}
+
+// wheel of an exited thread is destroyed with it, its timers are left idle and detached
+TEST_F(UtilTimerWheelTest, TestThreadWheelExit)
+{
+    std::thread owner([&]() {
+        util_timer_wheel_t *thread_tw = util_timer_wheel_thread_get(TEST_TW_TICK_US, 0);
+        ASSERT_NE(thread_tw, nullptr);
+        EXPECT_EQ(util_timer_wheel_thread_peek(), thread_tw);
+        EXPECT_EQ(util_tw_timer_add(thread_tw, &ctx[0].timer, US_PER_SEC, false), URPC_SUCCESS);
+    });
+    owner.join();
+
+    EXPECT_EQ(util_timer_wheel_thread_peek(), nullptr);
+    EXPECT_TRUE(util_tw_timer_is_idle(&ctx[0].timer));
+    EXPECT_FALSE(util_tw_timer_cancel(&ctx[0].timer));
+    EXPECT_EQ(ctx[0].fired, 0U);
+}
+
+TEST_F(UtilTimerWheelTest, TestDriveByFd)
+{
+    util_timer_wheel_t *fd_tw = util_timer_wheel_create(TEST_TW_TICK_US, UTIL_TIMER_WHEEL_FLAG_FD);
+    ASSERT_NE(fd_tw, nullptr);
+    int fd = util_timer_wheel_fd_get(fd_tw);
+    ASSERT_GE(fd, 0);
+    int epoll_fd = epoll_create1(0);
+    ASSERT_GE(epoll_fd, 0);
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ASSERT_EQ(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev), 0);
+
+    ctx[0].deadline_ns = get_timestamp_ns() + 500 * NS_PER_US;
+    ASSERT_EQ(util_tw_timer_add(fd_tw, &ctx[0].timer, 500, false), URPC_SUCCESS);
+    uint64_t end_ns = get_timestamp_ns() + 100 * NS_PER_MS;
+    while (ctx[0].fired == 0 && get_timestamp_ns() < end_ns) {
+        if (epoll_wait(epoll_fd, &ev, 1, 10) > 0) {
+            (void)util_timer_wheel_fd_process(fd_tw);
+        }
+    }
+    EXPECT_EQ(ctx[0].fired, 1U);
+    EXPECT_GE(ctx[0].fired_ns, ctx[0].deadline_ns);
+
+    // fd is disarmed once no timer is pending
+    EXPECT_EQ(util_timer_wheel_pending_num(fd_tw), 0U);
+    EXPECT_EQ(epoll_wait(epoll_fd, &ev, 1, 5), 0);
+
+    (void)close(epoll_fd);
+    util_timer_wheel_destroy(fd_tw);
+}
+
+TEST_F(UtilTimerWheelTest, TestThreadWheel)
+{
+    util_timer_wheel_t *first = nullptr;
+    std::thread t([&first]() {
+        first = util_timer_wheel_thread_get(UTIL_TIMER_WHEEL_DEFAULT_TICK_US, 0);
+        EXPECT_NE(first, nullptr);
+        EXPECT_EQ(util_timer_wheel_thread_get(UTIL_TIMER_WHEEL_DEFAULT_TICK_US, 0), first);
+    });
+    t.join();
+    EXPECT_NE(first, nullptr);
+}
+
+static void test_tw_nop_cb(void *args)
+{
+    (void)args;
+}
+
+// run func on thread_num threads at once, return ns of the slowest one
+template <typename F> static uint64_t TestTwRunThreads(uint32_t thread_num, F func)
+{
+    std::atomic<uint32_t> ready(0);
+    std::atomic<bool> start(false);
+    std::vector<uint64_t> cost(thread_num, 0);
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads.emplace_back([&, i]() {
+            ready++;
+            while (!start.load()) {
+            }
+            uint64_t begin = get_timestamp_ns();
+            func(i);
+            cost[i] = get_timestamp_ns() - begin;
+        });
+    }
+    while (ready.load() != thread_num) {
+    }
+    start.store(true);
+
+    uint64_t max_cost = 0;
+    for (uint32_t i = 0; i < thread_num; i++) {
+        threads[i].join();
+        max_cost = std::max(max_cost, cost[i]);
+    }
+    return max_cost;
+}
+
+// add and cancel as request timeouts do, on the global locked wheel and on per thread wheels
+TEST_F(UtilTimerWheelTest, TestAddCancelExpireBench)
+{
+    ASSERT_EQ(urpc_timing_wheel_init(), URPC_SUCCESS);
+    uint64_t global_ns = TestTwRunThreads(TEST_TW_BENCH_THREAD_NUM, [](uint32_t) {
+        for (uint32_t j = 0; j < TEST_TW_BENCH_NUM; j++) {
+            urpc_timer_t *timer = urpc_timer_create(URPC_INVALID_ID_U32, false);
+            ASSERT_NE(timer, nullptr);
+            ASSERT_EQ(urpc_timer_start(timer, TEST_TW_BENCH_TIMEOUT_MS, test_tw_nop_cb, nullptr, false), URPC_SUCCESS);
+            urpc_timer_destroy(timer);
+        }
+    });
+    urpc_timing_wheel_uninit();
+
+    uint64_t local_ns = TestTwRunThreads(TEST_TW_BENCH_THREAD_NUM, [](uint32_t) {
+        util_timer_wheel_t *wheel = util_timer_wheel_thread_get(TEST_TW_TICK_US, 0);
+        ASSERT_NE(wheel, nullptr);
+        util_tw_timer_t timer;
+        util_tw_timer_init(&timer, test_tw_nop_cb, nullptr);
+        for (uint32_t j = 0; j < TEST_TW_BENCH_NUM; j++) {
+            ASSERT_EQ(util_tw_timer_add(wheel, &timer, TEST_TW_BENCH_TIMEOUT_MS * (US_PER_SEC / MS_PER_SEC), false), URPC_SUCCESS);
+            ASSERT_TRUE(util_tw_timer_cancel(&timer));
+        }
+    });
+
+    // expire: timers all due, one poll fires them
+    std::vector<util_tw_timer_t> timers(TEST_TW_BENCH_NUM);
+    for (auto &t : timers) {
+        util_tw_timer_init(&t, test_tw_nop_cb, nullptr);
+        ASSERT_EQ(util_tw_timer_add(tw, &t, (&t - &timers[0]) % 100, false), URPC_SUCCESS);
+    }
+    test_tw_poll_until(tw, get_timestamp_ns() + 100 * TEST_TW_TICK_US * NS_PER_US);
+    uint64_t begin = get_timestamp_ns();
+    for (auto &t : timers) {
+        ASSERT_EQ(util_tw_timer_add(tw, &t, 0, false), URPC_SUCCESS);
+    }
+    uint64_t add_ns = get_timestamp_ns() - begin;
+    test_tw_poll_until(tw, get_timestamp_ns() + 2 * TEST_TW_TICK_US * NS_PER_US);
+    uint64_t expire_ns = get_timestamp_ns() - begin - add_ns;
+    EXPECT_EQ(util_timer_wheel_pending_num(tw), 0U);
+
+    printf("%d threads, global wheel: %.1f ns/add+cancel, per thread wheel: %.1f ns/add+cancel, "
+        "expire %.1f ns/timer\n", TEST_TW_BENCH_THREAD_NUM, (double)global_ns / TEST_TW_BENCH_NUM,
+        (double)local_ns / TEST_TW_BENCH_NUM, (double)expire_ns / TEST_TW_BENCH_NUM);
+}
+
+// lateness of expiry driven by a busy poll loop, timeouts of 0.1ms to 5ms
+TEST_F(UtilTimerWheelTest, TestExpiryJitterBench)
+{
+    std::vector<test_tw_ctx_t> jitter_ctx(TEST_TW_JITTER_NUM);
+    uint64_t max_timeout_us = 0;
+    for (uint32_t i = 0; i < TEST_TW_JITTER_NUM; i++) {
+        util_tw_timer_init(&jitter_ctx[i].timer, test_tw_cb, &jitter_ctx[i]);
+        uint64_t timeout_us = 100 + (uint64_t)(i * 2477) % 4900;
+        max_timeout_us = std::max(max_timeout_us, timeout_us);
+        ASSERT_EQ(Add(&jitter_ctx[i], timeout_us), URPC_SUCCESS);
+    }
+    test_tw_poll_until(tw, get_timestamp_ns() + (max_timeout_us + 2 * TEST_TW_TICK_US) * NS_PER_US);
+
+    std::vector<uint64_t> late_ns;
+    for (auto &c : jitter_ctx) {
+        ASSERT_EQ(c.fired, 1U);
+        ASSERT_GE(c.fired_ns, c.deadline_ns);
+        late_ns.push_back(c.fired_ns - c.deadline_ns);
+    }
+    std::sort(late_ns.begin(), late_ns.end());
+    printf("tick %d us, expiry lateness p50 %.1f us, p99 %.1f us, max %.1f us\n", TEST_TW_TICK_US,
+        (double)late_ns[late_ns.size() / 2] / NS_PER_US, (double)late_ns[late_ns.size() * 99 / 100] / NS_PER_US,
+        (double)late_ns.back() / NS_PER_US);
+}
@@ -93,6 +93,7 @@ TEST(UrpcUtilTest, TestEslabAlloc)
     slab.total = 1;
     slab.obj_size = sizeof(uint32_t);
     slab.addr = (void *)addr;
+    slab.cache = nullptr;
     void *ret = eslab_alloc(&slab, &id);
     ASSERT_EQ(ret, (void *)NULL);
     ASSERT_EQ(errno, URPC_ERR_EPERM);